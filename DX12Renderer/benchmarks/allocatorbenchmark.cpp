@@ -0,0 +1,208 @@
+/**
+ * Throughput and fragmentation of the TLSF allocator and the GPU memory
+ * allocator on the null backend, with committed resources as the baseline.
+ */
+#include "benchmark.h"
+#include "gpumemoryallocator.h"
+#include "rhinull.h"
+#include "tlsfallocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct TlsfOperation {
+    // Index into the live allocations, freed if allocate is false.
+    uint32_t index;
+    uint64_t size;
+    uint64_t alignment;
+    bool allocate;
+};
+
+// A random mix of allocations from 256 bytes to 1MB that keeps about numLive of them alive.
+std::vector<TlsfOperation> CreateTlsfTrace(uint32_t numOperations, uint32_t numLive, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::vector<TlsfOperation> trace;
+    trace.reserve(numOperations);
+
+    uint32_t live = 0;
+    for (uint32_t i = 0; i < numOperations; ++i) {
+        TlsfOperation operation = {};
+        operation.allocate = live == 0 || (live < 2 * numLive && random() % (2 * numLive) >= live);
+        if (operation.allocate) {
+            operation.index = live++;
+            operation.size = (256ull << (random() % 13)) + (random() % 64) * 256;
+            operation.alignment = 256ull << (random() % 9);
+        } else {
+            operation.index = random() % live--;
+        }
+        trace.push_back(operation);
+    }
+    return trace;
+}
+
+struct TlsfResult {
+    uint32_t numFailed;
+    double utilization;
+    double fragmentation;
+};
+
+// Replays the trace, live allocations are swapped to the back when freed.
+TlsfResult ReplayTlsfTrace(TlsfAllocator& allocator, const std::vector<TlsfOperation>& trace) {
+    TlsfResult result = {};
+    std::vector<uint64_t> offsets;
+    offsets.reserve(trace.size());
+
+    for (const TlsfOperation& operation : trace) {
+        if (operation.allocate) {
+            uint64_t offset = allocator.Allocate(operation.size, operation.alignment);
+            if (offset == TlsfAllocator::InvalidOffset) {
+                // Keep the indices of the trace valid, the free of the entry is skipped.
+                ++result.numFailed;
+            }
+            offsets.push_back(offset);
+        } else {
+            if (offsets[operation.index] != TlsfAllocator::InvalidOffset) {
+                allocator.Free(offsets[operation.index]);
+            }
+            offsets[operation.index] = offsets.back();
+            offsets.pop_back();
+        }
+    }
+
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    result.utilization = static_cast<double>(stats.usedBytes) / stats.size;
+    result.fragmentation = stats.freeBytes > 0 ? 1.0 - static_cast<double>(stats.largestFreeBlock) / stats.freeBytes : 0.0;
+
+    for (uint64_t offset : offsets) {
+        if (offset != TlsfAllocator::InvalidOffset) {
+            allocator.Free(offset);
+        }
+    }
+    return result;
+}
+
+void BenchmarkTlsf(const bench::Options& options) {
+    bench::PrintHeader("TlsfAllocator");
+
+    const uint32_t numOperations = bench::Scale(options, 1000000);
+    const std::vector<TlsfOperation> trace = CreateTlsfTrace(numOperations, 512, 1);
+
+    // The live set fits the range easily, this measures the cost of the operations.
+    TlsfAllocator largeAllocator(1024ull * 1024 * 1024, 256);
+    TlsfResult result;
+    double ms = bench::Measure(options, [&]() { result = ReplayTlsfTrace(largeAllocator, trace); });
+    bench::PrintRow("Allocate and free", ms * 1e6 / numOperations, "ns/operation");
+
+    // The live set about fills the range, failures and the free space left in pieces show the fragmentation.
+    TlsfAllocator smallAllocator(96ull * 1024 * 1024, 256);
+    bench::Measure(options, [&]() { result = ReplayTlsfTrace(smallAllocator, trace); });
+    bench::PrintRow("Failed allocations of a full range", 100.0 * result.numFailed / numOperations, "%");
+    bench::PrintRow("Utilization at the end", 100.0 * result.utilization, "%");
+    bench::PrintRow("External fragmentation at the end", 100.0 * result.fragmentation, "%");
+}
+
+void BenchmarkGpuMemoryAllocator(const bench::Options& options) {
+    bench::PrintHeader("GpuMemoryAllocator");
+
+    auto device = std::make_shared<NullRHIDevice>();
+    const uint32_t numBuffers = bench::Scale(options, 20000);
+    // The null heaps of buffers reserve CPU memory, a GB of them is enough.
+    const uint32_t numLargeBuffers = bench::Scale(options, 2000);
+
+    std::mt19937 random(2);
+    std::vector<uint64_t> smallSizes(numBuffers);
+    std::vector<uint64_t> largeSizes(numLargeBuffers);
+    for (uint32_t i = 0; i < numBuffers; ++i) {
+        smallSizes[i] = 16 + random() % 8192;
+    }
+    for (uint32_t i = 0; i < numLargeBuffers; ++i) {
+        largeSizes[i] = 64 * 1024 + random() % (1024 * 1024);
+    }
+
+    uint64_t smallBytes = 0;
+    for (uint64_t size : smallSizes) {
+        smallBytes += size;
+    }
+
+    std::vector<GpuAllocation> allocations(numBuffers);
+    std::vector< std::shared_ptr<RHIResource> > resources(numBuffers);
+    GpuMemoryAllocator::Stats stats = {};
+
+    double ms = bench::Measure(options, [&]() {
+        for (uint32_t i = 0; i < numBuffers; ++i) {
+            resources[i] = device->CreateCommittedResource(RHIHeapType::Upload, RHIResourceDesc::Buffer(smallSizes[i]),
+                RHIResourceState_GenericRead);
+        }
+        resources.assign(numBuffers, nullptr);
+    });
+    bench::PrintRow("Committed small buffers, create and release", ms * 1e6 / numBuffers, "ns/buffer");
+
+    ms = bench::Measure(options, [&]() {
+        GpuMemoryAllocator allocator(device, nullptr);
+        for (uint32_t i = 0; i < numBuffers; ++i) {
+            allocations[i] = allocator.CreateBuffer(RHIHeapType::Upload, smallSizes[i]);
+        }
+        stats = allocator.GetStats();
+        allocations.clear();
+        allocations.resize(numBuffers);
+    });
+    bench::PrintRow("Packed small buffers, create and free", ms * 1e6 / numBuffers, "ns/buffer");
+    bench::PrintRow("Packed small buffers, memory per requested byte",
+        static_cast<double>(stats.packedBufferBytes) / smallBytes, "");
+    bench::PrintRow("Committed small buffers, memory per requested byte",
+        static_cast<double>(numBuffers) * 64 * 1024 / smallBytes, "");
+
+    allocations.clear();
+    allocations.resize(numLargeBuffers);
+    ms = bench::Measure(options, [&]() {
+        GpuMemoryAllocator allocator(device, nullptr);
+        for (uint32_t i = 0; i < numLargeBuffers; ++i) {
+            allocations[i] = allocator.CreateBuffer(RHIHeapType::Default, largeSizes[i]);
+        }
+        stats = allocator.GetStats();
+        allocations.clear();
+        allocations.resize(numLargeBuffers);
+    });
+    bench::PrintRow("Placed buffers, create and free", ms * 1e6 / numLargeBuffers, "ns/buffer");
+    bench::PrintRow("Placed buffers, heap utilization", 100.0 * stats.heapUsedBytes / stats.heapBytes, "%");
+
+    // Replace buffers at random by buffers of other sizes, as streaming does.
+    GpuMemoryAllocator allocator(device, nullptr);
+    for (uint32_t i = 0; i < numLargeBuffers; ++i) {
+        allocations[i] = allocator.CreateBuffer(RHIHeapType::Default, largeSizes[i]);
+    }
+    const uint32_t numHeapsBefore = allocator.GetStats().numHeaps;
+
+    ms = bench::Measure(options, [&]() {
+        for (uint32_t i = 0; i < numLargeBuffers; ++i) {
+            uint32_t index = random() % numLargeBuffers;
+            allocations[index] = GpuAllocation();
+            allocations[index] = allocator.CreateBuffer(RHIHeapType::Default, largeSizes[(index + i) % numLargeBuffers]);
+        }
+    });
+    stats = allocator.GetStats();
+    bench::PrintRow("Placed buffers, replace at random", ms * 1e6 / numLargeBuffers, "ns/buffer");
+    bench::PrintRow("Placed buffers, heaps added by replacing", stats.numHeaps - numHeapsBefore, "");
+    bench::PrintRow("Placed buffers, heap utilization after replacing", 100.0 * stats.heapUsedBytes / stats.heapBytes, "%");
+
+    // Once everything is freed, Trim releases all heaps but one.
+    const uint32_t numHeapsBeforeTrim = allocator.GetStats().numHeaps;
+    allocations.clear();
+    allocator.Trim();
+    bench::PrintRow("Heaps released by Trim", numHeapsBeforeTrim - allocator.GetStats().numHeaps, "");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bench::Options options = bench::ParseOptions(argc, argv);
+
+    BenchmarkTlsf(options);
+    BenchmarkGpuMemoryAllocator(options);
+
+    return 0;
+}
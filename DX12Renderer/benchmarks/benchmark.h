@@ -0,0 +1,65 @@
+/**
+ * Minimal benchmark harness.
+ *
+ * A benchmark is an executable that measures a few workloads and prints a
+ * row per result. Workloads are run several times and the fastest run is
+ * reported, it is the one least disturbed by the rest of the system.
+ *
+ * With --quick every workload runs once on a fraction of the work, so ctest
+ * can check that the benchmarks still run without spending time on them.
+ */
+#pragma once
+
+#include "highresolutionclock.h"    // For HighResolutionClock
+
+#include <algorithm>                // For std::min
+#include <chrono>                   // For std::chrono::duration
+#include <cstdint>                  // For uint32_t and uint64_t
+#include <cstdio>                   // For std::printf
+#include <cstring>                  // For std::strcmp
+
+namespace bench {
+
+struct Options {
+    bool quick;
+    uint32_t numRuns;
+};
+
+inline Options ParseOptions(int argc, char** argv) {
+    Options options = { false, 5 };
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+            options.numRuns = 1;
+        }
+    }
+    return options;
+}
+
+// Scale an amount of work down in quick runs.
+inline uint32_t Scale(const Options& options, uint32_t amount) {
+    return options.quick ? std::max(amount / 100, 1u) : amount;
+}
+
+// Run the workload numRuns times and return the fastest run in milliseconds.
+template<typename Workload>
+double Measure(const Options& options, Workload workload) {
+    double fastestMs = 0.0;
+    for (uint32_t run = 0; run < options.numRuns; ++run) {
+        auto start = HighResolutionClock::Now();
+        workload();
+        double ms = std::chrono::duration<double, std::milli>(HighResolutionClock::Now() - start).count();
+        fastestMs = run == 0 ? ms : std::min(fastestMs, ms);
+    }
+    return fastestMs;
+}
+
+inline void PrintHeader(const char* title) {
+    std::printf("\n%s\n", title);
+}
+
+inline void PrintRow(const char* name, double value, const char* unit) {
+    std::printf("  %-44s %12.3f %s\n", name, value, unit);
+}
+
+} // namespace bench
@@ -0,0 +1,80 @@
+/**
+ * Scaling of the job system with the number of threads: the speedup of a
+ * ParallelFor over work heavy enough to hide the scheduling, and the cost
+ * per job of many tiny jobs, where the scheduling is all there is.
+ */
+#include "benchmark.h"
+#include "jobsystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A few dozen nanoseconds of arithmetic per item that the compiler cannot remove.
+void Work(std::vector<float>& output, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+        float x = i * 0.001f;
+        for (int j = 0; j < 16; ++j) {
+            x = std::sin(x) + 0.5f;
+        }
+        output[i] = x;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bench::Options options = bench::ParseOptions(argc, argv);
+
+    const uint32_t numItems = bench::Scale(options, 1 << 22);
+    const uint32_t numTinyJobs = bench::Scale(options, 200000);
+    std::vector<float> output(numItems);
+
+    // Up to twice the hardware threads, oversubscription shows how idle workers behave.
+    const uint32_t numHardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t numThreads = 1; numThreads < 2 * numHardwareThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(2 * numHardwareThreads);
+
+    double singleThreadMs = 0.0;
+    for (uint32_t numThreads : threadCounts) {
+        JobSystem::Settings settings;
+        settings.numWorkers = numThreads - 1;
+        JobSystem jobSystem(settings);
+
+        const std::string header = "JobSystem, " + std::to_string(numThreads) + (numThreads == 1 ? " thread" : " threads");
+        bench::PrintHeader(header.c_str());
+
+        const double ms = bench::Measure(options, [&]() {
+            jobSystem.ParallelFor(numItems, 4096, [&output](uint32_t begin, uint32_t end) { Work(output, begin, end); });
+        });
+        if (numThreads == 1) {
+            singleThreadMs = ms;
+        }
+        bench::PrintRow("ParallelFor", ms, "ms");
+        bench::PrintRow("ParallelFor speedup", singleThreadMs / ms, "x");
+
+        std::atomic<uint32_t> sink(0);
+        const JobSystem::Stats before = jobSystem.GetStats();
+        const double tinyMs = bench::Measure(options, [&]() {
+            JobCounter counter;
+            for (uint32_t i = 0; i < numTinyJobs; ++i) {
+                jobSystem.Run([&sink]() { sink.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            }
+            jobSystem.Wait(counter);
+        });
+        const JobSystem::Stats stats = jobSystem.GetStats();
+        bench::PrintRow("Tiny jobs", tinyMs * 1e6 / numTinyJobs, "ns/job");
+        bench::PrintRow("Tiny jobs stolen", 100.0 * (stats.numSteals - before.numSteals) / (stats.numJobs - before.numJobs), "%");
+    }
+
+    return 0;
+}
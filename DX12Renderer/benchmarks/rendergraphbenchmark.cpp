@@ -0,0 +1,119 @@
+/**
+ * Time spent by the render graph to declare and compile graphs of growing
+ * size and of different shapes, per pass. The graph is rebuilt every frame
+ * so this is a cost paid on the CPU every frame.
+ */
+#include "benchmark.h"
+#include "rendergraph.h"
+#include "rhinull.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+void Nothing(RenderGraph&, RHICommandList*) {
+}
+
+RHIResourceDesc RenderTargetDesc() {
+    return RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, 256, 256, RHIResourceFlag_AllowRenderTarget);
+}
+
+// Every pass reads the target of the one before it, nothing can be reordered
+// and every target can alias the one two passes back.
+void DeclareChain(RenderGraph& graph, uint32_t numPasses) {
+    RenderGraphResource previous = graph.CreateResource("Target", RenderTargetDesc());
+    graph.AddPass("Pass", Nothing).Write(previous, RHIResourceState_RenderTarget);
+    for (uint32_t i = 1; i < numPasses; ++i) {
+        RenderGraphResource target = graph.CreateResource("Target", RenderTargetDesc());
+        RenderGraphPassBuilder pass = graph.AddPass("Pass", Nothing)
+            .Read(previous, RHIResourceState_PixelShaderResource)
+            .Write(target, RHIResourceState_RenderTarget);
+        if (i + 1 == numPasses) {
+            pass.SetSideEffects();
+        }
+        previous = target;
+    }
+}
+
+// One pass writes a target every other pass reads to write their own, a last
+// pass reads all of those. The readers are free to run in any order and all
+// their targets live at once.
+void DeclareFanOut(RenderGraph& graph, uint32_t numPasses) {
+    RenderGraphResource source = graph.CreateResource("Source", RenderTargetDesc());
+    graph.AddPass("Source", Nothing).Write(source, RHIResourceState_RenderTarget);
+
+    std::vector<RenderGraphResource> targets;
+    for (uint32_t i = 2; i < numPasses; ++i) {
+        RenderGraphResource target = graph.CreateResource("Target", RenderTargetDesc());
+        graph.AddPass("Pass", Nothing)
+            .Read(source, RHIResourceState_PixelShaderResource)
+            .Write(target, RHIResourceState_RenderTarget);
+        targets.push_back(target);
+    }
+
+    RenderGraphPassBuilder gather = graph.AddPass("Gather", Nothing);
+    for (RenderGraphResource target : targets) {
+        gather.Read(target, RHIResourceState_PixelShaderResource);
+    }
+    gather.SetSideEffects();
+}
+
+// Passes in turn write and read a buffer as unordered access, as a chain of
+// compute dispatches working in place does.
+void DeclareUnorderedAccess(RenderGraph& graph, uint32_t numPasses) {
+    RenderGraphResource buffer = graph.CreateResource("Buffer",
+        RHIResourceDesc::Buffer(64 * 1024, RHIResourceFlag_AllowUnorderedAccess));
+    for (uint32_t i = 0; i < numPasses; ++i) {
+        RenderGraphPassBuilder pass = graph.AddPass("Dispatch", Nothing);
+        if (i % 2 == 0) {
+            pass.Write(buffer, RHIResourceState_UnorderedAccess);
+        } else {
+            pass.Read(buffer, RHIResourceState_UnorderedAccess);
+        }
+        pass.SetSideEffects();
+    }
+}
+
+template<typename Declare>
+void BenchmarkShape(const bench::Options& options, const char* shape, Declare declare) {
+    auto device = std::make_shared<NullRHIDevice>();
+    RenderGraph graph(device, nullptr);
+
+    bench::PrintHeader(shape);
+    for (uint32_t numPasses : { 16u, 64u, 256u, 1024u }) {
+        // Compile a few graphs per run so the small ones take long enough to measure.
+        const uint32_t numGraphs = bench::Scale(options, 100 * 1024 / numPasses);
+        double ms = bench::Measure(options, [&]() {
+            for (uint32_t i = 0; i < numGraphs; ++i) {
+                graph.Reset();
+                declare(graph, numPasses);
+                graph.Compile();
+            }
+        });
+
+        const std::string name = std::to_string(numPasses) + " passes, declare and compile";
+        bench::PrintRow(name.c_str(), ms * 1e6 / (static_cast<double>(numGraphs) * numPasses), "ns/pass");
+    }
+
+    // The aliasing of the largest graph, which the compile time pays for.
+    RenderGraph::Stats stats = graph.GetStats();
+    bench::PrintRow("Transient memory without aliasing", stats.transientBytes / (1024.0 * 1024.0), "MB");
+    bench::PrintRow("Transient memory with aliasing", stats.transientHeapBytes / (1024.0 * 1024.0), "MB");
+    bench::PrintRow("Barriers", stats.numBarriers, "");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const bench::Options options = bench::ParseOptions(argc, argv);
+
+    BenchmarkShape(options, "RenderGraph chain", DeclareChain);
+    BenchmarkShape(options, "RenderGraph fan-out", DeclareFanOut);
+    BenchmarkShape(options, "RenderGraph unordered access", DeclareUnorderedAccess);
+
+    return 0;
+}
@@ -7,12 +7,25 @@
 #include <dxgi1_6.h>
 #include <wrl.h>
 
+#include "descriptorallocator.h"
+#include "framepacer.h"
+
 #include <memory>
 #include <string>
 
 class Window;
 class GameBase;
+class AssetLoader;
 class CommandQueue;
+class BindlessDescriptorTable;
+class DeferredReleaseQueue;
+class DynamicDescriptorHeap;
+class DynamicDescriptorRing;
+class GpuMemoryAllocator;
+class GpuProfiler;
+class JobSystem;
+class ResourceStateMap;
+class RHIDevice;
 
 class Application {
 public:
@@ -42,12 +55,14 @@ public:
     * @param clientWidth The width (in pixels) of the window's client area.
     * @param clientHeight The height (in pixels) of the window's client area.
     * @param vSync Should the rendering be synchronized with the vertical refresh rate of the screen.
+    * @param framesInFlight The number of frames the CPU may queue ahead of the GPU.
     * @param windowed If true, the window will be created in windowed mode. If false, the window will be created full-screen.
     * @returns The created window instance. If an error occurred while creating the window an invalid
     * window instance is returned. If a window with the given name already exists, that window will be
     * returned.
     */
-    std::shared_ptr<Window> CreateRenderWindow(const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync = true);
+    std::shared_ptr<Window> CreateRenderWindow(const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync = true,
+        UINT framesInFlight = FramePacer::DefaultFramesInFlight);
 
     /**
     * Destroy a window given the window name.
@@ -79,6 +94,11 @@ public:
      * Get the Direct3D 12 device
      */
     Microsoft::WRL::ComPtr<ID3D12Device2> GetDevice() const;
+
+    /**
+     * Get the render hardware interface device wrapping the Direct3D 12 device.
+     */
+    std::shared_ptr<RHIDevice> GetRHIDevice() const;
     /**
      * Get a command queue. Valid types are:
      * - D3D12_COMMAND_LIST_TYPE_DIRECT : Can be used for draw, dispatch, or copy commands.
@@ -90,6 +110,62 @@ public:
     // Flush all command queues.
     void Flush();
 
+    /**
+     * Get the queue for objects that may still be in use by the GPU on any command queue.
+     * Use it instead of flushing when a resource is replaced.
+     */
+    std::shared_ptr<DeferredReleaseQueue> GetDeferredReleaseQueue() const;
+
+    /**
+     * Get the GPU timestamp profiler of a command queue.
+     * - D3D12_COMMAND_LIST_TYPE_DIRECT: Frames are begun and ended by the window.
+     * - D3D12_COMMAND_LIST_TYPE_COPY: Profiles the batches of the asset loader,
+     *   its frames and statistics belong to the asset loader's I/O thread.
+     * Nothing is submitted to the compute queue, it has no profiler.
+     */
+    std::shared_ptr<GpuProfiler> GetGpuProfiler(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) const;
+
+    /**
+     * Allocate a contiguous range of CPU visible descriptors from the shared descriptor heaps.
+     * The range is released when the returned allocation is destroyed, once the GPU no longer uses it.
+     */
+    DescriptorAllocation AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors = 1);
+
+    /**
+     * Create a dynamic descriptor heap for a command list. It binds descriptor tables through the
+     * shader visible CBV/SRV/UAV and sampler rings shared by all command lists.
+     */
+    std::shared_ptr<DynamicDescriptorHeap> CreateDynamicDescriptorHeap() const;
+
+    /**
+     * Get the bindless table resources are registered in for access by index.
+     * It lives in the same shader visible heap as the dynamic descriptor ring.
+     */
+    std::shared_ptr<BindlessDescriptorTable> GetBindlessDescriptorTable() const;
+
+    /**
+     * Get the allocator buffers and textures are placed in shared heaps with.
+     */
+    std::shared_ptr<GpuMemoryAllocator> GetGpuMemoryAllocator() const;
+
+    /**
+     * Get the loader that reads files on a background thread and uploads them on the copy queue.
+     * Requests are completed at the start of each frame.
+     */
+    std::shared_ptr<AssetLoader> GetAssetLoader() const;
+
+    /**
+     * Get the job system update, culling and command recording fan out over the cores with.
+     * The main thread is its first thread, it runs jobs while it waits for them.
+     */
+    std::shared_ptr<JobSystem> GetJobSystem() const;
+
+    /**
+     * Get the states of resources shared by all command queues.
+     * Resources used with the resource state trackers of command lists must be registered in it.
+     */
+    std::shared_ptr<ResourceStateMap> GetResourceStateMap() const;
+
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(UINT numDescriptors, D3D12_DESCRIPTOR_HEAP_TYPE type);
     UINT GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const;
 
@@ -113,11 +189,30 @@ private:
 
     Microsoft::WRL::ComPtr<IDXGIAdapter4> m_dxgiAdapter;
     Microsoft::WRL::ComPtr<ID3D12Device2> m_d3d12Device;
+    std::shared_ptr<RHIDevice> m_RHIDevice;
+
+    std::shared_ptr<ResourceStateMap> m_ResourceStateMap;
 
     std::shared_ptr<CommandQueue> m_DirectCommandQueue;
     std::shared_ptr<CommandQueue> m_ComputeCommandQueue;
     std::shared_ptr<CommandQueue> m_CopyCommandQueue;
 
+    std::shared_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+
+    std::shared_ptr<GpuMemoryAllocator> m_GpuMemoryAllocator;
+
+    std::shared_ptr<AssetLoader> m_AssetLoader;
+
+    std::shared_ptr<JobSystem> m_JobSystem;
+
+    std::shared_ptr<DescriptorAllocator> m_DescriptorAllocators[static_cast<size_t>(RHIDescriptorHeapType::NumTypes)];
+    std::shared_ptr<BindlessDescriptorTable> m_BindlessDescriptorTable;
+    std::shared_ptr<DynamicDescriptorRing> m_CbvSrvUavDescriptorRing;
+    std::shared_ptr<DynamicDescriptorRing> m_SamplerDescriptorRing;
+
+    std::shared_ptr<GpuProfiler> m_DirectGpuProfiler;
+    std::shared_ptr<GpuProfiler> m_CopyGpuProfiler;
+
     bool m_TearingSupported;
 
 };
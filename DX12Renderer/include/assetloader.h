@@ -0,0 +1,171 @@
+/**
+ * Asynchronous asset loader.
+ *
+ * Files are read on a background I/O thread. Files that become buffers are
+ * staged in the upload buffer of the copy queue right away and all uploads
+ * read in one go are recorded on a single copy command list, up to a batch
+ * size. Neither the I/O thread nor the main thread waits for the GPU.
+ *
+ * Update is called once per frame when the frame begins, on the render
+ * thread if frames are pipelined, see Window::BeginFrame. Requests whose copy
+ * fence has been passed become ready there and their callbacks are run,
+ * so a resource is usable the frame its upload has finished. The graphics
+ * queue does not have to wait on the copy queue for it. Buffers start in
+ * the common state and rely on implicit state promotion and decay.
+ *
+ * Meshes are memory mapped and their data section is copied from the
+ * mapping straight into upload memory, see meshfile.h.
+ *
+ * With a GPU profiler of the copy queue, every batch is a region of its own.
+ * The I/O thread drives the frames of that profiler, one per batch.
+ *
+ * Requests can be made from any thread.
+ */
+#pragma once
+
+#include "gpumemoryallocator.h"    // For GpuAllocation and GpuMemoryAllocator
+#include "meshfile.h"               // For MeshFile
+
+#include <atomic>                   // For std::atomic
+#include <condition_variable>       // For std::condition_variable
+#include <cstdint>                  // For uint32_t and uint64_t
+#include <deque>                    // For std::deque
+#include <functional>               // For std::function
+#include <memory>                   // For std::shared_ptr
+#include <mutex>                    // For std::mutex
+#include <string>                   // For std::string
+#include <thread>                   // For std::thread
+#include <vector>                   // For std::vector
+
+class CommandQueue;
+class GpuProfiler;
+
+class AssetRequest {
+public:
+    enum class State {
+        Pending,    // Waiting for the I/O thread.
+        Uploading,  // Submitted to the copy queue.
+        Ready,
+        Failed      // The file could not be read.
+    };
+
+    using Callback = std::function<void(AssetRequest& request)>;
+
+    // Requests are ready or failed when their callback runs.
+    State GetState() const;
+    bool IsReady() const;
+    // Ready or failed, and the callback has been run.
+    bool IsDone() const;
+
+    const std::string& GetPath() const;
+    // The contents of files that are not uploaded, valid once ready.
+    const std::vector<uint8_t>& GetData() const;
+    // The buffer of uploads, valid once ready.
+    const GpuAllocation& GetBuffer() const;
+    // Take over the buffer, the request keeps a null allocation.
+    GpuAllocation TakeBuffer();
+    // The mapped mesh file of meshes, valid once ready. The buffer holds its data section.
+    const MeshFile& GetMesh() const;
+
+private:
+    friend class AssetLoader;
+
+    enum class Type {
+        File,
+        Buffer,
+        Mesh
+    };
+
+    AssetRequest(const std::string& path, Type type, uint32_t bufferFlags, Callback callback);
+
+    std::string m_Path;
+    Type m_Type;
+    uint32_t m_BufferFlags;
+    Callback m_Callback;
+
+    std::atomic<State> m_State;
+    // Set by AssetLoader::Update once the callback has been run.
+    std::atomic<bool> m_Done;
+    std::vector<uint8_t> m_Data;
+    GpuAllocation m_Buffer;
+    MeshFile m_Mesh;
+    // Copy queue fence value of the upload, 0 for requests without one.
+    uint64_t m_FenceValue;
+};
+
+class AssetLoader {
+public:
+    // A batch is submitted once this many bytes have been staged.
+    static const size_t DefaultMaxBatchSize = 32 * 1024 * 1024;
+
+    struct Stats {
+        uint64_t numRequests;
+        uint64_t numBatches;
+        uint64_t bytesRead;
+        uint64_t bytesUploaded;
+    };
+
+    /**
+     * Create a loader that uploads on the copy queue. gpuProfiler is an optional
+     * profiler of the copy queue that no other code begins or ends frames of.
+     */
+    AssetLoader(std::shared_ptr<CommandQueue> copyCommandQueue, std::shared_ptr<GpuMemoryAllocator> gpuMemoryAllocator,
+        std::shared_ptr<GpuProfiler> gpuProfiler = nullptr, size_t maxBatchSize = DefaultMaxBatchSize);
+    // Finishes all requests that have been made.
+    virtual ~AssetLoader();
+
+    // Read a file.
+    std::shared_ptr<AssetRequest> LoadFile(const std::string& path, AssetRequest::Callback callback = nullptr);
+    // Read a file into a buffer in the default heap.
+    std::shared_ptr<AssetRequest> LoadBuffer(const std::string& path, uint32_t bufferFlags = RHIResourceFlag_None,
+        AssetRequest::Callback callback = nullptr);
+    // Upload data to a buffer in the default heap. The data is copied, it does not have to outlive the call.
+    std::shared_ptr<AssetRequest> CreateBuffer(const void* data, size_t size, uint32_t bufferFlags = RHIResourceFlag_None,
+        AssetRequest::Callback callback = nullptr);
+    // Map a mesh file and upload its data section to a buffer in the default heap.
+    std::shared_ptr<AssetRequest> LoadMesh(const std::string& path, uint32_t bufferFlags = RHIResourceFlag_None,
+        AssetRequest::Callback callback = nullptr);
+
+    // Complete the requests the GPU is done with and run their callbacks. Call once per frame.
+    void Update();
+    // Wait for all requests made so far and complete them.
+    void Flush();
+
+    // Requests that have not been completed by Update yet.
+    size_t GetNumPendingRequests() const;
+    Stats GetStats() const;
+
+private:
+    void Enqueue(std::shared_ptr<AssetRequest> request);
+    void IOThread();
+    // Read the file of the request. Returns false if it cannot be read.
+    bool ReadFile(AssetRequest& request);
+    // Create the buffer of the request and record the upload of the data to it.
+    void RecordUpload(AssetRequest& request, const uint8_t* data, size_t size, RHICommandList* commandList);
+    // Get the command list of a new batch and begin its profiler region.
+    std::shared_ptr<RHICommandList> BeginBatch();
+    void Submit(std::shared_ptr<RHICommandList>& commandList, std::vector< std::shared_ptr<AssetRequest> >& uploads);
+
+    std::shared_ptr<CommandQueue> m_CopyCommandQueue;
+    std::shared_ptr<GpuMemoryAllocator> m_GpuMemoryAllocator;
+    std::shared_ptr<GpuProfiler> m_GpuProfiler;
+    size_t m_MaxBatchSize;
+    // Profiler region of the batch being recorded, only used by the I/O thread.
+    uint32_t m_BatchRegion;
+
+    // Requests waiting for the I/O thread.
+    std::deque< std::shared_ptr<AssetRequest> > m_Queue;
+    // Requests waiting for their fence, in submission order.
+    std::deque< std::shared_ptr<AssetRequest> > m_Submitted;
+    // Requests the I/O thread is working on.
+    size_t m_NumProcessing;
+    bool m_Stop;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_QueueCondition;
+    std::condition_variable m_IdleCondition;
+
+    std::atomic<size_t> m_NumPendingRequests;
+    Stats m_Stats;
+
+    std::thread m_IOThread;
+};
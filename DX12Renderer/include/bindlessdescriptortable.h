@@ -0,0 +1,75 @@
+/**
+ * Bindless descriptor table.
+ *
+ * Resources are registered once and get a persistent index into a range of
+ * the shader visible CBV/SRV/UAV heap. The range is bound as a single
+ * descriptor table of unbounded descriptor ranges, so shaders access any
+ * registered resource through its index, e.g. passed as a root constant.
+ * Draws do not change descriptor tables anymore and indices can be written
+ * to GPU buffers for GPU driven rendering.
+ *
+ * The table shares the shader visible heap with the DynamicDescriptorRing of
+ * its type, only one CBV/SRV/UAV heap can be bound to a command list.
+ *
+ * All methods are thread safe.
+ */
+#pragma once
+
+#include "rhi.h"    // For RHIDevice, RHIDescriptorHeap and the descriptor handles
+
+#include <cstdint>  // For uint32_t
+#include <memory>   // For std::shared_ptr and std::weak_ptr
+#include <mutex>    // For std::mutex
+#include <vector>   // For std::vector
+
+class DeferredReleaseQueue;
+
+class BindlessDescriptorTable : public std::enable_shared_from_this<BindlessDescriptorTable> {
+public:
+    // Index that is never handed out.
+    static const uint32_t InvalidIndex = UINT32_MAX;
+
+    /**
+     * Use a range of a shader visible CBV/SRV/UAV heap for the table.
+     * If deferredReleaseQueue is null, unregistered indices are reused immediately.
+     */
+    BindlessDescriptorTable(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        std::shared_ptr<RHIDescriptorHeap> descriptorHeap, uint32_t firstDescriptor, uint32_t numDescriptors);
+
+    /**
+     * Copy a descriptor into the table.
+     * Returns the index of the descriptor which stays valid until it is unregistered.
+     * The source descriptor can be freed right away.
+     */
+    uint32_t Register(RHICPUDescriptorHandle srcDescriptor);
+
+    /**
+     * Release an index once the GPU has finished the work submitted so far.
+     * Call this after the last command list that uses the index has been executed.
+     */
+    void Unregister(uint32_t index);
+
+    // The start of the table, bind it to the root descriptor table of the bindless ranges.
+    RHIGPUDescriptorHandle GetGPUDescriptorHandle() const;
+    RHIDescriptorHeap* GetDescriptorHeap() const;
+
+    uint32_t GetNumDescriptors() const;
+    uint32_t GetNumRegistered() const;
+
+private:
+    std::shared_ptr<RHIDevice> m_Device;
+    std::shared_ptr<RHIDescriptorHeap> m_DescriptorHeap;
+    // Not owned, pending releases keep the table alive.
+    std::weak_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+    RHICPUDescriptorHandle m_CPUBase;
+    RHIGPUDescriptorHandle m_GPUBase;
+    uint32_t m_DescriptorSize;
+    uint32_t m_NumDescriptors;
+
+    // Indices that have been released, reused before the table grows.
+    std::vector<uint32_t> m_FreeIndices;
+    // Indices at or above this have never been used.
+    uint32_t m_NextIndex;
+
+    mutable std::mutex m_Mutex;
+};
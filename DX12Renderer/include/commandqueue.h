@@ -1,55 +1,140 @@
 /**
- * Wrapper class for a ID3D12CommandQueue.
+ * Wrapper class for a RHICommandQueue.
+ *
+ * The command queue is thread safe. Any number of threads can retrieve,
+ * record and execute command lists concurrently. Command allocators and
+ * command lists are pooled in shards so threads rarely contend for the
+ * same lock; submission and fence signaling are serialized per queue.
+ *
+ * Every command list has a ResourceStateTracker while it is recorded. When
+ * command lists are executed, their remaining barriers are flushed and the
+ * transitions from the states in the ResourceStateMap are recorded on extra
+ * command lists submitted right before them.
  */
-
 #pragma once
 
-#include <d3d12.h>  // For ID3D12CommandQueue, ID3D12Device2, and ID3D12Fence
-#include <wrl.h>    // For Microsoft::WRL::ComPtr
+#include "resourcestatetracker.h"   // For ResourceStateTracker and ResourceStateMap
+#include "rhi.h"                    // For RHIDevice, RHICommandQueue, RHIFence and RHICommandList
+#include "uploadbuffer.h"           // For UploadBuffer
 
-#include <cstdint>  // For uint64_t
-#include <queue>    // For std::queue
+#include <atomic>           // For std::atomic
+#include <cstdint>          // For uint64_t
+#include <memory>           // For std::shared_ptr
+#include <mutex>            // For std::mutex
+#include <queue>            // For std::queue
+#include <unordered_map>    // For std::unordered_map
+#include <vector>           // For std::vector
 
 class CommandQueue {
 public:
-    CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
+    // Queues that share resources must share the state map. If it is null, the queue creates its own.
+    CommandQueue(std::shared_ptr<RHIDevice> device, RHIQueueType type,
+        std::shared_ptr<ResourceStateMap> resourceStateMap = nullptr);
     virtual ~CommandQueue();
 
     // Get an available command list from the command queue.
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetCommandList();
+    // Every command list that is retrieved must be executed on this queue.
+    std::shared_ptr<RHICommandList> GetCommandList();
 
     // Execute a command list.
     // Returns the fence value to wait for for this command list.
-    uint64_t ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
+    uint64_t ExecuteCommandList(std::shared_ptr<RHICommandList> commandList);
+
+    // Execute a batch of command lists in order with a single submission.
+    // All command lists share one fence value which is returned.
+    uint64_t ExecuteCommandLists(const std::shared_ptr<RHICommandList>* commandLists, size_t numCommandLists);
+    uint64_t ExecuteCommandLists(const std::vector< std::shared_ptr<RHICommandList> >& commandLists);
+
+    // Upload memory for command lists recorded for this queue.
+    // Memory allocated while command lists are being recorded stays valid until
+    // all of these command lists have been executed and have completed on the GPU.
+    UploadBuffer& GetUploadBuffer();
+
+    // The state tracker of a command list retrieved from this queue, reset with the command list.
+    ResourceStateTracker& GetResourceStateTracker(RHICommandList* commandList);
+    std::shared_ptr<ResourceStateMap> GetResourceStateMap() const;
 
     uint64_t Signal();
+    // The fence value of the last signal. All work submitted so far completes at this value.
+    uint64_t GetLastSignaledFenceValue();
     bool IsFenceComplete(uint64_t fenceValue);
     void WaitForFenceValue(uint64_t fenceValue);
     void Flush();
 
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
-protected:
+    // Make all work submitted to this queue from now on wait on the GPU until the other
+    // queue reaches fenceValue. The CPU does not block. Waits that are already satisfied
+    // by an earlier wait or by the GPU's progress are skipped. Library API, the renderer itself has
+    // no caller: the AssetLoader polls the copy queue's fence instead of stalling the direct queue.
+    void Wait(const CommandQueue& other, uint64_t fenceValue);
+
+    // The highest fence value of the other queue this queue has been told to wait for.
+    uint64_t GetWaitedFenceValue(const CommandQueue& other);
 
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CreateCommandAllocator();
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
+    std::shared_ptr<RHICommandQueue> GetRHICommandQueue() const;
+
+protected:
+    std::shared_ptr<RHICommandAllocator> CreateCommandAllocator();
+    std::shared_ptr<RHICommandList> CreateCommandList(std::shared_ptr<RHICommandAllocator> allocator);
 
 private:
     // Keep track of command allocators that are "in-flight"
     struct CommandAllocatorEntry {
         uint64_t fenceValue;
-        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+        std::shared_ptr<RHICommandAllocator> commandAllocator;
     };
 
     using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-    using CommandListQueue = std::queue< Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> >;
+    using CommandListQueue = std::queue< std::shared_ptr<RHICommandList> >;
+
+    // A shard of the allocator and command list pools.
+    // Aligned to a cache line so shards used by different threads do not share one.
+    struct alignas(64) PoolShard {
+        std::mutex              mutex;
+        CommandAllocatorQueue   commandAllocatorQueue;
+        CommandListQueue        commandListQueue;
+    };
+
+    static const size_t NumPoolShards = 8;
+
+    // The shard the calling thread prefers. Threads are spread over the shards round-robin.
+    static size_t GetThreadShardIndex();
+
+    std::shared_ptr<RHICommandAllocator> AcquireCommandAllocator(size_t shardIndex);
+    std::shared_ptr<RHICommandList> AcquireCommandList(size_t shardIndex);
+
+    // Signal the fence. The submit mutex must be held.
+    uint64_t SignalLocked();
+
+    // Return an executed command list and its allocator to the pool. The shard mutex must be held.
+    void RetireCommandList(PoolShard& shard, const std::shared_ptr<RHICommandList>& commandList, uint64_t fenceValue);
+
+    RHIQueueType                        m_CommandListType;
+    std::shared_ptr<RHIDevice>          m_Device;
+    std::shared_ptr<RHICommandQueue>    m_CommandQueue;
+    std::shared_ptr<RHIFence>           m_Fence;
+    std::atomic_uint64_t                m_FenceValue;
+
+    // Serializes submission so fence values are signaled in increasing order.
+    std::mutex                          m_SubmitMutex;
+
+    // Queues this queue depends on and the highest fence value waited for on each.
+    struct Dependency {
+        const CommandQueue* commandQueue;
+        uint64_t fenceValue;
+    };
+    std::vector<Dependency>             m_Dependencies;
+
+    UploadBuffer                        m_UploadBuffer;
+
+    std::shared_ptr<ResourceStateMap>   m_ResourceStateMap;
+    // Trackers stay with their command list while it is pooled. Map nodes are stable.
+    std::unordered_map<RHICommandList*, ResourceStateTracker> m_ResourceStateTrackers;
+    std::mutex                          m_ResourceStateTrackersMutex;
 
-    D3D12_COMMAND_LIST_TYPE                     m_CommandListType;
-    Microsoft::WRL::ComPtr<ID3D12Device2>       m_d3d12Device;
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue>  m_d3d12CommandQueue;
-    Microsoft::WRL::ComPtr<ID3D12Fence>         m_d3d12Fence;
-    HANDLE                                      m_FenceEvent;
-    uint64_t                                    m_FenceValue;
+    // Scratch space of submissions, guarded by the submit mutex.
+    std::vector<RHIResourceBarrier>     m_ResolvedResourceBarriers;
+    std::vector< std::shared_ptr<RHICommandList> > m_SubmittedCommandLists;
+    std::vector<RHICommandList*>        m_SubmittedRHICommandLists;
 
-    CommandAllocatorQueue                       m_CommandAllocatorQueue;
-    CommandListQueue                            m_CommandListQueue;
+    PoolShard                           m_PoolShards[NumPoolShards];
 };
@@ -0,0 +1,70 @@
+/**
+ * Deferred release of GPU objects.
+ *
+ * Objects that may still be referenced by command lists in flight are handed
+ * to the queue instead of being released immediately. Each object is tagged
+ * with the last signaled fence value of every command queue and is released
+ * once the GPU has passed all of them. This avoids flushing the GPU just to
+ * replace a resource, e.g. when the window is resized.
+ *
+ * Any copyable object that keeps a GPU object alive can be queued (a ComPtr,
+ * a std::shared_ptr to an RHI object, ...). All methods are thread safe.
+ */
+#pragma once
+
+#include "commandqueue.h"
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint64_t
+#include <deque>    // For std::deque
+#include <memory>   // For std::shared_ptr
+#include <mutex>    // For std::mutex
+#include <vector>   // For std::vector
+
+class DeferredReleaseQueue {
+public:
+    // The maximum number of command queues an object can be tracked on.
+    static const size_t MaxCommandQueues = 4;
+
+    explicit DeferredReleaseQueue(const std::vector< std::shared_ptr<CommandQueue> >& commandQueues);
+    virtual ~DeferredReleaseQueue();
+
+    /**
+     * Release the object once all work that was submitted up to now has completed.
+     * Call this after the last command list that uses the object has been executed.
+     */
+    template<class T>
+    void Release(T object) {
+        Enqueue(std::make_shared<T>(std::move(object)));
+    }
+
+    /**
+     * Release all objects whose fence values have been reached.
+     * Returns the number of released objects.
+     */
+    size_t ReleaseCompleted();
+
+    /**
+     * Wait for the GPU and release all objects.
+     */
+    void Flush();
+
+    size_t GetNumPendingReleases() const;
+
+private:
+    struct PendingRelease {
+        uint64_t fenceValues[MaxCommandQueues];
+        std::shared_ptr<void> object;
+    };
+
+    void Enqueue(std::shared_ptr<void> object);
+    bool IsComplete(const PendingRelease& pendingRelease) const;
+
+    std::vector< std::shared_ptr<CommandQueue> > m_CommandQueues;
+
+    // Pending releases in submission order. The fence values per queue never
+    // decrease along the queue so only the front has to be checked.
+    std::deque<PendingRelease> m_PendingReleases;
+
+    mutable std::mutex m_Mutex;
+};
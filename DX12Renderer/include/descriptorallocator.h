@@ -0,0 +1,137 @@
+/**
+ * Allocator for CPU visible descriptors.
+ *
+ * Descriptors are allocated in ranges from large descriptor heaps (pages) of
+ * one descriptor heap type, instead of creating a heap for every view. Each
+ * page keeps a free list of blocks sorted by offset and by size, so ranges of
+ * any size can be allocated and adjacent free blocks are merged again.
+ *
+ * Freed ranges may still be referenced by command lists in flight. They are
+ * handed to the DeferredReleaseQueue and only return to the free list once
+ * the GPU has finished all work that was submitted before the range was freed.
+ *
+ * All methods are thread safe.
+ */
+#pragma once
+
+#include "rhi.h"    // For RHIDevice, RHIDescriptorHeap and RHICPUDescriptorHandle
+
+#include <cstdint>  // For uint32_t
+#include <map>      // For std::map and std::multimap
+#include <memory>   // For std::shared_ptr and std::weak_ptr
+#include <mutex>    // For std::mutex
+#include <vector>   // For std::vector
+
+class DeferredReleaseQueue;
+class DescriptorAllocatorPage;
+
+// A range of descriptors. The range is freed when the allocation is destroyed.
+class DescriptorAllocation {
+public:
+    // Creates a null allocation.
+    DescriptorAllocation();
+    DescriptorAllocation(RHICPUDescriptorHandle descriptor, uint32_t numHandles, uint32_t descriptorSize,
+        std::shared_ptr<DescriptorAllocatorPage> page);
+    ~DescriptorAllocation();
+
+    DescriptorAllocation(DescriptorAllocation&& allocation);
+    DescriptorAllocation& operator=(DescriptorAllocation&& other);
+
+    bool IsNull() const;
+
+    // Handle of a descriptor in the range.
+    RHICPUDescriptorHandle GetDescriptorHandle(uint32_t offset = 0) const;
+    uint32_t GetNumHandles() const;
+
+    // Free the range. The allocation is null afterwards.
+    void Free();
+
+private:
+    DescriptorAllocation(const DescriptorAllocation& copy) = delete;
+    DescriptorAllocation& operator=(const DescriptorAllocation& other) = delete;
+
+    RHICPUDescriptorHandle m_Descriptor;
+    uint32_t m_NumHandles;
+    uint32_t m_DescriptorSize;
+    std::shared_ptr<DescriptorAllocatorPage> m_Page;
+};
+
+// A descriptor heap ranges are allocated from.
+class DescriptorAllocatorPage : public std::enable_shared_from_this<DescriptorAllocatorPage> {
+public:
+    DescriptorAllocatorPage(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        RHIDescriptorHeapType type, uint32_t numDescriptors);
+
+    RHIDescriptorHeapType GetHeapType() const;
+    uint32_t GetNumDescriptors() const;
+    uint32_t GetNumFreeHandles() const;
+
+    // Allocate a contiguous range. Returns a null allocation if the page has no free block large enough.
+    DescriptorAllocation Allocate(uint32_t numDescriptors);
+
+    // Return a range to the page once the GPU has finished the work submitted so far.
+    void Free(RHICPUDescriptorHandle descriptor, uint32_t numDescriptors);
+
+private:
+    // Add a block to the free list and merge it with its free neighbors. The mutex must be held.
+    void FreeBlock(uint32_t offset, uint32_t numDescriptors);
+    void AddFreeBlock(uint32_t offset, uint32_t numDescriptors);
+
+    // Free blocks by offset and by size. The entries reference each other.
+    struct FreeBlockInfo;
+    using FreeListByOffset = std::map<uint32_t, FreeBlockInfo>;
+    using FreeListBySize = std::multimap<uint32_t, FreeListByOffset::iterator>;
+
+    struct FreeBlockInfo {
+        uint32_t size;
+        FreeListBySize::iterator bySizeIt;
+    };
+
+    std::shared_ptr<RHIDescriptorHeap> m_DescriptorHeap;
+    // Not owned, pending releases keep the page alive.
+    std::weak_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+    RHIDescriptorHeapType m_HeapType;
+    RHICPUDescriptorHandle m_BaseDescriptor;
+    uint32_t m_DescriptorSize;
+    uint32_t m_NumDescriptors;
+
+    FreeListByOffset m_FreeListByOffset;
+    FreeListBySize m_FreeListBySize;
+    uint32_t m_NumFreeHandles;
+
+    mutable std::mutex m_Mutex;
+};
+
+class DescriptorAllocator {
+public:
+    // Number of descriptors per page if not specified otherwise.
+    static const uint32_t DefaultDescriptorsPerPage = 256;
+
+    /**
+     * Create an allocator for a descriptor heap type.
+     * If deferredReleaseQueue is null, freed ranges are reused immediately.
+     */
+    DescriptorAllocator(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        RHIDescriptorHeapType type, uint32_t numDescriptorsPerPage = DefaultDescriptorsPerPage);
+    virtual ~DescriptorAllocator();
+
+    /**
+     * Allocate a contiguous range of descriptors.
+     * Ranges larger than a page get a page of their own.
+     */
+    DescriptorAllocation Allocate(uint32_t numDescriptors = 1);
+
+    size_t GetNumPages() const;
+
+private:
+    std::shared_ptr<DescriptorAllocatorPage> CreatePage(uint32_t numDescriptors);
+
+    std::shared_ptr<RHIDevice> m_Device;
+    std::shared_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+    RHIDescriptorHeapType m_HeapType;
+    uint32_t m_NumDescriptorsPerPage;
+
+    std::vector< std::shared_ptr<DescriptorAllocatorPage> > m_Pages;
+
+    mutable std::mutex m_Mutex;
+};
@@ -0,0 +1,182 @@
+/**
+ * Dynamic binding of descriptor tables through shader visible descriptor heaps.
+ *
+ * Descriptors are created in CPU visible heaps (see descriptorallocator.h),
+ * shaders can only read them from the shader visible heaps bound to the
+ * command list. Switching shader visible heaps is expensive, so all command
+ * lists share a single shader visible heap per descriptor heap type. The
+ * DynamicDescriptorRing splits (a range of) it into fixed size blocks that are
+ * handed out in ring order and return to the ring once the GPU is done with
+ * the command lists using them.
+ *
+ * A DynamicDescriptorHeap belongs to one command list while it is recorded.
+ * Descriptors are staged per descriptor table of the root signature. Right
+ * before a draw or dispatch only the tables that changed since the last one
+ * are copied to the ring, with a single CopyDescriptors call per heap type,
+ * and bound to the command list. The binding cost per draw therefore depends
+ * on the number of changed descriptors, not on the number of materials.
+ */
+#pragma once
+
+#include "rhi.h"    // For RHIDevice, RHIDescriptorHeap, RHICommandList and the descriptor handles
+
+#include <cstdint>  // For uint32_t and uint64_t
+#include <deque>    // For std::deque
+#include <memory>   // For std::shared_ptr and std::weak_ptr
+#include <mutex>    // For std::mutex
+#include <vector>   // For std::vector
+
+class DeferredReleaseQueue;
+
+// A shader visible descriptor heap allocated in blocks, in ring order.
+class DynamicDescriptorRing : public std::enable_shared_from_this<DynamicDescriptorRing> {
+public:
+    /**
+     * Create the shader visible heap of a heap type. Only CBV/SRV/UAV and sampler heaps can be shader visible.
+     * If deferredReleaseQueue is null, released blocks are reused immediately.
+     */
+    DynamicDescriptorRing(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        RHIDescriptorHeapType type, uint32_t numDescriptors, uint32_t numDescriptorsPerBlock);
+
+    /**
+     * Use a range of an existing shader visible heap, e.g. to share the heap with a BindlessDescriptorTable.
+     * Only one CBV/SRV/UAV and one sampler heap can be bound to a command list at a time.
+     */
+    DynamicDescriptorRing(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        std::shared_ptr<RHIDescriptorHeap> descriptorHeap, uint32_t firstDescriptor, uint32_t numDescriptors,
+        uint32_t numDescriptorsPerBlock);
+
+    RHIDescriptorHeapType GetHeapType() const;
+    RHIDescriptorHeap* GetDescriptorHeap() const;
+    uint32_t GetDescriptorSize() const;
+    uint32_t GetNumDescriptorsPerBlock() const;
+    uint32_t GetNumFreeBlocks() const;
+
+    /**
+     * Take the oldest free block. If all blocks are in use, blocks the GPU has finished
+     * with are reclaimed first and as a last resort the GPU is waited for.
+     * Returns the index of the block.
+     */
+    uint32_t AllocateBlock();
+
+    // Return a block once the GPU has finished the work submitted so far.
+    void ReleaseBlock(uint32_t block);
+
+    RHICPUDescriptorHandle GetCPUDescriptorHandle(uint32_t block, uint32_t offset) const;
+    RHIGPUDescriptorHandle GetGPUDescriptorHandle(uint32_t block, uint32_t offset) const;
+
+private:
+    void Init(RHIDevice& device, uint32_t firstDescriptor, uint32_t numDescriptors);
+
+    std::shared_ptr<RHIDescriptorHeap> m_DescriptorHeap;
+    // Not owned, pending releases keep the ring alive.
+    std::weak_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+    RHIDescriptorHeapType m_HeapType;
+    RHICPUDescriptorHandle m_CPUBase;
+    RHIGPUDescriptorHandle m_GPUBase;
+    uint32_t m_DescriptorSize;
+    uint32_t m_NumDescriptorsPerBlock;
+
+    // Free blocks in the order they were released.
+    std::deque<uint32_t> m_FreeBlocks;
+
+    mutable std::mutex m_Mutex;
+};
+
+class DynamicDescriptorHeap {
+public:
+    // Root signatures are limited to 64 DWORDs, a descriptor table takes one.
+    static const uint32_t MaxRootParameters = 64;
+
+    // A descriptor table of the root signature.
+    struct DescriptorTableLayout {
+        uint32_t rootParameterIndex;
+        RHIDescriptorHeapType type;     // CbvSrvUav or Sampler.
+        uint32_t numDescriptors;        // Must fit in a block of the ring of the type.
+    };
+
+    DynamicDescriptorHeap(std::shared_ptr<RHIDevice> device, std::shared_ptr<DynamicDescriptorRing> cbvSrvUavRing,
+        std::shared_ptr<DynamicDescriptorRing> samplerRing);
+    virtual ~DynamicDescriptorHeap();
+
+    /**
+     * Set the descriptor tables of the root signature bound to the command list.
+     * This drops all staged descriptors, the root signature change unbinds all tables anyway.
+     */
+    void SetRootSignatureLayout(const DescriptorTableLayout* tables, uint32_t numTables);
+
+    /**
+     * Stage a range of CPU visible descriptors for a descriptor table.
+     * The descriptors are copied when the next draw or dispatch is committed, the
+     * source descriptors must stay valid until then. Descriptors of a table that
+     * were never staged are left undefined and must not be accessed by shaders.
+     * @param rootParameterIndex The root parameter of the descriptor table.
+     * @param offset The first descriptor in the table to set.
+     * @param numDescriptors The number of descriptors to set.
+     * @param srcDescriptor The first of numDescriptors consecutive descriptors in a CPU visible heap.
+     */
+    void StageDescriptors(uint32_t rootParameterIndex, uint32_t offset, uint32_t numDescriptors,
+        RHICPUDescriptorHandle srcDescriptor);
+
+    // Copy the changed descriptor tables to the rings and bind them. Call before each draw or dispatch.
+    void CommitStagedDescriptorsForDraw(RHICommandList* commandList);
+    void CommitStagedDescriptorsForDispatch(RHICommandList* commandList);
+
+    /**
+     * Bind the ring heaps to the command list if that has not happened yet.
+     * Committing does this as well. Tables that point into the same heaps but are not
+     * managed here, like a BindlessDescriptorTable, need the heaps bound before use.
+     */
+    void BindDescriptorHeaps(RHICommandList* commandList);
+
+    /**
+     * Prepare for the next command list.
+     * Call after the command list has been executed, the ring blocks are kept until the GPU is done with it.
+     */
+    void Reset();
+
+private:
+    // CbvSrvUav and Sampler, the shader visible heap types.
+    static const uint32_t NumHeapTypes = 2;
+
+    struct DescriptorTable {
+        RHIDescriptorHeapType type;
+        uint32_t numDescriptors;
+        // Index of the first descriptor of the table in m_StagedDescriptors.
+        uint32_t firstStagedDescriptor;
+    };
+
+    struct HeapTypeState {
+        std::shared_ptr<DynamicDescriptorRing> ring;
+        // The block descriptors are currently allocated from and the number of descriptors used in it.
+        uint32_t currentBlock;
+        uint32_t currentBlockOffset;
+        bool hasBlock;
+        // Blocks used by the command list, including the current block.
+        std::vector<uint32_t> usedBlocks;
+        // Bit per root parameter of the tables of this type.
+        uint64_t tableMask;
+    };
+
+    void CommitStagedDescriptors(RHICommandList* commandList, bool graphics);
+    // Copy the dirty tables of one heap type and bind them.
+    void CommitHeapType(HeapTypeState& state, RHICommandList* commandList, bool graphics);
+    RHIGPUDescriptorHandle AllocateTable(HeapTypeState& state, uint32_t numDescriptors, RHICPUDescriptorHandle* cpuDescriptor);
+
+    std::shared_ptr<RHIDevice> m_Device;
+    HeapTypeState m_HeapTypes[NumHeapTypes];
+
+    DescriptorTable m_Tables[MaxRootParameters];
+    std::vector<RHICPUDescriptorHandle> m_StagedDescriptors;
+    // Bit per root parameter of the tables with staged descriptors that have not been committed.
+    uint64_t m_DirtyTableMask;
+
+    // Whether the ring heaps have been bound to the command list.
+    bool m_DescriptorHeapsBound;
+
+    // Scratch arrays for CopyDescriptors, kept to avoid allocations per draw.
+    std::vector<RHICPUDescriptorHandle> m_DestRangeStarts;
+    std::vector<uint32_t> m_DestRangeSizes;
+    std::vector<RHICPUDescriptorHandle> m_SrcRangeStarts;
+    std::vector<uint32_t> m_SrcRangeSizes;
+};
@@ -2,6 +2,8 @@
 
 #include "keycodes.h"
 
+#include <cstdint>
+
 // Base class for all event args
 class EventArgs {
 public:
@@ -143,25 +145,31 @@ public:
 class UpdateEventArgs : public EventArgs {
 public:
     typedef EventArgs base;
-    UpdateEventArgs(double fDeltaTime, double fTotalTime)
+    UpdateEventArgs(double fDeltaTime, double fTotalTime, uint32_t snapshotIndex = 0)
         : ElapsedTime(fDeltaTime)
-        , TotalTime(fTotalTime) {
+        , TotalTime(fTotalTime)
+        , SnapshotIndex(snapshotIndex) {
     }
 
     double ElapsedTime;
     double TotalTime;
+    // The snapshot the update writes the state the render reads to, see FramePipeline.
+    uint32_t SnapshotIndex;
 };
 
 class RenderEventArgs : public EventArgs {
 public:
     typedef EventArgs base;
-    RenderEventArgs(double fDeltaTime, double fTotalTime)
+    RenderEventArgs(double fDeltaTime, double fTotalTime, uint32_t snapshotIndex = 0)
         : ElapsedTime(fDeltaTime)
-        , TotalTime(fTotalTime) {
+        , TotalTime(fTotalTime)
+        , SnapshotIndex(snapshotIndex) {
     }
 
     double ElapsedTime;
     double TotalTime;
+    // The snapshot of the update of this frame to render from, see FramePipeline.
+    uint32_t SnapshotIndex;
 };
 
 class UserEventArgs : public EventArgs {
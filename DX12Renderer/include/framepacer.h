@@ -0,0 +1,79 @@
+/**
+ * Paces the CPU against the GPU with a configurable number of frames in flight.
+ *
+ * Every frame in flight has a frame context which remembers the fence value
+ * that marks the end of the frame's GPU work. BeginFrame blocks until the GPU
+ * has finished the last frame that used the same context, so resources that
+ * are duplicated per frame (indexed by GetFrameIndex) can be reused without
+ * any other synchronization. The CPU waits once at the start of the frame
+ * instead of stalling after present.
+ *
+ * More frames in flight allow more CPU/GPU overlap at the cost of latency.
+ */
+#pragma once
+
+#include "commandqueue.h"
+
+#include <cstdint>  // For uint32_t and uint64_t
+#include <memory>   // For std::shared_ptr
+#include <vector>   // For std::vector
+
+class FramePacer {
+public:
+    // DXGI allows at most 16 swap chain buffers, one more than frames in flight is needed.
+    static const uint32_t MaxFramesInFlight = 15;
+    // Number of frames the CPU may queue ahead of the GPU if not specified otherwise.
+    static const uint32_t DefaultFramesInFlight = 2;
+
+    struct FrameContext {
+        uint64_t FrameNumber;   // The frame the context was last used for.
+        uint64_t FenceValue;    // Fence value that marks the end of the frame's GPU work.
+    };
+
+    FramePacer(std::shared_ptr<CommandQueue> commandQueue, uint32_t numFramesInFlight);
+
+    // Clamp a number of frames in flight to the supported range.
+    static uint32_t ClampFramesInFlight(uint32_t numFramesInFlight);
+
+    /**
+     * Change the number of frames in flight.
+     * Waits until the GPU has finished all frames in flight so that per-frame resources
+     * can be resized. Must not be called between BeginFrame and EndFrame.
+     */
+    void SetNumFramesInFlight(uint32_t numFramesInFlight);
+    uint32_t GetNumFramesInFlight() const;
+
+    /**
+     * Start a new frame.
+     * Blocks until the GPU is done with the frame that last used the frame context.
+     */
+    void BeginFrame();
+
+    /**
+     * End the current frame.
+     * @param fenceValue Fence value of the command queue signaled after all work of the frame.
+     */
+    void EndFrame(uint64_t fenceValue);
+
+    /**
+     * Wait until the GPU has finished all frames in flight.
+     */
+    void WaitForIdle();
+
+    // The number of the current frame, starting with 1.
+    uint64_t GetFrameNumber() const;
+    // Index of the current frame context in [0, GetNumFramesInFlight()).
+    uint32_t GetFrameIndex() const;
+    const FrameContext& GetFrameContext() const;
+
+    // Time in seconds the CPU waited for the GPU in the last BeginFrame.
+    double GetLastWaitSeconds() const;
+
+private:
+    std::shared_ptr<CommandQueue> m_CommandQueue;
+    std::vector<FrameContext> m_FrameContexts;
+
+    uint64_t m_FrameNumber;
+    bool m_InFrame;
+    double m_LastWaitSeconds;
+};
@@ -0,0 +1,81 @@
+/**
+ * Pipelined frames.
+ *
+ * The simulation of a frame and building it into commands run on different
+ * threads: while the render thread records frame N, the simulation thread
+ * already updates frame N+1. The state a frame is rendered from is handed
+ * across in double-buffered snapshots owned by the caller. The simulation
+ * writes the snapshot at GetWriteIndex and submits it, the render thread
+ * renders from it while the simulation writes the other one.
+ *
+ * Submit waits for the render thread to finish the previous frame, so the
+ * simulation is at most one frame ahead and never writes a snapshot that is
+ * being rendered. State the render thread reads outside of the snapshots
+ * must only change while it is idle, see WaitForIdle.
+ *
+ * Exceptions thrown on the render thread are rethrown on the simulation
+ * thread by the next Submit or WaitForIdle.
+ *
+ * Plain C++ threads. Submit and WaitForIdle are called by the simulation
+ * thread only.
+ */
+#pragma once
+
+#include <condition_variable>   // For std::condition_variable
+#include <cstdint>              // For uint32_t and uint64_t
+#include <exception>            // For std::exception_ptr
+#include <functional>           // For std::function
+#include <mutex>                // For std::mutex
+#include <string>               // For std::string
+#include <thread>               // For std::thread
+
+class FramePipeline {
+public:
+    // Renders the frame of a snapshot. Called on the render thread.
+    using RenderFunction = std::function<void(uint32_t snapshotIndex)>;
+
+    // One snapshot is rendered while the other one is written.
+    static const uint32_t NumSnapshots = 2;
+
+    FramePipeline(RenderFunction render, const std::string& threadName = "Render");
+    // Finishes the submitted frame and stops the render thread.
+    virtual ~FramePipeline();
+
+    // The snapshot the simulation writes the next frame into. The render thread does not read it.
+    uint32_t GetWriteIndex() const;
+
+    // Render the frame written to the snapshot at GetWriteIndex on the render thread. Waits until the
+    // previous frame has been rendered, the next frame is written to the other snapshot.
+    void Submit();
+
+    // Wait until the render thread has finished the submitted frames.
+    void WaitForIdle();
+
+    // Frames the render thread has finished.
+    uint64_t GetNumFramesRendered() const;
+
+private:
+    FramePipeline(const FramePipeline& copy) = delete;
+    FramePipeline& operator=(const FramePipeline& other) = delete;
+
+    void RenderThread(const std::string& threadName);
+    // Rethrow an exception of the render thread. Called with the mutex locked.
+    void RethrowRenderException();
+
+    RenderFunction m_Render;
+
+    // Only used by the simulation thread.
+    uint32_t m_WriteIndex;
+
+    // The snapshot the render thread renders, valid while m_Busy is set.
+    uint32_t m_RenderIndex;
+    bool m_Busy;
+    bool m_Stop;
+    uint64_t m_NumFramesRendered;
+    std::exception_ptr m_RenderException;
+    mutable std::mutex m_Mutex;
+    // Signaled when a frame is submitted, finished or the thread is stopped.
+    std::condition_variable m_Condition;
+
+    std::thread m_Thread;
+};
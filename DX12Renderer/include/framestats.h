@@ -0,0 +1,100 @@
+/**
+ * Frame time statistics over a rolling window of frames.
+ *
+ * Frame times are counted in a histogram with fixed width buckets. The
+ * counts of frames that leave the window are subtracted again, so percentiles
+ * of the window are available at any time without sorting, only the rare
+ * frames beyond the histogram are selected from the window. Alongside the
+ * frame time, the time the CPU waited for the GPU and the interval between
+ * presents are tracked to tell GPU bound frames and uneven pacing apart.
+ *
+ * Every frame can be streamed to a CSV file for offline analysis.
+ *
+ * Not thread safe, frames are added by the thread driving the window.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t and uint64_t
+#include <fstream>  // For std::ofstream
+#include <ostream>  // For std::ostream
+#include <string>   // For std::string
+#include <vector>   // For std::vector
+
+class FrameStats {
+public:
+    // Number of frames the statistics are computed over if not specified otherwise.
+    static const size_t DefaultWindowSize = 1024;
+    // Width of a histogram bucket in milliseconds.
+    static constexpr double BucketWidthMs = 0.1;
+    // Frame times above NumBuckets * BucketWidthMs fall into the last bucket.
+    static const size_t NumBuckets = 2500;
+
+    // All times in milliseconds.
+    struct FrameRecord {
+        uint64_t frameNumber;
+        double frameTimeMs;         // Time since the previous frame.
+        double cpuWaitMs;           // Time the CPU was blocked waiting for the GPU or the swapchain.
+        double presentIntervalMs;   // Time since the previous present.
+    };
+
+    // Statistics of the frames in the window. All times in milliseconds.
+    struct Summary {
+        size_t numFrames;
+        double meanFrameTimeMs;
+        double p50FrameTimeMs;
+        double p95FrameTimeMs;
+        double p99FrameTimeMs;
+        double maxFrameTimeMs;
+        double meanCpuWaitMs;
+        double maxCpuWaitMs;
+        double meanPresentIntervalMs;
+        // Standard deviation of the present interval.
+        double presentJitterMs;
+    };
+
+    explicit FrameStats(size_t windowSize = DefaultWindowSize);
+    virtual ~FrameStats();
+
+    void AddFrame(const FrameRecord& frame);
+
+    // Drop all frames from the window.
+    void Reset();
+
+    size_t GetWindowSize() const;
+    size_t GetNumFrames() const;
+
+    /**
+     * Frame time percentile of the frames in the window, e.g. 0.99 for p99.
+     * The result is the upper edge of the histogram bucket the percentile falls
+     * into, except for the last bucket which reports the frame time at the
+     * percentile exactly.
+     */
+    double GetFrameTimePercentileMs(double percentile) const;
+
+    Summary GetSummary() const;
+    // Write the summary as a single line.
+    void WriteSummary(std::ostream& stream) const;
+
+    /**
+     * Stream every frame added from now on to a CSV file.
+     * Returns false if the file can't be opened.
+     */
+    bool BeginCsvCapture(const std::string& fileName);
+    void EndCsvCapture();
+    bool IsCsvCaptureActive() const;
+
+private:
+    static size_t GetBucket(double frameTimeMs);
+    // The frame time of the index-th shortest frame in the last bucket.
+    double GetOverflowFrameTimeMs(size_t index) const;
+
+    // The frames in the window, used as a ring buffer.
+    std::vector<FrameRecord> m_Frames;
+    size_t m_NumFrames;
+    size_t m_NextFrame;
+
+    std::vector<uint32_t> m_FrameTimeHistogram;
+
+    std::ofstream m_CsvFile;
+};
@@ -1,15 +1,23 @@
 #pragma once
 
+#include "framepipeline.h"
 #include "gamebase.h"
+#include "gpumemoryallocator.h"
+#include "meshfile.h"
+#include "rendergraph.h"
 #include "window.h"
 
 #include <DirectXMath.h>
 
+class AssetRequest;
+class ParallelCommandRecorder;
+
 class Game : public GameBase {
 public:
     using super = GameBase;
 
-    Game(const std::wstring& name, int width, int height, bool vSync = false);
+    Game(const std::wstring& name, int width, int height, bool vSync = false,
+        uint32_t framesInFlight = FramePacer::DefaultFramesInFlight);
     /**
      *  Load content required for the demo.
      */
@@ -46,11 +54,6 @@ protected:
 
 private:
     // Helper functions
-    // Transition a resource
-    void TransitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
-        Microsoft::WRL::ComPtr<ID3D12Resource> resource,
-        D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState);
-
     // Clear a render target view.
     void ClearRTV(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
         D3D12_CPU_DESCRIPTOR_HANDLE rtv, FLOAT* clearColor);
@@ -59,34 +62,103 @@ private:
     void ClearDepth(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
         D3D12_CPU_DESCRIPTOR_HANDLE dsv, FLOAT depth = 1.0f);
 
-    // Create a GPU buffer.
-    void UpdateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
-        ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource,
-        size_t numElements, size_t elementSize, const void* bufferData,
-        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+    // Create the views and pipelines once the requests of LoadContent are ready.
+    // Returns false while they are still loading.
+    bool FinishLoadContent();
+
+    // Point the depth-stencil view at the depth buffer of the frame.
+    void UpdateDepthStencilView(RHIResource* depthBuffer);
+
+    // Select the level of detail of each submesh from its projected error with the current camera.
+    void SelectLods();
+
+    // Requests made by LoadContent, released once the content has been created.
+    std::shared_ptr<AssetRequest> m_MeshRequest;
+    std::shared_ptr<AssetRequest> m_VertexShaderRequest;
+    std::shared_ptr<AssetRequest> m_BindlessVertexShaderRequest;
+    std::shared_ptr<AssetRequest> m_PixelShaderRequest;
+    // Only made if mesh shaders are supported.
+    std::shared_ptr<AssetRequest> m_AmplificationShaderRequest;
+    std::shared_ptr<AssetRequest> m_MeshShaderRequest;
+
+    // The data section of the cube mesh file, the vertex and index buffers are ranges of it.
+    GpuAllocation m_MeshBuffer;
+    // One vertex buffer per stream of the mesh, bound to the slot of the stream.
+    D3D12_VERTEX_BUFFER_VIEW m_VertexBufferViews[MeshFileMaxStreams];
+    uint32_t m_NumVertexBuffers;
+    D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+    std::vector<MeshFileSubmesh> m_Submeshes;
+    // The coarser levels of detail of the submeshes, see MeshFileSubmesh::FirstLod.
+    std::vector<MeshFileLod> m_Lods;
+    // The level drawn for each submesh, 0 is the submesh itself. Kept between frames for the hysteresis.
+    std::vector<uint32_t> m_SelectedLods;
+    bool m_LodSelection;
+    // Turns positions relative to the bounds of the mesh into object space, identity for float positions.
+    DirectX::XMMATRIX m_PositionDequantization;
 
-    // Resize the depth buffer to match the size of the client area.
-    void ResizeDepthBuffer(int width, int height);
+    // Descriptor heap for depth buffer. The depth buffer is a transient resource of the render graph.
+    DescriptorAllocation m_DSV;
 
-    uint64_t m_FenceValues[Window::BufferCount] = {};
+    // Rebuilt every frame, keeps the memory of transient resources between frames.
+    std::shared_ptr<RenderGraph> m_RenderGraph;
 
-    // Vertex buffer for the cube.
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_VertexBuffer;
-    D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
-    // Index buffer for the cube.
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_IndexBuffer;
-    D3D12_INDEX_BUFFER_VIEW m_IndexBufferView;
+    // Draws a command list of the cube pass gets at least, fewer are not worth a command list of their own.
+    static const uint32_t MinDrawsPerCommandList = 64;
 
-    // Depth buffer.
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthBuffer;
-    // Descriptor heap for depth buffer.
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_DSVHeap;
+    // Records the frame, the draws of the cube pass are recorded on the job system.
+    std::shared_ptr<ParallelCommandRecorder> m_CommandRecorder;
+    bool m_ParallelRecording;
 
     // Root signature
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_RootSignature;
+    // The root signature for the RHI, every command list of the cube pass starts with it.
+    std::shared_ptr<RHIRootSignature> m_RHIRootSignature;
 
     // Pipeline state object.
     Microsoft::WRL::ComPtr<ID3D12PipelineState> m_PipelineState;
+    // Pipeline state that fetches the vertices through the bindless table.
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_BindlessPipelineState;
+
+    // Flags of the vertex layout, match vertexdecode.hlsli.
+    enum VertexFlags : uint32_t {
+        VertexFlag_PackedPosition   = 0x1,
+        VertexFlag_PackedColor      = 0x2
+    };
+
+    // Root constants of the bindless pipeline that follow the MVP matrix, see vs_bindless.hlsl.
+    struct VertexFetchConstants {
+        // Index of the vertex buffer in the bindless descriptor table.
+        uint32_t VertexBufferIndex;
+        uint32_t VertexStride;
+        uint32_t ColorOffset;
+        uint32_t VertexFlags;
+    };
+
+    VertexFetchConstants m_VertexFetchConstants;
+    bool m_BindlessMode;
+
+    // Meshlets culled by one amplification shader group, matches MESHLET_GROUP_SIZE.
+    static const uint32_t MeshletGroupSize = 32;
+
+    // Constant buffer of the meshlet pipeline, see meshletcommon.hlsli.
+    struct MeshletConstants {
+        DirectX::XMFLOAT4 FrustumPlanes[6];
+        DirectX::XMFLOAT3 CameraPosition;
+        uint32_t MeshBufferIndex;
+        uint32_t VertexOffset;
+        uint32_t MeshletOffset;
+        uint32_t MeshletVertexOffset;
+        uint32_t MeshletTriangleOffset;
+        uint32_t FirstMeshlet;
+        uint32_t NumMeshlets;
+    };
+
+    // Pipeline state that culls meshlets in an amplification shader and draws them with a mesh shader.
+    // Null if mesh shaders are not supported or the mesh has no meshlets.
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_MeshletPipelineState;
+    // The buffer and offsets of the mesh, the rest is filled per draw.
+    MeshletConstants m_MeshletConstants;
+    bool m_MeshletMode;
 
     D3D12_VIEWPORT m_Viewport;
     D3D12_RECT m_ScissorRect;
@@ -97,5 +169,24 @@ private:
     DirectX::XMMATRIX m_ViewMatrix;
     DirectX::XMMATRIX m_ProjectionMatrix;
 
+    // The state of a frame OnRender reads that the update changes, written at the end of OnUpdate. With pipelined
+    // frames the render thread reads one snapshot while the next frame is written to the other.
+    struct FrameSnapshot {
+        DirectX::XMMATRIX ModelMatrix;
+        DirectX::XMMATRIX ViewMatrix;
+        DirectX::XMMATRIX ProjectionMatrix;
+        D3D12_VIEWPORT Viewport;
+        std::vector<uint32_t> SelectedLods;
+        bool ContentLoaded;
+        bool BindlessMode;
+        bool MeshletMode;
+        bool ParallelRecording;
+    };
+
+    FrameSnapshot m_Snapshots[FramePipeline::NumSnapshots];
+
+    // Seconds since the frame statistics were last reported.
+    double m_StatsReportTime;
+
     bool m_ContentLoaded;
 };
@@ -5,6 +5,7 @@
 
 #include "events.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -15,7 +16,7 @@ public:
     /**
      * Create the DirectX demo using the specified window dimensions.
      */
-    GameBase(const std::wstring& name, int width, int height, bool vSync);
+    GameBase(const std::wstring& name, int width, int height, bool vSync, uint32_t framesInFlight);
     virtual ~GameBase();
 
     int GetClientWidth() const {
@@ -50,12 +51,13 @@ protected:
     friend class Window;
 
     /**
-     *  Update the game logic.
+     *  Update the game logic. Writes the state the render reads to the snapshot of the event.
      */
     virtual void OnUpdate(UpdateEventArgs& e);
 
     /**
-     *  Render stuff.
+     *  Render stuff from the snapshot of the event. On the render thread of the window if
+     *  frames are pipelined, the next frame is updated meanwhile, see Window::SetPipelined.
      */
     virtual void OnRender(RenderEventArgs& e);
 
@@ -107,5 +109,6 @@ private:
     int m_Width;
     int m_Height;
     bool m_vSync;
+    uint32_t m_FramesInFlight;
 
 };
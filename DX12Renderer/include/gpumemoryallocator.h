@@ -0,0 +1,182 @@
+/**
+ * Allocator for GPU memory.
+ *
+ * A committed resource gets an implicit heap of its own, aligned to 64KB.
+ * Instead the allocator reserves large heaps (blocks) per heap type and kind
+ * of resource and places resources in them. The ranges of a block are
+ * managed by a TlsfAllocator, so the bookkeeping is CPU only and allocation
+ * patterns can be benchmarked with the null backend.
+ *
+ * Buffers smaller than the 64KB placement alignment are packed together into
+ * larger placed buffers, a vertex buffer of a few hundred bytes does not take
+ * up 64KB. Packed buffers share their resource, and with it the resource
+ * state, with other allocations. All buffers therefore start in the common
+ * state in default heaps and rely on implicit state promotion and decay;
+ * upload and readback buffers start in their required states.
+ *
+ * Placed render target and depth-stencil textures may reuse memory of other
+ * resources and must be cleared before their first use.
+ *
+ * Freed memory is handed to the DeferredReleaseQueue and only reused once the
+ * GPU has finished all work that was submitted before it was freed. Trim
+ * releases heaps and packed buffer pages that have become entirely free.
+ *
+ * All methods are thread safe.
+ */
+#pragma once
+
+#include "rhi.h"            // For RHIDevice, RHIHeap and RHIResource
+#include "tlsfallocator.h"  // For TlsfAllocator
+
+#include <cstdint>          // For uint32_t and uint64_t
+#include <memory>           // For std::shared_ptr and std::weak_ptr
+#include <mutex>            // For std::mutex
+#include <vector>           // For std::vector
+
+class DeferredReleaseQueue;
+class GpuMemoryBlock;
+
+// A buffer or texture. The memory is freed when the allocation is destroyed.
+class GpuAllocation {
+public:
+    // Creates a null allocation.
+    GpuAllocation();
+    GpuAllocation(std::shared_ptr<GpuMemoryBlock> block, uint64_t blockOffset,
+        std::shared_ptr<RHIResource> resource, uint64_t offset, uint64_t size);
+    ~GpuAllocation();
+
+    GpuAllocation(GpuAllocation&& allocation);
+    GpuAllocation& operator=(GpuAllocation&& other);
+
+    bool IsNull() const;
+
+    // The resource, shared with other allocations for packed buffers.
+    RHIResource* GetResource() const;
+    // Offset of the allocation in the resource, only packed buffers have a non zero offset.
+    uint64_t GetOffset() const;
+    uint64_t GetSize() const;
+    // Address of the allocation, including the offset.
+    uint64_t GetGPUVirtualAddress() const;
+
+    // Free the memory once the GPU has finished the work submitted so far. The allocation is null afterwards.
+    void Free();
+
+private:
+    // Packed buffers share the resource of the buffer of their block.
+    friend class GpuMemoryBlock;
+
+    GpuAllocation(const GpuAllocation& copy) = delete;
+    GpuAllocation& operator=(const GpuAllocation& other) = delete;
+
+    std::shared_ptr<GpuMemoryBlock> m_Block;
+    uint64_t m_BlockOffset;
+    std::shared_ptr<RHIResource> m_Resource;
+    uint64_t m_Offset;
+    uint64_t m_Size;
+};
+
+// A heap resources are placed in, or a buffer smaller buffers are packed into.
+class GpuMemoryBlock : public std::enable_shared_from_this<GpuMemoryBlock> {
+public:
+    // Create a heap for placed resources.
+    GpuMemoryBlock(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        const RHIHeapDesc& desc);
+    // Pack buffers into a buffer, at offsets aligned to the granularity.
+    GpuMemoryBlock(std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, GpuAllocation buffer, uint64_t granularity);
+
+    bool IsPackedBuffer() const;
+    // Nothing is allocated and all freed ranges have been returned.
+    bool IsEmpty() const;
+    TlsfAllocator::Stats GetStats() const;
+
+    // Place a resource in the heap. Returns a null allocation if the heap has no free block large enough.
+    GpuAllocation AllocatePlaced(const RHIResourceDesc& desc, const RHIResourceAllocationInfo& allocationInfo,
+        RHIResourceState initialState);
+    // Take a range of the buffer. Returns a null allocation if the buffer has no free block large enough.
+    GpuAllocation AllocatePacked(uint64_t size);
+
+    // Return a range once the GPU has finished the work submitted so far. Placed resources are released with it.
+    void Free(uint64_t blockOffset, std::shared_ptr<RHIResource> placedResource);
+
+private:
+    std::shared_ptr<RHIDevice> m_Device;
+    std::shared_ptr<RHIHeap> m_Heap;
+    GpuAllocation m_Buffer;
+    // Not owned, pending releases keep the block alive.
+    std::weak_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+
+    TlsfAllocator m_Allocator;
+
+    mutable std::mutex m_Mutex;
+};
+
+class GpuMemoryAllocator {
+public:
+    // Size of the heaps if not specified otherwise.
+    static const uint64_t DefaultBlockSize = 64 * 1024 * 1024;
+    // Buffers smaller than the placement alignment of 64KB are packed.
+    static const uint64_t MaxPackedBufferSize = 64 * 1024 - 1;
+    static const uint64_t PackedBufferPageSize = 4 * 1024 * 1024;
+    // Offsets of packed buffers are valid constant buffer locations.
+    static const uint64_t PackedBufferAlignment = 256;
+
+    struct Stats {
+        uint32_t numHeaps;
+        uint64_t heapBytes;
+        uint64_t heapUsedBytes;
+        // Placed resources, including the buffers packed buffers are taken from.
+        uint32_t numPlacedResources;
+        uint32_t numPackedBufferPages;
+        uint64_t packedBufferBytes;
+        uint64_t packedBufferUsedBytes;
+        uint32_t numPackedBuffers;
+        // Largest range that can be placed without creating a new heap.
+        uint64_t largestFreeBlock;
+    };
+
+    /**
+     * If deferredReleaseQueue is null, freed memory is reused immediately.
+     * Resources larger than the block size get a heap of their own which is released with them.
+     */
+    GpuMemoryAllocator(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+        uint64_t blockSize = DefaultBlockSize);
+    virtual ~GpuMemoryAllocator();
+
+    /**
+     * Create a buffer. Small buffers are packed with other buffers, mind the offset of the allocation.
+     * Buffers in default heaps start in the common state, upload buffers in the generic read
+     * state and readback buffers in the copy destination state.
+     */
+    GpuAllocation CreateBuffer(RHIHeapType heapType, uint64_t size, uint32_t flags = RHIResourceFlag_None);
+    // Create a texture in the default heap.
+    GpuAllocation CreateTexture(const RHIResourceDesc& desc, RHIResourceState initialState);
+
+    /**
+     * Release the heaps and packed buffer pages that are entirely free. One empty heap
+     * or page is kept per kind so allocations at its edge do not create one every frame.
+     * Call after the deferred release queue has released what the GPU is done with.
+     * The heaps of released pages become free once the GPU is done with the pages.
+     */
+    void Trim();
+
+    // Walks all blocks, meant for reports and benchmarks.
+    Stats GetStats() const;
+
+private:
+    static const size_t NumHeapTypes = 3;
+    static const size_t NumHeapResourceTypes = 3;
+
+    // Place a resource in a heap of the pool, creating a heap if none has enough space. The mutex must be held.
+    GpuAllocation AllocatePlaced(RHIHeapType heapType, RHIHeapResourceType resourceType,
+        const RHIResourceDesc& desc, RHIResourceState initialState);
+
+    std::shared_ptr<RHIDevice> m_Device;
+    std::shared_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+    uint64_t m_BlockSize;
+
+    std::vector< std::shared_ptr<GpuMemoryBlock> > m_Heaps[NumHeapTypes][NumHeapResourceTypes];
+    // Without and with unordered access, the flags of packed buffers are those of their page.
+    std::vector< std::shared_ptr<GpuMemoryBlock> > m_PackedBufferPages[NumHeapTypes][2];
+
+    mutable std::mutex m_Mutex;
+};
@@ -0,0 +1,164 @@
+/**
+ * GPU timestamp profiler for a command queue.
+ *
+ * Named regions are bracketed with timestamp queries in command lists of the
+ * queue. At the end of a frame the queries are resolved into a readback buffer
+ * by a small command list of its own. The results are read back once the GPU
+ * has finished the frame, a few frames later, so the CPU never waits for them.
+ * If the results of a frame slot are still pending when it comes around again,
+ * the new frame is not profiled instead of stalling.
+ *
+ * GPU timestamps are converted to the CPU clock with the queue's clock
+ * calibration and recorded on a Profiler track, so GPU regions line up with
+ * the CPU zones in the Chrome trace. Per region statistics are kept as well.
+ *
+ * Regions can be recorded from any thread. BeginFrame, EndFrame and the
+ * statistics must be used from the thread driving the frame.
+ */
+#pragma once
+
+#include "commandqueue.h"   // For CommandQueue
+#include "framepacer.h"     // For FramePacer::MaxFramesInFlight
+#include "rhi.h"            // For RHIDevice, RHIQueryHeap, RHIResource and RHICommandList
+
+#include <atomic>           // For std::atomic
+#include <cstdint>          // For uint32_t, uint64_t
+#include <map>              // For std::map
+#include <memory>           // For std::shared_ptr, std::unique_ptr
+#include <ostream>          // For std::ostream
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+
+class GpuProfiler {
+public:
+    // The maximum number of regions recorded per frame. Further regions are ignored.
+    static const uint32_t MaxRegionsPerFrame = 256;
+    // Number of frames whose results can be pending at a time. One more than
+    // the frame pacer allows in flight, so a slot is usually complete when reused.
+    static const uint32_t NumFrames = FramePacer::MaxFramesInFlight + 1;
+    // Returned by BeginRegion when the region is not recorded.
+    static const uint32_t InvalidRegion = ~0u;
+
+    // A region of the most recently read back frame. Timestamps are Profiler timestamps.
+    struct Region {
+        const char* name;
+        uint64_t beginTimestamp;
+        uint64_t endTimestamp;
+        uint32_t depth;
+    };
+
+    // Durations in milliseconds.
+    struct RegionStats {
+        uint64_t count;
+        double totalMs;
+        double minMs;
+        double maxMs;
+        double lastMs;
+    };
+
+    /**
+     * Create a profiler for the command queue. trackName names the GPU track in the trace.
+     * Profiling is disabled if the device does not support timestamps on the queue's type.
+     */
+    GpuProfiler(std::shared_ptr<RHIDevice> device, std::shared_ptr<CommandQueue> commandQueue,
+        const std::string& trackName);
+    virtual ~GpuProfiler();
+
+    bool IsSupported() const;
+
+    /**
+     * Read back the results of completed frames and start recording a new frame.
+     * Never waits for the GPU.
+     */
+    void BeginFrame();
+    /**
+     * Resolve the queries of the frame. Call after all command lists with regions
+     * of the frame have been executed.
+     */
+    void EndFrame();
+
+    /**
+     * Write a timestamp for the start of a region to the command list.
+     * name must stay valid for the lifetime of the profiler (usually a string literal).
+     * Returns the region to pass to EndRegion.
+     */
+    uint32_t BeginRegion(RHICommandList* commandList, const char* name);
+    void EndRegion(RHICommandList* commandList, uint32_t region);
+
+    // Regions of the most recently read back frame, sorted by begin timestamp.
+    const std::vector<Region>& GetLastFrameRegions() const;
+    // Statistics per region name since the last reset.
+    const std::map<std::string, RegionStats>& GetRegionStats() const;
+    void ResetStats();
+
+    // Number of frames that were not profiled because their slot was still pending.
+    uint64_t GetNumDroppedFrames() const;
+
+    // Write the region statistics as a table.
+    void WriteReport(std::ostream& stream) const;
+
+private:
+    GpuProfiler(const GpuProfiler& copy) = delete;
+    GpuProfiler& operator=(const GpuProfiler& other) = delete;
+
+    struct RegionQueries {
+        std::atomic<const char*> name;
+        std::atomic_bool ended;
+    };
+
+    struct Frame {
+        // Fence value of the resolve, 0 if no results are pending.
+        uint64_t fenceValue;
+        uint32_t numRegions;
+        // Clock calibration sampled when the frame was resolved.
+        uint64_t gpuCalibrationTimestamp;
+        uint64_t cpuCalibrationTimestamp;
+        std::unique_ptr<RegionQueries[]> regions;
+    };
+
+    // Read back the results of the frame slot and mark it free.
+    void ReadBack(uint32_t frameIndex);
+    // Convert a GPU timestamp to a Profiler timestamp.
+    uint64_t ToProfilerTimestamp(const Frame& frame, uint64_t gpuTimestamp) const;
+
+    std::shared_ptr<CommandQueue> m_CommandQueue;
+    std::shared_ptr<RHIQueryHeap> m_QueryHeap;
+    std::shared_ptr<RHIResource> m_ReadbackBuffer;
+    const uint64_t* m_ReadbackData;
+
+    uint64_t m_TimestampFrequency;
+    uint32_t m_ProfilerTrack;
+
+    Frame m_Frames[NumFrames];
+    uint32_t m_FrameIndex;
+    uint64_t m_NumDroppedFrames;
+
+    // Set while regions of the current frame can be recorded.
+    std::atomic_bool m_Recording;
+    std::atomic_uint32_t m_NumRegions;
+
+    std::vector<Region> m_LastFrameRegions;
+    std::map<std::string, RegionStats> m_RegionStats;
+};
+
+// Records a GPU region on a command list from construction to destruction.
+class GpuProfileScope {
+public:
+    GpuProfileScope(GpuProfiler& profiler, RHICommandList* commandList, const char* name)
+        : m_Profiler(profiler)
+        , m_CommandList(commandList)
+        , m_Region(profiler.BeginRegion(commandList, name)) {
+    }
+
+    ~GpuProfileScope() {
+        m_Profiler.EndRegion(m_CommandList, m_Region);
+    }
+
+private:
+    GpuProfileScope(const GpuProfileScope& copy) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope& other) = delete;
+
+    GpuProfiler& m_Profiler;
+    RHICommandList* m_CommandList;
+    uint32_t m_Region;
+};
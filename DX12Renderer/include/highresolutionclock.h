@@ -19,6 +19,9 @@ public:
     // Reset the clock.
     void Reset();
 
+    // The current time point of the clock. Safe to call from any thread.
+    static std::chrono::high_resolution_clock::time_point Now();
+
     double GetDeltaNanoseconds() const;
     double GetDeltaMicroseconds() const;
     double GetDeltaMilliseconds() const;
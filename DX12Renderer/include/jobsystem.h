@@ -0,0 +1,158 @@
+/**
+ * Work-stealing job system.
+ *
+ * The thread that creates the job system and a number of worker threads run
+ * jobs. Every one of them has a Chase-Lev deque, see Lê et al. "Correct and
+ * Efficient Work-Stealing for Weak Memory Models". Jobs a thread runs are
+ * pushed to the bottom of its own deque and popped from there, newest first,
+ * which keeps their data in its caches. Threads out of work steal the oldest
+ * jobs from the top of a random other deque, which are usually the biggest
+ * pieces of work left. Jobs run by other threads go to a shared queue.
+ *
+ * A JobCounter counts the unfinished jobs it was passed to. Jobs can depend
+ * on a counter and are only started once it has reached zero, and threads
+ * can wait for a counter. Waiting threads run jobs meanwhile, so jobs may
+ * wait for other jobs without blocking a worker. ParallelFor splits a range
+ * into halves that can be stolen until they reach the batch size.
+ *
+ * Idle workers spin briefly and then sleep until a job is run. Workers can
+ * be pinned to logical processors and given a lower or higher priority.
+ *
+ * Plain C++ threads, only affinity and priority are platform specific. All
+ * methods are thread safe.
+ */
+#pragma once
+
+#include <atomic>               // For std::atomic
+#include <condition_variable>   // For std::condition_variable
+#include <cstdint>              // For uint32_t and uint64_t
+#include <deque>                // For std::deque
+#include <functional>           // For std::function
+#include <memory>               // For std::unique_ptr
+#include <mutex>                // For std::mutex
+#include <vector>               // For std::vector
+
+class JobCounter;
+
+class JobSystem {
+public:
+    using JobFunction = std::function<void()>;
+    // Called with the iterations [begin, end).
+    using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+    static const uint32_t InvalidThreadIndex = ~0u;
+    // One worker per hardware thread besides the creating thread.
+    static const uint32_t AutoNumWorkers = ~0u;
+
+    enum class ThreadPriority {
+        Low,
+        Normal,
+        High
+    };
+
+    struct Settings {
+        // Worker threads next to the creating thread, with 0 all jobs run on the creating thread.
+        uint32_t numWorkers = AutoNumWorkers;
+        // Pin worker i to logical processor i, the first one is left to the creating thread, which is not pinned.
+        bool pinThreads = false;
+        // Priority of the worker threads, raising it may need privileges the process does not have.
+        ThreadPriority workerPriority = ThreadPriority::Normal;
+        // Initial number of jobs a deque holds, deques grow when they are full.
+        uint32_t dequeCapacity = 1024;
+    };
+
+    // Jobs run by threads that are not part of the job system while they wait count too. A job
+    // is counted before its counter is decremented, so the counts include every job waited for.
+    struct Stats {
+        uint64_t numJobs;
+        // Jobs taken from the deque of another thread.
+        uint64_t numSteals;
+    };
+
+    JobSystem();
+    explicit JobSystem(const Settings& settings);
+    // Runs all jobs that are left.
+    virtual ~JobSystem();
+
+    // Run a job. The counter is incremented now and decremented once the job has finished.
+    void Run(JobFunction function, JobCounter* counter = nullptr);
+    // Run a job once the dependency has reached zero.
+    void RunAfter(JobCounter& dependency, JobFunction function, JobCounter* counter = nullptr);
+    // Run the function over the iterations [0, count) in ranges of at most batchSize on all threads.
+    // Returns once all iterations are done.
+    void ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& function);
+
+    // Run jobs until the counter has reached zero.
+    void Wait(const JobCounter& counter);
+
+    // The worker threads and the creating thread.
+    uint32_t GetNumThreads() const;
+    // 0 for the creating thread, InvalidThreadIndex for threads that are not part of the job system.
+    uint32_t GetThreadIndex() const;
+
+    Stats GetStats() const;
+
+private:
+    friend class JobCounter;
+
+    struct Job;
+    struct Worker;
+
+    JobSystem(const JobSystem& copy) = delete;
+    JobSystem& operator=(const JobSystem& other) = delete;
+
+    void WorkerThread(uint32_t index);
+    // Push the job to the deque of the calling thread or to the shared queue and wake a worker.
+    void Schedule(Job* job);
+    // Take a job from the deque of the calling thread, the shared queue or another thread. Null if there is none.
+    Job* FindJob();
+    void Execute(Job* job);
+    void SplitRange(uint32_t begin, uint32_t end, uint32_t batchSize, const RangeFunction& function, JobCounter& counter);
+
+    Settings m_Settings;
+    std::vector< std::unique_ptr<Worker> > m_Workers;
+
+    // Jobs run by threads that are not part of the job system and jobs whose dependency has finished.
+    std::deque<Job*> m_Queue;
+    std::atomic<size_t> m_QueueSize;
+    std::mutex m_QueueMutex;
+
+    // Incremented whenever a job is scheduled, sleeping workers wake up when it changes.
+    std::atomic<uint64_t> m_Epoch;
+    std::atomic<uint32_t> m_NumSleeping;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_SleepCondition;
+
+    // Jobs that have been run but have not finished, including the ones waiting for a dependency.
+    std::atomic<uint64_t> m_NumPendingJobs;
+    // Jobs run and stolen by threads that are not part of the job system, the workers count their own.
+    std::atomic<uint64_t> m_NumForeignJobs;
+    std::atomic<uint64_t> m_NumForeignSteals;
+    std::atomic<bool> m_Stop;
+};
+
+// Counts unfinished jobs. Must not be destroyed before it has reached zero.
+class JobCounter {
+public:
+    JobCounter();
+    ~JobCounter();
+
+    bool IsDone() const;
+    uint32_t GetValue() const;
+
+private:
+    friend class JobSystem;
+
+    // The low bits count the jobs, the high bits the threads that brought the count to zero and are still
+    // starting the jobs that depend on it. The counter is only done once both are zero.
+    static const uint32_t CountMask = 0x00FFFFFF;
+    static const uint32_t Releaser = 0x01000000;
+
+    JobCounter(const JobCounter& copy) = delete;
+    JobCounter& operator=(const JobCounter& other) = delete;
+
+    std::atomic<uint32_t> m_Value;
+    // Jobs that are scheduled once the count reaches zero.
+    std::mutex m_Mutex;
+    std::vector<JobSystem::Job*> m_Dependents;
+};
@@ -0,0 +1,41 @@
+/**
+ * Level of detail selection by screen-space error.
+ *
+ * Every level of detail has a geometric error, the largest distance of its
+ * vertices from the planes of the full detail triangles they replace, in
+ * object space, see meshsimplifier.h. Projected to the screen at the distance of an object,
+ * the error is the number of pixels the level can be off by. SelectLod
+ * picks the coarsest level whose projected error stays below a threshold.
+ *
+ * An object near the distance where two levels switch would flicker
+ * between them as the camera moves. SelectLod keeps the current level
+ * inside a band around the threshold: a coarser level is only taken once
+ * its error is a fraction below the threshold and a finer one once the
+ * error of the current level is the same fraction above it.
+ *
+ * Plain CPU code.
+ */
+#pragma once
+
+#include <cstdint>  // For uint32_t
+
+struct LodSelectionSettings {
+    // Largest projected error of the selected level in pixels.
+    float pixelThreshold;
+    // Relative width of the band around the threshold where the current level is kept.
+    float hysteresis;
+};
+
+static const LodSelectionSettings DefaultLodSelectionSettings = { 1.0f, 0.25f };
+
+// Pixels covered by one unit at distance one, from the vertical field of view in radians and the viewport height.
+// The y scale of a perspective projection matrix is 1 / tan(fieldOfView / 2).
+float ComputeLodProjectionScale(float fieldOfView, float viewportHeight);
+
+// Size in pixels of an error at the distance from the camera.
+float ComputeScreenSpaceError(float error, float distance, float projectionScale);
+
+// Select a level from the errors of the levels, from fine to coarse, given the level selected last.
+// The first level is the full detail, its error is usually 0.
+uint32_t SelectLod(const float* lodErrors, uint32_t numLods, float distance, float projectionScale, uint32_t currentLod,
+    const LodSelectionSettings& settings = DefaultLodSelectionSettings);
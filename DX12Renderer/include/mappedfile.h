@@ -0,0 +1,34 @@
+/**
+ * Read only memory mapping of a file.
+ *
+ * The contents are paged in by the OS on first access instead of being read
+ * into a buffer up front, and pages that are not touched are never read.
+ * Windows and POSIX systems are supported.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint8_t
+#include <string>   // For std::string
+
+class MappedFile {
+public:
+    MappedFile();
+    // Unmaps the file.
+    ~MappedFile();
+
+    // Map the whole file. Returns false if it cannot be opened or is empty.
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const;
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+
+private:
+    MappedFile(const MappedFile& copy) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    const uint8_t* m_Data;
+    size_t m_Size;
+};
@@ -0,0 +1,248 @@
+/**
+ * Binary mesh file format.
+ *
+ * A mesh file is laid out so it can be used straight from a memory mapping:
+ *
+ *   MeshFileHeader
+ *   MeshFileSubmesh[NumSubmeshes]
+ *   MeshFileLod[NumLods]
+ *   data section, aligned to MeshFileDataAlignment
+ *     vertex streams and index data, each aligned to MeshFileDataAlignment
+ *     optionally meshlets, meshlet vertices and meshlet triangles, each
+ *     aligned to MeshFileDataAlignment
+ *
+ * The data section is the contents of a single GPU buffer. It is copied to
+ * upload memory as a whole and the streams and the indices are addressed by
+ * their offsets, nothing is parsed or converted at load time. All values are
+ * little-endian.
+ *
+ * The version is bumped whenever the layout changes. Files of other versions
+ * are rejected and have to be rebuilt from their source assets.
+ *
+ * Attributes can be stored packed, see vertexquantization.h. Positions in
+ * UNORM formats are relative to the bounds of the mesh and normals in two
+ * component formats are octahedral.
+ *
+ * Meshlets are built per submesh, see meshlet.h. They are in the data
+ * section too, so mesh and amplification shaders read them from the same
+ * buffer as the vertices.
+ *
+ * Submeshes can have a chain of coarser levels of detail, see
+ * meshsimplifier.h. A level is a range of the indices that refers to the
+ * vertices of its submesh, so all levels are drawn from the same buffers.
+ * The submesh itself is level 0. Meshlets are only built for level 0.
+ */
+#pragma once
+
+#include "mappedfile.h"     // For MappedFile
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint32_t and uint64_t
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+
+// "MESH"
+static const uint32_t MeshFileMagic = 0x4853454D;
+static const uint32_t MeshFileVersion = 3;
+static const uint32_t MeshFileMaxStreams = 4;
+static const uint32_t MeshFileMaxAttributes = 8;
+// Alignment of the data section in the file and of the streams and indices in it.
+static const uint64_t MeshFileDataAlignment = 256;
+
+// The values are stored in files, only append.
+enum class MeshSemantic : uint32_t {
+    Position,
+    Normal,
+    Color,
+    TexCoord
+};
+
+// The values are stored in files, only append.
+enum class MeshAttributeFormat : uint32_t {
+    R32G32B32_Float,
+    R32G32_Float,
+    R16G16B16A16_UNorm,
+    R16G16_SNorm,
+    R8G8B8A8_UNorm,
+    R16G16_Float
+};
+
+struct MeshFileAttribute {
+    MeshSemantic Semantic;
+    uint32_t SemanticIndex;
+    MeshAttributeFormat Format;
+    // Offset of the attribute in the vertex.
+    uint32_t Offset;
+};
+
+struct MeshFileStream {
+    uint32_t Stride;
+    uint32_t NumAttributes;
+    // Offset of the stream in the data section.
+    uint64_t Offset;
+    MeshFileAttribute Attributes[MeshFileMaxAttributes];
+};
+
+struct MeshFileBounds {
+    float Min[3];
+    float Max[3];
+};
+
+// A range of indices drawn with one draw call.
+struct MeshFileSubmesh {
+    uint32_t FirstIndex;
+    uint32_t NumIndices;
+    // The range of vertices the indices refer to.
+    uint32_t FirstVertex;
+    uint32_t NumVertices;
+    MeshFileBounds Bounds;
+    // The meshlets of the triangles, none if the mesh has no meshlets.
+    uint32_t FirstMeshlet;
+    uint32_t NumMeshlets;
+    // The coarser levels of detail, from fine to coarse.
+    uint32_t FirstLod;
+    uint32_t NumLods;
+};
+
+// A coarser level of detail of a submesh.
+struct MeshFileLod {
+    uint32_t FirstIndex;
+    uint32_t NumIndices;
+    // Largest distance of the simplified vertices from the planes of the triangles they replace, in the units of the positions.
+    float Error;
+    uint32_t Reserved;
+};
+
+// Same as Meshlet and MeshletBounds, read by shaders.
+struct MeshFileMeshlet {
+    // Offsets in the meshlet vertices and triangles of the mesh.
+    uint32_t VertexOffset;
+    uint32_t TriangleOffset;
+    uint32_t NumVertices;
+    uint32_t NumTriangles;
+    float Center[3];
+    float Radius;
+    float ConeAxis[3];
+    float ConeCutoff;
+};
+
+struct MeshFileHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t NumVertices;
+    uint32_t NumIndices;
+    // 2 or 4 bytes.
+    uint32_t IndexSize;
+    uint32_t NumStreams;
+    uint32_t NumSubmeshes;
+    uint32_t NumMeshlets;
+    // Bounds of all submeshes.
+    MeshFileBounds Bounds;
+    // Meshlet vertices are 32-bit vertex indices, meshlet triangles are three 8-bit indices in 32 bits.
+    uint32_t NumMeshletVertices;
+    uint32_t NumMeshletTriangles;
+    uint32_t NumLods;
+    uint32_t Reserved;
+    // Offset of the index data in the data section.
+    uint64_t IndexOffset;
+    // Offset and size of the data section in the file.
+    uint64_t DataOffset;
+    uint64_t DataSize;
+    // Offsets of the meshlet data in the data section.
+    uint64_t MeshletOffset;
+    uint64_t MeshletVertexOffset;
+    uint64_t MeshletTriangleOffset;
+    MeshFileStream Streams[MeshFileMaxStreams];
+};
+
+static_assert(sizeof(MeshFileAttribute) == 16, "The layout of mesh files must not depend on the compiler.");
+static_assert(sizeof(MeshFileStream) == 16 + 16 * MeshFileMaxAttributes, "The layout of mesh files must not depend on the compiler.");
+static_assert(sizeof(MeshFileSubmesh) == 56, "The layout of mesh files must not depend on the compiler.");
+static_assert(sizeof(MeshFileLod) == 16, "The layout of mesh files must not depend on the compiler.");
+static_assert(sizeof(MeshFileMeshlet) == 48, "The layout of mesh files must not depend on the compiler.");
+static_assert(sizeof(MeshFileHeader) == 120 + sizeof(MeshFileStream) * MeshFileMaxStreams,
+    "The layout of mesh files must not depend on the compiler.");
+
+// Size of an attribute in bytes, 0 for unknown formats.
+uint32_t GetMeshAttributeFormatSize(MeshAttributeFormat format);
+// Whether attributes of the semantic can be stored in the format.
+bool IsMeshAttributeFormatSupported(MeshSemantic semantic, MeshAttributeFormat format);
+
+// A validated mesh file, mapped or in memory.
+class MeshFile {
+public:
+    MeshFile();
+
+    // Map a mesh file. Returns false if it cannot be read or is not a valid mesh file of the current version.
+    bool Open(const std::string& path);
+    // Use a mesh file in memory, which must outlive the MeshFile.
+    bool Open(const void* data, size_t size);
+    void Close();
+
+    const MeshFileHeader& GetHeader() const;
+    const MeshFileSubmesh& GetSubmesh(uint32_t submesh) const;
+    const MeshFileLod& GetLod(uint32_t lod) const;
+
+    // The data section, copied to the GPU buffer as is.
+    const uint8_t* GetData() const;
+    uint64_t GetDataSize() const;
+    const uint8_t* GetStreamData(uint32_t stream) const;
+    const uint8_t* GetIndexData() const;
+    const MeshFileMeshlet* GetMeshlets() const;
+    const uint32_t* GetMeshletVertices() const;
+    const uint32_t* GetMeshletTriangles() const;
+
+private:
+    MeshFile(const MeshFile& copy) = delete;
+    MeshFile& operator=(const MeshFile& other) = delete;
+
+    bool Validate() const;
+
+    MappedFile m_MappedFile;
+    const uint8_t* m_Base;
+    size_t m_Size;
+    const MeshFileHeader* m_Header;
+    const MeshFileSubmesh* m_Submeshes;
+    const MeshFileLod* m_Lods;
+};
+
+// Writes mesh files, used by tools.
+class MeshFileBuilder {
+public:
+    MeshFileBuilder();
+
+    // Add a vertex stream. All streams must have the same number of vertices.
+    void AddStream(const MeshFileAttribute* attributes, uint32_t numAttributes, uint32_t stride,
+        const void* vertices, uint32_t numVertices);
+    // Indices are stored in 16 bits if all vertices can be addressed with them.
+    void SetIndices(const uint32_t* indices, uint32_t numIndices);
+    // The vertex range of the submesh is taken from its indices, SetIndices must have been called.
+    void AddSubmesh(uint32_t firstIndex, uint32_t numIndices, const MeshFileBounds& bounds);
+    // Add the meshlets of the last submesh. Their offsets are relative to the vertices and triangles passed along.
+    void AddMeshlets(const MeshFileMeshlet* meshlets, uint32_t numMeshlets, const uint32_t* vertices, uint32_t numVertices,
+        const uint32_t* triangles, uint32_t numTriangles);
+    // Add the next coarser level of detail of the last submesh, a range of the indices that refers to its vertices.
+    void AddLod(uint32_t firstIndex, uint32_t numIndices, float error);
+
+    // Bounds of the positions referenced by the indices. The positions are three floats at the start of each stride.
+    static MeshFileBounds ComputeBounds(const void* positions, size_t stride, const uint32_t* indices, uint32_t numIndices);
+
+    std::vector<uint8_t> Build() const;
+    // Returns false if the file cannot be written.
+    bool Write(const std::string& path) const;
+
+private:
+    struct Stream {
+        MeshFileStream desc;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<Stream> m_Streams;
+    uint32_t m_NumVertices;
+    std::vector<uint32_t> m_Indices;
+    std::vector<MeshFileSubmesh> m_Submeshes;
+    std::vector<MeshFileLod> m_Lods;
+    std::vector<MeshFileMeshlet> m_Meshlets;
+    std::vector<uint32_t> m_MeshletVertices;
+    std::vector<uint32_t> m_MeshletTriangles;
+};
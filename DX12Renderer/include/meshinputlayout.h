@@ -0,0 +1,22 @@
+/**
+ * Input layouts of mesh files.
+ *
+ * Every attribute of a mesh becomes an input element, the streams are the
+ * input slots and the semantics are POSITION, NORMAL, COLOR and TEXCOORD.
+ * Packed formats are decoded by the input assembler, vertex shaders declare
+ * the attributes as floats no matter how they are stored. The exceptions
+ * are positions relative to the bounds, see GetPositionDequantization, and
+ * octahedral normals, which arrive as a float2 to be decoded by the shader.
+ */
+#pragma once
+
+#include "meshfile.h"   // For MeshFileHeader and MeshAttributeFormat
+
+#include <d3d12.h>      // For D3D12_INPUT_ELEMENT_DESC and DXGI_FORMAT
+
+#include <vector>       // For std::vector
+
+DXGI_FORMAT ToDXGIFormat(MeshAttributeFormat format);
+
+// The semantic names are static strings, the elements stay valid on their own.
+std::vector<D3D12_INPUT_ELEMENT_DESC> CreateMeshInputLayout(const MeshFileHeader& header);
@@ -0,0 +1,60 @@
+/**
+ * Meshlet generation for mesh shader rendering.
+ *
+ * BuildMeshlets splits an indexed triangle list into meshlets of at most
+ * MaxMeshletVertices vertices and MaxMeshletTriangles triangles, the limits
+ * that keep the outputs of a mesh shader thread group small on all vendors.
+ * Triangles are taken in index order, so the indices should be optimized
+ * for the vertex cache first, which keeps neighbouring triangles together.
+ *
+ * ComputeMeshletBounds computes a bounding sphere for frustum culling and a
+ * normal cone for back-face culling of whole meshlets. A meshlet is back
+ * facing from a camera position if IsMeshletBackFacing, the amplification
+ * shader runs the same test, see shaders/meshletcommon.hlsli.
+ *
+ * Meshlet vertices are indices into the vertex buffer, triangles are three
+ * 8-bit indices into the vertices of their meshlet packed into 32 bits.
+ * Plain CPU code.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t
+#include <vector>   // For std::vector
+
+static const uint32_t MaxMeshletVertices = 64;
+static const uint32_t MaxMeshletTriangles = 124;
+
+struct Meshlet {
+    // Offset of the first vertex in the meshlet vertices.
+    uint32_t vertexOffset;
+    // Offset of the first triangle in the meshlet triangles.
+    uint32_t triangleOffset;
+    uint32_t numVertices;
+    uint32_t numTriangles;
+};
+
+struct MeshletBounds {
+    float center[3];
+    float radius;
+    // Average normal of the triangles.
+    float coneAxis[3];
+    // Sine of the angle between the axis and the normal furthest from it, 1 if the cone cannot be culled.
+    float coneCutoff;
+};
+
+// Append the meshlets of the triangles, degenerate triangles are dropped.
+// The limits may be lower than the defaults, the vertex limit at most 256.
+void BuildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint32_t>& meshletTriangles,
+    const uint32_t* indices, size_t numIndices, size_t numVertices,
+    uint32_t maxVertices = MaxMeshletVertices, uint32_t maxTriangles = MaxMeshletTriangles);
+
+// The positions are three floats at the start of each stride. Front faces are clockwise in a left-handed space.
+MeshletBounds ComputeMeshletBounds(const Meshlet& meshlet, const uint32_t* meshletVertices, const uint32_t* meshletTriangles,
+    const void* positions, size_t positionStride);
+
+// True if all triangles of the meshlet face away from the camera position, in the space of the bounds.
+bool IsMeshletBackFacing(const MeshletBounds& bounds, const float* cameraPosition);
+
+uint32_t PackMeshletTriangle(uint32_t i0, uint32_t i1, uint32_t i2);
+void UnpackMeshletTriangle(uint32_t triangle, uint32_t* indices);
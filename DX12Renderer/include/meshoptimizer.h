@@ -0,0 +1,65 @@
+/**
+ * Offline mesh optimizations for indexed triangle lists.
+ *
+ * Run in this order, each step keeps the gains of the previous ones:
+ *
+ * - OptimizeVertexCache reorders the triangles with Forsyth's algorithm so
+ *   vertices are reused while they are still in the post-transform cache.
+ * - OptimizeOverdraw splits the cache optimized order into clusters that
+ *   barely hurt cache efficiency and sorts them so outward facing clusters
+ *   are drawn first, following Sander et al. "Fast Triangle Reordering for
+ *   Vertex Locality and Reduced Overdraw".
+ * - OptimizeVertexFetch reorders the vertices in the order the indices
+ *   first use them, so vertex fetches read memory close to the previous
+ *   ones, and drops vertices that are not referenced.
+ *
+ * The analysis functions simulate the caches so tools can report the
+ * average cache miss ratio per triangle (ACMR), the average transformed
+ * vertices per vertex (ATVR) and the vertex fetch overhead.
+ *
+ * Indices are 32-bit, triangles are consecutive triples. Plain CPU code.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t
+
+static const uint32_t DefaultVertexCacheSize = 16;
+// A cluster may have this much higher ACMR than its hard cluster before it is split off.
+static const float DefaultOverdrawThreshold = 1.05f;
+
+struct VertexCacheStatistics {
+    uint32_t numTransformedVertices;
+    // Transformed vertices per triangle, 0.5 is the best case for large regular meshes and 3 the worst.
+    float acmr;
+    // Transformed vertices per referenced vertex, 1 is optimal.
+    float atvr;
+};
+
+struct VertexFetchStatistics {
+    uint64_t bytesFetched;
+    // Bytes fetched per byte of referenced vertices, 1 is optimal.
+    float overfetch;
+};
+
+// Reorder the triangles for the post-transform vertex cache. destination may be indices.
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t numIndices, size_t numVertices);
+
+// Reorder cache optimized triangles to draw outward facing parts first. destination must not be indices.
+// The positions are three floats at the start of each stride.
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t numIndices,
+    const void* positions, size_t positionStride, size_t numVertices, float threshold = DefaultOverdrawThreshold);
+
+// Create a remap table that orders the vertices by their first use and drops the unreferenced ones,
+// which are remapped to ~0u. Returns the number of vertices that remain.
+size_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t numIndices, size_t numVertices);
+// Apply a remap table to indices. destination may be indices.
+void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t numIndices, const uint32_t* remap);
+// Apply a remap table to vertices of vertexSize bytes. destination must not be vertices.
+void RemapVertexBuffer(void* destination, const void* vertices, size_t numVertices, size_t vertexSize, const uint32_t* remap);
+
+// Simulate a FIFO post-transform cache of the size.
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t numIndices, size_t numVertices,
+    uint32_t cacheSize = DefaultVertexCacheSize);
+// Simulate a small cache of 64 byte lines in front of the vertex buffer.
+VertexFetchStatistics AnalyzeVertexFetch(const uint32_t* indices, size_t numIndices, size_t numVertices, size_t vertexSize);
@@ -0,0 +1,38 @@
+/**
+ * Mesh simplification for level of detail chains.
+ *
+ * SimplifyMesh removes vertices by edge collapse, ordered by the quadric
+ * error metric of Garland and Heckbert, "Surface Simplification Using
+ * Quadric Error Metrics". A vertex collapses onto one of its neighbours, so
+ * the simplified indices refer to the vertices of the input and all levels
+ * of detail of a mesh share one vertex buffer.
+ *
+ * Vertices with the same position are welded for the topology. Vertices on
+ * attribute seams, positions shared by several vertices, are never removed
+ * so texture coordinates and normals do not tear. Border vertices only
+ * collapse along the border, which is also held in place by extra planes in
+ * the quadrics. Collapses that would flip a triangle are rejected.
+ *
+ * Collapses are done in passes over independent edges sorted by their
+ * quadric error, until the target index count or the error limit is
+ * reached. The quadrics average squared distances, so the error of a
+ * collapse is measured separately: the largest distance of the vertex that
+ * is kept from the planes of all input triangles around the vertices it
+ * stands in for. The error of the result is the largest of its collapses,
+ * in the units of the positions, so the levels can be selected by their
+ * projected size on screen, see lodselection.h.
+ *
+ * Indices are 32-bit, triangles are consecutive triples. Plain CPU code.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t
+
+// Simplify the triangles until at most targetNumIndices are left or no collapse stays within targetError.
+// Returns the number of indices written to destination, which must hold numIndices and may be indices.
+// The positions are three floats at the start of each stride. The error of the result, at most targetError,
+// is returned in resultError.
+size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t numIndices,
+    const void* positions, size_t positionStride, size_t numVertices,
+    size_t targetNumIndices, float targetError, float* resultError = nullptr);
@@ -0,0 +1,133 @@
+/**
+ * Parallel command list recording.
+ *
+ * A frame is recorded on a sequence of command lists that are executed in
+ * order with one submission. Serial work, like the barriers and clears of a
+ * render graph, goes to the current command list. RecordParallel splits the
+ * draws of a pass into chunks and records every chunk on the job system on a
+ * command list of its own, each with its own allocator from the
+ * CommandQueue. The chunks are placed after the current command list in
+ * chunk order and the frame continues on a new command list after them.
+ *
+ * D3D12 command lists inherit no state from the command lists before them.
+ * The viewport, scissor rectangle, render targets, root signature and
+ * descriptor heaps of a pass are passed as an InheritedState and set on
+ * every chunk before it is recorded. Pipeline state, vertex buffers and root
+ * arguments are left to the record function.
+ *
+ * Descriptor tables that change per draw are staged on a DynamicDescriptorHeap.
+ * If the recorder is given a function that creates them, every command list of
+ * the frame gets one of its own. It is passed to the record function with the
+ * descriptor table layout of the InheritedState set and its ring heaps bound,
+ * and it is reset once the frame has been executed.
+ *
+ * The recorder is a RenderGraphCommandContext. Passes that record in
+ * parallel must be marked with RenderGraphPassBuilder::SetSwitchesCommandList.
+ *
+ * Chunks are only recorded, they must not transition resources: barriers of
+ * a pass are recorded on the current command list before the pass starts.
+ */
+#pragma once
+
+#include "dynamicdescriptorheap.h"  // For DynamicDescriptorHeap
+#include "rendergraph.h"            // For RenderGraphCommandContext
+#include "rhi.h"                    // For RHICommandList, RHIRootSignature and RHIDescriptorHeap
+
+#include <cstdint>                  // For uint32_t and uint64_t
+#include <functional>               // For std::function
+#include <memory>                   // For std::shared_ptr
+#include <vector>                   // For std::vector
+
+class CommandQueue;
+class JobSystem;
+class ResourceStateTracker;
+
+class ParallelCommandRecorder : public RenderGraphCommandContext {
+public:
+    /**
+     * Records the items [begin, end) of a pass on the command list. Called on any thread of the job system.
+     * The dynamic descriptor heap belongs to the command list, it is null if the recorder has none.
+     */
+    using RecordFunction = std::function<void(RHICommandList* commandList, DynamicDescriptorHeap* dynamicDescriptorHeap,
+        uint32_t begin, uint32_t end)>;
+    using CreateDynamicDescriptorHeapFunction = std::function<std::shared_ptr<DynamicDescriptorHeap>()>;
+
+    static const uint32_t MaxRenderTargets = 8;
+    // One CBV/SRV/UAV and one sampler heap.
+    static const uint32_t MaxDescriptorHeaps = 2;
+
+    // The state every command list of a pass starts with.
+    struct InheritedState {
+        RHIViewport viewport;
+        RHIRect scissorRect;
+        uint32_t numRenderTargets;
+        RHICPUDescriptorHandle renderTargets[MaxRenderTargets];
+        // The depth-stencil view is only bound if hasDepthStencil is set.
+        bool hasDepthStencil;
+        RHICPUDescriptorHandle depthStencil;
+        // Not set if null.
+        RHIRootSignature* rootSignature;
+        // Only used without dynamic descriptor heaps, those bind the heaps of their rings.
+        uint32_t numDescriptorHeaps;
+        RHIDescriptorHeap* descriptorHeaps[MaxDescriptorHeaps];
+        // The descriptor tables of the root signature staged on the dynamic descriptor heaps.
+        const DynamicDescriptorHeap::DescriptorTableLayout* descriptorTables;
+        uint32_t numDescriptorTables;
+    };
+
+    // Without createDynamicDescriptorHeap the command lists get no dynamic descriptor heaps.
+    ParallelCommandRecorder(std::shared_ptr<CommandQueue> commandQueue, std::shared_ptr<JobSystem> jobSystem,
+        CreateDynamicDescriptorHeapFunction createDynamicDescriptorHeap = nullptr);
+    virtual ~ParallelCommandRecorder();
+
+    // Start a frame on a new command list.
+    void Begin();
+
+    /**
+     * Record the items [0, count) of a pass on the job system. Every command list gets at least
+     * minItemsPerCommandList items and there are at most as many as the job system has threads.
+     * If that is only one, the items are recorded on the current command list instead.
+     * Returns once all chunks are recorded, the frame continues on a new command list.
+     */
+    void RecordParallel(const InheritedState& state, uint32_t count, uint32_t minItemsPerCommandList,
+        const RecordFunction& record);
+
+    // Execute the command lists of the frame in order with one submission and reset their dynamic descriptor heaps.
+    // Returns the fence value to wait for for the frame.
+    uint64_t Execute();
+
+    // The command lists of the frame so far, including the current one.
+    uint32_t GetNumCommandLists() const;
+
+    // The command list serial work of the frame is recorded on.
+    virtual RHICommandList* GetCommandList() override;
+    virtual ResourceStateTracker& GetResourceStateTracker() override;
+    // The dynamic descriptor heap of the current command list, null if the recorder has none.
+    DynamicDescriptorHeap* GetDynamicDescriptorHeap() const;
+
+private:
+    ParallelCommandRecorder(const ParallelCommandRecorder& copy) = delete;
+    ParallelCommandRecorder& operator=(const ParallelCommandRecorder& other) = delete;
+
+    static void ApplyState(RHICommandList* commandList, DynamicDescriptorHeap* dynamicDescriptorHeap,
+        const InheritedState& state);
+
+    // Start a new current command list.
+    void AddCommandList();
+    // A free dynamic descriptor heap, null without dynamic descriptor heaps.
+    std::shared_ptr<DynamicDescriptorHeap> AcquireDynamicDescriptorHeap();
+
+    std::shared_ptr<CommandQueue> m_CommandQueue;
+    std::shared_ptr<JobSystem> m_JobSystem;
+    CreateDynamicDescriptorHeapFunction m_CreateDynamicDescriptorHeap;
+
+    // In execution order, the last one is the current command list.
+    std::vector< std::shared_ptr<RHICommandList> > m_CommandLists;
+    // The dynamic descriptor heaps of m_CommandLists, null without dynamic descriptor heaps.
+    std::vector< std::shared_ptr<DynamicDescriptorHeap> > m_DynamicDescriptorHeaps;
+    // The chunks of RecordParallel, indexed by chunk.
+    std::vector< std::shared_ptr<RHICommandList> > m_ChunkCommandLists;
+    std::vector< std::shared_ptr<DynamicDescriptorHeap> > m_ChunkDynamicDescriptorHeaps;
+    // Reset heaps of executed frames.
+    std::vector< std::shared_ptr<DynamicDescriptorHeap> > m_FreeDynamicDescriptorHeaps;
+};
@@ -0,0 +1,104 @@
+/**
+ * Hierarchical CPU profiler.
+ *
+ * Zones are recorded with scoped markers (PROFILE_SCOPE / PROFILE_FUNCTION)
+ * timed by the HighResolutionClock. Every thread writes completed zones to
+ * its own fixed size ring buffer without taking locks, so markers can be left
+ * in hot code. The most recent zones of all threads can be written as Chrome
+ * trace_event JSON at any time and inspected in chrome://tracing or Perfetto.
+ *
+ * Zones that were not measured on a CPU thread (e.g. GPU timings) can be
+ * recorded on tracks, which show up next to the threads in the trace.
+ *
+ * Define PROFILER_DISABLED to compile the markers out.
+ */
+#pragma once
+
+#include <atomic>   // For std::atomic
+#include <chrono>   // For std::chrono::high_resolution_clock
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t and uint64_t
+#include <ostream>  // For std::ostream
+#include <string>   // For std::string
+
+class Profiler {
+public:
+    // Number of zones each thread keeps, older zones are overwritten.
+    static const size_t ZonesPerThread = 64 * 1024;
+
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled() {
+        return s_Enabled.load(std::memory_order_relaxed);
+    }
+
+    // Name the calling thread in the trace.
+    static void SetThreadName(const std::string& name);
+
+    // Nanoseconds since the profiler was started.
+    static uint64_t GetTimestamp();
+    // Convert a time point to a profiler timestamp. Time points before the start are clamped to 0.
+    static uint64_t ToTimestamp(std::chrono::high_resolution_clock::time_point timePoint);
+
+    // Begin a zone on the calling thread. Returns the nesting depth of the zone.
+    static uint32_t BeginZone();
+    // Record a zone on the calling thread that ends now.
+    // name must stay valid for the lifetime of the profiler (usually a string literal).
+    static void EndZone(const char* name, uint64_t beginTimestamp, uint32_t depth);
+
+    /**
+     * Create a named track for zones with explicit timestamps. Returns the track id.
+     * Any thread can record to a track, but only one thread at a time.
+     */
+    static uint32_t CreateTrack(const std::string& name);
+    static void RecordZone(uint32_t track, const char* name, uint64_t beginTimestamp, uint64_t endTimestamp,
+        uint32_t depth);
+
+    // Drop all zones recorded so far.
+    static void Clear();
+
+    /**
+     * Write the recorded zones of all threads as Chrome trace_event JSON.
+     * Can be called while other threads keep recording.
+     */
+    static void WriteChromeTrace(std::ostream& stream);
+    static bool SaveChromeTrace(const std::string& fileName);
+
+private:
+    static std::atomic_bool s_Enabled;
+};
+
+// Records a zone from construction to destruction.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : m_Name(Profiler::IsEnabled() ? name : nullptr) {
+        if (m_Name) {
+            m_Depth = Profiler::BeginZone();
+            m_BeginTimestamp = Profiler::GetTimestamp();
+        }
+    }
+
+    ~ProfileScope() {
+        if (m_Name) {
+            Profiler::EndZone(m_Name, m_BeginTimestamp, m_Depth);
+        }
+    }
+
+private:
+    ProfileScope(const ProfileScope& copy) = delete;
+    ProfileScope& operator=(const ProfileScope& other) = delete;
+
+    const char* m_Name;
+    uint64_t m_BeginTimestamp;
+    uint32_t m_Depth;
+};
+
+#if defined(PROFILER_DISABLED)
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_SCOPE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_SCOPE_CONCAT(a, b) PROFILE_SCOPE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
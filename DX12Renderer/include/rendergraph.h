@@ -0,0 +1,235 @@
+/**
+ * Render graph.
+ *
+ * A frame is described as passes that declare the resources they read and
+ * write and the states they need them in. Compile turns the description
+ * into a plan on the CPU only, so it can be tested and benchmarked with the
+ * null backend:
+ *
+ * - Passes that contribute nothing to a pass with side effects, or to an
+ *   imported resource, are culled.
+ * - The remaining passes are ordered by their dependencies. Among passes
+ *   that are ready, the one whose inputs have been ready for the longest
+ *   runs first. This moves consumers away from their producers and gives
+ *   split barriers room.
+ * - Barriers are planned per resource. Consecutive reads are merged into
+ *   one transition to all read states. Transitions of transient resources
+ *   that have passes between the producer and the consumer are split.
+ * - Transient resources are placed in shared heaps. Resources whose
+ *   lifetimes do not overlap share memory and get an aliasing barrier.
+ *
+ * Execute creates the transient resources, cached across frames, and
+ * records the passes. Transitions of imported resources go through the
+ * ResourceStateTracker of the command list, the state they are in when the
+ * frame starts is resolved when the command list is executed.
+ *
+ * A pass may continue the frame on another command list, e.g. after it
+ * recorded its draws on worker threads, see ParallelCommandRecorder. The
+ * graph takes the command list of each pass from a RenderGraphCommandContext.
+ *
+ * The contents of transient resources are undefined at their first write,
+ * the first pass writing a render target or a depth buffer must clear it.
+ */
+#pragma once
+
+#include "rhi.h"            // For RHIDevice, RHIResource and RHICommandList
+
+#include <cstdint>          // For uint32_t and uint64_t
+#include <functional>       // For std::function
+#include <memory>           // For std::shared_ptr
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+
+class DeferredReleaseQueue;
+class RenderGraph;
+class ResourceStateTracker;
+
+// Handle of a resource of a render graph, valid until the graph is reset.
+using RenderGraphResource = uint32_t;
+
+// A barrier planned by Compile, resources are referred to by handle.
+struct RenderGraphBarrier {
+    RHIResourceBarrierType Type;
+    RenderGraphResource Resource;
+    RHIResourceState StateBefore;
+    RHIResourceState StateAfter;
+    uint32_t Flags;
+};
+
+// The command list the frame is recorded on. Queried before every pass and at the end of the frame.
+class RenderGraphCommandContext {
+public:
+    virtual ~RenderGraphCommandContext() = default;
+
+    virtual RHICommandList* GetCommandList() = 0;
+    // The tracker of the current command list.
+    virtual ResourceStateTracker& GetResourceStateTracker() = 0;
+};
+
+// Declares the resources a pass uses.
+class RenderGraphPassBuilder {
+public:
+    RenderGraphPassBuilder(RenderGraph& graph, uint32_t pass);
+
+    // The pass reads the resource in the state.
+    RenderGraphPassBuilder& Read(RenderGraphResource resource, RHIResourceState state);
+    // The pass writes the resource in the state. The contents written by earlier passes are kept.
+    RenderGraphPassBuilder& Write(RenderGraphResource resource, RHIResourceState state);
+    // The pass has effects outside of the graph and is never culled.
+    RenderGraphPassBuilder& SetSideEffects();
+    // The pass continues the frame on another command list. Split transitions are not planned across
+    // it, both halves must be recorded on the same command list.
+    RenderGraphPassBuilder& SetSwitchesCommandList();
+
+    uint32_t GetPass() const;
+
+private:
+    RenderGraph& m_Graph;
+    uint32_t m_Pass;
+};
+
+class RenderGraph {
+public:
+    static const RenderGraphResource InvalidResource = ~0u;
+    // Cached transient resources that have not been used for this many frames are released.
+    static const uint64_t MaxUnusedFrames = 8;
+
+    using ExecuteFunction = std::function<void(RenderGraph& graph, RHICommandList* commandList)>;
+
+    struct Stats {
+        uint32_t numPasses;
+        uint32_t numCulledPasses;
+        // Barriers recorded, both halves of split transitions are counted.
+        uint32_t numBarriers;
+        uint32_t numSplitBarriers;
+        uint32_t numAliasingBarriers;
+        uint32_t numTransientResources;
+        // The memory of the transient resources without and with aliasing.
+        uint64_t transientBytes;
+        uint64_t transientHeapBytes;
+    };
+
+    // If deferredReleaseQueue is null, transient memory is released immediately.
+    RenderGraph(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue);
+    virtual ~RenderGraph();
+
+    // Create a resource that only lives within the frame.
+    RenderGraphResource CreateResource(const std::string& name, const RHIResourceDesc& desc);
+    // Use a resource from outside of the graph. It is left in the final state after the frame.
+    RenderGraphResource ImportResource(const std::string& name, RHIResource* resource, RHIResourceState finalState);
+    // Passes are executed with the command list in an order Compile determines.
+    RenderGraphPassBuilder AddPass(const std::string& name, ExecuteFunction execute);
+
+    // Cull and order the passes, plan the barriers and place the transient resources.
+    void Compile();
+    // Create the transient resources and record the passes. Compile must have been called.
+    void Execute(RHICommandList* commandList, ResourceStateTracker& resourceStateTracker);
+    // Record every pass on the command list the context has when the pass starts.
+    void Execute(RenderGraphCommandContext& context);
+    // Remove all passes and resources. The transient memory is kept for the next frame.
+    void Reset();
+
+    // The resource behind a handle, only valid while the graph is executed.
+    RHIResource* GetResource(RenderGraphResource resource) const;
+    const std::string& GetResourceName(RenderGraphResource resource) const;
+    const std::string& GetPassName(uint32_t pass) const;
+
+    // The passes that are not culled, in execution order.
+    const std::vector<uint32_t>& GetPassOrder() const;
+    bool IsPassCulled(uint32_t pass) const;
+    // Barriers recorded before the pass at the position of the execution order. The first
+    // transitions of resources are resolved by Execute and are not included.
+    const std::vector<RenderGraphBarrier>& GetBarriers(uint32_t position) const;
+    // Offset of a transient resource in its heap.
+    uint64_t GetTransientOffset(RenderGraphResource resource) const;
+    Stats GetStats() const;
+
+private:
+    friend class RenderGraphPassBuilder;
+
+    static const size_t NumHeapResourceTypes = 3;
+
+    struct ResourceAccess {
+        RenderGraphResource resource;
+        RHIResourceState state;
+        bool write;
+    };
+
+    struct Pass {
+        std::string name;
+        ExecuteFunction execute;
+        std::vector<ResourceAccess> accesses;
+        bool sideEffects;
+        bool switchesCommandList;
+        bool culled;
+    };
+
+    struct Resource {
+        std::string name;
+        RHIResourceDesc desc;
+        // Null for transient resources until they are created by Execute.
+        RHIResource* resource;
+        bool imported;
+        RHIResourceState finalState;
+
+        // Filled by Compile. Positions are in the execution order.
+        bool used;
+        uint32_t firstPosition;
+        uint32_t lastPosition;
+        RHIResourceState firstState;
+        RHIResourceState lastState;
+        RHIHeapResourceType heapResourceType;
+        uint64_t size;
+        uint64_t alignment;
+        uint64_t heapOffset;
+        bool aliased;
+    };
+
+    // A transient resource created in a transient heap, reused by later frames.
+    struct CachedResource {
+        RHIHeapResourceType heapResourceType;
+        uint64_t heapOffset;
+        RHIResourceDesc desc;
+        std::shared_ptr<RHIResource> resource;
+        RHIResourceState state;
+        uint64_t lastUsedFrame;
+        bool inUse;
+    };
+
+    void AddAccess(uint32_t pass, RenderGraphResource resource, RHIResourceState state, bool write);
+
+    void CullPasses(const std::vector< std::vector<uint32_t> >& dataDependencies);
+    void OrderPasses(const std::vector< std::vector<uint32_t> >& dependencies);
+    void PlanBarriers();
+    void PlaceTransientResources();
+
+    // Make the transient heap of the type large enough, releasing the old heap and its resources.
+    void ReserveTransientHeap(RHIHeapResourceType heapResourceType, uint64_t size);
+    // Returns the index of a cached resource matching the placement of the transient resource.
+    size_t AcquireCachedResource(const Resource& resource);
+    // True if another cached resource shares memory with the cached resource, it was used last.
+    bool IsMemoryShared(size_t cachedResourceIndex) const;
+    void ReleaseCachedResource(CachedResource& cachedResource);
+
+    std::shared_ptr<RHIDevice> m_Device;
+    std::weak_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+
+    std::vector<Pass> m_Passes;
+    std::vector<Resource> m_Resources;
+
+    // Results of Compile.
+    bool m_Compiled;
+    std::vector<uint32_t> m_PassOrder;
+    std::vector< std::vector<RenderGraphBarrier> > m_Barriers;
+    // Resources first used at each position of the execution order.
+    std::vector< std::vector<RenderGraphResource> > m_FirstUses;
+    uint64_t m_TransientHeapSizes[NumHeapResourceTypes];
+    Stats m_Stats;
+
+    // Persist across frames.
+    std::shared_ptr<RHIHeap> m_TransientHeaps[NumHeapResourceTypes];
+    std::vector<CachedResource> m_CachedResources;
+    // Indices of the cached resources used by the transient resources of the frame being executed.
+    std::vector<size_t> m_CachedResourceIndices;
+    uint64_t m_FrameIndex;
+};
@@ -0,0 +1,98 @@
+/**
+ * Automatic resource state tracking.
+ *
+ * A ResourceStateTracker belongs to one command list while it is recorded.
+ * Callers only name the state a resource is needed in, the tracker knows the
+ * state the resource is in on the command list and batches the barriers
+ * until they are flushed right before the work that depends on them.
+ * Transitions to the current state are dropped and transitions of the same
+ * resource within a batch are merged into one.
+ *
+ * The state a resource is in when a command list starts is unknown while it
+ * is recorded, command lists are recorded in parallel and executed in any
+ * order. The first transition of each resource is kept as a pending barrier.
+ * When the command list is executed, the CommandQueue resolves the pending
+ * barriers against the ResourceStateMap, records the ones that are needed on
+ * a command list that is executed right before and stores the final states
+ * of the command list in the map.
+ *
+ * Only resources registered in the ResourceStateMap can be tracked. Buffers
+ * that rely on implicit state promotion and decay, like the packed buffers of
+ * the GpuMemoryAllocator, must not be tracked.
+ */
+#pragma once
+
+#include "rhi.h"            // For RHIResource, RHIResourceBarrier and RHICommandList
+
+#include <cstdint>          // For uint32_t and uint64_t
+#include <mutex>            // For std::mutex
+#include <unordered_map>    // For std::unordered_map
+#include <vector>           // For std::vector
+
+class ResourceStateTracker {
+public:
+    ResourceStateTracker();
+
+    // Make the resource available in the state. The barrier is batched until the next flush.
+    void TransitionResource(RHIResource* resource, RHIResourceState stateAfter);
+    // Wait for unordered access writes to the resource, or to any resource if it is null.
+    void UAVBarrier(RHIResource* resource = nullptr);
+    // The after resource takes over memory of the before resource. Either can be null for any.
+    void AliasingBarrier(RHIResource* resourceBefore, RHIResource* resourceAfter);
+    // Batch a barrier of a resource that is not tracked, e.g. a split transition planned by a render graph.
+    void ResourceBarrier(const RHIResourceBarrier& barrier);
+
+    // Record the batched barriers. Call before the draws, dispatches and copies that depend on them.
+    void FlushResourceBarriers(RHICommandList* commandList);
+
+    // The first transitions of resources, their before state is resolved when the command list is executed.
+    const std::vector<RHIResourceBarrier>& GetPendingResourceBarriers() const;
+    // The states of the resources used by the command list at its end.
+    const std::unordered_map<RHIResource*, RHIResourceState>& GetFinalResourceStates() const;
+
+    // Barriers recorded by flushes and the number of flushes that recorded any, for profiling.
+    uint64_t GetNumFlushedBarriers() const;
+    uint64_t GetNumFlushes() const;
+
+    // Forget all states. Called when the command list is reset.
+    void Reset();
+
+private:
+    // Update a transition of the resource that has not been flushed yet. Returns false if there is none.
+    bool MergeTransition(RHIResource* resource, RHIResourceState stateAfter);
+
+    std::vector<RHIResourceBarrier> m_ResourceBarriers;
+    std::vector<RHIResourceBarrier> m_PendingResourceBarriers;
+    // Pending barriers from this index on were recorded after the last flush and can still be merged.
+    size_t m_FirstUnflushedPendingBarrier;
+
+    std::unordered_map<RHIResource*, RHIResourceState> m_FinalResourceStates;
+
+    uint64_t m_NumFlushedBarriers;
+    uint64_t m_NumFlushes;
+};
+
+// The states of resources after all command lists executed so far. Thread safe.
+class ResourceStateMap {
+public:
+    // Start tracking a resource in its current state. Resources that are added again take the new state.
+    void AddResource(RHIResource* resource, RHIResourceState state);
+    // Stop tracking a resource, before it is destroyed.
+    void RemoveResource(RHIResource* resource);
+
+    // Returns false if the resource is not tracked.
+    bool GetResourceState(RHIResource* resource, RHIResourceState* state) const;
+
+    /**
+     * Resolve the pending barriers of a command list that is about to be executed and
+     * append the transitions needed before it to barriers. The final states of the
+     * command list become the current states. Command lists must be resolved in the
+     * order they are executed in.
+     */
+    void ResolveResourceStates(const ResourceStateTracker& tracker, std::vector<RHIResourceBarrier>* barriers);
+
+private:
+    std::unordered_map<RHIResource*, RHIResourceState> m_ResourceStates;
+
+    mutable std::mutex m_Mutex;
+};
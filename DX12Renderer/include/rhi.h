@@ -0,0 +1,417 @@
+/**
+ * Render hardware interface.
+ *
+ * A thin, backend agnostic layer over the graphics API. The interfaces mirror
+ * the D3D12 objects they wrap (device, command queue, fence, command allocator,
+ * command list, resource, heap, descriptor heap, query heap and root signature) so the D3D12 backend is a direct
+ * forwarding layer. The null backend (see rhinull.h) records commands and
+ * advances fences on the CPU so the renderer core can run without a GPU.
+ *
+ * This header must not include any platform or graphics API headers.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t, uint64_t
+#include <memory>   // For std::shared_ptr
+
+class RHIResource;
+
+enum class RHIBackend {
+    D3D12,
+    Null
+};
+
+enum class RHIQueueType {
+    Direct,     // Can be used for draw, dispatch, or copy commands.
+    Compute,    // Can be used for dispatch or copy commands.
+    Copy        // Can be used for copy commands.
+};
+
+enum class RHIHeapType {
+    Default,    // GPU local memory.
+    Upload,     // CPU write, GPU read.
+    Readback    // GPU write, CPU read.
+};
+
+// The resources a heap can hold. Resource heap tier 1 hardware cannot mix them in one heap.
+enum class RHIHeapResourceType {
+    Buffers,
+    Textures,               // Textures that are neither render targets nor depth-stencils.
+    RenderTargetTextures    // Render target and depth-stencil textures.
+};
+
+// Query heap types. Timestamps on copy queues need a heap of their own.
+enum class RHIQueryHeapType {
+    Timestamp,
+    CopyQueueTimestamp
+};
+
+enum class RHIDescriptorHeapType {
+    CbvSrvUav,
+    Sampler,
+    Rtv,
+    Dsv,
+    NumTypes
+};
+
+enum class RHIFormat {
+    Unknown,
+    R8G8B8A8_UNorm,
+    R32G32B32_Float,
+    R16_UInt,
+    R32_UInt,
+    D32_Float
+};
+
+// Resource states. The values match D3D12_RESOURCE_STATES.
+enum RHIResourceState : uint32_t {
+    RHIResourceState_Common                  = 0,
+    RHIResourceState_VertexAndConstantBuffer = 0x1,
+    RHIResourceState_IndexBuffer             = 0x2,
+    RHIResourceState_RenderTarget            = 0x4,
+    RHIResourceState_UnorderedAccess         = 0x8,
+    RHIResourceState_DepthWrite              = 0x10,
+    RHIResourceState_DepthRead               = 0x20,
+    RHIResourceState_NonPixelShaderResource  = 0x40,
+    RHIResourceState_PixelShaderResource     = 0x80,
+    RHIResourceState_IndirectArgument        = 0x200,
+    RHIResourceState_CopyDest                = 0x400,
+    RHIResourceState_CopySource              = 0x800,
+    RHIResourceState_GenericRead             = 0x1 | 0x2 | 0x40 | 0x80 | 0x200 | 0x800,
+    RHIResourceState_Present                 = 0
+};
+
+// Resource flags. The values match D3D12_RESOURCE_FLAGS.
+enum RHIResourceFlags : uint32_t {
+    RHIResourceFlag_None                = 0,
+    RHIResourceFlag_AllowRenderTarget   = 0x1,
+    RHIResourceFlag_AllowDepthStencil   = 0x2,
+    RHIResourceFlag_AllowUnorderedAccess = 0x4
+};
+
+enum class RHIResourceDimension {
+    Buffer,
+    Texture2D
+};
+
+struct RHIResourceDesc {
+    RHIResourceDimension Dimension = RHIResourceDimension::Buffer;
+    uint64_t Width = 0;     // Size in bytes for buffers.
+    uint32_t Height = 1;
+    RHIFormat Format = RHIFormat::Unknown;
+    uint32_t Flags = RHIResourceFlag_None;
+
+    static RHIResourceDesc Buffer(uint64_t size, uint32_t flags = RHIResourceFlag_None) {
+        RHIResourceDesc desc;
+        desc.Dimension = RHIResourceDimension::Buffer;
+        desc.Width = size;
+        desc.Flags = flags;
+        return desc;
+    }
+
+    static RHIResourceDesc Tex2D(RHIFormat format, uint64_t width, uint32_t height, uint32_t flags = RHIResourceFlag_None) {
+        RHIResourceDesc desc;
+        desc.Dimension = RHIResourceDimension::Texture2D;
+        desc.Width = width;
+        desc.Height = height;
+        desc.Format = format;
+        desc.Flags = flags;
+        return desc;
+    }
+};
+
+enum class RHIResourceBarrierType {
+    Transition,
+    Aliasing,
+    UAV
+};
+
+// Split transitions. The values match D3D12_RESOURCE_BARRIER_FLAGS.
+enum RHIResourceBarrierFlags : uint32_t {
+    RHIResourceBarrierFlag_None      = 0,
+    // Start the transition, the resource must not be used until the matching end.
+    RHIResourceBarrierFlag_BeginOnly = 0x1,
+    RHIResourceBarrierFlag_EndOnly   = 0x2
+};
+
+struct RHIResourceBarrier {
+    RHIResourceBarrierType Type = RHIResourceBarrierType::Transition;
+    // The transitioned resource, the resource written by UAV barriers (null for all),
+    // or the resource taking over the memory for aliasing barriers.
+    RHIResource* Resource = nullptr;
+    // The resource giving up the memory for aliasing barriers, null for any.
+    RHIResource* ResourceBefore = nullptr;
+    RHIResourceState StateBefore = RHIResourceState_Common;
+    RHIResourceState StateAfter = RHIResourceState_Common;
+    uint32_t Flags = RHIResourceBarrierFlag_None;
+
+    static RHIResourceBarrier Transition(RHIResource* resource, RHIResourceState stateBefore, RHIResourceState stateAfter,
+        uint32_t flags = RHIResourceBarrierFlag_None) {
+        RHIResourceBarrier barrier;
+        barrier.Type = RHIResourceBarrierType::Transition;
+        barrier.Resource = resource;
+        barrier.StateBefore = stateBefore;
+        barrier.StateAfter = stateAfter;
+        barrier.Flags = flags;
+        return barrier;
+    }
+
+    static RHIResourceBarrier UAV(RHIResource* resource) {
+        RHIResourceBarrier barrier;
+        barrier.Type = RHIResourceBarrierType::UAV;
+        barrier.Resource = resource;
+        return barrier;
+    }
+
+    static RHIResourceBarrier Aliasing(RHIResource* resourceBefore, RHIResource* resourceAfter) {
+        RHIResourceBarrier barrier;
+        barrier.Type = RHIResourceBarrierType::Aliasing;
+        barrier.Resource = resourceAfter;
+        barrier.ResourceBefore = resourceBefore;
+        return barrier;
+    }
+};
+
+struct RHIHeapDesc {
+    RHIHeapType Type = RHIHeapType::Default;
+    RHIHeapResourceType ResourceType = RHIHeapResourceType::Buffers;
+    uint64_t Size = 0;      // Must be a multiple of 64KB.
+};
+
+// The space a placed resource takes up in a heap.
+struct RHIResourceAllocationInfo {
+    uint64_t Size;
+    uint64_t Alignment;
+};
+
+struct RHIDescriptorHeapDesc {
+    RHIDescriptorHeapType Type = RHIDescriptorHeapType::CbvSrvUav;
+    uint32_t NumDescriptors = 0;
+    bool ShaderVisible = false;
+};
+
+// Layout compatible with D3D12_CPU_DESCRIPTOR_HANDLE.
+struct RHICPUDescriptorHandle {
+    size_t ptr;
+};
+
+// Layout compatible with D3D12_GPU_DESCRIPTOR_HANDLE.
+struct RHIGPUDescriptorHandle {
+    uint64_t ptr;
+};
+
+// Layout compatible with D3D12_VIEWPORT.
+struct RHIViewport {
+    float TopLeftX;
+    float TopLeftY;
+    float Width;
+    float Height;
+    float MinDepth;
+    float MaxDepth;
+};
+
+// Layout compatible with D3D12_RECT.
+struct RHIRect {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+class RHIFence {
+public:
+    virtual ~RHIFence() = default;
+
+    // The last value the fence has reached.
+    virtual uint64_t GetCompletedValue() const = 0;
+    // Set the fence to the specified value from the CPU.
+    virtual void Signal(uint64_t value) = 0;
+    // Block the calling thread until the fence reaches the specified value.
+    virtual void WaitForValue(uint64_t value) = 0;
+};
+
+class RHIResource {
+public:
+    virtual ~RHIResource() = default;
+
+    virtual const RHIResourceDesc& GetDesc() const = 0;
+    virtual uint64_t GetGPUVirtualAddress() const = 0;
+
+    // Map the entire resource for CPU access. Only valid for upload and readback heaps.
+    virtual void* Map() = 0;
+    virtual void Unmap() = 0;
+};
+
+// Memory placed resources are created in.
+class RHIHeap {
+public:
+    virtual ~RHIHeap() = default;
+
+    virtual const RHIHeapDesc& GetDesc() const = 0;
+};
+
+class RHIDescriptorHeap {
+public:
+    virtual ~RHIDescriptorHeap() = default;
+
+    virtual const RHIDescriptorHeapDesc& GetDesc() const = 0;
+    virtual RHICPUDescriptorHandle GetCPUDescriptorHandleForHeapStart() const = 0;
+    // Only valid for shader visible heaps.
+    virtual RHIGPUDescriptorHandle GetGPUDescriptorHandleForHeapStart() const = 0;
+};
+
+class RHIQueryHeap {
+public:
+    virtual ~RHIQueryHeap() = default;
+
+    virtual RHIQueryHeapType GetType() const = 0;
+    virtual uint32_t GetCount() const = 0;
+};
+
+// Created by the backend, e.g. from a serialized root signature, and only bound through the RHI.
+class RHIRootSignature {
+public:
+    virtual ~RHIRootSignature() = default;
+};
+
+class RHICommandAllocator {
+public:
+    virtual ~RHICommandAllocator() = default;
+
+    // Reclaim the memory of all command lists recorded with this allocator.
+    // The commands must have finished executing.
+    virtual void Reset() = 0;
+};
+
+class RHICommandList {
+public:
+    virtual ~RHICommandList() = default;
+
+    RHIQueueType GetType() const {
+        return m_Type;
+    }
+
+    // The allocator the command list was last reset with.
+    std::shared_ptr<RHICommandAllocator> GetCommandAllocator() const {
+        return m_CommandAllocator;
+    }
+
+    // A value reserved for the code that hands out the command list, comparable to
+    // ID3D12Object::SetPrivateData. CommandQueue uses it to track upload memory.
+    uint64_t GetOwnerData() const {
+        return m_OwnerData;
+    }
+    void SetOwnerData(uint64_t ownerData) {
+        m_OwnerData = ownerData;
+    }
+
+    // Reset the command list for recording with the specified allocator.
+    virtual void Reset(std::shared_ptr<RHICommandAllocator> allocator) = 0;
+    // Finish recording.
+    virtual void Close() = 0;
+
+    // Record a batch of barriers, they are issued together.
+    virtual void ResourceBarrier(uint32_t numBarriers, const RHIResourceBarrier* barriers) = 0;
+    virtual void CopyBufferRegion(RHIResource* dstBuffer, uint64_t dstOffset,
+        RHIResource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) = 0;
+
+    virtual void ClearRenderTargetView(RHICPUDescriptorHandle rtv, const float clearColor[4]) = 0;
+    virtual void ClearDepthStencilView(RHICPUDescriptorHandle dsv, float depth) = 0;
+
+    virtual void OMSetRenderTargets(uint32_t numRenderTargets, const RHICPUDescriptorHandle* rtvs,
+        const RHICPUDescriptorHandle* dsv) = 0;
+    virtual void RSSetViewport(const RHIViewport& viewport) = 0;
+    virtual void RSSetScissorRect(const RHIRect& rect) = 0;
+
+    virtual void IASetVertexBuffer(uint32_t slot, uint64_t bufferLocation, uint32_t sizeInBytes, uint32_t strideInBytes) = 0;
+    virtual void IASetIndexBuffer(uint64_t bufferLocation, uint32_t sizeInBytes, RHIFormat format) = 0;
+
+    // Bind the root signature of the graphics pipeline. The root arguments are reset.
+    virtual void SetGraphicsRootSignature(RHIRootSignature* rootSignature) = 0;
+    virtual void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues,
+        const void* pSrcData, uint32_t destOffsetIn32BitValues) = 0;
+
+    // Bind the shader visible heaps descriptor tables point into. At most one heap per type.
+    virtual void SetDescriptorHeaps(uint32_t numDescriptorHeaps, RHIDescriptorHeap* const* ppDescriptorHeaps) = 0;
+    virtual void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) = 0;
+    virtual void SetComputeRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) = 0;
+
+    virtual void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount,
+        uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) = 0;
+    virtual void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) = 0;
+
+    // Write the GPU timestamp to the query once all previous work has completed.
+    virtual void EndQuery(RHIQueryHeap* queryHeap, uint32_t index) = 0;
+    // Write the results of a range of queries as uint64_t values to a buffer.
+    // The destination offset must be a multiple of 8.
+    virtual void ResolveQueryData(RHIQueryHeap* queryHeap, uint32_t startIndex, uint32_t numQueries,
+        RHIResource* dstBuffer, uint64_t dstOffset) = 0;
+
+protected:
+    explicit RHICommandList(RHIQueueType type)
+        : m_Type(type)
+        , m_OwnerData(0) {
+    }
+
+    RHIQueueType m_Type;
+    std::shared_ptr<RHICommandAllocator> m_CommandAllocator;
+    uint64_t m_OwnerData;
+};
+
+class RHICommandQueue {
+public:
+    virtual ~RHICommandQueue() = default;
+
+    virtual RHIQueueType GetType() const = 0;
+
+    // Submit closed command lists for execution in order.
+    virtual void ExecuteCommandLists(uint32_t numCommandLists, RHICommandList* const* ppCommandLists) = 0;
+    // Set the fence to the specified value once all previously submitted work has completed.
+    virtual void Signal(RHIFence* fence, uint64_t value) = 0;
+    // Make work submitted after the wait wait on the GPU until the fence reaches the value.
+    // The CPU does not block.
+    virtual void Wait(RHIFence* fence, uint64_t value) = 0;
+
+    // Ticks per second of the timestamps written by EndQuery on this queue.
+    virtual uint64_t GetTimestampFrequency() const = 0;
+    // Sample the GPU timestamp counter and the CPU clock at the same time. The CPU
+    // timestamp is in nanoseconds of std::chrono::high_resolution_clock.
+    virtual void GetClockCalibration(uint64_t* gpuTimestamp, uint64_t* cpuTimestamp) const = 0;
+};
+
+class RHIDevice {
+public:
+    virtual ~RHIDevice() = default;
+
+    virtual RHIBackend GetBackend() const = 0;
+
+    virtual std::shared_ptr<RHICommandQueue> CreateCommandQueue(RHIQueueType type) = 0;
+    virtual std::shared_ptr<RHICommandAllocator> CreateCommandAllocator(RHIQueueType type) = 0;
+    // Create a command list in the recording state.
+    virtual std::shared_ptr<RHICommandList> CreateCommandList(RHIQueueType type,
+        std::shared_ptr<RHICommandAllocator> allocator) = 0;
+    virtual std::shared_ptr<RHIFence> CreateFence(uint64_t initialValue) = 0;
+
+    virtual std::shared_ptr<RHIResource> CreateCommittedResource(RHIHeapType heapType,
+        const RHIResourceDesc& desc, RHIResourceState initialState) = 0;
+
+    virtual std::shared_ptr<RHIHeap> CreateHeap(const RHIHeapDesc& desc) = 0;
+    // Create a resource at an offset in a heap. The offset must be a multiple of the alignment
+    // returned by GetResourceAllocationInfo and the heap must outlive the resource.
+    virtual std::shared_ptr<RHIResource> CreatePlacedResource(RHIHeap* heap, uint64_t heapOffset,
+        const RHIResourceDesc& desc, RHIResourceState initialState) = 0;
+    virtual RHIResourceAllocationInfo GetResourceAllocationInfo(const RHIResourceDesc& desc) const = 0;
+
+    virtual std::shared_ptr<RHIDescriptorHeap> CreateDescriptorHeap(const RHIDescriptorHeapDesc& desc) = 0;
+    virtual uint32_t GetDescriptorHandleIncrementSize(RHIDescriptorHeapType type) const = 0;
+    // Copy descriptors on the CPU timeline. The ranges are walked in order, the total number of
+    // source and destination descriptors must match. Sources must not be in shader visible heaps.
+    virtual void CopyDescriptors(uint32_t numDestRanges, const RHICPUDescriptorHandle* destRangeStarts,
+        const uint32_t* destRangeSizes, uint32_t numSrcRanges, const RHICPUDescriptorHandle* srcRangeStarts,
+        const uint32_t* srcRangeSizes, RHIDescriptorHeapType type) = 0;
+
+    virtual std::shared_ptr<RHIQueryHeap> CreateQueryHeap(RHIQueryHeapType type, uint32_t count) = 0;
+    // Whether command lists of the type can write timestamp queries.
+    virtual bool IsTimestampQuerySupported(RHIQueueType type) const = 0;
+};
@@ -0,0 +1,225 @@
+/**
+ * D3D12 RHI backend.
+ *
+ * Forwards the RHI interfaces to the wrapped D3D12 objects. Code that still
+ * needs the native objects (pipeline state, root signatures, swap chains)
+ * can retrieve them with the GetD3D12* helpers at the bottom of this file.
+ */
+#pragma once
+
+#include "rhi.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+D3D12_COMMAND_LIST_TYPE ToD3D12(RHIQueueType type);
+D3D12_DESCRIPTOR_HEAP_TYPE ToD3D12(RHIDescriptorHeapType type);
+DXGI_FORMAT ToD3D12(RHIFormat format);
+RHIQueueType ToRHI(D3D12_COMMAND_LIST_TYPE type);
+RHIDescriptorHeapType ToRHI(D3D12_DESCRIPTOR_HEAP_TYPE type);
+
+class D3D12RHIFence : public RHIFence {
+public:
+    explicit D3D12RHIFence(Microsoft::WRL::ComPtr<ID3D12Fence> fence);
+
+    virtual uint64_t GetCompletedValue() const override;
+    virtual void Signal(uint64_t value) override;
+    virtual void WaitForValue(uint64_t value) override;
+
+    Microsoft::WRL::ComPtr<ID3D12Fence> GetD3D12Fence() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Fence> m_d3d12Fence;
+};
+
+class D3D12RHIResource : public RHIResource {
+public:
+    D3D12RHIResource(Microsoft::WRL::ComPtr<ID3D12Resource> resource, const RHIResourceDesc& desc);
+
+    virtual const RHIResourceDesc& GetDesc() const override;
+    virtual uint64_t GetGPUVirtualAddress() const override;
+
+    virtual void* Map() override;
+    virtual void Unmap() override;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> GetD3D12Resource() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12Resource;
+    RHIResourceDesc m_Desc;
+};
+
+class D3D12RHIHeap : public RHIHeap {
+public:
+    D3D12RHIHeap(Microsoft::WRL::ComPtr<ID3D12Heap> heap, const RHIHeapDesc& desc);
+
+    virtual const RHIHeapDesc& GetDesc() const override;
+
+    Microsoft::WRL::ComPtr<ID3D12Heap> GetD3D12Heap() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Heap> m_d3d12Heap;
+    RHIHeapDesc m_Desc;
+};
+
+class D3D12RHIDescriptorHeap : public RHIDescriptorHeap {
+public:
+    D3D12RHIDescriptorHeap(Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap, const RHIDescriptorHeapDesc& desc);
+
+    virtual const RHIDescriptorHeapDesc& GetDesc() const override;
+    virtual RHICPUDescriptorHandle GetCPUDescriptorHandleForHeapStart() const override;
+    virtual RHIGPUDescriptorHandle GetGPUDescriptorHandleForHeapStart() const override;
+
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> GetD3D12DescriptorHeap() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12DescriptorHeap;
+    RHIDescriptorHeapDesc m_Desc;
+};
+
+class D3D12RHIQueryHeap : public RHIQueryHeap {
+public:
+    D3D12RHIQueryHeap(Microsoft::WRL::ComPtr<ID3D12QueryHeap> queryHeap, RHIQueryHeapType type, uint32_t count);
+
+    virtual RHIQueryHeapType GetType() const override;
+    virtual uint32_t GetCount() const override;
+
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> GetD3D12QueryHeap() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_d3d12QueryHeap;
+    RHIQueryHeapType m_Type;
+    uint32_t m_Count;
+};
+
+class D3D12RHIRootSignature : public RHIRootSignature {
+public:
+    explicit D3D12RHIRootSignature(Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature);
+
+    Microsoft::WRL::ComPtr<ID3D12RootSignature> GetD3D12RootSignature() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12RootSignature> m_d3d12RootSignature;
+};
+
+class D3D12RHICommandAllocator : public RHICommandAllocator {
+public:
+    explicit D3D12RHICommandAllocator(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
+
+    virtual void Reset() override;
+
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> GetD3D12CommandAllocator() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_d3d12CommandAllocator;
+};
+
+class D3D12RHICommandList : public RHICommandList {
+public:
+    D3D12RHICommandList(RHIQueueType type, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
+        std::shared_ptr<RHICommandAllocator> allocator);
+
+    virtual void Reset(std::shared_ptr<RHICommandAllocator> allocator) override;
+    virtual void Close() override;
+
+    virtual void ResourceBarrier(uint32_t numBarriers, const RHIResourceBarrier* barriers) override;
+    virtual void CopyBufferRegion(RHIResource* dstBuffer, uint64_t dstOffset,
+        RHIResource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) override;
+
+    virtual void ClearRenderTargetView(RHICPUDescriptorHandle rtv, const float clearColor[4]) override;
+    virtual void ClearDepthStencilView(RHICPUDescriptorHandle dsv, float depth) override;
+
+    virtual void OMSetRenderTargets(uint32_t numRenderTargets, const RHICPUDescriptorHandle* rtvs,
+        const RHICPUDescriptorHandle* dsv) override;
+    virtual void RSSetViewport(const RHIViewport& viewport) override;
+    virtual void RSSetScissorRect(const RHIRect& rect) override;
+
+    virtual void IASetVertexBuffer(uint32_t slot, uint64_t bufferLocation, uint32_t sizeInBytes, uint32_t strideInBytes) override;
+    virtual void IASetIndexBuffer(uint64_t bufferLocation, uint32_t sizeInBytes, RHIFormat format) override;
+
+    virtual void SetGraphicsRootSignature(RHIRootSignature* rootSignature) override;
+    virtual void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues,
+        const void* pSrcData, uint32_t destOffsetIn32BitValues) override;
+
+    virtual void SetDescriptorHeaps(uint32_t numDescriptorHeaps, RHIDescriptorHeap* const* ppDescriptorHeaps) override;
+    virtual void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) override;
+    virtual void SetComputeRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) override;
+
+    virtual void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount,
+        uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) override;
+    virtual void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override;
+
+    virtual void EndQuery(RHIQueryHeap* queryHeap, uint32_t index) override;
+    virtual void ResolveQueryData(RHIQueryHeap* queryHeap, uint32_t startIndex, uint32_t numQueries,
+        RHIResource* dstBuffer, uint64_t dstOffset) override;
+
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_d3d12CommandList;
+};
+
+class D3D12RHICommandQueue : public RHICommandQueue {
+public:
+    D3D12RHICommandQueue(Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue, RHIQueueType type);
+
+    virtual RHIQueueType GetType() const override;
+
+    virtual void ExecuteCommandLists(uint32_t numCommandLists, RHICommandList* const* ppCommandLists) override;
+    virtual void Signal(RHIFence* fence, uint64_t value) override;
+    virtual void Wait(RHIFence* fence, uint64_t value) override;
+
+    virtual uint64_t GetTimestampFrequency() const override;
+    virtual void GetClockCalibration(uint64_t* gpuTimestamp, uint64_t* cpuTimestamp) const override;
+
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_d3d12CommandQueue;
+    RHIQueueType m_Type;
+};
+
+class D3D12RHIDevice : public RHIDevice {
+public:
+    explicit D3D12RHIDevice(Microsoft::WRL::ComPtr<ID3D12Device2> device);
+
+    virtual RHIBackend GetBackend() const override;
+
+    virtual std::shared_ptr<RHICommandQueue> CreateCommandQueue(RHIQueueType type) override;
+    virtual std::shared_ptr<RHICommandAllocator> CreateCommandAllocator(RHIQueueType type) override;
+    virtual std::shared_ptr<RHICommandList> CreateCommandList(RHIQueueType type,
+        std::shared_ptr<RHICommandAllocator> allocator) override;
+    virtual std::shared_ptr<RHIFence> CreateFence(uint64_t initialValue) override;
+
+    virtual std::shared_ptr<RHIResource> CreateCommittedResource(RHIHeapType heapType,
+        const RHIResourceDesc& desc, RHIResourceState initialState) override;
+
+    virtual std::shared_ptr<RHIHeap> CreateHeap(const RHIHeapDesc& desc) override;
+    virtual std::shared_ptr<RHIResource> CreatePlacedResource(RHIHeap* heap, uint64_t heapOffset,
+        const RHIResourceDesc& desc, RHIResourceState initialState) override;
+    virtual RHIResourceAllocationInfo GetResourceAllocationInfo(const RHIResourceDesc& desc) const override;
+
+    virtual std::shared_ptr<RHIDescriptorHeap> CreateDescriptorHeap(const RHIDescriptorHeapDesc& desc) override;
+    virtual uint32_t GetDescriptorHandleIncrementSize(RHIDescriptorHeapType type) const override;
+    virtual void CopyDescriptors(uint32_t numDestRanges, const RHICPUDescriptorHandle* destRangeStarts,
+        const uint32_t* destRangeSizes, uint32_t numSrcRanges, const RHICPUDescriptorHandle* srcRangeStarts,
+        const uint32_t* srcRangeSizes, RHIDescriptorHeapType type) override;
+
+    virtual std::shared_ptr<RHIQueryHeap> CreateQueryHeap(RHIQueryHeapType type, uint32_t count) override;
+    virtual bool IsTimestampQuerySupported(RHIQueueType type) const override;
+
+    Microsoft::WRL::ComPtr<ID3D12Device2> GetD3D12Device() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device2> m_d3d12Device;
+    UINT m_DescriptorHandleIncrementSize[static_cast<size_t>(RHIDescriptorHeapType::NumTypes)];
+    bool m_CopyQueueTimestampQueriesSupported;
+};
+
+// Access the native objects of RHI objects created by a D3D12RHIDevice.
+Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList(const std::shared_ptr<RHICommandList>& commandList);
+Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList(RHICommandList* commandList);
+Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue(const std::shared_ptr<RHICommandQueue>& commandQueue);
+Microsoft::WRL::ComPtr<ID3D12Resource> GetD3D12Resource(const std::shared_ptr<RHIResource>& resource);
+Microsoft::WRL::ComPtr<ID3D12Resource> GetD3D12Resource(RHIResource* resource);
+Microsoft::WRL::ComPtr<ID3D12Fence> GetD3D12Fence(const std::shared_ptr<RHIFence>& fence);
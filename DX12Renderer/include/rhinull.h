@@ -0,0 +1,272 @@
+/**
+ * Null (headless) RHI backend.
+ *
+ * Command lists record their commands into a linear byte stream. Executing a
+ * command list on a null queue replays the stream on the CPU: buffer copies
+ * are performed on CPU memory and texture transitions are validated against
+ * the state of the texture, everything else is discarded. Fences are
+ * advanced as soon as the work before them has been replayed.
+ *
+ * Every queue runs a virtual GPU clock that advances by a synthetic cost for
+ * each replayed command, so timestamp queries return plausible timings.
+ *
+ * The null backend only depends on the C++ standard library so it builds on
+ * any platform and can be used to benchmark the renderer core without a GPU.
+ */
+#pragma once
+
+#include "rhi.h"
+
+#include <atomic>               // For std::atomic
+#include <condition_variable>   // For std::condition_variable
+#include <mutex>                // For std::mutex
+#include <vector>               // For std::vector
+
+class NullRHIFence : public RHIFence {
+public:
+    explicit NullRHIFence(uint64_t initialValue);
+
+    virtual uint64_t GetCompletedValue() const override;
+    virtual void Signal(uint64_t value) override;
+    virtual void WaitForValue(uint64_t value) override;
+
+private:
+    std::atomic_uint64_t m_CompletedValue;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+};
+
+class NullRHIResource : public RHIResource {
+public:
+    NullRHIResource(RHIHeapType heapType, const RHIResourceDesc& desc, RHIResourceState initialState,
+        uint64_t gpuVirtualAddress);
+    // A placed resource, buffers use the memory of the heap at placedData.
+    NullRHIResource(RHIHeapType heapType, const RHIResourceDesc& desc, RHIResourceState initialState,
+        uint64_t gpuVirtualAddress, uint8_t* placedData);
+
+    virtual const RHIResourceDesc& GetDesc() const override;
+    virtual uint64_t GetGPUVirtualAddress() const override;
+
+    virtual void* Map() override;
+    virtual void Unmap() override;
+
+    // CPU memory backing a buffer resource. Textures have no backing memory.
+    uint8_t* GetData();
+    RHIHeapType GetHeapType() const;
+
+    // The state on the virtual GPU timeline, updated when transitions are replayed.
+    RHIResourceState GetState() const;
+    void SetState(RHIResourceState state);
+
+private:
+    RHIHeapType m_HeapType;
+    RHIResourceDesc m_Desc;
+    RHIResourceState m_State;
+    uint64_t m_GPUVirtualAddress;
+    std::vector<uint8_t> m_Data;
+    // Heap memory of placed resources, null for committed resources.
+    uint8_t* m_PlacedData;
+};
+
+class NullRHIHeap : public RHIHeap {
+public:
+    NullRHIHeap(const RHIHeapDesc& desc, uint64_t gpuBaseAddress);
+
+    virtual const RHIHeapDesc& GetDesc() const override;
+
+    uint64_t GetGPUBaseAddress() const;
+    // CPU memory backing the buffers placed in the heap. Pages are only touched once a buffer uses them.
+    uint8_t* GetData();
+
+private:
+    RHIHeapDesc m_Desc;
+    uint64_t m_GPUBaseAddress;
+    std::unique_ptr<uint8_t[]> m_Data;
+};
+
+class NullRHIDescriptorHeap : public RHIDescriptorHeap {
+public:
+    NullRHIDescriptorHeap(const RHIDescriptorHeapDesc& desc, uint32_t incrementSize, uint64_t gpuBaseAddress);
+
+    virtual const RHIDescriptorHeapDesc& GetDesc() const override;
+    virtual RHICPUDescriptorHandle GetCPUDescriptorHandleForHeapStart() const override;
+    virtual RHIGPUDescriptorHandle GetGPUDescriptorHandleForHeapStart() const override;
+
+private:
+    RHIDescriptorHeapDesc m_Desc;
+    uint64_t m_GPUBaseAddress;
+    // Descriptors are plain memory so CPU handles can be copied and compared like real ones.
+    std::vector<uint8_t> m_Descriptors;
+};
+
+class NullRHIQueryHeap : public RHIQueryHeap {
+public:
+    NullRHIQueryHeap(RHIQueryHeapType type, uint32_t count);
+
+    virtual RHIQueryHeapType GetType() const override;
+    virtual uint32_t GetCount() const override;
+
+    // Query results, written when EndQuery is replayed.
+    uint64_t* GetData();
+
+private:
+    RHIQueryHeapType m_Type;
+    std::vector<uint64_t> m_Data;
+};
+
+// Root signatures have no state on the CPU, the command stream records which one was bound.
+class NullRHIRootSignature : public RHIRootSignature {
+};
+
+class NullRHICommandAllocator : public RHICommandAllocator {
+public:
+    virtual void Reset() override;
+};
+
+enum class NullRHICommandType : uint32_t {
+    ResourceBarrier,
+    CopyBufferRegion,
+    ClearRenderTargetView,
+    ClearDepthStencilView,
+    OMSetRenderTargets,
+    RSSetViewport,
+    RSSetScissorRect,
+    IASetVertexBuffer,
+    IASetIndexBuffer,
+    SetGraphicsRootSignature,
+    SetGraphicsRoot32BitConstants,
+    SetDescriptorHeaps,
+    SetGraphicsRootDescriptorTable,
+    SetComputeRootDescriptorTable,
+    DrawIndexedInstanced,
+    Dispatch,
+    EndQuery,
+    ResolveQueryData
+};
+
+// Every command in the stream starts with this header.
+// Size is the size of the command including the header.
+struct NullRHICommandHeader {
+    NullRHICommandType Type;
+    uint32_t Size;
+};
+
+class NullRHICommandList : public RHICommandList {
+public:
+    NullRHICommandList(RHIQueueType type, std::shared_ptr<RHICommandAllocator> allocator);
+
+    virtual void Reset(std::shared_ptr<RHICommandAllocator> allocator) override;
+    virtual void Close() override;
+
+    virtual void ResourceBarrier(uint32_t numBarriers, const RHIResourceBarrier* barriers) override;
+    virtual void CopyBufferRegion(RHIResource* dstBuffer, uint64_t dstOffset,
+        RHIResource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) override;
+
+    virtual void ClearRenderTargetView(RHICPUDescriptorHandle rtv, const float clearColor[4]) override;
+    virtual void ClearDepthStencilView(RHICPUDescriptorHandle dsv, float depth) override;
+
+    virtual void OMSetRenderTargets(uint32_t numRenderTargets, const RHICPUDescriptorHandle* rtvs,
+        const RHICPUDescriptorHandle* dsv) override;
+    virtual void RSSetViewport(const RHIViewport& viewport) override;
+    virtual void RSSetScissorRect(const RHIRect& rect) override;
+
+    virtual void IASetVertexBuffer(uint32_t slot, uint64_t bufferLocation, uint32_t sizeInBytes, uint32_t strideInBytes) override;
+    virtual void IASetIndexBuffer(uint64_t bufferLocation, uint32_t sizeInBytes, RHIFormat format) override;
+
+    virtual void SetGraphicsRootSignature(RHIRootSignature* rootSignature) override;
+    virtual void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues,
+        const void* pSrcData, uint32_t destOffsetIn32BitValues) override;
+
+    virtual void SetDescriptorHeaps(uint32_t numDescriptorHeaps, RHIDescriptorHeap* const* ppDescriptorHeaps) override;
+    virtual void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) override;
+    virtual void SetComputeRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) override;
+
+    virtual void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount,
+        uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) override;
+    virtual void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override;
+
+    virtual void EndQuery(RHIQueryHeap* queryHeap, uint32_t index) override;
+    virtual void ResolveQueryData(RHIQueryHeap* queryHeap, uint32_t startIndex, uint32_t numQueries,
+        RHIResource* dstBuffer, uint64_t dstOffset) override;
+
+    bool IsClosed() const;
+    // Number of commands recorded since the last reset.
+    uint32_t GetCommandCount() const;
+    // The recorded command stream. Commands are laid out back to back,
+    // each starting with a NullRHICommandHeader.
+    const std::vector<uint8_t>& GetCommandData() const;
+
+private:
+    // Append a command with a payload of type T to the command stream.
+    // Returns a pointer to the payload which stays valid until the next Record call.
+    template<typename T>
+    T* Record(NullRHICommandType type, size_t extraBytes = 0);
+
+    std::vector<uint8_t> m_CommandData;
+    uint32_t m_CommandCount;
+    bool m_Closed;
+};
+
+class NullRHICommandQueue : public RHICommandQueue {
+public:
+    explicit NullRHICommandQueue(RHIQueueType type);
+
+    virtual RHIQueueType GetType() const override;
+
+    virtual void ExecuteCommandLists(uint32_t numCommandLists, RHICommandList* const* ppCommandLists) override;
+    virtual void Signal(RHIFence* fence, uint64_t value) override;
+    virtual void Wait(RHIFence* fence, uint64_t value) override;
+
+    // The virtual GPU clock counts nanoseconds of std::chrono::high_resolution_clock.
+    virtual uint64_t GetTimestampFrequency() const override;
+    virtual void GetClockCalibration(uint64_t* gpuTimestamp, uint64_t* cpuTimestamp) const override;
+
+    // Total number of commands replayed by this queue.
+    uint64_t GetExecutedCommandCount() const;
+
+private:
+    void Replay(const NullRHICommandList& commandList);
+
+    RHIQueueType m_Type;
+    std::atomic_uint64_t m_ExecutedCommandCount;
+    // Time the virtual GPU has finished all replayed work. Guarded by m_Mutex.
+    uint64_t m_GPUTimestamp;
+    // Submissions to a queue are serialized like on a real GPU queue.
+    std::mutex m_Mutex;
+};
+
+class NullRHIDevice : public RHIDevice {
+public:
+    NullRHIDevice();
+
+    virtual RHIBackend GetBackend() const override;
+
+    virtual std::shared_ptr<RHICommandQueue> CreateCommandQueue(RHIQueueType type) override;
+    virtual std::shared_ptr<RHICommandAllocator> CreateCommandAllocator(RHIQueueType type) override;
+    virtual std::shared_ptr<RHICommandList> CreateCommandList(RHIQueueType type,
+        std::shared_ptr<RHICommandAllocator> allocator) override;
+    virtual std::shared_ptr<RHIFence> CreateFence(uint64_t initialValue) override;
+
+    virtual std::shared_ptr<RHIResource> CreateCommittedResource(RHIHeapType heapType,
+        const RHIResourceDesc& desc, RHIResourceState initialState) override;
+
+    virtual std::shared_ptr<RHIHeap> CreateHeap(const RHIHeapDesc& desc) override;
+    virtual std::shared_ptr<RHIResource> CreatePlacedResource(RHIHeap* heap, uint64_t heapOffset,
+        const RHIResourceDesc& desc, RHIResourceState initialState) override;
+    virtual RHIResourceAllocationInfo GetResourceAllocationInfo(const RHIResourceDesc& desc) const override;
+
+    virtual std::shared_ptr<RHIDescriptorHeap> CreateDescriptorHeap(const RHIDescriptorHeapDesc& desc) override;
+    virtual uint32_t GetDescriptorHandleIncrementSize(RHIDescriptorHeapType type) const override;
+    virtual void CopyDescriptors(uint32_t numDestRanges, const RHICPUDescriptorHandle* destRangeStarts,
+        const uint32_t* destRangeSizes, uint32_t numSrcRanges, const RHICPUDescriptorHandle* srcRangeStarts,
+        const uint32_t* srcRangeSizes, RHIDescriptorHeapType type) override;
+
+    virtual std::shared_ptr<RHIQueryHeap> CreateQueryHeap(RHIQueryHeapType type, uint32_t count) override;
+    virtual bool IsTimestampQuerySupported(RHIQueueType type) const override;
+
+private:
+    // Reserve a range of fake GPU virtual addresses.
+    uint64_t AllocateGPUVirtualAddress(uint64_t size);
+
+    std::atomic_uint64_t m_NextGPUVirtualAddress;
+};
@@ -0,0 +1,111 @@
+/**
+ * Two-level segregated fit (TLSF) range allocator.
+ *
+ * Manages the offsets of a linear range, e.g. a GPU heap or a large buffer,
+ * without touching the memory itself. Free blocks are kept in lists indexed
+ * by the power of two of their size (first level) and a linear subdivision
+ * of it (second level). Two bitmaps find a list with a large enough block in
+ * constant time, so allocating and freeing are O(1) and fragmentation stays
+ * low since adjacent free blocks are merged right away.
+ *
+ * The bookkeeping is plain CPU memory, allocation patterns can be replayed
+ * and measured without a device. Once the range is entirely free again, the
+ * block records that fragmentation grew beyond a few are released. Not
+ * thread safe.
+ */
+#pragma once
+
+#include <cstddef>          // For size_t
+#include <cstdint>          // For uint32_t and uint64_t
+#include <unordered_map>    // For std::unordered_map
+#include <vector>           // For std::vector
+
+class TlsfAllocator {
+public:
+    static const uint64_t InvalidOffset = UINT64_MAX;
+
+    struct Stats {
+        uint64_t size;
+        uint64_t usedBytes;
+        uint64_t freeBytes;
+        uint64_t largestFreeBlock;
+        uint32_t numAllocations;
+        uint32_t numFreeBlocks;
+    };
+
+    /**
+     * @param size The size of the range, rounded down to a multiple of the granularity.
+     * @param granularity Sizes and offsets are multiples of this power of two.
+     */
+    TlsfAllocator(uint64_t size, uint64_t granularity);
+
+    /**
+     * Allocate a block of at least size bytes whose offset is a multiple of the alignment.
+     * Returns InvalidOffset if there is no large enough free block.
+     */
+    uint64_t Allocate(uint64_t size, uint64_t alignment);
+    // Free a block returned by Allocate.
+    void Free(uint64_t offset);
+
+    uint64_t GetSize() const;
+    uint64_t GetGranularity() const;
+    bool IsEmpty() const;
+
+    /**
+     * Walks the largest size class for the largest free block.
+     * External fragmentation is 1 - largestFreeBlock / freeBytes.
+     */
+    Stats GetStats() const;
+
+private:
+    static const uint32_t SecondLevelBits = 4;
+    static const uint32_t NumSecondLevels = 1 << SecondLevelBits;
+    static const uint32_t NumFirstLevels = 64;
+    static const uint32_t NullBlock = UINT32_MAX;
+    // Block records kept when the range becomes empty, so alloc and free pairs do not reallocate them.
+    static const size_t MaxRetainedBlocks = 256;
+
+    // Offsets and sizes are in units of the granularity.
+    struct Block {
+        uint64_t offset;
+        uint64_t size;
+        // Neighbours in address order.
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        // Neighbours in the free list, only valid for free blocks.
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool free;
+    };
+
+    static void Mapping(uint64_t size, uint32_t* firstLevel, uint32_t* secondLevel);
+
+    uint32_t CreateBlock(uint64_t offset, uint64_t size);
+    void DestroyBlock(uint32_t block);
+    void InsertFreeBlock(uint32_t block);
+    void RemoveFreeBlock(uint32_t block);
+    // Find a free block of at least size units, NullBlock if there is none.
+    uint32_t FindFreeBlock(uint64_t size) const;
+    // Split a free block that is not in a free list, the tail becomes a free block.
+    void SplitTail(uint32_t block, uint64_t size);
+    // Merge a free block with its physical neighbour, the neighbour must be free.
+    void MergeWithNext(uint32_t block);
+    // Release the block records of an empty range, leaving the one free block of the whole range.
+    void Trim();
+
+    uint64_t m_Size;
+    uint64_t m_Granularity;
+    uint32_t m_GranularityShift;
+
+    std::vector<Block> m_Blocks;
+    // Entries of m_Blocks that are not in use.
+    std::vector<uint32_t> m_UnusedBlocks;
+    // Allocated blocks by their offset in units.
+    std::unordered_map<uint64_t, uint32_t> m_AllocatedBlocks;
+
+    uint32_t m_FreeLists[NumFirstLevels][NumSecondLevels];
+    uint64_t m_FirstLevelBitmap;
+    uint32_t m_SecondLevelBitmaps[NumFirstLevels];
+
+    uint64_t m_UsedSize;
+};
@@ -0,0 +1,130 @@
+/**
+ * Linear upload allocator for CPU to GPU transfers.
+ *
+ * Upload memory is reserved in large, persistently mapped pages in the upload
+ * heap. Allocations are suballocated linearly from the current page. Pages
+ * that are full are retired with a fence value and recycled once the GPU
+ * has passed that fence, so no committed resource is created per upload.
+ *
+ * The upload buffer is owned by a CommandQueue which retires the pages when
+ * the command lists that reference them are executed. All methods are
+ * thread safe.
+ */
+#pragma once
+
+#include "rhi.h"
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint64_t
+#include <deque>    // For std::deque
+#include <memory>   // For std::shared_ptr
+#include <mutex>    // For std::mutex
+#include <queue>    // For std::queue
+#include <vector>   // For std::vector
+
+class UploadBuffer {
+public:
+    // Use 2MB pages by default. This is the size of a large page on most GPUs.
+    static const size_t DefaultPageSize = 2 * 1024 * 1024;
+
+    // A suballocation of an upload page.
+    struct Allocation {
+        void* CPU;              // Mapped CPU address of the allocation.
+        uint64_t GPU;           // GPU virtual address of the allocation.
+        RHIResource* Resource;  // The upload resource containing the allocation.
+        uint64_t Offset;        // Offset of the allocation in Resource.
+    };
+
+    explicit UploadBuffer(std::shared_ptr<RHIDevice> device, size_t pageSize = DefaultPageSize);
+    virtual ~UploadBuffer();
+
+    size_t GetPageSize() const;
+
+    /**
+     * Allocate upload memory.
+     * Allocations larger than the page size get a dedicated page which is
+     * released instead of recycled when it is no longer in use.
+     * @param sizeInBytes The size of the allocation.
+     * @param alignment The alignment of the allocation. Must be a power of two.
+     */
+    Allocation Allocate(size_t sizeInBytes, size_t alignment);
+
+    /**
+     * Register a command list that may reference memory from this upload buffer.
+     * Returns the generation the command list was opened in which must be passed
+     * to CloseCommandList.
+     */
+    uint64_t OpenCommandList();
+
+    /**
+     * Unregister a command list that has been executed with the given fence value.
+     * Full pages are retired as soon as every command list that could reference
+     * them has been executed. Must be called in fence value order.
+     */
+    void CloseCommandList(uint64_t generation, uint64_t fenceValue);
+
+    /**
+     * Recycle retired pages whose fence value has been reached.
+     */
+    void ReleaseCompleted(uint64_t completedFenceValue);
+
+    // Number of pages that have been created (including dedicated pages in use).
+    size_t GetNumPages() const;
+
+private:
+    struct Page {
+        Page(std::shared_ptr<RHIResource> resource, size_t sizeInBytes, bool dedicated);
+        ~Page();
+
+        bool HasSpace(size_t sizeInBytes, size_t alignment) const;
+        Allocation Allocate(size_t sizeInBytes, size_t alignment);
+        void Reset();
+
+        std::shared_ptr<RHIResource> m_Resource;
+        uint8_t* m_CPUBase;
+        uint64_t m_GPUBase;
+        size_t m_PageSize;
+        size_t m_Offset;
+        bool m_Dedicated;
+    };
+
+    using PagePtr = std::shared_ptr<Page>;
+
+    struct RetiredPage {
+        uint64_t fenceValue;
+        PagePtr page;
+    };
+
+    /**
+     * Command lists are grouped in generations. A new generation starts every time a
+     * page becomes full so the full page can only be referenced by command lists of
+     * its own or earlier generations.
+     */
+    struct Generation {
+        size_t numOpenCommandLists;
+        // Pages that became full during this generation.
+        std::vector<PagePtr> fullPages;
+    };
+
+    // Move a page that can not be allocated from anymore to the current generation.
+    void RetirePage(PagePtr page);
+
+    PagePtr RequestPage();
+    PagePtr CreatePage(size_t sizeInBytes, bool dedicated);
+
+    std::shared_ptr<RHIDevice> m_Device;
+    size_t m_PageSize;
+
+    // Pages that can be used for new allocations.
+    std::deque<PagePtr> m_AvailablePages;
+    // Generations that still have open command lists or are the current one, oldest first.
+    std::deque<Generation> m_Generations;
+    uint64_t m_FirstGeneration;
+    // Pages that are waiting on the GPU, in fence order.
+    std::queue<RetiredPage> m_RetiredPages;
+
+    PagePtr m_CurrentPage;
+    size_t m_NumPages;
+
+    mutable std::mutex m_Mutex;
+};
@@ -0,0 +1,42 @@
+/**
+ * Encoding of packed vertex attributes.
+ *
+ * - Positions in R16G16B16A16_UNorm are relative to the bounds of the mesh,
+ *   0 is the minimum and 1 the maximum. The decoded [0, 1] positions are
+ *   turned into object space by the transform of GetPositionDequantization,
+ *   which is folded into the world matrix so vertex shaders do nothing.
+ * - Normals in R16G16_SNorm are octahedral: the unit sphere is projected on
+ *   an octahedron that is unfolded into a square.
+ * - Colors in R8G8B8A8_UNorm, the alpha is 1.
+ * - Texture coordinates in R16G16_Float.
+ *
+ * The input assembler decodes all of them except octahedral normals, see
+ * DecodeOctahedral in shaders/vertexdecode.hlsli. Shaders fetching vertices
+ * from buffers decode them with the functions there.
+ */
+#pragma once
+
+#include "meshfile.h"   // For MeshSemantic, MeshAttributeFormat and MeshFileBounds
+
+#include <cstdint>      // For uint8_t and uint16_t
+
+// Number of floats of an attribute before encoding: 3 for positions, normals and colors, 2 for texture coordinates.
+uint32_t GetMeshSemanticNumComponents(MeshSemantic semantic);
+
+// Round to the nearest half, values out of the range of halfs become infinity.
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// Map a unit normal to a point in [-1, 1]^2 and back.
+void EncodeOctahedral(const float* normal, float* encoded);
+void DecodeOctahedral(const float* encoded, float* normal);
+
+// Write an attribute in the format. The format must be supported for the semantic.
+void EncodeAttribute(MeshSemantic semantic, MeshAttributeFormat format, const float* value, const MeshFileBounds& bounds,
+    uint8_t* destination);
+// Read an attribute back, positions are returned in object space.
+void DecodeAttribute(MeshSemantic semantic, MeshAttributeFormat format, const uint8_t* source, const MeshFileBounds& bounds,
+    float* value);
+
+// The position p decoded by the input assembler is scale * p + offset in object space.
+void GetPositionDequantization(MeshAttributeFormat format, const MeshFileBounds& bounds, float* scale, float* offset);
@@ -8,9 +8,14 @@
 #include <d3d12.h>
 #include <dxgi1_5.h>
 
+#include "descriptorallocator.h"
 #include "events.h"
+#include "framepacer.h"
+#include "framepipeline.h"
+#include "framestats.h"
 #include "highresolutionclock.h"
 
+#include <chrono>
 #include <string>
 #include <memory>
 
@@ -25,8 +30,8 @@ class GameBase;
 
 class Window {
 public:
-    // Number of swapchain back buffers.
-    static const UINT BufferCount = 3;
+    // Maximum number of swapchain back buffers.
+    static const UINT MaxBufferCount = FramePacer::MaxFramesInFlight + 1;
 
     /**
     * Get a handle to this window's instance.
@@ -70,13 +75,51 @@ public:
      */
     void Hide();
 
+    /**
+     * The number of frames the CPU may queue ahead of the GPU.
+     * The swapchain is created with one more back buffer than frames in flight.
+     * Changing the number of frames in flight waits for the GPU to become idle.
+     */
+    UINT GetFramesInFlight() const;
+    void SetFramesInFlight(UINT framesInFlight);
+
+    UINT GetBufferCount() const;
+
+    /**
+     * Get the frame pacer that tracks the frames in flight of this window.
+     * Use its frame index for resources that are duplicated per frame.
+     */
+    FramePacer& GetFramePacer();
+
+    /**
+     * Get the frame time statistics of the recent frames. A frame is added on every present.
+     */
+    FrameStats& GetFrameStats();
+
+    /**
+     * Pipelined frames are rendered on a render thread of the window while the main thread
+     * updates the next frame, see FramePipeline. Otherwise the update and the render of a
+     * frame run back to back on the main thread. Switching finishes the frame being rendered.
+     */
+    bool IsPipelined() const;
+    void SetPipelined(bool pipelined);
+    void TogglePipelined();
+
+    /**
+     * Wait until the render thread has rendered the submitted frames. State it reads outside
+     * of the snapshots, like the frame statistics, must only be used by the main thread after this.
+     * Returns immediately if frames are not pipelined.
+     */
+    void WaitForRenderThread();
+
     /**
      * Return the current back buffer index.
      */
     UINT GetCurrentBackBufferIndex() const;
 
     /**
-     * Present the swapchain's back buffer to the screen.
+     * Present the swapchain's back buffer to the screen and end the frame.
+     * All work of the frame must have been submitted to the direct command queue.
      * Returns the current back buffer index after the present.
      */
     UINT Present();
@@ -88,8 +131,9 @@ public:
 
     /**
      * Get the back buffer resource for the current back buffer.
+     * Back buffers are registered in the resource state map in the present state.
      */
-    Microsoft::WRL::ComPtr<ID3D12Resource> GetCurrentBackBuffer() const;
+    std::shared_ptr<RHIResource> GetCurrentBackBuffer() const;
 
 
 protected:
@@ -102,7 +146,7 @@ protected:
     friend class GameBase;
 
     Window() = delete;
-    Window(HWND hWnd, const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync);
+    Window(HWND hWnd, const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync, UINT framesInFlight);
     virtual ~Window();
 
     // Register a Game with this window. This allows
@@ -135,6 +179,18 @@ protected:
 
     // Update the render target views for the swapchain back buffers.
     void UpdateRenderTargetViews();
+    // Release the back buffers and remove them from the resource state map.
+    void ReleaseBackBuffers();
+
+    // Resize the swapchain buffers to the client size and buffer count.
+    void ResizeSwapChain();
+
+    // Wait until the swapchain can accept a new frame and the frame context is free.
+    // This is the only place the CPU waits for the GPU during a frame.
+    void BeginFrame();
+
+    // Render the frame of the snapshot. On the render thread if frames are pipelined.
+    void RenderFrame(uint32_t snapshotIndex);
 
 private:
     // Windows should not be copied.
@@ -157,10 +213,23 @@ private:
     std::weak_ptr<GameBase> m_pGame;
 
     Microsoft::WRL::ComPtr<IDXGISwapChain4> m_dxgiSwapChain;
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12RTVDescriptorHeap;
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_d3d12BackBuffers[BufferCount];
+    // Render target views for the maximum number of buffers so they survive changing the buffer count.
+    DescriptorAllocation m_RTVDescriptors;
+    std::shared_ptr<RHIResource> m_BackBuffers[MaxBufferCount];
+    // Signaled by DXGI when the swapchain can accept another frame.
+    HANDLE m_FrameLatencyWaitableObject;
+
+    FramePacer m_FramePacer;
+
+    // Only created while frames are pipelined. Begins and renders the frames submitted by OnUpdate.
+    std::unique_ptr<FramePipeline> m_FramePipeline;
+
+    FrameStats m_FrameStats;
+    // Time the CPU was blocked in the last BeginFrame.
+    double m_LastFrameWaitSeconds;
+    std::chrono::high_resolution_clock::time_point m_LastPresentTime;
 
-    UINT m_RTVDescriptorSize;
+    UINT m_BufferCount;
     UINT m_CurrentBackBufferIndex;
 
     RECT m_WindowRect;
@@ -0,0 +1,30 @@
+#include "meshletcommon.hlsli"
+
+groupshared MeshletPayload Payload;
+groupshared uint NumVisibleMeshlets;
+
+// Each thread culls a meshlet, the visible ones of the group are passed on to the mesh shader.
+[numthreads(MESHLET_GROUP_SIZE, 1, 1)]
+void main(uint GroupThreadID : SV_GroupThreadID, uint DispatchThreadID : SV_DispatchThreadID)
+{
+    if (GroupThreadID == 0)
+    {
+        NumVisibleMeshlets = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (DispatchThreadID < MeshletCB.NumMeshlets)
+    {
+        uint meshletIndex = MeshletCB.FirstMeshlet + DispatchThreadID;
+        if (IsMeshletVisible(LoadMeshlet(meshletIndex)))
+        {
+            // The order of the meshlets does not matter, the depth test sorts them out.
+            uint slot;
+            InterlockedAdd(NumVisibleMeshlets, 1, slot);
+            Payload.MeshletIndices[slot] = meshletIndex;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    DispatchMesh(NumVisibleMeshlets, 1, 1, Payload);
+}
@@ -0,0 +1,82 @@
+// Meshlet culling and loading shared by the amplification and mesh shaders, see meshlet.h.
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// Meshlets culled by one amplification shader group.
+#define MESHLET_GROUP_SIZE 32
+
+struct MeshletConstants
+{
+    // Frustum planes and camera position in object space, the planes point inwards.
+    float4 FrustumPlanes[6];
+    float3 CameraPosition;
+    // Bindless index of the data section of the mesh and the offsets in it.
+    uint MeshBufferIndex;
+    uint VertexOffset;
+    uint MeshletOffset;
+    uint MeshletVertexOffset;
+    uint MeshletTriangleOffset;
+    // The meshlets of the submesh being drawn.
+    uint FirstMeshlet;
+    uint NumMeshlets;
+};
+
+ConstantBuffer<MeshletConstants> MeshletCB : register(b1);
+
+// All buffers registered in the bindless descriptor table.
+ByteAddressBuffer Buffers[] : register(t0, space1);
+
+// Same layout as MeshFileMeshlet.
+struct Meshlet
+{
+    uint VertexOffset;
+    uint TriangleOffset;
+    uint NumVertices;
+    uint NumTriangles;
+    float3 Center;
+    float Radius;
+    float3 ConeAxis;
+    float ConeCutoff;
+};
+
+// Meshlets the amplification shader group found visible.
+struct MeshletPayload
+{
+    uint MeshletIndices[MESHLET_GROUP_SIZE];
+};
+
+Meshlet LoadMeshlet(uint index)
+{
+    ByteAddressBuffer meshBuffer = Buffers[MeshletCB.MeshBufferIndex];
+    uint address = MeshletCB.MeshletOffset + index * 48;
+
+    uint4 ranges = meshBuffer.Load4(address);
+    float4 sphere = asfloat(meshBuffer.Load4(address + 16));
+    float4 cone = asfloat(meshBuffer.Load4(address + 32));
+
+    Meshlet meshlet;
+    meshlet.VertexOffset = ranges.x;
+    meshlet.TriangleOffset = ranges.y;
+    meshlet.NumVertices = ranges.z;
+    meshlet.NumTriangles = ranges.w;
+    meshlet.Center = sphere.xyz;
+    meshlet.Radius = sphere.w;
+    meshlet.ConeAxis = cone.xyz;
+    meshlet.ConeCutoff = cone.w;
+    return meshlet;
+}
+
+bool IsMeshletVisible(Meshlet meshlet)
+{
+    for (uint i = 0; i < 6; ++i)
+    {
+        if (dot(MeshletCB.FrustumPlanes[i].xyz, meshlet.Center) + MeshletCB.FrustumPlanes[i].w < -meshlet.Radius)
+        {
+            return false;
+        }
+    }
+
+    // The negation of IsMeshletBackFacing.
+    float3 direction = meshlet.Center - MeshletCB.CameraPosition;
+    return dot(direction, meshlet.ConeAxis) - length(direction) * meshlet.ConeCutoff <= meshlet.Radius * (1.0f + meshlet.ConeCutoff);
+}
@@ -0,0 +1,53 @@
+#include "meshletcommon.hlsli"
+#include "vertexdecode.hlsli"
+
+struct DrawConstants
+{
+    matrix MVP;
+    uint VertexBufferIndex;
+    uint VertexStride;
+    uint ColorOffset;
+    uint VertexFlags;
+};
+
+ConstantBuffer<DrawConstants> DrawConstantsCB : register(b0);
+
+struct VertexShaderOutput
+{
+    float4 Color    : COLOR;
+    float4 Position : SV_Position;
+};
+
+// A group outputs a meshlet, each thread a vertex and a triangle of it.
+[outputtopology("triangle")]
+[numthreads(128, 1, 1)]
+void main(uint GroupThreadID : SV_GroupThreadID, uint GroupID : SV_GroupID,
+    in payload MeshletPayload Payload,
+    out vertices VertexShaderOutput Vertices[MESHLET_MAX_VERTICES],
+    out indices uint3 Triangles[MESHLET_MAX_TRIANGLES])
+{
+    ByteAddressBuffer meshBuffer = Buffers[MeshletCB.MeshBufferIndex];
+    Meshlet meshlet = LoadMeshlet(Payload.MeshletIndices[GroupID]);
+
+    SetMeshOutputCounts(meshlet.NumVertices, meshlet.NumTriangles);
+
+    if (GroupThreadID < meshlet.NumVertices)
+    {
+        uint vertexIndex = meshBuffer.Load(MeshletCB.MeshletVertexOffset + (meshlet.VertexOffset + GroupThreadID) * 4);
+
+        // Packed positions are relative to the bounds, the MVP matrix includes the dequantization.
+        float3 position;
+        float3 color;
+        LoadPositionColor(meshBuffer, MeshletCB.VertexOffset + vertexIndex * DrawConstantsCB.VertexStride,
+            DrawConstantsCB.ColorOffset, DrawConstantsCB.VertexFlags, position, color);
+
+        Vertices[GroupThreadID].Position = mul(DrawConstantsCB.MVP, float4(position, 1.0f));
+        Vertices[GroupThreadID].Color = float4(color, 1.0f);
+    }
+
+    if (GroupThreadID < meshlet.NumTriangles)
+    {
+        uint packedTriangle = meshBuffer.Load(MeshletCB.MeshletTriangleOffset + (meshlet.TriangleOffset + GroupThreadID) * 4);
+        Triangles[GroupThreadID] = uint3(packedTriangle & 0xFF, (packedTriangle >> 8) & 0xFF, (packedTriangle >> 16) & 0xFF);
+    }
+}
@@ -0,0 +1,62 @@
+// Decoding of packed vertex attributes for shaders that fetch vertices from
+// buffers, see vertexquantization.h. The input assembler decodes everything
+// but octahedral normals on its own.
+
+// Flags of the vertex layout passed to vertex shaders that fetch vertices.
+#define VERTEX_FLAG_PACKED_POSITION 0x1 // R16G16B16A16_UNorm instead of R32G32B32_Float.
+#define VERTEX_FLAG_PACKED_COLOR    0x2 // R8G8B8A8_UNorm instead of R32G32B32_Float.
+
+float4 UnpackUNorm16x4(uint2 packed)
+{
+    return float4(packed.x & 0xFFFF, packed.x >> 16, packed.y & 0xFFFF, packed.y >> 16) / 65535.0f;
+}
+
+float4 UnpackUNorm8x4(uint packed)
+{
+    return float4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24) / 255.0f;
+}
+
+float2 UnpackSNorm16x2(uint packed)
+{
+    // Sign extend both halfs, -32768 decodes to -1 like -32767.
+    int2 values = int2(packed << 16, packed) >> 16;
+    return max(values / 32767.0f, -1.0f);
+}
+
+float2 UnpackHalf2(uint packed)
+{
+    return f16tof32(uint2(packed, packed >> 16));
+}
+
+// Inverse of EncodeOctahedral, takes the decoded R16G16_SNorm value.
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0f);
+    normal.xy += select(normal.xy >= 0.0f, -t, t);
+    return normalize(normal);
+}
+
+// Load a vertex laid out like the first stream of mesh files: the position at the start followed by the
+// color at colorOffset, each as floats or packed as the flags tell. Packed positions are in [0, 1].
+void LoadPositionColor(ByteAddressBuffer buffer, uint vertexOffset, uint colorOffset, uint flags,
+    out float3 position, out float3 color)
+{
+    if (flags & VERTEX_FLAG_PACKED_POSITION)
+    {
+        position = UnpackUNorm16x4(buffer.Load2(vertexOffset)).xyz;
+    }
+    else
+    {
+        position = asfloat(buffer.Load3(vertexOffset));
+    }
+
+    if (flags & VERTEX_FLAG_PACKED_COLOR)
+    {
+        color = UnpackUNorm8x4(buffer.Load(vertexOffset + colorOffset)).rgb;
+    }
+    else
+    {
+        color = asfloat(buffer.Load3(vertexOffset + colorOffset));
+    }
+}
@@ -0,0 +1,40 @@
+#include "vertexdecode.hlsli"
+
+struct DrawConstants
+{
+    matrix MVP;
+    uint VertexBufferIndex;
+    uint VertexStride;
+    uint ColorOffset;
+    uint VertexFlags;
+};
+
+ConstantBuffer<DrawConstants> DrawConstantsCB : register(b0);
+
+// All buffers registered in the bindless descriptor table.
+ByteAddressBuffer Buffers[] : register(t0, space1);
+
+struct VertexShaderOutput
+{
+    float4 Color    : COLOR;
+    float4 Position : SV_Position;
+};
+
+// The vertices are fetched from the bindless vertex buffer instead of the input assembler.
+VertexShaderOutput main(uint VertexID : SV_VertexID)
+{
+    ByteAddressBuffer vertexBuffer = Buffers[DrawConstantsCB.VertexBufferIndex];
+
+    // Packed positions are relative to the bounds, the MVP matrix includes the dequantization.
+    float3 position;
+    float3 color;
+    LoadPositionColor(vertexBuffer, VertexID * DrawConstantsCB.VertexStride, DrawConstantsCB.ColorOffset,
+        DrawConstantsCB.VertexFlags, position, color);
+
+    VertexShaderOutput OUT;
+
+    OUT.Position = mul(DrawConstantsCB.MVP, float4(position, 1.0f));
+    OUT.Color = float4(color, 1.0f);
+
+    return OUT;
+}
@@ -5,6 +5,8 @@ struct ModelViewProjection
 
 ConstantBuffer<ModelViewProjection> ModelViewProjectionCB : register(b0);
 
+// Packed attributes are decoded by the input assembler. Positions relative to the
+// bounds of the mesh arrive in [0, 1], the MVP matrix includes the dequantization.
 struct VertexPosColor
 {
     float3 Position : POSITION;
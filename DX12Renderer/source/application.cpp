@@ -1,9 +1,19 @@
 #include "application.h"
 
 #include "game.h"
+#include "assetloader.h"
+#include "bindlessdescriptortable.h"
 #include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "dynamicdescriptorheap.h"
+#include "gpumemoryallocator.h"
+#include "gpuprofiler.h"
 #include "window.h"
 #include "helpers.h"
+#include "jobsystem.h"
+#include "profiler.h"
+#include "resourcestatetracker.h"
+#include "rhid3d12.h"
 
 #include <map>
 
@@ -26,8 +36,8 @@ static LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
 
 // A wrapper struct to allow shared pointers for the window class.
 struct MakeWindow : public Window {
-    MakeWindow(HWND hWnd, const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync)
-        : Window(hWnd, windowName, clientWidth, clientHeight, vSync) {
+    MakeWindow(HWND hWnd, const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync, UINT framesInFlight)
+        : Window(hWnd, windowName, clientWidth, clientHeight, vSync, framesInFlight) {
     }
 };
 
@@ -66,14 +76,55 @@ Application::Application(HINSTANCE hInst)
         MessageBoxA(NULL, "Unable to register the window class.", "Error", MB_OK | MB_ICONERROR);
     }
 
+    // Created on the main thread, which becomes the first thread of the job system.
+    m_JobSystem = std::make_shared<JobSystem>();
+
     m_dxgiAdapter = GetAdapter(false);
     if (m_dxgiAdapter) {
         m_d3d12Device = CreateDevice(m_dxgiAdapter);
     }
     if (m_d3d12Device) {
-        m_DirectCommandQueue = std::make_shared<CommandQueue>(m_d3d12Device, D3D12_COMMAND_LIST_TYPE_DIRECT);
-        m_ComputeCommandQueue = std::make_shared<CommandQueue>(m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COMPUTE);
-        m_CopyCommandQueue = std::make_shared<CommandQueue>(m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COPY);
+        m_RHIDevice = std::make_shared<D3D12RHIDevice>(m_d3d12Device);
+
+        m_ResourceStateMap = std::make_shared<ResourceStateMap>();
+
+        m_DirectCommandQueue = std::make_shared<CommandQueue>(m_RHIDevice, RHIQueueType::Direct, m_ResourceStateMap);
+        m_ComputeCommandQueue = std::make_shared<CommandQueue>(m_RHIDevice, RHIQueueType::Compute, m_ResourceStateMap);
+        m_CopyCommandQueue = std::make_shared<CommandQueue>(m_RHIDevice, RHIQueueType::Copy, m_ResourceStateMap);
+
+        m_DeferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+            std::vector< std::shared_ptr<CommandQueue> >{ m_DirectCommandQueue, m_ComputeCommandQueue, m_CopyCommandQueue });
+
+        m_GpuMemoryAllocator = std::make_shared<GpuMemoryAllocator>(m_RHIDevice, m_DeferredReleaseQueue);
+
+        m_CopyGpuProfiler = std::make_shared<GpuProfiler>(m_RHIDevice, m_CopyCommandQueue, "GPU Copy Queue");
+        m_AssetLoader = std::make_shared<AssetLoader>(m_CopyCommandQueue, m_GpuMemoryAllocator, m_CopyGpuProfiler);
+
+        for (size_t i = 0; i < static_cast<size_t>(RHIDescriptorHeapType::NumTypes); ++i) {
+            m_DescriptorAllocators[i] = std::make_shared<DescriptorAllocator>(m_RHIDevice, m_DeferredReleaseQueue,
+                static_cast<RHIDescriptorHeapType>(i));
+        }
+
+        // The bindless table and the dynamic descriptor ring share the one shader visible CBV/SRV/UAV heap.
+        const uint32_t numBindlessDescriptors = 192 * 1024;
+        const uint32_t numDynamicDescriptors = 64 * 1024;
+
+        RHIDescriptorHeapDesc shaderVisibleHeapDesc;
+        shaderVisibleHeapDesc.Type = RHIDescriptorHeapType::CbvSrvUav;
+        shaderVisibleHeapDesc.NumDescriptors = numBindlessDescriptors + numDynamicDescriptors;
+        shaderVisibleHeapDesc.ShaderVisible = true;
+        auto shaderVisibleHeap = m_RHIDevice->CreateDescriptorHeap(shaderVisibleHeapDesc);
+
+        m_BindlessDescriptorTable = std::make_shared<BindlessDescriptorTable>(m_RHIDevice, m_DeferredReleaseQueue,
+            shaderVisibleHeap, 0, numBindlessDescriptors);
+        m_CbvSrvUavDescriptorRing = std::make_shared<DynamicDescriptorRing>(m_RHIDevice, m_DeferredReleaseQueue,
+            shaderVisibleHeap, numBindlessDescriptors, numDynamicDescriptors, 1024);
+
+        // Shader visible sampler heaps are limited to 2048 descriptors.
+        m_SamplerDescriptorRing = std::make_shared<DynamicDescriptorRing>(m_RHIDevice, m_DeferredReleaseQueue,
+            RHIDescriptorHeapType::Sampler, 2048, 128);
+
+        m_DirectGpuProfiler = std::make_shared<GpuProfiler>(m_RHIDevice, m_DirectCommandQueue, "GPU Direct Queue");
 
         m_TearingSupported = CheckTearingSupport();
     }
@@ -101,6 +152,12 @@ void Application::Destroy() {
 }
 
 Application::~Application() {
+    // Finish the jobs that are left while everything they may use still exists.
+    m_JobSystem.reset();
+
+    // Stop the I/O thread before the queues it submits to are flushed.
+    m_AssetLoader.reset();
+
     Flush();
 }
 
@@ -207,7 +264,7 @@ bool Application::IsTearingSupported() const {
     return m_TearingSupported;
 }
 
-std::shared_ptr<Window> Application::CreateRenderWindow(const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync) {
+std::shared_ptr<Window> Application::CreateRenderWindow(const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync, UINT framesInFlight) {
     // First check if a window with the given name already exists.
     WindowNameMap::iterator windowIter = gs_WindowByName.find(windowName);
     if (windowIter != gs_WindowByName.end()) {
@@ -228,7 +285,7 @@ std::shared_ptr<Window> Application::CreateRenderWindow(const std::wstring& wind
         return nullptr;
     }
 
-    WindowPtr pWindow = std::make_shared<MakeWindow>(hWnd, windowName, clientWidth, clientHeight, vSync);
+    WindowPtr pWindow = std::make_shared<MakeWindow>(hWnd, windowName, clientWidth, clientHeight, vSync, framesInFlight);
 
     gs_Windows.insert(WindowMap::value_type(hWnd, pWindow));
     gs_WindowByName.insert(WindowNameMap::value_type(windowName, pWindow));
@@ -259,17 +316,32 @@ std::shared_ptr<Window> Application::GetWindowByName(const std::wstring& windowN
 
 
 int Application::Run(std::shared_ptr<GameBase> pGame) {
-    if (!pGame->Initialize()) return 1;
-    if (!pGame->LoadContent()) return 2;
+    Profiler::SetThreadName("Main");
+
+    {
+        PROFILE_SCOPE("Application::Initialize");
+        if (!pGame->Initialize()) return 1;
+    }
+    {
+        PROFILE_SCOPE("Application::LoadContent");
+        if (!pGame->LoadContent()) return 2;
+    }
 
     MSG msg = { 0 };
     while (msg.message != WM_QUIT) {
         if (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+            // Frames are updated from WM_PAINT, their zones nest in here. Pipelined frames are rendered on a render thread.
+            PROFILE_SCOPE("Application::DispatchMessage");
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
     }
 
+    // Frames still rendered by render threads submit their commands first.
+    for (auto& window : gs_Windows) {
+        window.second->SetPipelined(false);
+    }
+
     // Flush any commands in the commands queues before quiting.
     Flush();
 
@@ -287,6 +359,10 @@ Microsoft::WRL::ComPtr<ID3D12Device2> Application::GetDevice() const {
     return m_d3d12Device;
 }
 
+std::shared_ptr<RHIDevice> Application::GetRHIDevice() const {
+    return m_RHIDevice;
+}
+
 std::shared_ptr<CommandQueue> Application::GetCommandQueue(D3D12_COMMAND_LIST_TYPE type) const {
     std::shared_ptr<CommandQueue> commandQueue;
     switch (type) {
@@ -310,6 +386,57 @@ void Application::Flush() {
     m_DirectCommandQueue->Flush();
     m_ComputeCommandQueue->Flush();
     m_CopyCommandQueue->Flush();
+
+    // Nothing is in use by the GPU anymore.
+    m_DeferredReleaseQueue->ReleaseCompleted();
+}
+
+std::shared_ptr<DeferredReleaseQueue> Application::GetDeferredReleaseQueue() const {
+    return m_DeferredReleaseQueue;
+}
+
+std::shared_ptr<GpuProfiler> Application::GetGpuProfiler(D3D12_COMMAND_LIST_TYPE type) const {
+    std::shared_ptr<GpuProfiler> gpuProfiler;
+    switch (type) {
+        case D3D12_COMMAND_LIST_TYPE_DIRECT:
+            gpuProfiler = m_DirectGpuProfiler;
+            break;
+        case D3D12_COMMAND_LIST_TYPE_COPY:
+            gpuProfiler = m_CopyGpuProfiler;
+            break;
+        default:
+            assert(false && "Invalid command queue type.");
+    }
+
+    return gpuProfiler;
+}
+
+DescriptorAllocation Application::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors) {
+    return m_DescriptorAllocators[static_cast<size_t>(ToRHI(type))]->Allocate(numDescriptors);
+}
+
+std::shared_ptr<DynamicDescriptorHeap> Application::CreateDynamicDescriptorHeap() const {
+    return std::make_shared<DynamicDescriptorHeap>(m_RHIDevice, m_CbvSrvUavDescriptorRing, m_SamplerDescriptorRing);
+}
+
+std::shared_ptr<BindlessDescriptorTable> Application::GetBindlessDescriptorTable() const {
+    return m_BindlessDescriptorTable;
+}
+
+std::shared_ptr<GpuMemoryAllocator> Application::GetGpuMemoryAllocator() const {
+    return m_GpuMemoryAllocator;
+}
+
+std::shared_ptr<AssetLoader> Application::GetAssetLoader() const {
+    return m_AssetLoader;
+}
+
+std::shared_ptr<JobSystem> Application::GetJobSystem() const {
+    return m_JobSystem;
+}
+
+std::shared_ptr<ResourceStateMap> Application::GetResourceStateMap() const {
+    return m_ResourceStateMap;
 }
 
 Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Application::CreateDescriptorHeap(UINT numDescriptors, D3D12_DESCRIPTOR_HEAP_TYPE type) {
@@ -529,6 +656,9 @@ static LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
             break;
             case WM_DESTROY:
             {
+                // The render thread must not present to the window once it is gone.
+                pWindow->SetPipelined(false);
+
                 // If a window is being destroyed, remove it from the 
                 // window maps.
                 RemoveWindow(hwnd);
@@ -0,0 +1,337 @@
+#include "assetloader.h"
+
+#include "commandqueue.h"
+#include "gpuprofiler.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+//
+// AssetRequest
+//
+AssetRequest::AssetRequest(const std::string& path, Type type, uint32_t bufferFlags, Callback callback)
+    : m_Path(path)
+    , m_Type(type)
+    , m_BufferFlags(bufferFlags)
+    , m_Callback(std::move(callback))
+    , m_State(State::Pending)
+    , m_Done(false)
+    , m_FenceValue(0) {
+}
+
+AssetRequest::State AssetRequest::GetState() const {
+    return m_State.load(std::memory_order_acquire);
+}
+
+bool AssetRequest::IsReady() const {
+    return GetState() == State::Ready;
+}
+
+bool AssetRequest::IsDone() const {
+    return m_Done.load(std::memory_order_acquire);
+}
+
+const std::string& AssetRequest::GetPath() const {
+    return m_Path;
+}
+
+const std::vector<uint8_t>& AssetRequest::GetData() const {
+    assert(IsReady() && "The request is not ready.");
+    return m_Data;
+}
+
+const GpuAllocation& AssetRequest::GetBuffer() const {
+    assert(IsReady() && "The request is not ready.");
+    return m_Buffer;
+}
+
+GpuAllocation AssetRequest::TakeBuffer() {
+    assert(IsReady() && "The request is not ready.");
+    return std::move(m_Buffer);
+}
+
+const MeshFile& AssetRequest::GetMesh() const {
+    assert(IsReady() && m_Type == Type::Mesh && "The request is not a mesh that is ready.");
+    return m_Mesh;
+}
+
+//
+// AssetLoader
+//
+const size_t AssetLoader::DefaultMaxBatchSize;
+
+AssetLoader::AssetLoader(std::shared_ptr<CommandQueue> copyCommandQueue, std::shared_ptr<GpuMemoryAllocator> gpuMemoryAllocator,
+    std::shared_ptr<GpuProfiler> gpuProfiler, size_t maxBatchSize)
+    : m_CopyCommandQueue(copyCommandQueue)
+    , m_GpuMemoryAllocator(gpuMemoryAllocator)
+    , m_GpuProfiler(gpuProfiler)
+    , m_MaxBatchSize(maxBatchSize)
+    , m_BatchRegion(GpuProfiler::InvalidRegion)
+    , m_NumProcessing(0)
+    , m_Stop(false)
+    , m_NumPendingRequests(0)
+    , m_Stats() {
+    m_IOThread = std::thread(&AssetLoader::IOThread, this);
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_QueueCondition.notify_one();
+
+    // The I/O thread finishes the queue before it exits.
+    m_IOThread.join();
+    Flush();
+}
+
+std::shared_ptr<AssetRequest> AssetLoader::LoadFile(const std::string& path, AssetRequest::Callback callback) {
+    std::shared_ptr<AssetRequest> request(new AssetRequest(path, AssetRequest::Type::File, RHIResourceFlag_None, std::move(callback)));
+    Enqueue(request);
+    return request;
+}
+
+std::shared_ptr<AssetRequest> AssetLoader::LoadBuffer(const std::string& path, uint32_t bufferFlags,
+    AssetRequest::Callback callback) {
+    std::shared_ptr<AssetRequest> request(new AssetRequest(path, AssetRequest::Type::Buffer, bufferFlags, std::move(callback)));
+    Enqueue(request);
+    return request;
+}
+
+std::shared_ptr<AssetRequest> AssetLoader::CreateBuffer(const void* data, size_t size, uint32_t bufferFlags,
+    AssetRequest::Callback callback) {
+    std::shared_ptr<AssetRequest> request(new AssetRequest(std::string(), AssetRequest::Type::Buffer, bufferFlags, std::move(callback)));
+    request->m_Data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    Enqueue(request);
+    return request;
+}
+
+std::shared_ptr<AssetRequest> AssetLoader::LoadMesh(const std::string& path, uint32_t bufferFlags,
+    AssetRequest::Callback callback) {
+    std::shared_ptr<AssetRequest> request(new AssetRequest(path, AssetRequest::Type::Mesh, bufferFlags, std::move(callback)));
+    Enqueue(request);
+    return request;
+}
+
+void AssetLoader::Enqueue(std::shared_ptr<AssetRequest> request) {
+    ++m_NumPendingRequests;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        assert(!m_Stop && "The loader is being destroyed.");
+        m_Queue.push_back(std::move(request));
+        ++m_Stats.numRequests;
+    }
+    m_QueueCondition.notify_one();
+}
+
+void AssetLoader::IOThread() {
+    Profiler::SetThreadName("Asset I/O");
+
+    std::vector< std::shared_ptr<AssetRequest> > batch;
+    std::vector< std::shared_ptr<AssetRequest> > uploads;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_QueueCondition.wait(lock, [this]() { return m_Stop || !m_Queue.empty(); });
+            if (m_Queue.empty()) {
+                return;
+            }
+
+            // Everything queued so far is read and uploaded together.
+            batch.assign(m_Queue.begin(), m_Queue.end());
+            m_Queue.clear();
+            m_NumProcessing = batch.size();
+        }
+
+        PROFILE_SCOPE("AssetLoader::ProcessBatch");
+
+        std::shared_ptr<RHICommandList> commandList;
+        size_t batchSize = 0;
+
+        for (auto& request : batch) {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+
+            bool loaded = true;
+            if (request->m_Type == AssetRequest::Type::Mesh) {
+                // Pages of the mapping are read as they are copied.
+                loaded = request->m_Mesh.Open(request->m_Path);
+                if (loaded) {
+                    data = request->m_Mesh.GetData();
+                    size = static_cast<size_t>(request->m_Mesh.GetDataSize());
+
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Stats.bytesRead += size;
+                }
+            } else if (!request->m_Path.empty()) {
+                loaded = ReadFile(*request);
+                data = request->m_Data.data();
+                size = request->m_Data.size();
+            } else {
+                data = request->m_Data.data();
+                size = request->m_Data.size();
+            }
+
+            if (!loaded) {
+                request->m_State.store(AssetRequest::State::Failed, std::memory_order_release);
+            } else if (request->m_Type != AssetRequest::Type::File) {
+                if (!commandList) {
+                    commandList = BeginBatch();
+                }
+                RecordUpload(*request, data, size, commandList.get());
+
+                uploads.push_back(request);
+                batchSize += size;
+                if (batchSize >= m_MaxBatchSize) {
+                    Submit(commandList, uploads);
+                    batchSize = 0;
+                }
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Submitted.push_back(request);
+        }
+
+        if (commandList) {
+            Submit(commandList, uploads);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_NumProcessing = 0;
+        }
+        m_IdleCondition.notify_all();
+        batch.clear();
+    }
+}
+
+bool AssetLoader::ReadFile(AssetRequest& request) {
+    PROFILE_FUNCTION();
+
+    std::ifstream file(request.m_Path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    std::streamoff size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+
+    request.m_Data.resize(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    if (size > 0 && !file.read(reinterpret_cast<char*>(request.m_Data.data()), size)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.bytesRead += static_cast<uint64_t>(size);
+    return true;
+}
+
+void AssetLoader::RecordUpload(AssetRequest& request, const uint8_t* data, size_t size, RHICommandList* commandList) {
+    // The buffer starts in the common state and is promoted to the copy destination by the copy.
+    request.m_Buffer = m_GpuMemoryAllocator->CreateBuffer(RHIHeapType::Default, std::max<size_t>(size, 1),
+        request.m_BufferFlags);
+    if (size > 0) {
+        UploadBuffer::Allocation upload = m_CopyCommandQueue->GetUploadBuffer().Allocate(size, sizeof(uint32_t));
+        std::memcpy(upload.CPU, data, size);
+        commandList->CopyBufferRegion(request.m_Buffer.GetResource(), request.m_Buffer.GetOffset(),
+            upload.Resource, upload.Offset, size);
+    }
+
+    // The data lives on in the upload page until the copy has finished.
+    std::vector<uint8_t>().swap(request.m_Data);
+    request.m_State.store(AssetRequest::State::Uploading, std::memory_order_release);
+}
+
+std::shared_ptr<RHICommandList> AssetLoader::BeginBatch() {
+    auto commandList = m_CopyCommandQueue->GetCommandList();
+    if (m_GpuProfiler) {
+        m_GpuProfiler->BeginFrame();
+        m_BatchRegion = m_GpuProfiler->BeginRegion(commandList.get(), "Asset Upload Batch");
+    }
+    return commandList;
+}
+
+void AssetLoader::Submit(std::shared_ptr<RHICommandList>& commandList, std::vector< std::shared_ptr<AssetRequest> >& uploads) {
+    if (m_GpuProfiler) {
+        m_GpuProfiler->EndRegion(commandList.get(), m_BatchRegion);
+    }
+
+    uint64_t fenceValue = m_CopyCommandQueue->ExecuteCommandList(commandList);
+    commandList.reset();
+
+    // The resolve of the batch's timestamps follows it on the copy queue.
+    if (m_GpuProfiler) {
+        m_GpuProfiler->EndFrame();
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto& request : uploads) {
+        request->m_FenceValue = fenceValue;
+        m_Stats.bytesUploaded += request->m_Buffer.GetSize();
+        m_Submitted.push_back(request);
+    }
+    ++m_Stats.numBatches;
+    uploads.clear();
+}
+
+void AssetLoader::Update() {
+    PROFILE_FUNCTION();
+
+    std::vector< std::shared_ptr<AssetRequest> > completed;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto firstPending = std::stable_partition(m_Submitted.begin(), m_Submitted.end(),
+            [this](const std::shared_ptr<AssetRequest>& request) {
+                return m_CopyCommandQueue->IsFenceComplete(request->m_FenceValue);
+            });
+        completed.assign(m_Submitted.begin(), firstPending);
+        m_Submitted.erase(m_Submitted.begin(), firstPending);
+    }
+
+    for (auto& request : completed) {
+        if (request->GetState() != AssetRequest::State::Failed) {
+            request->m_State.store(AssetRequest::State::Ready, std::memory_order_release);
+        }
+        if (request->m_Callback) {
+            request->m_Callback(*request);
+            request->m_Callback = nullptr;
+        }
+        // Published last, threads that see the request done see what the callback did.
+        request->m_Done.store(true, std::memory_order_release);
+        --m_NumPendingRequests;
+    }
+}
+
+void AssetLoader::Flush() {
+    PROFILE_FUNCTION();
+
+    uint64_t fenceValue = 0;
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_IdleCondition.wait(lock, [this]() { return m_Queue.empty() && m_NumProcessing == 0; });
+        for (const auto& request : m_Submitted) {
+            fenceValue = std::max(fenceValue, request->m_FenceValue);
+        }
+    }
+
+    m_CopyCommandQueue->WaitForFenceValue(fenceValue);
+    Update();
+}
+
+size_t AssetLoader::GetNumPendingRequests() const {
+    return m_NumPendingRequests;
+}
+
+AssetLoader::Stats AssetLoader::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
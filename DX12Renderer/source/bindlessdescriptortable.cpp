@@ -0,0 +1,85 @@
+#include "bindlessdescriptortable.h"
+
+#include "deferredreleasequeue.h"
+
+#include <cassert>
+#include <stdexcept>
+
+BindlessDescriptorTable::BindlessDescriptorTable(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, std::shared_ptr<RHIDescriptorHeap> descriptorHeap,
+    uint32_t firstDescriptor, uint32_t numDescriptors)
+    : m_Device(device)
+    , m_DescriptorHeap(descriptorHeap)
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_NumDescriptors(numDescriptors)
+    , m_NextIndex(0) {
+    assert(descriptorHeap->GetDesc().Type == RHIDescriptorHeapType::CbvSrvUav && "Bindless tables hold CBV/SRV/UAV descriptors.");
+    assert(descriptorHeap->GetDesc().ShaderVisible && "The table must be in a shader visible heap.");
+    assert(firstDescriptor + numDescriptors <= descriptorHeap->GetDesc().NumDescriptors && "The table is out of the range of the heap.");
+
+    m_DescriptorSize = device->GetDescriptorHandleIncrementSize(RHIDescriptorHeapType::CbvSrvUav);
+    m_CPUBase = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_CPUBase.ptr += static_cast<size_t>(firstDescriptor) * m_DescriptorSize;
+    m_GPUBase = descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    m_GPUBase.ptr += static_cast<uint64_t>(firstDescriptor) * m_DescriptorSize;
+}
+
+uint32_t BindlessDescriptorTable::Register(RHICPUDescriptorHandle srcDescriptor) {
+    uint32_t index;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (!m_FreeIndices.empty()) {
+            index = m_FreeIndices.back();
+            m_FreeIndices.pop_back();
+        } else if (m_NextIndex < m_NumDescriptors) {
+            index = m_NextIndex++;
+        } else {
+            assert(false && "The bindless descriptor table is full.");
+            throw std::runtime_error("Out of bindless descriptors.");
+        }
+    }
+
+    // Nothing on the GPU references a free index, it can be written without synchronization.
+    RHICPUDescriptorHandle destDescriptor = { m_CPUBase.ptr + static_cast<size_t>(index) * m_DescriptorSize };
+    const uint32_t numDescriptors = 1;
+    m_Device->CopyDescriptors(1, &destDescriptor, &numDescriptors, 1, &srcDescriptor, &numDescriptors,
+        RHIDescriptorHeapType::CbvSrvUav);
+
+    return index;
+}
+
+void BindlessDescriptorTable::Unregister(uint32_t index) {
+    assert(index < m_NumDescriptors && "Invalid bindless index.");
+
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue = m_DeferredReleaseQueue.lock();
+    if (!deferredReleaseQueue) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeIndices.push_back(index);
+        return;
+    }
+
+    // The deleter runs once the GPU is done and keeps the table alive until then.
+    std::shared_ptr<BindlessDescriptorTable> table = shared_from_this();
+    deferredReleaseQueue->Release(std::shared_ptr<void>(nullptr, [table, index](void*) {
+        std::lock_guard<std::mutex> lock(table->m_Mutex);
+        table->m_FreeIndices.push_back(index);
+    }));
+}
+
+RHIGPUDescriptorHandle BindlessDescriptorTable::GetGPUDescriptorHandle() const {
+    return m_GPUBase;
+}
+
+RHIDescriptorHeap* BindlessDescriptorTable::GetDescriptorHeap() const {
+    return m_DescriptorHeap.get();
+}
+
+uint32_t BindlessDescriptorTable::GetNumDescriptors() const {
+    return m_NumDescriptors;
+}
+
+uint32_t BindlessDescriptorTable::GetNumRegistered() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_NextIndex - static_cast<uint32_t>(m_FreeIndices.size());
+}
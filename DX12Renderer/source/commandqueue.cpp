@@ -1,120 +1,277 @@
 #include "commandqueue.h"
 
-#include "helpers.h"
+#include "profiler.h"
 
+#include <algorithm>
 #include <cassert>
 
-CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
-    : m_FenceValue(0)
-    , m_CommandListType(type)
-    , m_d3d12Device(device) {
-    D3D12_COMMAND_QUEUE_DESC desc = {};
-    desc.Type = type;
-    desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
-    desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-    desc.NodeMask = 0;
-
-    ThrowIfFailed(m_d3d12Device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_d3d12CommandQueue)));
-    ThrowIfFailed(m_d3d12Device->CreateFence(m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_d3d12Fence)));
+CommandQueue::CommandQueue(std::shared_ptr<RHIDevice> device, RHIQueueType type,
+    std::shared_ptr<ResourceStateMap> resourceStateMap)
+    : m_CommandListType(type)
+    , m_Device(device)
+    , m_FenceValue(0)
+    , m_UploadBuffer(device)
+    , m_ResourceStateMap(resourceStateMap) {
+    if (!m_ResourceStateMap) {
+        m_ResourceStateMap = std::make_shared<ResourceStateMap>();
+    }
 
-    m_FenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-    assert(m_FenceEvent && "Failed to create fence event handle.");
+    m_CommandQueue = m_Device->CreateCommandQueue(type);
+    m_Fence = m_Device->CreateFence(m_FenceValue);
 }
 
 CommandQueue::~CommandQueue() {
 }
 
 uint64_t CommandQueue::Signal() {
+    PROFILE_FUNCTION();
+
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+    return SignalLocked();
+}
+
+uint64_t CommandQueue::SignalLocked() {
     uint64_t fenceValue = ++m_FenceValue;
-    m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValue);
+    m_CommandQueue->Signal(m_Fence.get(), fenceValue);
     return fenceValue;
 }
 
+uint64_t CommandQueue::GetLastSignaledFenceValue() {
+    // Taking the submit mutex ensures a submission in progress is covered by the value.
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+    return m_FenceValue;
+}
+
 bool CommandQueue::IsFenceComplete(uint64_t fenceValue) {
-    return m_d3d12Fence->GetCompletedValue() >= fenceValue;
+    return m_Fence->GetCompletedValue() >= fenceValue;
 }
 
 void CommandQueue::WaitForFenceValue(uint64_t fenceValue) {
-    if (!IsFenceComplete(fenceValue)) {
-        m_d3d12Fence->SetEventOnCompletion(fenceValue, m_FenceEvent);
-        ::WaitForSingleObject(m_FenceEvent, DWORD_MAX);
-    }
+    PROFILE_FUNCTION();
+
+    m_Fence->WaitForValue(fenceValue);
 }
 
 void CommandQueue::Flush() {
+    PROFILE_FUNCTION();
+
     WaitForFenceValue(Signal());
 }
 
-Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandQueue::CreateCommandAllocator() {
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-    ThrowIfFailed(m_d3d12Device->CreateCommandAllocator(m_CommandListType, IID_PPV_ARGS(&commandAllocator)));
+void CommandQueue::Wait(const CommandQueue& other, uint64_t fenceValue) {
+    PROFILE_FUNCTION();
+
+    assert(&other != this && "A queue can't wait on its own fence.");
+
+    // Nothing to wait for if the GPU already got there.
+    if (other.m_Fence->GetCompletedValue() >= fenceValue) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+
+    auto dependency = std::find_if(m_Dependencies.begin(), m_Dependencies.end(),
+        [&other](const Dependency& d) { return d.commandQueue == &other; });
+    if (dependency == m_Dependencies.end()) {
+        m_Dependencies.push_back(Dependency{ &other, 0 });
+        dependency = m_Dependencies.end() - 1;
+    }
 
-    return commandAllocator;
+    // Fence values only increase, an earlier wait for a higher value covers this one.
+    if (dependency->fenceValue >= fenceValue) {
+        return;
+    }
+
+    m_CommandQueue->Wait(other.m_Fence.get(), fenceValue);
+    dependency->fenceValue = fenceValue;
 }
 
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::CreateCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator) {
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
-    ThrowIfFailed(m_d3d12Device->CreateCommandList(0, m_CommandListType, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+uint64_t CommandQueue::GetWaitedFenceValue(const CommandQueue& other) {
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
 
-    return commandList;
+    for (const auto& dependency : m_Dependencies) {
+        if (dependency.commandQueue == &other) {
+            return dependency.fenceValue;
+        }
+    }
+    return 0;
 }
 
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::GetCommandList() {
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
+std::shared_ptr<RHICommandAllocator> CommandQueue::CreateCommandAllocator() {
+    return m_Device->CreateCommandAllocator(m_CommandListType);
+}
+
+std::shared_ptr<RHICommandList> CommandQueue::CreateCommandList(std::shared_ptr<RHICommandAllocator> allocator) {
+    return m_Device->CreateCommandList(m_CommandListType, allocator);
+}
 
-    if (!m_CommandAllocatorQueue.empty() && IsFenceComplete(m_CommandAllocatorQueue.front().fenceValue)) {
-        commandAllocator = m_CommandAllocatorQueue.front().commandAllocator;
-        m_CommandAllocatorQueue.pop();
+size_t CommandQueue::GetThreadShardIndex() {
+    static std::atomic_size_t s_NextShardIndex(0);
+    static thread_local size_t t_ShardIndex = s_NextShardIndex++ % NumPoolShards;
 
-        ThrowIfFailed(commandAllocator->Reset());
-    } else {
-        commandAllocator = CreateCommandAllocator();
+    return t_ShardIndex;
+}
+
+std::shared_ptr<RHICommandAllocator> CommandQueue::AcquireCommandAllocator(size_t shardIndex) {
+    const uint64_t completedFenceValue = m_Fence->GetCompletedValue();
+
+    // Prefer the thread's own shard. Other shards are only checked if they are not
+    // locked by another thread, creating a new allocator is cheaper than waiting.
+    for (size_t i = 0; i < NumPoolShards; ++i) {
+        PoolShard& shard = m_PoolShards[(shardIndex + i) % NumPoolShards];
+
+        std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+        if (i == 0) {
+            lock.lock();
+        } else if (!lock.try_lock()) {
+            continue;
+        }
+
+        // Allocators are queued in fence order, only the front can be complete.
+        if (!shard.commandAllocatorQueue.empty() &&
+            shard.commandAllocatorQueue.front().fenceValue <= completedFenceValue) {
+            auto commandAllocator = shard.commandAllocatorQueue.front().commandAllocator;
+            shard.commandAllocatorQueue.pop();
+            lock.unlock();
+
+            commandAllocator->Reset();
+            return commandAllocator;
+        }
+    }
+
+    return CreateCommandAllocator();
+}
+
+std::shared_ptr<RHICommandList> CommandQueue::AcquireCommandList(size_t shardIndex) {
+    for (size_t i = 0; i < NumPoolShards; ++i) {
+        PoolShard& shard = m_PoolShards[(shardIndex + i) % NumPoolShards];
+
+        std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+        if (i == 0) {
+            lock.lock();
+        } else if (!lock.try_lock()) {
+            continue;
+        }
+
+        if (!shard.commandListQueue.empty()) {
+            auto commandList = shard.commandListQueue.front();
+            shard.commandListQueue.pop();
+            return commandList;
+        }
     }
 
-    if (!m_CommandListQueue.empty()) {
-        commandList = m_CommandListQueue.front();
-        m_CommandListQueue.pop();
+    return nullptr;
+}
+
+std::shared_ptr<RHICommandList> CommandQueue::GetCommandList() {
+    PROFILE_FUNCTION();
+
+    const size_t shardIndex = GetThreadShardIndex();
 
-        ThrowIfFailed(commandList->Reset(commandAllocator.Get(), nullptr));
+    // Recycle upload pages the GPU is done with.
+    m_UploadBuffer.ReleaseCompleted(m_Fence->GetCompletedValue());
+
+    std::shared_ptr<RHICommandAllocator> commandAllocator = AcquireCommandAllocator(shardIndex);
+
+    // The command list remembers the allocator it was reset with so that it
+    // can be retrieved when the command list is executed.
+    std::shared_ptr<RHICommandList> commandList = AcquireCommandList(shardIndex);
+    if (commandList) {
+        commandList->Reset(commandAllocator);
     } else {
         commandList = CreateCommandList(commandAllocator);
     }
 
-    // Associate the command allocator with the command list so that it can be
-    // retrieved when the command list is executed.
-    ThrowIfFailed(commandList->SetPrivateDataInterface(__uuidof(ID3D12CommandAllocator), commandAllocator.Get()));
+    commandList->SetOwnerData(m_UploadBuffer.OpenCommandList());
+    GetResourceStateTracker(commandList.get()).Reset();
 
     return commandList;
 }
 
 // Execute a command list.
 // Returns the fence value to wait for for this command list.
-uint64_t CommandQueue::ExecuteCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList) {
-    commandList->Close();
+uint64_t CommandQueue::ExecuteCommandList(std::shared_ptr<RHICommandList> commandList) {
+    return ExecuteCommandLists(&commandList, 1);
+}
+
+uint64_t CommandQueue::ExecuteCommandLists(const std::vector< std::shared_ptr<RHICommandList> >& commandLists) {
+    return ExecuteCommandLists(commandLists.data(), commandLists.size());
+}
+
+uint64_t CommandQueue::ExecuteCommandLists(const std::shared_ptr<RHICommandList>* commandLists, size_t numCommandLists) {
+    PROFILE_FUNCTION();
 
-    ID3D12CommandAllocator* commandAllocator;
-    UINT dataSize = sizeof(commandAllocator);
-    ThrowIfFailed(commandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
+    assert(numCommandLists > 0 && "No command lists to execute.");
 
-    ID3D12CommandList* const ppCommandLists[] = {
-        commandList.Get()
-    };
+    // Flushing and closing can be done in parallel with other threads' submissions.
+    for (size_t i = 0; i < numCommandLists; ++i) {
+        GetResourceStateTracker(commandLists[i].get()).FlushResourceBarriers(commandLists[i].get());
+        commandLists[i]->Close();
+    }
 
-    m_d3d12CommandQueue->ExecuteCommandLists(1, ppCommandLists);
-    uint64_t fenceValue = Signal();
+    PoolShard& shard = m_PoolShards[GetThreadShardIndex()];
 
-    m_CommandAllocatorQueue.emplace(CommandAllocatorEntry{ fenceValue, commandAllocator });
-    m_CommandListQueue.push(commandList);
+    std::lock_guard<std::mutex> submitLock(m_SubmitMutex);
 
-    // The ownership of the command allocator has been transferred to the ComPtr
-    // in the command allocator queue. It is safe to release the reference 
-    // in this temporary COM pointer here.
-    commandAllocator->Release();
+    // The states the command lists start in are known now. Command lists are resolved
+    // in submission order so each one sees the final states of the ones before it.
+    m_SubmittedCommandLists.clear();
+    for (size_t i = 0; i < numCommandLists; ++i) {
+        m_ResolvedResourceBarriers.clear();
+        m_ResourceStateMap->ResolveResourceStates(GetResourceStateTracker(commandLists[i].get()), &m_ResolvedResourceBarriers);
+
+        if (!m_ResolvedResourceBarriers.empty()) {
+            std::shared_ptr<RHICommandList> barrierCommandList = GetCommandList();
+            barrierCommandList->ResourceBarrier(static_cast<uint32_t>(m_ResolvedResourceBarriers.size()), m_ResolvedResourceBarriers.data());
+            barrierCommandList->Close();
+            m_SubmittedCommandLists.push_back(barrierCommandList);
+        }
+        m_SubmittedCommandLists.push_back(commandLists[i]);
+    }
+
+    m_SubmittedRHICommandLists.clear();
+    for (const auto& commandList : m_SubmittedCommandLists) {
+        m_SubmittedRHICommandLists.push_back(commandList.get());
+    }
+
+    m_CommandQueue->ExecuteCommandLists(static_cast<uint32_t>(m_SubmittedRHICommandLists.size()), m_SubmittedRHICommandLists.data());
+    uint64_t fenceValue = SignalLocked();
+
+    // All allocators are retired against the single fence value of the batch.
+    // This happens while the submit mutex is held so each shard stays sorted by fence value.
+    {
+        std::lock_guard<std::mutex> shardLock(shard.mutex);
+        for (const auto& commandList : m_SubmittedCommandLists) {
+            RetireCommandList(shard, commandList, fenceValue);
+        }
+    }
+    m_SubmittedCommandLists.clear();
 
     return fenceValue;
 }
 
-Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const {
-    return m_d3d12CommandQueue;
+void CommandQueue::RetireCommandList(PoolShard& shard, const std::shared_ptr<RHICommandList>& commandList, uint64_t fenceValue) {
+    // Upload pages are retired in fence order as well. This must happen before the
+    // command list is returned to the pool where other threads can pick it up.
+    m_UploadBuffer.CloseCommandList(commandList->GetOwnerData(), fenceValue);
+
+    shard.commandAllocatorQueue.emplace(CommandAllocatorEntry{ fenceValue, commandList->GetCommandAllocator() });
+    shard.commandListQueue.push(commandList);
+}
+
+ResourceStateTracker& CommandQueue::GetResourceStateTracker(RHICommandList* commandList) {
+    std::lock_guard<std::mutex> lock(m_ResourceStateTrackersMutex);
+    return m_ResourceStateTrackers[commandList];
+}
+
+std::shared_ptr<ResourceStateMap> CommandQueue::GetResourceStateMap() const {
+    return m_ResourceStateMap;
+}
+
+UploadBuffer& CommandQueue::GetUploadBuffer() {
+    return m_UploadBuffer;
+}
+
+std::shared_ptr<RHICommandQueue> CommandQueue::GetRHICommandQueue() const {
+    return m_CommandQueue;
 }
@@ -0,0 +1,72 @@
+#include "deferredreleasequeue.h"
+
+#include <cassert>
+
+DeferredReleaseQueue::DeferredReleaseQueue(const std::vector< std::shared_ptr<CommandQueue> >& commandQueues)
+    : m_CommandQueues(commandQueues) {
+    assert(m_CommandQueues.size() <= MaxCommandQueues && "Too many command queues.");
+}
+
+DeferredReleaseQueue::~DeferredReleaseQueue() {
+    Flush();
+}
+
+void DeferredReleaseQueue::Enqueue(std::shared_ptr<void> object) {
+    PendingRelease pendingRelease = {};
+    pendingRelease.object = std::move(object);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Read the fence values under the lock so they are queued in increasing order.
+    for (size_t i = 0; i < m_CommandQueues.size(); ++i) {
+        pendingRelease.fenceValues[i] = m_CommandQueues[i]->GetLastSignaledFenceValue();
+    }
+
+    m_PendingReleases.push_back(std::move(pendingRelease));
+}
+
+bool DeferredReleaseQueue::IsComplete(const PendingRelease& pendingRelease) const {
+    for (size_t i = 0; i < m_CommandQueues.size(); ++i) {
+        if (!m_CommandQueues[i]->IsFenceComplete(pendingRelease.fenceValues[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t DeferredReleaseQueue::ReleaseCompleted() {
+    std::vector< std::shared_ptr<void> > releasedObjects;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        while (!m_PendingReleases.empty() && IsComplete(m_PendingReleases.front())) {
+            releasedObjects.push_back(std::move(m_PendingReleases.front().object));
+            m_PendingReleases.pop_front();
+        }
+    }
+
+    // Destroying GPU objects can take a while, don't hold the lock for it.
+    return releasedObjects.size();
+}
+
+void DeferredReleaseQueue::Flush() {
+    std::deque<PendingRelease> pendingReleases;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        pendingReleases.swap(m_PendingReleases);
+    }
+
+    if (!pendingReleases.empty()) {
+        const PendingRelease& last = pendingReleases.back();
+        for (size_t i = 0; i < m_CommandQueues.size(); ++i) {
+            m_CommandQueues[i]->WaitForFenceValue(last.fenceValues[i]);
+        }
+    }
+}
+
+size_t DeferredReleaseQueue::GetNumPendingReleases() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_PendingReleases.size();
+}
@@ -0,0 +1,245 @@
+#include "descriptorallocator.h"
+
+#include "deferredreleasequeue.h"
+
+#include <cassert>
+#include <iterator>
+
+//
+// DescriptorAllocation
+//
+DescriptorAllocation::DescriptorAllocation()
+    : m_Descriptor{ 0 }
+    , m_NumHandles(0)
+    , m_DescriptorSize(0) {
+}
+
+DescriptorAllocation::DescriptorAllocation(RHICPUDescriptorHandle descriptor, uint32_t numHandles, uint32_t descriptorSize,
+    std::shared_ptr<DescriptorAllocatorPage> page)
+    : m_Descriptor(descriptor)
+    , m_NumHandles(numHandles)
+    , m_DescriptorSize(descriptorSize)
+    , m_Page(page) {
+}
+
+DescriptorAllocation::~DescriptorAllocation() {
+    Free();
+}
+
+DescriptorAllocation::DescriptorAllocation(DescriptorAllocation&& allocation)
+    : m_Descriptor(allocation.m_Descriptor)
+    , m_NumHandles(allocation.m_NumHandles)
+    , m_DescriptorSize(allocation.m_DescriptorSize)
+    , m_Page(std::move(allocation.m_Page)) {
+    allocation.m_Descriptor.ptr = 0;
+    allocation.m_NumHandles = 0;
+    allocation.m_DescriptorSize = 0;
+}
+
+DescriptorAllocation& DescriptorAllocation::operator=(DescriptorAllocation&& other) {
+    if (this != &other) {
+        Free();
+
+        m_Descriptor = other.m_Descriptor;
+        m_NumHandles = other.m_NumHandles;
+        m_DescriptorSize = other.m_DescriptorSize;
+        m_Page = std::move(other.m_Page);
+
+        other.m_Descriptor.ptr = 0;
+        other.m_NumHandles = 0;
+        other.m_DescriptorSize = 0;
+    }
+    return *this;
+}
+
+bool DescriptorAllocation::IsNull() const {
+    return m_Descriptor.ptr == 0;
+}
+
+RHICPUDescriptorHandle DescriptorAllocation::GetDescriptorHandle(uint32_t offset) const {
+    assert(offset < m_NumHandles && "Descriptor offset out of range.");
+    return RHICPUDescriptorHandle{ m_Descriptor.ptr + static_cast<size_t>(offset) * m_DescriptorSize };
+}
+
+uint32_t DescriptorAllocation::GetNumHandles() const {
+    return m_NumHandles;
+}
+
+void DescriptorAllocation::Free() {
+    if (!IsNull() && m_Page) {
+        m_Page->Free(m_Descriptor, m_NumHandles);
+    }
+
+    m_Descriptor.ptr = 0;
+    m_NumHandles = 0;
+    m_DescriptorSize = 0;
+    m_Page.reset();
+}
+
+//
+// DescriptorAllocatorPage
+//
+DescriptorAllocatorPage::DescriptorAllocatorPage(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, RHIDescriptorHeapType type, uint32_t numDescriptors)
+    : m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_HeapType(type)
+    , m_NumDescriptors(numDescriptors)
+    , m_NumFreeHandles(0) {
+    RHIDescriptorHeapDesc desc;
+    desc.Type = type;
+    desc.NumDescriptors = numDescriptors;
+    desc.ShaderVisible = false;
+
+    m_DescriptorHeap = device->CreateDescriptorHeap(desc);
+    m_BaseDescriptor = m_DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_DescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+
+    // The whole page starts out as one free block.
+    AddFreeBlock(0, numDescriptors);
+}
+
+RHIDescriptorHeapType DescriptorAllocatorPage::GetHeapType() const {
+    return m_HeapType;
+}
+
+uint32_t DescriptorAllocatorPage::GetNumDescriptors() const {
+    return m_NumDescriptors;
+}
+
+uint32_t DescriptorAllocatorPage::GetNumFreeHandles() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_NumFreeHandles;
+}
+
+void DescriptorAllocatorPage::AddFreeBlock(uint32_t offset, uint32_t numDescriptors) {
+    auto offsetIt = m_FreeListByOffset.emplace(offset, FreeBlockInfo{ numDescriptors, FreeListBySize::iterator() }).first;
+    offsetIt->second.bySizeIt = m_FreeListBySize.emplace(numDescriptors, offsetIt);
+    m_NumFreeHandles += numDescriptors;
+}
+
+DescriptorAllocation DescriptorAllocatorPage::Allocate(uint32_t numDescriptors) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (numDescriptors > m_NumFreeHandles) {
+        return DescriptorAllocation();
+    }
+
+    // The smallest free block that fits keeps large blocks available.
+    auto smallestBlockIt = m_FreeListBySize.lower_bound(numDescriptors);
+    if (smallestBlockIt == m_FreeListBySize.end()) {
+        return DescriptorAllocation();
+    }
+
+    const uint32_t blockSize = smallestBlockIt->first;
+    const auto offsetIt = smallestBlockIt->second;
+    const uint32_t offset = offsetIt->first;
+
+    m_FreeListBySize.erase(smallestBlockIt);
+    m_FreeListByOffset.erase(offsetIt);
+    m_NumFreeHandles -= blockSize;
+
+    // The rest of the block stays free.
+    if (blockSize > numDescriptors) {
+        AddFreeBlock(offset + numDescriptors, blockSize - numDescriptors);
+    }
+
+    RHICPUDescriptorHandle descriptor = { m_BaseDescriptor.ptr + static_cast<size_t>(offset) * m_DescriptorSize };
+    return DescriptorAllocation(descriptor, numDescriptors, m_DescriptorSize, shared_from_this());
+}
+
+void DescriptorAllocatorPage::Free(RHICPUDescriptorHandle descriptor, uint32_t numDescriptors) {
+    const uint32_t offset = static_cast<uint32_t>((descriptor.ptr - m_BaseDescriptor.ptr) / m_DescriptorSize);
+    assert(offset + numDescriptors <= m_NumDescriptors && "The descriptors do not belong to this page.");
+
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue = m_DeferredReleaseQueue.lock();
+    if (!deferredReleaseQueue) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        FreeBlock(offset, numDescriptors);
+        return;
+    }
+
+    // The queue keeps the object alive until the GPU is done, the deleter then
+    // returns the range. It also keeps the page alive until then.
+    std::shared_ptr<DescriptorAllocatorPage> page = shared_from_this();
+    deferredReleaseQueue->Release(std::shared_ptr<void>(nullptr, [page, offset, numDescriptors](void*) {
+        std::lock_guard<std::mutex> lock(page->m_Mutex);
+        page->FreeBlock(offset, numDescriptors);
+    }));
+}
+
+void DescriptorAllocatorPage::FreeBlock(uint32_t offset, uint32_t numDescriptors) {
+    // The first free block after the freed range.
+    auto nextBlockIt = m_FreeListByOffset.upper_bound(offset);
+
+    // Merge with the previous block if it ends where the freed range starts.
+    if (nextBlockIt != m_FreeListByOffset.begin()) {
+        auto prevBlockIt = std::prev(nextBlockIt);
+        assert(prevBlockIt->first + prevBlockIt->second.size <= offset && "Descriptor range freed twice.");
+
+        if (prevBlockIt->first + prevBlockIt->second.size == offset) {
+            offset = prevBlockIt->first;
+            numDescriptors += prevBlockIt->second.size;
+            m_NumFreeHandles -= prevBlockIt->second.size;
+
+            m_FreeListBySize.erase(prevBlockIt->second.bySizeIt);
+            m_FreeListByOffset.erase(prevBlockIt);
+        }
+    }
+
+    // Merge with the next block if it starts where the freed range ends.
+    if (nextBlockIt != m_FreeListByOffset.end()) {
+        assert(offset + numDescriptors <= nextBlockIt->first && "Descriptor range freed twice.");
+
+        if (offset + numDescriptors == nextBlockIt->first) {
+            numDescriptors += nextBlockIt->second.size;
+            m_NumFreeHandles -= nextBlockIt->second.size;
+
+            m_FreeListBySize.erase(nextBlockIt->second.bySizeIt);
+            m_FreeListByOffset.erase(nextBlockIt);
+        }
+    }
+
+    AddFreeBlock(offset, numDescriptors);
+}
+
+//
+// DescriptorAllocator
+//
+DescriptorAllocator::DescriptorAllocator(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, RHIDescriptorHeapType type, uint32_t numDescriptorsPerPage)
+    : m_Device(device)
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_HeapType(type)
+    , m_NumDescriptorsPerPage(numDescriptorsPerPage) {
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+}
+
+std::shared_ptr<DescriptorAllocatorPage> DescriptorAllocator::CreatePage(uint32_t numDescriptors) {
+    auto page = std::make_shared<DescriptorAllocatorPage>(m_Device, m_DeferredReleaseQueue, m_HeapType, numDescriptors);
+    m_Pages.push_back(page);
+    return page;
+}
+
+DescriptorAllocation DescriptorAllocator::Allocate(uint32_t numDescriptors) {
+    assert(numDescriptors > 0 && "Can't allocate an empty descriptor range.");
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // There are few pages, trying each of them is cheap.
+    for (const auto& page : m_Pages) {
+        DescriptorAllocation allocation = page->Allocate(numDescriptors);
+        if (!allocation.IsNull()) {
+            return allocation;
+        }
+    }
+
+    uint32_t pageSize = numDescriptors > m_NumDescriptorsPerPage ? numDescriptors : m_NumDescriptorsPerPage;
+    return CreatePage(pageSize)->Allocate(numDescriptors);
+}
+
+size_t DescriptorAllocator::GetNumPages() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Pages.size();
+}
@@ -0,0 +1,344 @@
+#include "dynamicdescriptorheap.h"
+
+#include "deferredreleasequeue.h"
+
+#include <cassert>
+#include <stdexcept>
+
+//
+// DynamicDescriptorRing
+//
+DynamicDescriptorRing::DynamicDescriptorRing(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, RHIDescriptorHeapType type,
+    uint32_t numDescriptors, uint32_t numDescriptorsPerBlock)
+    : m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_HeapType(type)
+    , m_NumDescriptorsPerBlock(numDescriptorsPerBlock) {
+    RHIDescriptorHeapDesc desc;
+    desc.Type = type;
+    desc.NumDescriptors = numDescriptors;
+    desc.ShaderVisible = true;
+
+    m_DescriptorHeap = device->CreateDescriptorHeap(desc);
+    Init(*device, 0, numDescriptors);
+}
+
+DynamicDescriptorRing::DynamicDescriptorRing(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, std::shared_ptr<RHIDescriptorHeap> descriptorHeap,
+    uint32_t firstDescriptor, uint32_t numDescriptors, uint32_t numDescriptorsPerBlock)
+    : m_DescriptorHeap(descriptorHeap)
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_HeapType(descriptorHeap->GetDesc().Type)
+    , m_NumDescriptorsPerBlock(numDescriptorsPerBlock) {
+    assert(descriptorHeap->GetDesc().ShaderVisible && "The ring must be in a shader visible heap.");
+    assert(firstDescriptor + numDescriptors <= descriptorHeap->GetDesc().NumDescriptors && "The ring is out of the range of the heap.");
+
+    Init(*device, firstDescriptor, numDescriptors);
+}
+
+void DynamicDescriptorRing::Init(RHIDevice& device, uint32_t firstDescriptor, uint32_t numDescriptors) {
+    assert((m_HeapType == RHIDescriptorHeapType::CbvSrvUav || m_HeapType == RHIDescriptorHeapType::Sampler) &&
+        "Only CBV/SRV/UAV and sampler heaps can be shader visible.");
+    assert(m_NumDescriptorsPerBlock > 0 && numDescriptors >= m_NumDescriptorsPerBlock && "The ring must hold at least one block.");
+
+    m_DescriptorSize = device.GetDescriptorHandleIncrementSize(m_HeapType);
+    m_CPUBase = m_DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_CPUBase.ptr += static_cast<size_t>(firstDescriptor) * m_DescriptorSize;
+    m_GPUBase = m_DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    m_GPUBase.ptr += static_cast<uint64_t>(firstDescriptor) * m_DescriptorSize;
+
+    // Descriptors past the last full block are not used.
+    const uint32_t numBlocks = numDescriptors / m_NumDescriptorsPerBlock;
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+        m_FreeBlocks.push_back(i);
+    }
+}
+
+RHIDescriptorHeapType DynamicDescriptorRing::GetHeapType() const {
+    return m_HeapType;
+}
+
+RHIDescriptorHeap* DynamicDescriptorRing::GetDescriptorHeap() const {
+    return m_DescriptorHeap.get();
+}
+
+uint32_t DynamicDescriptorRing::GetDescriptorSize() const {
+    return m_DescriptorSize;
+}
+
+uint32_t DynamicDescriptorRing::GetNumDescriptorsPerBlock() const {
+    return m_NumDescriptorsPerBlock;
+}
+
+uint32_t DynamicDescriptorRing::GetNumFreeBlocks() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return static_cast<uint32_t>(m_FreeBlocks.size());
+}
+
+uint32_t DynamicDescriptorRing::AllocateBlock() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_FreeBlocks.empty()) {
+            uint32_t block = m_FreeBlocks.front();
+            m_FreeBlocks.pop_front();
+            return block;
+        }
+    }
+
+    // All blocks are in flight. Releasing returns blocks through the ring's mutex,
+    // so it must not be held here.
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue = m_DeferredReleaseQueue.lock();
+    if (deferredReleaseQueue) {
+        deferredReleaseQueue->ReleaseCompleted();
+        if (GetNumFreeBlocks() == 0) {
+            deferredReleaseQueue->Flush();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_FreeBlocks.empty()) {
+        assert(false && "The descriptor ring is used up by command lists that are still being recorded.");
+        throw std::runtime_error("Out of shader visible descriptors.");
+    }
+
+    uint32_t block = m_FreeBlocks.front();
+    m_FreeBlocks.pop_front();
+    return block;
+}
+
+void DynamicDescriptorRing::ReleaseBlock(uint32_t block) {
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue = m_DeferredReleaseQueue.lock();
+    if (!deferredReleaseQueue) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeBlocks.push_back(block);
+        return;
+    }
+
+    // The deleter runs once the GPU is done and keeps the ring alive until then.
+    std::shared_ptr<DynamicDescriptorRing> ring = shared_from_this();
+    deferredReleaseQueue->Release(std::shared_ptr<void>(nullptr, [ring, block](void*) {
+        std::lock_guard<std::mutex> lock(ring->m_Mutex);
+        ring->m_FreeBlocks.push_back(block);
+    }));
+}
+
+RHICPUDescriptorHandle DynamicDescriptorRing::GetCPUDescriptorHandle(uint32_t block, uint32_t offset) const {
+    const size_t index = static_cast<size_t>(block) * m_NumDescriptorsPerBlock + offset;
+    return RHICPUDescriptorHandle{ m_CPUBase.ptr + index * m_DescriptorSize };
+}
+
+RHIGPUDescriptorHandle DynamicDescriptorRing::GetGPUDescriptorHandle(uint32_t block, uint32_t offset) const {
+    const uint64_t index = static_cast<uint64_t>(block) * m_NumDescriptorsPerBlock + offset;
+    return RHIGPUDescriptorHandle{ m_GPUBase.ptr + index * m_DescriptorSize };
+}
+
+//
+// DynamicDescriptorHeap
+//
+DynamicDescriptorHeap::DynamicDescriptorHeap(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DynamicDescriptorRing> cbvSrvUavRing, std::shared_ptr<DynamicDescriptorRing> samplerRing)
+    : m_Device(device)
+    , m_DirtyTableMask(0)
+    , m_DescriptorHeapsBound(false) {
+    assert(!cbvSrvUavRing || cbvSrvUavRing->GetHeapType() == RHIDescriptorHeapType::CbvSrvUav);
+    assert(!samplerRing || samplerRing->GetHeapType() == RHIDescriptorHeapType::Sampler);
+
+    // The heap type enum starts with CbvSrvUav followed by Sampler.
+    m_HeapTypes[static_cast<size_t>(RHIDescriptorHeapType::CbvSrvUav)].ring = cbvSrvUavRing;
+    m_HeapTypes[static_cast<size_t>(RHIDescriptorHeapType::Sampler)].ring = samplerRing;
+    for (auto& state : m_HeapTypes) {
+        state.currentBlock = 0;
+        state.currentBlockOffset = 0;
+        state.hasBlock = false;
+        state.tableMask = 0;
+    }
+
+    SetRootSignatureLayout(nullptr, 0);
+}
+
+DynamicDescriptorHeap::~DynamicDescriptorHeap() {
+    Reset();
+}
+
+void DynamicDescriptorHeap::SetRootSignatureLayout(const DescriptorTableLayout* tables, uint32_t numTables) {
+    for (auto& table : m_Tables) {
+        table.type = RHIDescriptorHeapType::CbvSrvUav;
+        table.numDescriptors = 0;
+        table.firstStagedDescriptor = 0;
+    }
+    for (auto& state : m_HeapTypes) {
+        state.tableMask = 0;
+    }
+
+    uint32_t numStagedDescriptors = 0;
+    for (uint32_t i = 0; i < numTables; ++i) {
+        const DescriptorTableLayout& layout = tables[i];
+        assert(layout.rootParameterIndex < MaxRootParameters && "Root parameter index out of range.");
+        assert(static_cast<size_t>(layout.type) < NumHeapTypes && "Descriptor tables must be CBV/SRV/UAV or sampler tables.");
+
+        HeapTypeState& state = m_HeapTypes[static_cast<size_t>(layout.type)];
+        assert(state.ring && "There is no ring for the descriptor heap type of the table.");
+        assert(layout.numDescriptors <= state.ring->GetNumDescriptorsPerBlock() && "The descriptor table does not fit in a block.");
+
+        DescriptorTable& table = m_Tables[layout.rootParameterIndex];
+        table.type = layout.type;
+        table.numDescriptors = layout.numDescriptors;
+        table.firstStagedDescriptor = numStagedDescriptors;
+        numStagedDescriptors += layout.numDescriptors;
+
+        state.tableMask |= 1ull << layout.rootParameterIndex;
+    }
+
+    m_StagedDescriptors.assign(numStagedDescriptors, RHICPUDescriptorHandle{ 0 });
+    m_DirtyTableMask = 0;
+}
+
+void DynamicDescriptorHeap::StageDescriptors(uint32_t rootParameterIndex, uint32_t offset, uint32_t numDescriptors,
+    RHICPUDescriptorHandle srcDescriptor) {
+    assert(rootParameterIndex < MaxRootParameters && m_Tables[rootParameterIndex].numDescriptors > 0 &&
+        "The root parameter is not a descriptor table.");
+
+    const DescriptorTable& table = m_Tables[rootParameterIndex];
+    assert(offset + numDescriptors <= table.numDescriptors && "Descriptors out of the range of the table.");
+
+    const uint32_t descriptorSize = m_HeapTypes[static_cast<size_t>(table.type)].ring->GetDescriptorSize();
+    RHICPUDescriptorHandle* staged = m_StagedDescriptors.data() + table.firstStagedDescriptor + offset;
+    for (uint32_t i = 0; i < numDescriptors; ++i) {
+        staged[i].ptr = srcDescriptor.ptr + static_cast<size_t>(i) * descriptorSize;
+    }
+
+    m_DirtyTableMask |= 1ull << rootParameterIndex;
+}
+
+void DynamicDescriptorHeap::CommitStagedDescriptorsForDraw(RHICommandList* commandList) {
+    CommitStagedDescriptors(commandList, true);
+}
+
+void DynamicDescriptorHeap::CommitStagedDescriptorsForDispatch(RHICommandList* commandList) {
+    CommitStagedDescriptors(commandList, false);
+}
+
+void DynamicDescriptorHeap::CommitStagedDescriptors(RHICommandList* commandList, bool graphics) {
+    if (m_DirtyTableMask == 0) {
+        return;
+    }
+
+    BindDescriptorHeaps(commandList);
+
+    for (auto& state : m_HeapTypes) {
+        if ((m_DirtyTableMask & state.tableMask) != 0) {
+            CommitHeapType(state, commandList, graphics);
+        }
+    }
+
+    m_DirtyTableMask = 0;
+}
+
+void DynamicDescriptorHeap::BindDescriptorHeaps(RHICommandList* commandList) {
+    // Setting the heaps is expensive on some hardware, the ring heaps are bound once per command list.
+    if (m_DescriptorHeapsBound) {
+        return;
+    }
+
+    RHIDescriptorHeap* descriptorHeaps[NumHeapTypes];
+    uint32_t numDescriptorHeaps = 0;
+    for (const auto& state : m_HeapTypes) {
+        if (state.ring) {
+            descriptorHeaps[numDescriptorHeaps++] = state.ring->GetDescriptorHeap();
+        }
+    }
+    commandList->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
+    m_DescriptorHeapsBound = true;
+}
+
+void DynamicDescriptorHeap::CommitHeapType(HeapTypeState& state, RHICommandList* commandList, bool graphics) {
+    const uint32_t descriptorSize = state.ring->GetDescriptorSize();
+
+    m_DestRangeStarts.clear();
+    m_DestRangeSizes.clear();
+    m_SrcRangeStarts.clear();
+    m_SrcRangeSizes.clear();
+
+    uint64_t dirtyTables = m_DirtyTableMask & state.tableMask;
+    for (uint32_t rootParameterIndex = 0; dirtyTables != 0; ++rootParameterIndex, dirtyTables >>= 1) {
+        if ((dirtyTables & 1) == 0) {
+            continue;
+        }
+
+        const DescriptorTable& table = m_Tables[rootParameterIndex];
+
+        // Earlier draws may still read the previous copy of the table, the whole table moves to new space.
+        RHICPUDescriptorHandle destDescriptor;
+        RHIGPUDescriptorHandle gpuDescriptor = AllocateTable(state, table.numDescriptors, &destDescriptor);
+
+        // Runs of staged descriptors become one destination range, consecutive sources one source range.
+        const RHICPUDescriptorHandle* staged = m_StagedDescriptors.data() + table.firstStagedDescriptor;
+        bool extendDestRange = false;
+        for (uint32_t i = 0; i < table.numDescriptors; ++i) {
+            if (staged[i].ptr == 0) {
+                extendDestRange = false;
+                continue;
+            }
+
+            if (extendDestRange) {
+                ++m_DestRangeSizes.back();
+            } else {
+                m_DestRangeStarts.push_back(RHICPUDescriptorHandle{ destDescriptor.ptr + static_cast<size_t>(i) * descriptorSize });
+                m_DestRangeSizes.push_back(1);
+                extendDestRange = true;
+            }
+
+            if (!m_SrcRangeStarts.empty() &&
+                m_SrcRangeStarts.back().ptr + static_cast<size_t>(m_SrcRangeSizes.back()) * descriptorSize == staged[i].ptr) {
+                ++m_SrcRangeSizes.back();
+            } else {
+                m_SrcRangeStarts.push_back(staged[i]);
+                m_SrcRangeSizes.push_back(1);
+            }
+        }
+
+        if (graphics) {
+            commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, gpuDescriptor);
+        } else {
+            commandList->SetComputeRootDescriptorTable(rootParameterIndex, gpuDescriptor);
+        }
+    }
+
+    if (!m_DestRangeStarts.empty()) {
+        m_Device->CopyDescriptors(
+            static_cast<uint32_t>(m_DestRangeStarts.size()), m_DestRangeStarts.data(), m_DestRangeSizes.data(),
+            static_cast<uint32_t>(m_SrcRangeStarts.size()), m_SrcRangeStarts.data(), m_SrcRangeSizes.data(),
+            state.ring->GetHeapType());
+    }
+}
+
+RHIGPUDescriptorHandle DynamicDescriptorHeap::AllocateTable(HeapTypeState& state, uint32_t numDescriptors,
+    RHICPUDescriptorHandle* cpuDescriptor) {
+    if (!state.hasBlock || state.currentBlockOffset + numDescriptors > state.ring->GetNumDescriptorsPerBlock()) {
+        state.currentBlock = state.ring->AllocateBlock();
+        state.currentBlockOffset = 0;
+        state.hasBlock = true;
+        state.usedBlocks.push_back(state.currentBlock);
+    }
+
+    *cpuDescriptor = state.ring->GetCPUDescriptorHandle(state.currentBlock, state.currentBlockOffset);
+    RHIGPUDescriptorHandle gpuDescriptor = state.ring->GetGPUDescriptorHandle(state.currentBlock, state.currentBlockOffset);
+    state.currentBlockOffset += numDescriptors;
+
+    return gpuDescriptor;
+}
+
+void DynamicDescriptorHeap::Reset() {
+    for (auto& state : m_HeapTypes) {
+        for (uint32_t block : state.usedBlocks) {
+            state.ring->ReleaseBlock(block);
+        }
+        state.usedBlocks.clear();
+        state.currentBlock = 0;
+        state.currentBlockOffset = 0;
+        state.hasBlock = false;
+    }
+
+    SetRootSignatureLayout(nullptr, 0);
+    m_DescriptorHeapsBound = false;
+}
@@ -0,0 +1,87 @@
+#include "framepacer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+FramePacer::FramePacer(std::shared_ptr<CommandQueue> commandQueue, uint32_t numFramesInFlight)
+    : m_CommandQueue(commandQueue)
+    , m_FrameNumber(0)
+    , m_InFrame(false)
+    , m_LastWaitSeconds(0.0) {
+    SetNumFramesInFlight(numFramesInFlight);
+}
+
+uint32_t FramePacer::ClampFramesInFlight(uint32_t numFramesInFlight) {
+    if (numFramesInFlight < 1) {
+        return 1;
+    }
+    if (numFramesInFlight > MaxFramesInFlight) {
+        return MaxFramesInFlight;
+    }
+    return numFramesInFlight;
+}
+
+void FramePacer::SetNumFramesInFlight(uint32_t numFramesInFlight) {
+    assert(!m_InFrame && "Can't change the number of frames in flight during a frame.");
+
+    numFramesInFlight = ClampFramesInFlight(numFramesInFlight);
+
+    WaitForIdle();
+
+    // All previous frames are done, the contexts start out free.
+    m_FrameContexts.assign(numFramesInFlight, FrameContext{ 0, 0 });
+}
+
+uint32_t FramePacer::GetNumFramesInFlight() const {
+    return static_cast<uint32_t>(m_FrameContexts.size());
+}
+
+void FramePacer::BeginFrame() {
+    assert(!m_InFrame && "EndFrame was not called for the previous frame.");
+
+    ++m_FrameNumber;
+    m_InFrame = true;
+
+    FrameContext& frameContext = m_FrameContexts[GetFrameIndex()];
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    m_CommandQueue->WaitForFenceValue(frameContext.FenceValue);
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    m_LastWaitSeconds = std::chrono::duration<double>(t1 - t0).count();
+
+    frameContext.FrameNumber = m_FrameNumber;
+}
+
+void FramePacer::EndFrame(uint64_t fenceValue) {
+    assert(m_InFrame && "BeginFrame was not called.");
+
+    m_FrameContexts[GetFrameIndex()].FenceValue = fenceValue;
+    m_InFrame = false;
+}
+
+void FramePacer::WaitForIdle() {
+    uint64_t fenceValue = 0;
+    for (const auto& frameContext : m_FrameContexts) {
+        fenceValue = std::max(fenceValue, frameContext.FenceValue);
+    }
+
+    m_CommandQueue->WaitForFenceValue(fenceValue);
+}
+
+uint64_t FramePacer::GetFrameNumber() const {
+    return m_FrameNumber;
+}
+
+uint32_t FramePacer::GetFrameIndex() const {
+    return static_cast<uint32_t>(m_FrameNumber % m_FrameContexts.size());
+}
+
+const FramePacer::FrameContext& FramePacer::GetFrameContext() const {
+    return m_FrameContexts[GetFrameIndex()];
+}
+
+double FramePacer::GetLastWaitSeconds() const {
+    return m_LastWaitSeconds;
+}
@@ -0,0 +1,106 @@
+#include "framepipeline.h"
+
+#include "profiler.h"
+
+#include <cassert>
+
+const uint32_t FramePipeline::NumSnapshots;
+
+FramePipeline::FramePipeline(RenderFunction render, const std::string& threadName)
+    : m_Render(std::move(render))
+    , m_WriteIndex(0)
+    , m_RenderIndex(0)
+    , m_Busy(false)
+    , m_Stop(false)
+    , m_NumFramesRendered(0) {
+    assert(m_Render && "The frame pipeline needs a render function.");
+
+    m_Thread = std::thread(&FramePipeline::RenderThread, this, threadName);
+}
+
+FramePipeline::~FramePipeline() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+
+    // The submitted frame is rendered before the thread returns.
+    m_Thread.join();
+}
+
+uint32_t FramePipeline::GetWriteIndex() const {
+    return m_WriteIndex;
+}
+
+void FramePipeline::Submit() {
+    PROFILE_FUNCTION();
+
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        // The previous frame reads the other snapshot, the one after this frame is written to it.
+        m_Condition.wait(lock, [this]() { return !m_Busy; });
+        RethrowRenderException();
+
+        m_RenderIndex = m_WriteIndex;
+        m_Busy = true;
+    }
+    m_Condition.notify_all();
+
+    m_WriteIndex = (m_WriteIndex + 1) % NumSnapshots;
+}
+
+void FramePipeline::WaitForIdle() {
+    PROFILE_FUNCTION();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Condition.wait(lock, [this]() { return !m_Busy; });
+    RethrowRenderException();
+}
+
+uint64_t FramePipeline::GetNumFramesRendered() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_NumFramesRendered;
+}
+
+void FramePipeline::RenderThread(const std::string& threadName) {
+    Profiler::SetThreadName(threadName);
+
+    for (;;) {
+        uint32_t snapshotIndex;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_Busy || m_Stop; });
+            if (!m_Busy) {
+                return;
+            }
+            snapshotIndex = m_RenderIndex;
+        }
+
+        // The frames after a failed one are still rendered, the simulation thread decides what to do.
+        std::exception_ptr exception;
+        try {
+            m_Render(snapshotIndex);
+        } catch (...) {
+            exception = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (exception && !m_RenderException) {
+                m_RenderException = exception;
+            }
+            m_Busy = false;
+            ++m_NumFramesRendered;
+        }
+        m_Condition.notify_all();
+    }
+}
+
+void FramePipeline::RethrowRenderException() {
+    if (m_RenderException) {
+        std::exception_ptr exception = m_RenderException;
+        m_RenderException = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
@@ -0,0 +1,173 @@
+#include "framestats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+
+FrameStats::FrameStats(size_t windowSize)
+    : m_Frames(windowSize)
+    , m_NumFrames(0)
+    , m_NextFrame(0)
+    , m_FrameTimeHistogram(NumBuckets, 0) {
+    assert(windowSize > 0 && "The window must hold at least one frame.");
+}
+
+FrameStats::~FrameStats() {
+    EndCsvCapture();
+}
+
+size_t FrameStats::GetBucket(double frameTimeMs) {
+    if (!(frameTimeMs > 0.0)) {
+        return 0;
+    }
+
+    size_t bucket = static_cast<size_t>(frameTimeMs / BucketWidthMs);
+    return bucket < NumBuckets ? bucket : NumBuckets - 1;
+}
+
+void FrameStats::AddFrame(const FrameRecord& frame) {
+    // The oldest frame leaves the window.
+    if (m_NumFrames == m_Frames.size()) {
+        --m_FrameTimeHistogram[GetBucket(m_Frames[m_NextFrame].frameTimeMs)];
+    } else {
+        ++m_NumFrames;
+    }
+
+    m_Frames[m_NextFrame] = frame;
+    ++m_FrameTimeHistogram[GetBucket(frame.frameTimeMs)];
+    m_NextFrame = (m_NextFrame + 1) % m_Frames.size();
+
+    if (m_CsvFile.is_open()) {
+        m_CsvFile << frame.frameNumber << ','
+            << frame.frameTimeMs << ','
+            << frame.cpuWaitMs << ','
+            << frame.presentIntervalMs << '\n';
+    }
+}
+
+void FrameStats::Reset() {
+    m_NumFrames = 0;
+    m_NextFrame = 0;
+    std::fill(m_FrameTimeHistogram.begin(), m_FrameTimeHistogram.end(), 0);
+}
+
+size_t FrameStats::GetWindowSize() const {
+    return m_Frames.size();
+}
+
+size_t FrameStats::GetNumFrames() const {
+    return m_NumFrames;
+}
+
+double FrameStats::GetFrameTimePercentileMs(double percentile) const {
+    if (m_NumFrames == 0) {
+        return 0.0;
+    }
+
+    // The rank of the frame at the percentile, 1 based.
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile * m_NumFrames));
+    rank = std::min<uint64_t>(std::max<uint64_t>(rank, 1), m_NumFrames);
+
+    uint64_t count = 0;
+    for (size_t bucket = 0; bucket < NumBuckets - 1; ++bucket) {
+        count += m_FrameTimeHistogram[bucket];
+        if (count >= rank) {
+            return (bucket + 1) * BucketWidthMs;
+        }
+    }
+
+    return GetOverflowFrameTimeMs(static_cast<size_t>(rank - count - 1));
+}
+
+double FrameStats::GetOverflowFrameTimeMs(size_t index) const {
+    // The last bucket has no upper edge, select among its frames exactly. They are rare, hitches and loading.
+    std::vector<double> frameTimesMs;
+    frameTimesMs.reserve(m_FrameTimeHistogram[NumBuckets - 1]);
+    for (size_t i = 0; i < m_NumFrames; ++i) {
+        if (GetBucket(m_Frames[i].frameTimeMs) == NumBuckets - 1) {
+            frameTimesMs.push_back(m_Frames[i].frameTimeMs);
+        }
+    }
+    assert(index < frameTimesMs.size() && "The histogram is out of sync with the window.");
+
+    std::nth_element(frameTimesMs.begin(), frameTimesMs.begin() + index, frameTimesMs.end());
+    return frameTimesMs[index];
+}
+
+FrameStats::Summary FrameStats::GetSummary() const {
+    Summary summary = {};
+    summary.numFrames = m_NumFrames;
+    if (m_NumFrames == 0) {
+        return summary;
+    }
+
+    double totalFrameTimeMs = 0.0;
+    double totalCpuWaitMs = 0.0;
+    double totalPresentIntervalMs = 0.0;
+    for (size_t i = 0; i < m_NumFrames; ++i) {
+        const FrameRecord& frame = m_Frames[i];
+        totalFrameTimeMs += frame.frameTimeMs;
+        totalCpuWaitMs += frame.cpuWaitMs;
+        totalPresentIntervalMs += frame.presentIntervalMs;
+        summary.maxFrameTimeMs = std::max(summary.maxFrameTimeMs, frame.frameTimeMs);
+        summary.maxCpuWaitMs = std::max(summary.maxCpuWaitMs, frame.cpuWaitMs);
+    }
+
+    summary.meanFrameTimeMs = totalFrameTimeMs / m_NumFrames;
+    summary.meanCpuWaitMs = totalCpuWaitMs / m_NumFrames;
+    summary.meanPresentIntervalMs = totalPresentIntervalMs / m_NumFrames;
+
+    double presentVariance = 0.0;
+    for (size_t i = 0; i < m_NumFrames; ++i) {
+        double deviation = m_Frames[i].presentIntervalMs - summary.meanPresentIntervalMs;
+        presentVariance += deviation * deviation;
+    }
+    summary.presentJitterMs = std::sqrt(presentVariance / m_NumFrames);
+
+    // The percentiles never exceed the maximum, which is exact.
+    summary.p50FrameTimeMs = std::min(GetFrameTimePercentileMs(0.50), summary.maxFrameTimeMs);
+    summary.p95FrameTimeMs = std::min(GetFrameTimePercentileMs(0.95), summary.maxFrameTimeMs);
+    summary.p99FrameTimeMs = std::min(GetFrameTimePercentileMs(0.99), summary.maxFrameTimeMs);
+
+    return summary;
+}
+
+void FrameStats::WriteSummary(std::ostream& stream) const {
+    Summary summary = GetSummary();
+
+    stream << std::fixed << std::setprecision(2)
+        << "Frame ms p50 " << summary.p50FrameTimeMs
+        << " p95 " << summary.p95FrameTimeMs
+        << " p99 " << summary.p99FrameTimeMs
+        << " max " << summary.maxFrameTimeMs
+        << " | CPU wait ms avg " << summary.meanCpuWaitMs
+        << " max " << summary.maxCpuWaitMs
+        << " | Present ms avg " << summary.meanPresentIntervalMs
+        << " jitter " << summary.presentJitterMs
+        << " | " << summary.numFrames << " frames"
+        << std::defaultfloat << "\n";
+}
+
+bool FrameStats::BeginCsvCapture(const std::string& fileName) {
+    EndCsvCapture();
+
+    m_CsvFile.open(fileName, std::ios::out | std::ios::trunc);
+    if (!m_CsvFile) {
+        m_CsvFile.close();
+        return false;
+    }
+
+    m_CsvFile << "frame,frame_ms,cpu_wait_ms,present_interval_ms\n";
+    return true;
+}
+
+void FrameStats::EndCsvCapture() {
+    if (m_CsvFile.is_open()) {
+        m_CsvFile.close();
+    }
+}
+
+bool FrameStats::IsCsvCaptureActive() const {
+    return m_CsvFile.is_open();
+}
@@ -1,8 +1,20 @@
 #include "game.h"
 
 #include "Application.h"
+#include "assetloader.h"
+#include "bindlessdescriptortable.h"
 #include "CommandQueue.h"
+#include "dynamicdescriptorheap.h"
+#include "gpuprofiler.h"
 #include "Helpers.h"
+#include "jobsystem.h"
+#include "lodselection.h"
+#include "meshinputlayout.h"
+#include "parallelcommandrecorder.h"
+#include "profiler.h"
+#include "resourcestatetracker.h"
+#include "rhid3d12.h"
+#include "vertexquantization.h"
 #include "Window.h"
 
 #include <wrl.h>
@@ -12,6 +24,9 @@ using namespace Microsoft::WRL;
 #include <d3dcompiler.h>
 
 #include <algorithm> // For std::min and std::max.
+#include <cstring>   // For std::memcpy.
+#include <sstream>   // For std::ostringstream.
+#include <stdexcept> // For std::runtime_error.
 
 using namespace DirectX;
 
@@ -22,129 +37,70 @@ constexpr const T& clamp(const T& val, const T& min, const T& max) {
     return val < min ? min : val > max ? max : val;
 }
 
-// Vertex data for a colored cube.
-struct VertexPosColor {
-    XMFLOAT3 Position;
-    XMFLOAT3 Color;
-};
-
-static VertexPosColor g_Vertices[8] = {
-    { XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) }, // 0
-{ XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) }, // 1
-{ XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 0.0f) }, // 2
-{ XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) }, // 3
-{ XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) }, // 4
-{ XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 1.0f) }, // 5
-{ XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) }, // 6
-{ XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 1.0f) }  // 7
-};
-
-static WORD g_Indicies[36] =
-{
-    0, 1, 2, 0, 2, 3,
-    4, 6, 5, 4, 7, 6,
-    4, 5, 1, 4, 1, 0,
-    3, 2, 6, 3, 6, 7,
-    1, 5, 6, 1, 6, 2,
-    4, 0, 3, 4, 3, 7
-};
-
-Game::Game(const std::wstring& name, int width, int height, bool vSync)
-    : super(name, width, height, vSync)
+// The frustum planes of a view projection matrix, normalized and pointing inwards.
+static void ExtractFrustumPlanes(const XMMATRIX& viewProjection, XMFLOAT4* planes) {
+    // Points are row vectors, the clip space coordinates are the dot products with the columns.
+    const XMMATRIX columns = XMMatrixTranspose(viewProjection);
+    const XMVECTOR frustumPlanes[6] = {
+        XMVectorAdd(columns.r[3], columns.r[0]),        // Left
+        XMVectorSubtract(columns.r[3], columns.r[0]),   // Right
+        XMVectorAdd(columns.r[3], columns.r[1]),        // Bottom
+        XMVectorSubtract(columns.r[3], columns.r[1]),   // Top
+        columns.r[2],                                   // Near, depth starts at 0
+        XMVectorSubtract(columns.r[3], columns.r[2])    // Far
+    };
+    for (int i = 0; i < 6; ++i) {
+        XMStoreFloat4(&planes[i], XMPlaneNormalize(frustumPlanes[i]));
+    }
+}
+
+Game::Game(const std::wstring& name, int width, int height, bool vSync, uint32_t framesInFlight)
+    : super(name, width, height, vSync, framesInFlight)
+    , m_NumVertexBuffers(0)
+    , m_PositionDequantization(XMMatrixIdentity())
+    , m_LodSelection(true)
+    , m_ParallelRecording(true)
+    , m_VertexFetchConstants{ BindlessDescriptorTable::InvalidIndex, 0, 0, 0 }
+    , m_BindlessMode(false)
+    , m_MeshletConstants()
+    , m_MeshletMode(false)
     , m_ScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX))
     , m_Viewport(CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)))
     , m_FoV(45.0)
+    , m_Snapshots()
+    , m_StatsReportTime(0.0)
     , m_ContentLoaded(false) {
 }
 
-void Game::UpdateBufferResource(
-    ComPtr<ID3D12GraphicsCommandList2> commandList,
-    ID3D12Resource** pDestinationResource,
-    ID3D12Resource** pIntermediateResource,
-    size_t numElements, size_t elementSize, const void* bufferData,
-    D3D12_RESOURCE_FLAGS flags) {
+bool Game::LoadContent() {
     auto device = Application::Get().GetDevice();
-
-    size_t bufferSize = numElements * elementSize;
-
-    // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(pDestinationResource)));
-
-    // Create an committed resource for the upload.
-    if (bufferData) {
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(pIntermediateResource)));
-
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData = bufferData;
-        subresourceData.RowPitch = bufferSize;
-        subresourceData.SlicePitch = subresourceData.RowPitch;
-
-        UpdateSubresources(commandList.Get(),
-            *pDestinationResource, *pIntermediateResource,
-            0, 0, 1, &subresourceData);
+    auto& assetLoader = *Application::Get().GetAssetLoader();
+
+    // Everything is read and uploaded in the background, FinishLoadContent
+    // creates the views and pipelines once it has arrived.
+    m_MeshRequest = assetLoader.LoadMesh("cube.mesh");
+    m_VertexShaderRequest = assetLoader.LoadFile("vs_simple.cso");
+    m_BindlessVertexShaderRequest = assetLoader.LoadFile("vs_bindless.cso");
+    m_PixelShaderRequest = assetLoader.LoadFile("ps_simple.cso");
+
+    // Meshlets are drawn with mesh shaders where the hardware supports them.
+    D3D12_FEATURE_DATA_D3D12_OPTIONS7 options7 = {};
+    if (SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &options7, sizeof(options7))) &&
+        options7.MeshShaderTier != D3D12_MESH_SHADER_TIER_NOT_SUPPORTED) {
+        m_AmplificationShaderRequest = assetLoader.LoadFile("as_meshlet.cso");
+        m_MeshShaderRequest = assetLoader.LoadFile("ms_meshlet.cso");
     }
-}
 
+    // Allocate the depth-stencil view.
+    m_DSV = Application::Get().AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
-bool Game::LoadContent() {
-    auto device = Application::Get().GetDevice();
-    auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-    auto commandList = commandQueue->GetCommandList();
-
-    // Upload vertex buffer data.
-    ComPtr<ID3D12Resource> intermediateVertexBuffer;
-    UpdateBufferResource(commandList,
-        &m_VertexBuffer, &intermediateVertexBuffer,
-        _countof(g_Vertices), sizeof(VertexPosColor), g_Vertices);
-
-    // Create the vertex buffer view.
-    m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
-    m_VertexBufferView.SizeInBytes = sizeof(g_Vertices);
-    m_VertexBufferView.StrideInBytes = sizeof(VertexPosColor);
-
-    // Upload index buffer data.
-    ComPtr<ID3D12Resource> intermediateIndexBuffer;
-    UpdateBufferResource(commandList,
-        &m_IndexBuffer, &intermediateIndexBuffer,
-        _countof(g_Indicies), sizeof(WORD), g_Indicies);
+    m_RenderGraph = std::make_shared<RenderGraph>(Application::Get().GetRHIDevice(),
+        Application::Get().GetDeferredReleaseQueue());
 
-    // Create index buffer view.
-    m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
-    m_IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-    m_IndexBufferView.SizeInBytes = sizeof(g_Indicies);
-
-    // Create the descriptor heap for the depth-stencil view.
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-    dsvHeapDesc.NumDescriptors = 1;
-    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    ThrowIfFailed(device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_DSVHeap)));
-
-    // Load the vertex shader.
-    ComPtr<ID3DBlob> vertexShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"vs_simple.cso", &vertexShaderBlob));
-
-    // Load the pixel shader.
-    ComPtr<ID3DBlob> pixelShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"ps_simple.cso", &pixelShaderBlob));
-
-    // Create the vertex input layout
-    D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    };
+    // Every command list of the frame binds its descriptor tables through a dynamic descriptor heap of its own.
+    m_CommandRecorder = std::make_shared<ParallelCommandRecorder>(
+        Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT), Application::Get().GetJobSystem(),
+        []() { return Application::Get().CreateDynamicDescriptorHeap(); });
 
     // Create a root signature.
     D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
@@ -154,16 +110,26 @@ bool Game::LoadContent() {
     }
 
     // Allow input layout and deny unnecessary access to certain pipeline stages.
+    // Pixel shaders keep access for bindless textures.
     D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
         D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
         D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
-        D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
-
-    // A single 32-bit constant root parameter that is used by the vertex shader.
-    CD3DX12_ROOT_PARAMETER1 rootParameters[1];
-    rootParameters[0].InitAsConstants(sizeof(XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    // The bindless table, unbounded ranges of buffers in space1 and textures in space2 that
+    // both start at the beginning of the table. Registering resources changes descriptors
+    // in the table while it is bound, so they are volatile. Needs resource binding tier 2.
+    CD3DX12_DESCRIPTOR_RANGE1 bindlessRanges[2];
+    bindlessRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE, 0);
+    bindlessRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE, 0);
+
+    // The MVP matrix and the vertex fetch constants as root constants, followed by the bindless table and
+    // the constant buffer of the meshlet pipeline. Mesh shaders read the root constants too.
+    CD3DX12_ROOT_PARAMETER1 rootParameters[3];
+    rootParameters[0].InitAsConstants((sizeof(XMMATRIX) + sizeof(VertexFetchConstants)) / 4, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[1].InitAsDescriptorTable(_countof(bindlessRanges), bindlessRanges, D3D12_SHADER_VISIBILITY_ALL);
+    rootParameters[2].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
 
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
     rootSignatureDescription.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, rootSignatureFlags);
@@ -176,6 +142,139 @@ bool Game::LoadContent() {
     // Create the root signature.
     ThrowIfFailed(device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(),
         rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&m_RootSignature)));
+    m_RHIRootSignature = std::make_shared<D3D12RHIRootSignature>(m_RootSignature);
+
+    return true;
+}
+
+bool Game::FinishLoadContent() {
+    PROFILE_FUNCTION();
+
+    const std::shared_ptr<AssetRequest> requests[] = {
+        m_MeshRequest, m_VertexShaderRequest, m_BindlessVertexShaderRequest, m_PixelShaderRequest,
+        m_AmplificationShaderRequest, m_MeshShaderRequest
+    };
+    for (const auto& request : requests) {
+        if (!request) {
+            // Optional requests that were not made.
+            continue;
+        }
+        if (request->GetState() == AssetRequest::State::Failed) {
+            throw std::runtime_error("Failed to load " + request->GetPath());
+        }
+        if (!request->IsReady()) {
+            return false;
+        }
+    }
+
+    auto device = Application::Get().GetDevice();
+
+    // The copy queue has finished the upload, the buffer can be used right away.
+    // It holds the data section of the mesh file, the streams and indices are addressed by offset.
+    const MeshFile& mesh = m_MeshRequest->GetMesh();
+    const MeshFileHeader& header = mesh.GetHeader();
+    m_MeshBuffer = m_MeshRequest->TakeBuffer();
+
+    // The input assembler reads any layout. The bindless pipeline reads the position at the
+    // start of the first stream and the color after it, both as floats or packed.
+    const MeshFileStream& stream = header.Streams[0];
+    if (stream.NumAttributes < 2 ||
+        stream.Attributes[0].Semantic != MeshSemantic::Position || stream.Attributes[0].Offset != 0 ||
+        stream.Attributes[1].Semantic != MeshSemantic::Color) {
+        throw std::runtime_error("Unsupported vertex layout in " + m_MeshRequest->GetPath());
+    }
+
+    m_VertexFetchConstants.VertexStride = stream.Stride;
+    m_VertexFetchConstants.ColorOffset = stream.Attributes[1].Offset;
+    m_VertexFetchConstants.VertexFlags = 0;
+    if (stream.Attributes[0].Format == MeshAttributeFormat::R16G16B16A16_UNorm) {
+        m_VertexFetchConstants.VertexFlags |= VertexFlag_PackedPosition;
+    }
+    if (stream.Attributes[1].Format == MeshAttributeFormat::R8G8B8A8_UNorm) {
+        m_VertexFetchConstants.VertexFlags |= VertexFlag_PackedColor;
+    }
+
+    // Packed positions are decoded to [0, 1] by both pipelines, the scale and offset are applied with the MVP matrix.
+    float positionScale[3];
+    float positionOffset[3];
+    GetPositionDequantization(stream.Attributes[0].Format, header.Bounds, positionScale, positionOffset);
+    m_PositionDequantization = XMMatrixMultiply(
+        XMMatrixScaling(positionScale[0], positionScale[1], positionScale[2]),
+        XMMatrixTranslation(positionOffset[0], positionOffset[1], positionOffset[2]));
+
+    // Create the vertex buffer views.
+    m_NumVertexBuffers = header.NumStreams;
+    for (uint32_t i = 0; i < header.NumStreams; ++i) {
+        m_VertexBufferViews[i].BufferLocation = m_MeshBuffer.GetGPUVirtualAddress() + header.Streams[i].Offset;
+        m_VertexBufferViews[i].SizeInBytes = header.Streams[i].Stride * header.NumVertices;
+        m_VertexBufferViews[i].StrideInBytes = header.Streams[i].Stride;
+    }
+    const uint32_t vertexBufferSize = m_VertexBufferViews[0].SizeInBytes;
+
+    // Register a raw view of the vertex buffer for the bindless pipeline.
+    {
+        DescriptorAllocation vertexBufferSRV = Application::Get().AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        // The vertex buffer may be packed into a larger buffer, raw views address it in 32-bit elements.
+        srvDesc.Buffer.FirstElement = (m_MeshBuffer.GetOffset() + stream.Offset) / 4;
+        srvDesc.Buffer.NumElements = vertexBufferSize / 4;
+        srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+        device->CreateShaderResourceView(GetD3D12Resource(m_MeshBuffer.GetResource()).Get(), &srvDesc,
+            D3D12_CPU_DESCRIPTOR_HANDLE{ vertexBufferSRV.GetDescriptorHandle().ptr });
+
+        // The table keeps a copy, the CPU descriptor is not needed anymore.
+        m_VertexFetchConstants.VertexBufferIndex =
+            Application::Get().GetBindlessDescriptorTable()->Register(vertexBufferSRV.GetDescriptorHandle());
+    }
+
+    // Register a raw view of the whole data section for the meshlet pipeline, which reads the
+    // meshlets and the vertices from it. It ends with the meshlet triangles, a multiple of 4 bytes.
+    if (m_MeshShaderRequest && header.NumMeshlets > 0) {
+        DescriptorAllocation meshBufferSRV = Application::Get().AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.FirstElement = m_MeshBuffer.GetOffset() / 4;
+        srvDesc.Buffer.NumElements = static_cast<UINT>(header.DataSize / 4);
+        srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+        device->CreateShaderResourceView(GetD3D12Resource(m_MeshBuffer.GetResource()).Get(), &srvDesc,
+            D3D12_CPU_DESCRIPTOR_HANDLE{ meshBufferSRV.GetDescriptorHandle().ptr });
+
+        m_MeshletConstants.MeshBufferIndex =
+            Application::Get().GetBindlessDescriptorTable()->Register(meshBufferSRV.GetDescriptorHandle());
+        m_MeshletConstants.VertexOffset = static_cast<uint32_t>(stream.Offset);
+        m_MeshletConstants.MeshletOffset = static_cast<uint32_t>(header.MeshletOffset);
+        m_MeshletConstants.MeshletVertexOffset = static_cast<uint32_t>(header.MeshletVertexOffset);
+        m_MeshletConstants.MeshletTriangleOffset = static_cast<uint32_t>(header.MeshletTriangleOffset);
+    }
+
+    // Create index buffer view.
+    m_IndexBufferView.BufferLocation = m_MeshBuffer.GetGPUVirtualAddress() + header.IndexOffset;
+    m_IndexBufferView.Format = header.IndexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    m_IndexBufferView.SizeInBytes = header.IndexSize * header.NumIndices;
+
+    m_Submeshes.clear();
+    for (uint32_t i = 0; i < header.NumSubmeshes; ++i) {
+        m_Submeshes.push_back(mesh.GetSubmesh(i));
+    }
+    m_Lods.clear();
+    for (uint32_t i = 0; i < header.NumLods; ++i) {
+        m_Lods.push_back(mesh.GetLod(i));
+    }
+    m_SelectedLods.assign(m_Submeshes.size(), 0);
+
+    const std::vector<uint8_t>& vertexShader = m_VertexShaderRequest->GetData();
+    const std::vector<uint8_t>& bindlessVertexShader = m_BindlessVertexShaderRequest->GetData();
+    const std::vector<uint8_t>& pixelShader = m_PixelShaderRequest->GetData();
+
+    // Create the vertex input layout from the attributes of the mesh.
+    const std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout = CreateMeshInputLayout(header);
 
     struct PipelineStateStream {
         CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
@@ -192,10 +291,10 @@ bool Game::LoadContent() {
     rtvFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 
     pipelineStateStream.pRootSignature = m_RootSignature.Get();
-    pipelineStateStream.InputLayout = { inputLayout, _countof(inputLayout) };
+    pipelineStateStream.InputLayout = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
     pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
+    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShader.data(), vertexShader.size());
+    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShader.data(), pixelShader.size());
     pipelineStateStream.DSVFormat = DXGI_FORMAT_D32_FLOAT;
     pipelineStateStream.RTVFormats = rtvFormats;
 
@@ -204,53 +303,64 @@ bool Game::LoadContent() {
     };
     ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
 
-    auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-    commandQueue->WaitForFenceValue(fenceValue);
+    // The bindless pipeline reads the vertices in the vertex shader, there is no input layout.
+    pipelineStateStream.InputLayout = { nullptr, 0 };
+    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(bindlessVertexShader.data(), bindlessVertexShader.size());
+    ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_BindlessPipelineState)));
+
+    if (m_MeshShaderRequest && header.NumMeshlets > 0) {
+        const std::vector<uint8_t>& amplificationShader = m_AmplificationShaderRequest->GetData();
+        const std::vector<uint8_t>& meshShader = m_MeshShaderRequest->GetData();
+
+        // The d3dx12.h in external predates mesh shaders.
+        using PipelineStateStreamAS = CD3DX12_PIPELINE_STATE_STREAM_SUBOBJECT<D3D12_SHADER_BYTECODE, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS>;
+        using PipelineStateStreamMS = CD3DX12_PIPELINE_STATE_STREAM_SUBOBJECT<D3D12_SHADER_BYTECODE, D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS>;
+
+        struct MeshletPipelineStateStream {
+            CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+            PipelineStateStreamAS AS;
+            PipelineStateStreamMS MS;
+            CD3DX12_PIPELINE_STATE_STREAM_PS PS;
+            CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
+            CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+        } meshletPipelineStateStream;
+
+        meshletPipelineStateStream.pRootSignature = m_RootSignature.Get();
+        meshletPipelineStateStream.AS = CD3DX12_SHADER_BYTECODE(amplificationShader.data(), amplificationShader.size());
+        meshletPipelineStateStream.MS = CD3DX12_SHADER_BYTECODE(meshShader.data(), meshShader.size());
+        meshletPipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShader.data(), pixelShader.size());
+        meshletPipelineStateStream.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+        meshletPipelineStateStream.RTVFormats = rtvFormats;
+
+        D3D12_PIPELINE_STATE_STREAM_DESC meshletPipelineStateStreamDesc = {
+            sizeof(MeshletPipelineStateStream), &meshletPipelineStateStream
+        };
+        ThrowIfFailed(device->CreatePipelineState(&meshletPipelineStateStreamDesc, IID_PPV_ARGS(&m_MeshletPipelineState)));
+    }
 
-    m_ContentLoaded = true;
+    // Unmaps the mesh file.
+    m_MeshRequest.reset();
+    m_VertexShaderRequest.reset();
+    m_BindlessVertexShaderRequest.reset();
+    m_PixelShaderRequest.reset();
+    m_AmplificationShaderRequest.reset();
+    m_MeshShaderRequest.reset();
 
-    // Resize/Create the depth buffer.
-    ResizeDepthBuffer(GetClientWidth(), GetClientHeight());
+    m_ContentLoaded = true;
 
     return true;
 }
 
-void Game::ResizeDepthBuffer(int width, int height) {
-    if (m_ContentLoaded) {
-        // Flush any GPU commands that might be referencing the depth buffer.
-        Application::Get().Flush();
-
-        width = std::max(1, width);
-        height = std::max(1, height);
-
-        auto device = Application::Get().GetDevice();
-
-        // Resize screen dependent resources.
-        // Create a depth buffer.
-        D3D12_CLEAR_VALUE optimizedClearValue = {};
-        optimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-        optimizedClearValue.DepthStencil = { 1.0f, 0 };
-
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height,
-                1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
-            D3D12_RESOURCE_STATE_DEPTH_WRITE,
-            &optimizedClearValue,
-            IID_PPV_ARGS(&m_DepthBuffer)
-        ));
-
-        // Update the depth-stencil view.
-        D3D12_DEPTH_STENCIL_VIEW_DESC dsv = {};
-        dsv.Format = DXGI_FORMAT_D32_FLOAT;
-        dsv.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-        dsv.Texture2D.MipSlice = 0;
-        dsv.Flags = D3D12_DSV_FLAG_NONE;
-
-        device->CreateDepthStencilView(m_DepthBuffer.Get(), &dsv,
-            m_DSVHeap->GetCPUDescriptorHandleForHeapStart());
-    }
+void Game::UpdateDepthStencilView(RHIResource* depthBuffer) {
+    // The view is copied when it is recorded, frames in flight are not affected.
+    D3D12_DEPTH_STENCIL_VIEW_DESC dsv = {};
+    dsv.Format = DXGI_FORMAT_D32_FLOAT;
+    dsv.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+    dsv.Texture2D.MipSlice = 0;
+    dsv.Flags = D3D12_DSV_FLAG_NONE;
+
+    Application::Get().GetDevice()->CreateDepthStencilView(GetD3D12Resource(depthBuffer).Get(), &dsv,
+        D3D12_CPU_DESCRIPTOR_HANDLE{ m_DSV.GetDescriptorHandle().ptr });
 }
 
 void Game::OnResize(ResizeEventArgs& e) {
@@ -259,33 +369,50 @@ void Game::OnResize(ResizeEventArgs& e) {
 
         m_Viewport = CD3DX12_VIEWPORT(0.0f, 0.0f,
             static_cast<float>(e.Width), static_cast<float>(e.Height));
-
-        ResizeDepthBuffer(e.Width, e.Height);
     }
 }
 
 void Game::UnloadContent() {
     m_ContentLoaded = false;
-}
 
-void Game::OnUpdate(UpdateEventArgs& e) {
-    static uint64_t frameCount = 0;
-    static double totalTime = 0.0;
+    // Requests that are still in flight free their buffers when the loader completes them.
+    m_MeshRequest.reset();
+    m_VertexShaderRequest.reset();
+    m_BindlessVertexShaderRequest.reset();
+    m_PixelShaderRequest.reset();
+    m_AmplificationShaderRequest.reset();
+    m_MeshShaderRequest.reset();
+
+    if (m_VertexFetchConstants.VertexBufferIndex != BindlessDescriptorTable::InvalidIndex) {
+        Application::Get().GetBindlessDescriptorTable()->Unregister(m_VertexFetchConstants.VertexBufferIndex);
+        m_VertexFetchConstants.VertexBufferIndex = BindlessDescriptorTable::InvalidIndex;
+    }
+    if (m_MeshletPipelineState) {
+        Application::Get().GetBindlessDescriptorTable()->Unregister(m_MeshletConstants.MeshBufferIndex);
+        m_MeshletPipelineState.Reset();
+        m_MeshletMode = false;
+    }
 
-    super::OnUpdate(e);
+    m_MeshBuffer.Free();
+    m_Submeshes.clear();
+    m_Lods.clear();
+    m_SelectedLods.clear();
+    for (FrameSnapshot& snapshot : m_Snapshots) {
+        snapshot.SelectedLods.clear();
+        snapshot.ContentLoaded = false;
+    }
 
-    totalTime += e.ElapsedTime;
-    frameCount++;
+    // Frames in flight may still use the transient resources, they are released once they are done.
+    m_RenderGraph.reset();
 
-    if (totalTime > 1.0) {
-        double fps = frameCount / totalTime;
+    m_CommandRecorder.reset();
+}
 
-        char buffer[512];
-        sprintf_s(buffer, "FPS: %f\n", fps);
-        OutputDebugStringA(buffer);
+void Game::OnUpdate(UpdateEventArgs& e) {
+    super::OnUpdate(e);
 
-        frameCount = 0;
-        totalTime = 0.0;
+    if (!m_ContentLoaded && m_MeshRequest) {
+        FinishLoadContent();
     }
 
     // Update the model matrix.
@@ -302,17 +429,64 @@ void Game::OnUpdate(UpdateEventArgs& e) {
     // Update the projection matrix.
     float aspectRatio = GetClientWidth() / static_cast<float>(GetClientHeight());
     m_ProjectionMatrix = XMMatrixPerspectiveFovLH(XMConvertToRadians(m_FoV), aspectRatio, 0.1f, 100.0f);
+
+    if (m_ContentLoaded) {
+        SelectLods();
+    }
+
+    // The render of this frame may run on the render thread while the next frame is updated.
+    FrameSnapshot& snapshot = m_Snapshots[e.SnapshotIndex];
+    snapshot.ModelMatrix = m_ModelMatrix;
+    snapshot.ViewMatrix = m_ViewMatrix;
+    snapshot.ProjectionMatrix = m_ProjectionMatrix;
+    snapshot.Viewport = m_Viewport;
+    snapshot.SelectedLods = m_SelectedLods;
+    snapshot.ContentLoaded = m_ContentLoaded;
+    snapshot.BindlessMode = m_BindlessMode;
+    snapshot.MeshletMode = m_MeshletMode;
+    snapshot.ParallelRecording = m_ParallelRecording;
 }
 
-// Transition a resource
-void Game::TransitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
-    Microsoft::WRL::ComPtr<ID3D12Resource> resource,
-    D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState) {
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-        resource.Get(),
-        beforeState, afterState);
+void Game::SelectLods() {
+    PROFILE_FUNCTION();
+
+    // The y scale of the projection is 1 / tan(fov / 2), see ComputeLodProjectionScale.
+    const float projectionScale = 0.5f * m_Viewport.Height * XMVectorGetY(m_ProjectionMatrix.r[1]);
+
+    // Errors are in object space, the model matrix may scale them.
+    const XMMATRIX modelView = XMMatrixMultiply(m_ModelMatrix, m_ViewMatrix);
+    const float modelScale = std::max({ XMVectorGetX(XMVector3Length(m_ModelMatrix.r[0])),
+        XMVectorGetX(XMVector3Length(m_ModelMatrix.r[1])), XMVectorGetX(XMVector3Length(m_ModelMatrix.r[2])) });
+
+    // Submeshes are independent, they are spread over the job system in batches.
+    const uint32_t batchSize = 64;
+    Application::Get().GetJobSystem()->ParallelFor(static_cast<uint32_t>(m_Submeshes.size()), batchSize,
+        [&](uint32_t begin, uint32_t end) {
+        std::vector<float> lodErrors;
+        for (uint32_t i = begin; i < end; ++i) {
+            const MeshFileSubmesh& submesh = m_Submeshes[i];
+            if (!m_LodSelection || submesh.NumLods == 0) {
+                m_SelectedLods[i] = 0;
+                continue;
+            }
+
+            lodErrors.assign(1, 0.0f);
+            for (uint32_t j = 0; j < submesh.NumLods; ++j) {
+                lodErrors.push_back(m_Lods[submesh.FirstLod + j].Error * modelScale);
+            }
 
-    commandList->ResourceBarrier(1, &barrier);
+            // The distance to the bounding sphere of the submesh, the nearest its surface can be.
+            const MeshFileBounds& bounds = submesh.Bounds;
+            const XMVECTOR minimum = XMVectorSet(bounds.Min[0], bounds.Min[1], bounds.Min[2], 1.0f);
+            const XMVECTOR maximum = XMVectorSet(bounds.Max[0], bounds.Max[1], bounds.Max[2], 1.0f);
+            const XMVECTOR center = XMVector3Transform(XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f), modelView);
+            const float radius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(maximum, minimum))) * modelScale;
+            const float distance = XMVectorGetX(XMVector3Length(center)) - radius;
+
+            m_SelectedLods[i] = SelectLod(lodErrors.data(), static_cast<uint32_t>(lodErrors.size()), distance, projectionScale,
+                m_SelectedLods[i]);
+        }
+    });
 }
 
 // Clear a render target.
@@ -327,56 +501,166 @@ void Game::ClearDepth(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> command
 }
 
 void Game::OnRender(RenderEventArgs& e) {
+    PROFILE_FUNCTION();
+
     super::OnRender(e);
 
+    // Report the frame time distribution once per second, the mean hides stutter.
+    // The frame statistics are added by the present of the frame, on the render thread if frames are pipelined.
+    m_StatsReportTime += e.ElapsedTime;
+    if (m_StatsReportTime > 1.0) {
+        std::ostringstream report;
+        m_pWindow->GetFrameStats().WriteSummary(report);
+        OutputDebugStringA(report.str().c_str());
+
+        m_StatsReportTime = 0.0;
+    }
+
+    // Everything the update changes is read from the snapshot, see OnUpdate.
+    const FrameSnapshot& snapshot = m_Snapshots[e.SnapshotIndex];
+
     auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-    auto commandList = commandQueue->GetCommandList();
+    auto& gpuProfiler = *Application::Get().GetGpuProfiler(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
-    UINT currentBackBufferIndex = m_pWindow->GetCurrentBackBufferIndex();
-    auto backBuffer = m_pWindow->GetCurrentBackBuffer();
     auto rtv = m_pWindow->GetCurrentRenderTargetView();
-    auto dsv = m_DSVHeap->GetCPUDescriptorHandleForHeapStart();
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv = { m_DSV.GetDescriptorHandle().ptr };
 
-    // Clear the render targets.
-    {
-        TransitionResource(commandList, backBuffer,
-            D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_CommandRecorder->Begin();
+    m_RenderGraph->Reset();
 
-        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
+    RenderGraphResource backBuffer = m_RenderGraph->ImportResource("Back Buffer",
+        m_pWindow->GetCurrentBackBuffer().get(), RHIResourceState_Present);
+    RenderGraphResource depthBuffer = m_RenderGraph->CreateResource("Depth Buffer",
+        RHIResourceDesc::Tex2D(RHIFormat::D32_Float, std::max(1, GetClientWidth()), std::max(1, GetClientHeight()),
+            RHIResourceFlag_AllowDepthStencil));
 
-        ClearRTV(commandList, rtv, clearColor);
-        ClearDepth(commandList, dsv);
-    }
+    // Clear the render targets. The depth buffer may share memory with other resources.
+    m_RenderGraph->AddPass("Clear", [&](RenderGraph& graph, RHICommandList* passCommandList) {
+        GpuProfileScope gpuScope(gpuProfiler, passCommandList, "Clear");
 
-    commandList->SetPipelineState(m_PipelineState.Get());
-    commandList->SetGraphicsRootSignature(m_RootSignature.Get());
+        UpdateDepthStencilView(graph.GetResource(depthBuffer));
 
-    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    commandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);
-    commandList->IASetIndexBuffer(&m_IndexBufferView);
+        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
 
-    commandList->RSSetViewports(1, &m_Viewport);
-    commandList->RSSetScissorRects(1, &m_ScissorRect);
+        auto commandList = GetD3D12CommandList(passCommandList);
+        ClearRTV(commandList, rtv, clearColor);
+        ClearDepth(commandList, dsv);
+    })
+        .Write(backBuffer, RHIResourceState_RenderTarget)
+        .Write(depthBuffer, RHIResourceState_DepthWrite);
+
+    // Until the content has been streamed in only the clear color is shown.
+    if (snapshot.ContentLoaded) {
+        m_RenderGraph->AddPass("Draw Cube", [&](RenderGraph& graph, RHICommandList* passCommandList) {
+            uint32_t drawRegion = gpuProfiler.BeginRegion(passCommandList, "Draw Cube");
+
+            // The bindless table lives in the shader visible heap of the dynamic descriptor ring, which the
+            // dynamic descriptor heaps bind. It is the only descriptor table, there are no descriptor tables to stage.
+            auto bindlessDescriptorTable = Application::Get().GetBindlessDescriptorTable();
+
+            ParallelCommandRecorder::InheritedState state = {};
+            const D3D12_VIEWPORT& viewport = snapshot.Viewport;
+            state.viewport = RHIViewport{ viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height,
+                viewport.MinDepth, viewport.MaxDepth };
+            state.scissorRect = RHIRect{ m_ScissorRect.left, m_ScissorRect.top, m_ScissorRect.right, m_ScissorRect.bottom };
+            state.numRenderTargets = 1;
+            state.renderTargets[0] = RHICPUDescriptorHandle{ rtv.ptr };
+            state.hasDepthStencil = true;
+            state.depthStencil = RHICPUDescriptorHandle{ dsv.ptr };
+            state.rootSignature = m_RHIRootSignature.get();
+            state.descriptorTables = nullptr;
+            state.numDescriptorTables = 0;
+
+            ID3D12PipelineState* pipelineState = snapshot.BindlessMode ? m_BindlessPipelineState.Get() : m_PipelineState.Get();
+            if (snapshot.MeshletMode) {
+                pipelineState = m_MeshletPipelineState.Get();
+            }
 
-    commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+            // Update the MVP matrix
+            XMMATRIX mvpMatrix = XMMatrixMultiply(m_PositionDequantization, snapshot.ModelMatrix);
+            mvpMatrix = XMMatrixMultiply(mvpMatrix, snapshot.ViewMatrix);
+            mvpMatrix = XMMatrixMultiply(mvpMatrix, snapshot.ProjectionMatrix);
+
+            // Meshlets only exist for the full detail. They are culled in object space, the bounds are not quantized.
+            MeshletConstants meshletConstants = m_MeshletConstants;
+            if (snapshot.MeshletMode) {
+                const XMMATRIX modelView = XMMatrixMultiply(snapshot.ModelMatrix, snapshot.ViewMatrix);
+                ExtractFrustumPlanes(XMMatrixMultiply(modelView, snapshot.ProjectionMatrix), meshletConstants.FrustumPlanes);
+                // The camera is at the origin of view space.
+                XMStoreFloat3(&meshletConstants.CameraPosition, XMMatrixInverse(nullptr, modelView).r[3]);
+            }
 
-    // Update the MVP matrix
-    XMMATRIX mvpMatrix = XMMatrixMultiply(m_ModelMatrix, m_ViewMatrix);
-    mvpMatrix = XMMatrixMultiply(mvpMatrix, m_ProjectionMatrix);
-    commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &mvpMatrix, 0);
+            // Draw the submeshes [begin, end), on the job system when there are enough of them.
+            auto recordDraws = [&](RHICommandList* drawCommandList, DynamicDescriptorHeap* dynamicDescriptorHeap,
+                uint32_t begin, uint32_t end) {
+                auto commandList = GetD3D12CommandList(drawCommandList);
+
+                commandList->SetPipelineState(pipelineState);
+                drawCommandList->SetGraphicsRootDescriptorTable(1, bindlessDescriptorTable->GetGPUDescriptorHandle());
+
+                commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                commandList->IASetVertexBuffers(0, m_NumVertexBuffers, m_VertexBufferViews);
+                commandList->IASetIndexBuffer(&m_IndexBufferView);
+
+                commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &mvpMatrix, 0);
+                // Only the bindless pipeline reads the vertex fetch constants.
+                commandList->SetGraphicsRoot32BitConstants(0, sizeof(VertexFetchConstants) / 4, &m_VertexFetchConstants,
+                    sizeof(XMMATRIX) / 4);
+
+                // Descriptor tables staged for the draws of the chunk are bound before the first of them.
+                dynamicDescriptorHeap->CommitStagedDescriptorsForDraw(drawCommandList);
+
+                if (snapshot.MeshletMode) {
+                    ComPtr<ID3D12GraphicsCommandList6> meshCommandList;
+                    ThrowIfFailed(commandList.As(&meshCommandList));
+                    MeshletConstants submeshConstants = meshletConstants;
+                    for (uint32_t i = begin; i < end; ++i) {
+                        const MeshFileSubmesh& submesh = m_Submeshes[i];
+                        submeshConstants.FirstMeshlet = submesh.FirstMeshlet;
+                        submeshConstants.NumMeshlets = submesh.NumMeshlets;
+                        UploadBuffer::Allocation constantBuffer = commandQueue->GetUploadBuffer().Allocate(sizeof(MeshletConstants),
+                            D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+                        std::memcpy(constantBuffer.CPU, &submeshConstants, sizeof(submeshConstants));
+                        commandList->SetGraphicsRootConstantBufferView(2, constantBuffer.GPU);
+
+                        meshCommandList->DispatchMesh((submesh.NumMeshlets + MeshletGroupSize - 1) / MeshletGroupSize, 1, 1);
+                    }
+                } else {
+                    for (uint32_t i = begin; i < end; ++i) {
+                        const MeshFileSubmesh& submesh = m_Submeshes[i];
+                        if (snapshot.SelectedLods[i] == 0) {
+                            commandList->DrawIndexedInstanced(submesh.NumIndices, 1, submesh.FirstIndex, 0, 0);
+                        } else {
+                            const MeshFileLod& lod = m_Lods[submesh.FirstLod + snapshot.SelectedLods[i] - 1];
+                            commandList->DrawIndexedInstanced(lod.NumIndices, 1, lod.FirstIndex, 0, 0);
+                        }
+                    }
+                }
+            };
+
+            const uint32_t minDrawsPerCommandList = snapshot.ParallelRecording ? MinDrawsPerCommandList : UINT32_MAX;
+            m_CommandRecorder->RecordParallel(state, static_cast<uint32_t>(m_Submeshes.size()), minDrawsPerCommandList,
+                recordDraws);
+
+            // The frame continues on the command list after the draws.
+            gpuProfiler.EndRegion(m_CommandRecorder->GetCommandList(), drawRegion);
+        })
+            .Write(backBuffer, RHIResourceState_RenderTarget)
+            .Write(depthBuffer, RHIResourceState_DepthWrite)
+            .SetSwitchesCommandList();
+    }
 
-    commandList->DrawIndexedInstanced(_countof(g_Indicies), 1, 0, 0, 0);
+    m_RenderGraph->Compile();
+    m_RenderGraph->Execute(*m_CommandRecorder);
 
     // Present
     {
-        TransitionResource(commandList, backBuffer,
-            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-
-        m_FenceValues[currentBackBufferIndex] = commandQueue->ExecuteCommandList(commandList);
-
-        currentBackBufferIndex = m_pWindow->Present();
+        // The command lists of the frame are executed in order. The transition of the back buffer to the
+        // present state is flushed when the last one is executed.
+        m_CommandRecorder->Execute();
 
-        commandQueue->WaitForFenceValue(m_FenceValues[currentBackBufferIndex]);
+        // The window waits for the frame context at the start of the next frame.
+        m_pWindow->Present();
     }
 }
 
@@ -396,6 +680,62 @@ void Game::OnKeyPressed(KeyEventArgs& e) {
         case KeyCode::V:
             m_pWindow->ToggleVSync();
             break;
+        case KeyCode::B:
+            // Switch between the input assembler and fetching the vertices through the bindless table.
+            m_BindlessMode = !m_BindlessMode;
+            OutputDebugStringA(m_BindlessMode ? "Bindless vertex fetch\n" : "Input assembler vertex fetch\n");
+            break;
+        case KeyCode::M:
+            // Switch between the vertex pipelines and culling and drawing meshlets with mesh shaders.
+            if (m_MeshletPipelineState) {
+                m_MeshletMode = !m_MeshletMode;
+                OutputDebugStringA(m_MeshletMode ? "Mesh shader meshlets\n" : "Vertex shader pipeline\n");
+            } else {
+                OutputDebugStringA("Mesh shaders are not supported or the mesh has no meshlets\n");
+            }
+            break;
+        case KeyCode::L:
+            // Switch between selecting levels of detail by their screen-space error and always drawing the full detail.
+            m_LodSelection = !m_LodSelection;
+            OutputDebugStringA(m_LodSelection ? "Level of detail selection\n" : "Full detail\n");
+            break;
+        case KeyCode::R:
+            // Switch between recording the draws on the job system and recording them on the main thread.
+            m_ParallelRecording = !m_ParallelRecording;
+            OutputDebugStringA(m_ParallelRecording ? "Parallel command recording\n" : "Serial command recording\n");
+            break;
+        case KeyCode::T:
+            // Switch between pipelined frames, rendered on a render thread while the next one is updated, and serial frames.
+            m_pWindow->TogglePipelined();
+            OutputDebugStringA(m_pWindow->IsPipelined() ? "Pipelined frames\n" : "Serial frames\n");
+            break;
+        case KeyCode::P:
+            // Dump the recent CPU zones and GPU regions for chrome://tracing.
+            if (Profiler::SaveChromeTrace("cpu_trace.json")) {
+                OutputDebugStringA("Saved CPU profile to cpu_trace.json\n");
+            }
+            break;
+        case KeyCode::C: {
+            // Toggle streaming of per-frame records for offline analysis.
+            // The present of a pipelined frame adds its record on the render thread.
+            m_pWindow->WaitForRenderThread();
+            FrameStats& frameStats = m_pWindow->GetFrameStats();
+            if (frameStats.IsCsvCaptureActive()) {
+                frameStats.EndCsvCapture();
+                OutputDebugStringA("Saved frame statistics to frame_stats.csv\n");
+            } else if (frameStats.BeginCsvCapture("frame_stats.csv")) {
+                OutputDebugStringA("Capturing frame statistics to frame_stats.csv\n");
+            }
+            break;
+        }
+        case KeyCode::G: {
+            // The GPU profiler is used by the render thread.
+            m_pWindow->WaitForRenderThread();
+            std::ostringstream report;
+            Application::Get().GetGpuProfiler(D3D12_COMMAND_LIST_TYPE_DIRECT)->WriteReport(report);
+            OutputDebugStringA(report.str().c_str());
+            break;
+        }
     }
 }
 
@@ -5,11 +5,12 @@
 #include <cassert>
 #include <directxmath.h>
 
-GameBase::GameBase(const std::wstring& name, int width, int height, bool vSync)
+GameBase::GameBase(const std::wstring& name, int width, int height, bool vSync, uint32_t framesInFlight)
     : m_Name(name)
     , m_Width(width)
     , m_Height(height)
-    , m_vSync(vSync) {
+    , m_vSync(vSync)
+    , m_FramesInFlight(framesInFlight) {
 }
 
 GameBase::~GameBase() {
@@ -23,7 +24,7 @@ bool GameBase::Initialize() {
         return false;
     }
 
-    m_pWindow = Application::Get().CreateRenderWindow(m_Name, m_Width, m_Height, m_vSync);
+    m_pWindow = Application::Get().CreateRenderWindow(m_Name, m_Width, m_Height, m_vSync, m_FramesInFlight);
     m_pWindow->RegisterCallbacks(shared_from_this());
     m_pWindow->Show();
 
@@ -0,0 +1,353 @@
+#include "gpumemoryallocator.h"
+
+#include "deferredreleasequeue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+// Placed resources are aligned to at least 64KB, MSAA textures to 4MB.
+static constexpr uint64_t PlacementAlignment = 64 * 1024;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Release the empty blocks of a pool but the first one.
+static void ReleaseEmptyBlocks(std::vector< std::shared_ptr<GpuMemoryBlock> >& blocks) {
+    bool keptEmptyBlock = false;
+    auto last = std::remove_if(blocks.begin(), blocks.end(), [&keptEmptyBlock](const std::shared_ptr<GpuMemoryBlock>& block) {
+        if (!block->IsEmpty()) {
+            return false;
+        }
+        bool release = keptEmptyBlock;
+        keptEmptyBlock = true;
+        return release;
+    });
+    blocks.erase(last, blocks.end());
+}
+
+// Upload and readback heaps require these states, default heap buffers are promoted from the common state.
+static RHIResourceState GetInitialBufferState(RHIHeapType heapType) {
+    switch (heapType) {
+        case RHIHeapType::Upload:
+            return RHIResourceState_GenericRead;
+        case RHIHeapType::Readback:
+            return RHIResourceState_CopyDest;
+        default:
+            return RHIResourceState_Common;
+    }
+}
+
+//
+// GpuAllocation
+//
+GpuAllocation::GpuAllocation()
+    : m_BlockOffset(0)
+    , m_Offset(0)
+    , m_Size(0) {
+}
+
+GpuAllocation::GpuAllocation(std::shared_ptr<GpuMemoryBlock> block, uint64_t blockOffset,
+    std::shared_ptr<RHIResource> resource, uint64_t offset, uint64_t size)
+    : m_Block(block)
+    , m_BlockOffset(blockOffset)
+    , m_Resource(resource)
+    , m_Offset(offset)
+    , m_Size(size) {
+}
+
+GpuAllocation::~GpuAllocation() {
+    Free();
+}
+
+GpuAllocation::GpuAllocation(GpuAllocation&& allocation)
+    : m_Block(std::move(allocation.m_Block))
+    , m_BlockOffset(allocation.m_BlockOffset)
+    , m_Resource(std::move(allocation.m_Resource))
+    , m_Offset(allocation.m_Offset)
+    , m_Size(allocation.m_Size) {
+    allocation.m_BlockOffset = 0;
+    allocation.m_Offset = 0;
+    allocation.m_Size = 0;
+}
+
+GpuAllocation& GpuAllocation::operator=(GpuAllocation&& other) {
+    if (this != &other) {
+        Free();
+
+        m_Block = std::move(other.m_Block);
+        m_BlockOffset = other.m_BlockOffset;
+        m_Resource = std::move(other.m_Resource);
+        m_Offset = other.m_Offset;
+        m_Size = other.m_Size;
+
+        other.m_BlockOffset = 0;
+        other.m_Offset = 0;
+        other.m_Size = 0;
+    }
+    return *this;
+}
+
+bool GpuAllocation::IsNull() const {
+    return !m_Resource;
+}
+
+RHIResource* GpuAllocation::GetResource() const {
+    return m_Resource.get();
+}
+
+uint64_t GpuAllocation::GetOffset() const {
+    return m_Offset;
+}
+
+uint64_t GpuAllocation::GetSize() const {
+    return m_Size;
+}
+
+uint64_t GpuAllocation::GetGPUVirtualAddress() const {
+    return m_Resource->GetGPUVirtualAddress() + m_Offset;
+}
+
+void GpuAllocation::Free() {
+    if (m_Block) {
+        // Packed buffers share the resource of the block, only placed resources are released.
+        std::shared_ptr<RHIResource> placedResource = m_Block->IsPackedBuffer() ? nullptr : std::move(m_Resource);
+        m_Block->Free(m_BlockOffset, std::move(placedResource));
+    }
+
+    m_Block.reset();
+    m_BlockOffset = 0;
+    m_Resource.reset();
+    m_Offset = 0;
+    m_Size = 0;
+}
+
+//
+// GpuMemoryBlock
+//
+GpuMemoryBlock::GpuMemoryBlock(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue,
+    const RHIHeapDesc& desc)
+    : m_Device(device)
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_Allocator(desc.Size, PlacementAlignment) {
+    m_Heap = device->CreateHeap(desc);
+}
+
+GpuMemoryBlock::GpuMemoryBlock(std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, GpuAllocation buffer,
+    uint64_t granularity)
+    : m_Buffer(std::move(buffer))
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_Allocator(m_Buffer.GetSize(), granularity) {
+}
+
+bool GpuMemoryBlock::IsPackedBuffer() const {
+    return !m_Heap;
+}
+
+bool GpuMemoryBlock::IsEmpty() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Allocator.IsEmpty();
+}
+
+TlsfAllocator::Stats GpuMemoryBlock::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Allocator.GetStats();
+}
+
+GpuAllocation GpuMemoryBlock::AllocatePlaced(const RHIResourceDesc& desc, const RHIResourceAllocationInfo& allocationInfo,
+    RHIResourceState initialState) {
+    assert(!IsPackedBuffer() && "Resources can only be placed in heaps.");
+
+    uint64_t offset;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        offset = m_Allocator.Allocate(allocationInfo.Size, allocationInfo.Alignment);
+    }
+    if (offset == TlsfAllocator::InvalidOffset) {
+        return GpuAllocation();
+    }
+
+    std::shared_ptr<RHIResource> resource;
+    try {
+        resource = m_Device->CreatePlacedResource(m_Heap.get(), offset, desc, initialState);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Allocator.Free(offset);
+        throw;
+    }
+
+    return GpuAllocation(shared_from_this(), offset, resource, 0, allocationInfo.Size);
+}
+
+GpuAllocation GpuMemoryBlock::AllocatePacked(uint64_t size) {
+    assert(IsPackedBuffer() && "Only buffers can be packed.");
+
+    uint64_t offset;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        offset = m_Allocator.Allocate(size, m_Allocator.GetGranularity());
+    }
+    if (offset == TlsfAllocator::InvalidOffset) {
+        return GpuAllocation();
+    }
+
+    // The views of packed buffers must not overlap the next allocation, keep the requested size.
+    return GpuAllocation(shared_from_this(), offset, m_Buffer.m_Resource, offset, size);
+}
+
+void GpuMemoryBlock::Free(uint64_t blockOffset, std::shared_ptr<RHIResource> placedResource) {
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue = m_DeferredReleaseQueue.lock();
+    if (!deferredReleaseQueue) {
+        placedResource.reset();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Allocator.Free(blockOffset);
+        return;
+    }
+
+    // The deleter runs once the GPU is done and keeps the block alive until then.
+    // The placed resource is released before another resource can take its place.
+    std::shared_ptr<GpuMemoryBlock> block = shared_from_this();
+    deferredReleaseQueue->Release(std::shared_ptr<void>(nullptr, [block, blockOffset, placedResource](void*) mutable {
+        placedResource.reset();
+
+        std::lock_guard<std::mutex> lock(block->m_Mutex);
+        block->m_Allocator.Free(blockOffset);
+    }));
+}
+
+//
+// GpuMemoryAllocator
+//
+const uint64_t GpuMemoryAllocator::DefaultBlockSize;
+const uint64_t GpuMemoryAllocator::MaxPackedBufferSize;
+const uint64_t GpuMemoryAllocator::PackedBufferPageSize;
+const uint64_t GpuMemoryAllocator::PackedBufferAlignment;
+
+GpuMemoryAllocator::GpuMemoryAllocator(std::shared_ptr<RHIDevice> device,
+    std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue, uint64_t blockSize)
+    : m_Device(device)
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_BlockSize(AlignUp(blockSize, PlacementAlignment)) {
+}
+
+GpuMemoryAllocator::~GpuMemoryAllocator() {
+}
+
+GpuAllocation GpuMemoryAllocator::CreateBuffer(RHIHeapType heapType, uint64_t size, uint32_t flags) {
+    assert(size > 0 && "Buffers must not be empty.");
+    assert(!(flags & (RHIResourceFlag_AllowRenderTarget | RHIResourceFlag_AllowDepthStencil)) &&
+        "Buffers cannot be render targets or depth-stencils.");
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (size > MaxPackedBufferSize) {
+        return AllocatePlaced(heapType, RHIHeapResourceType::Buffers, RHIResourceDesc::Buffer(size, flags),
+            GetInitialBufferState(heapType));
+    }
+
+    auto& pages = m_PackedBufferPages[static_cast<size_t>(heapType)][(flags & RHIResourceFlag_AllowUnorderedAccess) ? 1 : 0];
+    for (auto& page : pages) {
+        GpuAllocation allocation = page->AllocatePacked(size);
+        if (!allocation.IsNull()) {
+            return allocation;
+        }
+    }
+
+    GpuAllocation buffer = AllocatePlaced(heapType, RHIHeapResourceType::Buffers,
+        RHIResourceDesc::Buffer(PackedBufferPageSize, flags), GetInitialBufferState(heapType));
+    pages.push_back(std::make_shared<GpuMemoryBlock>(m_DeferredReleaseQueue, std::move(buffer), PackedBufferAlignment));
+
+    return pages.back()->AllocatePacked(size);
+}
+
+GpuAllocation GpuMemoryAllocator::CreateTexture(const RHIResourceDesc& desc, RHIResourceState initialState) {
+    assert(desc.Dimension != RHIResourceDimension::Buffer && "Use CreateBuffer for buffers.");
+
+    RHIHeapResourceType resourceType = (desc.Flags & (RHIResourceFlag_AllowRenderTarget | RHIResourceFlag_AllowDepthStencil)) ?
+        RHIHeapResourceType::RenderTargetTextures : RHIHeapResourceType::Textures;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return AllocatePlaced(RHIHeapType::Default, resourceType, desc, initialState);
+}
+
+void GpuMemoryAllocator::Trim() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Allocations only come from the pools while the mutex is held, an empty block stays empty.
+    // Pages first, they free ranges of the heaps.
+    for (size_t heapType = 0; heapType < NumHeapTypes; ++heapType) {
+        for (auto& pages : m_PackedBufferPages[heapType]) {
+            ReleaseEmptyBlocks(pages);
+        }
+        for (auto& heaps : m_Heaps[heapType]) {
+            ReleaseEmptyBlocks(heaps);
+        }
+    }
+}
+
+GpuAllocation GpuMemoryAllocator::AllocatePlaced(RHIHeapType heapType, RHIHeapResourceType resourceType,
+    const RHIResourceDesc& desc, RHIResourceState initialState) {
+    RHIResourceAllocationInfo allocationInfo = m_Device->GetResourceAllocationInfo(desc);
+
+    RHIHeapDesc heapDesc;
+    heapDesc.Type = heapType;
+    heapDesc.ResourceType = resourceType;
+
+    if (allocationInfo.Size + allocationInfo.Alignment - PlacementAlignment > m_BlockSize) {
+        // Too large for a shared heap, give it a heap of its own. Only the allocation references
+        // the heap, so it is released together with the resource.
+        heapDesc.Size = AlignUp(allocationInfo.Size, PlacementAlignment);
+        auto heap = std::make_shared<GpuMemoryBlock>(m_Device, m_DeferredReleaseQueue, heapDesc);
+        return heap->AllocatePlaced(desc, allocationInfo, initialState);
+    }
+
+    auto& heaps = m_Heaps[static_cast<size_t>(heapType)][static_cast<size_t>(resourceType)];
+    for (auto& heap : heaps) {
+        GpuAllocation allocation = heap->AllocatePlaced(desc, allocationInfo, initialState);
+        if (!allocation.IsNull()) {
+            return allocation;
+        }
+    }
+
+    heapDesc.Size = m_BlockSize;
+    heaps.push_back(std::make_shared<GpuMemoryBlock>(m_Device, m_DeferredReleaseQueue, heapDesc));
+
+    GpuAllocation allocation = heaps.back()->AllocatePlaced(desc, allocationInfo, initialState);
+    if (allocation.IsNull()) {
+        assert(false && "A resource does not fit in an empty heap.");
+        throw std::runtime_error("Failed to place a resource.");
+    }
+    return allocation;
+}
+
+GpuMemoryAllocator::Stats GpuMemoryAllocator::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Stats stats = {};
+    for (size_t heapType = 0; heapType < NumHeapTypes; ++heapType) {
+        for (size_t resourceType = 0; resourceType < NumHeapResourceTypes; ++resourceType) {
+            for (const auto& heap : m_Heaps[heapType][resourceType]) {
+                TlsfAllocator::Stats heapStats = heap->GetStats();
+                ++stats.numHeaps;
+                stats.heapBytes += heapStats.size;
+                stats.heapUsedBytes += heapStats.usedBytes;
+                stats.numPlacedResources += heapStats.numAllocations;
+                stats.largestFreeBlock = std::max(stats.largestFreeBlock, heapStats.largestFreeBlock);
+            }
+        }
+
+        for (const auto& pages : m_PackedBufferPages[heapType]) {
+            for (const auto& page : pages) {
+                TlsfAllocator::Stats pageStats = page->GetStats();
+                ++stats.numPackedBufferPages;
+                stats.packedBufferBytes += pageStats.size;
+                stats.packedBufferUsedBytes += pageStats.usedBytes;
+                stats.numPackedBuffers += pageStats.numAllocations;
+            }
+        }
+    }
+
+    return stats;
+}
@@ -0,0 +1,256 @@
+#include "gpuprofiler.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+
+const uint32_t GpuProfiler::MaxRegionsPerFrame;
+const uint32_t GpuProfiler::NumFrames;
+const uint32_t GpuProfiler::InvalidRegion;
+
+GpuProfiler::GpuProfiler(std::shared_ptr<RHIDevice> device, std::shared_ptr<CommandQueue> commandQueue,
+    const std::string& trackName)
+    : m_CommandQueue(commandQueue)
+    , m_ReadbackData(nullptr)
+    , m_TimestampFrequency(0)
+    , m_ProfilerTrack(0)
+    , m_FrameIndex(0)
+    , m_NumDroppedFrames(0)
+    , m_Recording(false)
+    , m_NumRegions(0) {
+    for (auto& frame : m_Frames) {
+        frame.fenceValue = 0;
+        frame.numRegions = 0;
+        frame.gpuCalibrationTimestamp = 0;
+        frame.cpuCalibrationTimestamp = 0;
+        frame.regions.reset(new RegionQueries[MaxRegionsPerFrame]);
+    }
+
+    std::shared_ptr<RHICommandQueue> rhiCommandQueue = m_CommandQueue->GetRHICommandQueue();
+    const RHIQueueType type = rhiCommandQueue->GetType();
+    if (!device->IsTimestampQuerySupported(type)) {
+        return;
+    }
+
+    // Every region has a begin and an end query.
+    const uint32_t numQueries = NumFrames * MaxRegionsPerFrame * 2;
+
+    m_QueryHeap = device->CreateQueryHeap(
+        type == RHIQueueType::Copy ? RHIQueryHeapType::CopyQueueTimestamp : RHIQueryHeapType::Timestamp, numQueries);
+    m_ReadbackBuffer = device->CreateCommittedResource(RHIHeapType::Readback,
+        RHIResourceDesc::Buffer(numQueries * sizeof(uint64_t)), RHIResourceState_CopyDest);
+
+    // Readback buffers can stay mapped, a frame's range is only read after its resolve has completed.
+    m_ReadbackData = static_cast<const uint64_t*>(m_ReadbackBuffer->Map());
+
+    m_TimestampFrequency = rhiCommandQueue->GetTimestampFrequency();
+    m_ProfilerTrack = Profiler::CreateTrack(trackName);
+}
+
+GpuProfiler::~GpuProfiler() {
+    if (m_ReadbackBuffer) {
+        uint64_t fenceValue = 0;
+        for (const auto& frame : m_Frames) {
+            fenceValue = std::max(fenceValue, frame.fenceValue);
+        }
+        m_CommandQueue->WaitForFenceValue(fenceValue);
+
+        m_ReadbackBuffer->Unmap();
+    }
+}
+
+bool GpuProfiler::IsSupported() const {
+    return m_QueryHeap != nullptr;
+}
+
+void GpuProfiler::BeginFrame() {
+    assert(!m_Recording && "EndFrame was not called for the previous frame.");
+
+    if (!IsSupported()) {
+        return;
+    }
+
+    // Read back completed frames from the oldest to the newest.
+    for (uint32_t i = 1; i <= NumFrames; ++i) {
+        uint32_t frameIndex = (m_FrameIndex + i) % NumFrames;
+        const Frame& frame = m_Frames[frameIndex];
+        if (frame.fenceValue != 0 && m_CommandQueue->IsFenceComplete(frame.fenceValue)) {
+            ReadBack(frameIndex);
+        }
+    }
+
+    m_FrameIndex = (m_FrameIndex + 1) % NumFrames;
+
+    // The GPU is more than NumFrames frames behind, skip the frame instead of waiting.
+    if (m_Frames[m_FrameIndex].fenceValue != 0) {
+        ++m_NumDroppedFrames;
+        return;
+    }
+
+    m_NumRegions.store(0, std::memory_order_relaxed);
+    m_Recording.store(true, std::memory_order_release);
+}
+
+void GpuProfiler::EndFrame() {
+    if (!m_Recording.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    Frame& frame = m_Frames[m_FrameIndex];
+
+    uint32_t numRegions = m_NumRegions.load(std::memory_order_relaxed);
+    if (numRegions > MaxRegionsPerFrame) {
+        numRegions = MaxRegionsPerFrame;
+    }
+    if (numRegions == 0) {
+        return;
+    }
+
+    const uint32_t firstQuery = m_FrameIndex * MaxRegionsPerFrame * 2;
+
+    auto commandList = m_CommandQueue->GetCommandList();
+    commandList->ResolveQueryData(m_QueryHeap.get(), firstQuery, numRegions * 2,
+        m_ReadbackBuffer.get(), firstQuery * sizeof(uint64_t));
+
+    frame.fenceValue = m_CommandQueue->ExecuteCommandList(commandList);
+    frame.numRegions = numRegions;
+    m_CommandQueue->GetRHICommandQueue()->GetClockCalibration(
+        &frame.gpuCalibrationTimestamp, &frame.cpuCalibrationTimestamp);
+}
+
+uint32_t GpuProfiler::BeginRegion(RHICommandList* commandList, const char* name) {
+    if (!m_Recording.load(std::memory_order_acquire)) {
+        return InvalidRegion;
+    }
+
+    uint32_t region = m_NumRegions.fetch_add(1, std::memory_order_relaxed);
+    if (region >= MaxRegionsPerFrame) {
+        return InvalidRegion;
+    }
+
+    RegionQueries& regionQueries = m_Frames[m_FrameIndex].regions[region];
+    regionQueries.name.store(name, std::memory_order_relaxed);
+    regionQueries.ended.store(false, std::memory_order_relaxed);
+
+    commandList->EndQuery(m_QueryHeap.get(), (m_FrameIndex * MaxRegionsPerFrame + region) * 2);
+
+    return region;
+}
+
+void GpuProfiler::EndRegion(RHICommandList* commandList, uint32_t region) {
+    if (region == InvalidRegion) {
+        return;
+    }
+
+    commandList->EndQuery(m_QueryHeap.get(), (m_FrameIndex * MaxRegionsPerFrame + region) * 2 + 1);
+
+    m_Frames[m_FrameIndex].regions[region].ended.store(true, std::memory_order_relaxed);
+}
+
+void GpuProfiler::ReadBack(uint32_t frameIndex) {
+    Frame& frame = m_Frames[frameIndex];
+    const uint64_t* timestamps = m_ReadbackData + frameIndex * MaxRegionsPerFrame * 2;
+
+    m_LastFrameRegions.clear();
+    for (uint32_t i = 0; i < frame.numRegions; ++i) {
+        const RegionQueries& regionQueries = frame.regions[i];
+
+        // Regions that were never ended have no valid end timestamp.
+        if (!regionQueries.ended.load(std::memory_order_relaxed) || timestamps[i * 2 + 1] < timestamps[i * 2]) {
+            continue;
+        }
+
+        m_LastFrameRegions.push_back(Region{
+            regionQueries.name.load(std::memory_order_relaxed),
+            ToProfilerTimestamp(frame, timestamps[i * 2]),
+            ToProfilerTimestamp(frame, timestamps[i * 2 + 1]),
+            0 });
+    }
+
+    frame.fenceValue = 0;
+    frame.numRegions = 0;
+
+    std::sort(m_LastFrameRegions.begin(), m_LastFrameRegions.end(), [](const Region& a, const Region& b) {
+        return a.beginTimestamp < b.beginTimestamp ||
+            (a.beginTimestamp == b.beginTimestamp && a.endTimestamp > b.endTimestamp);
+    });
+
+    // Regions nest by time, the depth is the number of enclosing regions still open.
+    std::vector<uint64_t> openRegionEnds;
+    for (auto& region : m_LastFrameRegions) {
+        while (!openRegionEnds.empty() && openRegionEnds.back() <= region.beginTimestamp) {
+            openRegionEnds.pop_back();
+        }
+        region.depth = static_cast<uint32_t>(openRegionEnds.size());
+        openRegionEnds.push_back(region.endTimestamp);
+
+        if (Profiler::IsEnabled()) {
+            Profiler::RecordZone(m_ProfilerTrack, region.name, region.beginTimestamp, region.endTimestamp, region.depth);
+        }
+
+        double durationMs = (region.endTimestamp - region.beginTimestamp) * 1e-6;
+
+        auto stats = m_RegionStats.find(region.name);
+        if (stats == m_RegionStats.end()) {
+            m_RegionStats.emplace(region.name, RegionStats{ 1, durationMs, durationMs, durationMs, durationMs });
+        } else {
+            stats->second.count++;
+            stats->second.totalMs += durationMs;
+            stats->second.minMs = std::min(stats->second.minMs, durationMs);
+            stats->second.maxMs = std::max(stats->second.maxMs, durationMs);
+            stats->second.lastMs = durationMs;
+        }
+    }
+}
+
+uint64_t GpuProfiler::ToProfilerTimestamp(const Frame& frame, uint64_t gpuTimestamp) const {
+    // Signed tick offset from the calibration point, converted to nanoseconds.
+    int64_t ticks = static_cast<int64_t>(gpuTimestamp - frame.gpuCalibrationTimestamp);
+    int64_t frequency = static_cast<int64_t>(m_TimestampFrequency);
+    int64_t nanoseconds = ticks / frequency * 1000000000ll + ticks % frequency * 1000000000ll / frequency;
+
+    std::chrono::high_resolution_clock::time_point timePoint(
+        std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+            std::chrono::nanoseconds(static_cast<int64_t>(frame.cpuCalibrationTimestamp) + nanoseconds)));
+
+    return Profiler::ToTimestamp(timePoint);
+}
+
+const std::vector<GpuProfiler::Region>& GpuProfiler::GetLastFrameRegions() const {
+    return m_LastFrameRegions;
+}
+
+const std::map<std::string, GpuProfiler::RegionStats>& GpuProfiler::GetRegionStats() const {
+    return m_RegionStats;
+}
+
+void GpuProfiler::ResetStats() {
+    m_RegionStats.clear();
+}
+
+uint64_t GpuProfiler::GetNumDroppedFrames() const {
+    return m_NumDroppedFrames;
+}
+
+void GpuProfiler::WriteReport(std::ostream& stream) const {
+    stream << std::left << std::setw(32) << "GPU region" << std::right
+        << std::setw(8) << "count"
+        << std::setw(10) << "avg ms"
+        << std::setw(10) << "min ms"
+        << std::setw(10) << "max ms"
+        << std::setw(10) << "last ms" << "\n";
+
+    stream << std::fixed << std::setprecision(3);
+    for (const auto& stats : m_RegionStats) {
+        stream << std::left << std::setw(32) << stats.first << std::right
+            << std::setw(8) << stats.second.count
+            << std::setw(10) << stats.second.totalMs / stats.second.count
+            << std::setw(10) << stats.second.minMs
+            << std::setw(10) << stats.second.maxMs
+            << std::setw(10) << stats.second.lastMs << "\n";
+    }
+    stream << std::defaultfloat;
+}
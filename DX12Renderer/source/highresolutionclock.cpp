@@ -13,6 +13,10 @@ void HighResolutionClock::Tick() {
     m_T0 = t1;
 }
 
+std::chrono::high_resolution_clock::time_point HighResolutionClock::Now() {
+    return std::chrono::high_resolution_clock::now();
+}
+
 void HighResolutionClock::Reset() {
     m_T0 = std::chrono::high_resolution_clock::now();
     m_DeltaTime = std::chrono::high_resolution_clock::duration();
@@ -0,0 +1,510 @@
+#include "jobsystem.h"
+
+#include "profiler.h"
+
+#include <cassert>
+#include <functional>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Attempts to find a job before an idle worker goes to sleep.
+const int SpinCount = 64;
+
+// Chase-Lev deque with the memory orders of Lê et al. The owner pushes and pops at the bottom, any thread steals
+// from the top.
+template<typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(size_t capacity)
+        : m_Top(0)
+        , m_Bottom(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        m_Buffers.emplace_back(new Buffer(size));
+        m_Buffer.store(m_Buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    void Push(T* item) {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_Top.load(std::memory_order_acquire);
+        Buffer* buffer = m_Buffer.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(buffer->mask)) {
+            buffer = Grow(buffer, top, bottom);
+        }
+        buffer->Store(bottom, item);
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only. Null if the deque is empty.
+    T* Pop() {
+        const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* buffer = m_Buffer.load(std::memory_order_relaxed);
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = buffer->Load(bottom);
+        if (top == bottom) {
+            // The last item, thieves may be taking it too.
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Null if the deque is empty or another thread took the item first.
+    T* Steal() {
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        Buffer* buffer = m_Buffer.load(std::memory_order_acquire);
+        T* item = buffer->Load(top);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+private:
+    struct Buffer {
+        explicit Buffer(size_t size)
+            : mask(size - 1)
+            , items(new std::atomic<T*>[size]) {
+        }
+
+        // The item pointers publish the items, a thief may read a bottom the owner stored without release in Pop.
+        T* Load(int64_t index) const {
+            return items[static_cast<size_t>(index) & mask].load(std::memory_order_acquire);
+        }
+
+        void Store(int64_t index, T* item) {
+            items[static_cast<size_t>(index) & mask].store(item, std::memory_order_release);
+        }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom) {
+        m_Buffers.emplace_back(new Buffer((buffer->mask + 1) * 2));
+        Buffer* grown = m_Buffers.back().get();
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->Store(i, buffer->Load(i));
+        }
+        // Thieves may still read the old buffer, it is kept until the deque is destroyed.
+        m_Buffer.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    std::atomic<int64_t> m_Top;
+    // Keeps the top that thieves write and the bottom of the owner on separate cache lines.
+    char m_Padding[64];
+    std::atomic<int64_t> m_Bottom;
+    std::atomic<Buffer*> m_Buffer;
+    // All buffers the deque has used, only accessed by the owner.
+    std::vector< std::unique_ptr<Buffer> > m_Buffers;
+};
+
+struct ThreadContext {
+    const JobSystem* jobSystem;
+    uint32_t index;
+    // State of the random victim selection, 0 until it is seeded.
+    uint32_t random;
+};
+
+thread_local ThreadContext t_Context = { nullptr, JobSystem::InvalidThreadIndex, 0 };
+
+uint32_t NextRandom(ThreadContext& context) {
+    if (context.random == 0) {
+        context.random = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+    }
+    // Xorshift32.
+    context.random ^= context.random << 13;
+    context.random ^= context.random >> 17;
+    context.random ^= context.random << 5;
+    return context.random;
+}
+
+void SetCurrentThreadAffinity(uint32_t processor) {
+#if defined(_WIN32)
+    // Only the processors of the first processor group.
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (processor % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t processors;
+    CPU_ZERO(&processors);
+    CPU_SET(processor % CPU_SETSIZE, &processors);
+    pthread_setaffinity_np(pthread_self(), sizeof(processors), &processors);
+#else
+    (void)processor;
+#endif
+}
+
+void SetCurrentThreadPriority(JobSystem::ThreadPriority priority) {
+    if (priority == JobSystem::ThreadPriority::Normal) {
+        return;
+    }
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(),
+        priority == JobSystem::ThreadPriority::Low ? THREAD_PRIORITY_BELOW_NORMAL : THREAD_PRIORITY_ABOVE_NORMAL);
+#elif defined(__linux__)
+    // Linux applies nice values per thread. Failures to raise the priority without privileges are ignored.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), priority == JobSystem::ThreadPriority::Low ? 5 : -5);
+#endif
+}
+
+}
+
+//
+// JobSystem
+//
+struct JobSystem::Job {
+    JobFunction function;
+    JobCounter* counter;
+};
+
+struct JobSystem::Worker {
+    explicit Worker(size_t dequeCapacity)
+        : deque(dequeCapacity)
+        , numJobs(0)
+        , numSteals(0) {
+    }
+
+    WorkStealingDeque<Job> deque;
+    std::thread thread;
+    // Only written by the thread of the worker.
+    std::atomic<uint64_t> numJobs;
+    std::atomic<uint64_t> numSteals;
+};
+
+const uint32_t JobSystem::InvalidThreadIndex;
+const uint32_t JobSystem::AutoNumWorkers;
+
+JobSystem::JobSystem()
+    : JobSystem(Settings()) {
+}
+
+JobSystem::JobSystem(const Settings& settings)
+    : m_Settings(settings)
+    , m_QueueSize(0)
+    , m_Epoch(0)
+    , m_NumSleeping(0)
+    , m_NumPendingJobs(0)
+    , m_NumForeignJobs(0)
+    , m_NumForeignSteals(0)
+    , m_Stop(false) {
+    assert(!t_Context.jobSystem && "The thread is already part of a job system.");
+
+    uint32_t numWorkers = settings.numWorkers;
+    if (numWorkers == AutoNumWorkers) {
+        const uint32_t numHardwareThreads = std::thread::hardware_concurrency();
+        numWorkers = numHardwareThreads > 1 ? numHardwareThreads - 1 : 1;
+    }
+
+    // The creating thread is the first, the workers need all deques before they start.
+    for (uint32_t i = 0; i <= numWorkers; ++i) {
+        m_Workers.emplace_back(new Worker(settings.dequeCapacity));
+    }
+
+    // The creating thread is not pinned, it belongs to the application and keeps running after the job system.
+    t_Context = ThreadContext{ this, 0, 0 };
+
+    for (uint32_t i = 1; i <= numWorkers; ++i) {
+        m_Workers[i]->thread = std::thread(&JobSystem::WorkerThread, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    assert(t_Context.jobSystem == this && t_Context.index == 0 && "The job system must be destroyed by the thread that created it.");
+
+    while (m_NumPendingJobs.load(std::memory_order_acquire) != 0) {
+        if (Job* job = FindJob()) {
+            Execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Stop = true;
+    }
+    m_SleepCondition.notify_all();
+
+    for (size_t i = 1; i < m_Workers.size(); ++i) {
+        m_Workers[i]->thread.join();
+    }
+
+    t_Context = ThreadContext{ nullptr, InvalidThreadIndex, 0 };
+}
+
+void JobSystem::Run(JobFunction function, JobCounter* counter) {
+    Job* job = new Job{ std::move(function), counter };
+    if (counter) {
+        assert((counter->m_Value.load(std::memory_order_relaxed) & JobCounter::CountMask) < JobCounter::CountMask &&
+            "Too many jobs on the counter.");
+        counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_NumPendingJobs.fetch_add(1, std::memory_order_relaxed);
+
+    Schedule(job);
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobFunction function, JobCounter* counter) {
+    Job* job = new Job{ std::move(function), counter };
+    if (counter) {
+        assert((counter->m_Value.load(std::memory_order_relaxed) & JobCounter::CountMask) < JobCounter::CountMask &&
+            "Too many jobs on the counter.");
+        counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_NumPendingJobs.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        // The job that brings the count to zero takes the dependents under the same lock.
+        std::lock_guard<std::mutex> lock(dependency.m_Mutex);
+        if ((dependency.m_Value.load(std::memory_order_acquire) & JobCounter::CountMask) != 0) {
+            dependency.m_Dependents.push_back(job);
+            return;
+        }
+    }
+    Schedule(job);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& function) {
+    assert(batchSize > 0 && "The batch size must not be 0.");
+
+    if (count <= batchSize) {
+        if (count > 0) {
+            function(0, count);
+        }
+        return;
+    }
+
+    JobCounter counter;
+    SplitRange(0, count, batchSize, function, counter);
+    Wait(counter);
+}
+
+void JobSystem::SplitRange(uint32_t begin, uint32_t end, uint32_t batchSize, const RangeFunction& function, JobCounter& counter) {
+    // Offer the upper half to other threads until one batch is left, big ranges are stolen first.
+    while (end - begin > batchSize) {
+        const uint32_t middle = begin + (end - begin) / 2;
+        Run([this, middle, end, batchSize, &function, &counter]() {
+            SplitRange(middle, end, batchSize, function, counter);
+        }, &counter);
+        end = middle;
+    }
+    function(begin, end);
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+    while (!counter.IsDone()) {
+        if (Job* job = FindJob()) {
+            Execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint32_t JobSystem::GetNumThreads() const {
+    return static_cast<uint32_t>(m_Workers.size());
+}
+
+uint32_t JobSystem::GetThreadIndex() const {
+    return t_Context.jobSystem == this ? t_Context.index : InvalidThreadIndex;
+}
+
+JobSystem::Stats JobSystem::GetStats() const {
+    Stats stats = {};
+    stats.numJobs = m_NumForeignJobs.load(std::memory_order_relaxed);
+    stats.numSteals = m_NumForeignSteals.load(std::memory_order_relaxed);
+    for (const auto& worker : m_Workers) {
+        stats.numJobs += worker->numJobs.load(std::memory_order_relaxed);
+        stats.numSteals += worker->numSteals.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void JobSystem::WorkerThread(uint32_t index) {
+    Profiler::SetThreadName("Job Worker " + std::to_string(index));
+
+    t_Context = ThreadContext{ this, index, 0 };
+    if (m_Settings.pinThreads) {
+        SetCurrentThreadAffinity(index);
+    }
+    SetCurrentThreadPriority(m_Settings.workerPriority);
+
+    for (;;) {
+        // Jobs scheduled after this are either found below or change the epoch before the worker sleeps.
+        const uint64_t epoch = m_Epoch.load(std::memory_order_seq_cst);
+
+        Job* job = FindJob();
+        for (int i = 0; i < SpinCount && !job; ++i) {
+            std::this_thread::yield();
+            job = FindJob();
+        }
+        if (job) {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        if (m_Stop) {
+            return;
+        }
+        m_NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_SleepCondition.wait(lock, [this, epoch]() { return m_Epoch.load(std::memory_order_seq_cst) != epoch || m_Stop; });
+        m_NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::Schedule(Job* job) {
+    if (t_Context.jobSystem == this) {
+        m_Workers[t_Context.index]->deque.Push(job);
+    } else {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        m_Queue.push_back(job);
+        m_QueueSize.store(m_Queue.size(), std::memory_order_release);
+    }
+
+    m_Epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_NumSleeping.load(std::memory_order_seq_cst) > 0) {
+        // Taking the lock makes sure the worker is either waiting or has not checked the epoch yet.
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_SleepCondition.notify_one();
+    }
+}
+
+JobSystem::Job* JobSystem::FindJob() {
+    ThreadContext& context = t_Context;
+    const bool isMember = context.jobSystem == this;
+
+    if (isMember) {
+        if (Job* job = m_Workers[context.index]->deque.Pop()) {
+            return job;
+        }
+    }
+
+    if (m_QueueSize.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        if (!m_Queue.empty()) {
+            Job* job = m_Queue.front();
+            m_Queue.pop_front();
+            m_QueueSize.store(m_Queue.size(), std::memory_order_release);
+            return job;
+        }
+    }
+
+    // Start at a random thread so thieves spread over the deques.
+    const uint32_t numThreads = GetNumThreads();
+    const uint32_t first = NextRandom(context) % numThreads;
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        const uint32_t victim = (first + i) % numThreads;
+        if (isMember && victim == context.index) {
+            continue;
+        }
+        if (Job* job = m_Workers[victim]->deque.Steal()) {
+            if (isMember) {
+                std::atomic<uint64_t>& numSteals = m_Workers[context.index]->numSteals;
+                numSteals.store(numSteals.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            } else {
+                m_NumForeignSteals.fetch_add(1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job) {
+    job->function();
+
+    // Counted before the counter is released, so a thread that has waited for the job sees it counted.
+    if (t_Context.jobSystem == this) {
+        std::atomic<uint64_t>& numJobs = m_Workers[t_Context.index]->numJobs;
+        numJobs.store(numJobs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    } else {
+        m_NumForeignJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (JobCounter* counter = job->counter) {
+        // The job that brings the count to zero registers as a releaser so the counter is not done,
+        // and cannot be destroyed, before it has taken the dependents.
+        uint32_t value = counter->m_Value.load(std::memory_order_relaxed);
+        uint32_t decremented;
+        do {
+            decremented = value - 1;
+            if ((decremented & JobCounter::CountMask) == 0) {
+                decremented += JobCounter::Releaser;
+            }
+        } while (!counter->m_Value.compare_exchange_weak(value, decremented, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        if ((decremented & JobCounter::CountMask) == 0) {
+            std::vector<Job*> dependents;
+            {
+                std::lock_guard<std::mutex> lock(counter->m_Mutex);
+                dependents.swap(counter->m_Dependents);
+            }
+            counter->m_Value.fetch_sub(JobCounter::Releaser, std::memory_order_release);
+
+            for (Job* dependent : dependents) {
+                Schedule(dependent);
+            }
+        }
+    }
+    delete job;
+
+    m_NumPendingJobs.fetch_sub(1, std::memory_order_release);
+}
+
+//
+// JobCounter
+//
+JobCounter::JobCounter()
+    : m_Value(0) {
+}
+
+JobCounter::~JobCounter() {
+    assert(GetValue() == 0 && "Jobs still use the counter.");
+    // A job that depends on the counter may have started as soon as the count reached zero, while the thread
+    // that brought it there is still taking the dependents.
+    while (m_Value.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+bool JobCounter::IsDone() const {
+    return m_Value.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t JobCounter::GetValue() const {
+    return m_Value.load(std::memory_order_acquire) & CountMask;
+}
@@ -0,0 +1,35 @@
+#include "lodselection.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+float ComputeLodProjectionScale(float fieldOfView, float viewportHeight) {
+    return 0.5f * viewportHeight / std::tan(0.5f * fieldOfView);
+}
+
+float ComputeScreenSpaceError(float error, float distance, float projectionScale) {
+    // Inside the bounds the error could cover the whole screen.
+    if (distance <= 0.0f) {
+        return error > 0.0f ? FLT_MAX : 0.0f;
+    }
+    return error * projectionScale / distance;
+}
+
+uint32_t SelectLod(const float* lodErrors, uint32_t numLods, float distance, float projectionScale, uint32_t currentLod,
+    const LodSelectionSettings& settings) {
+    assert(numLods > 0 && "There must be at least one level of detail.");
+
+    const float refineThreshold = settings.pixelThreshold * (1.0f + settings.hysteresis);
+    const float coarsenThreshold = settings.pixelThreshold * (1.0f - settings.hysteresis);
+
+    uint32_t lod = std::min(currentLod, numLods - 1);
+    while (lod > 0 && ComputeScreenSpaceError(lodErrors[lod], distance, projectionScale) > refineThreshold) {
+        --lod;
+    }
+    while (lod + 1 < numLods && ComputeScreenSpaceError(lodErrors[lod + 1], distance, projectionScale) <= coarsenThreshold) {
+        ++lod;
+    }
+    return lod;
+}
@@ -2,6 +2,7 @@
 #include "game.h"
 
 #include <Shlwapi.h>
+#include <shellapi.h>
 
 #include <dxgidebug.h>
 
@@ -27,9 +28,23 @@ int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdL
         SetCurrentDirectoryW(path);
     }
 
+    // The number of frames in flight trades CPU/GPU overlap for latency.
+    // It can be tuned per deployment with -framesInFlight N.
+    uint32_t framesInFlight = FramePacer::DefaultFramesInFlight;
+    int argc = 0;
+    LPWSTR* argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+    if (argv) {
+        for (int i = 0; i + 1 < argc; ++i) {
+            if (::wcscmp(argv[i], L"-framesInFlight") == 0) {
+                framesInFlight = static_cast<uint32_t>(::wcstoul(argv[++i], nullptr, 10));
+            }
+        }
+        ::LocalFree(argv);
+    }
+
     Application::Create(hInstance);
     {
-        std::shared_ptr<Game> demo = std::make_shared<Game>(L"Learning DirectX 12 - Lesson 2", 1280, 720);
+        std::shared_ptr<Game> demo = std::make_shared<Game>(L"Learning DirectX 12 - Lesson 2", 1280, 720, false, framesInFlight);
         retCode = Application::Get().Run(demo);
     }
     Application::Destroy();
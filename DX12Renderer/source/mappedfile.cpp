@@ -0,0 +1,104 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : m_Data(nullptr)
+    , m_Size(0) {
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || static_cast<uint64_t>(size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the mapping and the file alive, the handles are not needed anymore.
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        return false;
+    }
+
+    m_Data = static_cast<const uint8_t*>(data);
+    m_Size = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size <= 0) {
+        close(file);
+        return false;
+    }
+
+    // The mapping keeps the file alive, the descriptor is not needed anymore.
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    m_Data = static_cast<const uint8_t*>(data);
+    m_Size = static_cast<size_t>(status.st_size);
+#endif
+
+    return true;
+}
+
+void MappedFile::Close() {
+    if (!m_Data) {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(m_Data);
+#else
+    munmap(const_cast<uint8_t*>(m_Data), m_Size);
+#endif
+
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+bool MappedFile::IsOpen() const {
+    return m_Data != nullptr;
+}
+
+const uint8_t* MappedFile::GetData() const {
+    return m_Data;
+}
+
+size_t MappedFile::GetSize() const {
+    return m_Size;
+}
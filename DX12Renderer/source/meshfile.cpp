@@ -0,0 +1,442 @@
+#include "meshfile.h"
+
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template<typename Index>
+static bool AreIndicesInRange(const uint8_t* indexData, uint32_t numIndices, uint32_t numVertices) {
+    const Index* indices = reinterpret_cast<const Index*>(indexData);
+    return std::all_of(indices, indices + numIndices, [numVertices](Index index) { return index < numVertices; });
+}
+
+uint32_t GetMeshAttributeFormatSize(MeshAttributeFormat format) {
+    switch (format) {
+        case MeshAttributeFormat::R32G32B32_Float:
+            return 12;
+        case MeshAttributeFormat::R32G32_Float:
+        case MeshAttributeFormat::R16G16B16A16_UNorm:
+            return 8;
+        case MeshAttributeFormat::R16G16_SNorm:
+        case MeshAttributeFormat::R8G8B8A8_UNorm:
+        case MeshAttributeFormat::R16G16_Float:
+            return 4;
+    }
+    return 0;
+}
+
+bool IsMeshAttributeFormatSupported(MeshSemantic semantic, MeshAttributeFormat format) {
+    switch (semantic) {
+        case MeshSemantic::Position:
+            return format == MeshAttributeFormat::R32G32B32_Float || format == MeshAttributeFormat::R16G16B16A16_UNorm;
+        case MeshSemantic::Normal:
+            return format == MeshAttributeFormat::R32G32B32_Float || format == MeshAttributeFormat::R16G16_SNorm;
+        case MeshSemantic::Color:
+            return format == MeshAttributeFormat::R32G32B32_Float || format == MeshAttributeFormat::R8G8B8A8_UNorm;
+        case MeshSemantic::TexCoord:
+            return format == MeshAttributeFormat::R32G32_Float || format == MeshAttributeFormat::R16G16_Float;
+    }
+    return false;
+}
+
+//
+// MeshFile
+//
+MeshFile::MeshFile()
+    : m_Base(nullptr)
+    , m_Size(0)
+    , m_Header(nullptr)
+    , m_Submeshes(nullptr)
+    , m_Lods(nullptr) {
+}
+
+bool MeshFile::Open(const std::string& path) {
+    Close();
+
+    if (!m_MappedFile.Open(path)) {
+        return false;
+    }
+
+    if (!Open(m_MappedFile.GetData(), m_MappedFile.GetSize())) {
+        m_MappedFile.Close();
+        return false;
+    }
+    return true;
+}
+
+bool MeshFile::Open(const void* data, size_t size) {
+    m_Base = static_cast<const uint8_t*>(data);
+    m_Size = size;
+    m_Header = reinterpret_cast<const MeshFileHeader*>(m_Base);
+    m_Submeshes = reinterpret_cast<const MeshFileSubmesh*>(m_Base + sizeof(MeshFileHeader));
+
+    if (!Validate()) {
+        m_Base = nullptr;
+        m_Size = 0;
+        m_Header = nullptr;
+        m_Submeshes = nullptr;
+        return false;
+    }
+    m_Lods = reinterpret_cast<const MeshFileLod*>(m_Submeshes + m_Header->NumSubmeshes);
+    return true;
+}
+
+void MeshFile::Close() {
+    m_MappedFile.Close();
+    m_Base = nullptr;
+    m_Size = 0;
+    m_Header = nullptr;
+    m_Submeshes = nullptr;
+    m_Lods = nullptr;
+}
+
+bool MeshFile::Validate() const {
+    if (m_Size < sizeof(MeshFileHeader) || reinterpret_cast<uintptr_t>(m_Base) % alignof(MeshFileHeader) != 0) {
+        return false;
+    }
+
+    const MeshFileHeader& header = *m_Header;
+    if (header.Magic != MeshFileMagic || header.Version != MeshFileVersion) {
+        return false;
+    }
+
+    // Everything is checked against the size so a truncated or corrupt file cannot be read out of bounds.
+    if (header.NumSubmeshes > (m_Size - sizeof(MeshFileHeader)) / sizeof(MeshFileSubmesh) ||
+        header.NumLods > (m_Size - sizeof(MeshFileHeader) - header.NumSubmeshes * sizeof(MeshFileSubmesh)) / sizeof(MeshFileLod) ||
+        header.DataOffset < sizeof(MeshFileHeader) + header.NumSubmeshes * sizeof(MeshFileSubmesh) + header.NumLods * sizeof(MeshFileLod) ||
+        header.DataOffset > m_Size || header.DataSize > m_Size - header.DataOffset) {
+        return false;
+    }
+
+    // The sections are read in place as arrays of their types, so they must be aligned
+    // like the builder aligns them. The start of the file is aligned for the header.
+    if (header.DataOffset % MeshFileDataAlignment != 0) {
+        return false;
+    }
+
+    if (header.NumStreams == 0 || header.NumStreams > MeshFileMaxStreams) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header.NumStreams; ++i) {
+        const MeshFileStream& stream = header.Streams[i];
+        if (stream.Stride == 0 || stream.NumAttributes > MeshFileMaxAttributes || stream.Offset % MeshFileDataAlignment != 0 ||
+            stream.Offset > header.DataSize || uint64_t(stream.Stride) * header.NumVertices > header.DataSize - stream.Offset) {
+            return false;
+        }
+        for (uint32_t j = 0; j < stream.NumAttributes; ++j) {
+            const MeshFileAttribute& attribute = stream.Attributes[j];
+            uint32_t size = GetMeshAttributeFormatSize(attribute.Format);
+            if (!IsMeshAttributeFormatSupported(attribute.Semantic, attribute.Format) ||
+                attribute.Offset > stream.Stride || size > stream.Stride - attribute.Offset) {
+                return false;
+            }
+        }
+    }
+
+    if ((header.IndexSize != 2 && header.IndexSize != 4) || header.IndexOffset % MeshFileDataAlignment != 0 ||
+        header.IndexOffset > header.DataSize || uint64_t(header.IndexSize) * header.NumIndices > header.DataSize - header.IndexOffset) {
+        return false;
+    }
+
+    if (header.MeshletOffset > header.DataSize ||
+        uint64_t(sizeof(MeshFileMeshlet)) * header.NumMeshlets > header.DataSize - header.MeshletOffset ||
+        header.MeshletVertexOffset > header.DataSize ||
+        uint64_t(sizeof(uint32_t)) * header.NumMeshletVertices > header.DataSize - header.MeshletVertexOffset ||
+        header.MeshletTriangleOffset > header.DataSize ||
+        uint64_t(sizeof(uint32_t)) * header.NumMeshletTriangles > header.DataSize - header.MeshletTriangleOffset ||
+        header.MeshletOffset % MeshFileDataAlignment != 0 || header.MeshletVertexOffset % MeshFileDataAlignment != 0 ||
+        header.MeshletTriangleOffset % MeshFileDataAlignment != 0) {
+        return false;
+    }
+
+    // Indices out of the vertices would make the GPU and the tools read past the streams.
+    const uint8_t* indexData = m_Base + header.DataOffset + header.IndexOffset;
+    if (header.IndexSize == 2 ? !AreIndicesInRange<uint16_t>(indexData, header.NumIndices, header.NumVertices) :
+        !AreIndicesInRange<uint32_t>(indexData, header.NumIndices, header.NumVertices)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.NumSubmeshes; ++i) {
+        const MeshFileSubmesh& submesh = m_Submeshes[i];
+        if (submesh.FirstIndex > header.NumIndices || submesh.NumIndices > header.NumIndices - submesh.FirstIndex ||
+            submesh.FirstVertex > header.NumVertices || submesh.NumVertices > header.NumVertices - submesh.FirstVertex ||
+            submesh.FirstMeshlet > header.NumMeshlets || submesh.NumMeshlets > header.NumMeshlets - submesh.FirstMeshlet ||
+            submesh.FirstLod > header.NumLods || submesh.NumLods > header.NumLods - submesh.FirstLod) {
+            return false;
+        }
+    }
+
+    const MeshFileLod* lods = reinterpret_cast<const MeshFileLod*>(m_Submeshes + header.NumSubmeshes);
+    for (uint32_t i = 0; i < header.NumLods; ++i) {
+        const MeshFileLod& lod = lods[i];
+        if (lod.FirstIndex > header.NumIndices || lod.NumIndices > header.NumIndices - lod.FirstIndex) {
+            return false;
+        }
+    }
+
+    // The vertices and triangles of the meshlets are read by shaders, only their ranges are checked.
+    const MeshFileMeshlet* meshlets = reinterpret_cast<const MeshFileMeshlet*>(m_Base + header.DataOffset + header.MeshletOffset);
+    for (uint32_t i = 0; i < header.NumMeshlets; ++i) {
+        const MeshFileMeshlet& meshlet = meshlets[i];
+        if (meshlet.NumVertices > MaxMeshletVertices || meshlet.NumTriangles > MaxMeshletTriangles ||
+            meshlet.VertexOffset > header.NumMeshletVertices || meshlet.NumVertices > header.NumMeshletVertices - meshlet.VertexOffset ||
+            meshlet.TriangleOffset > header.NumMeshletTriangles ||
+            meshlet.NumTriangles > header.NumMeshletTriangles - meshlet.TriangleOffset) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const MeshFileHeader& MeshFile::GetHeader() const {
+    assert(m_Header && "The mesh file is not open.");
+    return *m_Header;
+}
+
+const MeshFileSubmesh& MeshFile::GetSubmesh(uint32_t submesh) const {
+    assert(submesh < GetHeader().NumSubmeshes && "Invalid submesh.");
+    return m_Submeshes[submesh];
+}
+
+const MeshFileLod& MeshFile::GetLod(uint32_t lod) const {
+    assert(lod < GetHeader().NumLods && "Invalid level of detail.");
+    return m_Lods[lod];
+}
+
+const uint8_t* MeshFile::GetData() const {
+    return m_Base + GetHeader().DataOffset;
+}
+
+uint64_t MeshFile::GetDataSize() const {
+    return GetHeader().DataSize;
+}
+
+const uint8_t* MeshFile::GetStreamData(uint32_t stream) const {
+    assert(stream < GetHeader().NumStreams && "Invalid stream.");
+    return GetData() + GetHeader().Streams[stream].Offset;
+}
+
+const uint8_t* MeshFile::GetIndexData() const {
+    return GetData() + GetHeader().IndexOffset;
+}
+
+const MeshFileMeshlet* MeshFile::GetMeshlets() const {
+    return reinterpret_cast<const MeshFileMeshlet*>(GetData() + GetHeader().MeshletOffset);
+}
+
+const uint32_t* MeshFile::GetMeshletVertices() const {
+    return reinterpret_cast<const uint32_t*>(GetData() + GetHeader().MeshletVertexOffset);
+}
+
+const uint32_t* MeshFile::GetMeshletTriangles() const {
+    return reinterpret_cast<const uint32_t*>(GetData() + GetHeader().MeshletTriangleOffset);
+}
+
+//
+// MeshFileBuilder
+//
+MeshFileBuilder::MeshFileBuilder()
+    : m_NumVertices(0) {
+}
+
+void MeshFileBuilder::AddStream(const MeshFileAttribute* attributes, uint32_t numAttributes, uint32_t stride,
+    const void* vertices, uint32_t numVertices) {
+    assert(m_Streams.size() < MeshFileMaxStreams && "Too many streams.");
+    assert(numAttributes <= MeshFileMaxAttributes && "Too many attributes.");
+    assert((m_Streams.empty() || numVertices == m_NumVertices) && "All streams must have the same number of vertices.");
+
+    Stream stream;
+    std::memset(&stream.desc, 0, sizeof(stream.desc));
+    stream.desc.Stride = stride;
+    stream.desc.NumAttributes = numAttributes;
+    std::copy(attributes, attributes + numAttributes, stream.desc.Attributes);
+    stream.data.assign(static_cast<const uint8_t*>(vertices), static_cast<const uint8_t*>(vertices) + size_t(stride) * numVertices);
+
+    m_Streams.push_back(std::move(stream));
+    m_NumVertices = numVertices;
+}
+
+void MeshFileBuilder::SetIndices(const uint32_t* indices, uint32_t numIndices) {
+    m_Indices.assign(indices, indices + numIndices);
+}
+
+void MeshFileBuilder::AddSubmesh(uint32_t firstIndex, uint32_t numIndices, const MeshFileBounds& bounds) {
+    assert(firstIndex + numIndices <= m_Indices.size() && "The submesh is out of the indices.");
+
+    MeshFileSubmesh submesh = {};
+    submesh.FirstIndex = firstIndex;
+    submesh.NumIndices = numIndices;
+    submesh.Bounds = bounds;
+
+    if (numIndices > 0) {
+        auto range = std::minmax_element(m_Indices.begin() + firstIndex, m_Indices.begin() + firstIndex + numIndices);
+        submesh.FirstVertex = *range.first;
+        submesh.NumVertices = *range.second - *range.first + 1;
+    }
+
+    m_Submeshes.push_back(submesh);
+}
+
+void MeshFileBuilder::AddMeshlets(const MeshFileMeshlet* meshlets, uint32_t numMeshlets, const uint32_t* vertices, uint32_t numVertices,
+    const uint32_t* triangles, uint32_t numTriangles) {
+    assert(!m_Submeshes.empty() && "There is no submesh to add the meshlets to.");
+
+    MeshFileSubmesh& submesh = m_Submeshes.back();
+    if (submesh.NumMeshlets == 0) {
+        submesh.FirstMeshlet = static_cast<uint32_t>(m_Meshlets.size());
+    }
+    assert(submesh.FirstMeshlet + submesh.NumMeshlets == m_Meshlets.size() && "Meshlets must be added to the last submesh.");
+    submesh.NumMeshlets += numMeshlets;
+
+    const uint32_t vertexOffset = static_cast<uint32_t>(m_MeshletVertices.size());
+    const uint32_t triangleOffset = static_cast<uint32_t>(m_MeshletTriangles.size());
+    for (uint32_t i = 0; i < numMeshlets; ++i) {
+        MeshFileMeshlet meshlet = meshlets[i];
+        assert(meshlet.VertexOffset + meshlet.NumVertices <= numVertices && meshlet.TriangleOffset + meshlet.NumTriangles <= numTriangles &&
+            "The meshlet is out of the vertices or triangles.");
+        meshlet.VertexOffset += vertexOffset;
+        meshlet.TriangleOffset += triangleOffset;
+        m_Meshlets.push_back(meshlet);
+    }
+    m_MeshletVertices.insert(m_MeshletVertices.end(), vertices, vertices + numVertices);
+    m_MeshletTriangles.insert(m_MeshletTriangles.end(), triangles, triangles + numTriangles);
+}
+
+void MeshFileBuilder::AddLod(uint32_t firstIndex, uint32_t numIndices, float error) {
+    assert(!m_Submeshes.empty() && "There is no submesh to add the level of detail to.");
+    assert(firstIndex + numIndices <= m_Indices.size() && "The level of detail is out of the indices.");
+
+    MeshFileSubmesh& submesh = m_Submeshes.back();
+    if (submesh.NumLods == 0) {
+        submesh.FirstLod = static_cast<uint32_t>(m_Lods.size());
+    }
+    assert(submesh.FirstLod + submesh.NumLods == m_Lods.size() && "Levels of detail must be added to the last submesh.");
+    ++submesh.NumLods;
+
+    MeshFileLod lod = {};
+    lod.FirstIndex = firstIndex;
+    lod.NumIndices = numIndices;
+    lod.Error = error;
+    m_Lods.push_back(lod);
+}
+
+MeshFileBounds MeshFileBuilder::ComputeBounds(const void* positions, size_t stride, const uint32_t* indices, uint32_t numIndices) {
+    MeshFileBounds bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    for (uint32_t i = 0; i < numIndices; ++i) {
+        float position[3];
+        std::memcpy(position, static_cast<const uint8_t*>(positions) + indices[i] * stride, sizeof(position));
+        for (int j = 0; j < 3; ++j) {
+            bounds.Min[j] = std::min(bounds.Min[j], position[j]);
+            bounds.Max[j] = std::max(bounds.Max[j], position[j]);
+        }
+    }
+
+    if (numIndices == 0) {
+        bounds = MeshFileBounds{};
+    }
+    return bounds;
+}
+
+std::vector<uint8_t> MeshFileBuilder::Build() const {
+    assert(!m_Streams.empty() && "A mesh needs at least one stream.");
+
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.Magic = MeshFileMagic;
+    header.Version = MeshFileVersion;
+    header.NumVertices = m_NumVertices;
+    header.NumIndices = static_cast<uint32_t>(m_Indices.size());
+    header.IndexSize = m_NumVertices <= 0x10000 ? 2 : 4;
+    header.NumStreams = static_cast<uint32_t>(m_Streams.size());
+    header.NumSubmeshes = static_cast<uint32_t>(m_Submeshes.size());
+    header.NumMeshlets = static_cast<uint32_t>(m_Meshlets.size());
+    header.NumMeshletVertices = static_cast<uint32_t>(m_MeshletVertices.size());
+    header.NumMeshletTriangles = static_cast<uint32_t>(m_MeshletTriangles.size());
+    header.NumLods = static_cast<uint32_t>(m_Lods.size());
+
+    for (size_t i = 0; i < m_Submeshes.size(); ++i) {
+        const MeshFileBounds& bounds = m_Submeshes[i].Bounds;
+        for (int j = 0; j < 3; ++j) {
+            header.Bounds.Min[j] = i == 0 ? bounds.Min[j] : std::min(header.Bounds.Min[j], bounds.Min[j]);
+            header.Bounds.Max[j] = i == 0 ? bounds.Max[j] : std::max(header.Bounds.Max[j], bounds.Max[j]);
+        }
+    }
+
+    // Lay out the data section.
+    uint64_t dataSize = 0;
+    for (size_t i = 0; i < m_Streams.size(); ++i) {
+        header.Streams[i] = m_Streams[i].desc;
+        header.Streams[i].Offset = dataSize;
+        dataSize = AlignUp(dataSize + m_Streams[i].data.size(), MeshFileDataAlignment);
+    }
+    header.IndexOffset = dataSize;
+    dataSize += uint64_t(header.IndexSize) * header.NumIndices;
+    if (!m_Meshlets.empty()) {
+        header.MeshletOffset = dataSize = AlignUp(dataSize, MeshFileDataAlignment);
+        dataSize += m_Meshlets.size() * sizeof(MeshFileMeshlet);
+        header.MeshletVertexOffset = dataSize = AlignUp(dataSize, MeshFileDataAlignment);
+        dataSize += m_MeshletVertices.size() * sizeof(uint32_t);
+        header.MeshletTriangleOffset = dataSize = AlignUp(dataSize, MeshFileDataAlignment);
+        dataSize += m_MeshletTriangles.size() * sizeof(uint32_t);
+    }
+
+    header.DataOffset = AlignUp(sizeof(MeshFileHeader) + m_Submeshes.size() * sizeof(MeshFileSubmesh) + m_Lods.size() * sizeof(MeshFileLod),
+        MeshFileDataAlignment);
+    header.DataSize = dataSize;
+
+    std::vector<uint8_t> file(static_cast<size_t>(header.DataOffset + header.DataSize), 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    if (!m_Submeshes.empty()) {
+        std::memcpy(file.data() + sizeof(header), m_Submeshes.data(), m_Submeshes.size() * sizeof(MeshFileSubmesh));
+    }
+    if (!m_Lods.empty()) {
+        std::memcpy(file.data() + sizeof(header) + m_Submeshes.size() * sizeof(MeshFileSubmesh), m_Lods.data(),
+            m_Lods.size() * sizeof(MeshFileLod));
+    }
+
+    uint8_t* data = file.data() + header.DataOffset;
+    for (size_t i = 0; i < m_Streams.size(); ++i) {
+        if (!m_Streams[i].data.empty()) {
+            std::memcpy(data + header.Streams[i].Offset, m_Streams[i].data.data(), m_Streams[i].data.size());
+        }
+    }
+
+    uint8_t* indexData = data + header.IndexOffset;
+    for (size_t i = 0; i < m_Indices.size(); ++i) {
+        assert(m_Indices[i] < m_NumVertices && "Index out of the vertices.");
+        if (header.IndexSize == 2) {
+            uint16_t index = static_cast<uint16_t>(m_Indices[i]);
+            std::memcpy(indexData + i * 2, &index, 2);
+        } else {
+            std::memcpy(indexData + i * 4, &m_Indices[i], 4);
+        }
+    }
+
+    if (!m_Meshlets.empty()) {
+        std::memcpy(data + header.MeshletOffset, m_Meshlets.data(), m_Meshlets.size() * sizeof(MeshFileMeshlet));
+        std::memcpy(data + header.MeshletVertexOffset, m_MeshletVertices.data(), m_MeshletVertices.size() * sizeof(uint32_t));
+        std::memcpy(data + header.MeshletTriangleOffset, m_MeshletTriangles.data(), m_MeshletTriangles.size() * sizeof(uint32_t));
+    }
+
+    return file;
+}
+
+bool MeshFileBuilder::Write(const std::string& path) const {
+    std::vector<uint8_t> file = Build();
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        return false;
+    }
+    stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+    return static_cast<bool>(stream);
+}
@@ -0,0 +1,57 @@
+#include "meshinputlayout.h"
+
+#include <cassert>
+
+static const char* GetSemanticName(MeshSemantic semantic) {
+    switch (semantic) {
+        case MeshSemantic::Position:
+            return "POSITION";
+        case MeshSemantic::Normal:
+            return "NORMAL";
+        case MeshSemantic::Color:
+            return "COLOR";
+        case MeshSemantic::TexCoord:
+            return "TEXCOORD";
+    }
+    return nullptr;
+}
+
+DXGI_FORMAT ToDXGIFormat(MeshAttributeFormat format) {
+    switch (format) {
+        case MeshAttributeFormat::R32G32B32_Float:
+            return DXGI_FORMAT_R32G32B32_FLOAT;
+        case MeshAttributeFormat::R32G32_Float:
+            return DXGI_FORMAT_R32G32_FLOAT;
+        case MeshAttributeFormat::R16G16B16A16_UNorm:
+            return DXGI_FORMAT_R16G16B16A16_UNORM;
+        case MeshAttributeFormat::R16G16_SNorm:
+            return DXGI_FORMAT_R16G16_SNORM;
+        case MeshAttributeFormat::R8G8B8A8_UNorm:
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case MeshAttributeFormat::R16G16_Float:
+            return DXGI_FORMAT_R16G16_FLOAT;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> CreateMeshInputLayout(const MeshFileHeader& header) {
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+    for (uint32_t i = 0; i < header.NumStreams; ++i) {
+        const MeshFileStream& stream = header.Streams[i];
+        for (uint32_t j = 0; j < stream.NumAttributes; ++j) {
+            const MeshFileAttribute& attribute = stream.Attributes[j];
+            assert(IsMeshAttributeFormatSupported(attribute.Semantic, attribute.Format) && "The mesh file has not been validated.");
+
+            D3D12_INPUT_ELEMENT_DESC element = {};
+            element.SemanticName = GetSemanticName(attribute.Semantic);
+            element.SemanticIndex = attribute.SemanticIndex;
+            element.Format = ToDXGIFormat(attribute.Format);
+            element.InputSlot = i;
+            element.AlignedByteOffset = attribute.Offset;
+            element.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+            element.InstanceDataStepRate = 0;
+            inputLayout.push_back(element);
+        }
+    }
+    return inputLayout;
+}
@@ -0,0 +1,220 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Marks vertices that are not in the meshlet being built.
+const uint32_t NotInMeshlet = ~0u;
+
+struct Vector3 {
+    float x, y, z;
+};
+
+Vector3 operator+(const Vector3& a, const Vector3& b) {
+    return Vector3{ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+Vector3 operator-(const Vector3& a, const Vector3& b) {
+    return Vector3{ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+Vector3 operator*(const Vector3& a, float s) {
+    return Vector3{ a.x * s, a.y * s, a.z * s };
+}
+
+float Dot(const Vector3& a, const Vector3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vector3 Cross(const Vector3& a, const Vector3& b) {
+    return Vector3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Length(const Vector3& a) {
+    return std::sqrt(Dot(a, a));
+}
+
+Vector3 LoadPosition(const void* positions, size_t stride, uint32_t vertex) {
+    Vector3 position;
+    std::memcpy(&position, static_cast<const uint8_t*>(positions) + vertex * stride, sizeof(position));
+    return position;
+}
+
+// Ritter's bounding sphere, grown until it contains all points. Not minimal but close.
+void ComputeBoundingSphere(const std::vector<Vector3>& points, Vector3& center, float& radius) {
+    // Start from the points furthest apart along the axis where the extreme points are furthest apart.
+    size_t minPoints[3] = {};
+    size_t maxPoints[3] = {};
+    for (size_t i = 1; i < points.size(); ++i) {
+        const float* point = &points[i].x;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (point[axis] < (&points[minPoints[axis]].x)[axis]) {
+                minPoints[axis] = i;
+            }
+            if (point[axis] > (&points[maxPoints[axis]].x)[axis]) {
+                maxPoints[axis] = i;
+            }
+        }
+    }
+
+    int spanAxis = 0;
+    float span = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        const Vector3 extent = points[maxPoints[axis]] - points[minPoints[axis]];
+        if (Dot(extent, extent) > span) {
+            span = Dot(extent, extent);
+            spanAxis = axis;
+        }
+    }
+
+    const Vector3& a = points[minPoints[spanAxis]];
+    const Vector3& b = points[maxPoints[spanAxis]];
+    center = (a + b) * 0.5f;
+    radius = Length(b - a) * 0.5f;
+
+    for (const Vector3& point : points) {
+        const float distance = Length(point - center);
+        if (distance > radius) {
+            // Move the center towards the point so the sphere touches it and still contains the old sphere.
+            const float newRadius = (radius + distance) * 0.5f;
+            center = center + (point - center) * ((newRadius - radius) / distance);
+            radius = newRadius;
+        }
+    }
+}
+
+}
+
+uint32_t PackMeshletTriangle(uint32_t i0, uint32_t i1, uint32_t i2) {
+    assert(i0 < 256 && i1 < 256 && i2 < 256 && "Meshlet indices are 8-bit.");
+    return i0 | (i1 << 8) | (i2 << 16);
+}
+
+void UnpackMeshletTriangle(uint32_t triangle, uint32_t* indices) {
+    indices[0] = triangle & 0xFF;
+    indices[1] = (triangle >> 8) & 0xFF;
+    indices[2] = (triangle >> 16) & 0xFF;
+}
+
+void BuildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint32_t>& meshletTriangles,
+    const uint32_t* indices, size_t numIndices, size_t numVertices, uint32_t maxVertices, uint32_t maxTriangles) {
+    assert(numIndices % 3 == 0 && "The indices are not a triangle list.");
+    assert(maxVertices >= 3 && maxVertices <= 256 && maxTriangles >= 1 && "Invalid meshlet limits.");
+
+    // Position of each vertex in the current meshlet.
+    std::vector<uint32_t> localIndices(numVertices, NotInMeshlet);
+
+    Meshlet meshlet = { static_cast<uint32_t>(meshletVertices.size()), static_cast<uint32_t>(meshletTriangles.size()), 0, 0 };
+
+    auto finishMeshlet = [&]() {
+        for (uint32_t i = 0; i < meshlet.numVertices; ++i) {
+            localIndices[meshletVertices[meshlet.vertexOffset + i]] = NotInMeshlet;
+        }
+        meshlets.push_back(meshlet);
+        meshlet = Meshlet{ static_cast<uint32_t>(meshletVertices.size()), static_cast<uint32_t>(meshletTriangles.size()), 0, 0 };
+    };
+
+    for (size_t i = 0; i < numIndices; i += 3) {
+        const uint32_t a = indices[i + 0];
+        const uint32_t b = indices[i + 1];
+        const uint32_t c = indices[i + 2];
+        assert(a < numVertices && b < numVertices && c < numVertices && "Index out of the vertices.");
+
+        if (a == b || b == c || c == a) {
+            continue;
+        }
+
+        const uint32_t numNewVertices = (localIndices[a] == NotInMeshlet) + (localIndices[b] == NotInMeshlet) +
+            (localIndices[c] == NotInMeshlet);
+        if (meshlet.numVertices + numNewVertices > maxVertices || meshlet.numTriangles == maxTriangles) {
+            finishMeshlet();
+        }
+
+        uint32_t local[3];
+        const uint32_t triangle[3] = { a, b, c };
+        for (int j = 0; j < 3; ++j) {
+            if (localIndices[triangle[j]] == NotInMeshlet) {
+                localIndices[triangle[j]] = meshlet.numVertices++;
+                meshletVertices.push_back(triangle[j]);
+            }
+            local[j] = localIndices[triangle[j]];
+        }
+        meshletTriangles.push_back(PackMeshletTriangle(local[0], local[1], local[2]));
+        ++meshlet.numTriangles;
+    }
+
+    if (meshlet.numTriangles > 0) {
+        finishMeshlet();
+    }
+}
+
+MeshletBounds ComputeMeshletBounds(const Meshlet& meshlet, const uint32_t* meshletVertices, const uint32_t* meshletTriangles,
+    const void* positions, size_t positionStride) {
+    MeshletBounds bounds = {};
+
+    std::vector<Vector3> points(meshlet.numVertices);
+    for (uint32_t i = 0; i < meshlet.numVertices; ++i) {
+        points[i] = LoadPosition(positions, positionStride, meshletVertices[meshlet.vertexOffset + i]);
+    }
+    if (points.empty()) {
+        bounds.coneCutoff = 1.0f;
+        return bounds;
+    }
+
+    Vector3 center;
+    ComputeBoundingSphere(points, center, bounds.radius);
+    bounds.center[0] = center.x;
+    bounds.center[1] = center.y;
+    bounds.center[2] = center.z;
+
+    // With clockwise front faces in a left-handed space the cross product points out of the front face.
+    std::vector<Vector3> normals;
+    normals.reserve(meshlet.numTriangles);
+    Vector3 axis = {};
+    for (uint32_t i = 0; i < meshlet.numTriangles; ++i) {
+        uint32_t triangle[3];
+        UnpackMeshletTriangle(meshletTriangles[meshlet.triangleOffset + i], triangle);
+        const Vector3& p0 = points[triangle[0]];
+        const Vector3 normal = Cross(points[triangle[1]] - p0, points[triangle[2]] - p0);
+        const float length = Length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal * (1.0f / length));
+            axis = axis + normals.back();
+        }
+    }
+
+    const float axisLength = Length(axis);
+    if (normals.empty() || axisLength == 0.0f) {
+        bounds.coneCutoff = 1.0f;
+        return bounds;
+    }
+    axis = axis * (1.0f / axisLength);
+
+    float minDot = 1.0f;
+    for (const Vector3& normal : normals) {
+        minDot = std::min(minDot, Dot(normal, axis));
+    }
+
+    bounds.coneAxis[0] = axis.x;
+    bounds.coneAxis[1] = axis.y;
+    bounds.coneAxis[2] = axis.z;
+    // Cones of 90 degrees and wider have front faces from every position.
+    bounds.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(std::max(1.0f - minDot * minDot, 0.0f));
+    return bounds;
+}
+
+bool IsMeshletBackFacing(const MeshletBounds& bounds, const float* cameraPosition) {
+    // A point sees all normals of the cone from behind if the angle between the axis and the direction to
+    // it is at most 90 degrees minus the cone angle, dot(d, axis) >= |d| * cutoff. That holds for all
+    // points of the sphere if it holds for the center with a margin of the radius times the Lipschitz
+    // constant of dot(d, axis) - |d| * cutoff, which is 1 + cutoff.
+    const Vector3 direction = {
+        bounds.center[0] - cameraPosition[0], bounds.center[1] - cameraPosition[1], bounds.center[2] - cameraPosition[2]
+    };
+    const Vector3 axis = { bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2] };
+    return Dot(direction, axis) - Length(direction) * bounds.coneCutoff > bounds.radius * (1.0f + bounds.coneCutoff);
+}
@@ -0,0 +1,385 @@
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation".
+const uint32_t ForsythCacheSize = 32;
+const float ForsythCacheDecayPower = 1.5f;
+const float ForsythLastTriangleScore = 0.75f;
+const float ForsythValenceBoostScale = 2.0f;
+const float ForsythValenceBoostPower = 0.5f;
+
+float ForsythVertexScore(int cachePosition, uint32_t numRemainingTriangles) {
+    if (numRemainingTriangles == 0) {
+        // Nothing left to draw with the vertex, it does not pull any triangle.
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The vertices of the last triangle get a fixed score so the strip direction is not preferred.
+            score = ForsythLastTriangleScore;
+        } else {
+            const float scale = 1.0f / (ForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, ForsythCacheDecayPower);
+        }
+    }
+
+    // Vertices with few triangles left are finished first so they do not have to be transformed again later.
+    score += ForsythValenceBoostScale * std::pow(static_cast<float>(numRemainingTriangles), -ForsythValenceBoostPower);
+    return score;
+}
+
+// Simulate a FIFO cache with timestamps, a vertex is cached if it was one of the last cacheSize misses.
+uint32_t UpdateCache(uint32_t a, uint32_t b, uint32_t c, uint32_t cacheSize, uint32_t* cacheTimestamps, uint32_t& timestamp) {
+    uint32_t misses = 0;
+    const uint32_t vertices[3] = { a, b, c };
+    for (uint32_t vertex : vertices) {
+        if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+            cacheTimestamps[vertex] = timestamp++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+void GetPosition(const void* positions, size_t stride, uint32_t vertex, float* position) {
+    std::memcpy(position, static_cast<const uint8_t*>(positions) + vertex * stride, 3 * sizeof(float));
+}
+
+}
+
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t numIndices, size_t numVertices) {
+    assert(numIndices % 3 == 0 && "The indices must form triangles.");
+
+    const size_t numTriangles = numIndices / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // The triangles of each vertex that have not been emitted yet.
+    std::vector<uint32_t> numRemainingTriangles(numVertices, 0);
+    for (size_t i = 0; i < numIndices; ++i) {
+        assert(indices[i] < numVertices && "Index out of the vertices.");
+        ++numRemainingTriangles[indices[i]];
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    for (size_t i = 0; i < numVertices; ++i) {
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + numRemainingTriangles[i];
+    }
+
+    std::vector<uint32_t> adjacency(numIndices);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < numIndices; ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<float> vertexScores(numVertices);
+    for (size_t i = 0; i < numVertices; ++i) {
+        vertexScores[i] = ForsythVertexScore(-1, numRemainingTriangles[i]);
+    }
+
+    std::vector<float> triangleScores(numTriangles);
+    for (size_t i = 0; i < numTriangles; ++i) {
+        triangleScores[i] = vertexScores[indices[i * 3 + 0]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+    }
+    std::vector<bool> emitted(numTriangles, false);
+
+    // The indices are read while the output is written, destination may alias them.
+    std::vector<uint32_t> output;
+    output.reserve(numIndices);
+
+    uint32_t cache[ForsythCacheSize + 3];
+    uint32_t newCache[ForsythCacheSize + 3];
+    uint32_t cacheSize = 0;
+
+    uint32_t bestTriangle = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    size_t inputCursor = 0;
+
+    for (size_t emittedTriangles = 0; emittedTriangles < numTriangles; ++emittedTriangles) {
+        if (bestTriangle == ~0u) {
+            // Nothing in the cache is connected to a remaining triangle, continue with the next one in input order.
+            while (emitted[inputCursor]) {
+                ++inputCursor;
+            }
+            bestTriangle = static_cast<uint32_t>(inputCursor);
+        }
+
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from its vertices, once per corner.
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t vertex = triangle[corner];
+            uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t* end = begin + numRemainingTriangles[vertex];
+            uint32_t* found = std::find(begin, end, bestTriangle);
+            assert(found != end && "The triangle is missing from the adjacency.");
+            *found = *(end - 1);
+            --numRemainingTriangles[vertex];
+        }
+
+        // The vertices of the triangle move to the front of the cache.
+        uint32_t newCacheSize = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            if (std::find(newCache, newCache + newCacheSize, triangle[corner]) == newCache + newCacheSize) {
+                newCache[newCacheSize++] = triangle[corner];
+            }
+        }
+        const uint32_t numTriangleVertices = newCacheSize;
+        for (uint32_t i = 0; i < cacheSize; ++i) {
+            if (std::find(newCache, newCache + numTriangleVertices, cache[i]) == newCache + numTriangleVertices) {
+                newCache[newCacheSize++] = cache[i];
+            }
+        }
+
+        // Update the scores of the vertices that entered, moved in or left the cache and of their triangles.
+        bestTriangle = ~0u;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < newCacheSize; ++i) {
+            uint32_t vertex = newCache[i];
+            // Vertices past the cache size have just been evicted.
+            int cachePosition = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+
+            float score = ForsythVertexScore(cachePosition, numRemainingTriangles[vertex]);
+            float scoreDelta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            const uint32_t* end = begin + numRemainingTriangles[vertex];
+            for (const uint32_t* adjacent = begin; adjacent != end; ++adjacent) {
+                float& triangleScore = triangleScores[*adjacent];
+                triangleScore += scoreDelta;
+                if (cachePosition >= 0 && triangleScore > bestScore) {
+                    bestScore = triangleScore;
+                    bestTriangle = *adjacent;
+                }
+            }
+        }
+
+        cacheSize = std::min(newCacheSize, ForsythCacheSize);
+        std::copy(newCache, newCache + cacheSize, cache);
+    }
+
+    std::copy(output.begin(), output.end(), destination);
+}
+
+void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t numIndices,
+    const void* positions, size_t positionStride, size_t numVertices, float threshold) {
+    assert(numIndices % 3 == 0 && "The indices must form triangles.");
+    assert(destination != indices && "The indices cannot be reordered in place.");
+
+    const size_t numTriangles = numIndices / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    const uint32_t cacheSize = DefaultVertexCacheSize;
+    std::vector<uint32_t> cacheTimestamps(numVertices, 0);
+    uint32_t timestamp = cacheSize + 1;
+
+    // Hard boundaries are where all three vertices miss the cache. The cache optimizer has started
+    // on a new part of the mesh there, reordering these clusters costs no cache efficiency.
+    std::vector<uint32_t> hardClusters;
+    for (size_t i = 0; i < numTriangles; ++i) {
+        uint32_t misses = UpdateCache(indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2], cacheSize,
+            cacheTimestamps.data(), timestamp);
+        if (i == 0 || misses == 3) {
+            hardClusters.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Soft boundaries split hard clusters wherever the ACMR up to there is within the threshold
+    // of the ACMR of the whole hard cluster. Each split restarts the cache, which the threshold pays for.
+    std::vector<uint32_t> clusters;
+    for (size_t i = 0; i < hardClusters.size(); ++i) {
+        const size_t begin = hardClusters[i];
+        const size_t end = i + 1 < hardClusters.size() ? hardClusters[i + 1] : numTriangles;
+
+        timestamp += cacheSize + 1;
+        uint32_t clusterMisses = 0;
+        for (size_t j = begin; j < end; ++j) {
+            clusterMisses += UpdateCache(indices[j * 3 + 0], indices[j * 3 + 1], indices[j * 3 + 2], cacheSize,
+                cacheTimestamps.data(), timestamp);
+        }
+        const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+        clusters.push_back(static_cast<uint32_t>(begin));
+
+        timestamp += cacheSize + 1;
+        uint32_t runningMisses = 0;
+        uint32_t runningTriangles = 0;
+        for (size_t j = begin; j < end; ++j) {
+            runningMisses += UpdateCache(indices[j * 3 + 0], indices[j * 3 + 1], indices[j * 3 + 2], cacheSize,
+                cacheTimestamps.data(), timestamp);
+            ++runningTriangles;
+
+            if (j + 1 < end && static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold) {
+                clusters.push_back(static_cast<uint32_t>(j + 1));
+                timestamp += cacheSize + 1;
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+
+    // Area weighted centroid of the mesh and of each cluster, and the area weighted normal of each cluster.
+    float meshCentroid[3] = {};
+    float meshArea = 0.0f;
+    std::vector<float> clusterCentroids(clusters.size() * 3, 0.0f);
+    std::vector<float> clusterNormals(clusters.size() * 3, 0.0f);
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const size_t begin = clusters[i];
+        const size_t end = i + 1 < clusters.size() ? clusters[i + 1] : numTriangles;
+
+        float clusterArea = 0.0f;
+        float* centroid = &clusterCentroids[i * 3];
+        float* normal = &clusterNormals[i * 3];
+        for (size_t j = begin; j < end; ++j) {
+            float p0[3], p1[3], p2[3];
+            GetPosition(positions, positionStride, indices[j * 3 + 0], p0);
+            GetPosition(positions, positionStride, indices[j * 3 + 1], p1);
+            GetPosition(positions, positionStride, indices[j * 3 + 2], p2);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            // Twice the area in length, the winding decides the direction.
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; ++k) {
+                centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * area;
+                normal[k] += n[k];
+            }
+            clusterArea += area;
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            meshCentroid[k] += centroid[k];
+            centroid[k] = clusterArea > 0.0f ? centroid[k] / clusterArea : 0.0f;
+        }
+        meshArea += clusterArea;
+
+        const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int k = 0; k < 3; ++k) {
+            normal[k] = normalLength > 0.0f ? normal[k] / normalLength : 0.0f;
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+    }
+
+    // Clusters that face away from the center are likely to occlude the others, draw them first.
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        const float* centroid = &clusterCentroids[i * 3];
+        const float* normal = &clusterNormals[i * 3];
+        sortKeys[i] = (centroid[0] - meshCentroid[0]) * normal[0] + (centroid[1] - meshCentroid[1]) * normal[1] +
+            (centroid[2] - meshCentroid[2]) * normal[2];
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t offset = 0;
+    for (uint32_t cluster : order) {
+        const size_t begin = clusters[cluster];
+        const size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : numTriangles;
+        std::copy(indices + begin * 3, indices + end * 3, destination + offset);
+        offset += (end - begin) * 3;
+    }
+    assert(offset == numIndices);
+}
+
+size_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t numIndices, size_t numVertices) {
+    std::fill(remap, remap + numVertices, ~0u);
+
+    uint32_t numRemappedVertices = 0;
+    for (size_t i = 0; i < numIndices; ++i) {
+        assert(indices[i] < numVertices && "Index out of the vertices.");
+        if (remap[indices[i]] == ~0u) {
+            remap[indices[i]] = numRemappedVertices++;
+        }
+    }
+    return numRemappedVertices;
+}
+
+void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t numIndices, const uint32_t* remap) {
+    for (size_t i = 0; i < numIndices; ++i) {
+        assert(remap[indices[i]] != ~0u && "The index refers to a removed vertex.");
+        destination[i] = remap[indices[i]];
+    }
+}
+
+void RemapVertexBuffer(void* destination, const void* vertices, size_t numVertices, size_t vertexSize, const uint32_t* remap) {
+    assert(destination != vertices && "The vertices cannot be remapped in place.");
+
+    for (size_t i = 0; i < numVertices; ++i) {
+        if (remap[i] != ~0u) {
+            std::memcpy(static_cast<uint8_t*>(destination) + remap[i] * vertexSize,
+                static_cast<const uint8_t*>(vertices) + i * vertexSize, vertexSize);
+        }
+    }
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t numIndices, size_t numVertices, uint32_t cacheSize) {
+    VertexCacheStatistics statistics = {};
+
+    std::vector<uint32_t> cacheTimestamps(numVertices, 0);
+    uint32_t timestamp = cacheSize + 1;
+    for (size_t i = 0; i + 2 < numIndices; i += 3) {
+        statistics.numTransformedVertices += UpdateCache(indices[i + 0], indices[i + 1], indices[i + 2], cacheSize,
+            cacheTimestamps.data(), timestamp);
+    }
+
+    size_t numReferencedVertices = 0;
+    for (uint32_t cacheTimestamp : cacheTimestamps) {
+        numReferencedVertices += cacheTimestamp != 0 ? 1 : 0;
+    }
+
+    const size_t numTriangles = numIndices / 3;
+    statistics.acmr = numTriangles > 0 ? static_cast<float>(statistics.numTransformedVertices) / numTriangles : 0.0f;
+    statistics.atvr = numReferencedVertices > 0 ? static_cast<float>(statistics.numTransformedVertices) / numReferencedVertices : 0.0f;
+    return statistics;
+}
+
+VertexFetchStatistics AnalyzeVertexFetch(const uint32_t* indices, size_t numIndices, size_t numVertices, size_t vertexSize) {
+    const size_t cacheLineSize = 64;
+    const uint32_t cacheSize = 16 * 1024 / cacheLineSize;
+
+    VertexFetchStatistics statistics = {};
+
+    std::vector<bool> referenced(numVertices, false);
+    std::vector<uint32_t> cacheTimestamps((numVertices * vertexSize + cacheLineSize - 1) / cacheLineSize, 0);
+    uint32_t timestamp = cacheSize + 1;
+    for (size_t i = 0; i < numIndices; ++i) {
+        const size_t begin = indices[i] * vertexSize;
+        const size_t end = begin + vertexSize;
+        for (size_t line = begin / cacheLineSize; line < (end + cacheLineSize - 1) / cacheLineSize; ++line) {
+            if (timestamp - cacheTimestamps[line] > cacheSize) {
+                cacheTimestamps[line] = timestamp++;
+                statistics.bytesFetched += cacheLineSize;
+            }
+        }
+        referenced[indices[i]] = true;
+    }
+
+    const size_t numReferencedVertices = std::count(referenced.begin(), referenced.end(), true);
+    statistics.overfetch = numReferencedVertices > 0 ?
+        static_cast<float>(statistics.bytesFetched) / (numReferencedVertices * vertexSize) : 0.0f;
+    return statistics;
+}
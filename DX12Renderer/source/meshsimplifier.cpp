@@ -0,0 +1,417 @@
+#include "meshsimplifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Border planes are weighted by the squared length of their edge times this, which keeps borders in place.
+const double BorderWeight = 10.0;
+
+struct Vector3 {
+    float x, y, z;
+};
+
+Vector3 operator-(const Vector3& a, const Vector3& b) {
+    return Vector3{ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+float Dot(const Vector3& a, const Vector3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vector3 Cross(const Vector3& a, const Vector3& b) {
+    return Vector3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Length(const Vector3& a) {
+    return std::sqrt(Dot(a, a));
+}
+
+// The symmetric matrix of the sum of squared distances to weighted planes, p^T A p + 2 b^T p + c.
+struct Quadric {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+};
+
+// Add the plane of the unit normal through point.
+void AddPlane(Quadric& quadric, const Vector3& normal, const Vector3& point, double weight) {
+    const double x = normal.x;
+    const double y = normal.y;
+    const double z = normal.z;
+    const double d = -Dot(normal, point);
+
+    quadric.a00 += weight * x * x;
+    quadric.a01 += weight * x * y;
+    quadric.a02 += weight * x * z;
+    quadric.a11 += weight * y * y;
+    quadric.a12 += weight * y * z;
+    quadric.a22 += weight * z * z;
+    quadric.b0 += weight * x * d;
+    quadric.b1 += weight * y * d;
+    quadric.b2 += weight * z * d;
+    quadric.c += weight * d * d;
+    quadric.weight += weight;
+}
+
+Quadric operator+(const Quadric& a, const Quadric& b) {
+    return Quadric{ a.a00 + b.a00, a.a01 + b.a01, a.a02 + b.a02, a.a11 + b.a11, a.a12 + b.a12, a.a22 + b.a22,
+        a.b0 + b.b0, a.b1 + b.b1, a.b2 + b.b2, a.c + b.c, a.weight + b.weight };
+}
+
+// Weighted average of the squared distances of the point to the planes.
+double EvaluateQuadric(const Quadric& quadric, const Vector3& point) {
+    const double x = point.x;
+    const double y = point.y;
+    const double z = point.z;
+    const double error =
+        quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z +
+        2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z) +
+        2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+    // Rounding can make the error of a point on all planes slightly negative.
+    return quadric.weight > 0.0 ? std::max(error, 0.0) / quadric.weight : 0.0;
+}
+
+struct Plane {
+    Vector3 normal;
+    float d;
+};
+
+// Largest distance of the point from the planes of the triangles.
+float GetMaxPlaneDistance(const std::vector<Plane>& planes, const std::vector<uint32_t>& triangles, const Vector3& point) {
+    float distance = 0.0f;
+    for (uint32_t triangle : triangles) {
+        const Plane& plane = planes[triangle];
+        distance = std::max(distance, std::abs(Dot(plane.normal, point) + plane.d));
+    }
+    return distance;
+}
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+struct Collapse {
+    // Welded vertices, from is removed.
+    uint32_t from;
+    uint32_t to;
+    // The quadric error, which orders the collapses.
+    double error;
+    // The largest distance of the target from the planes of the input triangles around both vertices.
+    float distance;
+};
+
+}
+
+size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t numIndices,
+    const void* positions, size_t positionStride, size_t numVertices,
+    size_t targetNumIndices, float targetError, float* resultError) {
+    assert(numIndices % 3 == 0 && "The indices must form triangles.");
+
+    std::vector<Vector3> vertexPositions(numVertices);
+    for (size_t i = 0; i < numVertices; ++i) {
+        std::memcpy(&vertexPositions[i], static_cast<const uint8_t*>(positions) + i * positionStride, sizeof(Vector3));
+    }
+
+    // Weld vertices with the same position to the first of them. Welded groups of several vertices are seams.
+    std::vector<uint32_t> welded(numVertices);
+    std::vector<bool> locked(numVertices, false);
+    {
+        std::vector<uint32_t> order(numVertices);
+        for (size_t i = 0; i < numVertices; ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        // Compares values, so 0 and -0 are the same.
+        auto samePosition = [&](uint32_t a, uint32_t b) {
+            const Vector3& pa = vertexPositions[a];
+            const Vector3& pb = vertexPositions[b];
+            return pa.x == pb.x && pa.y == pb.y && pa.z == pb.z;
+        };
+        auto less = [&](uint32_t a, uint32_t b) {
+            const Vector3& pa = vertexPositions[a];
+            const Vector3& pb = vertexPositions[b];
+            if (pa.x != pb.x) {
+                return pa.x < pb.x;
+            }
+            if (pa.y != pb.y) {
+                return pa.y < pb.y;
+            }
+            if (pa.z != pb.z) {
+                return pa.z < pb.z;
+            }
+            return a < b;
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        for (size_t i = 0; i < numVertices;) {
+            size_t end = i + 1;
+            while (end < numVertices && samePosition(order[i], order[end])) {
+                ++end;
+            }
+            for (size_t j = i; j < end; ++j) {
+                welded[order[j]] = order[i];
+            }
+            locked[order[i]] = end - i > 1;
+            i = end;
+        }
+    }
+
+    // Triangles keep their vertices, degenerate ones are dropped.
+    std::vector<uint32_t> triangles;
+    triangles.reserve(numIndices);
+    for (size_t i = 0; i < numIndices; i += 3) {
+        const uint32_t a = welded[indices[i + 0]];
+        const uint32_t b = welded[indices[i + 1]];
+        const uint32_t c = welded[indices[i + 2]];
+        if (a != b && b != c && c != a) {
+            triangles.insert(triangles.end(), indices + i, indices + i + 3);
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeCounts;
+    auto countEdges = [&]() {
+        edgeCounts.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int j = 0; j < 3; ++j) {
+                ++edgeCounts[EdgeKey(welded[triangles[i + j]], welded[triangles[i + (j + 1) % 3]])];
+            }
+        }
+    };
+
+    // The planes of the triangles around each welded vertex, weighted by their area, and the planes through the borders.
+    std::vector<Quadric> quadrics(numVertices, Quadric{});
+    // The quadrics average the squared distances, which hides the largest one. The error reported is the largest
+    // distance of a vertex from the planes of the input triangles it stands in for, kept as sorted lists of them.
+    std::vector<Plane> planes;
+    std::vector< std::vector<uint32_t> > vertexPlanes(numVertices);
+    countEdges();
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        const Vector3& p0 = vertexPositions[triangles[i + 0]];
+        const Vector3& p1 = vertexPositions[triangles[i + 1]];
+        const Vector3& p2 = vertexPositions[triangles[i + 2]];
+        Vector3 normal = Cross(p1 - p0, p2 - p0);
+        const float length = Length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+        normal = Vector3{ normal.x / length, normal.y / length, normal.z / length };
+
+        for (int j = 0; j < 3; ++j) {
+            AddPlane(quadrics[welded[triangles[i + j]]], normal, p0, 0.5 * length);
+            vertexPlanes[welded[triangles[i + j]]].push_back(static_cast<uint32_t>(planes.size()));
+        }
+        planes.push_back(Plane{ normal, -Dot(normal, p0) });
+
+        for (int j = 0; j < 3; ++j) {
+            const uint32_t a = welded[triangles[i + j]];
+            const uint32_t b = welded[triangles[i + (j + 1) % 3]];
+            if (edgeCounts[EdgeKey(a, b)] != 1) {
+                continue;
+            }
+
+            // The plane through the border edge perpendicular to the triangle.
+            const Vector3 edge = vertexPositions[b] - vertexPositions[a];
+            Vector3 borderNormal = Cross(edge, normal);
+            const float borderLength = Length(borderNormal);
+            if (borderLength > 0.0f) {
+                borderNormal = Vector3{ borderNormal.x / borderLength, borderNormal.y / borderLength, borderNormal.z / borderLength };
+                const double weight = BorderWeight * Dot(edge, edge);
+                AddPlane(quadrics[a], borderNormal, vertexPositions[a], weight);
+                AddPlane(quadrics[b], borderNormal, vertexPositions[b], weight);
+            }
+        }
+    }
+
+    const size_t targetNumTriangles = targetNumIndices / 3;
+    // The mean of the squared distances is at most the square of the largest distance.
+    const double maxQuadricError = double(targetError) * targetError;
+    float error = 0.0f;
+
+    std::vector<uint32_t> triangleOffsets(numVertices + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<bool> border(numVertices);
+    std::vector<bool> touched(numVertices);
+    std::vector<uint32_t> remap(numVertices);
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> mergedPlanes;
+
+    while (triangles.size() / 3 > targetNumTriangles) {
+        const size_t numTriangles = triangles.size() / 3;
+
+        // The triangles around each welded vertex.
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (uint32_t index : triangles) {
+            ++triangleOffsets[welded[index] + 1];
+        }
+        for (size_t i = 0; i < numVertices; ++i) {
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        }
+        vertexTriangles.resize(triangles.size());
+        {
+            std::vector<uint32_t> next(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                vertexTriangles[next[welded[triangles[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        countEdges();
+        std::fill(border.begin(), border.end(), false);
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int j = 0; j < 3; ++j) {
+                const uint32_t a = welded[triangles[i + j]];
+                const uint32_t b = welded[triangles[i + (j + 1) % 3]];
+                if (edgeCounts[EdgeKey(a, b)] == 1) {
+                    border[a] = true;
+                    border[b] = true;
+                }
+            }
+        }
+
+        // Collapse candidates in both directions of every edge. Border vertices only move along the border.
+        collapses.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int j = 0; j < 3; ++j) {
+                const uint32_t a = welded[triangles[i + j]];
+                const uint32_t b = welded[triangles[i + (j + 1) % 3]];
+                const bool borderEdge = edgeCounts[EdgeKey(a, b)] == 1;
+                const uint32_t ends[2][2] = { { a, b }, { b, a } };
+                for (const auto& end : ends) {
+                    if (locked[end[0]] || (border[end[0]] && !borderEdge)) {
+                        continue;
+                    }
+                    const Vector3& target = vertexPositions[end[1]];
+                    const double collapseError = EvaluateQuadric(quadrics[end[0]] + quadrics[end[1]], target);
+                    if (collapseError > maxQuadricError) {
+                        continue;
+                    }
+                    const float distance = std::max(GetMaxPlaneDistance(planes, vertexPlanes[end[0]], target),
+                        GetMaxPlaneDistance(planes, vertexPlanes[end[1]], target));
+                    if (distance <= targetError) {
+                        collapses.push_back(Collapse{ end[0], end[1], collapseError, distance });
+                    }
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        // Apply the cheapest collapses whose triangles are not changed by another collapse of the pass.
+        for (size_t i = 0; i < numVertices; ++i) {
+            remap[i] = static_cast<uint32_t>(i);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        size_t numRemainingTriangles = numTriangles;
+
+        for (const Collapse& collapse : collapses) {
+            if (numRemainingTriangles <= targetNumTriangles) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            const Vector3& target = vertexPositions[collapse.to];
+            uint32_t toVertex = ~0u;
+            size_t numRemoved = 0;
+            bool flips = false;
+            for (uint32_t k = triangleOffsets[collapse.from]; k < triangleOffsets[collapse.from + 1] && !flips; ++k) {
+                const uint32_t* triangle = &triangles[vertexTriangles[k] * 3];
+                int fromCorner = -1;
+                int toCorner = -1;
+                for (int j = 0; j < 3; ++j) {
+                    if (welded[triangle[j]] == collapse.from) {
+                        fromCorner = j;
+                    } else if (welded[triangle[j]] == collapse.to) {
+                        toCorner = j;
+                    }
+                }
+
+                if (toCorner >= 0) {
+                    // The triangle collapses. The vertex of the edge keeps the attributes on this side of any seam at the target.
+                    toVertex = triangle[toCorner];
+                    ++numRemoved;
+                    continue;
+                }
+
+                Vector3 corners[3] = { vertexPositions[triangle[0]], vertexPositions[triangle[1]], vertexPositions[triangle[2]] };
+                const Vector3 before = Cross(corners[1] - corners[0], corners[2] - corners[0]);
+                corners[fromCorner] = target;
+                const Vector3 after = Cross(corners[1] - corners[0], corners[2] - corners[0]);
+                flips = Dot(before, after) <= 0.0f;
+            }
+            if (flips || toVertex == ~0u) {
+                continue;
+            }
+
+            // The vertices may only share the neighbours of the collapsed triangles, otherwise the surface folds onto itself.
+            size_t numSharedNeighbours = 0;
+            for (uint32_t k = triangleOffsets[collapse.from]; k < triangleOffsets[collapse.from + 1]; ++k) {
+                for (int j = 0; j < 3; ++j) {
+                    const uint32_t neighbour = welded[triangles[vertexTriangles[k] * 3 + j]];
+                    if (neighbour == collapse.from || neighbour == collapse.to) {
+                        continue;
+                    }
+                    for (uint32_t l = triangleOffsets[collapse.to]; l < triangleOffsets[collapse.to + 1]; ++l) {
+                        const uint32_t* triangle = &triangles[vertexTriangles[l] * 3];
+                        if (welded[triangle[0]] == neighbour || welded[triangle[1]] == neighbour || welded[triangle[2]] == neighbour) {
+                            ++numSharedNeighbours;
+                            break;
+                        }
+                    }
+                }
+            }
+            // Each neighbour is seen from both triangles around it, except the ones of the collapsed triangles.
+            if (numSharedNeighbours > numRemoved * 2) {
+                continue;
+            }
+
+            // Vertices that are not seams are welded only to themselves.
+            remap[collapse.from] = toVertex;
+            quadrics[collapse.to] = quadrics[collapse.to] + quadrics[collapse.from];
+            mergedPlanes.clear();
+            std::set_union(vertexPlanes[collapse.to].begin(), vertexPlanes[collapse.to].end(),
+                vertexPlanes[collapse.from].begin(), vertexPlanes[collapse.from].end(), std::back_inserter(mergedPlanes));
+            vertexPlanes[collapse.to].swap(mergedPlanes);
+            vertexPlanes[collapse.from] = std::vector<uint32_t>();
+            error = std::max(error, collapse.distance);
+            numRemainingTriangles -= numRemoved;
+
+            for (uint32_t k = triangleOffsets[collapse.from]; k < triangleOffsets[collapse.from + 1]; ++k) {
+                const uint32_t* triangle = &triangles[vertexTriangles[k] * 3];
+                for (int j = 0; j < 3; ++j) {
+                    touched[welded[triangle[j]]] = true;
+                }
+            }
+        }
+
+        // Move the collapsed vertices and drop the triangles that became degenerate.
+        size_t numKept = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const uint32_t a = remap[triangles[i + 0]];
+            const uint32_t b = remap[triangles[i + 1]];
+            const uint32_t c = remap[triangles[i + 2]];
+            if (welded[a] != welded[b] && welded[b] != welded[c] && welded[c] != welded[a]) {
+                triangles[numKept++] = a;
+                triangles[numKept++] = b;
+                triangles[numKept++] = c;
+            }
+        }
+        triangles.resize(numKept);
+
+        if (triangles.size() / 3 == numTriangles) {
+            break;
+        }
+    }
+
+    std::copy(triangles.begin(), triangles.end(), destination);
+    if (resultError) {
+        *resultError = error;
+    }
+    return triangles.size();
+}
@@ -0,0 +1,164 @@
+#include "parallelcommandrecorder.h"
+
+#include "commandqueue.h"
+#include "jobsystem.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+
+const uint32_t ParallelCommandRecorder::MaxRenderTargets;
+const uint32_t ParallelCommandRecorder::MaxDescriptorHeaps;
+
+ParallelCommandRecorder::ParallelCommandRecorder(std::shared_ptr<CommandQueue> commandQueue, std::shared_ptr<JobSystem> jobSystem,
+    CreateDynamicDescriptorHeapFunction createDynamicDescriptorHeap)
+    : m_CommandQueue(commandQueue)
+    , m_JobSystem(jobSystem)
+    , m_CreateDynamicDescriptorHeap(std::move(createDynamicDescriptorHeap)) {
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder() {
+    assert(m_CommandLists.empty() && "Every command list that is recorded must be executed.");
+}
+
+void ParallelCommandRecorder::Begin() {
+    assert(m_CommandLists.empty() && "The previous frame has not been executed.");
+    AddCommandList();
+}
+
+void ParallelCommandRecorder::RecordParallel(const InheritedState& state, uint32_t count, uint32_t minItemsPerCommandList,
+    const RecordFunction& record) {
+    PROFILE_FUNCTION();
+
+    assert(!m_CommandLists.empty() && "Begin must be called before recording.");
+    assert(state.numRenderTargets <= MaxRenderTargets && state.numDescriptorHeaps <= MaxDescriptorHeaps &&
+        "Too many render targets or descriptor heaps.");
+    assert((m_CreateDynamicDescriptorHeap || state.numDescriptorTables == 0) &&
+        "Descriptor tables are staged on dynamic descriptor heaps, the recorder has none.");
+
+    if (count == 0) {
+        return;
+    }
+
+    const uint32_t numChunks = std::min(std::max(count / std::max(minItemsPerCommandList, 1u), 1u),
+        m_JobSystem->GetNumThreads());
+
+    // Not worth the command lists, the items are recorded in place.
+    if (numChunks == 1) {
+        RHICommandList* commandList = GetCommandList();
+        DynamicDescriptorHeap* dynamicDescriptorHeap = GetDynamicDescriptorHeap();
+        ApplyState(commandList, dynamicDescriptorHeap, state);
+        record(commandList, dynamicDescriptorHeap, 0, count);
+        return;
+    }
+
+    m_ChunkCommandLists.assign(numChunks, nullptr);
+    // Acquired here, the pool is not shared with the jobs.
+    m_ChunkDynamicDescriptorHeaps.resize(numChunks);
+    for (std::shared_ptr<DynamicDescriptorHeap>& dynamicDescriptorHeap : m_ChunkDynamicDescriptorHeaps) {
+        dynamicDescriptorHeap = AcquireDynamicDescriptorHeap();
+    }
+    m_JobSystem->ParallelFor(numChunks, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; ++chunk) {
+            PROFILE_SCOPE("ParallelCommandRecorder::RecordChunk");
+
+            // The command queue hands out an allocator per command list, threads do not share them.
+            std::shared_ptr<RHICommandList> commandList = m_CommandQueue->GetCommandList();
+            DynamicDescriptorHeap* dynamicDescriptorHeap = m_ChunkDynamicDescriptorHeaps[chunk].get();
+            ApplyState(commandList.get(), dynamicDescriptorHeap, state);
+
+            // Spread the items evenly, chunks differ by at most one item.
+            const uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(count) * chunk / numChunks);
+            const uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(count) * (chunk + 1) / numChunks);
+            record(commandList.get(), dynamicDescriptorHeap, first, last);
+
+            m_ChunkCommandLists[chunk] = std::move(commandList);
+        }
+    });
+
+    m_CommandLists.insert(m_CommandLists.end(), m_ChunkCommandLists.begin(), m_ChunkCommandLists.end());
+    m_DynamicDescriptorHeaps.insert(m_DynamicDescriptorHeaps.end(),
+        m_ChunkDynamicDescriptorHeaps.begin(), m_ChunkDynamicDescriptorHeaps.end());
+    m_ChunkCommandLists.clear();
+    m_ChunkDynamicDescriptorHeaps.clear();
+
+    // Serial work after the pass must be executed after the chunks.
+    AddCommandList();
+}
+
+uint64_t ParallelCommandRecorder::Execute() {
+    PROFILE_FUNCTION();
+
+    assert(!m_CommandLists.empty() && "Begin must be called before executing.");
+
+    const uint64_t fenceValue = m_CommandQueue->ExecuteCommandLists(m_CommandLists);
+    m_CommandLists.clear();
+
+    // The ring blocks of the heaps are returned once the GPU has finished the submission.
+    for (std::shared_ptr<DynamicDescriptorHeap>& dynamicDescriptorHeap : m_DynamicDescriptorHeaps) {
+        if (dynamicDescriptorHeap) {
+            dynamicDescriptorHeap->Reset();
+            m_FreeDynamicDescriptorHeaps.push_back(std::move(dynamicDescriptorHeap));
+        }
+    }
+    m_DynamicDescriptorHeaps.clear();
+
+    return fenceValue;
+}
+
+uint32_t ParallelCommandRecorder::GetNumCommandLists() const {
+    return static_cast<uint32_t>(m_CommandLists.size());
+}
+
+RHICommandList* ParallelCommandRecorder::GetCommandList() {
+    assert(!m_CommandLists.empty() && "Begin must be called before recording.");
+    return m_CommandLists.back().get();
+}
+
+ResourceStateTracker& ParallelCommandRecorder::GetResourceStateTracker() {
+    return m_CommandQueue->GetResourceStateTracker(GetCommandList());
+}
+
+DynamicDescriptorHeap* ParallelCommandRecorder::GetDynamicDescriptorHeap() const {
+    assert(!m_CommandLists.empty() && "Begin must be called before recording.");
+    return m_DynamicDescriptorHeaps.back().get();
+}
+
+void ParallelCommandRecorder::AddCommandList() {
+    m_CommandLists.push_back(m_CommandQueue->GetCommandList());
+    m_DynamicDescriptorHeaps.push_back(AcquireDynamicDescriptorHeap());
+}
+
+std::shared_ptr<DynamicDescriptorHeap> ParallelCommandRecorder::AcquireDynamicDescriptorHeap() {
+    if (!m_CreateDynamicDescriptorHeap) {
+        return nullptr;
+    }
+    if (m_FreeDynamicDescriptorHeaps.empty()) {
+        return m_CreateDynamicDescriptorHeap();
+    }
+    std::shared_ptr<DynamicDescriptorHeap> dynamicDescriptorHeap = std::move(m_FreeDynamicDescriptorHeaps.back());
+    m_FreeDynamicDescriptorHeaps.pop_back();
+    return dynamicDescriptorHeap;
+}
+
+void ParallelCommandRecorder::ApplyState(RHICommandList* commandList, DynamicDescriptorHeap* dynamicDescriptorHeap,
+    const InheritedState& state) {
+    // Root signatures that index the descriptor heaps directly need the heaps bound first.
+    if (dynamicDescriptorHeap) {
+        assert(state.numDescriptorHeaps == 0 && "The dynamic descriptor heaps bind the heaps of their rings.");
+        dynamicDescriptorHeap->BindDescriptorHeaps(commandList);
+    } else if (state.numDescriptorHeaps > 0) {
+        commandList->SetDescriptorHeaps(state.numDescriptorHeaps, state.descriptorHeaps);
+    }
+    if (state.rootSignature) {
+        commandList->SetGraphicsRootSignature(state.rootSignature);
+    }
+    if (dynamicDescriptorHeap) {
+        // Setting the root signature unbinds the tables of the previous one.
+        dynamicDescriptorHeap->SetRootSignatureLayout(state.descriptorTables, state.numDescriptorTables);
+    }
+    commandList->RSSetViewport(state.viewport);
+    commandList->RSSetScissorRect(state.scissorRect);
+    commandList->OMSetRenderTargets(state.numRenderTargets, state.renderTargets,
+        state.hasDepthStencil ? &state.depthStencil : nullptr);
+}
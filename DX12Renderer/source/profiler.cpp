@@ -0,0 +1,287 @@
+#include "profiler.h"
+
+#include "highresolutionclock.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// A completed zone. The fields are atomic because the exporting thread may read
+// a slot while the recording thread overwrites it, torn reads are discarded.
+struct ZoneRecord {
+    std::atomic<const char*> name;
+    std::atomic_uint64_t beginTimestamp;
+    std::atomic_uint64_t endTimestamp;
+    std::atomic_uint32_t depth;
+};
+
+// Single producer ring buffer owned by one thread.
+struct ThreadBuffer {
+    ThreadBuffer(uint32_t id, bool track)
+        : threadId(id)
+        , isTrack(track)
+        , reservedCount(0)
+        , writtenCount(0)
+        , clearedCount(0)
+        , zones(new ZoneRecord[Profiler::ZonesPerThread]) {
+    }
+
+    uint32_t threadId;
+    // Tracks are not bound to a thread, zones are recorded with RecordZone.
+    bool isTrack;
+    std::string threadName;     // Guarded by the registry mutex.
+
+    // Number of zones claimed by the writer. Claimed before a slot is written so
+    // the reader can tell which slots may have been overwritten while it read them.
+    std::atomic_uint64_t reservedCount;
+    // Number of zones that are completely written.
+    std::atomic_uint64_t writtenCount;
+    // Zones before this count were dropped by Profiler::Clear.
+    std::atomic_uint64_t clearedCount;
+
+    std::unique_ptr<ZoneRecord[]> zones;
+
+    // Depth of the zones currently open on the thread. Only touched by the owning thread.
+    uint32_t depth = 0;
+};
+
+struct ThreadRegistry {
+    std::mutex mutex;
+    // Buffers outlive their threads so zones of finished threads can still be exported.
+    std::vector< std::unique_ptr<ThreadBuffer> > threadBuffers;
+};
+
+ThreadRegistry& GetThreadRegistry() {
+    static ThreadRegistry s_ThreadRegistry;
+    return s_ThreadRegistry;
+}
+
+// Initialized on first use so zones recorded during static initialization are valid too.
+std::chrono::high_resolution_clock::time_point GetStartTime() {
+    static const std::chrono::high_resolution_clock::time_point s_StartTime = HighResolutionClock::Now();
+    return s_StartTime;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+    static thread_local ThreadBuffer* t_ThreadBuffer = nullptr;
+
+    if (!t_ThreadBuffer) {
+        ThreadRegistry& registry = GetThreadRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        uint32_t threadId = static_cast<uint32_t>(registry.threadBuffers.size()) + 1;
+        registry.threadBuffers.push_back(std::make_unique<ThreadBuffer>(threadId, false));
+        t_ThreadBuffer = registry.threadBuffers.back().get();
+    }
+
+    return *t_ThreadBuffer;
+}
+
+void WriteZone(ThreadBuffer& threadBuffer, const char* name, uint64_t beginTimestamp, uint64_t endTimestamp,
+    uint32_t depth) {
+    uint64_t index = threadBuffer.writtenCount.load(std::memory_order_relaxed);
+    threadBuffer.reservedCount.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ZoneRecord& zone = threadBuffer.zones[index % Profiler::ZonesPerThread];
+    zone.name.store(name, std::memory_order_relaxed);
+    zone.beginTimestamp.store(beginTimestamp, std::memory_order_relaxed);
+    zone.endTimestamp.store(endTimestamp, std::memory_order_relaxed);
+    zone.depth.store(depth, std::memory_order_relaxed);
+
+    threadBuffer.writtenCount.store(index + 1, std::memory_order_release);
+}
+
+struct ExportedZone {
+    const char* name;
+    uint64_t beginTimestamp;
+    uint64_t endTimestamp;
+    uint32_t depth;
+};
+
+// Copy the valid zones of a thread buffer.
+void ReadThreadBuffer(const ThreadBuffer& threadBuffer, std::vector<ExportedZone>& exportedZones) {
+    const uint64_t capacity = Profiler::ZonesPerThread;
+
+    uint64_t end = threadBuffer.writtenCount.load(std::memory_order_acquire);
+    uint64_t begin = std::max(threadBuffer.clearedCount.load(std::memory_order_relaxed),
+        end > capacity ? end - capacity : 0);
+
+    size_t first = exportedZones.size();
+    for (uint64_t i = begin; i < end; ++i) {
+        const ZoneRecord& zone = threadBuffer.zones[i % capacity];
+        exportedZones.push_back(ExportedZone{
+            zone.name.load(std::memory_order_relaxed),
+            zone.beginTimestamp.load(std::memory_order_relaxed),
+            zone.endTimestamp.load(std::memory_order_relaxed),
+            zone.depth.load(std::memory_order_relaxed) });
+    }
+
+    // Slot i is reused for zone i + capacity. Anything the writer claimed in the
+    // meantime may have been torn and is dropped.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t reserved = threadBuffer.reservedCount.load(std::memory_order_relaxed);
+    if (reserved > begin + capacity) {
+        size_t numOverwritten = static_cast<size_t>(std::min(end, reserved - capacity) - begin);
+        exportedZones.erase(exportedZones.begin() + first, exportedZones.begin() + first + numOverwritten);
+    }
+}
+
+void WriteJsonString(std::ostream& stream, const char* string) {
+    stream << '"';
+    for (const char* c = string; *c; ++c) {
+        switch (*c) {
+            case '"':
+                stream << "\\\"";
+                break;
+            case '\\':
+                stream << "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(*c) >= 0x20) {
+                    stream << *c;
+                }
+                break;
+        }
+    }
+    stream << '"';
+}
+
+// Chrome expects microseconds.
+void WriteMicroseconds(std::ostream& stream, uint64_t nanoseconds) {
+    stream << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000
+        << std::setfill(' ');
+}
+
+}
+
+const size_t Profiler::ZonesPerThread;
+
+std::atomic_bool Profiler::s_Enabled(true);
+
+void Profiler::SetEnabled(bool enabled) {
+    s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+    ThreadBuffer& threadBuffer = GetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(GetThreadRegistry().mutex);
+    threadBuffer.threadName = name;
+}
+
+uint64_t Profiler::GetTimestamp() {
+    return ToTimestamp(HighResolutionClock::Now());
+}
+
+uint64_t Profiler::ToTimestamp(std::chrono::high_resolution_clock::time_point timePoint) {
+    const std::chrono::high_resolution_clock::time_point startTime = GetStartTime();
+    if (timePoint < startTime) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint - startTime).count());
+}
+
+uint32_t Profiler::BeginZone() {
+    return GetThreadBuffer().depth++;
+}
+
+void Profiler::EndZone(const char* name, uint64_t beginTimestamp, uint32_t depth) {
+    uint64_t endTimestamp = GetTimestamp();
+
+    ThreadBuffer& threadBuffer = GetThreadBuffer();
+    threadBuffer.depth = depth;
+
+    WriteZone(threadBuffer, name, beginTimestamp, endTimestamp, depth);
+}
+
+uint32_t Profiler::CreateTrack(const std::string& name) {
+    ThreadRegistry& registry = GetThreadRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    uint32_t trackId = static_cast<uint32_t>(registry.threadBuffers.size()) + 1;
+    registry.threadBuffers.push_back(std::make_unique<ThreadBuffer>(trackId, true));
+    registry.threadBuffers.back()->threadName = name;
+
+    return trackId;
+}
+
+void Profiler::RecordZone(uint32_t track, const char* name, uint64_t beginTimestamp, uint64_t endTimestamp,
+    uint32_t depth) {
+    ThreadBuffer* threadBuffer = nullptr;
+    {
+        // Buffers are never removed, the pointer stays valid after the lock is released.
+        ThreadRegistry& registry = GetThreadRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        assert(track > 0 && track <= registry.threadBuffers.size() && "Invalid profiler track.");
+        threadBuffer = registry.threadBuffers[track - 1].get();
+        assert(threadBuffer->isTrack && "Zones can only be recorded on tracks created with CreateTrack.");
+    }
+
+    WriteZone(*threadBuffer, name, beginTimestamp, endTimestamp, depth);
+}
+
+void Profiler::Clear() {
+    ThreadRegistry& registry = GetThreadRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (auto& threadBuffer : registry.threadBuffers) {
+        threadBuffer->clearedCount.store(threadBuffer->writtenCount.load(std::memory_order_acquire),
+            std::memory_order_relaxed);
+    }
+}
+
+void Profiler::WriteChromeTrace(std::ostream& stream) {
+    ThreadRegistry& registry = GetThreadRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::vector<ExportedZone> zones;
+    bool first = true;
+
+    stream << "{\"traceEvents\":[\n";
+
+    for (auto& threadBuffer : registry.threadBuffers) {
+        if (!threadBuffer->threadName.empty()) {
+            stream << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+                << threadBuffer->threadId << ",\"args\":{\"name\":";
+            WriteJsonString(stream, threadBuffer->threadName.c_str());
+            stream << "}}";
+            first = false;
+        }
+
+        zones.clear();
+        ReadThreadBuffer(*threadBuffer, zones);
+
+        // Complete events, the viewer nests them by time.
+        for (const auto& zone : zones) {
+            stream << (first ? "" : ",\n") << "{\"name\":";
+            WriteJsonString(stream, zone.name);
+            stream << ",\"cat\":\"" << (threadBuffer->isTrack ? "track" : "cpu")
+                << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadBuffer->threadId << ",\"ts\":";
+            WriteMicroseconds(stream, zone.beginTimestamp);
+            stream << ",\"dur\":";
+            WriteMicroseconds(stream, zone.endTimestamp - zone.beginTimestamp);
+            stream << ",\"args\":{\"depth\":" << zone.depth << "}}";
+            first = false;
+        }
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool Profiler::SaveChromeTrace(const std::string& fileName) {
+    std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    WriteChromeTrace(file);
+    return file.good();
+}
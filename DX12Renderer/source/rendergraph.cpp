@@ -0,0 +1,714 @@
+#include "rendergraph.h"
+
+#include "deferredreleasequeue.h"
+#include "profiler.h"
+#include "resourcestatetracker.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Placed resources and heaps are aligned to 64KB.
+static const uint64_t TransientHeapAlignment = 64 * 1024;
+
+// Read states can be combined into one state, all other states are exclusive.
+static const uint32_t ReadOnlyStates = RHIResourceState_VertexAndConstantBuffer | RHIResourceState_IndexBuffer |
+    RHIResourceState_DepthRead | RHIResourceState_NonPixelShaderResource | RHIResourceState_PixelShaderResource |
+    RHIResourceState_IndirectArgument | RHIResourceState_CopySource;
+
+static bool IsReadOnlyState(RHIResourceState state) {
+    return state != RHIResourceState_Common && (state & ~ReadOnlyStates) == 0;
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool IsSameDesc(const RHIResourceDesc& a, const RHIResourceDesc& b) {
+    return a.Dimension == b.Dimension && a.Width == b.Width && a.Height == b.Height &&
+        a.Format == b.Format && a.Flags == b.Flags;
+}
+
+static RHIHeapResourceType GetHeapResourceType(const RHIResourceDesc& desc) {
+    if (desc.Dimension == RHIResourceDimension::Buffer) {
+        return RHIHeapResourceType::Buffers;
+    }
+    if (desc.Flags & (RHIResourceFlag_AllowRenderTarget | RHIResourceFlag_AllowDepthStencil)) {
+        return RHIHeapResourceType::RenderTargetTextures;
+    }
+    return RHIHeapResourceType::Textures;
+}
+
+//
+// RenderGraphPassBuilder
+//
+RenderGraphPassBuilder::RenderGraphPassBuilder(RenderGraph& graph, uint32_t pass)
+    : m_Graph(graph)
+    , m_Pass(pass) {
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::Read(RenderGraphResource resource, RHIResourceState state) {
+    m_Graph.AddAccess(m_Pass, resource, state, false);
+    return *this;
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::Write(RenderGraphResource resource, RHIResourceState state) {
+    m_Graph.AddAccess(m_Pass, resource, state, true);
+    return *this;
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::SetSideEffects() {
+    m_Graph.m_Passes[m_Pass].sideEffects = true;
+    return *this;
+}
+
+RenderGraphPassBuilder& RenderGraphPassBuilder::SetSwitchesCommandList() {
+    m_Graph.m_Passes[m_Pass].switchesCommandList = true;
+    return *this;
+}
+
+uint32_t RenderGraphPassBuilder::GetPass() const {
+    return m_Pass;
+}
+
+//
+// RenderGraph
+//
+const RenderGraphResource RenderGraph::InvalidResource;
+const uint64_t RenderGraph::MaxUnusedFrames;
+
+RenderGraph::RenderGraph(std::shared_ptr<RHIDevice> device, std::shared_ptr<DeferredReleaseQueue> deferredReleaseQueue)
+    : m_Device(device)
+    , m_DeferredReleaseQueue(deferredReleaseQueue)
+    , m_Compiled(false)
+    , m_Stats()
+    , m_FrameIndex(0) {
+    for (size_t i = 0; i < NumHeapResourceTypes; ++i) {
+        m_TransientHeapSizes[i] = 0;
+    }
+}
+
+RenderGraph::~RenderGraph() {
+    for (CachedResource& cachedResource : m_CachedResources) {
+        ReleaseCachedResource(cachedResource);
+    }
+    if (auto deferredReleaseQueue = m_DeferredReleaseQueue.lock()) {
+        for (size_t i = 0; i < NumHeapResourceTypes; ++i) {
+            if (m_TransientHeaps[i]) {
+                deferredReleaseQueue->Release(m_TransientHeaps[i]);
+            }
+        }
+    }
+}
+
+RenderGraphResource RenderGraph::CreateResource(const std::string& name, const RHIResourceDesc& desc) {
+    Resource resource = {};
+    resource.name = name;
+    resource.desc = desc;
+    resource.resource = nullptr;
+    resource.imported = false;
+
+    m_Resources.push_back(resource);
+    m_Compiled = false;
+    return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportResource(const std::string& name, RHIResource* rhiResource, RHIResourceState finalState) {
+    assert(rhiResource && "Cannot import a null resource.");
+
+    Resource resource = {};
+    resource.name = name;
+    resource.desc = rhiResource->GetDesc();
+    resource.resource = rhiResource;
+    resource.imported = true;
+    resource.finalState = finalState;
+
+    m_Resources.push_back(resource);
+    m_Compiled = false;
+    return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphPassBuilder RenderGraph::AddPass(const std::string& name, ExecuteFunction execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    pass.sideEffects = false;
+    pass.switchesCommandList = false;
+    pass.culled = false;
+
+    m_Passes.push_back(std::move(pass));
+    m_Compiled = false;
+    return RenderGraphPassBuilder(*this, static_cast<uint32_t>(m_Passes.size() - 1));
+}
+
+void RenderGraph::AddAccess(uint32_t pass, RenderGraphResource resource, RHIResourceState state, bool write) {
+    assert(resource < m_Resources.size() && "Invalid render graph resource.");
+
+    m_Compiled = false;
+
+    // A pass that uses a resource twice needs it in both states at once.
+    for (ResourceAccess& access : m_Passes[pass].accesses) {
+        if (access.resource == resource) {
+            assert((access.state == state || (IsReadOnlyState(access.state) && IsReadOnlyState(state))) &&
+                "A pass cannot use a resource in two exclusive states.");
+            access.state = static_cast<RHIResourceState>(access.state | state);
+            access.write = access.write || write;
+            return;
+        }
+    }
+
+    m_Passes[pass].accesses.push_back(ResourceAccess{ resource, state, write });
+}
+
+void RenderGraph::Compile() {
+    PROFILE_FUNCTION();
+
+    const size_t numPasses = m_Passes.size();
+    m_Stats = Stats();
+
+    // Dependencies in declaration order. Reads and writes depend on the previous writer,
+    // writes keep its contents. Writes also wait for the reads of the previous contents,
+    // those only matter for the order.
+    std::vector< std::vector<uint32_t> > dataDependencies(numPasses);
+    std::vector< std::vector<uint32_t> > dependencies(numPasses);
+    {
+        std::vector<uint32_t> lastWriters(m_Resources.size(), ~0u);
+        std::vector< std::vector<uint32_t> > readers(m_Resources.size());
+
+        for (uint32_t pass = 0; pass < numPasses; ++pass) {
+            for (const ResourceAccess& access : m_Passes[pass].accesses) {
+                uint32_t lastWriter = lastWriters[access.resource];
+                if (lastWriter != ~0u) {
+                    dataDependencies[pass].push_back(lastWriter);
+                    dependencies[pass].push_back(lastWriter);
+                }
+
+                if (access.write) {
+                    for (uint32_t reader : readers[access.resource]) {
+                        if (reader != pass) {
+                            dependencies[pass].push_back(reader);
+                        }
+                    }
+                    readers[access.resource].clear();
+                    lastWriters[access.resource] = pass;
+                } else {
+                    readers[access.resource].push_back(pass);
+                }
+            }
+        }
+    }
+
+    CullPasses(dataDependencies);
+    OrderPasses(dependencies);
+    PlanBarriers();
+    PlaceTransientResources();
+
+    m_Stats.numPasses = static_cast<uint32_t>(numPasses);
+    m_Stats.numCulledPasses = static_cast<uint32_t>(numPasses - m_PassOrder.size());
+
+    m_Compiled = true;
+}
+
+void RenderGraph::CullPasses(const std::vector< std::vector<uint32_t> >& dataDependencies) {
+    // Everything a pass with side effects or a write to an imported resource depends on is needed.
+    std::vector<uint32_t> stack;
+    for (uint32_t pass = 0; pass < m_Passes.size(); ++pass) {
+        bool root = m_Passes[pass].sideEffects;
+        for (const ResourceAccess& access : m_Passes[pass].accesses) {
+            root = root || (access.write && m_Resources[access.resource].imported);
+        }
+
+        m_Passes[pass].culled = !root;
+        if (root) {
+            stack.push_back(pass);
+        }
+    }
+
+    while (!stack.empty()) {
+        uint32_t pass = stack.back();
+        stack.pop_back();
+
+        for (uint32_t dependency : dataDependencies[pass]) {
+            if (m_Passes[dependency].culled) {
+                m_Passes[dependency].culled = false;
+                stack.push_back(dependency);
+            }
+        }
+    }
+}
+
+void RenderGraph::OrderPasses(const std::vector< std::vector<uint32_t> >& dependencies) {
+    const size_t numPasses = m_Passes.size();
+
+    std::vector<uint32_t> numDependencies(numPasses, 0);
+    std::vector< std::vector<uint32_t> > dependents(numPasses);
+    for (uint32_t pass = 0; pass < numPasses; ++pass) {
+        if (m_Passes[pass].culled) {
+            continue;
+        }
+        for (uint32_t dependency : dependencies[pass]) {
+            if (!m_Passes[dependency].culled) {
+                ++numDependencies[pass];
+                dependents[dependency].push_back(pass);
+            }
+        }
+    }
+
+    // The position after the last dependency of each pass.
+    std::vector<uint32_t> readyPositions(numPasses, 0);
+    std::vector<uint32_t> readyPasses;
+    for (uint32_t pass = 0; pass < numPasses; ++pass) {
+        if (!m_Passes[pass].culled && numDependencies[pass] == 0) {
+            readyPasses.push_back(pass);
+        }
+    }
+
+    m_PassOrder.clear();
+    while (!readyPasses.empty()) {
+        // The pass that has been ready the longest, then the one declared first.
+        size_t best = 0;
+        for (size_t i = 1; i < readyPasses.size(); ++i) {
+            uint32_t pass = readyPasses[i];
+            uint32_t bestPass = readyPasses[best];
+            if (readyPositions[pass] < readyPositions[bestPass] ||
+                (readyPositions[pass] == readyPositions[bestPass] && pass < bestPass)) {
+                best = i;
+            }
+        }
+
+        uint32_t pass = readyPasses[best];
+        readyPasses.erase(readyPasses.begin() + best);
+
+        const uint32_t position = static_cast<uint32_t>(m_PassOrder.size());
+        m_PassOrder.push_back(pass);
+
+        for (uint32_t dependent : dependents[pass]) {
+            readyPositions[dependent] = std::max(readyPositions[dependent], position + 1);
+            if (--numDependencies[dependent] == 0) {
+                readyPasses.push_back(dependent);
+            }
+        }
+    }
+
+    assert(m_PassOrder.size() == numPasses - std::count_if(m_Passes.begin(), m_Passes.end(),
+        [](const Pass& pass) { return pass.culled; }) && "The passes have a cyclic dependency.");
+}
+
+void RenderGraph::PlanBarriers() {
+    const uint32_t numPositions = static_cast<uint32_t>(m_PassOrder.size());
+
+    m_Barriers.assign(numPositions, std::vector<RenderGraphBarrier>());
+    m_FirstUses.assign(numPositions, std::vector<RenderGraphResource>());
+
+    struct ScheduledAccess {
+        uint32_t position;
+        RHIResourceState state;
+        bool write;
+    };
+
+    std::vector< std::vector<ScheduledAccess> > resourceAccesses(m_Resources.size());
+    // The passes before each position that continue the frame on another command list.
+    std::vector<uint32_t> numCommandListSwitches(numPositions + 1, 0);
+    for (uint32_t position = 0; position < numPositions; ++position) {
+        const Pass& pass = m_Passes[m_PassOrder[position]];
+        for (const ResourceAccess& access : pass.accesses) {
+            resourceAccesses[access.resource].push_back(ScheduledAccess{ position, access.state, access.write });
+        }
+        numCommandListSwitches[position + 1] = numCommandListSwitches[position] + (pass.switchesCommandList ? 1 : 0);
+    }
+
+    for (RenderGraphResource resourceIndex = 0; resourceIndex < m_Resources.size(); ++resourceIndex) {
+        Resource& resource = m_Resources[resourceIndex];
+        const std::vector<ScheduledAccess>& accesses = resourceAccesses[resourceIndex];
+
+        resource.used = !accesses.empty();
+        if (!resource.used) {
+            continue;
+        }
+
+        // One transition covers a run of reads.
+        auto readStates = [&accesses](size_t first) {
+            uint32_t state = accesses[first].state;
+            for (size_t i = first + 1; i < accesses.size() && !accesses[i].write && IsReadOnlyState(accesses[i].state); ++i) {
+                state |= accesses[i].state;
+            }
+            return static_cast<RHIResourceState>(state);
+        };
+
+        resource.firstPosition = accesses.front().position;
+        resource.lastPosition = accesses.back().position;
+        resource.firstState = (!accesses[0].write && IsReadOnlyState(accesses[0].state)) ? readStates(0) : accesses[0].state;
+        m_FirstUses[resource.firstPosition].push_back(resourceIndex);
+
+        RHIResourceState currentState = resource.firstState;
+        for (size_t i = 1; i < accesses.size(); ++i) {
+            const ScheduledAccess& access = accesses[i];
+            const ScheduledAccess& previousAccess = accesses[i - 1];
+            const bool readOnly = !access.write && IsReadOnlyState(access.state);
+
+            if (readOnly && IsReadOnlyState(currentState) && (currentState & access.state) == access.state) {
+                continue;
+            }
+
+            if (access.state == currentState) {
+                // Unordered access needs a barrier between a write and any access around it,
+                // a write after a read must not overtake the read either.
+                if (currentState == RHIResourceState_UnorderedAccess && (previousAccess.write || access.write)) {
+                    m_Barriers[access.position].push_back(RenderGraphBarrier{ RHIResourceBarrierType::UAV, resourceIndex,
+                        currentState, currentState, RHIResourceBarrierFlag_None });
+                    ++m_Stats.numBarriers;
+                }
+                continue;
+            }
+
+            RHIResourceState stateAfter = readOnly ? readStates(i) : access.state;
+
+            // Imported resources are transitioned through the resource state tracker, which does not split.
+            const bool sameCommandList =
+                numCommandListSwitches[access.position] == numCommandListSwitches[previousAccess.position + 1];
+            if (!resource.imported && access.position > previousAccess.position + 1 && sameCommandList) {
+                m_Barriers[previousAccess.position + 1].push_back(RenderGraphBarrier{ RHIResourceBarrierType::Transition,
+                    resourceIndex, currentState, stateAfter, RHIResourceBarrierFlag_BeginOnly });
+                m_Barriers[access.position].push_back(RenderGraphBarrier{ RHIResourceBarrierType::Transition,
+                    resourceIndex, currentState, stateAfter, RHIResourceBarrierFlag_EndOnly });
+                m_Stats.numBarriers += 2;
+                ++m_Stats.numSplitBarriers;
+            } else {
+                m_Barriers[access.position].push_back(RenderGraphBarrier{ RHIResourceBarrierType::Transition,
+                    resourceIndex, currentState, stateAfter, RHIResourceBarrierFlag_None });
+                ++m_Stats.numBarriers;
+            }
+            currentState = stateAfter;
+        }
+        resource.lastState = currentState;
+    }
+}
+
+void RenderGraph::PlaceTransientResources() {
+    struct Placement {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t firstPosition;
+        uint32_t lastPosition;
+    };
+
+    for (size_t heapType = 0; heapType < NumHeapResourceTypes; ++heapType) {
+        std::vector<RenderGraphResource> transientResources;
+        for (RenderGraphResource i = 0; i < m_Resources.size(); ++i) {
+            Resource& resource = m_Resources[i];
+            if (resource.imported || !resource.used) {
+                continue;
+            }
+
+            resource.heapResourceType = GetHeapResourceType(resource.desc);
+            if (static_cast<size_t>(resource.heapResourceType) != heapType) {
+                continue;
+            }
+
+            RHIResourceAllocationInfo allocationInfo = m_Device->GetResourceAllocationInfo(resource.desc);
+            resource.size = allocationInfo.Size;
+            resource.alignment = allocationInfo.Alignment;
+            transientResources.push_back(i);
+        }
+
+        // Largest first, small resources fill the gaps between large ones.
+        std::sort(transientResources.begin(), transientResources.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+            return m_Resources[a].size != m_Resources[b].size ? m_Resources[a].size > m_Resources[b].size : a < b;
+        });
+
+        std::vector<Placement> placements;
+        std::vector<const Placement*> overlapping;
+        uint64_t heapSize = 0;
+        for (RenderGraphResource i : transientResources) {
+            Resource& resource = m_Resources[i];
+
+            // Only resources that are alive at the same time constrain the offset.
+            overlapping.clear();
+            for (const Placement& placement : placements) {
+                if (placement.lastPosition >= resource.firstPosition && placement.firstPosition <= resource.lastPosition) {
+                    overlapping.push_back(&placement);
+                }
+            }
+            std::sort(overlapping.begin(), overlapping.end(), [](const Placement* a, const Placement* b) {
+                return a->offset < b->offset;
+            });
+
+            // The lowest gap that fits, found by moving past every placement in the way in
+            // order of offset. Placements further up start after the end of the resource.
+            uint64_t offset = 0;
+            for (const Placement* placement : overlapping) {
+                if (offset + resource.size <= placement->offset) {
+                    break;
+                }
+                if (offset < placement->offset + placement->size) {
+                    offset = AlignUp(placement->offset + placement->size, resource.alignment);
+                }
+            }
+            resource.heapOffset = offset;
+
+            placements.push_back(Placement{ resource.heapOffset, resource.size, resource.firstPosition, resource.lastPosition });
+            heapSize = std::max(heapSize, resource.heapOffset + resource.size);
+            m_Stats.transientBytes += resource.size;
+            ++m_Stats.numTransientResources;
+        }
+
+        // Memory used by an earlier resource of the frame is taken over with an aliasing barrier.
+        for (RenderGraphResource i : transientResources) {
+            Resource& resource = m_Resources[i];
+            resource.aliased = std::any_of(transientResources.begin(), transientResources.end(), [&](RenderGraphResource j) {
+                const Resource& other = m_Resources[j];
+                return other.lastPosition < resource.firstPosition &&
+                    other.heapOffset < resource.heapOffset + resource.size && resource.heapOffset < other.heapOffset + other.size;
+            });
+            if (resource.aliased) {
+                ++m_Stats.numAliasingBarriers;
+                ++m_Stats.numBarriers;
+            }
+        }
+
+        m_TransientHeapSizes[heapType] = AlignUp(heapSize, TransientHeapAlignment);
+        m_Stats.transientHeapBytes += m_TransientHeapSizes[heapType];
+    }
+}
+
+void RenderGraph::Execute(RHICommandList* commandList, ResourceStateTracker& resourceStateTracker) {
+    // All passes are recorded on the one command list.
+    class SingleCommandListContext : public RenderGraphCommandContext {
+    public:
+        SingleCommandListContext(RHICommandList* commandList, ResourceStateTracker& resourceStateTracker)
+            : m_CommandList(commandList)
+            , m_ResourceStateTracker(resourceStateTracker) {
+        }
+
+        virtual RHICommandList* GetCommandList() override {
+            return m_CommandList;
+        }
+
+        virtual ResourceStateTracker& GetResourceStateTracker() override {
+            return m_ResourceStateTracker;
+        }
+
+    private:
+        RHICommandList* m_CommandList;
+        ResourceStateTracker& m_ResourceStateTracker;
+    };
+
+    SingleCommandListContext context(commandList, resourceStateTracker);
+    Execute(context);
+}
+
+void RenderGraph::Execute(RenderGraphCommandContext& context) {
+    PROFILE_FUNCTION();
+
+    assert(m_Compiled && "The render graph must be compiled before it is executed.");
+
+    ++m_FrameIndex;
+
+    for (size_t heapType = 0; heapType < NumHeapResourceTypes; ++heapType) {
+        ReserveTransientHeap(static_cast<RHIHeapResourceType>(heapType), m_TransientHeapSizes[heapType]);
+    }
+
+    m_CachedResourceIndices.assign(m_Resources.size(), ~size_t(0));
+    for (RenderGraphResource i = 0; i < m_Resources.size(); ++i) {
+        Resource& resource = m_Resources[i];
+        if (!resource.imported && resource.used) {
+            m_CachedResourceIndices[i] = AcquireCachedResource(resource);
+            resource.resource = m_CachedResources[m_CachedResourceIndices[i]].resource.get();
+        }
+    }
+
+    for (uint32_t position = 0; position < m_PassOrder.size(); ++position) {
+        // The previous pass may have moved the frame to another command list. The states of imported
+        // resources carry over when the command lists are executed in order, transient resources have
+        // explicit before states.
+        RHICommandList* commandList = context.GetCommandList();
+        ResourceStateTracker& resourceStateTracker = context.GetResourceStateTracker();
+
+        for (RenderGraphResource i : m_FirstUses[position]) {
+            const Resource& resource = m_Resources[i];
+            if (resource.imported) {
+                resourceStateTracker.TransitionResource(resource.resource, resource.firstState);
+                continue;
+            }
+
+            // Memory may also have been used by another resource in an earlier frame.
+            const CachedResource& cachedResource = m_CachedResources[m_CachedResourceIndices[i]];
+            if (resource.aliased || IsMemoryShared(m_CachedResourceIndices[i])) {
+                resourceStateTracker.AliasingBarrier(nullptr, resource.resource);
+            }
+            if (cachedResource.state != resource.firstState) {
+                resourceStateTracker.ResourceBarrier(RHIResourceBarrier::Transition(resource.resource,
+                    cachedResource.state, resource.firstState));
+            }
+        }
+
+        for (const RenderGraphBarrier& barrier : m_Barriers[position]) {
+            const Resource& resource = m_Resources[barrier.Resource];
+            if (barrier.Type == RHIResourceBarrierType::UAV) {
+                resourceStateTracker.UAVBarrier(resource.resource);
+            } else if (resource.imported) {
+                resourceStateTracker.TransitionResource(resource.resource, barrier.StateAfter);
+            } else {
+                resourceStateTracker.ResourceBarrier(RHIResourceBarrier::Transition(resource.resource,
+                    barrier.StateBefore, barrier.StateAfter, barrier.Flags));
+            }
+        }
+
+        resourceStateTracker.FlushResourceBarriers(commandList);
+
+        Pass& pass = m_Passes[m_PassOrder[position]];
+        if (pass.execute) {
+            pass.execute(*this, commandList);
+        }
+    }
+
+    // Imported resources are flushed with the next barriers of the command list.
+    ResourceStateTracker& resourceStateTracker = context.GetResourceStateTracker();
+    for (RenderGraphResource i = 0; i < m_Resources.size(); ++i) {
+        Resource& resource = m_Resources[i];
+        if (!resource.used) {
+            continue;
+        }
+
+        if (resource.imported) {
+            resourceStateTracker.TransitionResource(resource.resource, resource.finalState);
+        } else {
+            CachedResource& cachedResource = m_CachedResources[m_CachedResourceIndices[i]];
+            cachedResource.state = resource.lastState;
+            cachedResource.inUse = false;
+        }
+    }
+
+    // Resources of other sizes, e.g. from before the window was resized.
+    auto unused = std::stable_partition(m_CachedResources.begin(), m_CachedResources.end(), [this](const CachedResource& cachedResource) {
+        return cachedResource.lastUsedFrame + MaxUnusedFrames >= m_FrameIndex;
+    });
+    for (auto iter = unused; iter != m_CachedResources.end(); ++iter) {
+        ReleaseCachedResource(*iter);
+    }
+    m_CachedResources.erase(unused, m_CachedResources.end());
+}
+
+void RenderGraph::Reset() {
+    m_Passes.clear();
+    m_Resources.clear();
+
+    m_Compiled = false;
+    m_PassOrder.clear();
+    m_Barriers.clear();
+    m_FirstUses.clear();
+    m_CachedResourceIndices.clear();
+    m_Stats = Stats();
+}
+
+void RenderGraph::ReserveTransientHeap(RHIHeapResourceType heapResourceType, uint64_t size) {
+    std::shared_ptr<RHIHeap>& heap = m_TransientHeaps[static_cast<size_t>(heapResourceType)];
+    if (size == 0 || (heap && heap->GetDesc().Size >= size)) {
+        return;
+    }
+
+    // The resources placed in the old heap go with it.
+    auto removed = std::stable_partition(m_CachedResources.begin(), m_CachedResources.end(), [heapResourceType](const CachedResource& cachedResource) {
+        return cachedResource.heapResourceType != heapResourceType;
+    });
+    for (auto iter = removed; iter != m_CachedResources.end(); ++iter) {
+        ReleaseCachedResource(*iter);
+    }
+    m_CachedResources.erase(removed, m_CachedResources.end());
+
+    if (heap) {
+        if (auto deferredReleaseQueue = m_DeferredReleaseQueue.lock()) {
+            deferredReleaseQueue->Release(heap);
+        }
+    }
+
+    RHIHeapDesc desc;
+    desc.Type = RHIHeapType::Default;
+    desc.ResourceType = heapResourceType;
+    desc.Size = size;
+    heap = m_Device->CreateHeap(desc);
+}
+
+size_t RenderGraph::AcquireCachedResource(const Resource& resource) {
+    for (size_t i = 0; i < m_CachedResources.size(); ++i) {
+        CachedResource& cachedResource = m_CachedResources[i];
+        if (!cachedResource.inUse && cachedResource.heapResourceType == resource.heapResourceType &&
+            cachedResource.heapOffset == resource.heapOffset && IsSameDesc(cachedResource.desc, resource.desc)) {
+            cachedResource.inUse = true;
+            cachedResource.lastUsedFrame = m_FrameIndex;
+            return i;
+        }
+    }
+
+    CachedResource cachedResource;
+    cachedResource.heapResourceType = resource.heapResourceType;
+    cachedResource.heapOffset = resource.heapOffset;
+    cachedResource.desc = resource.desc;
+    cachedResource.resource = m_Device->CreatePlacedResource(m_TransientHeaps[static_cast<size_t>(resource.heapResourceType)].get(),
+        resource.heapOffset, resource.desc, resource.firstState);
+    cachedResource.state = resource.firstState;
+    cachedResource.lastUsedFrame = m_FrameIndex;
+    cachedResource.inUse = true;
+
+    m_CachedResources.push_back(cachedResource);
+    return m_CachedResources.size() - 1;
+}
+
+bool RenderGraph::IsMemoryShared(size_t cachedResourceIndex) const {
+    const CachedResource& cachedResource = m_CachedResources[cachedResourceIndex];
+    const uint64_t size = m_Device->GetResourceAllocationInfo(cachedResource.desc).Size;
+
+    for (size_t i = 0; i < m_CachedResources.size(); ++i) {
+        const CachedResource& other = m_CachedResources[i];
+        if (i == cachedResourceIndex || other.heapResourceType != cachedResource.heapResourceType) {
+            continue;
+        }
+
+        const uint64_t otherSize = m_Device->GetResourceAllocationInfo(other.desc).Size;
+        if (other.heapOffset < cachedResource.heapOffset + size && cachedResource.heapOffset < other.heapOffset + otherSize) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderGraph::ReleaseCachedResource(CachedResource& cachedResource) {
+    // Frames in flight may still use the resource.
+    if (auto deferredReleaseQueue = m_DeferredReleaseQueue.lock()) {
+        deferredReleaseQueue->Release(cachedResource.resource);
+    }
+    cachedResource.resource.reset();
+}
+
+RHIResource* RenderGraph::GetResource(RenderGraphResource resource) const {
+    assert(resource < m_Resources.size() && "Invalid render graph resource.");
+    return m_Resources[resource].resource;
+}
+
+const std::string& RenderGraph::GetResourceName(RenderGraphResource resource) const {
+    return m_Resources[resource].name;
+}
+
+const std::string& RenderGraph::GetPassName(uint32_t pass) const {
+    return m_Passes[pass].name;
+}
+
+const std::vector<uint32_t>& RenderGraph::GetPassOrder() const {
+    return m_PassOrder;
+}
+
+bool RenderGraph::IsPassCulled(uint32_t pass) const {
+    return m_Passes[pass].culled;
+}
+
+const std::vector<RenderGraphBarrier>& RenderGraph::GetBarriers(uint32_t position) const {
+    return m_Barriers[position];
+}
+
+uint64_t RenderGraph::GetTransientOffset(RenderGraphResource resource) const {
+    assert(!m_Resources[resource].imported && "Imported resources are not placed.");
+    return m_Resources[resource].heapOffset;
+}
+
+RenderGraph::Stats RenderGraph::GetStats() const {
+    return m_Stats;
+}
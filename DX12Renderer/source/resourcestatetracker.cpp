@@ -0,0 +1,165 @@
+#include "resourcestatetracker.h"
+
+#include <cassert>
+#include <iterator>
+
+//
+// ResourceStateTracker
+//
+ResourceStateTracker::ResourceStateTracker()
+    : m_FirstUnflushedPendingBarrier(0)
+    , m_NumFlushedBarriers(0)
+    , m_NumFlushes(0) {
+}
+
+void ResourceStateTracker::TransitionResource(RHIResource* resource, RHIResourceState stateAfter) {
+    assert(resource && "Cannot transition a null resource.");
+
+    auto finalState = m_FinalResourceStates.find(resource);
+    if (finalState == m_FinalResourceStates.end()) {
+        // The first use on the command list, the state before is only known at submission.
+        m_PendingResourceBarriers.push_back(RHIResourceBarrier::Transition(resource, RHIResourceState_Common, stateAfter));
+        m_FinalResourceStates[resource] = stateAfter;
+        return;
+    }
+
+    if (finalState->second == stateAfter) {
+        return;
+    }
+
+    if (!MergeTransition(resource, stateAfter)) {
+        m_ResourceBarriers.push_back(RHIResourceBarrier::Transition(resource, finalState->second, stateAfter));
+    }
+    finalState->second = stateAfter;
+}
+
+bool ResourceStateTracker::MergeTransition(RHIResource* resource, RHIResourceState stateAfter) {
+    // Nothing has used the intermediate state yet, the batched transition can go straight to the new state.
+    for (auto barrier = m_ResourceBarriers.rbegin(); barrier != m_ResourceBarriers.rend(); ++barrier) {
+        if (barrier->Type == RHIResourceBarrierType::Transition) {
+            if (barrier->Resource != resource) {
+                continue;
+            }
+
+            if (barrier->StateBefore == stateAfter) {
+                // Back to the state before the batch, the transition is not needed at all.
+                m_ResourceBarriers.erase(std::next(barrier).base());
+            } else {
+                barrier->StateAfter = stateAfter;
+            }
+            return true;
+        }
+
+        // Transitions cannot be moved across UAV and aliasing barriers of the resource.
+        if (!barrier->Resource || barrier->Resource == resource || barrier->ResourceBefore == resource) {
+            return false;
+        }
+    }
+
+    // The same holds for a first transition that has not been flushed yet. Its before state is
+    // unknown, so it stays even if it goes back to the state the resource had at first use.
+    for (size_t i = m_FirstUnflushedPendingBarrier; i < m_PendingResourceBarriers.size(); ++i) {
+        if (m_PendingResourceBarriers[i].Resource == resource) {
+            m_PendingResourceBarriers[i].StateAfter = stateAfter;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ResourceStateTracker::UAVBarrier(RHIResource* resource) {
+    m_ResourceBarriers.push_back(RHIResourceBarrier::UAV(resource));
+}
+
+void ResourceStateTracker::AliasingBarrier(RHIResource* resourceBefore, RHIResource* resourceAfter) {
+    m_ResourceBarriers.push_back(RHIResourceBarrier::Aliasing(resourceBefore, resourceAfter));
+}
+
+void ResourceStateTracker::ResourceBarrier(const RHIResourceBarrier& barrier) {
+    assert((barrier.Type != RHIResourceBarrierType::Transition || m_FinalResourceStates.count(barrier.Resource) == 0) &&
+        "Transitions of tracked resources must go through TransitionResource.");
+    m_ResourceBarriers.push_back(barrier);
+}
+
+void ResourceStateTracker::FlushResourceBarriers(RHICommandList* commandList) {
+    m_FirstUnflushedPendingBarrier = m_PendingResourceBarriers.size();
+
+    if (m_ResourceBarriers.empty()) {
+        return;
+    }
+
+    commandList->ResourceBarrier(static_cast<uint32_t>(m_ResourceBarriers.size()), m_ResourceBarriers.data());
+
+    m_NumFlushedBarriers += m_ResourceBarriers.size();
+    ++m_NumFlushes;
+    m_ResourceBarriers.clear();
+}
+
+const std::vector<RHIResourceBarrier>& ResourceStateTracker::GetPendingResourceBarriers() const {
+    return m_PendingResourceBarriers;
+}
+
+const std::unordered_map<RHIResource*, RHIResourceState>& ResourceStateTracker::GetFinalResourceStates() const {
+    return m_FinalResourceStates;
+}
+
+uint64_t ResourceStateTracker::GetNumFlushedBarriers() const {
+    return m_NumFlushedBarriers;
+}
+
+uint64_t ResourceStateTracker::GetNumFlushes() const {
+    return m_NumFlushes;
+}
+
+void ResourceStateTracker::Reset() {
+    assert(m_ResourceBarriers.empty() && "Batched barriers were never flushed.");
+
+    m_ResourceBarriers.clear();
+    m_PendingResourceBarriers.clear();
+    m_FirstUnflushedPendingBarrier = 0;
+    m_FinalResourceStates.clear();
+}
+
+//
+// ResourceStateMap
+//
+void ResourceStateMap::AddResource(RHIResource* resource, RHIResourceState state) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_ResourceStates[resource] = state;
+}
+
+void ResourceStateMap::RemoveResource(RHIResource* resource) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_ResourceStates.erase(resource);
+}
+
+bool ResourceStateMap::GetResourceState(RHIResource* resource, RHIResourceState* state) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto iter = m_ResourceStates.find(resource);
+    if (iter == m_ResourceStates.end()) {
+        return false;
+    }
+    *state = iter->second;
+    return true;
+}
+
+void ResourceStateMap::ResolveResourceStates(const ResourceStateTracker& tracker, std::vector<RHIResourceBarrier>* barriers) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    for (const RHIResourceBarrier& pendingBarrier : tracker.GetPendingResourceBarriers()) {
+        auto iter = m_ResourceStates.find(pendingBarrier.Resource);
+        assert(iter != m_ResourceStates.end() && "The resource is not tracked, add it to the ResourceStateMap.");
+        if (iter != m_ResourceStates.end() && iter->second != pendingBarrier.StateAfter) {
+            barriers->push_back(RHIResourceBarrier::Transition(pendingBarrier.Resource, iter->second, pendingBarrier.StateAfter));
+        }
+    }
+
+    for (const auto& finalState : tracker.GetFinalResourceStates()) {
+        auto iter = m_ResourceStates.find(finalState.first);
+        if (iter != m_ResourceStates.end()) {
+            iter->second = finalState.second;
+        }
+    }
+}
@@ -0,0 +1,680 @@
+#include "rhid3d12.h"
+
+#include "helpers.h"
+
+#include <d3dx12.h>
+
+#include <algorithm>
+#include <cassert>
+
+template<class T>
+using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+D3D12_COMMAND_LIST_TYPE ToD3D12(RHIQueueType type) {
+    switch (type) {
+        case RHIQueueType::Direct:
+            return D3D12_COMMAND_LIST_TYPE_DIRECT;
+        case RHIQueueType::Compute:
+            return D3D12_COMMAND_LIST_TYPE_COMPUTE;
+        case RHIQueueType::Copy:
+            return D3D12_COMMAND_LIST_TYPE_COPY;
+        default:
+            assert(false && "Invalid command queue type.");
+            return D3D12_COMMAND_LIST_TYPE_DIRECT;
+    }
+}
+
+RHIQueueType ToRHI(D3D12_COMMAND_LIST_TYPE type) {
+    switch (type) {
+        case D3D12_COMMAND_LIST_TYPE_DIRECT:
+            return RHIQueueType::Direct;
+        case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+            return RHIQueueType::Compute;
+        case D3D12_COMMAND_LIST_TYPE_COPY:
+            return RHIQueueType::Copy;
+        default:
+            assert(false && "Invalid command queue type.");
+            return RHIQueueType::Direct;
+    }
+}
+
+D3D12_DESCRIPTOR_HEAP_TYPE ToD3D12(RHIDescriptorHeapType type) {
+    switch (type) {
+        case RHIDescriptorHeapType::CbvSrvUav:
+            return D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        case RHIDescriptorHeapType::Sampler:
+            return D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+        case RHIDescriptorHeapType::Rtv:
+            return D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+        case RHIDescriptorHeapType::Dsv:
+            return D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+        default:
+            assert(false && "Invalid descriptor heap type.");
+            return D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    }
+}
+
+RHIDescriptorHeapType ToRHI(D3D12_DESCRIPTOR_HEAP_TYPE type) {
+    switch (type) {
+        case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+            return RHIDescriptorHeapType::CbvSrvUav;
+        case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+            return RHIDescriptorHeapType::Sampler;
+        case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
+            return RHIDescriptorHeapType::Rtv;
+        case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
+            return RHIDescriptorHeapType::Dsv;
+        default:
+            assert(false && "Invalid descriptor heap type.");
+            return RHIDescriptorHeapType::CbvSrvUav;
+    }
+}
+
+DXGI_FORMAT ToD3D12(RHIFormat format) {
+    switch (format) {
+        case RHIFormat::R8G8B8A8_UNorm:
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case RHIFormat::R32G32B32_Float:
+            return DXGI_FORMAT_R32G32B32_FLOAT;
+        case RHIFormat::R16_UInt:
+            return DXGI_FORMAT_R16_UINT;
+        case RHIFormat::R32_UInt:
+            return DXGI_FORMAT_R32_UINT;
+        case RHIFormat::D32_Float:
+            return DXGI_FORMAT_D32_FLOAT;
+        default:
+            return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+static D3D12_HEAP_TYPE ToD3D12(RHIHeapType type) {
+    switch (type) {
+        case RHIHeapType::Upload:
+            return D3D12_HEAP_TYPE_UPLOAD;
+        case RHIHeapType::Readback:
+            return D3D12_HEAP_TYPE_READBACK;
+        default:
+            return D3D12_HEAP_TYPE_DEFAULT;
+    }
+}
+
+static CD3DX12_RESOURCE_DESC ToD3D12(const RHIResourceDesc& desc) {
+    if (desc.Dimension == RHIResourceDimension::Buffer) {
+        return CD3DX12_RESOURCE_DESC::Buffer(desc.Width, static_cast<D3D12_RESOURCE_FLAGS>(desc.Flags));
+    }
+    return CD3DX12_RESOURCE_DESC::Tex2D(ToD3D12(desc.Format), desc.Width, desc.Height,
+        1, 1, 1, 0, static_cast<D3D12_RESOURCE_FLAGS>(desc.Flags));
+}
+
+static D3D12_HEAP_FLAGS ToD3D12(RHIHeapResourceType type) {
+    switch (type) {
+        case RHIHeapResourceType::Textures:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+        case RHIHeapResourceType::RenderTargetTextures:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        default:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    }
+}
+
+// Depth-stencils get an optimized clear value matching the clears in the renderer.
+// Returns null if the resource has no optimized clear value.
+static const D3D12_CLEAR_VALUE* GetOptimizedClearValue(const RHIResourceDesc& desc, D3D12_CLEAR_VALUE* clearValue) {
+    if (desc.Flags & RHIResourceFlag_AllowDepthStencil) {
+        *clearValue = {};
+        clearValue->Format = ToD3D12(desc.Format);
+        clearValue->DepthStencil = { 1.0f, 0 };
+        return clearValue;
+    }
+    return nullptr;
+}
+
+//
+// D3D12RHIFence
+//
+D3D12RHIFence::D3D12RHIFence(ComPtr<ID3D12Fence> fence)
+    : m_d3d12Fence(fence) {
+}
+
+uint64_t D3D12RHIFence::GetCompletedValue() const {
+    return m_d3d12Fence->GetCompletedValue();
+}
+
+void D3D12RHIFence::Signal(uint64_t value) {
+    ThrowIfFailed(m_d3d12Fence->Signal(value));
+}
+
+void D3D12RHIFence::WaitForValue(uint64_t value) {
+    if (m_d3d12Fence->GetCompletedValue() < value) {
+        // Without an event handle SetEventOnCompletion blocks until the fence
+        // reaches the value. This lets any number of threads wait at the same time.
+        ThrowIfFailed(m_d3d12Fence->SetEventOnCompletion(value, nullptr));
+    }
+}
+
+ComPtr<ID3D12Fence> D3D12RHIFence::GetD3D12Fence() const {
+    return m_d3d12Fence;
+}
+
+//
+// D3D12RHIResource
+//
+D3D12RHIResource::D3D12RHIResource(ComPtr<ID3D12Resource> resource, const RHIResourceDesc& desc)
+    : m_d3d12Resource(resource)
+    , m_Desc(desc) {
+}
+
+const RHIResourceDesc& D3D12RHIResource::GetDesc() const {
+    return m_Desc;
+}
+
+uint64_t D3D12RHIResource::GetGPUVirtualAddress() const {
+    return m_d3d12Resource->GetGPUVirtualAddress();
+}
+
+void* D3D12RHIResource::Map() {
+    void* data = nullptr;
+    ThrowIfFailed(m_d3d12Resource->Map(0, nullptr, &data));
+    return data;
+}
+
+void D3D12RHIResource::Unmap() {
+    m_d3d12Resource->Unmap(0, nullptr);
+}
+
+ComPtr<ID3D12Resource> D3D12RHIResource::GetD3D12Resource() const {
+    return m_d3d12Resource;
+}
+
+//
+// D3D12RHIHeap
+//
+D3D12RHIHeap::D3D12RHIHeap(ComPtr<ID3D12Heap> heap, const RHIHeapDesc& desc)
+    : m_d3d12Heap(heap)
+    , m_Desc(desc) {
+}
+
+const RHIHeapDesc& D3D12RHIHeap::GetDesc() const {
+    return m_Desc;
+}
+
+ComPtr<ID3D12Heap> D3D12RHIHeap::GetD3D12Heap() const {
+    return m_d3d12Heap;
+}
+
+//
+// D3D12RHIDescriptorHeap
+//
+D3D12RHIDescriptorHeap::D3D12RHIDescriptorHeap(ComPtr<ID3D12DescriptorHeap> descriptorHeap, const RHIDescriptorHeapDesc& desc)
+    : m_d3d12DescriptorHeap(descriptorHeap)
+    , m_Desc(desc) {
+}
+
+const RHIDescriptorHeapDesc& D3D12RHIDescriptorHeap::GetDesc() const {
+    return m_Desc;
+}
+
+RHICPUDescriptorHandle D3D12RHIDescriptorHeap::GetCPUDescriptorHandleForHeapStart() const {
+    return RHICPUDescriptorHandle{ m_d3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart().ptr };
+}
+
+RHIGPUDescriptorHandle D3D12RHIDescriptorHeap::GetGPUDescriptorHandleForHeapStart() const {
+    assert(m_Desc.ShaderVisible && "Only shader visible descriptor heaps have a GPU handle.");
+    return RHIGPUDescriptorHandle{ m_d3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr };
+}
+
+ComPtr<ID3D12DescriptorHeap> D3D12RHIDescriptorHeap::GetD3D12DescriptorHeap() const {
+    return m_d3d12DescriptorHeap;
+}
+
+//
+// D3D12RHIQueryHeap
+//
+D3D12RHIQueryHeap::D3D12RHIQueryHeap(ComPtr<ID3D12QueryHeap> queryHeap, RHIQueryHeapType type, uint32_t count)
+    : m_d3d12QueryHeap(queryHeap)
+    , m_Type(type)
+    , m_Count(count) {
+}
+
+RHIQueryHeapType D3D12RHIQueryHeap::GetType() const {
+    return m_Type;
+}
+
+uint32_t D3D12RHIQueryHeap::GetCount() const {
+    return m_Count;
+}
+
+ComPtr<ID3D12QueryHeap> D3D12RHIQueryHeap::GetD3D12QueryHeap() const {
+    return m_d3d12QueryHeap;
+}
+
+//
+// D3D12RHIRootSignature
+//
+D3D12RHIRootSignature::D3D12RHIRootSignature(ComPtr<ID3D12RootSignature> rootSignature)
+    : m_d3d12RootSignature(rootSignature) {
+}
+
+ComPtr<ID3D12RootSignature> D3D12RHIRootSignature::GetD3D12RootSignature() const {
+    return m_d3d12RootSignature;
+}
+
+//
+// D3D12RHICommandAllocator
+//
+D3D12RHICommandAllocator::D3D12RHICommandAllocator(ComPtr<ID3D12CommandAllocator> allocator)
+    : m_d3d12CommandAllocator(allocator) {
+}
+
+void D3D12RHICommandAllocator::Reset() {
+    ThrowIfFailed(m_d3d12CommandAllocator->Reset());
+}
+
+ComPtr<ID3D12CommandAllocator> D3D12RHICommandAllocator::GetD3D12CommandAllocator() const {
+    return m_d3d12CommandAllocator;
+}
+
+//
+// D3D12RHICommandList
+//
+D3D12RHICommandList::D3D12RHICommandList(RHIQueueType type, ComPtr<ID3D12GraphicsCommandList2> commandList,
+    std::shared_ptr<RHICommandAllocator> allocator)
+    : RHICommandList(type)
+    , m_d3d12CommandList(commandList) {
+    m_CommandAllocator = allocator;
+}
+
+void D3D12RHICommandList::Reset(std::shared_ptr<RHICommandAllocator> allocator) {
+    m_CommandAllocator = allocator;
+
+    auto d3d12Allocator = static_cast<D3D12RHICommandAllocator*>(allocator.get())->GetD3D12CommandAllocator();
+    ThrowIfFailed(m_d3d12CommandList->Reset(d3d12Allocator.Get(), nullptr));
+}
+
+void D3D12RHICommandList::Close() {
+    ThrowIfFailed(m_d3d12CommandList->Close());
+}
+
+static ID3D12Resource* GetD3D12ResourceOrNull(RHIResource* resource) {
+    return resource ? static_cast<D3D12RHIResource*>(resource)->GetD3D12Resource().Get() : nullptr;
+}
+
+void D3D12RHICommandList::ResourceBarrier(uint32_t numBarriers, const RHIResourceBarrier* barriers) {
+    // Batches are small, they are usually flushed before every draw or dispatch.
+    constexpr uint32_t MaxBarriersPerCall = 16;
+    CD3DX12_RESOURCE_BARRIER d3d12Barriers[MaxBarriersPerCall];
+
+    for (uint32_t first = 0; first < numBarriers; first += MaxBarriersPerCall) {
+        uint32_t count = std::min(numBarriers - first, MaxBarriersPerCall);
+        for (uint32_t i = 0; i < count; ++i) {
+            const RHIResourceBarrier& barrier = barriers[first + i];
+            switch (barrier.Type) {
+                case RHIResourceBarrierType::Transition:
+                    d3d12Barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(GetD3D12ResourceOrNull(barrier.Resource),
+                        static_cast<D3D12_RESOURCE_STATES>(barrier.StateBefore), static_cast<D3D12_RESOURCE_STATES>(barrier.StateAfter),
+                        D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, static_cast<D3D12_RESOURCE_BARRIER_FLAGS>(barrier.Flags));
+                    break;
+                case RHIResourceBarrierType::Aliasing:
+                    d3d12Barriers[i] = CD3DX12_RESOURCE_BARRIER::Aliasing(GetD3D12ResourceOrNull(barrier.ResourceBefore),
+                        GetD3D12ResourceOrNull(barrier.Resource));
+                    break;
+                case RHIResourceBarrierType::UAV:
+                    d3d12Barriers[i] = CD3DX12_RESOURCE_BARRIER::UAV(GetD3D12ResourceOrNull(barrier.Resource));
+                    break;
+            }
+        }
+
+        m_d3d12CommandList->ResourceBarrier(count, d3d12Barriers);
+    }
+}
+
+void D3D12RHICommandList::CopyBufferRegion(RHIResource* dstBuffer, uint64_t dstOffset,
+    RHIResource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) {
+    m_d3d12CommandList->CopyBufferRegion(
+        static_cast<D3D12RHIResource*>(dstBuffer)->GetD3D12Resource().Get(), dstOffset,
+        static_cast<D3D12RHIResource*>(srcBuffer)->GetD3D12Resource().Get(), srcOffset,
+        numBytes);
+}
+
+void D3D12RHICommandList::ClearRenderTargetView(RHICPUDescriptorHandle rtv, const float clearColor[4]) {
+    m_d3d12CommandList->ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE{ rtv.ptr }, clearColor, 0, nullptr);
+}
+
+void D3D12RHICommandList::ClearDepthStencilView(RHICPUDescriptorHandle dsv, float depth) {
+    m_d3d12CommandList->ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE{ dsv.ptr },
+        D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr);
+}
+
+void D3D12RHICommandList::OMSetRenderTargets(uint32_t numRenderTargets, const RHICPUDescriptorHandle* rtvs,
+    const RHICPUDescriptorHandle* dsv) {
+    static_assert(sizeof(RHICPUDescriptorHandle) == sizeof(D3D12_CPU_DESCRIPTOR_HANDLE),
+        "RHI descriptor handles must be layout compatible with D3D12 descriptor handles.");
+
+    m_d3d12CommandList->OMSetRenderTargets(numRenderTargets,
+        reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(rtvs), FALSE,
+        reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(dsv));
+}
+
+void D3D12RHICommandList::RSSetViewport(const RHIViewport& viewport) {
+    static_assert(sizeof(RHIViewport) == sizeof(D3D12_VIEWPORT),
+        "RHI viewports must be layout compatible with D3D12 viewports.");
+
+    m_d3d12CommandList->RSSetViewports(1, reinterpret_cast<const D3D12_VIEWPORT*>(&viewport));
+}
+
+void D3D12RHICommandList::RSSetScissorRect(const RHIRect& rect) {
+    D3D12_RECT d3d12Rect = { rect.left, rect.top, rect.right, rect.bottom };
+    m_d3d12CommandList->RSSetScissorRects(1, &d3d12Rect);
+}
+
+void D3D12RHICommandList::IASetVertexBuffer(uint32_t slot, uint64_t bufferLocation, uint32_t sizeInBytes, uint32_t strideInBytes) {
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView = { bufferLocation, sizeInBytes, strideInBytes };
+    m_d3d12CommandList->IASetVertexBuffers(slot, 1, &vertexBufferView);
+}
+
+void D3D12RHICommandList::IASetIndexBuffer(uint64_t bufferLocation, uint32_t sizeInBytes, RHIFormat format) {
+    D3D12_INDEX_BUFFER_VIEW indexBufferView = { bufferLocation, sizeInBytes, ToD3D12(format) };
+    m_d3d12CommandList->IASetIndexBuffer(&indexBufferView);
+}
+
+void D3D12RHICommandList::SetGraphicsRootSignature(RHIRootSignature* rootSignature) {
+    m_d3d12CommandList->SetGraphicsRootSignature(
+        static_cast<D3D12RHIRootSignature*>(rootSignature)->GetD3D12RootSignature().Get());
+}
+
+void D3D12RHICommandList::SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues,
+    const void* pSrcData, uint32_t destOffsetIn32BitValues) {
+    m_d3d12CommandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, pSrcData, destOffsetIn32BitValues);
+}
+
+void D3D12RHICommandList::SetDescriptorHeaps(uint32_t numDescriptorHeaps, RHIDescriptorHeap* const* ppDescriptorHeaps) {
+    ID3D12DescriptorHeap* descriptorHeaps[static_cast<size_t>(RHIDescriptorHeapType::NumTypes)];
+    assert(numDescriptorHeaps <= _countof(descriptorHeaps) && "Too many descriptor heaps.");
+
+    for (uint32_t i = 0; i < numDescriptorHeaps; ++i) {
+        descriptorHeaps[i] = static_cast<D3D12RHIDescriptorHeap*>(ppDescriptorHeaps[i])->GetD3D12DescriptorHeap().Get();
+    }
+    m_d3d12CommandList->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
+}
+
+void D3D12RHICommandList::SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) {
+    m_d3d12CommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE{ baseDescriptor.ptr });
+}
+
+void D3D12RHICommandList::SetComputeRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) {
+    m_d3d12CommandList->SetComputeRootDescriptorTable(rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE{ baseDescriptor.ptr });
+}
+
+void D3D12RHICommandList::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount,
+    uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) {
+    m_d3d12CommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount,
+        startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void D3D12RHICommandList::Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) {
+    m_d3d12CommandList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+}
+
+void D3D12RHICommandList::EndQuery(RHIQueryHeap* queryHeap, uint32_t index) {
+    // Both timestamp heap types hold D3D12_QUERY_TYPE_TIMESTAMP queries.
+    m_d3d12CommandList->EndQuery(static_cast<D3D12RHIQueryHeap*>(queryHeap)->GetD3D12QueryHeap().Get(),
+        D3D12_QUERY_TYPE_TIMESTAMP, index);
+}
+
+void D3D12RHICommandList::ResolveQueryData(RHIQueryHeap* queryHeap, uint32_t startIndex, uint32_t numQueries,
+    RHIResource* dstBuffer, uint64_t dstOffset) {
+    m_d3d12CommandList->ResolveQueryData(static_cast<D3D12RHIQueryHeap*>(queryHeap)->GetD3D12QueryHeap().Get(),
+        D3D12_QUERY_TYPE_TIMESTAMP, startIndex, numQueries,
+        static_cast<D3D12RHIResource*>(dstBuffer)->GetD3D12Resource().Get(), dstOffset);
+}
+
+ComPtr<ID3D12GraphicsCommandList2> D3D12RHICommandList::GetD3D12CommandList() const {
+    return m_d3d12CommandList;
+}
+
+//
+// D3D12RHICommandQueue
+//
+D3D12RHICommandQueue::D3D12RHICommandQueue(ComPtr<ID3D12CommandQueue> commandQueue, RHIQueueType type)
+    : m_d3d12CommandQueue(commandQueue)
+    , m_Type(type) {
+}
+
+RHIQueueType D3D12RHICommandQueue::GetType() const {
+    return m_Type;
+}
+
+void D3D12RHICommandQueue::ExecuteCommandLists(uint32_t numCommandLists, RHICommandList* const* ppCommandLists) {
+    // Command lists are submitted in small batches, avoid a heap allocation.
+    constexpr uint32_t MaxBatchSize = 64;
+    ID3D12CommandList* d3d12CommandLists[MaxBatchSize];
+
+    while (numCommandLists > 0) {
+        uint32_t batchSize = numCommandLists < MaxBatchSize ? numCommandLists : MaxBatchSize;
+        for (uint32_t i = 0; i < batchSize; ++i) {
+            d3d12CommandLists[i] = static_cast<D3D12RHICommandList*>(ppCommandLists[i])->GetD3D12CommandList().Get();
+        }
+
+        m_d3d12CommandQueue->ExecuteCommandLists(batchSize, d3d12CommandLists);
+
+        ppCommandLists += batchSize;
+        numCommandLists -= batchSize;
+    }
+}
+
+void D3D12RHICommandQueue::Signal(RHIFence* fence, uint64_t value) {
+    ThrowIfFailed(m_d3d12CommandQueue->Signal(static_cast<D3D12RHIFence*>(fence)->GetD3D12Fence().Get(), value));
+}
+
+void D3D12RHICommandQueue::Wait(RHIFence* fence, uint64_t value) {
+    ThrowIfFailed(m_d3d12CommandQueue->Wait(static_cast<D3D12RHIFence*>(fence)->GetD3D12Fence().Get(), value));
+}
+
+uint64_t D3D12RHICommandQueue::GetTimestampFrequency() const {
+    UINT64 frequency = 0;
+    ThrowIfFailed(m_d3d12CommandQueue->GetTimestampFrequency(&frequency));
+    return frequency;
+}
+
+void D3D12RHICommandQueue::GetClockCalibration(uint64_t* gpuTimestamp, uint64_t* cpuTimestamp) const {
+    UINT64 gpuTicks = 0;
+    UINT64 cpuTicks = 0;
+    ThrowIfFailed(m_d3d12CommandQueue->GetClockCalibration(&gpuTicks, &cpuTicks));
+
+    // The CPU timestamp is a QueryPerformanceCounter value, which is also the
+    // source of std::chrono::high_resolution_clock. Convert it the same way.
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    const uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+
+    *gpuTimestamp = gpuTicks;
+    *cpuTimestamp = cpuTicks / ticksPerSecond * 1000000000ull + cpuTicks % ticksPerSecond * 1000000000ull / ticksPerSecond;
+}
+
+ComPtr<ID3D12CommandQueue> D3D12RHICommandQueue::GetD3D12CommandQueue() const {
+    return m_d3d12CommandQueue;
+}
+
+//
+// D3D12RHIDevice
+//
+D3D12RHIDevice::D3D12RHIDevice(ComPtr<ID3D12Device2> device)
+    : m_d3d12Device(device)
+    , m_CopyQueueTimestampQueriesSupported(false) {
+    for (size_t i = 0; i < static_cast<size_t>(RHIDescriptorHeapType::NumTypes); ++i) {
+        m_DescriptorHandleIncrementSize[i] =
+            m_d3d12Device->GetDescriptorHandleIncrementSize(ToD3D12(static_cast<RHIDescriptorHeapType>(i)));
+    }
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS3 options3 = {};
+    if (SUCCEEDED(m_d3d12Device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS3, &options3, sizeof(options3)))) {
+        m_CopyQueueTimestampQueriesSupported = options3.CopyQueueTimestampQueriesSupported == TRUE;
+    }
+}
+
+RHIBackend D3D12RHIDevice::GetBackend() const {
+    return RHIBackend::D3D12;
+}
+
+std::shared_ptr<RHICommandQueue> D3D12RHIDevice::CreateCommandQueue(RHIQueueType type) {
+    D3D12_COMMAND_QUEUE_DESC desc = {};
+    desc.Type = ToD3D12(type);
+    desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+    desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    desc.NodeMask = 0;
+
+    ComPtr<ID3D12CommandQueue> commandQueue;
+    ThrowIfFailed(m_d3d12Device->CreateCommandQueue(&desc, IID_PPV_ARGS(&commandQueue)));
+
+    return std::make_shared<D3D12RHICommandQueue>(commandQueue, type);
+}
+
+std::shared_ptr<RHICommandAllocator> D3D12RHIDevice::CreateCommandAllocator(RHIQueueType type) {
+    ComPtr<ID3D12CommandAllocator> commandAllocator;
+    ThrowIfFailed(m_d3d12Device->CreateCommandAllocator(ToD3D12(type), IID_PPV_ARGS(&commandAllocator)));
+
+    return std::make_shared<D3D12RHICommandAllocator>(commandAllocator);
+}
+
+std::shared_ptr<RHICommandList> D3D12RHIDevice::CreateCommandList(RHIQueueType type,
+    std::shared_ptr<RHICommandAllocator> allocator) {
+    auto d3d12Allocator = static_cast<D3D12RHICommandAllocator*>(allocator.get())->GetD3D12CommandAllocator();
+
+    ComPtr<ID3D12GraphicsCommandList2> commandList;
+    ThrowIfFailed(m_d3d12Device->CreateCommandList(0, ToD3D12(type), d3d12Allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+
+    return std::make_shared<D3D12RHICommandList>(type, commandList, allocator);
+}
+
+std::shared_ptr<RHIFence> D3D12RHIDevice::CreateFence(uint64_t initialValue) {
+    ComPtr<ID3D12Fence> fence;
+    ThrowIfFailed(m_d3d12Device->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+
+    return std::make_shared<D3D12RHIFence>(fence);
+}
+
+std::shared_ptr<RHIResource> D3D12RHIDevice::CreateCommittedResource(RHIHeapType heapType,
+    const RHIResourceDesc& desc, RHIResourceState initialState) {
+    CD3DX12_HEAP_PROPERTIES heapProperties(ToD3D12(heapType));
+    CD3DX12_RESOURCE_DESC resourceDesc = ToD3D12(desc);
+    D3D12_CLEAR_VALUE optimizedClearValue;
+
+    ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(m_d3d12Device->CreateCommittedResource(
+        &heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &resourceDesc,
+        static_cast<D3D12_RESOURCE_STATES>(initialState),
+        GetOptimizedClearValue(desc, &optimizedClearValue),
+        IID_PPV_ARGS(&resource)));
+
+    return std::make_shared<D3D12RHIResource>(resource, desc);
+}
+
+std::shared_ptr<RHIHeap> D3D12RHIDevice::CreateHeap(const RHIHeapDesc& desc) {
+    CD3DX12_HEAP_DESC heapDesc(desc.Size, ToD3D12(desc.Type), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+        ToD3D12(desc.ResourceType));
+
+    ComPtr<ID3D12Heap> heap;
+    ThrowIfFailed(m_d3d12Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+
+    return std::make_shared<D3D12RHIHeap>(heap, desc);
+}
+
+std::shared_ptr<RHIResource> D3D12RHIDevice::CreatePlacedResource(RHIHeap* heap, uint64_t heapOffset,
+    const RHIResourceDesc& desc, RHIResourceState initialState) {
+    CD3DX12_RESOURCE_DESC resourceDesc = ToD3D12(desc);
+    D3D12_CLEAR_VALUE optimizedClearValue;
+
+    ComPtr<ID3D12Resource> resource;
+    ThrowIfFailed(m_d3d12Device->CreatePlacedResource(
+        static_cast<D3D12RHIHeap*>(heap)->GetD3D12Heap().Get(),
+        heapOffset,
+        &resourceDesc,
+        static_cast<D3D12_RESOURCE_STATES>(initialState),
+        GetOptimizedClearValue(desc, &optimizedClearValue),
+        IID_PPV_ARGS(&resource)));
+
+    return std::make_shared<D3D12RHIResource>(resource, desc);
+}
+
+RHIResourceAllocationInfo D3D12RHIDevice::GetResourceAllocationInfo(const RHIResourceDesc& desc) const {
+    CD3DX12_RESOURCE_DESC resourceDesc = ToD3D12(desc);
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_d3d12Device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+    return RHIResourceAllocationInfo{ allocationInfo.SizeInBytes, allocationInfo.Alignment };
+}
+
+std::shared_ptr<RHIDescriptorHeap> D3D12RHIDevice::CreateDescriptorHeap(const RHIDescriptorHeapDesc& desc) {
+    D3D12_DESCRIPTOR_HEAP_DESC d3d12Desc = {};
+    d3d12Desc.Type = ToD3D12(desc.Type);
+    d3d12Desc.NumDescriptors = desc.NumDescriptors;
+    d3d12Desc.Flags = desc.ShaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    d3d12Desc.NodeMask = 0;
+
+    ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+    ThrowIfFailed(m_d3d12Device->CreateDescriptorHeap(&d3d12Desc, IID_PPV_ARGS(&descriptorHeap)));
+
+    return std::make_shared<D3D12RHIDescriptorHeap>(descriptorHeap, desc);
+}
+
+uint32_t D3D12RHIDevice::GetDescriptorHandleIncrementSize(RHIDescriptorHeapType type) const {
+    return m_DescriptorHandleIncrementSize[static_cast<size_t>(type)];
+}
+
+void D3D12RHIDevice::CopyDescriptors(uint32_t numDestRanges, const RHICPUDescriptorHandle* destRangeStarts,
+    const uint32_t* destRangeSizes, uint32_t numSrcRanges, const RHICPUDescriptorHandle* srcRangeStarts,
+    const uint32_t* srcRangeSizes, RHIDescriptorHeapType type) {
+    // RHICPUDescriptorHandle is layout compatible with D3D12_CPU_DESCRIPTOR_HANDLE.
+    m_d3d12Device->CopyDescriptors(
+        numDestRanges, reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(destRangeStarts), destRangeSizes,
+        numSrcRanges, reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(srcRangeStarts), srcRangeSizes,
+        ToD3D12(type));
+}
+
+std::shared_ptr<RHIQueryHeap> D3D12RHIDevice::CreateQueryHeap(RHIQueryHeapType type, uint32_t count) {
+    D3D12_QUERY_HEAP_DESC desc = {};
+    desc.Type = type == RHIQueryHeapType::CopyQueueTimestamp ?
+        D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP : D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    desc.Count = count;
+    desc.NodeMask = 0;
+
+    ComPtr<ID3D12QueryHeap> queryHeap;
+    ThrowIfFailed(m_d3d12Device->CreateQueryHeap(&desc, IID_PPV_ARGS(&queryHeap)));
+
+    return std::make_shared<D3D12RHIQueryHeap>(queryHeap, type, count);
+}
+
+bool D3D12RHIDevice::IsTimestampQuerySupported(RHIQueueType type) const {
+    return type != RHIQueueType::Copy || m_CopyQueueTimestampQueriesSupported;
+}
+
+ComPtr<ID3D12Device2> D3D12RHIDevice::GetD3D12Device() const {
+    return m_d3d12Device;
+}
+
+//
+// Native object access
+//
+ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList(const std::shared_ptr<RHICommandList>& commandList) {
+    return static_cast<D3D12RHICommandList*>(commandList.get())->GetD3D12CommandList();
+}
+
+ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList(RHICommandList* commandList) {
+    return static_cast<D3D12RHICommandList*>(commandList)->GetD3D12CommandList();
+}
+
+ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue(const std::shared_ptr<RHICommandQueue>& commandQueue) {
+    return static_cast<D3D12RHICommandQueue*>(commandQueue.get())->GetD3D12CommandQueue();
+}
+
+ComPtr<ID3D12Resource> GetD3D12Resource(const std::shared_ptr<RHIResource>& resource) {
+    return GetD3D12Resource(resource.get());
+}
+
+ComPtr<ID3D12Resource> GetD3D12Resource(RHIResource* resource) {
+    return static_cast<D3D12RHIResource*>(resource)->GetD3D12Resource();
+}
+
+ComPtr<ID3D12Fence> GetD3D12Fence(const std::shared_ptr<RHIFence>& fence) {
+    return static_cast<D3D12RHIFence*>(fence.get())->GetD3D12Fence();
+}
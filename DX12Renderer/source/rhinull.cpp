@@ -0,0 +1,741 @@
+#include "rhinull.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+// Fake GPU virtual addresses are handed out with the same alignment
+// as committed resources in D3D12.
+static constexpr uint64_t NullResourceAlignment = 64 * 1024;
+static constexpr uint32_t NullDescriptorSize = 32;
+
+// Synthetic cost of replayed commands on the virtual GPU clock, in nanoseconds.
+static constexpr uint64_t NullCommandCost = 100;
+static constexpr uint64_t NullClearCost = 20 * 1000;
+static constexpr uint64_t NullDrawCost = 5 * 1000;
+static constexpr uint64_t NullDispatchCostPerGroup = 100;
+// Every barrier batch drains the virtual GPU once.
+static constexpr uint64_t NullBarrierBatchCost = 1000;
+// Bytes copied per nanosecond (16 GB/s).
+static constexpr uint64_t NullCopyBytesPerNanosecond = 16;
+
+// Command payloads. These follow the NullRHICommandHeader in the command stream.
+namespace {
+// Followed by NumBarriers RHIResourceBarrier.
+struct ResourceBarrierCommand {
+    uint32_t NumBarriers;
+};
+
+struct CopyBufferRegionCommand {
+    RHIResource* Dst;
+    uint64_t DstOffset;
+    RHIResource* Src;
+    uint64_t SrcOffset;
+    uint64_t NumBytes;
+};
+
+struct ClearRenderTargetViewCommand {
+    RHICPUDescriptorHandle Rtv;
+    float Color[4];
+};
+
+struct ClearDepthStencilViewCommand {
+    RHICPUDescriptorHandle Dsv;
+    float Depth;
+};
+
+// Followed by NumRenderTargets RHICPUDescriptorHandles.
+struct OMSetRenderTargetsCommand {
+    uint32_t NumRenderTargets;
+    bool HasDepthStencil;
+    RHICPUDescriptorHandle Dsv;
+};
+
+struct IASetVertexBufferCommand {
+    uint32_t Slot;
+    uint64_t BufferLocation;
+    uint32_t SizeInBytes;
+    uint32_t StrideInBytes;
+};
+
+struct IASetIndexBufferCommand {
+    uint64_t BufferLocation;
+    uint32_t SizeInBytes;
+    RHIFormat Format;
+};
+
+struct SetGraphicsRootSignatureCommand {
+    RHIRootSignature* RootSignature;
+};
+
+// Followed by Num32BitValues 32-bit values.
+struct SetGraphicsRoot32BitConstantsCommand {
+    uint32_t RootParameterIndex;
+    uint32_t Num32BitValues;
+    uint32_t DestOffsetIn32BitValues;
+};
+
+// Followed by NumDescriptorHeaps RHIDescriptorHeap pointers.
+struct SetDescriptorHeapsCommand {
+    uint32_t NumDescriptorHeaps;
+};
+
+struct SetRootDescriptorTableCommand {
+    uint32_t RootParameterIndex;
+    RHIGPUDescriptorHandle BaseDescriptor;
+};
+
+struct DrawIndexedInstancedCommand {
+    uint32_t IndexCountPerInstance;
+    uint32_t InstanceCount;
+    uint32_t StartIndexLocation;
+    int32_t BaseVertexLocation;
+    uint32_t StartInstanceLocation;
+};
+
+struct DispatchCommand {
+    uint32_t ThreadGroupCountX;
+    uint32_t ThreadGroupCountY;
+    uint32_t ThreadGroupCountZ;
+};
+
+struct EndQueryCommand {
+    RHIQueryHeap* QueryHeap;
+    uint32_t Index;
+};
+
+struct ResolveQueryDataCommand {
+    RHIQueryHeap* QueryHeap;
+    uint32_t StartIndex;
+    uint32_t NumQueries;
+    RHIResource* Dst;
+    uint64_t DstOffset;
+};
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t GetCPUTimestamp() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count());
+}
+
+//
+// NullRHIFence
+//
+NullRHIFence::NullRHIFence(uint64_t initialValue)
+    : m_CompletedValue(initialValue) {
+}
+
+uint64_t NullRHIFence::GetCompletedValue() const {
+    return m_CompletedValue.load(std::memory_order_acquire);
+}
+
+void NullRHIFence::Signal(uint64_t value) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_CompletedValue.store(value, std::memory_order_release);
+    }
+    m_Condition.notify_all();
+}
+
+void NullRHIFence::WaitForValue(uint64_t value) {
+    if (GetCompletedValue() >= value) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Condition.wait(lock, [this, value]() { return GetCompletedValue() >= value; });
+}
+
+//
+// NullRHIResource
+//
+NullRHIResource::NullRHIResource(RHIHeapType heapType, const RHIResourceDesc& desc, RHIResourceState initialState,
+    uint64_t gpuVirtualAddress)
+    : m_HeapType(heapType)
+    , m_Desc(desc)
+    , m_State(initialState)
+    , m_GPUVirtualAddress(gpuVirtualAddress)
+    , m_PlacedData(nullptr) {
+    if (m_Desc.Dimension == RHIResourceDimension::Buffer) {
+        m_Data.resize(static_cast<size_t>(m_Desc.Width));
+    }
+}
+
+NullRHIResource::NullRHIResource(RHIHeapType heapType, const RHIResourceDesc& desc, RHIResourceState initialState,
+    uint64_t gpuVirtualAddress, uint8_t* placedData)
+    : m_HeapType(heapType)
+    , m_Desc(desc)
+    , m_State(initialState)
+    , m_GPUVirtualAddress(gpuVirtualAddress)
+    , m_PlacedData(placedData) {
+}
+
+const RHIResourceDesc& NullRHIResource::GetDesc() const {
+    return m_Desc;
+}
+
+uint64_t NullRHIResource::GetGPUVirtualAddress() const {
+    return m_GPUVirtualAddress;
+}
+
+void* NullRHIResource::Map() {
+    assert(m_HeapType != RHIHeapType::Default && "Resources in the default heap cannot be mapped.");
+    assert(m_Desc.Dimension == RHIResourceDimension::Buffer && "Only buffers can be mapped.");
+    return GetData();
+}
+
+void NullRHIResource::Unmap() {
+}
+
+uint8_t* NullRHIResource::GetData() {
+    return m_PlacedData ? m_PlacedData : m_Data.data();
+}
+
+RHIHeapType NullRHIResource::GetHeapType() const {
+    return m_HeapType;
+}
+
+RHIResourceState NullRHIResource::GetState() const {
+    return m_State;
+}
+
+void NullRHIResource::SetState(RHIResourceState state) {
+    m_State = state;
+}
+
+//
+// NullRHIHeap
+//
+NullRHIHeap::NullRHIHeap(const RHIHeapDesc& desc, uint64_t gpuBaseAddress)
+    : m_Desc(desc)
+    , m_GPUBaseAddress(gpuBaseAddress) {
+    // Left uninitialized on purpose, the OS only commits the pages buffers write to.
+    if (m_Desc.ResourceType == RHIHeapResourceType::Buffers) {
+        m_Data.reset(new uint8_t[static_cast<size_t>(m_Desc.Size)]);
+    }
+}
+
+const RHIHeapDesc& NullRHIHeap::GetDesc() const {
+    return m_Desc;
+}
+
+uint64_t NullRHIHeap::GetGPUBaseAddress() const {
+    return m_GPUBaseAddress;
+}
+
+uint8_t* NullRHIHeap::GetData() {
+    return m_Data.get();
+}
+
+//
+// NullRHIDescriptorHeap
+//
+NullRHIDescriptorHeap::NullRHIDescriptorHeap(const RHIDescriptorHeapDesc& desc, uint32_t incrementSize, uint64_t gpuBaseAddress)
+    : m_Desc(desc)
+    , m_GPUBaseAddress(gpuBaseAddress)
+    , m_Descriptors(static_cast<size_t>(desc.NumDescriptors) * incrementSize) {
+}
+
+const RHIDescriptorHeapDesc& NullRHIDescriptorHeap::GetDesc() const {
+    return m_Desc;
+}
+
+RHICPUDescriptorHandle NullRHIDescriptorHeap::GetCPUDescriptorHandleForHeapStart() const {
+    return RHICPUDescriptorHandle{ reinterpret_cast<size_t>(m_Descriptors.data()) };
+}
+
+RHIGPUDescriptorHandle NullRHIDescriptorHeap::GetGPUDescriptorHandleForHeapStart() const {
+    assert(m_Desc.ShaderVisible && "Only shader visible descriptor heaps have a GPU handle.");
+    return RHIGPUDescriptorHandle{ m_GPUBaseAddress };
+}
+
+//
+// NullRHIQueryHeap
+//
+NullRHIQueryHeap::NullRHIQueryHeap(RHIQueryHeapType type, uint32_t count)
+    : m_Type(type)
+    , m_Data(count, 0) {
+}
+
+RHIQueryHeapType NullRHIQueryHeap::GetType() const {
+    return m_Type;
+}
+
+uint32_t NullRHIQueryHeap::GetCount() const {
+    return static_cast<uint32_t>(m_Data.size());
+}
+
+uint64_t* NullRHIQueryHeap::GetData() {
+    return m_Data.data();
+}
+
+//
+// NullRHICommandAllocator
+//
+void NullRHICommandAllocator::Reset() {
+}
+
+//
+// NullRHICommandList
+//
+NullRHICommandList::NullRHICommandList(RHIQueueType type, std::shared_ptr<RHICommandAllocator> allocator)
+    : RHICommandList(type)
+    , m_CommandCount(0)
+    , m_Closed(false) {
+    m_CommandAllocator = allocator;
+}
+
+template<typename T>
+T* NullRHICommandList::Record(NullRHICommandType type, size_t extraBytes) {
+    assert(!m_Closed && "Cannot record commands into a closed command list.");
+
+    const size_t commandSize = AlignUp(sizeof(NullRHICommandHeader) + sizeof(T) + extraBytes, alignof(uint64_t));
+    const size_t offset = m_CommandData.size();
+    m_CommandData.resize(offset + commandSize);
+
+    NullRHICommandHeader* header = reinterpret_cast<NullRHICommandHeader*>(m_CommandData.data() + offset);
+    header->Type = type;
+    header->Size = static_cast<uint32_t>(commandSize);
+
+    ++m_CommandCount;
+
+    return reinterpret_cast<T*>(header + 1);
+}
+
+void NullRHICommandList::Reset(std::shared_ptr<RHICommandAllocator> allocator) {
+    m_CommandAllocator = allocator;
+    // Keep the capacity so recording the next frame does not allocate.
+    m_CommandData.clear();
+    m_CommandCount = 0;
+    m_Closed = false;
+}
+
+void NullRHICommandList::Close() {
+    m_Closed = true;
+}
+
+void NullRHICommandList::ResourceBarrier(uint32_t numBarriers, const RHIResourceBarrier* barriers) {
+    auto command = Record<ResourceBarrierCommand>(NullRHICommandType::ResourceBarrier,
+        numBarriers * sizeof(RHIResourceBarrier));
+    command->NumBarriers = numBarriers;
+    if (numBarriers > 0) {
+        std::memcpy(command + 1, barriers, numBarriers * sizeof(RHIResourceBarrier));
+    }
+}
+
+void NullRHICommandList::CopyBufferRegion(RHIResource* dstBuffer, uint64_t dstOffset,
+    RHIResource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) {
+    assert(dstOffset + numBytes <= dstBuffer->GetDesc().Width && "Copy destination out of range.");
+    assert(srcOffset + numBytes <= srcBuffer->GetDesc().Width && "Copy source out of range.");
+
+    auto command = Record<CopyBufferRegionCommand>(NullRHICommandType::CopyBufferRegion);
+    command->Dst = dstBuffer;
+    command->DstOffset = dstOffset;
+    command->Src = srcBuffer;
+    command->SrcOffset = srcOffset;
+    command->NumBytes = numBytes;
+}
+
+void NullRHICommandList::ClearRenderTargetView(RHICPUDescriptorHandle rtv, const float clearColor[4]) {
+    auto command = Record<ClearRenderTargetViewCommand>(NullRHICommandType::ClearRenderTargetView);
+    command->Rtv = rtv;
+    std::memcpy(command->Color, clearColor, sizeof(command->Color));
+}
+
+void NullRHICommandList::ClearDepthStencilView(RHICPUDescriptorHandle dsv, float depth) {
+    auto command = Record<ClearDepthStencilViewCommand>(NullRHICommandType::ClearDepthStencilView);
+    command->Dsv = dsv;
+    command->Depth = depth;
+}
+
+void NullRHICommandList::OMSetRenderTargets(uint32_t numRenderTargets, const RHICPUDescriptorHandle* rtvs,
+    const RHICPUDescriptorHandle* dsv) {
+    auto command = Record<OMSetRenderTargetsCommand>(NullRHICommandType::OMSetRenderTargets,
+        numRenderTargets * sizeof(RHICPUDescriptorHandle));
+    command->NumRenderTargets = numRenderTargets;
+    command->HasDepthStencil = dsv != nullptr;
+    command->Dsv = dsv ? *dsv : RHICPUDescriptorHandle{ 0 };
+    if (numRenderTargets > 0) {
+        std::memcpy(command + 1, rtvs, numRenderTargets * sizeof(RHICPUDescriptorHandle));
+    }
+}
+
+void NullRHICommandList::RSSetViewport(const RHIViewport& viewport) {
+    *Record<RHIViewport>(NullRHICommandType::RSSetViewport) = viewport;
+}
+
+void NullRHICommandList::RSSetScissorRect(const RHIRect& rect) {
+    *Record<RHIRect>(NullRHICommandType::RSSetScissorRect) = rect;
+}
+
+void NullRHICommandList::IASetVertexBuffer(uint32_t slot, uint64_t bufferLocation, uint32_t sizeInBytes, uint32_t strideInBytes) {
+    auto command = Record<IASetVertexBufferCommand>(NullRHICommandType::IASetVertexBuffer);
+    command->Slot = slot;
+    command->BufferLocation = bufferLocation;
+    command->SizeInBytes = sizeInBytes;
+    command->StrideInBytes = strideInBytes;
+}
+
+void NullRHICommandList::IASetIndexBuffer(uint64_t bufferLocation, uint32_t sizeInBytes, RHIFormat format) {
+    auto command = Record<IASetIndexBufferCommand>(NullRHICommandType::IASetIndexBuffer);
+    command->BufferLocation = bufferLocation;
+    command->SizeInBytes = sizeInBytes;
+    command->Format = format;
+}
+
+void NullRHICommandList::SetGraphicsRootSignature(RHIRootSignature* rootSignature) {
+    Record<SetGraphicsRootSignatureCommand>(NullRHICommandType::SetGraphicsRootSignature)->RootSignature = rootSignature;
+}
+
+void NullRHICommandList::SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues,
+    const void* pSrcData, uint32_t destOffsetIn32BitValues) {
+    auto command = Record<SetGraphicsRoot32BitConstantsCommand>(NullRHICommandType::SetGraphicsRoot32BitConstants,
+        num32BitValues * sizeof(uint32_t));
+    command->RootParameterIndex = rootParameterIndex;
+    command->Num32BitValues = num32BitValues;
+    command->DestOffsetIn32BitValues = destOffsetIn32BitValues;
+    std::memcpy(command + 1, pSrcData, num32BitValues * sizeof(uint32_t));
+}
+
+void NullRHICommandList::SetDescriptorHeaps(uint32_t numDescriptorHeaps, RHIDescriptorHeap* const* ppDescriptorHeaps) {
+    for (uint32_t i = 0; i < numDescriptorHeaps; ++i) {
+        assert(ppDescriptorHeaps[i]->GetDesc().ShaderVisible && "Only shader visible descriptor heaps can be bound.");
+    }
+
+    auto command = Record<SetDescriptorHeapsCommand>(NullRHICommandType::SetDescriptorHeaps,
+        numDescriptorHeaps * sizeof(RHIDescriptorHeap*));
+    command->NumDescriptorHeaps = numDescriptorHeaps;
+    if (numDescriptorHeaps > 0) {
+        std::memcpy(command + 1, ppDescriptorHeaps, numDescriptorHeaps * sizeof(RHIDescriptorHeap*));
+    }
+}
+
+void NullRHICommandList::SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) {
+    auto command = Record<SetRootDescriptorTableCommand>(NullRHICommandType::SetGraphicsRootDescriptorTable);
+    command->RootParameterIndex = rootParameterIndex;
+    command->BaseDescriptor = baseDescriptor;
+}
+
+void NullRHICommandList::SetComputeRootDescriptorTable(uint32_t rootParameterIndex, RHIGPUDescriptorHandle baseDescriptor) {
+    auto command = Record<SetRootDescriptorTableCommand>(NullRHICommandType::SetComputeRootDescriptorTable);
+    command->RootParameterIndex = rootParameterIndex;
+    command->BaseDescriptor = baseDescriptor;
+}
+
+void NullRHICommandList::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount,
+    uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) {
+    auto command = Record<DrawIndexedInstancedCommand>(NullRHICommandType::DrawIndexedInstanced);
+    command->IndexCountPerInstance = indexCountPerInstance;
+    command->InstanceCount = instanceCount;
+    command->StartIndexLocation = startIndexLocation;
+    command->BaseVertexLocation = baseVertexLocation;
+    command->StartInstanceLocation = startInstanceLocation;
+}
+
+void NullRHICommandList::Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) {
+    assert(m_Type != RHIQueueType::Copy && "Dispatch is not supported on copy command lists.");
+
+    auto command = Record<DispatchCommand>(NullRHICommandType::Dispatch);
+    command->ThreadGroupCountX = threadGroupCountX;
+    command->ThreadGroupCountY = threadGroupCountY;
+    command->ThreadGroupCountZ = threadGroupCountZ;
+}
+
+void NullRHICommandList::EndQuery(RHIQueryHeap* queryHeap, uint32_t index) {
+    assert(index < queryHeap->GetCount() && "Query index out of range.");
+    assert((queryHeap->GetType() == RHIQueryHeapType::CopyQueueTimestamp) == (m_Type == RHIQueueType::Copy) &&
+        "Copy command lists need a copy queue timestamp heap.");
+
+    auto command = Record<EndQueryCommand>(NullRHICommandType::EndQuery);
+    command->QueryHeap = queryHeap;
+    command->Index = index;
+}
+
+void NullRHICommandList::ResolveQueryData(RHIQueryHeap* queryHeap, uint32_t startIndex, uint32_t numQueries,
+    RHIResource* dstBuffer, uint64_t dstOffset) {
+    assert(startIndex + numQueries <= queryHeap->GetCount() && "Query range out of range.");
+    assert(dstOffset % sizeof(uint64_t) == 0 && "Query results must be resolved to an 8 byte aligned offset.");
+    assert(dstOffset + numQueries * sizeof(uint64_t) <= dstBuffer->GetDesc().Width && "Resolve destination out of range.");
+
+    auto command = Record<ResolveQueryDataCommand>(NullRHICommandType::ResolveQueryData);
+    command->QueryHeap = queryHeap;
+    command->StartIndex = startIndex;
+    command->NumQueries = numQueries;
+    command->Dst = dstBuffer;
+    command->DstOffset = dstOffset;
+}
+
+bool NullRHICommandList::IsClosed() const {
+    return m_Closed;
+}
+
+uint32_t NullRHICommandList::GetCommandCount() const {
+    return m_CommandCount;
+}
+
+const std::vector<uint8_t>& NullRHICommandList::GetCommandData() const {
+    return m_CommandData;
+}
+
+//
+// NullRHICommandQueue
+//
+NullRHICommandQueue::NullRHICommandQueue(RHIQueueType type)
+    : m_Type(type)
+    , m_ExecutedCommandCount(0)
+    , m_GPUTimestamp(0) {
+}
+
+RHIQueueType NullRHICommandQueue::GetType() const {
+    return m_Type;
+}
+
+void NullRHICommandQueue::ExecuteCommandLists(uint32_t numCommandLists, RHICommandList* const* ppCommandLists) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // The GPU idles until work is submitted.
+    m_GPUTimestamp = std::max(m_GPUTimestamp, GetCPUTimestamp());
+
+    for (uint32_t i = 0; i < numCommandLists; ++i) {
+        const NullRHICommandList* commandList = static_cast<const NullRHICommandList*>(ppCommandLists[i]);
+        assert(commandList->IsClosed() && "Command lists must be closed before they are executed.");
+
+        Replay(*commandList);
+    }
+}
+
+void NullRHICommandQueue::Signal(RHIFence* fence, uint64_t value) {
+    // All work submitted before the signal has already been replayed.
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    fence->Signal(value);
+}
+
+void NullRHICommandQueue::Wait(RHIFence* fence, uint64_t value) {
+    // Work is replayed at submission so the queue has to stall right away. Like on a
+    // real GPU this deadlocks if the value is never signaled by another queue or thread.
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    fence->WaitForValue(value);
+}
+
+uint64_t NullRHICommandQueue::GetTimestampFrequency() const {
+    return 1000 * 1000 * 1000;
+}
+
+void NullRHICommandQueue::GetClockCalibration(uint64_t* gpuTimestamp, uint64_t* cpuTimestamp) const {
+    // The virtual GPU clock runs on the CPU clock.
+    *cpuTimestamp = GetCPUTimestamp();
+    *gpuTimestamp = *cpuTimestamp;
+}
+
+uint64_t NullRHICommandQueue::GetExecutedCommandCount() const {
+    return m_ExecutedCommandCount.load(std::memory_order_relaxed);
+}
+
+void NullRHICommandQueue::Replay(const NullRHICommandList& commandList) {
+    const std::vector<uint8_t>& commandData = commandList.GetCommandData();
+
+    size_t offset = 0;
+    while (offset < commandData.size()) {
+        const NullRHICommandHeader* header = reinterpret_cast<const NullRHICommandHeader*>(commandData.data() + offset);
+
+        // Copies and queries are the only commands with an observable result on the CPU.
+        switch (header->Type) {
+            case NullRHICommandType::ResourceBarrier: {
+                const ResourceBarrierCommand* command = reinterpret_cast<const ResourceBarrierCommand*>(header + 1);
+                const uint8_t* barrierData = reinterpret_cast<const uint8_t*>(command + 1);
+                for (uint32_t i = 0; i < command->NumBarriers; ++i) {
+                    // The barriers follow a 4 byte payload, copy them out to read them aligned.
+                    RHIResourceBarrier barrier;
+                    std::memcpy(&barrier, barrierData + i * sizeof(RHIResourceBarrier), sizeof(RHIResourceBarrier));
+                    if (barrier.Type != RHIResourceBarrierType::Transition) {
+                        continue;
+                    }
+
+                    // Buffers are implicitly promoted and decay, which is not modeled. Textures must match.
+                    NullRHIResource* resource = static_cast<NullRHIResource*>(barrier.Resource);
+                    assert((resource->GetDesc().Dimension == RHIResourceDimension::Buffer ||
+                        resource->GetState() == barrier.StateBefore) && "The before state of a transition does not match the texture.");
+                    // A split transition completes with its end.
+                    if (!(barrier.Flags & RHIResourceBarrierFlag_BeginOnly)) {
+                        resource->SetState(barrier.StateAfter);
+                    }
+                }
+                m_GPUTimestamp += NullBarrierBatchCost + NullCommandCost * command->NumBarriers;
+                break;
+            }
+            case NullRHICommandType::CopyBufferRegion: {
+                const CopyBufferRegionCommand* command = reinterpret_cast<const CopyBufferRegionCommand*>(header + 1);
+                NullRHIResource* dst = static_cast<NullRHIResource*>(command->Dst);
+                NullRHIResource* src = static_cast<NullRHIResource*>(command->Src);
+                std::memcpy(dst->GetData() + command->DstOffset, src->GetData() + command->SrcOffset,
+                    static_cast<size_t>(command->NumBytes));
+                m_GPUTimestamp += NullCommandCost + command->NumBytes / NullCopyBytesPerNanosecond;
+                break;
+            }
+            case NullRHICommandType::EndQuery: {
+                const EndQueryCommand* command = reinterpret_cast<const EndQueryCommand*>(header + 1);
+                static_cast<NullRHIQueryHeap*>(command->QueryHeap)->GetData()[command->Index] = m_GPUTimestamp;
+                break;
+            }
+            case NullRHICommandType::ResolveQueryData: {
+                const ResolveQueryDataCommand* command = reinterpret_cast<const ResolveQueryDataCommand*>(header + 1);
+                NullRHIQueryHeap* queryHeap = static_cast<NullRHIQueryHeap*>(command->QueryHeap);
+                NullRHIResource* dst = static_cast<NullRHIResource*>(command->Dst);
+                std::memcpy(dst->GetData() + command->DstOffset, queryHeap->GetData() + command->StartIndex,
+                    command->NumQueries * sizeof(uint64_t));
+                m_GPUTimestamp += NullCommandCost;
+                break;
+            }
+            case NullRHICommandType::ClearRenderTargetView:
+            case NullRHICommandType::ClearDepthStencilView:
+                m_GPUTimestamp += NullClearCost;
+                break;
+            case NullRHICommandType::DrawIndexedInstanced: {
+                const DrawIndexedInstancedCommand* command = reinterpret_cast<const DrawIndexedInstancedCommand*>(header + 1);
+                m_GPUTimestamp += NullDrawCost + static_cast<uint64_t>(command->IndexCountPerInstance) * command->InstanceCount;
+                break;
+            }
+            case NullRHICommandType::Dispatch: {
+                const DispatchCommand* command = reinterpret_cast<const DispatchCommand*>(header + 1);
+                m_GPUTimestamp += NullCommandCost + NullDispatchCostPerGroup *
+                    command->ThreadGroupCountX * command->ThreadGroupCountY * command->ThreadGroupCountZ;
+                break;
+            }
+            default:
+                m_GPUTimestamp += NullCommandCost;
+                break;
+        }
+
+        offset += header->Size;
+    }
+
+    m_ExecutedCommandCount.fetch_add(commandList.GetCommandCount(), std::memory_order_relaxed);
+}
+
+//
+// NullRHIDevice
+//
+NullRHIDevice::NullRHIDevice()
+    : m_NextGPUVirtualAddress(NullResourceAlignment) {
+}
+
+RHIBackend NullRHIDevice::GetBackend() const {
+    return RHIBackend::Null;
+}
+
+std::shared_ptr<RHICommandQueue> NullRHIDevice::CreateCommandQueue(RHIQueueType type) {
+    return std::make_shared<NullRHICommandQueue>(type);
+}
+
+std::shared_ptr<RHICommandAllocator> NullRHIDevice::CreateCommandAllocator(RHIQueueType) {
+    return std::make_shared<NullRHICommandAllocator>();
+}
+
+std::shared_ptr<RHICommandList> NullRHIDevice::CreateCommandList(RHIQueueType type,
+    std::shared_ptr<RHICommandAllocator> allocator) {
+    return std::make_shared<NullRHICommandList>(type, allocator);
+}
+
+std::shared_ptr<RHIFence> NullRHIDevice::CreateFence(uint64_t initialValue) {
+    return std::make_shared<NullRHIFence>(initialValue);
+}
+
+std::shared_ptr<RHIResource> NullRHIDevice::CreateCommittedResource(RHIHeapType heapType,
+    const RHIResourceDesc& desc, RHIResourceState initialState) {
+    uint64_t size = desc.Dimension == RHIResourceDimension::Buffer ? desc.Width : desc.Width * desc.Height * 4;
+    return std::make_shared<NullRHIResource>(heapType, desc, initialState, AllocateGPUVirtualAddress(size));
+}
+
+std::shared_ptr<RHIHeap> NullRHIDevice::CreateHeap(const RHIHeapDesc& desc) {
+    assert(desc.Size > 0 && desc.Size % NullResourceAlignment == 0 && "Heap sizes must be a multiple of 64KB.");
+    return std::make_shared<NullRHIHeap>(desc, AllocateGPUVirtualAddress(desc.Size));
+}
+
+std::shared_ptr<RHIResource> NullRHIDevice::CreatePlacedResource(RHIHeap* heap, uint64_t heapOffset,
+    const RHIResourceDesc& desc, RHIResourceState initialState) {
+    NullRHIHeap* nullHeap = static_cast<NullRHIHeap*>(heap);
+    const RHIHeapDesc& heapDesc = nullHeap->GetDesc();
+
+    RHIResourceAllocationInfo allocationInfo = GetResourceAllocationInfo(desc);
+    assert(heapOffset % allocationInfo.Alignment == 0 && "Misaligned placed resource.");
+    assert(heapOffset + allocationInfo.Size <= heapDesc.Size && "The placed resource does not fit in the heap.");
+    assert((desc.Dimension == RHIResourceDimension::Buffer) == (heapDesc.ResourceType == RHIHeapResourceType::Buffers) &&
+        "The heap cannot hold the resource.");
+
+    uint8_t* placedData = nullHeap->GetData() ? nullHeap->GetData() + heapOffset : nullptr;
+    return std::make_shared<NullRHIResource>(heapDesc.Type, desc, initialState, nullHeap->GetGPUBaseAddress() + heapOffset,
+        placedData);
+}
+
+RHIResourceAllocationInfo NullRHIDevice::GetResourceAllocationInfo(const RHIResourceDesc& desc) const {
+    uint64_t size = desc.Dimension == RHIResourceDimension::Buffer ? desc.Width : desc.Width * desc.Height * 4;
+    return RHIResourceAllocationInfo{ AlignUp(std::max<uint64_t>(size, 1), NullResourceAlignment), NullResourceAlignment };
+}
+
+std::shared_ptr<RHIDescriptorHeap> NullRHIDevice::CreateDescriptorHeap(const RHIDescriptorHeapDesc& desc) {
+    uint64_t gpuBaseAddress = desc.ShaderVisible ?
+        AllocateGPUVirtualAddress(static_cast<uint64_t>(desc.NumDescriptors) * NullDescriptorSize) : 0;
+    return std::make_shared<NullRHIDescriptorHeap>(desc, NullDescriptorSize, gpuBaseAddress);
+}
+
+uint32_t NullRHIDevice::GetDescriptorHandleIncrementSize(RHIDescriptorHeapType) const {
+    return NullDescriptorSize;
+}
+
+void NullRHIDevice::CopyDescriptors(uint32_t numDestRanges, const RHICPUDescriptorHandle* destRangeStarts,
+    const uint32_t* destRangeSizes, uint32_t numSrcRanges, const RHICPUDescriptorHandle* srcRangeStarts,
+    const uint32_t* srcRangeSizes, RHIDescriptorHeapType) {
+    // Walk both range lists in lock step, one descriptor at a time.
+    uint32_t destRange = 0;
+    uint32_t destIndex = 0;
+    uint32_t srcRange = 0;
+    uint32_t srcIndex = 0;
+    while (destRange < numDestRanges && srcRange < numSrcRanges) {
+        if (destIndex == destRangeSizes[destRange]) {
+            ++destRange;
+            destIndex = 0;
+            continue;
+        }
+        if (srcIndex == srcRangeSizes[srcRange]) {
+            ++srcRange;
+            srcIndex = 0;
+            continue;
+        }
+
+        std::memcpy(reinterpret_cast<void*>(destRangeStarts[destRange].ptr + destIndex * NullDescriptorSize),
+            reinterpret_cast<const void*>(srcRangeStarts[srcRange].ptr + srcIndex * NullDescriptorSize),
+            NullDescriptorSize);
+        ++destIndex;
+        ++srcIndex;
+    }
+
+    // Skip empty trailing ranges before checking that both sides were used up.
+    while (destRange < numDestRanges && destIndex == destRangeSizes[destRange]) {
+        ++destRange;
+        destIndex = 0;
+    }
+    while (srcRange < numSrcRanges && srcIndex == srcRangeSizes[srcRange]) {
+        ++srcRange;
+        srcIndex = 0;
+    }
+    assert(destRange == numDestRanges && srcRange == numSrcRanges &&
+        "The number of source and destination descriptors must match.");
+}
+
+std::shared_ptr<RHIQueryHeap> NullRHIDevice::CreateQueryHeap(RHIQueryHeapType type, uint32_t count) {
+    return std::make_shared<NullRHIQueryHeap>(type, count);
+}
+
+bool NullRHIDevice::IsTimestampQuerySupported(RHIQueueType) const {
+    return true;
+}
+
+uint64_t NullRHIDevice::AllocateGPUVirtualAddress(uint64_t size) {
+    uint64_t alignedSize = AlignUp(std::max<uint64_t>(size, 1), NullResourceAlignment);
+    return m_NextGPUVirtualAddress.fetch_add(alignedSize, std::memory_order_relaxed);
+}
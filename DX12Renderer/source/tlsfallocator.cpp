@@ -0,0 +1,293 @@
+#include "tlsfallocator.h"
+
+#include <cassert>
+
+// Index of the most significant set bit, value must not be zero.
+static uint32_t FindLastSet(uint64_t value) {
+    uint32_t index = 0;
+    if (value >> 32) { value >>= 32; index += 32; }
+    if (value >> 16) { value >>= 16; index += 16; }
+    if (value >> 8) { value >>= 8; index += 8; }
+    if (value >> 4) { value >>= 4; index += 4; }
+    if (value >> 2) { value >>= 2; index += 2; }
+    if (value >> 1) { index += 1; }
+    return index;
+}
+
+// Index of the least significant set bit, value must not be zero.
+static uint32_t FindFirstSet(uint64_t value) {
+    return FindLastSet(value & (~value + 1));
+}
+
+const uint64_t TlsfAllocator::InvalidOffset;
+
+TlsfAllocator::TlsfAllocator(uint64_t size, uint64_t granularity)
+    : m_Granularity(granularity)
+    , m_GranularityShift(FindLastSet(granularity))
+    , m_FirstLevelBitmap(0)
+    , m_UsedSize(0) {
+    assert(granularity > 0 && (granularity & (granularity - 1)) == 0 && "The granularity must be a power of two.");
+
+    for (uint32_t firstLevel = 0; firstLevel < NumFirstLevels; ++firstLevel) {
+        for (uint32_t secondLevel = 0; secondLevel < NumSecondLevels; ++secondLevel) {
+            m_FreeLists[firstLevel][secondLevel] = NullBlock;
+        }
+        m_SecondLevelBitmaps[firstLevel] = 0;
+    }
+
+    m_Size = size >> m_GranularityShift;
+    if (m_Size > 0) {
+        InsertFreeBlock(CreateBlock(0, m_Size));
+    }
+}
+
+uint64_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+    uint64_t numUnits = size > 0 ? ((size - 1) >> m_GranularityShift) + 1 : 1;
+    uint64_t alignmentUnits = alignment > m_Granularity ? alignment >> m_GranularityShift : 1;
+
+    // Any block this large fits the allocation at an aligned offset.
+    uint64_t searchSize = numUnits + alignmentUnits - 1;
+    if (searchSize > m_Size) {
+        return InvalidOffset;
+    }
+
+    uint32_t block = FindFreeBlock(searchSize);
+    if (block == NullBlock) {
+        return InvalidOffset;
+    }
+    RemoveFreeBlock(block);
+
+    // Leading padding becomes a free block of its own. The physical neighbours of
+    // a free block are never free, there is nothing to merge it with.
+    uint64_t alignedOffset = (m_Blocks[block].offset + alignmentUnits - 1) & ~(alignmentUnits - 1);
+    uint64_t padding = alignedOffset - m_Blocks[block].offset;
+    if (padding > 0) {
+        uint32_t paddingBlock = CreateBlock(m_Blocks[block].offset, padding);
+        uint32_t prevPhysical = m_Blocks[block].prevPhysical;
+        m_Blocks[paddingBlock].prevPhysical = prevPhysical;
+        m_Blocks[paddingBlock].nextPhysical = block;
+        if (prevPhysical != NullBlock) {
+            m_Blocks[prevPhysical].nextPhysical = paddingBlock;
+        }
+        m_Blocks[block].prevPhysical = paddingBlock;
+        m_Blocks[block].offset = alignedOffset;
+        m_Blocks[block].size -= padding;
+        InsertFreeBlock(paddingBlock);
+    }
+
+    if (m_Blocks[block].size > numUnits) {
+        SplitTail(block, numUnits);
+    }
+
+    m_Blocks[block].free = false;
+    m_AllocatedBlocks[alignedOffset] = block;
+    m_UsedSize += numUnits;
+
+    return alignedOffset << m_GranularityShift;
+}
+
+void TlsfAllocator::Free(uint64_t offset) {
+    auto iter = m_AllocatedBlocks.find(offset >> m_GranularityShift);
+    assert(iter != m_AllocatedBlocks.end() && "The offset was not allocated.");
+    if (iter == m_AllocatedBlocks.end()) {
+        return;
+    }
+
+    uint32_t block = iter->second;
+    m_AllocatedBlocks.erase(iter);
+    m_UsedSize -= m_Blocks[block].size;
+    m_Blocks[block].free = true;
+
+    uint32_t nextPhysical = m_Blocks[block].nextPhysical;
+    if (nextPhysical != NullBlock && m_Blocks[nextPhysical].free) {
+        RemoveFreeBlock(nextPhysical);
+        MergeWithNext(block);
+    }
+
+    uint32_t prevPhysical = m_Blocks[block].prevPhysical;
+    if (prevPhysical != NullBlock && m_Blocks[prevPhysical].free) {
+        RemoveFreeBlock(prevPhysical);
+        MergeWithNext(prevPhysical);
+        block = prevPhysical;
+    }
+
+    InsertFreeBlock(block);
+
+    if (m_AllocatedBlocks.empty() && m_Blocks.size() > MaxRetainedBlocks) {
+        Trim();
+    }
+}
+
+uint64_t TlsfAllocator::GetSize() const {
+    return m_Size << m_GranularityShift;
+}
+
+uint64_t TlsfAllocator::GetGranularity() const {
+    return m_Granularity;
+}
+
+bool TlsfAllocator::IsEmpty() const {
+    return m_AllocatedBlocks.empty();
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const {
+    Stats stats = {};
+    stats.size = m_Size << m_GranularityShift;
+    stats.usedBytes = m_UsedSize << m_GranularityShift;
+    stats.freeBytes = stats.size - stats.usedBytes;
+    stats.numAllocations = static_cast<uint32_t>(m_AllocatedBlocks.size());
+    stats.numFreeBlocks = static_cast<uint32_t>(m_Blocks.size() - m_UnusedBlocks.size() - m_AllocatedBlocks.size());
+
+    if (m_FirstLevelBitmap != 0) {
+        uint32_t firstLevel = FindLastSet(m_FirstLevelBitmap);
+        uint32_t secondLevel = FindLastSet(m_SecondLevelBitmaps[firstLevel]);
+
+        uint64_t largestFreeBlock = 0;
+        for (uint32_t block = m_FreeLists[firstLevel][secondLevel]; block != NullBlock; block = m_Blocks[block].nextFree) {
+            if (m_Blocks[block].size > largestFreeBlock) {
+                largestFreeBlock = m_Blocks[block].size;
+            }
+        }
+        stats.largestFreeBlock = largestFreeBlock << m_GranularityShift;
+    }
+
+    return stats;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t* firstLevel, uint32_t* secondLevel) {
+    if (size < NumSecondLevels) {
+        // Small sizes get a list per size.
+        *firstLevel = 0;
+        *secondLevel = static_cast<uint32_t>(size);
+    } else {
+        uint32_t msb = FindLastSet(size);
+        *firstLevel = msb - SecondLevelBits + 1;
+        *secondLevel = static_cast<uint32_t>(size >> (msb - SecondLevelBits)) - NumSecondLevels;
+    }
+}
+
+uint32_t TlsfAllocator::CreateBlock(uint64_t offset, uint64_t size) {
+    Block newBlock = { offset, size, NullBlock, NullBlock, NullBlock, NullBlock, true };
+
+    if (!m_UnusedBlocks.empty()) {
+        uint32_t block = m_UnusedBlocks.back();
+        m_UnusedBlocks.pop_back();
+        m_Blocks[block] = newBlock;
+        return block;
+    }
+
+    m_Blocks.push_back(newBlock);
+    return static_cast<uint32_t>(m_Blocks.size() - 1);
+}
+
+void TlsfAllocator::DestroyBlock(uint32_t block) {
+    m_UnusedBlocks.push_back(block);
+}
+
+void TlsfAllocator::InsertFreeBlock(uint32_t block) {
+    uint32_t firstLevel, secondLevel;
+    Mapping(m_Blocks[block].size, &firstLevel, &secondLevel);
+
+    uint32_t head = m_FreeLists[firstLevel][secondLevel];
+    m_Blocks[block].prevFree = NullBlock;
+    m_Blocks[block].nextFree = head;
+    if (head != NullBlock) {
+        m_Blocks[head].prevFree = block;
+    }
+    m_FreeLists[firstLevel][secondLevel] = block;
+
+    m_FirstLevelBitmap |= 1ull << firstLevel;
+    m_SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::RemoveFreeBlock(uint32_t block) {
+    uint32_t prevFree = m_Blocks[block].prevFree;
+    uint32_t nextFree = m_Blocks[block].nextFree;
+    if (nextFree != NullBlock) {
+        m_Blocks[nextFree].prevFree = prevFree;
+    }
+    if (prevFree != NullBlock) {
+        m_Blocks[prevFree].nextFree = nextFree;
+        return;
+    }
+
+    // The block was the head of its list.
+    uint32_t firstLevel, secondLevel;
+    Mapping(m_Blocks[block].size, &firstLevel, &secondLevel);
+    m_FreeLists[firstLevel][secondLevel] = nextFree;
+    if (nextFree == NullBlock) {
+        m_SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (m_SecondLevelBitmaps[firstLevel] == 0) {
+            m_FirstLevelBitmap &= ~(1ull << firstLevel);
+        }
+    }
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const {
+    // Round up to the next list so every block in the list found is large enough.
+    if (size >= NumSecondLevels) {
+        size += (1ull << (FindLastSet(size) - SecondLevelBits)) - 1;
+    }
+
+    uint32_t firstLevel, secondLevel;
+    Mapping(size, &firstLevel, &secondLevel);
+    if (firstLevel >= NumFirstLevels) {
+        return NullBlock;
+    }
+
+    // A list of the same first level with larger blocks, or else the smallest larger first level.
+    uint32_t secondLevelMap = m_SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+        uint64_t firstLevelMap = firstLevel + 1 < NumFirstLevels ? m_FirstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0) {
+            return NullBlock;
+        }
+        firstLevel = FindFirstSet(firstLevelMap);
+        secondLevelMap = m_SecondLevelBitmaps[firstLevel];
+    }
+
+    return m_FreeLists[firstLevel][FindFirstSet(secondLevelMap)];
+}
+
+void TlsfAllocator::SplitTail(uint32_t block, uint64_t size) {
+    uint32_t tail = CreateBlock(m_Blocks[block].offset + size, m_Blocks[block].size - size);
+    uint32_t nextPhysical = m_Blocks[block].nextPhysical;
+    m_Blocks[tail].prevPhysical = block;
+    m_Blocks[tail].nextPhysical = nextPhysical;
+    if (nextPhysical != NullBlock) {
+        m_Blocks[nextPhysical].prevPhysical = tail;
+    }
+    m_Blocks[block].nextPhysical = tail;
+    m_Blocks[block].size = size;
+
+    InsertFreeBlock(tail);
+}
+
+void TlsfAllocator::Trim() {
+    // Without allocations all free blocks have been merged into one.
+    assert(m_Blocks.size() - m_UnusedBlocks.size() == 1 && "An empty range must be a single free block.");
+
+    uint32_t firstLevel = FindLastSet(m_FirstLevelBitmap);
+    RemoveFreeBlock(m_FreeLists[firstLevel][FindLastSet(m_SecondLevelBitmaps[firstLevel])]);
+
+    std::vector<Block>().swap(m_Blocks);
+    std::vector<uint32_t>().swap(m_UnusedBlocks);
+    std::unordered_map<uint64_t, uint32_t>().swap(m_AllocatedBlocks);
+
+    InsertFreeBlock(CreateBlock(0, m_Size));
+}
+
+void TlsfAllocator::MergeWithNext(uint32_t block) {
+    uint32_t next = m_Blocks[block].nextPhysical;
+    assert(next != NullBlock && m_Blocks[next].free && "Only free neighbours can be merged.");
+
+    m_Blocks[block].size += m_Blocks[next].size;
+    m_Blocks[block].nextPhysical = m_Blocks[next].nextPhysical;
+    if (m_Blocks[next].nextPhysical != NullBlock) {
+        m_Blocks[m_Blocks[next].nextPhysical].prevPhysical = block;
+    }
+
+    DestroyBlock(next);
+}
@@ -0,0 +1,163 @@
+#include "uploadbuffer.h"
+
+#include <cassert>
+
+static size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+UploadBuffer::UploadBuffer(std::shared_ptr<RHIDevice> device, size_t pageSize)
+    : m_Device(device)
+    , m_PageSize(pageSize)
+    , m_FirstGeneration(0)
+    , m_NumPages(0) {
+    m_Generations.push_back(Generation{ 0, {} });
+}
+
+UploadBuffer::~UploadBuffer() {
+}
+
+size_t UploadBuffer::GetPageSize() const {
+    return m_PageSize;
+}
+
+size_t UploadBuffer::GetNumPages() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_NumPages;
+}
+
+UploadBuffer::Allocation UploadBuffer::Allocate(size_t sizeInBytes, size_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (sizeInBytes > m_PageSize) {
+        // Too large for a shared page, give it a page of its own.
+        PagePtr page = CreatePage(AlignUp(sizeInBytes, alignment), true);
+        Allocation allocation = page->Allocate(sizeInBytes, alignment);
+        RetirePage(page);
+        return allocation;
+    }
+
+    if (!m_CurrentPage || !m_CurrentPage->HasSpace(sizeInBytes, alignment)) {
+        if (m_CurrentPage) {
+            RetirePage(m_CurrentPage);
+        }
+        m_CurrentPage = RequestPage();
+    }
+
+    return m_CurrentPage->Allocate(sizeInBytes, alignment);
+}
+
+uint64_t UploadBuffer::OpenCommandList() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ++m_Generations.back().numOpenCommandLists;
+    return m_FirstGeneration + m_Generations.size() - 1;
+}
+
+void UploadBuffer::CloseCommandList(uint64_t generation, uint64_t fenceValue) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    assert(generation >= m_FirstGeneration && generation - m_FirstGeneration < m_Generations.size()
+        && "Command list was not opened on this upload buffer.");
+
+    Generation& commandListGeneration = m_Generations[static_cast<size_t>(generation - m_FirstGeneration)];
+    assert(commandListGeneration.numOpenCommandLists > 0 && "Command list was closed twice.");
+    --commandListGeneration.numOpenCommandLists;
+
+    // Pages of a generation are done once all command lists up to that generation have been
+    // executed. Closing happens in fence order so fenceValue covers all of them.
+    // The current generation is never retired, its pages are still being filled.
+    while (m_Generations.size() > 1 && m_Generations.front().numOpenCommandLists == 0) {
+        for (auto& page : m_Generations.front().fullPages) {
+            m_RetiredPages.push(RetiredPage{ fenceValue, page });
+        }
+        m_Generations.pop_front();
+        ++m_FirstGeneration;
+    }
+}
+
+void UploadBuffer::RetirePage(PagePtr page) {
+    m_Generations.back().fullPages.push_back(page);
+
+    // Command lists opened from now on can't reference the page.
+    m_Generations.push_back(Generation{ 0, {} });
+}
+
+void UploadBuffer::ReleaseCompleted(uint64_t completedFenceValue) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    while (!m_RetiredPages.empty() && m_RetiredPages.front().fenceValue <= completedFenceValue) {
+        PagePtr page = m_RetiredPages.front().page;
+        m_RetiredPages.pop();
+
+        if (page->m_Dedicated) {
+            --m_NumPages;
+        } else {
+            page->Reset();
+            m_AvailablePages.push_back(page);
+        }
+    }
+}
+
+UploadBuffer::PagePtr UploadBuffer::RequestPage() {
+    PagePtr page;
+
+    if (!m_AvailablePages.empty()) {
+        page = m_AvailablePages.front();
+        m_AvailablePages.pop_front();
+    } else {
+        page = CreatePage(m_PageSize, false);
+    }
+
+    return page;
+}
+
+UploadBuffer::PagePtr UploadBuffer::CreatePage(size_t sizeInBytes, bool dedicated) {
+    auto resource = m_Device->CreateCommittedResource(RHIHeapType::Upload,
+        RHIResourceDesc::Buffer(sizeInBytes), RHIResourceState_GenericRead);
+
+    ++m_NumPages;
+
+    return std::make_shared<Page>(resource, sizeInBytes, dedicated);
+}
+
+UploadBuffer::Page::Page(std::shared_ptr<RHIResource> resource, size_t sizeInBytes, bool dedicated)
+    : m_Resource(resource)
+    , m_PageSize(sizeInBytes)
+    , m_Offset(0)
+    , m_Dedicated(dedicated) {
+    // Upload heap resources stay mapped for their whole lifetime.
+    m_CPUBase = static_cast<uint8_t*>(m_Resource->Map());
+    m_GPUBase = m_Resource->GetGPUVirtualAddress();
+}
+
+UploadBuffer::Page::~Page() {
+    m_Resource->Unmap();
+}
+
+bool UploadBuffer::Page::HasSpace(size_t sizeInBytes, size_t alignment) const {
+    size_t alignedOffset = AlignUp(m_Offset, alignment);
+
+    return alignedOffset + sizeInBytes <= m_PageSize;
+}
+
+UploadBuffer::Allocation UploadBuffer::Page::Allocate(size_t sizeInBytes, size_t alignment) {
+    assert(HasSpace(sizeInBytes, alignment) && "Not enough space in the upload page.");
+
+    size_t alignedOffset = AlignUp(m_Offset, alignment);
+    m_Offset = alignedOffset + sizeInBytes;
+
+    Allocation allocation;
+    allocation.CPU = m_CPUBase + alignedOffset;
+    allocation.GPU = m_GPUBase + alignedOffset;
+    allocation.Resource = m_Resource.get();
+    allocation.Offset = alignedOffset;
+
+    return allocation;
+}
+
+void UploadBuffer::Page::Reset() {
+    m_Offset = 0;
+}
@@ -0,0 +1,239 @@
+#include "vertexquantization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+static float Clamp(float value, float min, float max) {
+    return std::min(std::max(value, min), max);
+}
+
+static uint16_t QuantizeUNorm16(float value) {
+    return static_cast<uint16_t>(Clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static uint8_t QuantizeUNorm8(float value) {
+    return static_cast<uint8_t>(Clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static int16_t QuantizeSNorm16(float value) {
+    return static_cast<int16_t>(std::lround(Clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Same as D3D, -32768 decodes to -1 as well.
+static float DequantizeSNorm16(int16_t value) {
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+template<typename T>
+static void Store(uint8_t* destination, const T* values, size_t count) {
+    std::memcpy(destination, values, count * sizeof(T));
+}
+
+template<typename T>
+static void Load(const uint8_t* source, T* values, size_t count) {
+    std::memcpy(values, source, count * sizeof(T));
+}
+
+uint32_t GetMeshSemanticNumComponents(MeshSemantic semantic) {
+    return semantic == MeshSemantic::TexCoord ? 2 : 3;
+}
+
+uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t absBits = bits & 0x7FFFFFFF;
+
+    if (absBits >= 0x7F800000) {
+        // Infinity stays infinity, NaNs stay quiet NaNs.
+        return static_cast<uint16_t>(sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0));
+    }
+    if (absBits >= 0x477FF000) {
+        // 65520 and above round to infinity.
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t halfway;
+    if (absBits < 0x38800000) {
+        // Below the smallest normal half, the result is a multiple of 2^-24.
+        const uint32_t exponent = absBits >> 23;
+        if (exponent < 102) {
+            return static_cast<uint16_t>(sign);
+        }
+        const uint32_t mantissa = (absBits & 0x7FFFFF) | 0x800000;
+        const uint32_t shift = 126 - exponent;
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        // Rebias the exponent from 127 to 15 and drop 13 bits of the mantissa.
+        half = (absBits - 0x38000000) >> 13;
+        remainder = absBits & 0x1FFF;
+        halfway = 0x1000;
+    }
+
+    // Round to nearest even, a carry into the exponent is the correct result.
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1F;
+    const uint32_t mantissa = value & 0x3FF;
+
+    if (exponent == 0) {
+        const float result = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -result : result;
+    }
+
+    uint32_t bits;
+    if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+void EncodeOctahedral(const float* normal, float* encoded) {
+    const float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    if (length == 0.0f) {
+        encoded[0] = 0.0f;
+        encoded[1] = 0.0f;
+        return;
+    }
+
+    float x = normal[0] / length;
+    float y = normal[1] / length;
+    if (normal[2] < 0.0f) {
+        // Fold the lower half of the octahedron over the diagonals.
+        const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = x;
+    encoded[1] = y;
+}
+
+void DecodeOctahedral(const float* encoded, float* normal) {
+    float x = encoded[0];
+    float y = encoded[1];
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+
+    const float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    const float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+void EncodeAttribute(MeshSemantic semantic, MeshAttributeFormat format, const float* value, const MeshFileBounds& bounds,
+    uint8_t* destination) {
+    assert(IsMeshAttributeFormatSupported(semantic, format) && "The format is not supported for the semantic.");
+
+    switch (format) {
+        case MeshAttributeFormat::R32G32B32_Float:
+            Store(destination, value, 3);
+            break;
+        case MeshAttributeFormat::R32G32_Float:
+            Store(destination, value, 2);
+            break;
+        case MeshAttributeFormat::R16G16B16A16_UNorm: {
+            uint16_t packed[4] = {};
+            for (int i = 0; i < 3; ++i) {
+                const float extent = bounds.Max[i] - bounds.Min[i];
+                packed[i] = QuantizeUNorm16(extent > 0.0f ? (value[i] - bounds.Min[i]) / extent : 0.0f);
+            }
+            Store(destination, packed, 4);
+            break;
+        }
+        case MeshAttributeFormat::R16G16_SNorm: {
+            float octahedral[2];
+            EncodeOctahedral(value, octahedral);
+            const int16_t packed[2] = { QuantizeSNorm16(octahedral[0]), QuantizeSNorm16(octahedral[1]) };
+            Store(destination, packed, 2);
+            break;
+        }
+        case MeshAttributeFormat::R8G8B8A8_UNorm: {
+            const uint8_t packed[4] = { QuantizeUNorm8(value[0]), QuantizeUNorm8(value[1]), QuantizeUNorm8(value[2]), 255 };
+            Store(destination, packed, 4);
+            break;
+        }
+        case MeshAttributeFormat::R16G16_Float: {
+            const uint16_t packed[2] = { FloatToHalf(value[0]), FloatToHalf(value[1]) };
+            Store(destination, packed, 2);
+            break;
+        }
+    }
+}
+
+void DecodeAttribute(MeshSemantic semantic, MeshAttributeFormat format, const uint8_t* source, const MeshFileBounds& bounds,
+    float* value) {
+    assert(IsMeshAttributeFormatSupported(semantic, format) && "The format is not supported for the semantic.");
+
+    switch (format) {
+        case MeshAttributeFormat::R32G32B32_Float:
+            Load(source, value, 3);
+            break;
+        case MeshAttributeFormat::R32G32_Float:
+            Load(source, value, 2);
+            break;
+        case MeshAttributeFormat::R16G16B16A16_UNorm: {
+            uint16_t packed[4];
+            Load(source, packed, 4);
+            for (int i = 0; i < 3; ++i) {
+                value[i] = bounds.Min[i] + packed[i] / 65535.0f * (bounds.Max[i] - bounds.Min[i]);
+            }
+            break;
+        }
+        case MeshAttributeFormat::R16G16_SNorm: {
+            int16_t packed[2];
+            Load(source, packed, 2);
+            const float octahedral[2] = { DequantizeSNorm16(packed[0]), DequantizeSNorm16(packed[1]) };
+            DecodeOctahedral(octahedral, value);
+            break;
+        }
+        case MeshAttributeFormat::R8G8B8A8_UNorm: {
+            uint8_t packed[4];
+            Load(source, packed, 4);
+            for (int i = 0; i < 3; ++i) {
+                value[i] = packed[i] / 255.0f;
+            }
+            break;
+        }
+        case MeshAttributeFormat::R16G16_Float: {
+            uint16_t packed[2];
+            Load(source, packed, 2);
+            value[0] = HalfToFloat(packed[0]);
+            value[1] = HalfToFloat(packed[1]);
+            break;
+        }
+    }
+}
+
+void GetPositionDequantization(MeshAttributeFormat format, const MeshFileBounds& bounds, float* scale, float* offset) {
+    for (int i = 0; i < 3; ++i) {
+        if (format == MeshAttributeFormat::R16G16B16A16_UNorm) {
+            scale[i] = bounds.Max[i] - bounds.Min[i];
+            offset[i] = bounds.Min[i];
+        } else {
+            scale[i] = 1.0f;
+            offset[i] = 0.0f;
+        }
+    }
+}
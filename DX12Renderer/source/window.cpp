@@ -1,8 +1,15 @@
 #include "application.h"
+#include "assetloader.h"
 #include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "gpumemoryallocator.h"
+#include "gpuprofiler.h"
 #include "window.h"
 #include "game.h"
 #include "helpers.h"
+#include "profiler.h"
+#include "resourcestatetracker.h"
+#include "rhid3d12.h"
 
 #include <cassert>
 #include <cmath>
@@ -13,21 +20,25 @@
 template<class T>
 using ComPtr = Microsoft::WRL::ComPtr<T>;
 
-Window::Window(HWND hWnd, const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync)
+Window::Window(HWND hWnd, const std::wstring& windowName, int clientWidth, int clientHeight, bool vSync, UINT framesInFlight)
     : m_hWnd(hWnd)
     , m_WindowName(windowName)
     , m_ClientWidth(clientWidth)
     , m_ClientHeight(clientHeight)
     , m_VSync(vSync)
     , m_Fullscreen(false)
-    , m_FrameCounter(0) {
+    , m_FrameCounter(0)
+    , m_FrameLatencyWaitableObject(nullptr)
+    , m_FramePacer(Application::Get().GetCommandQueue(), framesInFlight)
+    , m_LastFrameWaitSeconds(0.0) {
     Application& app = Application::Get();
 
+    m_BufferCount = m_FramePacer.GetNumFramesInFlight() + 1;
+
     m_IsTearingSupported = app.IsTearingSupported();
 
     m_dxgiSwapChain = CreateSwapChain();
-    m_d3d12RTVDescriptorHeap = app.CreateDescriptorHeap(BufferCount, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-    m_RTVDescriptorSize = app.GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    m_RTVDescriptors = app.AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, MaxBufferCount);
 
     UpdateRenderTargetViews();
 }
@@ -58,6 +69,9 @@ void Window::Hide() {
 }
 
 void Window::Destroy() {
+    // The game unloads the content the render thread uses.
+    m_FramePipeline.reset();
+
     if (auto pGame = m_pGame.lock()) {
         // Notify the registered game that the window is being destroyed.
         pGame->OnWindowDestroy();
@@ -66,6 +80,12 @@ void Window::Destroy() {
         DestroyWindow(m_hWnd);
         m_hWnd = nullptr;
     }
+    if (m_FrameLatencyWaitableObject) {
+        ::CloseHandle(m_FrameLatencyWaitableObject);
+        m_FrameLatencyWaitableObject = nullptr;
+    }
+
+    ReleaseBackBuffers();
 }
 
 int Window::GetClientWidth() const {
@@ -81,6 +101,8 @@ bool Window::IsVSync() const {
 }
 
 void Window::SetVSync(bool vSync) {
+    // Read by the present of the frame on the render thread.
+    WaitForRenderThread();
     m_VSync = vSync;
 }
 
@@ -153,25 +175,81 @@ void Window::RegisterCallbacks(std::shared_ptr<GameBase> pGame) {
 }
 
 void Window::OnUpdate(UpdateEventArgs&) {
+    PROFILE_FUNCTION();
+
+    auto pGame = m_pGame.lock();
+
+    // Wait before the update so the frame works with the latest input.
+    // Pipelined frames wait on the render thread, the update runs ahead of them.
+    if (pGame && !m_FramePipeline) {
+        BeginFrame();
+    }
+
     m_UpdateClock.Tick();
 
-    if (auto pGame = m_pGame.lock()) {
+    if (pGame) {
         m_FrameCounter++;
 
-        UpdateEventArgs updateEventArgs(m_UpdateClock.GetDeltaSeconds(), m_UpdateClock.GetTotalSeconds());
+        const uint32_t snapshotIndex = m_FramePipeline ? m_FramePipeline->GetWriteIndex() : 0;
+        UpdateEventArgs updateEventArgs(m_UpdateClock.GetDeltaSeconds(), m_UpdateClock.GetTotalSeconds(), snapshotIndex);
         pGame->OnUpdate(updateEventArgs);
+
+        if (m_FramePipeline) {
+            m_FramePipeline->Submit();
+        }
     }
 }
 
 void Window::OnRender(RenderEventArgs&) {
+    // Pipelined frames are rendered by the render thread once they are submitted.
+    if (!m_FramePipeline) {
+        RenderFrame(0);
+    }
+}
+
+void Window::RenderFrame(uint32_t snapshotIndex) {
+    PROFILE_FUNCTION();
+
     m_RenderClock.Tick();
 
     if (auto pGame = m_pGame.lock()) {
-        RenderEventArgs renderEventArgs(m_RenderClock.GetDeltaSeconds(), m_RenderClock.GetTotalSeconds());
+        RenderEventArgs renderEventArgs(m_RenderClock.GetDeltaSeconds(), m_RenderClock.GetTotalSeconds(), snapshotIndex);
         pGame->OnRender(renderEventArgs);
     }
 }
 
+bool Window::IsPipelined() const {
+    return m_FramePipeline != nullptr;
+}
+
+void Window::SetPipelined(bool pipelined) {
+    if (pipelined == IsPipelined()) {
+        return;
+    }
+
+    if (pipelined) {
+        m_FramePipeline = std::make_unique<FramePipeline>([this](uint32_t snapshotIndex) {
+            if (m_pGame.lock()) {
+                BeginFrame();
+            }
+            RenderFrame(snapshotIndex);
+        });
+    } else {
+        // Renders the submitted frame, the next one is rendered on the main thread.
+        m_FramePipeline.reset();
+    }
+}
+
+void Window::TogglePipelined() {
+    SetPipelined(!IsPipelined());
+}
+
+void Window::WaitForRenderThread() {
+    if (m_FramePipeline) {
+        m_FramePipeline->WaitForIdle();
+    }
+}
+
 void Window::OnKeyPressed(KeyEventArgs& e) {
     if (auto pGame = m_pGame.lock()) {
         pGame->OnKeyPressed(e);
@@ -213,25 +291,21 @@ void Window::OnMouseWheel(MouseWheelEventArgs& e) {
 }
 
 void Window::OnResize(ResizeEventArgs& e) {
+    PROFILE_FUNCTION();
+
+    // The render thread uses the back buffers and the size of the game.
+    WaitForRenderThread();
+
     // Update the client size.
     if (m_ClientWidth != e.Width || m_ClientHeight != e.Height) {
         m_ClientWidth = std::max(1, e.Width);
         m_ClientHeight = std::max(1, e.Height);
 
-        Application::Get().Flush();
+        // DXGI can only resize the back buffers once the GPU is done with them.
+        // They are only used by the frames of this window so there is no need to flush every queue.
+        m_FramePacer.WaitForIdle();
 
-        for (int i = 0; i < BufferCount; ++i) {
-            m_d3d12BackBuffers[i].Reset();
-        }
-
-        DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
-        ThrowIfFailed(m_dxgiSwapChain->GetDesc(&swapChainDesc));
-        ThrowIfFailed(m_dxgiSwapChain->ResizeBuffers(BufferCount, m_ClientWidth,
-            m_ClientHeight, swapChainDesc.BufferDesc.Format, swapChainDesc.Flags));
-
-        m_CurrentBackBufferIndex = m_dxgiSwapChain->GetCurrentBackBufferIndex();
-
-        UpdateRenderTargetViews();
+        ResizeSwapChain();
     }
 
     if (auto pGame = m_pGame.lock()) {
@@ -258,17 +332,19 @@ Microsoft::WRL::ComPtr<IDXGISwapChain4> Window::CreateSwapChain() {
     swapChainDesc.Stereo = FALSE;
     swapChainDesc.SampleDesc = { 1, 0 };
     swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.BufferCount = BufferCount;
+    swapChainDesc.BufferCount = m_BufferCount;
     swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
     swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
     swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
     // It is recommended to always allow tearing if tearing support is available.
     swapChainDesc.Flags = m_IsTearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
-    ID3D12CommandQueue* pCommandQueue = app.GetCommandQueue()->GetD3D12CommandQueue().Get();
+    // Let DXGI signal when the swapchain can accept another frame instead of blocking in Present.
+    swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    ComPtr<ID3D12CommandQueue> d3d12CommandQueue = GetD3D12CommandQueue(app.GetCommandQueue()->GetRHICommandQueue());
 
     ComPtr<IDXGISwapChain1> swapChain1;
     ThrowIfFailed(dxgiFactory4->CreateSwapChainForHwnd(
-        pCommandQueue,
+        d3d12CommandQueue.Get(),
         m_hWnd,
         &swapChainDesc,
         nullptr,
@@ -281,6 +357,9 @@ Microsoft::WRL::ComPtr<IDXGISwapChain4> Window::CreateSwapChain() {
 
     ThrowIfFailed(swapChain1.As(&dxgiSwapChain4));
 
+    ThrowIfFailed(dxgiSwapChain4->SetMaximumFrameLatency(m_FramePacer.GetNumFramesInFlight()));
+    m_FrameLatencyWaitableObject = dxgiSwapChain4->GetFrameLatencyWaitableObject();
+
     m_CurrentBackBufferIndex = dxgiSwapChain4->GetCurrentBackBufferIndex();
 
     return dxgiSwapChain4;
@@ -289,28 +368,41 @@ Microsoft::WRL::ComPtr<IDXGISwapChain4> Window::CreateSwapChain() {
 // Update the render target views for the swapchain back buffers.
 void Window::UpdateRenderTargetViews() {
     auto device = Application::Get().GetDevice();
+    auto resourceStateMap = Application::Get().GetResourceStateMap();
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_d3d12RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-    for (int i = 0; i < BufferCount; ++i) {
+    for (UINT i = 0; i < m_BufferCount; ++i) {
         ComPtr<ID3D12Resource> backBuffer;
         ThrowIfFailed(m_dxgiSwapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffer)));
 
-        device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvHandle);
+        device->CreateRenderTargetView(backBuffer.Get(), nullptr,
+            D3D12_CPU_DESCRIPTOR_HANDLE{ m_RTVDescriptors.GetDescriptorHandle(i).ptr });
 
-        m_d3d12BackBuffers[i] = backBuffer;
+        D3D12_RESOURCE_DESC backBufferDesc = backBuffer->GetDesc();
+        m_BackBuffers[i] = std::make_shared<D3D12RHIResource>(backBuffer, RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm,
+            backBufferDesc.Width, backBufferDesc.Height, RHIResourceFlag_AllowRenderTarget));
 
-        rtvHandle.Offset(m_RTVDescriptorSize);
+        // Presenting leaves the back buffers in the present state.
+        resourceStateMap->AddResource(m_BackBuffers[i].get(), RHIResourceState_Present);
+    }
+}
+
+void Window::ReleaseBackBuffers() {
+    auto resourceStateMap = Application::Get().GetResourceStateMap();
+
+    for (UINT i = 0; i < MaxBufferCount; ++i) {
+        if (m_BackBuffers[i]) {
+            resourceStateMap->RemoveResource(m_BackBuffers[i].get());
+            m_BackBuffers[i].reset();
+        }
     }
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE Window::GetCurrentRenderTargetView() const {
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_d3d12RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-        m_CurrentBackBufferIndex, m_RTVDescriptorSize);
+    return D3D12_CPU_DESCRIPTOR_HANDLE{ m_RTVDescriptors.GetDescriptorHandle(m_CurrentBackBufferIndex).ptr };
 }
 
-Microsoft::WRL::ComPtr<ID3D12Resource> Window::GetCurrentBackBuffer() const {
-    return m_d3d12BackBuffers[m_CurrentBackBufferIndex];
+std::shared_ptr<RHIResource> Window::GetCurrentBackBuffer() const {
+    return m_BackBuffers[m_CurrentBackBufferIndex];
 }
 
 UINT Window::GetCurrentBackBufferIndex() const {
@@ -318,10 +410,105 @@ UINT Window::GetCurrentBackBufferIndex() const {
 }
 
 UINT Window::Present() {
+    PROFILE_FUNCTION();
+
     UINT syncInterval = m_VSync ? 1 : 0;
     UINT presentFlags = m_IsTearingSupported && !m_VSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
     ThrowIfFailed(m_dxgiSwapChain->Present(syncInterval, presentFlags));
     m_CurrentBackBufferIndex = m_dxgiSwapChain->GetCurrentBackBufferIndex();
 
+    // Resolve the GPU timestamps of the frame. Included in the frame's fence below.
+    Application& app = Application::Get();
+    app.GetGpuProfiler(D3D12_COMMAND_LIST_TYPE_DIRECT)->EndFrame();
+
+    // The frame context is free again once the GPU reaches this fence value.
+    m_FramePacer.EndFrame(app.GetCommandQueue()->Signal());
+
+    // The first frame has no previous present and its update time includes loading.
+    auto presentTime = HighResolutionClock::Now();
+    if (m_LastPresentTime != std::chrono::high_resolution_clock::time_point()) {
+        FrameStats::FrameRecord frameRecord;
+        frameRecord.frameNumber = m_FramePacer.GetFrameNumber();
+        // Pipelined frames are updated and rendered on different threads, the frame ends here.
+        frameRecord.frameTimeMs = m_RenderClock.GetDeltaMilliseconds();
+        frameRecord.cpuWaitMs = m_LastFrameWaitSeconds * 1000.0;
+        frameRecord.presentIntervalMs = std::chrono::duration<double, std::milli>(presentTime - m_LastPresentTime).count();
+        m_FrameStats.AddFrame(frameRecord);
+    }
+    m_LastPresentTime = presentTime;
+
     return m_CurrentBackBufferIndex;
 }
+
+void Window::BeginFrame() {
+    PROFILE_FUNCTION();
+
+    auto waitStart = HighResolutionClock::Now();
+
+    // Blocks while the maximum frame latency is reached. The timeout keeps the
+    // application responsive should the swapchain stop presenting.
+    ::WaitForSingleObjectEx(m_FrameLatencyWaitableObject, 1000, TRUE);
+
+    // Usually returns immediately since DXGI already throttled the frame.
+    m_FramePacer.BeginFrame();
+
+    m_LastFrameWaitSeconds = std::chrono::duration<double>(HighResolutionClock::Now() - waitStart).count();
+
+    // The GPU made progress, free the objects it no longer uses
+    // and collect the timestamps of finished frames.
+    Application& app = Application::Get();
+    app.GetDeferredReleaseQueue()->ReleaseCompleted();
+    app.GetGpuMemoryAllocator()->Trim();
+    app.GetAssetLoader()->Update();
+    app.GetGpuProfiler(D3D12_COMMAND_LIST_TYPE_DIRECT)->BeginFrame();
+}
+
+UINT Window::GetFramesInFlight() const {
+    return m_FramePacer.GetNumFramesInFlight();
+}
+
+void Window::SetFramesInFlight(UINT framesInFlight) {
+    PROFILE_FUNCTION();
+
+    framesInFlight = FramePacer::ClampFramesInFlight(framesInFlight);
+    if (framesInFlight == GetFramesInFlight()) {
+        return;
+    }
+
+    // The render thread begins and presents frames with the frame pacer.
+    WaitForRenderThread();
+
+    // Waits until the GPU no longer references the back buffers.
+    m_FramePacer.SetNumFramesInFlight(framesInFlight);
+    m_BufferCount = framesInFlight + 1;
+
+    ResizeSwapChain();
+    ThrowIfFailed(m_dxgiSwapChain->SetMaximumFrameLatency(framesInFlight));
+}
+
+UINT Window::GetBufferCount() const {
+    return m_BufferCount;
+}
+
+FramePacer& Window::GetFramePacer() {
+    return m_FramePacer;
+}
+
+FrameStats& Window::GetFrameStats() {
+    return m_FrameStats;
+}
+
+void Window::ResizeSwapChain() {
+    PROFILE_FUNCTION();
+
+    ReleaseBackBuffers();
+
+    DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
+    ThrowIfFailed(m_dxgiSwapChain->GetDesc(&swapChainDesc));
+    ThrowIfFailed(m_dxgiSwapChain->ResizeBuffers(m_BufferCount, m_ClientWidth,
+        m_ClientHeight, swapChainDesc.BufferDesc.Format, swapChainDesc.Flags));
+
+    m_CurrentBackBufferIndex = m_dxgiSwapChain->GetCurrentBackBufferIndex();
+
+    UpdateRenderTargetViews();
+}
@@ -0,0 +1,50 @@
+#include "assetloader.h"
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+TEST(AssetLoader, RequestsAreDoneOnceTheirCallbackHasRun) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto copyCommandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Copy, std::make_shared<ResourceStateMap>());
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ copyCommandQueue });
+    auto gpuMemoryAllocator = std::make_shared<GpuMemoryAllocator>(device, deferredReleaseQueue);
+
+    {
+        AssetLoader assetLoader(copyCommandQueue, gpuMemoryAllocator);
+
+        std::vector<uint8_t> data(4096, 0x5A);
+        int numCallbacks = 0;
+        GpuAllocation buffer;
+        auto request = assetLoader.CreateBuffer(data.data(), data.size(), RHIResourceFlag_None, [&](AssetRequest& request) {
+            ++numCallbacks;
+            // The callback can use the request but it is not done before the callback returns.
+            EXPECT_TRUE(request.IsReady());
+            EXPECT_FALSE(request.IsDone());
+            buffer = request.TakeBuffer();
+        });
+        auto missing = assetLoader.LoadFile("does/not/exist.bin", [&](AssetRequest& request) {
+            ++numCallbacks;
+            EXPECT_EQ(request.GetState(), AssetRequest::State::Failed);
+            EXPECT_FALSE(request.IsDone());
+        });
+
+        assetLoader.Flush();
+
+        EXPECT_EQ(numCallbacks, 2);
+        EXPECT_TRUE(request->IsDone());
+        EXPECT_TRUE(missing->IsDone());
+        EXPECT_FALSE(missing->IsReady());
+        // What the callback did is visible once the request is done.
+        EXPECT_TRUE(request->GetBuffer().IsNull());
+        EXPECT_EQ(buffer.GetSize(), data.size());
+        EXPECT_EQ(assetLoader.GetNumPendingRequests(), 0u);
+    }
+
+    deferredReleaseQueue->ReleaseCompleted();
+}
@@ -0,0 +1,128 @@
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "descriptorallocator.h"
+#include "resourcestatetracker.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const uint32_t NumDescriptorsPerPage = 16;
+
+} // namespace
+
+TEST(DescriptorAllocator, FreedBlocksAreMergedInAnyOrder) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto page = std::make_shared<DescriptorAllocatorPage>(device, nullptr, RHIDescriptorHeapType::CbvSrvUav, NumDescriptorsPerPage);
+    const size_t descriptorSize = device->GetDescriptorHandleIncrementSize(RHIDescriptorHeapType::CbvSrvUav);
+
+    std::vector<DescriptorAllocation> allocations;
+    for (uint32_t i = 0; i < NumDescriptorsPerPage / 2; ++i) {
+        allocations.push_back(page->Allocate(2));
+        ASSERT_FALSE(allocations.back().IsNull());
+    }
+    const size_t base = allocations[0].GetDescriptorHandle().ptr;
+    EXPECT_EQ(allocations[3].GetDescriptorHandle(1).ptr, base + 7 * descriptorSize);
+    EXPECT_EQ(page->GetNumFreeHandles(), 0u);
+    EXPECT_TRUE(page->Allocate(1).IsNull());
+
+    // Every other range is free, no two of them are adjacent.
+    const uint32_t freeOrder[] = { 5, 1, 7, 3, 0, 6, 2, 4 };
+    for (uint32_t i = 0; i < 4; ++i) {
+        allocations[freeOrder[i]].Free();
+        EXPECT_TRUE(allocations[freeOrder[i]].IsNull());
+    }
+    EXPECT_EQ(page->GetNumFreeHandles(), 8u);
+    EXPECT_TRUE(page->Allocate(3).IsNull());
+
+    // Freeing the ranges in between merges the free blocks with both neighbors.
+    for (uint32_t i = 4; i < 8; ++i) {
+        allocations[freeOrder[i]].Free();
+    }
+    EXPECT_EQ(page->GetNumFreeHandles(), NumDescriptorsPerPage);
+
+    DescriptorAllocation all = page->Allocate(NumDescriptorsPerPage);
+    ASSERT_FALSE(all.IsNull());
+    EXPECT_EQ(all.GetDescriptorHandle().ptr, base);
+    EXPECT_EQ(all.GetNumHandles(), NumDescriptorsPerPage);
+}
+
+TEST(DescriptorAllocator, AFragmentedPageIsReusedOnceItsRangesAreFree) {
+    auto device = std::make_shared<NullRHIDevice>();
+    DescriptorAllocator allocator(device, nullptr, RHIDescriptorHeapType::CbvSrvUav, NumDescriptorsPerPage);
+    const size_t descriptorSize = device->GetDescriptorHandleIncrementSize(RHIDescriptorHeapType::CbvSrvUav);
+
+    std::vector<DescriptorAllocation> allocations;
+    const uint32_t sizes[] = { 1, 3, 2, 4, 1, 5 };
+    for (uint32_t size : sizes) {
+        allocations.push_back(allocator.Allocate(size));
+    }
+    EXPECT_EQ(allocator.GetNumPages(), 1u);
+    const size_t base = allocations[0].GetDescriptorHandle().ptr;
+
+    // The smallest free block that fits is used, the gap of 2 is refilled.
+    allocations[2].Free();
+    allocations[4].Free();
+    DescriptorAllocation refill = allocator.Allocate(2);
+    EXPECT_EQ(refill.GetDescriptorHandle().ptr, base + 4 * descriptorSize);
+    refill.Free();
+
+    const uint32_t freeOrder[] = { 3, 0, 5, 1 };
+    for (uint32_t index : freeOrder) {
+        allocations[index].Free();
+    }
+
+    DescriptorAllocation all = allocator.Allocate(NumDescriptorsPerPage);
+    ASSERT_FALSE(all.IsNull());
+    EXPECT_EQ(all.GetDescriptorHandle().ptr, base);
+    EXPECT_EQ(allocator.GetNumPages(), 1u);
+
+    // Ranges larger than a page get a page of their own.
+    DescriptorAllocation large = allocator.Allocate(NumDescriptorsPerPage * 2);
+    ASSERT_FALSE(large.IsNull());
+    EXPECT_EQ(large.GetNumHandles(), NumDescriptorsPerPage * 2);
+    EXPECT_EQ(allocator.GetNumPages(), 2u);
+}
+
+TEST(DescriptorAllocator, FreedRangesReturnOnceTheGpuIsDone) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ commandQueue });
+    DescriptorAllocator allocator(device, deferredReleaseQueue, RHIDescriptorHeapType::CbvSrvUav, NumDescriptorsPerPage);
+
+    DescriptorAllocation first = allocator.Allocate(NumDescriptorsPerPage);
+    const size_t firstPage = first.GetDescriptorHandle().ptr;
+    // A command list referencing the range is in flight while it is freed.
+    const uint64_t fenceValue = commandQueue->ExecuteCommandList(commandQueue->GetCommandList());
+    first.Free();
+    EXPECT_EQ(deferredReleaseQueue->GetNumPendingReleases(), 1u);
+
+    // The range is not reused yet, the allocator needs another page.
+    DescriptorAllocation second = allocator.Allocate(NumDescriptorsPerPage);
+    EXPECT_NE(second.GetDescriptorHandle().ptr, firstPage);
+    EXPECT_EQ(allocator.GetNumPages(), 2u);
+    second.Free();
+
+    // Completion alone doesn't return the ranges, ReleaseCompleted does.
+    commandQueue->WaitForFenceValue(fenceValue);
+    EXPECT_EQ(deferredReleaseQueue->GetNumPendingReleases(), 2u);
+    EXPECT_EQ(deferredReleaseQueue->ReleaseCompleted(), 2u);
+
+    DescriptorAllocation third = allocator.Allocate(NumDescriptorsPerPage);
+    DescriptorAllocation fourth = allocator.Allocate(NumDescriptorsPerPage);
+    EXPECT_FALSE(third.IsNull());
+    EXPECT_FALSE(fourth.IsNull());
+    EXPECT_EQ(third.GetDescriptorHandle().ptr, firstPage);
+    EXPECT_EQ(allocator.GetNumPages(), 2u);
+
+    // Flush releases the ranges without a call to ReleaseCompleted.
+    third.Free();
+    fourth.Free();
+    deferredReleaseQueue->Flush();
+    EXPECT_EQ(deferredReleaseQueue->GetNumPendingReleases(), 0u);
+}
@@ -0,0 +1,235 @@
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "dynamicdescriptorheap.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Null descriptors are plain memory, CopyDescriptors copies them. Every source descriptor is filled
+// with its index so the copies in the ring can be traced back to the staged descriptors.
+
+namespace {
+
+// Counts the CopyDescriptors calls and their ranges.
+class CopyCountingDevice : public NullRHIDevice {
+public:
+    virtual void CopyDescriptors(uint32_t numDestRanges, const RHICPUDescriptorHandle* destRangeStarts,
+        const uint32_t* destRangeSizes, uint32_t numSrcRanges, const RHICPUDescriptorHandle* srcRangeStarts,
+        const uint32_t* srcRangeSizes, RHIDescriptorHeapType type) override {
+        ++numCopies;
+        numLastDestRanges = numDestRanges;
+        numLastSrcRanges = numSrcRanges;
+        NullRHIDevice::CopyDescriptors(numDestRanges, destRangeStarts, destRangeSizes,
+            numSrcRanges, srcRangeStarts, srcRangeSizes, type);
+    }
+
+    uint32_t numCopies = 0;
+    uint32_t numLastDestRanges = 0;
+    uint32_t numLastSrcRanges = 0;
+};
+
+const uint32_t NumSourceDescriptors = 16;
+const uint32_t NumBlocks = 4;
+const uint32_t NumDescriptorsPerBlock = 8;
+
+class SourceDescriptors {
+public:
+    explicit SourceDescriptors(RHIDevice& device)
+        : m_DescriptorSize(device.GetDescriptorHandleIncrementSize(RHIDescriptorHeapType::CbvSrvUav)) {
+        RHIDescriptorHeapDesc desc;
+        desc.NumDescriptors = NumSourceDescriptors;
+        m_Heap = device.CreateDescriptorHeap(desc);
+        for (uint32_t i = 0; i < NumSourceDescriptors; ++i) {
+            std::memset(reinterpret_cast<void*>(Get(i).ptr), static_cast<int>(i + 1), m_DescriptorSize);
+        }
+    }
+
+    RHICPUDescriptorHandle Get(uint32_t index) const {
+        RHICPUDescriptorHandle handle = m_Heap->GetCPUDescriptorHandleForHeapStart();
+        handle.ptr += static_cast<size_t>(index) * m_DescriptorSize;
+        return handle;
+    }
+
+    // The source descriptor a descriptor is a copy of, or -1.
+    int Find(RHICPUDescriptorHandle descriptor) const {
+        for (uint32_t i = 0; i < NumSourceDescriptors; ++i) {
+            if (std::memcmp(reinterpret_cast<const void*>(Get(i).ptr), reinterpret_cast<const void*>(descriptor.ptr),
+                m_DescriptorSize) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+private:
+    std::shared_ptr<RHIDescriptorHeap> m_Heap;
+    uint32_t m_DescriptorSize;
+};
+
+uint32_t CountCommands(const NullRHICommandList& commandList, NullRHICommandType type) {
+    uint32_t count = 0;
+    const std::vector<uint8_t>& data = commandList.GetCommandData();
+    for (size_t offset = 0; offset < data.size(); ) {
+        const NullRHICommandHeader* header = reinterpret_cast<const NullRHICommandHeader*>(data.data() + offset);
+        count += header->Type == type ? 1 : 0;
+        offset += header->Size;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(DynamicDescriptorHeap, OnlyDirtyTablesAreCopiedWithOneCopyPerHeapType) {
+    auto device = std::make_shared<CopyCountingDevice>();
+    auto ring = std::make_shared<DynamicDescriptorRing>(device, nullptr, RHIDescriptorHeapType::CbvSrvUav,
+        NumBlocks * NumDescriptorsPerBlock, NumDescriptorsPerBlock);
+    auto samplerRing = std::make_shared<DynamicDescriptorRing>(device, nullptr, RHIDescriptorHeapType::Sampler,
+        NumBlocks * NumDescriptorsPerBlock, NumDescriptorsPerBlock);
+    SourceDescriptors sources(*device);
+    DynamicDescriptorHeap heap(device, ring, samplerRing);
+    NullRHICommandList commandList(RHIQueueType::Direct, device->CreateCommandAllocator(RHIQueueType::Direct));
+
+    const DynamicDescriptorHeap::DescriptorTableLayout tables[] = {
+        { 0, RHIDescriptorHeapType::CbvSrvUav, 4 },
+        { 2, RHIDescriptorHeapType::CbvSrvUav, 2 },
+        { 3, RHIDescriptorHeapType::Sampler, 1 }
+    };
+    heap.SetRootSignatureLayout(tables, 3);
+
+    heap.StageDescriptors(0, 0, 4, sources.Get(0));
+    heap.StageDescriptors(2, 0, 2, sources.Get(6));
+    heap.StageDescriptors(3, 0, 1, sources.Get(15));
+    heap.CommitStagedDescriptorsForDraw(&commandList);
+
+    // Both CBV/SRV/UAV tables in one copy, table 0 first in the first block, and one copy of the samplers.
+    EXPECT_EQ(device->numCopies, 2u);
+    EXPECT_EQ(CountCommands(commandList, NullRHICommandType::SetDescriptorHeaps), 1u);
+    EXPECT_EQ(CountCommands(commandList, NullRHICommandType::SetGraphicsRootDescriptorTable), 3u);
+    for (uint32_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, i)), static_cast<int>(i));
+    }
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 4)), 6);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 5)), 7);
+    EXPECT_EQ(sources.Find(samplerRing->GetCPUDescriptorHandle(0, 0)), 15);
+
+    // Nothing changed, nothing to do.
+    heap.CommitStagedDescriptorsForDraw(&commandList);
+    EXPECT_EQ(device->numCopies, 2u);
+    EXPECT_EQ(CountCommands(commandList, NullRHICommandType::SetGraphicsRootDescriptorTable), 3u);
+
+    // Only table 2 moves, earlier draws still read the old copy. The heaps stay bound.
+    heap.StageDescriptors(2, 1, 1, sources.Get(9));
+    heap.CommitStagedDescriptorsForDraw(&commandList);
+    EXPECT_EQ(device->numCopies, 3u);
+    EXPECT_EQ(CountCommands(commandList, NullRHICommandType::SetDescriptorHeaps), 1u);
+    EXPECT_EQ(CountCommands(commandList, NullRHICommandType::SetGraphicsRootDescriptorTable), 4u);
+    for (uint32_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, i)), static_cast<int>(i));
+    }
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 5)), 7);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 6)), 6);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 7)), 9);
+    EXPECT_EQ(samplerRing->GetNumFreeBlocks(), NumBlocks - 1);
+
+    // Dispatches bind compute tables.
+    heap.StageDescriptors(0, 0, 1, sources.Get(12));
+    heap.CommitStagedDescriptorsForDispatch(&commandList);
+    EXPECT_EQ(CountCommands(commandList, NullRHICommandType::SetComputeRootDescriptorTable), 1u);
+}
+
+TEST(DynamicDescriptorHeap, StagedRunsAreCoalescedIntoRanges) {
+    auto device = std::make_shared<CopyCountingDevice>();
+    auto ring = std::make_shared<DynamicDescriptorRing>(device, nullptr, RHIDescriptorHeapType::CbvSrvUav,
+        NumBlocks * NumDescriptorsPerBlock, NumDescriptorsPerBlock);
+    SourceDescriptors sources(*device);
+    DynamicDescriptorHeap heap(device, ring, nullptr);
+    NullRHICommandList commandList(RHIQueueType::Direct, device->CreateCommandAllocator(RHIQueueType::Direct));
+
+    const DynamicDescriptorHeap::DescriptorTableLayout table = { 0, RHIDescriptorHeapType::CbvSrvUav, 6 };
+    heap.SetRootSignatureLayout(&table, 1);
+
+    // Offsets 0-1 and 3 are staged, 2 is a hole. The sources 0-2 are consecutive, 10 is not.
+    heap.StageDescriptors(0, 0, 2, sources.Get(0));
+    heap.StageDescriptors(0, 3, 1, sources.Get(2));
+    heap.StageDescriptors(0, 4, 1, sources.Get(10));
+    heap.CommitStagedDescriptorsForDraw(&commandList);
+
+    EXPECT_EQ(device->numCopies, 1u);
+    EXPECT_EQ(device->numLastDestRanges, 2u);
+    EXPECT_EQ(device->numLastSrcRanges, 2u);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 0)), 0);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 1)), 1);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 3)), 2);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 4)), 10);
+}
+
+TEST(DynamicDescriptorHeap, TablesRollOverToTheNextBlock) {
+    auto device = std::make_shared<CopyCountingDevice>();
+    auto ring = std::make_shared<DynamicDescriptorRing>(device, nullptr, RHIDescriptorHeapType::CbvSrvUav,
+        NumBlocks * NumDescriptorsPerBlock, NumDescriptorsPerBlock);
+    SourceDescriptors sources(*device);
+    DynamicDescriptorHeap heap(device, ring, nullptr);
+    NullRHICommandList commandList(RHIQueueType::Direct, device->CreateCommandAllocator(RHIQueueType::Direct));
+
+    const DynamicDescriptorHeap::DescriptorTableLayout table = { 1, RHIDescriptorHeapType::CbvSrvUav, 3 };
+    heap.SetRootSignatureLayout(&table, 1);
+
+    // Two tables of three fit in a block of eight, the third starts the next block.
+    for (uint32_t draw = 0; draw < 3; ++draw) {
+        heap.StageDescriptors(1, 0, 3, sources.Get(draw * 3));
+        heap.CommitStagedDescriptorsForDraw(&commandList);
+    }
+    EXPECT_EQ(ring->GetNumFreeBlocks(), NumBlocks - 2);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 0)), 0);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(0, 3)), 3);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(1, 0)), 6);
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(1, 2)), 8);
+
+    // Without a release queue the blocks are free again right away.
+    heap.Reset();
+    EXPECT_EQ(ring->GetNumFreeBlocks(), NumBlocks);
+}
+
+TEST(DynamicDescriptorHeap, ResetReturnsBlocksOnceTheGpuIsDone) {
+    auto device = std::make_shared<CopyCountingDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ commandQueue });
+    auto ring = std::make_shared<DynamicDescriptorRing>(device, deferredReleaseQueue, RHIDescriptorHeapType::CbvSrvUav,
+        NumBlocks * NumDescriptorsPerBlock, NumDescriptorsPerBlock);
+    SourceDescriptors sources(*device);
+    DynamicDescriptorHeap heap(device, ring, nullptr);
+
+    const DynamicDescriptorHeap::DescriptorTableLayout table = { 0, RHIDescriptorHeapType::CbvSrvUav, NumDescriptorsPerBlock };
+    heap.SetRootSignatureLayout(&table, 1);
+
+    auto commandList = commandQueue->GetCommandList();
+    for (uint32_t draw = 0; draw < 3; ++draw) {
+        heap.StageDescriptors(0, 0, 1, sources.Get(draw));
+        heap.CommitStagedDescriptorsForDraw(commandList.get());
+    }
+    EXPECT_EQ(ring->GetNumFreeBlocks(), NumBlocks - 3);
+
+    const uint64_t fenceValue = commandQueue->ExecuteCommandList(commandList);
+    heap.Reset();
+    EXPECT_EQ(ring->GetNumFreeBlocks(), NumBlocks - 3);
+    EXPECT_EQ(deferredReleaseQueue->GetNumPendingReleases(), 3u);
+
+    commandQueue->WaitForFenceValue(fenceValue);
+    EXPECT_EQ(ring->GetNumFreeBlocks(), NumBlocks - 3);
+    deferredReleaseQueue->ReleaseCompleted();
+    EXPECT_EQ(ring->GetNumFreeBlocks(), NumBlocks);
+
+    // The returned blocks are handed out in the order they were released, after the ones never used.
+    heap.SetRootSignatureLayout(&table, 1);
+    auto nextCommandList = commandQueue->GetCommandList();
+    heap.StageDescriptors(0, 0, 1, sources.Get(5));
+    heap.CommitStagedDescriptorsForDraw(nextCommandList.get());
+    EXPECT_EQ(sources.Find(ring->GetCPUDescriptorHandle(3, 0)), 5);
+    commandQueue->WaitForFenceValue(commandQueue->ExecuteCommandList(nextCommandList));
+    heap.Reset();
+}
@@ -0,0 +1,162 @@
+#include "framepipeline.h"
+#include "testing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Snapshot {
+    uint32_t frame;
+    // Every element is the frame, a snapshot written while it is rendered has a mix of frames.
+    std::vector<uint32_t> values;
+};
+
+// Slow enough that the simulation catches up with the render thread and waits in Submit.
+void RenderSlowly() {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+} // namespace
+
+TEST(FramePipeline, SnapshotsAreHandedOverInOrderAndNeverWrittenWhileRendered) {
+    const uint32_t numFrames = 200;
+    Snapshot snapshots[FramePipeline::NumSnapshots];
+    // The snapshot the simulation is writing, or -1.
+    std::atomic<int> writing(-1);
+
+    // Only touched by the render thread until WaitForIdle returns.
+    std::vector<uint32_t> renderedFrames;
+    std::vector<uint32_t> renderedSnapshots;
+    uint32_t numTorn = 0;
+    uint32_t numRacing = 0;
+
+    FramePipeline pipeline([&](uint32_t snapshotIndex) {
+        if (writing.load() == static_cast<int>(snapshotIndex)) {
+            ++numRacing;
+        }
+        const Snapshot& snapshot = snapshots[snapshotIndex];
+        RenderSlowly();
+        for (uint32_t value : snapshot.values) {
+            if (value != snapshot.frame) {
+                ++numTorn;
+                break;
+            }
+        }
+        renderedFrames.push_back(snapshot.frame);
+        renderedSnapshots.push_back(snapshotIndex);
+    });
+
+    for (uint32_t frame = 0; frame < numFrames; ++frame) {
+        const uint32_t writeIndex = pipeline.GetWriteIndex();
+        EXPECT_EQ(writeIndex, frame % FramePipeline::NumSnapshots);
+
+        writing = static_cast<int>(writeIndex);
+        Snapshot& snapshot = snapshots[writeIndex];
+        snapshot.frame = frame;
+        snapshot.values.assign(1000, frame);
+        writing = -1;
+
+        pipeline.Submit();
+        // Submit waited for the previous frame, the simulation is at most one frame ahead.
+        EXPECT_GE(pipeline.GetNumFramesRendered(), frame);
+    }
+    pipeline.WaitForIdle();
+
+    EXPECT_EQ(pipeline.GetNumFramesRendered(), numFrames);
+    ASSERT_EQ(renderedFrames.size(), numFrames);
+    for (uint32_t frame = 0; frame < numFrames; ++frame) {
+        ASSERT_EQ(renderedFrames[frame], frame);
+        ASSERT_EQ(renderedSnapshots[frame], frame % FramePipeline::NumSnapshots);
+    }
+    EXPECT_EQ(numTorn, 0u);
+    EXPECT_EQ(numRacing, 0u);
+}
+
+TEST(FramePipeline, WaitForIdleWaitsForTheSubmittedFrame) {
+    std::atomic<uint32_t> numRendered(0);
+    FramePipeline pipeline([&](uint32_t) {
+        RenderSlowly();
+        ++numRendered;
+    });
+
+    // Nothing submitted, nothing to wait for.
+    pipeline.WaitForIdle();
+    EXPECT_EQ(pipeline.GetNumFramesRendered(), 0u);
+
+    for (uint32_t frame = 1; frame <= 10; ++frame) {
+        pipeline.Submit();
+        pipeline.WaitForIdle();
+        EXPECT_EQ(numRendered.load(), frame);
+        EXPECT_EQ(pipeline.GetNumFramesRendered(), frame);
+    }
+}
+
+TEST(FramePipeline, DestructionRendersTheSubmittedFrameFirst) {
+    // Declared before the pipelines, the render thread uses them until the pipeline is destroyed.
+    std::atomic<uint32_t> numRendered(0);
+    std::atomic<bool> rendering(false);
+
+    for (uint32_t numFrames = 0; numFrames < 4; ++numFrames) {
+        numRendered = 0;
+        {
+            FramePipeline pipeline([&](uint32_t) {
+                rendering = true;
+                // Still rendering while the simulation destroys the pipeline.
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                ++numRendered;
+                rendering = false;
+            });
+            for (uint32_t frame = 0; frame < numFrames; ++frame) {
+                pipeline.Submit();
+            }
+        }
+        // The render thread was joined after it finished the last frame, and no frame is rendered twice.
+        EXPECT_FALSE(rendering.load());
+        EXPECT_EQ(numRendered.load(), numFrames);
+    }
+}
+
+TEST(FramePipeline, RenderExceptionsAreRethrownOnTheSimulationThread) {
+    uint32_t numRendered = 0;
+    FramePipeline pipeline([&](uint32_t snapshotIndex) {
+        ++numRendered;
+        if (snapshotIndex == 1) {
+            throw std::runtime_error("Render failed");
+        }
+    });
+
+    pipeline.Submit();
+    pipeline.Submit();
+
+    bool thrown = false;
+    try {
+        pipeline.WaitForIdle();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+
+    // The exception is rethrown once, the pipeline keeps rendering.
+    pipeline.WaitForIdle();
+    EXPECT_EQ(pipeline.GetNumFramesRendered(), 2u);
+
+    pipeline.Submit();
+    pipeline.WaitForIdle();
+    EXPECT_EQ(numRendered, 3u);
+
+    // A failed frame is reported by the Submit after it if nothing waited for it.
+    pipeline.Submit();
+    thrown = false;
+    try {
+        pipeline.Submit();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+    pipeline.WaitForIdle();
+}
@@ -0,0 +1,81 @@
+#include "framestats.h"
+#include "testing.h"
+
+#include <cstdint>
+
+namespace {
+
+const double Epsilon = 1.0e-9;
+
+void AddFrames(FrameStats& stats, uint64_t& frameNumber, uint32_t count, double frameTimeMs) {
+    for (uint32_t i = 0; i < count; ++i) {
+        stats.AddFrame({ frameNumber++, frameTimeMs, 0.0, frameTimeMs });
+    }
+}
+
+} // namespace
+
+TEST(FrameStats, PercentilesBeyondTheHistogramAreExact) {
+    FrameStats stats;
+    uint64_t frameNumber = 0;
+    for (uint32_t i = 0; i < 10; ++i) {
+        AddFrames(stats, frameNumber, 1, 300.0 + i);
+    }
+
+    // All frames are in the last bucket, the percentiles are not all the maximum.
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.10), 300.0, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.50), 304.0, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.95), 309.0, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(1.00), 309.0, Epsilon);
+
+    // With frames in the histogram, the rank continues into the last bucket.
+    AddFrames(stats, frameNumber, 10, 16.05);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.50), 16.1, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.55), 300.0, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.75), 304.0, Epsilon);
+
+    const FrameStats::Summary summary = stats.GetSummary();
+    EXPECT_NEAR(summary.p50FrameTimeMs, 16.1, Epsilon);
+    EXPECT_NEAR(summary.p95FrameTimeMs, 308.0, Epsilon);
+    EXPECT_NEAR(summary.p99FrameTimeMs, 309.0, Epsilon);
+    EXPECT_NEAR(summary.maxFrameTimeMs, 309.0, Epsilon);
+}
+
+TEST(FrameStats, PercentilesFollowTheWindowAsItRolls) {
+    FrameStats stats(8);
+    uint64_t frameNumber = 0;
+
+    AddFrames(stats, frameNumber, 8, 10.05);
+    EXPECT_EQ(stats.GetNumFrames(), 8u);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.50), 10.1, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.99), 10.1, Epsilon);
+
+    // Half of the window is replaced.
+    AddFrames(stats, frameNumber, 4, 30.05);
+    EXPECT_EQ(stats.GetNumFrames(), 8u);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.50), 10.1, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.99), 30.1, Epsilon);
+
+    // All of it.
+    AddFrames(stats, frameNumber, 4, 30.05);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.01), 30.1, Epsilon);
+
+    // Hitches beyond the histogram leave the window too.
+    AddFrames(stats, frameNumber, 2, 500.0);
+    AddFrames(stats, frameNumber, 2, 400.0);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.50), 30.1, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.75), 400.0, Epsilon);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.99), 500.0, Epsilon);
+
+    AddFrames(stats, frameNumber, 6, 16.05);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.99), 400.0, Epsilon);
+    AddFrames(stats, frameNumber, 2, 16.05);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.99), 16.1, Epsilon);
+    EXPECT_NEAR(stats.GetSummary().maxFrameTimeMs, 16.05, Epsilon);
+
+    stats.Reset();
+    EXPECT_EQ(stats.GetNumFrames(), 0u);
+    EXPECT_EQ(stats.GetFrameTimePercentileMs(0.50), 0.0);
+    AddFrames(stats, frameNumber, 1, 300.0);
+    EXPECT_NEAR(stats.GetFrameTimePercentileMs(0.50), 300.0, Epsilon);
+}
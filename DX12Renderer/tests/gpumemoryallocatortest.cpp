@@ -0,0 +1,139 @@
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "gpumemoryallocator.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const uint64_t BlockSize = 16 * 1024 * 1024;
+
+} // namespace
+
+TEST(GpuMemoryAllocator, RandomAllocationsNeverOverlap) {
+    auto device = std::make_shared<NullRHIDevice>();
+    GpuMemoryAllocator allocator(device, nullptr, BlockSize);
+
+    std::mt19937 random(42);
+
+    // Live allocations by GPU virtual address. Placed resources have the address of
+    // their heap plus their offset, packed buffers that of their page plus theirs.
+    std::map<uint64_t, GpuAllocation> allocations;
+
+    for (int i = 0; i < 5000; ++i) {
+        if (allocations.empty() || random() % 5 < 3) {
+            GpuAllocation allocation;
+            switch (random() % 4) {
+                case 0:
+                    allocation = allocator.CreateBuffer(RHIHeapType::Default, 1 + random() % (256 * 1024));
+                    break;
+                case 1:
+                    allocation = allocator.CreateBuffer(RHIHeapType::Default, 1 + random() % 4096);
+                    break;
+                case 2:
+                    allocation = allocator.CreateBuffer(RHIHeapType::Upload, 1 + random() % 4096);
+                    break;
+                default:
+                    allocation = allocator.CreateTexture(RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm,
+                        16 << (random() % 5), 16 << (random() % 5)), RHIResourceState_Common);
+                    break;
+            }
+            ASSERT_FALSE(allocation.IsNull());
+
+            const uint64_t address = allocation.GetGPUVirtualAddress();
+            if (allocation.GetOffset() != 0) {
+                ASSERT_EQ(allocation.GetOffset() % GpuMemoryAllocator::PackedBufferAlignment, 0u);
+            }
+
+            auto next = allocations.lower_bound(address);
+            if (next != allocations.end()) {
+                ASSERT_LE(address + allocation.GetSize(), next->first);
+            }
+            if (next != allocations.begin()) {
+                auto prev = std::prev(next);
+                ASSERT_LE(prev->first + prev->second.GetSize(), address);
+            }
+
+            allocations.emplace(address, std::move(allocation));
+        } else {
+            allocations.erase(std::next(allocations.begin(), random() % allocations.size()));
+        }
+    }
+
+    GpuMemoryAllocator::Stats stats = allocator.GetStats();
+    EXPECT_GT(stats.numHeaps, 1u);
+    EXPECT_EQ(stats.numPackedBuffers + stats.numPlacedResources - stats.numPackedBufferPages, allocations.size());
+}
+
+TEST(GpuMemoryAllocator, TrimReleasesEmptyHeapsAndPages) {
+    auto device = std::make_shared<NullRHIDevice>();
+    GpuMemoryAllocator allocator(device, nullptr, BlockSize);
+
+    // Enough of both to fill several heaps and pages.
+    std::vector<GpuAllocation> allocations;
+    for (int i = 0; i < 64; ++i) {
+        allocations.push_back(allocator.CreateBuffer(RHIHeapType::Default, 1024 * 1024));
+    }
+    for (int i = 0; i < 3000; ++i) {
+        allocations.push_back(allocator.CreateBuffer(RHIHeapType::Default, 4096));
+    }
+
+    GpuMemoryAllocator::Stats stats = allocator.GetStats();
+    EXPECT_GT(stats.numHeaps, 4u);
+    EXPECT_GT(stats.numPackedBufferPages, 2u);
+
+    // Nothing is empty yet.
+    allocator.Trim();
+    EXPECT_EQ(allocator.GetStats().numHeaps, stats.numHeaps);
+    EXPECT_EQ(allocator.GetStats().numPackedBufferPages, stats.numPackedBufferPages);
+
+    allocations.clear();
+    allocator.Trim();
+
+    // One empty page is kept, and with it the heap it is placed in, and one empty heap.
+    stats = allocator.GetStats();
+    EXPECT_EQ(stats.numPackedBufferPages, 1u);
+    EXPECT_EQ(stats.numPackedBuffers, 0u);
+    EXPECT_EQ(stats.numHeaps, 2u);
+    EXPECT_EQ(stats.numPlacedResources, 1u);
+    EXPECT_EQ(stats.heapUsedBytes, GpuMemoryAllocator::PackedBufferPageSize);
+
+    // The kept blocks are reused.
+    GpuAllocation buffer = allocator.CreateBuffer(RHIHeapType::Default, 1024 * 1024);
+    GpuAllocation packedBuffer = allocator.CreateBuffer(RHIHeapType::Default, 4096);
+    EXPECT_EQ(allocator.GetStats().numHeaps, 2u);
+    EXPECT_EQ(allocator.GetStats().numPackedBufferPages, 1u);
+}
+
+TEST(GpuMemoryAllocator, TrimKeepsHeapsUntilTheirReleasesComplete) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ commandQueue });
+    GpuMemoryAllocator allocator(device, deferredReleaseQueue, BlockSize);
+
+    std::vector<GpuAllocation> allocations;
+    for (int i = 0; i < 32; ++i) {
+        allocations.push_back(allocator.CreateBuffer(RHIHeapType::Default, 1024 * 1024));
+    }
+    const uint32_t numHeaps = allocator.GetStats().numHeaps;
+    EXPECT_GT(numHeaps, 1u);
+
+    // The ranges are returned once the GPU is done with them.
+    commandQueue->Signal();
+    allocations.clear();
+    allocator.Trim();
+    EXPECT_EQ(allocator.GetStats().numHeaps, numHeaps);
+
+    deferredReleaseQueue->ReleaseCompleted();
+    allocator.Trim();
+    EXPECT_EQ(allocator.GetStats().numHeaps, 1u);
+    EXPECT_EQ(allocator.GetStats().heapUsedBytes, 0u);
+}
@@ -0,0 +1,126 @@
+#include "assetloader.h"
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "gpuprofiler.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+double GetDurationMs(const GpuProfiler::Region& region) {
+    return (region.endTimestamp - region.beginTimestamp) * 1e-6;
+}
+
+} // namespace
+
+TEST(GpuProfiler, RegionsGetTheSynthesizedTimingsOfTheNullBackend) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    GpuProfiler profiler(device, commandQueue, "GPU Test");
+    ASSERT_TRUE(profiler.IsSupported());
+
+    profiler.BeginFrame();
+
+    auto commandList = commandQueue->GetCommandList();
+    {
+        GpuProfileScope frameScope(profiler, commandList.get(), "Frame");
+        {
+            GpuProfileScope scope(profiler, commandList.get(), "Ten Draws");
+            for (int i = 0; i < 10; ++i) {
+                commandList->DrawIndexedInstanced(300, 1, 0, 0, 0);
+            }
+        }
+        {
+            GpuProfileScope scope(profiler, commandList.get(), "Twenty Draws");
+            for (int i = 0; i < 20; ++i) {
+                commandList->DrawIndexedInstanced(300, 1, 0, 0, 0);
+            }
+        }
+    }
+    commandQueue->ExecuteCommandList(commandList);
+
+    profiler.EndFrame();
+
+    // The null queue replays at submission, the results are read back by the next frame.
+    profiler.BeginFrame();
+    profiler.EndFrame();
+
+    const std::vector<GpuProfiler::Region>& regions = profiler.GetLastFrameRegions();
+    ASSERT_EQ(regions.size(), 3u);
+
+    // Sorted by begin timestamp, the enclosing region first.
+    EXPECT_EQ(std::string(regions[0].name), "Frame");
+    EXPECT_EQ(std::string(regions[1].name), "Ten Draws");
+    EXPECT_EQ(std::string(regions[2].name), "Twenty Draws");
+    EXPECT_EQ(regions[0].depth, 0u);
+    EXPECT_EQ(regions[1].depth, 1u);
+    EXPECT_EQ(regions[2].depth, 1u);
+
+    EXPECT_LE(regions[0].beginTimestamp, regions[1].beginTimestamp);
+    EXPECT_LE(regions[1].endTimestamp, regions[2].beginTimestamp);
+    EXPECT_LE(regions[2].endTimestamp, regions[0].endTimestamp);
+
+    // Every draw costs the same virtual GPU time.
+    EXPECT_GT(GetDurationMs(regions[1]), 0.0);
+    EXPECT_NEAR(GetDurationMs(regions[2]), 2.0 * GetDurationMs(regions[1]), 1e-4);
+    EXPECT_NEAR(GetDurationMs(regions[0]), GetDurationMs(regions[1]) + GetDurationMs(regions[2]), 1e-4);
+
+    const std::map<std::string, GpuProfiler::RegionStats>& stats = profiler.GetRegionStats();
+    ASSERT_EQ(stats.size(), 3u);
+    EXPECT_EQ(stats.at("Ten Draws").count, 1u);
+    EXPECT_NEAR(stats.at("Ten Draws").lastMs, GetDurationMs(regions[1]), 1e-9);
+    EXPECT_EQ(profiler.GetNumDroppedFrames(), 0u);
+}
+
+TEST(GpuProfiler, RegionsOutsideOfAFrameAreNotRecorded) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    GpuProfiler profiler(device, commandQueue, "GPU Test");
+
+    auto commandList = commandQueue->GetCommandList();
+    EXPECT_EQ(profiler.BeginRegion(commandList.get(), "Outside"), GpuProfiler::InvalidRegion);
+    commandQueue->ExecuteCommandList(commandList);
+
+    profiler.BeginFrame();
+    profiler.EndFrame();
+    profiler.BeginFrame();
+    profiler.EndFrame();
+
+    EXPECT_TRUE(profiler.GetLastFrameRegions().empty());
+    EXPECT_TRUE(profiler.GetRegionStats().empty());
+}
+
+TEST(GpuProfiler, AssetLoaderBatchesAreProfiledOnTheCopyQueue) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto copyCommandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Copy, std::make_shared<ResourceStateMap>());
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ copyCommandQueue });
+    auto gpuMemoryAllocator = std::make_shared<GpuMemoryAllocator>(device, deferredReleaseQueue);
+    auto gpuProfiler = std::make_shared<GpuProfiler>(device, copyCommandQueue, "GPU Copy Queue");
+
+    {
+        AssetLoader assetLoader(copyCommandQueue, gpuMemoryAllocator, gpuProfiler);
+
+        // Every batch reads back the timestamps of the batches before it.
+        std::vector<uint8_t> data(64 * 1024, 0x5A);
+        const int numBatches = 3;
+        for (int i = 0; i < numBatches; ++i) {
+            auto request = assetLoader.CreateBuffer(data.data(), data.size());
+            assetLoader.Flush();
+            EXPECT_TRUE(request->IsReady());
+        }
+    }
+
+    // The I/O thread has been joined, the statistics can be read here.
+    const std::map<std::string, GpuProfiler::RegionStats>& stats = gpuProfiler->GetRegionStats();
+    ASSERT_EQ(stats.count("Asset Upload Batch"), 1u);
+    EXPECT_EQ(stats.at("Asset Upload Batch").count, 2u);
+    EXPECT_GT(stats.at("Asset Upload Batch").minMs, 0.0);
+
+    deferredReleaseQueue->ReleaseCompleted();
+}
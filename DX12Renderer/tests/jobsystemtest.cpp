@@ -0,0 +1,235 @@
+#include "jobsystem.h"
+#include "testing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Stress tests of the job system, also meant to be run in builds with RENDERER_SANITIZER set to thread and address.
+
+namespace {
+
+// Worker counts from all jobs on the creating thread to more workers than the hardware has.
+const uint32_t WorkerCounts[] = { 0, 1, 3, 7 };
+
+JobSystem::Settings GetSettings(uint32_t numWorkers) {
+    JobSystem::Settings settings;
+    settings.numWorkers = numWorkers;
+    // Small deques so they grow while thieves read them.
+    settings.dequeCapacity = 4;
+    return settings;
+}
+
+} // namespace
+
+TEST(JobSystem, ParallelForRunsEveryIterationOnce) {
+    for (uint32_t numWorkers : WorkerCounts) {
+        JobSystem jobSystem(GetSettings(numWorkers));
+        EXPECT_EQ(jobSystem.GetNumThreads(), numWorkers + 1);
+        EXPECT_EQ(jobSystem.GetThreadIndex(), 0u);
+
+        std::vector<uint32_t> counts(100003, 0);
+        for (int run = 0; run < 10; ++run) {
+            jobSystem.ParallelFor(static_cast<uint32_t>(counts.size()), 100, [&counts](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    ++counts[i];
+                }
+            });
+        }
+
+        uint32_t numWrong = 0;
+        for (uint32_t count : counts) {
+            numWrong += count != 10 ? 1 : 0;
+        }
+        EXPECT_EQ(numWrong, 0u);
+    }
+}
+
+TEST(JobSystem, JobsCanWaitForJobs) {
+    for (uint32_t numWorkers : WorkerCounts) {
+        JobSystem jobSystem(GetSettings(numWorkers));
+
+        std::atomic<uint32_t> numLeaves(0);
+        JobCounter outer;
+        for (int i = 0; i < 32; ++i) {
+            jobSystem.Run([&jobSystem, &numLeaves]() {
+                JobCounter inner;
+                for (int j = 0; j < 32; ++j) {
+                    jobSystem.Run([&numLeaves]() { numLeaves.fetch_add(1, std::memory_order_relaxed); }, &inner);
+                }
+                jobSystem.Wait(inner);
+            }, &outer);
+        }
+        jobSystem.Wait(outer);
+
+        EXPECT_EQ(numLeaves.load(), 32u * 32u);
+        EXPECT_TRUE(outer.IsDone());
+    }
+}
+
+TEST(JobSystem, DependentsRunAfterTheirDependency) {
+    for (uint32_t numWorkers : WorkerCounts) {
+        JobSystem jobSystem(GetSettings(numWorkers));
+
+        uint32_t numOutOfOrder = 0;
+        for (int run = 0; run < 500; ++run) {
+            JobCounter first;
+            JobCounter second;
+            JobCounter third;
+            std::atomic<int> numFirst(0);
+            // Plain values, the dependency orders the accesses.
+            int stage = 0;
+            bool inOrder = true;
+
+            for (int i = 0; i < 8; ++i) {
+                jobSystem.Run([&numFirst]() { numFirst.fetch_add(1, std::memory_order_relaxed); }, &first);
+            }
+            jobSystem.RunAfter(first, [&]() {
+                inOrder = inOrder && numFirst.load(std::memory_order_relaxed) == 8;
+                stage = 1;
+            }, &second);
+            jobSystem.RunAfter(second, [&]() {
+                inOrder = inOrder && stage == 1;
+                stage = 2;
+            }, &third);
+            jobSystem.Wait(third);
+
+            numOutOfOrder += inOrder && stage == 2 ? 0 : 1;
+        }
+        EXPECT_EQ(numOutOfOrder, 0u);
+    }
+}
+
+TEST(JobSystem, ThreadsOutsideTheJobSystemRunAndWait) {
+    for (uint32_t numWorkers : WorkerCounts) {
+        JobSystem jobSystem(GetSettings(numWorkers));
+        const JobSystem::Stats before = jobSystem.GetStats();
+
+        std::atomic<uint32_t> numIterations(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; ++i) {
+            threads.emplace_back([&jobSystem, &numIterations]() {
+                EXPECT_EQ(jobSystem.GetThreadIndex(), JobSystem::InvalidThreadIndex);
+                for (int run = 0; run < 100; ++run) {
+                    JobCounter counter;
+                    for (int j = 0; j < 10; ++j) {
+                        jobSystem.Run([&numIterations]() { numIterations.fetch_add(1, std::memory_order_relaxed); }, &counter);
+                    }
+                    jobSystem.Wait(counter);
+                }
+                jobSystem.ParallelFor(5000, 7, [&numIterations](uint32_t begin, uint32_t end) {
+                    numIterations.fetch_add(end - begin, std::memory_order_relaxed);
+                });
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(numIterations.load(), 3u * (1000u + 5000u));
+
+        // Every job has been waited for, the ones the outside threads ran themselves included.
+        const JobSystem::Stats stats = jobSystem.GetStats();
+        EXPECT_GE(stats.numJobs - before.numJobs, 3u * 1000u);
+        if (numWorkers == 0) {
+            // Nothing but the outside threads runs jobs while the creating thread is in join.
+            EXPECT_GE(stats.numJobs - before.numJobs, 3u * (1000u + 4999u / 7u));
+        }
+    }
+}
+
+TEST(JobSystem, StatsCountEveryJob) {
+    for (uint32_t numWorkers : WorkerCounts) {
+        JobSystem jobSystem(GetSettings(numWorkers));
+
+        // Run from an outside thread, which runs jobs in Wait too.
+        std::thread thread([&jobSystem]() {
+            JobCounter counter;
+            for (int i = 0; i < 1000; ++i) {
+                jobSystem.Run([]() {}, &counter);
+            }
+            jobSystem.Wait(counter);
+        });
+        thread.join();
+        EXPECT_EQ(jobSystem.GetStats().numJobs, 1000u);
+
+        JobCounter counter;
+        for (int i = 0; i < 500; ++i) {
+            jobSystem.Run([]() {}, &counter);
+        }
+        jobSystem.Wait(counter);
+        EXPECT_EQ(jobSystem.GetStats().numJobs, 1500u);
+    }
+}
+
+TEST(JobSystem, TheDestructorRunsTheJobsThatAreLeft) {
+    for (uint32_t numWorkers : WorkerCounts) {
+        std::atomic<uint32_t> numJobs(0);
+        {
+            // Outlives the job system, which finishes the jobs on it.
+            JobCounter dependency;
+            JobSystem jobSystem(GetSettings(numWorkers));
+            for (int i = 0; i < 1000; ++i) {
+                jobSystem.Run([&numJobs]() { numJobs.fetch_add(1, std::memory_order_relaxed); });
+            }
+            jobSystem.Run([]() { std::this_thread::yield(); }, &dependency);
+            jobSystem.RunAfter(dependency, [&numJobs]() { numJobs.fetch_add(1, std::memory_order_relaxed); });
+        }
+        EXPECT_EQ(numJobs.load(), 1001u);
+    }
+}
+
+#if defined(__linux__)
+TEST(JobSystem, PinningLeavesTheCreatingThreadAlone) {
+    cpu_set_t processors;
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(processors), &processors), 0);
+
+    const uint32_t numWorkers = 3;
+    // Per worker, the processor it is pinned to or -1 if it runs on more than one.
+    std::atomic<int> pinnedProcessors[numWorkers + 1];
+    std::atomic<bool> ranJob[numWorkers + 1];
+    for (uint32_t i = 0; i <= numWorkers; ++i) {
+        pinnedProcessors[i] = -1;
+        ranJob[i] = false;
+    }
+
+    {
+        JobSystem::Settings settings = GetSettings(numWorkers);
+        settings.pinThreads = true;
+        JobSystem jobSystem(settings);
+
+        cpu_set_t current;
+        ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(current), &current), 0);
+        EXPECT_TRUE(CPU_EQUAL(&current, &processors));
+
+        jobSystem.ParallelFor(10000, 1, [&](uint32_t, uint32_t) {
+            const uint32_t index = jobSystem.GetThreadIndex();
+            cpu_set_t affinity;
+            if (index > 0 && pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity) == 0 && CPU_COUNT(&affinity) == 1) {
+                for (int processor = 0; processor < CPU_SETSIZE; ++processor) {
+                    if (CPU_ISSET(processor, &affinity)) {
+                        pinnedProcessors[index] = processor;
+                    }
+                }
+            }
+            ranJob[index] = true;
+        });
+    }
+
+    cpu_set_t current;
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(current), &current), 0);
+    EXPECT_TRUE(CPU_EQUAL(&current, &processors));
+
+    // A worker can only be pinned to a processor the process may run on.
+    for (uint32_t i = 1; i <= numWorkers; ++i) {
+        if (ranJob[i] && CPU_ISSET(i, &processors)) {
+            EXPECT_EQ(pinnedProcessors[i].load(), static_cast<int>(i));
+        }
+    }
+}
+#endif
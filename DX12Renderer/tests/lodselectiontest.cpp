@@ -0,0 +1,61 @@
+#include "lodselection.h"
+#include "testing.h"
+
+#include <cstdint>
+
+namespace {
+
+// Errors of a chain where every level is off by four times the one before it.
+const float LodErrors[] = { 0.0f, 0.01f, 0.04f, 0.16f };
+const uint32_t NumLods = 4;
+
+} // namespace
+
+TEST(LodSelection, ProjectionScaleAndScreenSpaceError) {
+    const float projectionScale = ComputeLodProjectionScale(1.5707963f, 1000.0f);
+    EXPECT_NEAR(projectionScale, 500.0f, 1e-2f);
+
+    EXPECT_NEAR(ComputeScreenSpaceError(0.01f, 5.0f, projectionScale), 1.0f, 1e-5f);
+    EXPECT_NEAR(ComputeScreenSpaceError(0.01f, 10.0f, projectionScale), 0.5f, 1e-5f);
+    // Inside the bounds any error covers the screen.
+    EXPECT_GT(ComputeScreenSpaceError(0.01f, 0.0f, projectionScale), 1e30f);
+    EXPECT_EQ(ComputeScreenSpaceError(0.0f, 0.0f, projectionScale), 0.0f);
+}
+
+TEST(LodSelection, CoarserLevelsAreSelectedFurtherAway) {
+    const float projectionScale = 500.0f;
+
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 0.0f, projectionScale, 3), 0u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 1.0f, projectionScale, 0), 0u);
+    // Level 1 is off by 0.5 pixels at 10, level 2 by 2.
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 10.0f, projectionScale, 0), 1u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 1000.0f, projectionScale, 0), 3u);
+
+    uint32_t lod = 0;
+    for (float distance = 0.5f; distance < 1000.0f; distance *= 1.1f) {
+        const uint32_t next = SelectLod(LodErrors, NumLods, distance, projectionScale, lod);
+        ASSERT_GE(next, lod);
+        ASSERT_LE(ComputeScreenSpaceError(LodErrors[next], distance, projectionScale), 1.25f);
+        lod = next;
+    }
+    EXPECT_EQ(lod, 3u);
+}
+
+TEST(LodSelection, TheCurrentLevelIsKeptAroundTheThreshold) {
+    const float projectionScale = 500.0f;
+
+    // Level 1 is off by exactly the threshold of a pixel at 5.
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 5.0f, projectionScale, 0), 0u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 5.0f, projectionScale, 1), 1u);
+
+    // Coarsen once the error is a quarter below the threshold, refine once it is a quarter above.
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 6.0f, projectionScale, 0), 0u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 6.7f, projectionScale, 0), 1u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 4.1f, projectionScale, 1), 1u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 3.9f, projectionScale, 1), 0u);
+
+    // Without hysteresis the level follows the threshold both ways.
+    const LodSelectionSettings settings = { 1.0f, 0.0f };
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 5.0f, projectionScale, 0, settings), 1u);
+    EXPECT_EQ(SelectLod(LodErrors, NumLods, 4.9f, projectionScale, 1, settings), 0u);
+}
@@ -0,0 +1,86 @@
+#include "meshfile.h"
+#include "testing.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// A quad of two triangles with float positions, in a file in memory.
+std::vector<uint8_t> BuildQuad() {
+    const float positions[] = {
+        0.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, 0.0f,
+        1.0f, 1.0f, 0.0f,
+        0.0f, 1.0f, 0.0f
+    };
+    const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    const MeshFileAttribute position = { MeshSemantic::Position, 0, MeshAttributeFormat::R32G32B32_Float, 0 };
+
+    MeshFileBuilder builder;
+    builder.AddStream(&position, 1, 3 * sizeof(float), positions, 4);
+    builder.SetIndices(indices, 6);
+    builder.AddSubmesh(0, 6, MeshFileBuilder::ComputeBounds(positions, 3 * sizeof(float), indices, 6));
+    return builder.Build();
+}
+
+MeshFileHeader& GetHeader(std::vector<uint8_t>& file) {
+    return *reinterpret_cast<MeshFileHeader*>(file.data());
+}
+
+bool IsValid(const std::vector<uint8_t>& file) {
+    MeshFile meshFile;
+    return meshFile.Open(file.data(), file.size());
+}
+
+} // namespace
+
+TEST(MeshFile, BuiltFilesAreValid) {
+    std::vector<uint8_t> file = BuildQuad();
+
+    MeshFile meshFile;
+    ASSERT_TRUE(meshFile.Open(file.data(), file.size()));
+    EXPECT_EQ(meshFile.GetHeader().NumVertices, 4u);
+    EXPECT_EQ(meshFile.GetHeader().NumIndices, 6u);
+    EXPECT_EQ(meshFile.GetHeader().IndexSize, 2u);
+    EXPECT_EQ(meshFile.GetSubmesh(0).NumVertices, 4u);
+
+    float position[3];
+    std::memcpy(position, meshFile.GetStreamData(0) + 2 * sizeof(position), sizeof(position));
+    EXPECT_EQ(position[0], 1.0f);
+    EXPECT_EQ(position[1], 1.0f);
+}
+
+TEST(MeshFile, MisalignedSectionsAreRejected) {
+    const std::vector<uint8_t> valid = BuildQuad();
+
+    // Moved by a few bytes every section would still be in the file.
+    std::vector<uint8_t> file = valid;
+    file.resize(file.size() + 4);
+    GetHeader(file).DataOffset += 4;
+    EXPECT_FALSE(IsValid(file));
+
+    file = valid;
+    GetHeader(file).Streams[0].Offset += 4;
+    EXPECT_FALSE(IsValid(file));
+
+    file = valid;
+    GetHeader(file).IndexOffset -= 2;
+    EXPECT_FALSE(IsValid(file));
+
+    file = valid;
+    GetHeader(file).MeshletOffset = 4;
+    EXPECT_FALSE(IsValid(file));
+}
+
+TEST(MeshFile, IndicesOutOfTheVerticesAreRejected) {
+    std::vector<uint8_t> file = BuildQuad();
+    const MeshFileHeader& header = GetHeader(file);
+
+    uint16_t* indices = reinterpret_cast<uint16_t*>(file.data() + header.DataOffset + header.IndexOffset);
+    indices[5] = static_cast<uint16_t>(header.NumVertices - 1);
+    EXPECT_TRUE(IsValid(file));
+    indices[5] = static_cast<uint16_t>(header.NumVertices);
+    EXPECT_FALSE(IsValid(file));
+}
@@ -0,0 +1,230 @@
+#include "meshlet.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Mesh {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+};
+
+const float* GetPosition(const Mesh& mesh, uint32_t vertex) {
+    return &mesh.positions[3 * vertex];
+}
+
+// The unnormalized normal of the front face, clockwise in a left-handed space.
+std::array<float, 3> GetFaceNormal(const float* p0, const float* p1, const float* p2) {
+    const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    return { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+}
+
+float Dot(const std::array<float, 3>& a, const float* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// A unit sphere of rings and segments whose front faces are on the outside. The triangles
+// are in tiles of a few rings and segments, as after optimizing for the vertex cache.
+Mesh CreateSphere(uint32_t numRings, uint32_t numSegments) {
+    const float pi = 3.14159265f;
+
+    Mesh mesh;
+    for (uint32_t ring = 0; ring <= numRings; ++ring) {
+        const float theta = pi * ring / numRings;
+        for (uint32_t segment = 0; segment <= numSegments; ++segment) {
+            const float phi = 2.0f * pi * segment / numSegments;
+            mesh.positions.push_back(std::sin(theta) * std::cos(phi));
+            mesh.positions.push_back(std::cos(theta));
+            mesh.positions.push_back(std::sin(theta) * std::sin(phi));
+        }
+    }
+
+    auto addTriangle = [&mesh](uint32_t a, uint32_t b, uint32_t c) {
+        const float* p0 = GetPosition(mesh, a);
+        std::array<float, 3> normal = GetFaceNormal(p0, GetPosition(mesh, b), GetPosition(mesh, c));
+        const float area = Dot(normal, normal.data());
+        if (area < 1e-12f) {
+            return;
+        }
+        if (Dot(normal, p0) < 0.0f) {
+            std::swap(b, c);
+        }
+        mesh.indices.insert(mesh.indices.end(), { a, b, c });
+    };
+
+    const uint32_t rowSize = numSegments + 1;
+    const uint32_t tileSize = 4;
+    for (uint32_t tileRing = 0; tileRing < numRings; tileRing += tileSize) {
+        for (uint32_t tileSegment = 0; tileSegment < numSegments; tileSegment += tileSize) {
+            for (uint32_t ring = tileRing; ring < std::min(tileRing + tileSize, numRings); ++ring) {
+                for (uint32_t segment = tileSegment; segment < std::min(tileSegment + tileSize, numSegments); ++segment) {
+                    const uint32_t v0 = ring * rowSize + segment;
+                    const uint32_t v1 = v0 + rowSize;
+                    addTriangle(v0, v1, v1 + 1);
+                    addTriangle(v0, v1 + 1, v0 + 1);
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+struct Meshlets {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint32_t> triangles;
+};
+
+Meshlets Build(const Mesh& mesh, uint32_t maxVertices = MaxMeshletVertices, uint32_t maxTriangles = MaxMeshletTriangles) {
+    Meshlets result;
+    BuildMeshlets(result.meshlets, result.vertices, result.triangles, mesh.indices.data(), mesh.indices.size(),
+        mesh.positions.size() / 3, maxVertices, maxTriangles);
+    return result;
+}
+
+// The vertex indices of a triangle of a meshlet.
+std::array<uint32_t, 3> GetTriangle(const Meshlets& meshlets, const Meshlet& meshlet, uint32_t triangle) {
+    uint32_t local[3];
+    UnpackMeshletTriangle(meshlets.triangles[meshlet.triangleOffset + triangle], local);
+    return {
+        meshlets.vertices[meshlet.vertexOffset + local[0]],
+        meshlets.vertices[meshlet.vertexOffset + local[1]],
+        meshlets.vertices[meshlet.vertexOffset + local[2]]
+    };
+}
+
+} // namespace
+
+TEST(Meshlet, EveryTriangleIsInExactlyOneMeshlet) {
+    Mesh mesh = CreateSphere(24, 48);
+    // A degenerate triangle is dropped.
+    mesh.indices.insert(mesh.indices.end(), { 5, 5, 6 });
+
+    const Meshlets meshlets = Build(mesh);
+
+    std::vector< std::array<uint32_t, 3> > expected;
+    for (size_t i = 0; i + 3 < mesh.indices.size(); i += 3) {
+        expected.push_back({ mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] });
+    }
+    std::vector< std::array<uint32_t, 3> > triangles;
+    for (const Meshlet& meshlet : meshlets.meshlets) {
+        for (uint32_t i = 0; i < meshlet.numTriangles; ++i) {
+            triangles.push_back(GetTriangle(meshlets, meshlet, i));
+        }
+    }
+
+    // The winding is kept, so the triangles are compared as they are.
+    std::sort(expected.begin(), expected.end());
+    std::sort(triangles.begin(), triangles.end());
+    EXPECT_TRUE(triangles == expected);
+}
+
+TEST(Meshlet, MeshletsStayWithinTheLimits) {
+    const Mesh mesh = CreateSphere(24, 48);
+
+    const uint32_t limits[][2] = { { MaxMeshletVertices, MaxMeshletTriangles }, { 32, 40 }, { 3, 1 }, { 256, 255 } };
+    for (const uint32_t* limit : limits) {
+        const Meshlets meshlets = Build(mesh, limit[0], limit[1]);
+
+        size_t numTriangles = 0;
+        for (const Meshlet& meshlet : meshlets.meshlets) {
+            ASSERT_GT(meshlet.numTriangles, 0u);
+            ASSERT_LE(meshlet.numVertices, limit[0]);
+            ASSERT_LE(meshlet.numTriangles, limit[1]);
+            ASSERT_LE(meshlet.vertexOffset + meshlet.numVertices, meshlets.vertices.size());
+            ASSERT_LE(meshlet.triangleOffset + meshlet.numTriangles, meshlets.triangles.size());
+
+            for (uint32_t i = 0; i < meshlet.numTriangles; ++i) {
+                uint32_t local[3];
+                UnpackMeshletTriangle(meshlets.triangles[meshlet.triangleOffset + i], local);
+                for (uint32_t index : local) {
+                    ASSERT_LT(index, meshlet.numVertices);
+                }
+            }
+            numTriangles += meshlet.numTriangles;
+        }
+        EXPECT_EQ(numTriangles, mesh.indices.size() / 3);
+    }
+}
+
+TEST(Meshlet, BoundingSpheresContainTheVertices) {
+    const Mesh mesh = CreateSphere(24, 48);
+    const Meshlets meshlets = Build(mesh);
+
+    for (const Meshlet& meshlet : meshlets.meshlets) {
+        const MeshletBounds bounds = ComputeMeshletBounds(meshlet, meshlets.vertices.data(), meshlets.triangles.data(),
+            mesh.positions.data(), 3 * sizeof(float));
+
+        for (uint32_t i = 0; i < meshlet.numVertices; ++i) {
+            const float* position = GetPosition(mesh, meshlets.vertices[meshlet.vertexOffset + i]);
+            const float offset[3] = {
+                position[0] - bounds.center[0], position[1] - bounds.center[1], position[2] - bounds.center[2]
+            };
+            const float distance = std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+            ASSERT_LE(distance, bounds.radius * (1.0f + 1e-5f));
+        }
+    }
+}
+
+TEST(Meshlet, ConeCullingNeverRejectsAFrontFacingTriangle) {
+    const Mesh mesh = CreateSphere(24, 48);
+    const Meshlets meshlets = Build(mesh);
+
+    std::vector<MeshletBounds> bounds;
+    for (const Meshlet& meshlet : meshlets.meshlets) {
+        bounds.push_back(ComputeMeshletBounds(meshlet, meshlets.vertices.data(), meshlets.triangles.data(),
+            mesh.positions.data(), 3 * sizeof(float)));
+    }
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> coordinate(-4.0f, 4.0f);
+
+    uint32_t numCulled = 0;
+    uint32_t numTested = 0;
+    for (int camera = 0; camera < 200; ++camera) {
+        const float cameraPosition[3] = { coordinate(random), coordinate(random), coordinate(random) };
+
+        for (size_t i = 0; i < meshlets.meshlets.size(); ++i) {
+            const Meshlet& meshlet = meshlets.meshlets[i];
+            ++numTested;
+            if (!IsMeshletBackFacing(bounds[i], cameraPosition)) {
+                continue;
+            }
+            ++numCulled;
+
+            for (uint32_t j = 0; j < meshlet.numTriangles; ++j) {
+                const std::array<uint32_t, 3> triangle = GetTriangle(meshlets, meshlet, j);
+                const float* p0 = GetPosition(mesh, triangle[0]);
+                const std::array<float, 3> normal = GetFaceNormal(p0, GetPosition(mesh, triangle[1]), GetPosition(mesh, triangle[2]));
+                const float toCamera[3] = { cameraPosition[0] - p0[0], cameraPosition[1] - p0[1], cameraPosition[2] - p0[2] };
+                ASSERT_LE(Dot(normal, toCamera), 0.0f);
+            }
+        }
+    }
+
+    // The test is conservative, but a good part of the far side is culled.
+    EXPECT_GT(numCulled, numTested / 10);
+}
+
+TEST(Meshlet, BackFacingFromBehindAndNotFromTheFront) {
+    const Mesh mesh = CreateSphere(24, 48);
+    const Meshlets meshlets = Build(mesh);
+
+    // The first meshlet is a patch around the top pole, whose front faces look up.
+    const MeshletBounds bounds = ComputeMeshletBounds(meshlets.meshlets[0], meshlets.vertices.data(), meshlets.triangles.data(),
+        mesh.positions.data(), 3 * sizeof(float));
+    EXPECT_GT(bounds.coneAxis[1], 0.9f);
+    EXPECT_LT(bounds.coneCutoff, 1.0f);
+
+    const float above[3] = { 0.0f, 3.0f, 0.0f };
+    const float below[3] = { 0.0f, -3.0f, 0.0f };
+    EXPECT_FALSE(IsMeshletBackFacing(bounds, above));
+    EXPECT_TRUE(IsMeshletBackFacing(bounds, below));
+}
@@ -0,0 +1,167 @@
+#include "meshoptimizer.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Vertex {
+    float position[3];
+    uint32_t id;
+};
+
+// A regular grid of quads with the triangles in random order, and the vertices too.
+// The last vertex is not referenced by any triangle.
+struct ShuffledGrid {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+ShuffledGrid BuildShuffledGrid(uint32_t numQuads) {
+    const uint32_t size = numQuads + 1;
+    std::mt19937 random(42);
+
+    std::vector<uint32_t> vertexOrder(size * size);
+    for (uint32_t i = 0; i < vertexOrder.size(); ++i) {
+        vertexOrder[i] = i;
+    }
+    std::shuffle(vertexOrder.begin(), vertexOrder.end(), random);
+
+    ShuffledGrid grid;
+    grid.vertices.resize(size * size + 1);
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            // A bump, so some triangles face other directions than others.
+            const float dx = x / float(numQuads) - 0.5f;
+            const float dy = y / float(numQuads) - 0.5f;
+            Vertex& vertex = grid.vertices[vertexOrder[y * size + x]];
+            vertex.position[0] = float(x);
+            vertex.position[1] = float(y);
+            vertex.position[2] = 4.0f * (0.25f - dx * dx - dy * dy);
+            vertex.id = y * size + x;
+        }
+    }
+    grid.vertices.back() = Vertex{ { -1.0f, -1.0f, -1.0f }, ~0u };
+
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < numQuads; ++y) {
+        for (uint32_t x = 0; x < numQuads; ++x) {
+            const uint32_t v0 = vertexOrder[y * size + x];
+            const uint32_t v1 = vertexOrder[y * size + x + 1];
+            const uint32_t v2 = vertexOrder[(y + 1) * size + x];
+            const uint32_t v3 = vertexOrder[(y + 1) * size + x + 1];
+            triangles.push_back({ v0, v1, v3 });
+            triangles.push_back({ v0, v3, v2 });
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    for (const std::array<uint32_t, 3>& triangle : triangles) {
+        grid.indices.insert(grid.indices.end(), triangle.begin(), triangle.end());
+    }
+    return grid;
+}
+
+// The triangles as sorted keys, each rotated to start at its smallest vertex so the winding is kept.
+std::vector<std::array<uint32_t, 3>> GetSortedTriangles(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices) {
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        std::array<uint32_t, 3> triangle = { vertices[indices[i]].id, vertices[indices[i + 1]].id, vertices[indices[i + 2]].id };
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+} // namespace
+
+TEST(MeshOptimizer, VertexCacheOptimizationReordersTrianglesAndLowersTheACMR) {
+    const ShuffledGrid grid = BuildShuffledGrid(40);
+    const size_t numIndices = grid.indices.size();
+    const size_t numVertices = grid.vertices.size();
+    ASSERT_EQ(numIndices, 3u * 3200u);
+
+    const VertexCacheStatistics before = AnalyzeVertexCache(grid.indices.data(), numIndices, numVertices);
+    EXPECT_GT(before.acmr, 2.5f);
+
+    std::vector<uint32_t> optimized(numIndices);
+    OptimizeVertexCache(optimized.data(), grid.indices.data(), numIndices, numVertices);
+    EXPECT_TRUE(GetSortedTriangles(optimized, grid.vertices) == GetSortedTriangles(grid.indices, grid.vertices));
+
+    // About 0.69 for this grid, from 2.98 before, 0.5 is the limit for an infinite one.
+    const VertexCacheStatistics after = AnalyzeVertexCache(optimized.data(), numIndices, numVertices);
+    EXPECT_LT(after.acmr, 0.8f);
+    EXPECT_GT(after.acmr, 0.5f);
+    EXPECT_LT(after.atvr, 1.5f);
+
+    // In place gives the same order.
+    std::vector<uint32_t> inPlace = grid.indices;
+    OptimizeVertexCache(inPlace.data(), inPlace.data(), numIndices, numVertices);
+    EXPECT_TRUE(inPlace == optimized);
+}
+
+TEST(MeshOptimizer, OverdrawOptimizationKeepsTheTrianglesAndMostOfTheCacheEfficiency) {
+    const ShuffledGrid grid = BuildShuffledGrid(40);
+    const size_t numIndices = grid.indices.size();
+    const size_t numVertices = grid.vertices.size();
+
+    std::vector<uint32_t> cacheOptimized(numIndices);
+    OptimizeVertexCache(cacheOptimized.data(), grid.indices.data(), numIndices, numVertices);
+    const float cacheOptimizedAcmr = AnalyzeVertexCache(cacheOptimized.data(), numIndices, numVertices).acmr;
+
+    std::vector<uint32_t> optimized(numIndices);
+    OptimizeOverdraw(optimized.data(), cacheOptimized.data(), numIndices, grid.vertices.data(), sizeof(Vertex), numVertices);
+    EXPECT_TRUE(GetSortedTriangles(optimized, grid.vertices) == GetSortedTriangles(grid.indices, grid.vertices));
+
+    // Clusters are split where the ACMR rises by less than the threshold, and their boundaries cost a little more.
+    const float acmr = AnalyzeVertexCache(optimized.data(), numIndices, numVertices).acmr;
+    EXPECT_LT(acmr, cacheOptimizedAcmr * DefaultOverdrawThreshold + 0.05f);
+}
+
+TEST(MeshOptimizer, VertexFetchRemapReproducesTheTriangles) {
+    const ShuffledGrid grid = BuildShuffledGrid(40);
+    const size_t numIndices = grid.indices.size();
+    const size_t numVertices = grid.vertices.size();
+
+    std::vector<uint32_t> indices(numIndices);
+    OptimizeVertexCache(indices.data(), grid.indices.data(), numIndices, numVertices);
+    const VertexFetchStatistics before = AnalyzeVertexFetch(indices.data(), numIndices, numVertices, sizeof(Vertex));
+
+    std::vector<uint32_t> remap(numVertices);
+    const size_t numRemapped = GenerateVertexFetchRemap(remap.data(), indices.data(), numIndices, numVertices);
+    // The unreferenced vertex is dropped.
+    ASSERT_EQ(numRemapped, numVertices - 1);
+    EXPECT_EQ(remap.back(), ~0u);
+
+    std::vector<uint32_t> remappedIndices(numIndices);
+    RemapIndexBuffer(remappedIndices.data(), indices.data(), numIndices, remap.data());
+    std::vector<Vertex> remappedVertices(numRemapped);
+    RemapVertexBuffer(remappedVertices.data(), grid.vertices.data(), numVertices, sizeof(Vertex), remap.data());
+
+    // The same triangles in the same order, with the same vertex data.
+    for (size_t i = 0; i < numIndices; ++i) {
+        ASSERT_LT(remappedIndices[i], numRemapped);
+        const Vertex& original = grid.vertices[indices[i]];
+        const Vertex& remapped = remappedVertices[remappedIndices[i]];
+        ASSERT_EQ(remapped.id, original.id);
+        ASSERT_EQ(std::memcmp(remapped.position, original.position, sizeof(original.position)), 0);
+    }
+
+    // Vertices are numbered in the order of their first use.
+    uint32_t nextVertex = 0;
+    for (uint32_t index : remappedIndices) {
+        ASSERT_LE(index, nextVertex);
+        if (index == nextVertex) {
+            ++nextVertex;
+        }
+    }
+    EXPECT_EQ(nextVertex, numRemapped);
+
+    const VertexFetchStatistics after = AnalyzeVertexFetch(remappedIndices.data(), numIndices, numRemapped, sizeof(Vertex));
+    EXPECT_LT(after.overfetch, before.overfetch);
+}
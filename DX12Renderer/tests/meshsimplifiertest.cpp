@@ -0,0 +1,188 @@
+#include "meshsimplifier.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+struct Mesh {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+
+    size_t GetNumVertices() const {
+        return positions.size() / 3;
+    }
+};
+
+struct Vector3 {
+    float x, y, z;
+};
+
+Vector3 GetPosition(const Mesh& mesh, uint32_t vertex) {
+    return Vector3{ mesh.positions[3 * vertex], mesh.positions[3 * vertex + 1], mesh.positions[3 * vertex + 2] };
+}
+
+// The unnormalized normal of the front face, clockwise in a left-handed space.
+Vector3 GetFaceNormal(const Vector3& p0, const Vector3& p1, const Vector3& p2) {
+    const Vector3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+    const Vector3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+    return Vector3{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+}
+
+float Dot(const Vector3& a, const Vector3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// A square of quads in the xy plane, with front faces towards -z.
+Mesh CreateGrid(uint32_t numQuads) {
+    Mesh mesh;
+    for (uint32_t y = 0; y <= numQuads; ++y) {
+        for (uint32_t x = 0; x <= numQuads; ++x) {
+            mesh.positions.insert(mesh.positions.end(), { static_cast<float>(x), static_cast<float>(y), 0.0f });
+        }
+    }
+    for (uint32_t y = 0; y < numQuads; ++y) {
+        for (uint32_t x = 0; x < numQuads; ++x) {
+            const uint32_t v0 = y * (numQuads + 1) + x;
+            const uint32_t v1 = v0 + numQuads + 1;
+            mesh.indices.insert(mesh.indices.end(), { v0, v1, v1 + 1, v0, v1 + 1, v0 + 1 });
+        }
+    }
+    return mesh;
+}
+
+// A closed unit sphere without seams, with front faces on the outside.
+Mesh CreateSphere(uint32_t numRings, uint32_t numSegments) {
+    const float pi = 3.14159265f;
+
+    Mesh mesh;
+    mesh.positions.insert(mesh.positions.end(), { 0.0f, 1.0f, 0.0f });
+    for (uint32_t ring = 1; ring < numRings; ++ring) {
+        const float theta = pi * ring / numRings;
+        for (uint32_t segment = 0; segment < numSegments; ++segment) {
+            const float phi = 2.0f * pi * segment / numSegments;
+            mesh.positions.insert(mesh.positions.end(),
+                { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+        }
+    }
+    mesh.positions.insert(mesh.positions.end(), { 0.0f, -1.0f, 0.0f });
+    const uint32_t bottom = static_cast<uint32_t>(mesh.GetNumVertices() - 1);
+
+    auto addTriangle = [&mesh](uint32_t a, uint32_t b, uint32_t c) {
+        const Vector3 p0 = GetPosition(mesh, a);
+        if (Dot(GetFaceNormal(p0, GetPosition(mesh, b), GetPosition(mesh, c)), p0) < 0.0f) {
+            std::swap(b, c);
+        }
+        mesh.indices.insert(mesh.indices.end(), { a, b, c });
+    };
+    auto ringVertex = [numSegments](uint32_t ring, uint32_t segment) {
+        return 1 + (ring - 1) * numSegments + segment % numSegments;
+    };
+
+    for (uint32_t segment = 0; segment < numSegments; ++segment) {
+        addTriangle(0, ringVertex(1, segment), ringVertex(1, segment + 1));
+        addTriangle(bottom, ringVertex(numRings - 1, segment), ringVertex(numRings - 1, segment + 1));
+        for (uint32_t ring = 1; ring + 1 < numRings; ++ring) {
+            addTriangle(ringVertex(ring, segment), ringVertex(ring + 1, segment), ringVertex(ring + 1, segment + 1));
+            addTriangle(ringVertex(ring, segment), ringVertex(ring + 1, segment + 1), ringVertex(ring, segment + 1));
+        }
+    }
+    return mesh;
+}
+
+std::vector<uint32_t> Simplify(const Mesh& mesh, size_t targetNumIndices, float targetError, float& error) {
+    std::vector<uint32_t> indices(mesh.indices.size());
+    indices.resize(SimplifyMesh(indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(),
+        3 * sizeof(float), mesh.GetNumVertices(), targetNumIndices, targetError, &error));
+    return indices;
+}
+
+} // namespace
+
+TEST(MeshSimplifier, FlatSurfacesCollapseWithoutError) {
+    const Mesh mesh = CreateGrid(16);
+
+    float error = -1.0f;
+    std::vector<uint32_t> indices = Simplify(mesh, 0, 1e-6f, error);
+
+    EXPECT_LT(indices.size(), mesh.indices.size() / 4);
+    EXPECT_LE(error, 1e-6f);
+
+    // Nothing flips and the border holds, so the triangles still cover the square once.
+    float area = 0.0f;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const Vector3 normal = GetFaceNormal(GetPosition(mesh, indices[i]), GetPosition(mesh, indices[i + 1]),
+            GetPosition(mesh, indices[i + 2]));
+        ASSERT_LT(normal.z, 0.0f);
+        area -= 0.5f * normal.z;
+    }
+    EXPECT_NEAR(area, 256.0f, 1e-3f);
+}
+
+TEST(MeshSimplifier, TheErrorStaysWithinTheTarget) {
+    const Mesh mesh = CreateSphere(32, 64);
+
+    size_t previousNumIndices = mesh.indices.size();
+    for (float targetError : { 0.001f, 0.01f, 0.05f, 0.2f }) {
+        float error = -1.0f;
+        std::vector<uint32_t> indices = Simplify(mesh, 0, targetError, error);
+
+        EXPECT_GT(error, 0.0f);
+        EXPECT_LE(error, targetError);
+        // A larger error allows more collapses.
+        EXPECT_LE(indices.size(), previousNumIndices);
+        previousNumIndices = indices.size();
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const Vector3 p0 = GetPosition(mesh, indices[i]);
+            ASSERT_GT(Dot(GetFaceNormal(p0, GetPosition(mesh, indices[i + 1]), GetPosition(mesh, indices[i + 2])), p0), 0.0f);
+        }
+    }
+    EXPECT_LT(previousNumIndices, mesh.indices.size() / 10);
+}
+
+TEST(MeshSimplifier, TheErrorBoundsTheLargestDeviation) {
+    const Mesh mesh = CreateSphere(32, 64);
+
+    for (size_t targetNumIndices : { mesh.indices.size() / 2, mesh.indices.size() / 8, mesh.indices.size() / 32 }) {
+        float error = -1.0f;
+        std::vector<uint32_t> indices = Simplify(mesh, targetNumIndices, FLT_MAX, error);
+        ASSERT_LE(indices.size(), targetNumIndices);
+
+        // The vertices stay on the sphere, the triangles between them cut into it. The middle of a
+        // triangle is as far from the sphere as it gets, a small triangle of the input lies there.
+        float deviation = 0.0f;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const Vector3 p0 = GetPosition(mesh, indices[i]);
+            const Vector3 p1 = GetPosition(mesh, indices[i + 1]);
+            const Vector3 p2 = GetPosition(mesh, indices[i + 2]);
+            const Vector3 center = { (p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f };
+            deviation = std::max(deviation, 1.0f - std::sqrt(Dot(center, center)));
+        }
+
+        // The faceting of the input is about 1 - cos(pi / 64).
+        EXPECT_LE(deviation, error + 0.002f);
+    }
+}
+
+TEST(MeshSimplifier, TheTargetCountIsMet) {
+    const Mesh mesh = CreateSphere(16, 32);
+
+    float error = 0.0f;
+    std::vector<uint32_t> indices = Simplify(mesh, 300, FLT_MAX, error);
+    EXPECT_LE(indices.size(), 300u);
+    EXPECT_GT(indices.size(), 0u);
+    EXPECT_EQ(indices.size() % 3, 0u);
+    for (uint32_t index : indices) {
+        ASSERT_LT(index, mesh.GetNumVertices());
+    }
+
+    // Nothing to do.
+    indices = Simplify(mesh, mesh.indices.size(), FLT_MAX, error);
+    EXPECT_EQ(indices.size(), mesh.indices.size());
+    EXPECT_EQ(error, 0.0f);
+}
@@ -0,0 +1,334 @@
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "dynamicdescriptorheap.h"
+#include "jobsystem.h"
+#include "parallelcommandrecorder.h"
+#include "rendergraph.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+// Every item is recorded as a timestamp query followed by a draw. The null queue advances its
+// clock for every draw, so the timestamps of the items increase in the order they are executed.
+
+namespace {
+
+std::shared_ptr<JobSystem> CreateJobSystem(uint32_t numWorkers) {
+    JobSystem::Settings settings;
+    settings.numWorkers = numWorkers;
+    return std::make_shared<JobSystem>(settings);
+}
+
+ParallelCommandRecorder::InheritedState GetInheritedState(RHIRootSignature* rootSignature) {
+    ParallelCommandRecorder::InheritedState state = {};
+    state.viewport = RHIViewport{ 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+    state.scissorRect = RHIRect{ 0, 0, 1280, 720 };
+    state.numRenderTargets = 1;
+    state.renderTargets[0] = RHICPUDescriptorHandle{ 1 };
+    state.rootSignature = rootSignature;
+    return state;
+}
+
+void RecordItem(RHICommandList* commandList, RHIQueryHeap* queryHeap, uint32_t query) {
+    commandList->EndQuery(queryHeap, query);
+    commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+}
+
+std::vector<NullRHICommandType> GetCommandTypes(const NullRHICommandList& commandList) {
+    std::vector<NullRHICommandType> types;
+    const std::vector<uint8_t>& data = commandList.GetCommandData();
+    for (size_t offset = 0; offset < data.size(); ) {
+        const NullRHICommandHeader* header = reinterpret_cast<const NullRHICommandHeader*>(data.data() + offset);
+        types.push_back(header->Type);
+        offset += header->Size;
+    }
+    return types;
+}
+
+} // namespace
+
+TEST(ParallelCommandRecorder, ItemsAreExecutedOnceInOrder) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    NullRHIRootSignature rootSignature;
+
+    const uint32_t count = 1000;
+    // Query 0 is recorded before the pass, the items follow and the last query is recorded after it.
+    auto queryHeap = device->CreateQueryHeap(RHIQueryHeapType::Timestamp, count + 2);
+    const uint64_t* timestamps = static_cast<NullRHIQueryHeap*>(queryHeap.get())->GetData();
+
+    for (uint32_t numWorkers : { 0u, 3u }) {
+        auto jobSystem = CreateJobSystem(numWorkers);
+        ParallelCommandRecorder recorder(commandQueue, jobSystem);
+
+        std::vector< std::atomic<uint32_t> > numRecorded(count);
+        for (std::atomic<uint32_t>& n : numRecorded) {
+            n = 0;
+        }
+
+        recorder.Begin();
+        RecordItem(recorder.GetCommandList(), queryHeap.get(), 0);
+        recorder.RecordParallel(GetInheritedState(&rootSignature), count, 10,
+            [&](RHICommandList* commandList, DynamicDescriptorHeap*, uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    RecordItem(commandList, queryHeap.get(), i + 1);
+                    ++numRecorded[i];
+                }
+            });
+        RecordItem(recorder.GetCommandList(), queryHeap.get(), count + 1);
+
+        // The list before the pass, a chunk per thread and the list after it.
+        EXPECT_EQ(recorder.GetNumCommandLists(), jobSystem->GetNumThreads() == 1 ? 1u : jobSystem->GetNumThreads() + 2);
+
+        commandQueue->WaitForFenceValue(recorder.Execute());
+
+        for (uint32_t i = 0; i < count; ++i) {
+            ASSERT_EQ(numRecorded[i].load(), 1u);
+        }
+        for (uint32_t query = 0; query <= count; ++query) {
+            ASSERT_LT(timestamps[query], timestamps[query + 1]);
+        }
+    }
+}
+
+TEST(ParallelCommandRecorder, SmallPassesAreRecordedInPlace) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    auto jobSystem = CreateJobSystem(3);
+    ParallelCommandRecorder recorder(commandQueue, jobSystem);
+
+    recorder.Begin();
+    RHICommandList* commandList = recorder.GetCommandList();
+
+    // Fewer items than two command lists need.
+    std::vector<RHICommandList*> recordedOn;
+    recorder.RecordParallel(GetInheritedState(nullptr), 100, 64,
+        [&](RHICommandList* chunkCommandList, DynamicDescriptorHeap*, uint32_t begin, uint32_t end) {
+            recordedOn.push_back(chunkCommandList);
+            EXPECT_EQ(begin, 0u);
+            EXPECT_EQ(end, 100u);
+        });
+    // Nothing to record.
+    recorder.RecordParallel(GetInheritedState(nullptr), 0, 1, [&](RHICommandList*, DynamicDescriptorHeap*, uint32_t, uint32_t) {
+        recordedOn.push_back(nullptr);
+    });
+
+    ASSERT_EQ(recordedOn.size(), 1u);
+    EXPECT_EQ(recordedOn[0], commandList);
+    EXPECT_EQ(recorder.GetNumCommandLists(), 1u);
+    EXPECT_EQ(recorder.GetCommandList(), commandList);
+
+    commandQueue->WaitForFenceValue(recorder.Execute());
+}
+
+TEST(ParallelCommandRecorder, EveryChunkStartsWithTheInheritedState) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    auto jobSystem = CreateJobSystem(3);
+    ParallelCommandRecorder recorder(commandQueue, jobSystem);
+    NullRHIRootSignature rootSignature;
+    RHIDescriptorHeapDesc descriptorHeapDesc;
+    descriptorHeapDesc.NumDescriptors = 16;
+    descriptorHeapDesc.ShaderVisible = true;
+    auto descriptorHeap = device->CreateDescriptorHeap(descriptorHeapDesc);
+
+    ParallelCommandRecorder::InheritedState state = GetInheritedState(&rootSignature);
+    state.numDescriptorHeaps = 1;
+    state.descriptorHeaps[0] = descriptorHeap.get();
+
+    // The commands found on the chunks when their record function is called, by first item.
+    std::map< uint32_t, std::vector<NullRHICommandType> > chunkCommands;
+    std::map<uint32_t, uint32_t> chunkEnds;
+    std::mutex mutex;
+
+    recorder.Begin();
+    recorder.RecordParallel(state, 10, 2, [&](RHICommandList* commandList, DynamicDescriptorHeap*, uint32_t begin, uint32_t end) {
+        std::vector<NullRHICommandType> types = GetCommandTypes(*static_cast<NullRHICommandList*>(commandList));
+        std::lock_guard<std::mutex> lock(mutex);
+        chunkCommands[begin] = std::move(types);
+        chunkEnds[begin] = end;
+    });
+    commandQueue->WaitForFenceValue(recorder.Execute());
+
+    // One chunk per thread, the items are spread evenly over them.
+    ASSERT_EQ(chunkCommands.size(), 4u);
+    uint32_t next = 0;
+    for (const auto& chunk : chunkEnds) {
+        EXPECT_EQ(chunk.first, next);
+        EXPECT_GE(chunk.second - chunk.first, 2u);
+        EXPECT_LE(chunk.second - chunk.first, 3u);
+        next = chunk.second;
+    }
+    EXPECT_EQ(next, 10u);
+
+    const std::vector<NullRHICommandType> expected = {
+        NullRHICommandType::SetDescriptorHeaps,
+        NullRHICommandType::SetGraphicsRootSignature,
+        NullRHICommandType::RSSetViewport,
+        NullRHICommandType::RSSetScissorRect,
+        NullRHICommandType::OMSetRenderTargets
+    };
+    for (const auto& chunk : chunkCommands) {
+        EXPECT_TRUE(chunk.second == expected);
+    }
+}
+
+TEST(ParallelCommandRecorder, EveryCommandListStagesOnADynamicDescriptorHeapOfItsOwn) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, std::make_shared<ResourceStateMap>());
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ commandQueue });
+    auto jobSystem = CreateJobSystem(3);
+    NullRHIRootSignature rootSignature;
+
+    const uint32_t numBlocks = 16;
+    auto ring = std::make_shared<DynamicDescriptorRing>(device, deferredReleaseQueue, RHIDescriptorHeapType::CbvSrvUav,
+        numBlocks * 8, 8);
+    uint32_t numHeapsCreated = 0;
+    ParallelCommandRecorder recorder(commandQueue, jobSystem, [&]() {
+        ++numHeapsCreated;
+        return std::make_shared<DynamicDescriptorHeap>(device, ring, nullptr);
+    });
+
+    RHIDescriptorHeapDesc sourceHeapDesc;
+    sourceHeapDesc.NumDescriptors = 4;
+    auto sourceHeap = device->CreateDescriptorHeap(sourceHeapDesc);
+    const uint32_t descriptorSize = device->GetDescriptorHandleIncrementSize(RHIDescriptorHeapType::CbvSrvUav);
+
+    // A table of one descriptor, staged for every draw.
+    const DynamicDescriptorHeap::DescriptorTableLayout table = { 1, RHIDescriptorHeapType::CbvSrvUav, 1 };
+    ParallelCommandRecorder::InheritedState state = GetInheritedState(&rootSignature);
+    state.descriptorTables = &table;
+    state.numDescriptorTables = 1;
+
+    for (int frame = 0; frame < 3; ++frame) {
+        std::map<uint32_t, DynamicDescriptorHeap*> chunkHeaps;
+        std::map< uint32_t, std::vector<NullRHICommandType> > chunkCommands;
+        std::mutex mutex;
+
+        recorder.Begin();
+        DynamicDescriptorHeap* firstHeap = recorder.GetDynamicDescriptorHeap();
+        recorder.RecordParallel(state, 8, 2,
+            [&](RHICommandList* commandList, DynamicDescriptorHeap* dynamicDescriptorHeap, uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i) {
+                    RHICPUDescriptorHandle descriptor = sourceHeap->GetCPUDescriptorHandleForHeapStart();
+                    descriptor.ptr += static_cast<size_t>(i % 4) * descriptorSize;
+                    dynamicDescriptorHeap->StageDescriptors(1, 0, 1, descriptor);
+                    dynamicDescriptorHeap->CommitStagedDescriptorsForDraw(commandList);
+                    commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+                }
+                std::vector<NullRHICommandType> types = GetCommandTypes(*static_cast<NullRHICommandList*>(commandList));
+                std::lock_guard<std::mutex> lock(mutex);
+                chunkHeaps[begin] = dynamicDescriptorHeap;
+                chunkCommands[begin] = std::move(types);
+            });
+        DynamicDescriptorHeap* lastHeap = recorder.GetDynamicDescriptorHeap();
+
+        // Each chunk and each serial command list has a heap of its own.
+        ASSERT_EQ(chunkHeaps.size(), 4u);
+        std::set<DynamicDescriptorHeap*> heaps = { firstHeap, lastHeap };
+        for (const auto& chunk : chunkHeaps) {
+            heaps.insert(chunk.second);
+        }
+        EXPECT_EQ(heaps.size(), 6u);
+        EXPECT_EQ(heaps.count(nullptr), 0u);
+
+        // The ring heap is bound before the root signature, every draw binds its table.
+        for (const auto& chunk : chunkCommands) {
+            ASSERT_EQ(chunk.second.size(), 5u + 2 * 2);
+            EXPECT_TRUE(chunk.second[0] == NullRHICommandType::SetDescriptorHeaps);
+            EXPECT_TRUE(chunk.second[1] == NullRHICommandType::SetGraphicsRootSignature);
+            for (size_t i = 5; i < chunk.second.size(); i += 2) {
+                EXPECT_TRUE(chunk.second[i] == NullRHICommandType::SetGraphicsRootDescriptorTable);
+                EXPECT_TRUE(chunk.second[i + 1] == NullRHICommandType::DrawIndexedInstanced);
+            }
+        }
+
+        // Execute resets the heaps, their blocks return once the GPU is done with the frame.
+        const uint64_t fenceValue = recorder.Execute();
+        EXPECT_EQ(ring->GetNumFreeBlocks(), numBlocks - 4);
+        commandQueue->WaitForFenceValue(fenceValue);
+        deferredReleaseQueue->ReleaseCompleted();
+        EXPECT_EQ(ring->GetNumFreeBlocks(), numBlocks);
+
+        // The heaps are reused by the next frames.
+        EXPECT_EQ(numHeapsCreated, 6u);
+    }
+}
+
+TEST(ParallelCommandRecorder, RenderGraphPassesRecordInParallel) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto resourceStateMap = std::make_shared<ResourceStateMap>();
+    auto commandQueue = std::make_shared<CommandQueue>(device, RHIQueueType::Direct, resourceStateMap);
+    auto deferredReleaseQueue = std::make_shared<DeferredReleaseQueue>(
+        std::vector< std::shared_ptr<CommandQueue> >{ commandQueue });
+    NullRHIRootSignature rootSignature;
+
+    auto backBuffer = device->CreateCommittedResource(RHIHeapType::Default,
+        RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, 1280, 720, RHIResourceFlag_AllowRenderTarget), RHIResourceState_Present);
+    resourceStateMap->AddResource(backBuffer.get(), RHIResourceState_Present);
+
+    const uint32_t numDraws = 10000;
+    // The shadow pass, the draws and the lighting pass.
+    auto queryHeap = device->CreateQueryHeap(RHIQueryHeapType::Timestamp, numDraws + 2);
+    const uint64_t* timestamps = static_cast<NullRHIQueryHeap*>(queryHeap.get())->GetData();
+
+    for (uint32_t numWorkers : { 0u, 3u }) {
+        auto jobSystem = CreateJobSystem(numWorkers);
+        ParallelCommandRecorder recorder(commandQueue, jobSystem);
+        RenderGraph graph(device, deferredReleaseQueue);
+
+        for (int frame = 0; frame < 3; ++frame) {
+            graph.Reset();
+            RenderGraphResource output = graph.ImportResource("Back Buffer", backBuffer.get(), RHIResourceState_Present);
+            RenderGraphResource shadowMap = graph.CreateResource("Shadow Map",
+                RHIResourceDesc::Tex2D(RHIFormat::D32_Float, 512, 512, RHIResourceFlag_AllowDepthStencil));
+            RenderGraphResource scene = graph.CreateResource("Scene",
+                RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, 1280, 720, RHIResourceFlag_AllowRenderTarget));
+
+            std::atomic<uint32_t> numRecorded(0);
+            graph.AddPass("Shadow", [&](RenderGraph&, RHICommandList* commandList) {
+                RecordItem(commandList, queryHeap.get(), 0);
+            }).Write(shadowMap, RHIResourceState_DepthWrite);
+            graph.AddPass("Opaque", [&](RenderGraph&, RHICommandList* commandList) {
+                EXPECT_EQ(commandList, recorder.GetCommandList());
+                recorder.RecordParallel(GetInheritedState(&rootSignature), numDraws, 256,
+                    [&](RHICommandList* chunkCommandList, DynamicDescriptorHeap*, uint32_t begin, uint32_t end) {
+                        for (uint32_t i = begin; i < end; ++i) {
+                            RecordItem(chunkCommandList, queryHeap.get(), i + 1);
+                        }
+                        numRecorded += end - begin;
+                    });
+            }).Write(scene, RHIResourceState_RenderTarget).SetSwitchesCommandList();
+            graph.AddPass("Lighting", [&](RenderGraph&, RHICommandList* commandList) {
+                RecordItem(commandList, queryHeap.get(), numDraws + 1);
+            })
+                .Read(shadowMap, RHIResourceState_PixelShaderResource)
+                .Read(scene, RHIResourceState_PixelShaderResource)
+                .Write(output, RHIResourceState_RenderTarget);
+            graph.Compile();
+
+            recorder.Begin();
+            graph.Execute(recorder);
+            commandQueue->WaitForFenceValue(recorder.Execute());
+            deferredReleaseQueue->ReleaseCompleted();
+
+            EXPECT_EQ(numRecorded.load(), numDraws);
+            for (uint32_t query = 0; query <= numDraws; ++query) {
+                ASSERT_LT(timestamps[query], timestamps[query + 1]);
+            }
+
+            // The barriers of the lighting pass went to the list after the chunks, the graph returned the back buffer.
+            RHIResourceState state;
+            ASSERT_TRUE(resourceStateMap->GetResourceState(backBuffer.get(), &state));
+            EXPECT_EQ(state, RHIResourceState_Present);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#include "profiler.h"
+#include "testing.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The profiler is global. Every test records on a track of its own and clears the zones of the tests before it.
+
+namespace {
+
+// Zone i of a test starts at i microseconds, so the zones in the trace can be told apart by their timestamps.
+void RecordZones(uint32_t track, uint64_t first, uint64_t count) {
+    for (uint64_t i = first; i < first + count; ++i) {
+        Profiler::RecordZone(track, "Zone", i * 1000, i * 1000 + 500, 0);
+    }
+}
+
+// The timestamps in microseconds of the zones of a track in the trace, in trace order.
+std::vector<uint64_t> GetZoneTimestamps(uint32_t track) {
+    std::ostringstream trace;
+    Profiler::WriteChromeTrace(trace);
+    const std::string json = trace.str();
+
+    const std::string key = "\"ph\":\"X\",\"pid\":0,\"tid\":" + std::to_string(track) + ",\"ts\":";
+    std::vector<uint64_t> timestamps;
+    for (size_t position = json.find(key); position != std::string::npos; position = json.find(key, position + 1)) {
+        timestamps.push_back(std::strtoull(json.c_str() + position + key.size(), nullptr, 10));
+    }
+    return timestamps;
+}
+
+} // namespace
+
+TEST(Profiler, OnlyTheNewestZonesSurviveInOrder) {
+    Profiler::Clear();
+    const uint32_t track = Profiler::CreateTrack("Overflow");
+    const uint64_t numOverwritten = 1000;
+    RecordZones(track, 0, Profiler::ZonesPerThread + numOverwritten);
+
+    const std::vector<uint64_t> timestamps = GetZoneTimestamps(track);
+    ASSERT_EQ(timestamps.size(), Profiler::ZonesPerThread);
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        ASSERT_EQ(timestamps[i], numOverwritten + i);
+    }
+
+    // Wrapping around once more keeps the order.
+    RecordZones(track, Profiler::ZonesPerThread + numOverwritten, Profiler::ZonesPerThread / 2);
+    const std::vector<uint64_t> wrapped = GetZoneTimestamps(track);
+    ASSERT_EQ(wrapped.size(), Profiler::ZonesPerThread);
+    for (size_t i = 0; i < wrapped.size(); ++i) {
+        ASSERT_EQ(wrapped[i], numOverwritten + Profiler::ZonesPerThread / 2 + i);
+    }
+}
+
+TEST(Profiler, ClearDropsTheZonesRecordedBefore) {
+    Profiler::Clear();
+    const uint32_t track = Profiler::CreateTrack("Clear");
+    RecordZones(track, 0, 10);
+    EXPECT_EQ(GetZoneTimestamps(track).size(), 10u);
+
+    Profiler::Clear();
+    EXPECT_EQ(GetZoneTimestamps(track).size(), 0u);
+
+    RecordZones(track, 10, 5);
+    const std::vector<uint64_t> timestamps = GetZoneTimestamps(track);
+    ASSERT_EQ(timestamps.size(), 5u);
+    EXPECT_EQ(timestamps[0], 10u);
+    EXPECT_EQ(timestamps[4], 14u);
+
+    // Zones of threads are dropped too.
+    {
+        PROFILE_SCOPE("Thread zone");
+    }
+    std::ostringstream trace;
+    Profiler::WriteChromeTrace(trace);
+    EXPECT_NE(trace.str().find("\"Thread zone\""), std::string::npos);
+    Profiler::Clear();
+    trace.str("");
+    Profiler::WriteChromeTrace(trace);
+    EXPECT_EQ(trace.str().find("\"Thread zone\""), std::string::npos);
+}
+
+TEST(Profiler, NamesAreEscapedInTheTrace) {
+    Profiler::Clear();
+    const uint32_t track = Profiler::CreateTrack("Track \"quoted\"");
+    Profiler::RecordZone(track, "Load \"C:\\assets\\mesh.bin\"\n", 1000, 2000, 0);
+
+    std::ostringstream trace;
+    Profiler::WriteChromeTrace(trace);
+    const std::string json = trace.str();
+
+    EXPECT_NE(json.find("\"name\":\"Load \\\"C:\\\\assets\\\\mesh.bin\\\"\""), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"Track \\\"quoted\\\"\"}"), std::string::npos);
+    // Control characters are dropped, the string ends at the closing quote.
+    EXPECT_EQ(json.find("mesh.bin\\\"\n"), std::string::npos);
+    EXPECT_NE(json.find("\"ts\":1.000,\"dur\":1.000"), std::string::npos);
+}
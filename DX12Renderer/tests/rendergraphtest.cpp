@@ -0,0 +1,292 @@
+#include "commandqueue.h"
+#include "rendergraph.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+void Nothing(RenderGraph&, RHICommandList*) {
+}
+
+uint32_t GetPosition(const RenderGraph& graph, uint32_t pass) {
+    const std::vector<uint32_t>& order = graph.GetPassOrder();
+    for (uint32_t position = 0; position < order.size(); ++position) {
+        if (order[position] == pass) {
+            return position;
+        }
+    }
+    return ~0u;
+}
+
+struct PlannedBarrier {
+    uint32_t position;
+    RenderGraphBarrier barrier;
+};
+
+// The barriers of the resource in execution order.
+std::vector<PlannedBarrier> GetBarriers(const RenderGraph& graph, RenderGraphResource resource) {
+    std::vector<PlannedBarrier> barriers;
+    for (uint32_t position = 0; position < graph.GetPassOrder().size(); ++position) {
+        for (const RenderGraphBarrier& barrier : graph.GetBarriers(position)) {
+            if (barrier.Resource == resource) {
+                barriers.push_back(PlannedBarrier{ position, barrier });
+            }
+        }
+    }
+    return barriers;
+}
+
+RHIResourceDesc RenderTargetDesc(uint32_t width, uint32_t height) {
+    return RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, width, height, RHIResourceFlag_AllowRenderTarget);
+}
+
+} // namespace
+
+TEST(RenderGraph, PassesThatContributeNothingAreCulled) {
+    auto device = std::make_shared<NullRHIDevice>();
+    RenderGraph graph(device, nullptr);
+
+    auto backBuffer = device->CreateCommittedResource(RHIHeapType::Default, RenderTargetDesc(64, 64), RHIResourceState_Present);
+    RenderGraphResource output = graph.ImportResource("Back Buffer", backBuffer.get(), RHIResourceState_Present);
+    RenderGraphResource scene = graph.CreateResource("Scene", RenderTargetDesc(64, 64));
+    RenderGraphResource unused = graph.CreateResource("Unused", RenderTargetDesc(64, 64));
+    RenderGraphResource unusedCopy = graph.CreateResource("Unused Copy", RenderTargetDesc(64, 64));
+
+    uint32_t draw = graph.AddPass("Draw", Nothing).Write(scene, RHIResourceState_RenderTarget).GetPass();
+    // A chain whose result nobody reads.
+    uint32_t debug = graph.AddPass("Debug", Nothing).Write(unused, RHIResourceState_RenderTarget).GetPass();
+    uint32_t debugCopy = graph.AddPass("Debug Copy", Nothing)
+        .Read(unused, RHIResourceState_PixelShaderResource)
+        .Write(unusedCopy, RHIResourceState_RenderTarget).GetPass();
+    // Effects outside of the graph keep a pass that writes nothing of it.
+    uint32_t readback = graph.AddPass("Readback", Nothing)
+        .Read(scene, RHIResourceState_CopySource)
+        .SetSideEffects().GetPass();
+    uint32_t present = graph.AddPass("Present", Nothing)
+        .Read(scene, RHIResourceState_PixelShaderResource)
+        .Write(output, RHIResourceState_RenderTarget).GetPass();
+
+    graph.Compile();
+
+    EXPECT_FALSE(graph.IsPassCulled(draw));
+    EXPECT_TRUE(graph.IsPassCulled(debug));
+    EXPECT_TRUE(graph.IsPassCulled(debugCopy));
+    EXPECT_FALSE(graph.IsPassCulled(readback));
+    EXPECT_FALSE(graph.IsPassCulled(present));
+
+    ASSERT_EQ(graph.GetPassOrder().size(), 3u);
+    EXPECT_EQ(graph.GetPassOrder()[0], draw);
+
+    RenderGraph::Stats stats = graph.GetStats();
+    EXPECT_EQ(stats.numPasses, 5u);
+    EXPECT_EQ(stats.numCulledPasses, 2u);
+    // The resources of culled passes are not created.
+    EXPECT_EQ(stats.numTransientResources, 1u);
+}
+
+TEST(RenderGraph, ReadsAfterAWriteShareOneSplitTransition) {
+    auto device = std::make_shared<NullRHIDevice>();
+    RenderGraph graph(device, nullptr);
+
+    auto target = device->CreateCommittedResource(RHIHeapType::Default, RenderTargetDesc(64, 64), RHIResourceState_Common);
+    RenderGraphResource output = graph.ImportResource("Output", target.get(), RHIResourceState_Common);
+    RenderGraphResource scene = graph.CreateResource("Scene", RenderTargetDesc(64, 64));
+    RenderGraphResource other = graph.CreateResource("Other", RenderTargetDesc(64, 64));
+
+    uint32_t draw = graph.AddPass("Draw", Nothing).Write(scene, RHIResourceState_RenderTarget).GetPass();
+    graph.AddPass("Independent", Nothing).Write(other, RHIResourceState_RenderTarget).SetSideEffects();
+    uint32_t pixelRead = graph.AddPass("Pixel Read", Nothing)
+        .Read(scene, RHIResourceState_PixelShaderResource)
+        .Write(output, RHIResourceState_RenderTarget).GetPass();
+    uint32_t computeRead = graph.AddPass("Compute Read", Nothing)
+        .Read(scene, RHIResourceState_NonPixelShaderResource)
+        .SetSideEffects().GetPass();
+
+    graph.Compile();
+
+    // The independent pass runs between the draw and its readers, which gives the transition room.
+    ASSERT_EQ(GetPosition(graph, draw), 0u);
+    ASSERT_EQ(GetPosition(graph, pixelRead), 2u);
+    ASSERT_EQ(GetPosition(graph, computeRead), 3u);
+
+    std::vector<PlannedBarrier> barriers = GetBarriers(graph, scene);
+    ASSERT_EQ(barriers.size(), 2u);
+
+    const RHIResourceState readStates =
+        static_cast<RHIResourceState>(RHIResourceState_PixelShaderResource | RHIResourceState_NonPixelShaderResource);
+    EXPECT_EQ(barriers[0].position, 1u);
+    EXPECT_EQ(barriers[0].barrier.Flags, static_cast<uint32_t>(RHIResourceBarrierFlag_BeginOnly));
+    EXPECT_EQ(barriers[0].barrier.StateBefore, RHIResourceState_RenderTarget);
+    EXPECT_EQ(barriers[0].barrier.StateAfter, readStates);
+    EXPECT_EQ(barriers[1].position, 2u);
+    EXPECT_EQ(barriers[1].barrier.Flags, static_cast<uint32_t>(RHIResourceBarrierFlag_EndOnly));
+    EXPECT_EQ(barriers[1].barrier.StateAfter, readStates);
+
+    EXPECT_EQ(graph.GetStats().numSplitBarriers, 1u);
+}
+
+TEST(RenderGraph, TransitionsOfImportedResourcesAreNotSplit) {
+    auto device = std::make_shared<NullRHIDevice>();
+    RenderGraph graph(device, nullptr);
+
+    auto texture = device->CreateCommittedResource(RHIHeapType::Default, RenderTargetDesc(64, 64), RHIResourceState_Common);
+    RenderGraphResource scene = graph.ImportResource("Scene", texture.get(), RHIResourceState_Common);
+    RenderGraphResource other = graph.CreateResource("Other", RenderTargetDesc(64, 64));
+
+    graph.AddPass("Draw", Nothing).Write(scene, RHIResourceState_RenderTarget);
+    graph.AddPass("Independent", Nothing).Write(other, RHIResourceState_RenderTarget).SetSideEffects();
+    uint32_t read = graph.AddPass("Read", Nothing).Read(scene, RHIResourceState_PixelShaderResource).SetSideEffects().GetPass();
+
+    graph.Compile();
+
+    std::vector<PlannedBarrier> barriers = GetBarriers(graph, scene);
+    ASSERT_EQ(barriers.size(), 1u);
+    EXPECT_EQ(barriers[0].position, GetPosition(graph, read));
+    EXPECT_EQ(barriers[0].barrier.Flags, static_cast<uint32_t>(RHIResourceBarrierFlag_None));
+}
+
+TEST(RenderGraph, UnorderedAccessHazardsGetUavBarriers) {
+    auto device = std::make_shared<NullRHIDevice>();
+    RenderGraph graph(device, nullptr);
+
+    RenderGraphResource buffer = graph.CreateResource("Buffer", RHIResourceDesc::Buffer(4096, RHIResourceFlag_AllowUnorderedAccess));
+
+    uint32_t write = graph.AddPass("Write", Nothing).Write(buffer, RHIResourceState_UnorderedAccess).SetSideEffects().GetPass();
+    uint32_t read = graph.AddPass("Read", Nothing).Read(buffer, RHIResourceState_UnorderedAccess).SetSideEffects().GetPass();
+    // A write after a read must wait for the read.
+    uint32_t rewrite = graph.AddPass("Rewrite", Nothing).Write(buffer, RHIResourceState_UnorderedAccess).SetSideEffects().GetPass();
+    uint32_t firstRead = graph.AddPass("First Read", Nothing).Read(buffer, RHIResourceState_UnorderedAccess).SetSideEffects().GetPass();
+    // Reads after reads do not.
+    uint32_t secondRead = graph.AddPass("Second Read", Nothing).Read(buffer, RHIResourceState_UnorderedAccess).SetSideEffects().GetPass();
+
+    graph.Compile();
+
+    ASSERT_EQ(GetPosition(graph, write), 0u);
+    ASSERT_EQ(GetPosition(graph, read), 1u);
+    ASSERT_EQ(GetPosition(graph, rewrite), 2u);
+    ASSERT_EQ(GetPosition(graph, firstRead), 3u);
+    ASSERT_EQ(GetPosition(graph, secondRead), 4u);
+
+    std::vector<PlannedBarrier> barriers = GetBarriers(graph, buffer);
+    ASSERT_EQ(barriers.size(), 3u);
+    for (uint32_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(barriers[i].position, i + 1);
+        EXPECT_EQ(barriers[i].barrier.Type, RHIResourceBarrierType::UAV);
+    }
+}
+
+TEST(RenderGraph, OnlyTransientsWithDisjointLifetimesShareMemory) {
+    auto device = std::make_shared<NullRHIDevice>();
+    RenderGraph graph(device, nullptr);
+
+    auto backBuffer = device->CreateCommittedResource(RHIHeapType::Default, RenderTargetDesc(1024, 1024), RHIResourceState_Present);
+    RenderGraphResource output = graph.ImportResource("Back Buffer", backBuffer.get(), RHIResourceState_Present);
+
+    // A downsample chain, each level is only alive for the pass writing it and the one reading it.
+    // The scene is read again at the end and lives through all of them.
+    const uint32_t numLevels = 8;
+    std::vector<RenderGraphResource> resources;
+    std::vector<uint64_t> sizes;
+    std::vector< std::vector<uint32_t> > passResources;
+
+    RenderGraphResource scene = graph.CreateResource("Scene", RenderTargetDesc(1024, 1024));
+    graph.AddPass("Scene", Nothing).Write(scene, RHIResourceState_RenderTarget);
+    resources.push_back(scene);
+    sizes.push_back(device->GetResourceAllocationInfo(RenderTargetDesc(1024, 1024)).Size);
+    passResources.push_back({ scene });
+
+    RenderGraphResource previous = scene;
+    for (uint32_t level = 0; level < numLevels; ++level) {
+        uint32_t size = 1024 >> (level % 4);
+        RenderGraphResource resource = graph.CreateResource("Level", RenderTargetDesc(size, size));
+        graph.AddPass("Downsample", Nothing)
+            .Read(previous, RHIResourceState_PixelShaderResource)
+            .Write(resource, RHIResourceState_RenderTarget);
+        resources.push_back(resource);
+        sizes.push_back(device->GetResourceAllocationInfo(RenderTargetDesc(size, size)).Size);
+        passResources.push_back({ previous, resource });
+        previous = resource;
+    }
+
+    graph.AddPass("Composite", Nothing)
+        .Read(scene, RHIResourceState_PixelShaderResource)
+        .Read(previous, RHIResourceState_PixelShaderResource)
+        .Write(output, RHIResourceState_RenderTarget);
+    passResources.push_back({ scene, previous });
+
+    graph.Compile();
+    ASSERT_EQ(graph.GetPassOrder().size(), passResources.size());
+
+    // The lifetime of every resource from the passes that use it.
+    std::vector<uint32_t> firstPositions(resources.size(), ~0u);
+    std::vector<uint32_t> lastPositions(resources.size(), 0);
+    for (uint32_t position = 0; position < graph.GetPassOrder().size(); ++position) {
+        for (RenderGraphResource resource : passResources[graph.GetPassOrder()[position]]) {
+            size_t index = resource - scene;
+            firstPositions[index] = std::min(firstPositions[index], position);
+            lastPositions[index] = std::max(lastPositions[index], position);
+        }
+    }
+
+    uint32_t numShared = 0;
+    for (size_t a = 0; a < resources.size(); ++a) {
+        for (size_t b = a + 1; b < resources.size(); ++b) {
+            const uint64_t offsetA = graph.GetTransientOffset(resources[a]);
+            const uint64_t offsetB = graph.GetTransientOffset(resources[b]);
+            const bool memoryOverlaps = offsetA < offsetB + sizes[b] && offsetB < offsetA + sizes[a];
+            const bool lifetimesOverlap = firstPositions[a] <= lastPositions[b] && firstPositions[b] <= lastPositions[a];
+            EXPECT_FALSE(memoryOverlaps && lifetimesOverlap);
+            numShared += memoryOverlaps ? 1 : 0;
+        }
+    }
+    EXPECT_GT(numShared, 0u);
+
+    RenderGraph::Stats stats = graph.GetStats();
+    EXPECT_EQ(stats.numTransientResources, resources.size());
+    EXPECT_LT(stats.transientHeapBytes, stats.transientBytes);
+    EXPECT_GT(stats.numAliasingBarriers, 0u);
+}
+
+TEST(RenderGraph, ExecutionOnTheNullBackendLeavesImportsInTheirFinalState) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto resourceStateMap = std::make_shared<ResourceStateMap>();
+    CommandQueue commandQueue(device, RHIQueueType::Direct, resourceStateMap);
+    RenderGraph graph(device, nullptr);
+
+    auto backBuffer = device->CreateCommittedResource(RHIHeapType::Default, RenderTargetDesc(256, 256), RHIResourceState_Present);
+    resourceStateMap->AddResource(backBuffer.get(), RHIResourceState_Present);
+
+    // The null backend asserts that every transition starts in the state the resource is in.
+    for (int frame = 0; frame < 3; ++frame) {
+        graph.Reset();
+        RenderGraphResource output = graph.ImportResource("Back Buffer", backBuffer.get(), RHIResourceState_Present);
+        RenderGraphResource scene = graph.CreateResource("Scene", RenderTargetDesc(256, 256));
+        RenderGraphResource buffer = graph.CreateResource("Buffer", RHIResourceDesc::Buffer(4096, RHIResourceFlag_AllowUnorderedAccess));
+
+        uint32_t numExecuted = 0;
+        auto count = [&numExecuted](RenderGraph&, RHICommandList*) { ++numExecuted; };
+        graph.AddPass("Simulate", count).Write(buffer, RHIResourceState_UnorderedAccess);
+        graph.AddPass("Draw", count)
+            .Read(buffer, RHIResourceState_NonPixelShaderResource)
+            .Write(scene, RHIResourceState_RenderTarget);
+        graph.AddPass("Present", count)
+            .Read(scene, RHIResourceState_PixelShaderResource)
+            .Write(output, RHIResourceState_RenderTarget);
+        graph.Compile();
+
+        auto commandList = commandQueue.GetCommandList();
+        graph.Execute(commandList.get(), commandQueue.GetResourceStateTracker(commandList.get()));
+        commandQueue.WaitForFenceValue(commandQueue.ExecuteCommandList(commandList));
+
+        EXPECT_EQ(numExecuted, 3u);
+        EXPECT_EQ(static_cast<NullRHIResource*>(backBuffer.get())->GetState(), RHIResourceState_Present);
+    }
+
+    graph.Reset();
+    resourceStateMap->RemoveResource(backBuffer.get());
+}
@@ -0,0 +1,222 @@
+#include "resourcestatetracker.h"
+#include "rhinull.h"
+#include "testing.h"
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Keeps the barrier batches recorded on it.
+class BarrierRecordingCommandList : public NullRHICommandList {
+public:
+    explicit BarrierRecordingCommandList(RHIDevice& device)
+        : NullRHICommandList(RHIQueueType::Direct, device.CreateCommandAllocator(RHIQueueType::Direct)) {
+    }
+
+    virtual void ResourceBarrier(uint32_t numBarriers, const RHIResourceBarrier* barriers) override {
+        batches.emplace_back(barriers, barriers + numBarriers);
+        NullRHICommandList::ResourceBarrier(numBarriers, barriers);
+    }
+
+    std::vector< std::vector<RHIResourceBarrier> > batches;
+};
+
+bool IsTransition(const RHIResourceBarrier& barrier, RHIResource* resource, RHIResourceState before, RHIResourceState after) {
+    return barrier.Type == RHIResourceBarrierType::Transition && barrier.Resource == resource &&
+        barrier.StateBefore == before && barrier.StateAfter == after;
+}
+
+std::shared_ptr<RHIResource> CreateTexture(RHIDevice& device) {
+    return device.CreateCommittedResource(RHIHeapType::Default,
+        RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, 64, 64, RHIResourceFlag_AllowRenderTarget | RHIResourceFlag_AllowUnorderedAccess),
+        RHIResourceState_Common);
+}
+
+} // namespace
+
+TEST(ResourceStateTracker, TransitionsWithinABatchAreMerged) {
+    NullRHIDevice device;
+    auto texture = CreateTexture(device);
+    BarrierRecordingCommandList commandList(device);
+    ResourceStateTracker tracker;
+
+    // The first use is pending until submission, nothing is recorded.
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.FlushResourceBarriers(&commandList);
+    EXPECT_EQ(commandList.batches.size(), 0u);
+
+    // Transitions to the current state are dropped.
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    tracker.TransitionResource(texture.get(), RHIResourceState_PixelShaderResource);
+    tracker.FlushResourceBarriers(&commandList);
+
+    ASSERT_EQ(commandList.batches.size(), 1u);
+    ASSERT_EQ(commandList.batches[0].size(), 1u);
+    EXPECT_TRUE(IsTransition(commandList.batches[0][0], texture.get(),
+        RHIResourceState_RenderTarget, RHIResourceState_PixelShaderResource));
+    EXPECT_EQ(tracker.GetNumFlushedBarriers(), 1u);
+    EXPECT_EQ(tracker.GetNumFlushes(), 1u);
+}
+
+TEST(ResourceStateTracker, TransitionsBackToTheStateBeforeTheBatchAreDropped) {
+    NullRHIDevice device;
+    auto texture = CreateTexture(device);
+    auto other = CreateTexture(device);
+    BarrierRecordingCommandList commandList(device);
+    ResourceStateTracker tracker;
+
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.TransitionResource(other.get(), RHIResourceState_RenderTarget);
+    tracker.FlushResourceBarriers(&commandList);
+
+    // A -> B -> A of one resource cancels out, the transition of the other one stays.
+    tracker.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    tracker.TransitionResource(other.get(), RHIResourceState_CopySource);
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.FlushResourceBarriers(&commandList);
+
+    ASSERT_EQ(commandList.batches.size(), 1u);
+    ASSERT_EQ(commandList.batches[0].size(), 1u);
+    EXPECT_TRUE(IsTransition(commandList.batches[0][0], other.get(), RHIResourceState_RenderTarget, RHIResourceState_CopySource));
+
+    // A batch that cancels out completely records nothing.
+    tracker.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.FlushResourceBarriers(&commandList);
+    EXPECT_EQ(commandList.batches.size(), 1u);
+    EXPECT_EQ(tracker.GetFinalResourceStates().at(texture.get()), RHIResourceState_RenderTarget);
+}
+
+TEST(ResourceStateTracker, TransitionsAreNotMergedAcrossUAVOrAliasingBarriers) {
+    NullRHIDevice device;
+    auto texture = CreateTexture(device);
+    auto other = CreateTexture(device);
+    auto unrelated = CreateTexture(device);
+    BarrierRecordingCommandList commandList(device);
+    ResourceStateTracker tracker;
+
+    tracker.TransitionResource(texture.get(), RHIResourceState_UnorderedAccess);
+    tracker.TransitionResource(other.get(), RHIResourceState_UnorderedAccess);
+    tracker.FlushResourceBarriers(&commandList);
+
+    // A UAV barrier of the resource.
+    tracker.TransitionResource(texture.get(), RHIResourceState_PixelShaderResource);
+    tracker.UAVBarrier(texture.get());
+    tracker.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    // A UAV barrier of all resources.
+    tracker.TransitionResource(other.get(), RHIResourceState_PixelShaderResource);
+    tracker.UAVBarrier();
+    tracker.TransitionResource(other.get(), RHIResourceState_CopySource);
+    tracker.FlushResourceBarriers(&commandList);
+
+    ASSERT_EQ(commandList.batches.size(), 1u);
+    const std::vector<RHIResourceBarrier>& uavBatch = commandList.batches[0];
+    ASSERT_EQ(uavBatch.size(), 6u);
+    EXPECT_TRUE(IsTransition(uavBatch[0], texture.get(), RHIResourceState_UnorderedAccess, RHIResourceState_PixelShaderResource));
+    EXPECT_TRUE(uavBatch[1].Type == RHIResourceBarrierType::UAV && uavBatch[1].Resource == texture.get());
+    EXPECT_TRUE(IsTransition(uavBatch[2], texture.get(), RHIResourceState_PixelShaderResource, RHIResourceState_CopySource));
+    EXPECT_TRUE(IsTransition(uavBatch[3], other.get(), RHIResourceState_UnorderedAccess, RHIResourceState_PixelShaderResource));
+    EXPECT_TRUE(uavBatch[4].Type == RHIResourceBarrierType::UAV && uavBatch[4].Resource == nullptr);
+    EXPECT_TRUE(IsTransition(uavBatch[5], other.get(), RHIResourceState_PixelShaderResource, RHIResourceState_CopySource));
+
+    // An aliasing barrier blocks merges of the resources giving up and taking over the memory, not of others.
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.TransitionResource(unrelated.get(), RHIResourceState_RenderTarget);
+    tracker.FlushResourceBarriers(&commandList);
+    tracker.TransitionResource(texture.get(), RHIResourceState_PixelShaderResource);
+    tracker.TransitionResource(unrelated.get(), RHIResourceState_PixelShaderResource);
+    tracker.AliasingBarrier(texture.get(), other.get());
+    tracker.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    tracker.TransitionResource(unrelated.get(), RHIResourceState_CopySource);
+    tracker.FlushResourceBarriers(&commandList);
+
+    ASSERT_EQ(commandList.batches.size(), 3u);
+    const std::vector<RHIResourceBarrier>& aliasingBatch = commandList.batches[2];
+    ASSERT_EQ(aliasingBatch.size(), 4u);
+    EXPECT_TRUE(IsTransition(aliasingBatch[0], texture.get(), RHIResourceState_RenderTarget, RHIResourceState_PixelShaderResource));
+    EXPECT_TRUE(IsTransition(aliasingBatch[1], unrelated.get(), RHIResourceState_RenderTarget, RHIResourceState_CopySource));
+    EXPECT_TRUE(aliasingBatch[2].Type == RHIResourceBarrierType::Aliasing &&
+        aliasingBatch[2].ResourceBefore == texture.get() && aliasingBatch[2].Resource == other.get());
+    EXPECT_TRUE(IsTransition(aliasingBatch[3], texture.get(), RHIResourceState_PixelShaderResource, RHIResourceState_CopySource));
+}
+
+TEST(ResourceStateTracker, FirstTransitionsMergeUntilTheyAreFlushed) {
+    NullRHIDevice device;
+    auto texture = CreateTexture(device);
+    auto other = CreateTexture(device);
+    BarrierRecordingCommandList commandList(device);
+    ResourceStateTracker tracker;
+
+    // Both changes go into the pending barrier, nothing has used the render target state yet.
+    tracker.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    tracker.TransitionResource(texture.get(), RHIResourceState_PixelShaderResource);
+    // The state before is unknown, so going back to the first state keeps the pending barrier.
+    tracker.TransitionResource(other.get(), RHIResourceState_RenderTarget);
+    tracker.TransitionResource(other.get(), RHIResourceState_CopySource);
+    tracker.TransitionResource(other.get(), RHIResourceState_RenderTarget);
+    tracker.FlushResourceBarriers(&commandList);
+
+    EXPECT_EQ(commandList.batches.size(), 0u);
+    const std::vector<RHIResourceBarrier>& pending = tracker.GetPendingResourceBarriers();
+    ASSERT_EQ(pending.size(), 2u);
+    EXPECT_TRUE(pending[0].Resource == texture.get() && pending[0].StateAfter == RHIResourceState_PixelShaderResource);
+    EXPECT_TRUE(pending[1].Resource == other.get() && pending[1].StateAfter == RHIResourceState_RenderTarget);
+
+    // Once flushed, the work after it relies on the pending state, later transitions are barriers of their own.
+    tracker.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    tracker.FlushResourceBarriers(&commandList);
+
+    ASSERT_EQ(commandList.batches.size(), 1u);
+    ASSERT_EQ(commandList.batches[0].size(), 1u);
+    EXPECT_TRUE(IsTransition(commandList.batches[0][0], texture.get(),
+        RHIResourceState_PixelShaderResource, RHIResourceState_CopySource));
+    EXPECT_EQ(tracker.GetPendingResourceBarriers()[0].StateAfter, RHIResourceState_PixelShaderResource);
+    EXPECT_EQ(tracker.GetFinalResourceStates().at(texture.get()), RHIResourceState_CopySource);
+}
+
+TEST(ResourceStateMap, PendingBarriersAreResolvedAtSubmission) {
+    NullRHIDevice device;
+    auto texture = CreateTexture(device);
+    auto other = CreateTexture(device);
+    auto untouched = CreateTexture(device);
+    BarrierRecordingCommandList commandList(device);
+
+    ResourceStateMap map;
+    map.AddResource(texture.get(), RHIResourceState_Present);
+    map.AddResource(other.get(), RHIResourceState_PixelShaderResource);
+    map.AddResource(untouched.get(), RHIResourceState_CopyDest);
+
+    ResourceStateTracker first;
+    first.TransitionResource(texture.get(), RHIResourceState_RenderTarget);
+    first.TransitionResource(other.get(), RHIResourceState_PixelShaderResource);
+    first.FlushResourceBarriers(&commandList);
+    first.TransitionResource(texture.get(), RHIResourceState_CopySource);
+    first.FlushResourceBarriers(&commandList);
+
+    // Only the resource that is in another state needs a transition before the command list.
+    std::vector<RHIResourceBarrier> barriers;
+    map.ResolveResourceStates(first, &barriers);
+    ASSERT_EQ(barriers.size(), 1u);
+    EXPECT_TRUE(IsTransition(barriers[0], texture.get(), RHIResourceState_Present, RHIResourceState_RenderTarget));
+
+    // The final states of the command list are the states of the next one.
+    RHIResourceState state;
+    ASSERT_TRUE(map.GetResourceState(texture.get(), &state));
+    EXPECT_EQ(state, RHIResourceState_CopySource);
+    ASSERT_TRUE(map.GetResourceState(untouched.get(), &state));
+    EXPECT_EQ(state, RHIResourceState_CopyDest);
+
+    ResourceStateTracker second;
+    second.TransitionResource(texture.get(), RHIResourceState_Present);
+    second.TransitionResource(other.get(), RHIResourceState_UnorderedAccess);
+
+    barriers.clear();
+    map.ResolveResourceStates(second, &barriers);
+    ASSERT_EQ(barriers.size(), 2u);
+    EXPECT_TRUE(IsTransition(barriers[0], texture.get(), RHIResourceState_CopySource, RHIResourceState_Present));
+    EXPECT_TRUE(IsTransition(barriers[1], other.get(), RHIResourceState_PixelShaderResource, RHIResourceState_UnorderedAccess));
+    ASSERT_TRUE(map.GetResourceState(other.get(), &state));
+    EXPECT_EQ(state, RHIResourceState_UnorderedAccess);
+}
@@ -0,0 +1,211 @@
+#include "commandqueue.h"
+#include "rhinull.h"
+#include "testing.h"
+#include "uploadbuffer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Record on a fresh command list of the queue and execute it, the null queue replays it right away.
+template<typename Record>
+void Execute(RHIDevice& device, RHICommandQueue& queue, Record record) {
+    auto allocator = device.CreateCommandAllocator(queue.GetType());
+    auto commandList = device.CreateCommandList(queue.GetType(), allocator);
+    record(commandList.get());
+    commandList->Close();
+
+    RHICommandList* commandLists[] = { commandList.get() };
+    queue.ExecuteCommandLists(1, commandLists);
+}
+
+// Records the GPU waits of its queues instead of stalling on them, the null queue would block until the value is signaled.
+class WaitRecordingDevice : public NullRHIDevice {
+public:
+    struct RecordedWait {
+        RHIFence* fence;
+        uint64_t value;
+    };
+
+    class Queue : public NullRHICommandQueue {
+    public:
+        Queue(RHIQueueType type, std::vector<RecordedWait>& waits)
+            : NullRHICommandQueue(type)
+            , m_Waits(waits) {
+        }
+
+        virtual void Wait(RHIFence* fence, uint64_t value) override {
+            m_Waits.push_back(RecordedWait{ fence, value });
+        }
+
+    private:
+        std::vector<RecordedWait>& m_Waits;
+    };
+
+    virtual std::shared_ptr<RHICommandQueue> CreateCommandQueue(RHIQueueType type) override {
+        return std::make_shared<Queue>(type, waits);
+    }
+
+    std::vector<RecordedWait> waits;
+};
+
+} // namespace
+
+TEST(RHINull, CopiesAreReplayedOnExecute) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto queue = device->CreateCommandQueue(RHIQueueType::Copy);
+    auto upload = device->CreateCommittedResource(RHIHeapType::Upload, RHIResourceDesc::Buffer(256), RHIResourceState_GenericRead);
+    auto buffer = device->CreateCommittedResource(RHIHeapType::Default, RHIResourceDesc::Buffer(256), RHIResourceState_CopyDest);
+
+    uint8_t* uploadData = static_cast<uint8_t*>(upload->Map());
+    for (int i = 0; i < 256; ++i) {
+        uploadData[i] = static_cast<uint8_t>(i);
+    }
+
+    Execute(*device, *queue, [&](RHICommandList* commandList) {
+        commandList->CopyBufferRegion(buffer.get(), 16, upload.get(), 32, 64);
+    });
+
+    const uint8_t* data = static_cast<NullRHIResource*>(buffer.get())->GetData();
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_EQ(data[16 + i], 32 + i);
+    }
+    EXPECT_EQ(data[0], 0);
+    EXPECT_EQ(data[80], 0);
+}
+
+TEST(RHINull, FencesCompleteOnceTheWorkBeforeThemIsReplayed) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto queue = device->CreateCommandQueue(RHIQueueType::Direct);
+    auto fence = device->CreateFence(0);
+
+    Execute(*device, *queue, [](RHICommandList* commandList) {
+        commandList->DrawIndexedInstanced(3, 1, 0, 0, 0);
+    });
+    EXPECT_EQ(fence->GetCompletedValue(), 0u);
+
+    queue->Signal(fence.get(), 5);
+    EXPECT_EQ(fence->GetCompletedValue(), 5u);
+    fence->WaitForValue(5);
+
+    EXPECT_EQ(static_cast<NullRHICommandQueue*>(queue.get())->GetExecutedCommandCount(), 1u);
+}
+
+TEST(RHINull, TransitionsUpdateTheTextureState) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto queue = device->CreateCommandQueue(RHIQueueType::Direct);
+    auto texture = device->CreateCommittedResource(RHIHeapType::Default,
+        RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, 64, 64, RHIResourceFlag_AllowRenderTarget), RHIResourceState_Present);
+    NullRHIResource* nullTexture = static_cast<NullRHIResource*>(texture.get());
+
+    // The first half of a split transition leaves the state alone, the end completes it.
+    Execute(*device, *queue, [&](RHICommandList* commandList) {
+        RHIResourceBarrier barrier = RHIResourceBarrier::Transition(texture.get(), RHIResourceState_Present,
+            RHIResourceState_RenderTarget, RHIResourceBarrierFlag_BeginOnly);
+        commandList->ResourceBarrier(1, &barrier);
+    });
+    EXPECT_EQ(nullTexture->GetState(), RHIResourceState_Present);
+
+    Execute(*device, *queue, [&](RHICommandList* commandList) {
+        RHIResourceBarrier barrier = RHIResourceBarrier::Transition(texture.get(), RHIResourceState_Present,
+            RHIResourceState_RenderTarget, RHIResourceBarrierFlag_EndOnly);
+        commandList->ResourceBarrier(1, &barrier);
+    });
+    EXPECT_EQ(nullTexture->GetState(), RHIResourceState_RenderTarget);
+}
+
+TEST(RHINull, TimestampsAdvanceWithTheReplayedWork) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto queue = device->CreateCommandQueue(RHIQueueType::Direct);
+    auto queryHeap = device->CreateQueryHeap(RHIQueryHeapType::Timestamp, 2);
+    auto readback = device->CreateCommittedResource(RHIHeapType::Readback, RHIResourceDesc::Buffer(16), RHIResourceState_CopyDest);
+
+    Execute(*device, *queue, [&](RHICommandList* commandList) {
+        commandList->EndQuery(queryHeap.get(), 0);
+        for (int i = 0; i < 10; ++i) {
+            commandList->DrawIndexedInstanced(300, 1, 0, 0, 0);
+        }
+        commandList->EndQuery(queryHeap.get(), 1);
+        commandList->ResolveQueryData(queryHeap.get(), 0, 2, readback.get(), 0);
+    });
+
+    uint64_t timestamps[2];
+    std::memcpy(timestamps, readback->Map(), sizeof(timestamps));
+    EXPECT_GT(timestamps[1], timestamps[0]);
+}
+
+TEST(RHINull, CommandQueueUploadsThroughTheUploadBuffer) {
+    auto device = std::make_shared<NullRHIDevice>();
+    auto resourceStateMap = std::make_shared<ResourceStateMap>();
+    CommandQueue commandQueue(device, RHIQueueType::Direct, resourceStateMap);
+    auto buffer = device->CreateCommittedResource(RHIHeapType::Default, RHIResourceDesc::Buffer(1024), RHIResourceState_Common);
+    resourceStateMap->AddResource(buffer.get(), RHIResourceState_Common);
+
+    auto commandList = commandQueue.GetCommandList();
+    UploadBuffer::Allocation allocation = commandQueue.GetUploadBuffer().Allocate(1024, 256);
+    std::memset(allocation.CPU, 0xAB, 1024);
+
+    ResourceStateTracker& tracker = commandQueue.GetResourceStateTracker(commandList.get());
+    tracker.TransitionResource(buffer.get(), RHIResourceState_CopyDest);
+    tracker.FlushResourceBarriers(commandList.get());
+    commandList->CopyBufferRegion(buffer.get(), 0, allocation.Resource, allocation.Offset, 1024);
+    tracker.TransitionResource(buffer.get(), RHIResourceState_VertexAndConstantBuffer);
+
+    commandQueue.WaitForFenceValue(commandQueue.ExecuteCommandList(commandList));
+
+    const uint8_t* data = static_cast<NullRHIResource*>(buffer.get())->GetData();
+    for (int i = 0; i < 1024; ++i) {
+        ASSERT_EQ(data[i], 0xAB);
+    }
+
+    RHIResourceState state;
+    ASSERT_TRUE(resourceStateMap->GetResourceState(buffer.get(), &state));
+    EXPECT_EQ(state, RHIResourceState_VertexAndConstantBuffer);
+
+    resourceStateMap->RemoveResource(buffer.get());
+}
+
+TEST(RHINull, CommandQueueWaitsOnlyForWhatIsNotCoveredYet) {
+    auto device = std::make_shared<WaitRecordingDevice>();
+    auto resourceStateMap = std::make_shared<ResourceStateMap>();
+    CommandQueue directQueue(device, RHIQueueType::Direct, resourceStateMap);
+    CommandQueue copyQueue(device, RHIQueueType::Copy, resourceStateMap);
+    CommandQueue computeQueue(device, RHIQueueType::Compute, resourceStateMap);
+
+    // The null GPU is done with everything that was signaled, a wait for it is skipped.
+    const uint64_t completed = copyQueue.Signal();
+    directQueue.Wait(copyQueue, completed);
+    EXPECT_EQ(device->waits.size(), 0u);
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(copyQueue), 0u);
+
+    // Values the copy queue has not signaled yet are waited for on the GPU.
+    directQueue.Wait(copyQueue, completed + 2);
+    ASSERT_EQ(device->waits.size(), 1u);
+    EXPECT_EQ(device->waits[0].value, completed + 2);
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(copyQueue), completed + 2);
+
+    // An earlier wait for a higher or equal value covers lower ones.
+    directQueue.Wait(copyQueue, completed + 1);
+    directQueue.Wait(copyQueue, completed + 2);
+    EXPECT_EQ(device->waits.size(), 1u);
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(copyQueue), completed + 2);
+
+    directQueue.Wait(copyQueue, completed + 3);
+    ASSERT_EQ(device->waits.size(), 2u);
+    EXPECT_EQ(device->waits[1].value, completed + 3);
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(copyQueue), completed + 3);
+
+    // Dependencies are tracked per queue, a lower value of another queue is still waited for.
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(computeQueue), 0u);
+    directQueue.Wait(computeQueue, computeQueue.GetLastSignaledFenceValue() + 1);
+    ASSERT_EQ(device->waits.size(), 3u);
+    EXPECT_NE(device->waits[2].fence, device->waits[0].fence);
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(computeQueue), computeQueue.GetLastSignaledFenceValue() + 1);
+    EXPECT_EQ(directQueue.GetWaitedFenceValue(copyQueue), completed + 3);
+
+    // Waits are per waiting queue.
+    EXPECT_EQ(computeQueue.GetWaitedFenceValue(copyQueue), 0u);
+}
@@ -0,0 +1,101 @@
+/**
+ * Minimal unit test framework.
+ *
+ * TEST(Suite, Name) { ... } defines and registers a test. EXPECT_* checks
+ * record a failure and continue, ASSERT_* checks also return from the test.
+ * Every test executable links testmain.cpp, which runs all tests, or the
+ * ones whose Suite.Name contains the first argument, and fails if any check
+ * failed.
+ *
+ * No dependencies besides the C++ standard library, so the tests build
+ * wherever the renderer core builds.
+ */
+#pragma once
+
+#include <cmath>        // For std::fabs
+#include <sstream>      // For std::ostringstream
+#include <string>       // For std::string
+#include <type_traits>  // For std::is_enum and std::is_integral
+
+namespace test {
+
+using TestFunction = void (*)();
+
+// Registers a test before main runs.
+class Registrar {
+public:
+    Registrar(const char* suite, const char* name, TestFunction function);
+};
+
+// Record a failed check of the running test.
+void ReportFailure(const char* file, int line, const std::string& message);
+
+// Run the tests whose Suite.Name contains the filter. Returns the number of tests that failed.
+int RunTests(const char* filter);
+
+// Values of failed checks are printed, enums and characters as numbers.
+template<typename T>
+std::string ToString(const T& value) {
+    std::ostringstream stream;
+    if constexpr (std::is_enum<T>::value) {
+        stream << static_cast<long long>(value);
+    } else if constexpr (std::is_integral<T>::value && sizeof(T) == 1) {
+        stream << static_cast<int>(value);
+    } else {
+        stream << value;
+    }
+    return stream.str();
+}
+
+template<typename A, typename B>
+std::string FormatComparison(const char* expression, const A& a, const B& b) {
+    return std::string("Expected ") + expression + ", got " + ToString(a) + " and " + ToString(b);
+}
+
+} // namespace test
+
+#define TEST(suite, name)                                                                       \
+    static void suite##_##name();                                                               \
+    static const ::test::Registrar suite##_##name##_Registrar(#suite, #name, &suite##_##name);  \
+    static void suite##_##name()
+
+#define TEST_CHECK_(condition, message, onFailure)                                              \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            ::test::ReportFailure(__FILE__, __LINE__, message);                                 \
+            onFailure;                                                                          \
+        }                                                                                       \
+    } while (0)
+
+#define TEST_COMPARE_(a, b, op, onFailure)                                                      \
+    do {                                                                                        \
+        const auto& testA_ = (a);                                                               \
+        const auto& testB_ = (b);                                                               \
+        if (!(testA_ op testB_)) {                                                              \
+            ::test::ReportFailure(__FILE__, __LINE__,                                           \
+                ::test::FormatComparison(#a " " #op " " #b, testA_, testB_));                   \
+            onFailure;                                                                          \
+        }                                                                                       \
+    } while (0)
+
+#define EXPECT_TRUE(condition)  TEST_CHECK_(condition, "Expected " #condition, (void)0)
+#define EXPECT_FALSE(condition) TEST_CHECK_(!(condition), "Expected !(" #condition ")", (void)0)
+#define EXPECT_EQ(a, b) TEST_COMPARE_(a, b, ==, (void)0)
+#define EXPECT_NE(a, b) TEST_COMPARE_(a, b, !=, (void)0)
+#define EXPECT_LT(a, b) TEST_COMPARE_(a, b, <, (void)0)
+#define EXPECT_LE(a, b) TEST_COMPARE_(a, b, <=, (void)0)
+#define EXPECT_GT(a, b) TEST_COMPARE_(a, b, >, (void)0)
+#define EXPECT_GE(a, b) TEST_COMPARE_(a, b, >=, (void)0)
+#define EXPECT_NEAR(a, b, tolerance) \
+    TEST_CHECK_(std::fabs((a) - (b)) <= (tolerance), ::test::FormatComparison("|" #a " - " #b "| <= " #tolerance, a, b), (void)0)
+
+#define ASSERT_TRUE(condition)  TEST_CHECK_(condition, "Expected " #condition, return)
+#define ASSERT_FALSE(condition) TEST_CHECK_(!(condition), "Expected !(" #condition ")", return)
+#define ASSERT_EQ(a, b) TEST_COMPARE_(a, b, ==, return)
+#define ASSERT_NE(a, b) TEST_COMPARE_(a, b, !=, return)
+#define ASSERT_LT(a, b) TEST_COMPARE_(a, b, <, return)
+#define ASSERT_LE(a, b) TEST_COMPARE_(a, b, <=, return)
+#define ASSERT_GT(a, b) TEST_COMPARE_(a, b, >, return)
+#define ASSERT_GE(a, b) TEST_COMPARE_(a, b, >=, return)
+#define ASSERT_NEAR(a, b, tolerance) \
+    TEST_CHECK_(std::fabs((a) - (b)) <= (tolerance), ::test::FormatComparison("|" #a " - " #b "| <= " #tolerance, a, b), return)
@@ -0,0 +1,69 @@
+#include "testing.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace test {
+
+namespace {
+
+struct TestCase {
+    std::string name;
+    TestFunction function;
+};
+
+// Function local so registrars of any translation unit can use it.
+std::vector<TestCase>& GetTests() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+uint32_t s_NumFailures = 0;
+
+} // namespace
+
+Registrar::Registrar(const char* suite, const char* name, TestFunction function) {
+    GetTests().push_back(TestCase{ std::string(suite) + "." + name, function });
+}
+
+void ReportFailure(const char* file, int line, const std::string& message) {
+    std::printf("%s:%d: %s\n", file, line, message.c_str());
+    ++s_NumFailures;
+}
+
+int RunTests(const char* filter) {
+    int numFailedTests = 0;
+    int numTests = 0;
+    for (const TestCase& test : GetTests()) {
+        if (filter && test.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        std::printf("[ RUN    ] %s\n", test.name.c_str());
+        std::fflush(stdout);
+
+        const uint32_t numFailures = s_NumFailures;
+        try {
+            test.function();
+        } catch (const std::exception& e) {
+            ReportFailure(__FILE__, __LINE__, std::string("Unexpected exception: ") + e.what());
+        }
+
+        const bool failed = s_NumFailures != numFailures;
+        std::printf("[ %s ] %s\n", failed ? "FAILED" : "    OK", test.name.c_str());
+        numFailedTests += failed ? 1 : 0;
+        ++numTests;
+    }
+
+    std::printf("%d tests, %d failed\n", numTests, numFailedTests);
+    return numFailedTests;
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    return test::RunTests(argc > 1 ? argv[1] : nullptr) == 0 ? 0 : 1;
+}
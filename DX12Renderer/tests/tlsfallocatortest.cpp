@@ -0,0 +1,103 @@
+#include "testing.h"
+#include "tlsfallocator.h"
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+
+TEST(TlsfAllocator, AlignmentPaddingStaysFree) {
+    TlsfAllocator allocator(1024 * 1024, 256);
+
+    EXPECT_EQ(allocator.Allocate(256, 1), 0u);
+    EXPECT_EQ(allocator.Allocate(256, 64 * 1024), 64u * 1024);
+
+    // The padding in front of the aligned block is used by the next small allocation.
+    EXPECT_EQ(allocator.Allocate(256, 256), 256u);
+
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    EXPECT_EQ(stats.numAllocations, 3u);
+    EXPECT_EQ(stats.usedBytes, 3u * 256);
+}
+
+TEST(TlsfAllocator, AllocationsLargerThanTheRangeFail) {
+    TlsfAllocator allocator(1024 * 1024, 256);
+
+    EXPECT_EQ(allocator.Allocate(1024 * 1024 + 1, 1), TlsfAllocator::InvalidOffset);
+    EXPECT_EQ(allocator.Allocate(1024 * 1024, 1), 0u);
+    EXPECT_EQ(allocator.Allocate(1, 1), TlsfAllocator::InvalidOffset);
+}
+
+TEST(TlsfAllocator, RandomAllocationsNeverOverlapAndCoalesceWhenFreed) {
+    const uint64_t size = 64 * 1024 * 1024;
+    const uint64_t granularity = 256;
+    TlsfAllocator allocator(size, granularity);
+
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<uint32_t> sizeShift(0, 18);
+    std::uniform_int_distribution<uint32_t> alignmentShift(0, 16);
+
+    // Requested size of the live allocations by offset.
+    std::map<uint64_t, uint64_t> allocations;
+    uint64_t requestedBytes = 0;
+    uint32_t numFailed = 0;
+
+    for (int i = 0; i < 50000; ++i) {
+        if (allocations.empty() || random() % 5 < 3) {
+            const uint64_t allocationSize = (1ull << sizeShift(random)) + random() % 4096;
+            const uint64_t alignment = 1ull << alignmentShift(random);
+
+            const uint64_t offset = allocator.Allocate(allocationSize, alignment);
+            if (offset == TlsfAllocator::InvalidOffset) {
+                ++numFailed;
+                continue;
+            }
+
+            ASSERT_EQ(offset % alignment, 0u);
+            ASSERT_EQ(offset % granularity, 0u);
+            ASSERT_LE(offset + allocationSize, size);
+
+            auto next = allocations.lower_bound(offset);
+            if (next != allocations.end()) {
+                ASSERT_LE(offset + allocationSize, next->first);
+            }
+            if (next != allocations.begin()) {
+                auto prev = std::prev(next);
+                ASSERT_LE(prev->first + prev->second, offset);
+            }
+
+            allocations.emplace(offset, allocationSize);
+            requestedBytes += allocationSize;
+        } else {
+            auto allocation = std::next(allocations.begin(), random() % allocations.size());
+            allocator.Free(allocation->first);
+            requestedBytes -= allocation->second;
+            allocations.erase(allocation);
+        }
+
+        if (i % 1000 == 0) {
+            TlsfAllocator::Stats stats = allocator.GetStats();
+            ASSERT_EQ(stats.numAllocations, allocations.size());
+            ASSERT_GE(stats.usedBytes, requestedBytes);
+            ASSERT_EQ(stats.usedBytes + stats.freeBytes, size);
+            ASSERT_LE(stats.largestFreeBlock, stats.freeBytes);
+        }
+    }
+
+    // The pattern must fill the range now and then, or it does not test much.
+    EXPECT_GT(numFailed, 0u);
+
+    while (!allocations.empty()) {
+        auto allocation = std::next(allocations.begin(), random() % allocations.size());
+        allocator.Free(allocation->first);
+        allocations.erase(allocation);
+    }
+
+    // Every freed block has been merged with its free neighbours.
+    EXPECT_TRUE(allocator.IsEmpty());
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    EXPECT_EQ(stats.usedBytes, 0u);
+    EXPECT_EQ(stats.numFreeBlocks, 1u);
+    EXPECT_EQ(stats.largestFreeBlock, size);
+    EXPECT_EQ(allocator.Allocate(size, 1), 0u);
+}
@@ -0,0 +1,234 @@
+#include "vertexquantization.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const double Pi = 3.14159265358979323846;
+
+bool IsHalfNaN(uint16_t half) {
+    return (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0;
+}
+
+float MakeFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Angle between two vectors in degrees, acos loses the small angles to the rounding of the dot product.
+double AngleDegrees(const float* a, const float* b) {
+    const double cross[3] = {
+        double(a[1]) * b[2] - double(a[2]) * b[1],
+        double(a[2]) * b[0] - double(a[0]) * b[2],
+        double(a[0]) * b[1] - double(a[1]) * b[0]
+    };
+    const double dot = double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2];
+    const double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+    return std::atan2(sine, dot) * 180.0 / Pi;
+}
+
+// Unit vectors spread evenly over the sphere, plus the axes and the folds of the octahedron.
+std::vector<float> SphereNormals(uint32_t count) {
+    std::vector<float> normals;
+    const double goldenAngle = Pi * (3.0 - std::sqrt(5.0));
+    for (uint32_t i = 0; i < count; ++i) {
+        const double z = 1.0 - 2.0 * (i + 0.5) / count;
+        const double radius = std::sqrt(1.0 - z * z);
+        const double angle = goldenAngle * i;
+        normals.push_back(static_cast<float>(radius * std::cos(angle)));
+        normals.push_back(static_cast<float>(radius * std::sin(angle)));
+        normals.push_back(static_cast<float>(z));
+    }
+    const float special[][3] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { 0.6f, 0.8f, 0.0f }, { -0.6f, 0.0f, -0.8f }
+    };
+    for (const float* normal : special) {
+        normals.insert(normals.end(), normal, normal + 3);
+    }
+    return normals;
+}
+
+} // namespace
+
+TEST(VertexQuantization, EveryHalfSurvivesARoundTrip) {
+    for (uint32_t half = 0; half <= 0xFFFF; ++half) {
+        const uint16_t result = FloatToHalf(HalfToFloat(static_cast<uint16_t>(half)));
+        if (IsHalfNaN(static_cast<uint16_t>(half))) {
+            ASSERT_TRUE(IsHalfNaN(result));
+            ASSERT_EQ(result & 0x8000, half & 0x8000);
+        } else {
+            ASSERT_EQ(result, half);
+        }
+    }
+}
+
+TEST(VertexQuantization, FloatsRoundToTheNearestHalfWithTiesToEven) {
+    // Every finite half and the next one, subnormals included. The midpoint is exact in a float.
+    for (uint32_t half = 0; half < 0x7BFF; ++half) {
+        const float low = HalfToFloat(static_cast<uint16_t>(half));
+        const float high = HalfToFloat(static_cast<uint16_t>(half + 1));
+        const float middle = (low + high) * 0.5f;
+        const uint16_t even = static_cast<uint16_t>(half & 1 ? half + 1 : half);
+
+        ASSERT_EQ(FloatToHalf(middle), even);
+        ASSERT_EQ(FloatToHalf(-middle), even | 0x8000);
+        ASSERT_EQ(FloatToHalf(std::nextafter(middle, 0.0f)), half);
+        ASSERT_EQ(FloatToHalf(std::nextafter(middle, high)), half + 1);
+    }
+
+    // Below half the smallest subnormal everything is zero.
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -26)), 0u);
+    EXPECT_EQ(FloatToHalf(MakeFloat(1)), 0u);
+    EXPECT_EQ(FloatToHalf(-std::ldexp(1.0f, -30)), 0x8000u);
+}
+
+TEST(VertexQuantization, FloatsOutOfRangeBecomeInfinity) {
+    // 65504 is the largest half, 65520 is halfway to the next power of two and rounds to even, which is infinity.
+    EXPECT_EQ(FloatToHalf(65504.0f), 0x7BFFu);
+    EXPECT_EQ(FloatToHalf(std::nextafter(65520.0f, 0.0f)), 0x7BFFu);
+    EXPECT_EQ(FloatToHalf(65520.0f), 0x7C00u);
+    EXPECT_EQ(FloatToHalf(-65520.0f), 0xFC00u);
+    EXPECT_EQ(FloatToHalf(1.0e10f), 0x7C00u);
+    EXPECT_EQ(FloatToHalf(MakeFloat(0x7F7FFFFF)), 0x7C00u);
+    EXPECT_EQ(FloatToHalf(MakeFloat(0x7F800000)), 0x7C00u);
+    EXPECT_EQ(FloatToHalf(MakeFloat(0xFF800000)), 0xFC00u);
+    EXPECT_TRUE(IsHalfNaN(FloatToHalf(MakeFloat(0x7FC00000))));
+    EXPECT_TRUE(IsHalfNaN(FloatToHalf(MakeFloat(0x7F800001))));
+}
+
+TEST(VertexQuantization, OctahedralNormalsAreAccurateToAFewThousandthsOfADegree) {
+    const std::vector<float> normals = SphereNormals(200000);
+    const MeshFileBounds bounds = {};
+
+    double maxExactError = 0.0;
+    double maxPackedError = 0.0;
+    for (size_t i = 0; i < normals.size(); i += 3) {
+        const float* normal = &normals[i];
+
+        float encoded[2];
+        EncodeOctahedral(normal, encoded);
+        ASSERT_LE(std::abs(encoded[0]), 1.0f);
+        ASSERT_LE(std::abs(encoded[1]), 1.0f);
+        float decoded[3];
+        DecodeOctahedral(encoded, decoded);
+        maxExactError = std::max(maxExactError, AngleDegrees(normal, decoded));
+
+        uint8_t packed[4];
+        EncodeAttribute(MeshSemantic::Normal, MeshAttributeFormat::R16G16_SNorm, normal, bounds, packed);
+        DecodeAttribute(MeshSemantic::Normal, MeshAttributeFormat::R16G16_SNorm, packed, bounds, decoded);
+        maxPackedError = std::max(maxPackedError, AngleDegrees(normal, decoded));
+    }
+
+    EXPECT_LT(maxExactError, 0.001);
+    // Two 16 bit components give at most about 0.0036 degrees, well within 0.04.
+    EXPECT_LT(maxPackedError, 0.005);
+
+    // A zero normal stays finite.
+    const float zero[3] = { 0.0f, 0.0f, 0.0f };
+    float encoded[2];
+    EncodeOctahedral(zero, encoded);
+    EXPECT_EQ(encoded[0], 0.0f);
+    EXPECT_EQ(encoded[1], 0.0f);
+}
+
+TEST(VertexQuantization, EveryFormatRoundTripsWithinItsPrecision) {
+    const MeshSemantic semantics[] = { MeshSemantic::Position, MeshSemantic::Normal, MeshSemantic::Color, MeshSemantic::TexCoord };
+    const MeshAttributeFormat formats[] = {
+        MeshAttributeFormat::R32G32B32_Float, MeshAttributeFormat::R32G32_Float, MeshAttributeFormat::R16G16B16A16_UNorm,
+        MeshAttributeFormat::R16G16_SNorm, MeshAttributeFormat::R8G8B8A8_UNorm, MeshAttributeFormat::R16G16_Float
+    };
+    const MeshFileBounds bounds = { { -2.0f, 0.5f, -100.0f }, { 3.0f, 0.5f, 28.0f } };
+    const std::vector<float> normals = SphereNormals(1000);
+
+    uint32_t numCombinations = 0;
+    for (MeshSemantic semantic : semantics) {
+        for (MeshAttributeFormat format : formats) {
+            if (!IsMeshAttributeFormatSupported(semantic, format)) {
+                continue;
+            }
+            ++numCombinations;
+            const uint32_t size = GetMeshAttributeFormatSize(format);
+            const uint32_t numComponents = GetMeshSemanticNumComponents(semantic);
+
+            for (uint32_t i = 0; i < 1000; ++i) {
+                float value[3];
+                float tolerance[3];
+                for (uint32_t c = 0; c < 3; ++c) {
+                    const float t = ((i * 7919 + c * 104729) % 1000) / 999.0f;
+                    switch (semantic) {
+                        case MeshSemantic::Position:
+                            value[c] = bounds.Min[c] + t * (bounds.Max[c] - bounds.Min[c]);
+                            tolerance[c] = format == MeshAttributeFormat::R32G32B32_Float ? 0.0f :
+                                (bounds.Max[c] - bounds.Min[c]) / 65535.0f * 0.5f + 1.0e-5f;
+                            break;
+                        case MeshSemantic::Normal:
+                            value[c] = normals[i * 3 + c];
+                            // Components of the angle bound checked above.
+                            tolerance[c] = format == MeshAttributeFormat::R32G32B32_Float ? 0.0f : 0.0001f;
+                            break;
+                        case MeshSemantic::Color:
+                            value[c] = t;
+                            tolerance[c] = format == MeshAttributeFormat::R32G32B32_Float ? 0.0f : 0.5f / 255.0f + 1.0e-6f;
+                            break;
+                        case MeshSemantic::TexCoord:
+                            // Texture coordinates repeat, they go beyond [0, 1].
+                            value[c] = (t - 0.25f) * 8.0f;
+                            tolerance[c] = format == MeshAttributeFormat::R32G32_Float ? 0.0f :
+                                std::abs(value[c]) * std::ldexp(1.0f, -11) + std::ldexp(1.0f, -25);
+                            break;
+                    }
+                }
+
+                // The attribute is written in exactly the size of the format.
+                uint8_t packed[16];
+                std::memset(packed, 0xCD, sizeof(packed));
+                EncodeAttribute(semantic, format, value, bounds, packed);
+                for (uint32_t b = size; b < sizeof(packed); ++b) {
+                    ASSERT_EQ(packed[b], 0xCDu);
+                }
+
+                float decoded[3];
+                DecodeAttribute(semantic, format, packed, bounds, decoded);
+                for (uint32_t c = 0; c < numComponents; ++c) {
+                    ASSERT_NEAR(decoded[c], value[c], tolerance[c]);
+                }
+            }
+        }
+    }
+    EXPECT_EQ(numCombinations, 8u);
+}
+
+TEST(VertexQuantization, DequantizedPositionsMatchTheDecodedOnes) {
+    const MeshFileBounds bounds = { { -2.0f, 0.5f, -100.0f }, { 3.0f, 0.5f, 28.0f } };
+    const float position[3] = { 1.25f, 0.5f, -3.0f };
+
+    uint16_t packed[4];
+    EncodeAttribute(MeshSemantic::Position, MeshAttributeFormat::R16G16B16A16_UNorm, position, bounds,
+        reinterpret_cast<uint8_t*>(packed));
+    // The flat axis of the bounds encodes to 0, the input assembler sets w to the last component.
+    EXPECT_EQ(packed[1], 0u);
+    EXPECT_EQ(packed[3], 0u);
+
+    float decoded[3];
+    DecodeAttribute(MeshSemantic::Position, MeshAttributeFormat::R16G16B16A16_UNorm, reinterpret_cast<const uint8_t*>(packed),
+        bounds, decoded);
+    float scale[3];
+    float offset[3];
+    GetPositionDequantization(MeshAttributeFormat::R16G16B16A16_UNorm, bounds, scale, offset);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(scale[i] * (packed[i] / 65535.0f) + offset[i], decoded[i], 1.0e-5f);
+    }
+
+    GetPositionDequantization(MeshAttributeFormat::R32G32B32_Float, bounds, scale, offset);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(scale[i], 1.0f);
+        EXPECT_EQ(offset[i], 0.0f);
+    }
+}
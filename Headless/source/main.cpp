@@ -0,0 +1,460 @@
+/**
+ * Headless driver.
+ *
+ * Runs the CPU side of frames of the renderer core on the null RHI backend,
+ * without a window or a GPU, so it can be profiled and regression tested on
+ * any machine. Every frame
+ *
+ * - uploads buffers through the upload buffer of the direct queue and copies
+ *   them into default heap buffers, which are checked once the frame
+ *   context is reused,
+ * - allocates CPU descriptor ranges of varying sizes, freed through the
+ *   deferred release queue when the frame context is reused,
+ * - builds, compiles and executes a render graph with transient resources
+ *   and a pass that is culled,
+ *
+ * and is paced with a FramePacer. The time of each part is reported at the
+ * end, and the CPU profile can be saved as a Chrome trace. Returns 1 if any
+ * result is wrong.
+ */
+#include "commandqueue.h"
+#include "deferredreleasequeue.h"
+#include "descriptorallocator.h"
+#include "framepacer.h"
+#include "highresolutionclock.h"
+#include "profiler.h"
+#include "rendergraph.h"
+#include "resourcestatetracker.h"
+#include "rhinull.h"
+#include "uploadbuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint32_t numFrames;
+    uint32_t numFramesInFlight;
+    uint32_t numUploads;
+    uint32_t uploadSize;
+    uint32_t numDescriptorRanges;
+    std::string tracePath;
+};
+
+// Descriptor ranges are 1 to this many descriptors.
+const uint32_t MaxDescriptorRange = 8;
+// Upload and descriptor pages are recycled, more than this many means they leak.
+const size_t MaxPages = 64;
+
+void PrintUsage() {
+    std::printf(
+        "Usage: Headless [options]\n"
+        "\n"
+        "Options:\n"
+        "  --frames <n>            Frames to run, default 1000.\n"
+        "  --frames-in-flight <n>  Frames the CPU may queue ahead, default %u.\n"
+        "  --uploads <n>           Buffers uploaded per frame, default 64.\n"
+        "  --upload-size <bytes>   Size of each upload, default 16384.\n"
+        "  --descriptors <n>       Descriptor ranges allocated per frame, default 256.\n"
+        "  --trace <file>          Save the CPU profile as a Chrome trace.\n",
+        FramePacer::DefaultFramesInFlight);
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    options.numFrames = 1000;
+    options.numFramesInFlight = FramePacer::DefaultFramesInFlight;
+    options.numUploads = 64;
+    options.uploadSize = 16 * 1024;
+    options.numDescriptorRanges = 256;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--frames" && i + 1 < argc) {
+            options.numFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--frames-in-flight" && i + 1 < argc) {
+            options.numFramesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--uploads" && i + 1 < argc) {
+            options.numUploads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--upload-size" && i + 1 < argc) {
+            options.uploadSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--descriptors" && i + 1 < argc) {
+            options.numDescriptorRanges = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--trace" && i + 1 < argc) {
+            options.tracePath = argv[++i];
+        } else {
+            throw std::invalid_argument("Invalid arguments.");
+        }
+    }
+
+    if (options.numFrames == 0 || options.uploadSize == 0 || options.uploadSize % 4 != 0) {
+        throw std::invalid_argument("Invalid arguments.");
+    }
+    options.numFramesInFlight = FramePacer::ClampFramesInFlight(options.numFramesInFlight);
+    return options;
+}
+
+// Milliseconds spent in each part of the frames.
+struct Timings {
+    double uploadMs;
+    double descriptorMs;
+    double compileMs;
+    double executeMs;
+    double submitMs;
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(double& milliseconds)
+        : m_Milliseconds(milliseconds)
+        , m_Start(HighResolutionClock::Now()) {
+    }
+
+    ~ScopedTimer() {
+        m_Milliseconds += std::chrono::duration<double, std::milli>(HighResolutionClock::Now() - m_Start).count();
+    }
+
+private:
+    double& m_Milliseconds;
+    std::chrono::high_resolution_clock::time_point m_Start;
+};
+
+// The contents of an upload, different for every buffer and frame.
+uint32_t GetUploadValue(uint64_t frameNumber, uint32_t upload, uint32_t word) {
+    return static_cast<uint32_t>(frameNumber * 2654435761u) ^ (upload << 20) ^ word;
+}
+
+class HeadlessRenderer {
+public:
+    explicit HeadlessRenderer(const Options& options)
+        : m_Options(options)
+        , m_Device(std::make_shared<NullRHIDevice>())
+        , m_ResourceStateMap(std::make_shared<ResourceStateMap>())
+        , m_CommandQueue(std::make_shared<CommandQueue>(m_Device, RHIQueueType::Direct, m_ResourceStateMap))
+        , m_DeferredReleaseQueue(std::make_shared<DeferredReleaseQueue>(
+            std::vector< std::shared_ptr<CommandQueue> >{ m_CommandQueue }))
+        , m_DescriptorAllocator(std::make_shared<DescriptorAllocator>(m_Device, m_DeferredReleaseQueue,
+            RHIDescriptorHeapType::CbvSrvUav))
+        , m_RenderGraph(std::make_shared<RenderGraph>(m_Device, m_DeferredReleaseQueue))
+        , m_FramePacer(m_CommandQueue, options.numFramesInFlight)
+        , m_Timings()
+        , m_NumErrors(0) {
+        m_Frames.resize(FramePacer::MaxFramesInFlight);
+        for (FrameData& frame : m_Frames) {
+            for (uint32_t i = 0; i < options.numUploads; ++i) {
+                frame.buffers.push_back(m_Device->CreateCommittedResource(RHIHeapType::Default,
+                    RHIResourceDesc::Buffer(options.uploadSize), RHIResourceState_Common));
+                m_ResourceStateMap->AddResource(frame.buffers.back().get(), RHIResourceState_Common);
+            }
+        }
+
+        m_BackBuffer = m_Device->CreateCommittedResource(RHIHeapType::Default,
+            RHIResourceDesc::Tex2D(RHIFormat::R8G8B8A8_UNorm, Width, Height, RHIResourceFlag_AllowRenderTarget),
+            RHIResourceState_Present);
+        m_ResourceStateMap->AddResource(m_BackBuffer.get(), RHIResourceState_Present);
+    }
+
+    ~HeadlessRenderer() {
+        m_FramePacer.WaitForIdle();
+        m_DeferredReleaseQueue->Flush();
+
+        for (FrameData& frame : m_Frames) {
+            for (const auto& buffer : frame.buffers) {
+                m_ResourceStateMap->RemoveResource(buffer.get());
+            }
+        }
+        m_ResourceStateMap->RemoveResource(m_BackBuffer.get());
+    }
+
+    void Run() {
+        for (uint32_t frame = 0; frame < m_Options.numFrames; ++frame) {
+            RenderFrame();
+        }
+
+        // The frames in flight are checked once they are done.
+        m_FramePacer.WaitForIdle();
+        for (FrameData& frame : m_Frames) {
+            CheckUploads(frame);
+        }
+
+        if (m_CommandQueue->GetUploadBuffer().GetNumPages() > MaxPages || m_DescriptorAllocator->GetNumPages() > MaxPages) {
+            ReportError("Upload or descriptor pages are not recycled.");
+        }
+    }
+
+    const Timings& GetTimings() const {
+        return m_Timings;
+    }
+
+    uint32_t GetNumErrors() const {
+        return m_NumErrors;
+    }
+
+private:
+    static const uint32_t Width = 1920;
+    static const uint32_t Height = 1080;
+
+    struct FrameData {
+        // Zero if the frame context has not been used yet.
+        uint64_t frameNumber = 0;
+        std::vector< std::shared_ptr<RHIResource> > buffers;
+        std::vector<DescriptorAllocation> descriptors;
+    };
+
+    void RenderFrame() {
+        PROFILE_FUNCTION();
+
+        // The GPU is done with the frame that used the context last.
+        m_FramePacer.BeginFrame();
+        m_DeferredReleaseQueue->ReleaseCompleted();
+
+        FrameData& frame = m_Frames[m_FramePacer.GetFrameIndex()];
+        CheckUploads(frame);
+        frame.frameNumber = m_FramePacer.GetFrameNumber();
+
+        std::shared_ptr<RHICommandList> commandList = m_CommandQueue->GetCommandList();
+        ResourceStateTracker& tracker = m_CommandQueue->GetResourceStateTracker(commandList.get());
+
+        {
+            PROFILE_SCOPE("Upload");
+            ScopedTimer timer(m_Timings.uploadMs);
+            RecordUploads(frame, commandList.get(), tracker);
+        }
+        {
+            PROFILE_SCOPE("Descriptors");
+            ScopedTimer timer(m_Timings.descriptorMs);
+            AllocateDescriptors(frame);
+        }
+        {
+            PROFILE_SCOPE("Render Graph Compile");
+            ScopedTimer timer(m_Timings.compileMs);
+            BuildRenderGraph();
+            m_RenderGraph->Compile();
+        }
+        {
+            PROFILE_SCOPE("Render Graph Execute");
+            ScopedTimer timer(m_Timings.executeMs);
+            m_RenderGraph->Execute(commandList.get(), tracker);
+        }
+        {
+            PROFILE_SCOPE("Submit");
+            ScopedTimer timer(m_Timings.submitMs);
+            m_CommandQueue->ExecuteCommandList(commandList);
+            m_FramePacer.EndFrame(m_CommandQueue->Signal());
+        }
+
+        CheckRenderGraph();
+    }
+
+    void RecordUploads(FrameData& frame, RHICommandList* commandList, ResourceStateTracker& tracker) {
+        UploadBuffer& uploadBuffer = m_CommandQueue->GetUploadBuffer();
+        const uint32_t numWords = m_Options.uploadSize / 4;
+
+        for (uint32_t i = 0; i < m_Options.numUploads; ++i) {
+            UploadBuffer::Allocation allocation = uploadBuffer.Allocate(m_Options.uploadSize, 256);
+            uint32_t* words = static_cast<uint32_t*>(allocation.CPU);
+            for (uint32_t word = 0; word < numWords; ++word) {
+                words[word] = GetUploadValue(frame.frameNumber, i, word);
+            }
+
+            RHIResource* buffer = frame.buffers[i].get();
+            tracker.TransitionResource(buffer, RHIResourceState_CopyDest);
+            tracker.FlushResourceBarriers(commandList);
+            commandList->CopyBufferRegion(buffer, 0, allocation.Resource, allocation.Offset, m_Options.uploadSize);
+            tracker.TransitionResource(buffer, RHIResourceState_VertexAndConstantBuffer);
+        }
+        tracker.FlushResourceBarriers(commandList);
+    }
+
+    void CheckUploads(FrameData& frame) {
+        if (frame.frameNumber == 0) {
+            return;
+        }
+
+        const uint32_t numWords = m_Options.uploadSize / 4;
+        for (uint32_t i = 0; i < m_Options.numUploads; ++i) {
+            const uint32_t* words = reinterpret_cast<const uint32_t*>(
+                static_cast<NullRHIResource*>(frame.buffers[i].get())->GetData());
+            for (uint32_t word = 0; word < numWords; ++word) {
+                if (words[word] != GetUploadValue(frame.frameNumber, i, word)) {
+                    ReportError("An upload did not arrive in its buffer.");
+                    return;
+                }
+            }
+        }
+        frame.frameNumber = 0;
+    }
+
+    void AllocateDescriptors(FrameData& frame) {
+        // Freed ranges go through the deferred release queue, the GPU may still use them.
+        frame.descriptors.clear();
+
+        for (uint32_t i = 0; i < m_Options.numDescriptorRanges; ++i) {
+            const uint32_t numDescriptors = 1 + (i * 7 + static_cast<uint32_t>(m_FramePacer.GetFrameNumber())) % MaxDescriptorRange;
+            frame.descriptors.push_back(m_DescriptorAllocator->Allocate(numDescriptors));
+            if (frame.descriptors.back().GetNumHandles() != numDescriptors) {
+                ReportError("A descriptor range has the wrong size.");
+            }
+        }
+    }
+
+    // A deferred renderer: a G-buffer, lighting, a bloom chain and tonemapping into the back buffer.
+    // The debug view is not used by anything and is culled.
+    void BuildRenderGraph() {
+        RenderGraph& graph = *m_RenderGraph;
+        graph.Reset();
+
+        const auto colorTarget = [](RHIFormat format, uint32_t divisor) {
+            return RHIResourceDesc::Tex2D(format, Width / divisor, Height / divisor, RHIResourceFlag_AllowRenderTarget);
+        };
+
+        RenderGraphResource backBuffer = graph.ImportResource("Back Buffer", m_BackBuffer.get(), RHIResourceState_Present);
+        RenderGraphResource depth = graph.CreateResource("Depth",
+            RHIResourceDesc::Tex2D(RHIFormat::D32_Float, Width, Height, RHIResourceFlag_AllowDepthStencil));
+        RenderGraphResource albedo = graph.CreateResource("Albedo", colorTarget(RHIFormat::R8G8B8A8_UNorm, 1));
+        RenderGraphResource normals = graph.CreateResource("Normals", colorTarget(RHIFormat::R8G8B8A8_UNorm, 1));
+        RenderGraphResource lighting = graph.CreateResource("Lighting", colorTarget(RHIFormat::R8G8B8A8_UNorm, 1));
+        RenderGraphResource debugView = graph.CreateResource("Debug View", colorTarget(RHIFormat::R8G8B8A8_UNorm, 1));
+
+        const auto clear = [](RenderGraph&, RHICommandList* commandList) {
+            const float clearColor[4] = {};
+            commandList->ClearRenderTargetView(RHICPUDescriptorHandle{ 0 }, clearColor);
+        };
+        const auto draw = [](RenderGraph&, RHICommandList* commandList) {
+            commandList->DrawIndexedInstanced(3, 1, 0, 0, 0);
+        };
+
+        graph.AddPass("G-Buffer", [](RenderGraph&, RHICommandList* commandList) {
+            const float clearColor[4] = {};
+            commandList->ClearRenderTargetView(RHICPUDescriptorHandle{ 0 }, clearColor);
+            commandList->ClearDepthStencilView(RHICPUDescriptorHandle{ 0 }, 1.0f);
+            for (uint32_t i = 0; i < 100; ++i) {
+                commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+            }
+        })
+            .Write(depth, RHIResourceState_DepthWrite)
+            .Write(albedo, RHIResourceState_RenderTarget)
+            .Write(normals, RHIResourceState_RenderTarget);
+
+        graph.AddPass("Lighting", clear)
+            .Read(depth, RHIResourceState_PixelShaderResource)
+            .Read(albedo, RHIResourceState_PixelShaderResource)
+            .Read(normals, RHIResourceState_PixelShaderResource)
+            .Write(lighting, RHIResourceState_RenderTarget);
+
+        graph.AddPass("Debug View", draw)
+            .Read(normals, RHIResourceState_PixelShaderResource)
+            .Write(debugView, RHIResourceState_RenderTarget);
+
+        // Each bloom level is half the size of the previous one and only lives until the next level is made.
+        RenderGraphResource bloom = lighting;
+        for (uint32_t level = 1; level <= 4; ++level) {
+            RenderGraphResource next = graph.CreateResource("Bloom " + std::to_string(level),
+                colorTarget(RHIFormat::R8G8B8A8_UNorm, 2u << level));
+            graph.AddPass("Bloom Downsample " + std::to_string(level), clear)
+                .Read(bloom, RHIResourceState_PixelShaderResource)
+                .Write(next, RHIResourceState_RenderTarget);
+            bloom = next;
+        }
+
+        graph.AddPass("Tonemap", draw)
+            .Read(lighting, RHIResourceState_PixelShaderResource)
+            .Read(bloom, RHIResourceState_PixelShaderResource)
+            .Write(backBuffer, RHIResourceState_RenderTarget);
+    }
+
+    void CheckRenderGraph() {
+        const RenderGraph::Stats stats = m_RenderGraph->GetStats();
+        if (stats.numCulledPasses != 1 || stats.numPasses != 8) {
+            ReportError("The render graph did not cull exactly the debug view.");
+        }
+        if (stats.transientHeapBytes > stats.transientBytes || stats.numAliasingBarriers == 0) {
+            ReportError("The transient resources of the render graph are not aliased.");
+        }
+    }
+
+    void ReportError(const char* message) {
+        // Only the first error of each kind is interesting, the rest repeat every frame.
+        if (m_NumErrors++ < 16) {
+            std::fprintf(stderr, "Frame %llu: %s\n", static_cast<unsigned long long>(m_FramePacer.GetFrameNumber()), message);
+        }
+    }
+
+    Options m_Options;
+
+    std::shared_ptr<RHIDevice> m_Device;
+    std::shared_ptr<ResourceStateMap> m_ResourceStateMap;
+    std::shared_ptr<CommandQueue> m_CommandQueue;
+    std::shared_ptr<DeferredReleaseQueue> m_DeferredReleaseQueue;
+    std::shared_ptr<DescriptorAllocator> m_DescriptorAllocator;
+    std::shared_ptr<RenderGraph> m_RenderGraph;
+    FramePacer m_FramePacer;
+
+    std::vector<FrameData> m_Frames;
+    std::shared_ptr<RHIResource> m_BackBuffer;
+
+    Timings m_Timings;
+    uint32_t m_NumErrors;
+};
+
+void PrintTiming(const char* label, double milliseconds, uint32_t numFrames) {
+    std::printf("  %-24s %10.3f ms %10.2f us/frame\n", label, milliseconds, milliseconds * 1000.0 / numFrames);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Profiler::SetThreadName("Main");
+
+    Options options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
+
+    uint32_t numErrors = 0;
+    try {
+        HighResolutionClock clock;
+        HeadlessRenderer renderer(options);
+        renderer.Run();
+        clock.Tick();
+
+        const Timings& timings = renderer.GetTimings();
+        std::printf("%u frames, %u in flight, %.3f ms\n", options.numFrames, options.numFramesInFlight,
+            clock.GetDeltaMilliseconds());
+        PrintTiming("Upload", timings.uploadMs, options.numFrames);
+        PrintTiming("Descriptor allocation", timings.descriptorMs, options.numFrames);
+        PrintTiming("Render graph compile", timings.compileMs, options.numFrames);
+        PrintTiming("Render graph execute", timings.executeMs, options.numFrames);
+        PrintTiming("Submit", timings.submitMs, options.numFrames);
+
+        numErrors = renderer.GetNumErrors();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (!options.tracePath.empty()) {
+        if (!Profiler::SaveChromeTrace(options.tracePath)) {
+            std::fprintf(stderr, "Cannot write %s\n", options.tracePath.c_str());
+            return 1;
+        }
+        std::printf("Wrote %s\n", options.tracePath.c_str());
+    }
+
+    if (numErrors > 0) {
+        std::fprintf(stderr, "%u errors\n", numErrors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * Importers of source mesh formats.
+ *
+ * OBJ and glTF are right-handed with counter-clockwise front faces. The
+ * importers convert to the left-handed system of the renderer, with
+ * clockwise front faces, by negating z and reversing the winding. Texture
+ * coordinates of OBJ files are flipped to a top left origin. Errors throw
+ * std::runtime_error.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For uint32_t
+#include <string>   // For std::string
+#include <vector>   // For std::vector
+
+struct ImportedMesh {
+    struct Submesh {
+        uint32_t firstIndex;
+        uint32_t numIndices;
+    };
+
+    // Three floats per vertex.
+    std::vector<float> positions;
+    // Empty or three floats per vertex.
+    std::vector<float> normals;
+    std::vector<float> colors;
+    // Empty or two floats per vertex.
+    std::vector<float> texCoords;
+
+    std::vector<uint32_t> indices;
+    std::vector<Submesh> submeshes;
+
+    size_t GetNumVertices() const {
+        return positions.size() / 3;
+    }
+};
+
+// Faces are triangulated as fans. A submesh is started for every material, vertex colors
+// are read from the "v x y z r g b" extension.
+ImportedMesh ImportObj(const std::string& path);
+
+// Reads .gltf files with external or embedded buffers and .glb files. Every triangle primitive
+// of every mesh becomes a submesh. Node transforms are not applied.
+ImportedMesh ImportGltf(const std::string& path);
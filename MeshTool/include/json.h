@@ -0,0 +1,51 @@
+/**
+ * Minimal JSON reader for the glTF importer.
+ *
+ * Parses a document into a tree of values. Errors throw std::runtime_error
+ * with the offset of the problem.
+ */
+#pragma once
+
+#include <cstddef>  // For size_t
+#include <string>   // For std::string
+#include <utility>  // For std::pair
+#include <vector>   // For std::vector
+
+class JsonValue {
+public:
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    JsonValue();
+
+    static JsonValue Parse(const char* begin, const char* end);
+
+    Type GetType() const;
+    bool IsNull() const;
+
+    bool GetBool() const;
+    double GetNumber() const;
+    const std::string& GetString() const;
+
+    // The number of elements of an array.
+    size_t GetSize() const;
+    const JsonValue& operator[](size_t index) const;
+    // The member of an object with the key, or null if there is none.
+    const JsonValue* Find(const std::string& key) const;
+
+private:
+    class Parser;
+
+    Type m_Type;
+    bool m_Bool;
+    double m_Number;
+    std::string m_String;
+    std::vector<JsonValue> m_Array;
+    std::vector< std::pair<std::string, JsonValue> > m_Object;
+};
@@ -0,0 +1,397 @@
+#include "importer.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// "glTF"
+const uint32_t GlbMagic = 0x46546C67;
+const uint32_t GlbChunkJson = 0x4E4F534A;
+const uint32_t GlbChunkBin = 0x004E4942;
+
+enum GltfComponentType {
+    GltfComponentType_Byte = 5120,
+    GltfComponentType_UnsignedByte = 5121,
+    GltfComponentType_Short = 5122,
+    GltfComponentType_UnsignedShort = 5123,
+    GltfComponentType_UnsignedInt = 5125,
+    GltfComponentType_Float = 5126
+};
+
+const uint32_t GltfModeTriangles = 4;
+
+std::vector<uint8_t> ReadBinaryFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path + ".");
+    }
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+std::vector<uint8_t> DecodeBase64(const std::string& string, size_t begin) {
+    std::vector<uint8_t> data;
+    data.reserve((string.size() - begin) * 3 / 4);
+
+    uint32_t bits = 0;
+    int numBits = 0;
+    for (size_t i = begin; i < string.size() && string[i] != '='; ++i) {
+        char c = string[i];
+        uint32_t value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '+') {
+            value = 62;
+        } else if (c == '/') {
+            value = 63;
+        } else {
+            throw std::runtime_error("Invalid base64 data in a buffer URI.");
+        }
+
+        bits = (bits << 6) | value;
+        numBits += 6;
+        if (numBits >= 8) {
+            numBits -= 8;
+            data.push_back(static_cast<uint8_t>(bits >> numBits));
+        }
+    }
+    return data;
+}
+
+const JsonValue& GetMember(const JsonValue& object, const char* key) {
+    const JsonValue* member = object.Find(key);
+    if (!member) {
+        throw std::runtime_error(std::string("Missing \"") + key + "\".");
+    }
+    return *member;
+}
+
+size_t GetSize(const JsonValue& object, const char* key, size_t defaultValue) {
+    const JsonValue* member = object.Find(key);
+    return member ? static_cast<size_t>(member->GetNumber()) : defaultValue;
+}
+
+class GltfDocument {
+public:
+    GltfDocument(const std::string& path) {
+        std::vector<uint8_t> file = ReadBinaryFile(path);
+
+        uint32_t magic = 0;
+        if (file.size() >= 4) {
+            std::memcpy(&magic, file.data(), 4);
+        }
+
+        std::vector<uint8_t> binaryChunk;
+        if (magic == GlbMagic) {
+            // A binary container of a JSON chunk and an optional binary chunk.
+            size_t offset = 12;
+            const char* jsonBegin = nullptr;
+            const char* jsonEnd = nullptr;
+            while (offset + 8 <= file.size()) {
+                uint32_t chunkLength;
+                uint32_t chunkType;
+                std::memcpy(&chunkLength, &file[offset], 4);
+                std::memcpy(&chunkType, &file[offset + 4], 4);
+                offset += 8;
+                if (chunkLength > file.size() - offset) {
+                    throw std::runtime_error("Truncated chunk in " + path + ".");
+                }
+
+                if (chunkType == GlbChunkJson) {
+                    jsonBegin = reinterpret_cast<const char*>(&file[offset]);
+                    jsonEnd = jsonBegin + chunkLength;
+                } else if (chunkType == GlbChunkBin && binaryChunk.empty()) {
+                    binaryChunk.assign(file.begin() + offset, file.begin() + offset + chunkLength);
+                }
+                offset += chunkLength;
+            }
+            if (!jsonBegin) {
+                throw std::runtime_error("No JSON chunk in " + path + ".");
+            }
+            m_Document = JsonValue::Parse(jsonBegin, jsonEnd);
+        } else {
+            m_Document = JsonValue::Parse(reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data()) + file.size());
+        }
+
+        const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        const JsonValue* buffers = m_Document.Find("buffers");
+        for (size_t i = 0; buffers && i < buffers->GetSize(); ++i) {
+            const JsonValue* uri = (*buffers)[i].Find("uri");
+            if (!uri) {
+                // The first buffer of a binary container refers to the binary chunk.
+                m_Buffers.push_back(i == 0 ? std::move(binaryChunk) : std::vector<uint8_t>());
+            } else if (uri->GetString().compare(0, 5, "data:") == 0) {
+                size_t dataBegin = uri->GetString().find(";base64,");
+                if (dataBegin == std::string::npos) {
+                    throw std::runtime_error("Only base64 data URIs are supported.");
+                }
+                m_Buffers.push_back(DecodeBase64(uri->GetString(), dataBegin + 8));
+            } else {
+                m_Buffers.push_back(ReadBinaryFile(directory + uri->GetString()));
+            }
+
+            if (m_Buffers.back().size() < GetSize((*buffers)[i], "byteLength", 0)) {
+                throw std::runtime_error("Buffer " + std::to_string(i) + " is smaller than its byte length.");
+            }
+        }
+    }
+
+    const JsonValue& GetDocument() const {
+        return m_Document;
+    }
+
+    // Read the elements of an accessor as floats. Normalized integers are converted to [0, 1] or [-1, 1].
+    std::vector<float> ReadAccessor(size_t accessorIndex, size_t* numComponents) const {
+        const JsonValue& accessor = GetMember(m_Document, "accessors")[accessorIndex];
+        if (accessor.Find("sparse")) {
+            throw std::runtime_error("Sparse accessors are not supported.");
+        }
+
+        const std::string& type = GetMember(accessor, "type").GetString();
+        if (type == "SCALAR") {
+            *numComponents = 1;
+        } else if (type == "VEC2") {
+            *numComponents = 2;
+        } else if (type == "VEC3") {
+            *numComponents = 3;
+        } else if (type == "VEC4") {
+            *numComponents = 4;
+        } else {
+            throw std::runtime_error("Unsupported accessor type " + type + ".");
+        }
+
+        const uint32_t componentType = static_cast<uint32_t>(GetMember(accessor, "componentType").GetNumber());
+        size_t componentSize;
+        switch (componentType) {
+            case GltfComponentType_Byte:
+            case GltfComponentType_UnsignedByte:
+                componentSize = 1;
+                break;
+            case GltfComponentType_Short:
+            case GltfComponentType_UnsignedShort:
+                componentSize = 2;
+                break;
+            case GltfComponentType_UnsignedInt:
+            case GltfComponentType_Float:
+                componentSize = 4;
+                break;
+            default:
+                throw std::runtime_error("Unsupported component type " + std::to_string(componentType) + ".");
+        }
+        const JsonValue* normalizedMember = accessor.Find("normalized");
+        const bool normalized = normalizedMember && normalizedMember->GetBool();
+
+        const size_t count = GetSize(accessor, "count", 0);
+        std::vector<float> values(count * *numComponents, 0.0f);
+
+        // Accessors without a buffer view are all zeros.
+        const JsonValue* bufferViewIndex = accessor.Find("bufferView");
+        if (!bufferViewIndex || count == 0) {
+            return values;
+        }
+
+        const JsonValue& bufferView = GetMember(m_Document, "bufferViews")[static_cast<size_t>(bufferViewIndex->GetNumber())];
+        const size_t bufferIndex = static_cast<size_t>(GetMember(bufferView, "buffer").GetNumber());
+        if (bufferIndex >= m_Buffers.size()) {
+            throw std::runtime_error("Buffer index out of range.");
+        }
+        const std::vector<uint8_t>& buffer = m_Buffers[bufferIndex];
+
+        const size_t elementSize = componentSize * *numComponents;
+        const size_t stride = GetSize(bufferView, "byteStride", elementSize);
+        const size_t offset = GetSize(bufferView, "byteOffset", 0) + GetSize(accessor, "byteOffset", 0);
+        const size_t viewEnd = GetSize(bufferView, "byteOffset", 0) + GetSize(bufferView, "byteLength", 0);
+        if (viewEnd > buffer.size() || offset + stride * (count - 1) + elementSize > viewEnd) {
+            throw std::runtime_error("Accessor " + std::to_string(accessorIndex) + " is out of its buffer view.");
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t* element = &buffer[offset + i * stride];
+            for (size_t j = 0; j < *numComponents; ++j) {
+                const uint8_t* component = element + j * componentSize;
+                float value = 0.0f;
+                switch (componentType) {
+                    case GltfComponentType_Byte: {
+                        int8_t v;
+                        std::memcpy(&v, component, 1);
+                        value = normalized ? std::max(v / 127.0f, -1.0f) : v;
+                        break;
+                    }
+                    case GltfComponentType_UnsignedByte:
+                        value = normalized ? *component / 255.0f : *component;
+                        break;
+                    case GltfComponentType_Short: {
+                        int16_t v;
+                        std::memcpy(&v, component, 2);
+                        value = normalized ? std::max(v / 32767.0f, -1.0f) : v;
+                        break;
+                    }
+                    case GltfComponentType_UnsignedShort: {
+                        uint16_t v;
+                        std::memcpy(&v, component, 2);
+                        value = normalized ? v / 65535.0f : v;
+                        break;
+                    }
+                    case GltfComponentType_UnsignedInt: {
+                        uint32_t v;
+                        std::memcpy(&v, component, 4);
+                        value = static_cast<float>(v);
+                        break;
+                    }
+                    case GltfComponentType_Float:
+                        std::memcpy(&value, component, 4);
+                        break;
+                }
+                values[i * *numComponents + j] = value;
+            }
+        }
+        return values;
+    }
+
+    // Indices are read exactly, floats cannot represent all 32-bit values.
+    std::vector<uint32_t> ReadIndices(size_t accessorIndex) const {
+        const JsonValue& accessor = GetMember(m_Document, "accessors")[accessorIndex];
+        const uint32_t componentType = static_cast<uint32_t>(GetMember(accessor, "componentType").GetNumber());
+        if (componentType != GltfComponentType_UnsignedInt) {
+            size_t numComponents;
+            std::vector<float> values = ReadAccessor(accessorIndex, &numComponents);
+            return std::vector<uint32_t>(values.begin(), values.end());
+        }
+
+        const size_t count = GetSize(accessor, "count", 0);
+        std::vector<uint32_t> indices(count, 0);
+        const JsonValue* bufferViewIndex = accessor.Find("bufferView");
+        if (!bufferViewIndex || count == 0) {
+            return indices;
+        }
+
+        const JsonValue& bufferView = GetMember(m_Document, "bufferViews")[static_cast<size_t>(bufferViewIndex->GetNumber())];
+        const size_t bufferIndex = static_cast<size_t>(GetMember(bufferView, "buffer").GetNumber());
+        const size_t offset = GetSize(bufferView, "byteOffset", 0) + GetSize(accessor, "byteOffset", 0);
+        if (bufferIndex >= m_Buffers.size() || offset + count * 4 > m_Buffers[bufferIndex].size()) {
+            throw std::runtime_error("Accessor " + std::to_string(accessorIndex) + " is out of its buffer.");
+        }
+        std::memcpy(indices.data(), &m_Buffers[bufferIndex][offset], count * 4);
+        return indices;
+    }
+
+private:
+    JsonValue m_Document;
+    std::vector< std::vector<uint8_t> > m_Buffers;
+};
+
+}
+
+ImportedMesh ImportGltf(const std::string& path) {
+    GltfDocument document(path);
+
+    ImportedMesh mesh;
+    bool hasNormals = false;
+    bool hasColors = false;
+    bool hasTexCoords = false;
+
+    // Attributes a primitive does not have are filled with defaults, in case another primitive has them.
+    std::vector<float> normals;
+    std::vector<float> colors;
+    std::vector<float> texCoords;
+
+    const JsonValue* meshes = document.GetDocument().Find("meshes");
+    for (size_t i = 0; meshes && i < meshes->GetSize(); ++i) {
+        const JsonValue& primitives = GetMember((*meshes)[i], "primitives");
+        for (size_t j = 0; j < primitives.GetSize(); ++j) {
+            const JsonValue& primitive = primitives[j];
+            if (GetSize(primitive, "mode", GltfModeTriangles) != GltfModeTriangles) {
+                continue;
+            }
+
+            const JsonValue& attributes = GetMember(primitive, "attributes");
+            const uint32_t firstVertex = static_cast<uint32_t>(mesh.GetNumVertices());
+
+            size_t numComponents;
+            std::vector<float> positions = document.ReadAccessor(static_cast<size_t>(GetMember(attributes, "POSITION").GetNumber()), &numComponents);
+            if (numComponents != 3) {
+                throw std::runtime_error("Positions must have three components.");
+            }
+            const size_t numVertices = positions.size() / 3;
+            for (size_t k = 0; k < numVertices; ++k) {
+                mesh.positions.insert(mesh.positions.end(), { positions[k * 3 + 0], positions[k * 3 + 1], -positions[k * 3 + 2] });
+            }
+
+            normals.assign(numVertices * 3, 0.0f);
+            if (const JsonValue* accessor = attributes.Find("NORMAL")) {
+                std::vector<float> values = document.ReadAccessor(static_cast<size_t>(accessor->GetNumber()), &numComponents);
+                for (size_t k = 0; k < numVertices && numComponents == 3 && k * 3 + 2 < values.size(); ++k) {
+                    normals[k * 3 + 0] = values[k * 3 + 0];
+                    normals[k * 3 + 1] = values[k * 3 + 1];
+                    normals[k * 3 + 2] = -values[k * 3 + 2];
+                }
+                hasNormals = true;
+            }
+
+            colors.assign(numVertices * 3, 1.0f);
+            if (const JsonValue* accessor = attributes.Find("COLOR_0")) {
+                // RGB or RGBA, the alpha is dropped.
+                std::vector<float> values = document.ReadAccessor(static_cast<size_t>(accessor->GetNumber()), &numComponents);
+                for (size_t k = 0; k < numVertices && numComponents >= 3 && k * numComponents + 2 < values.size(); ++k) {
+                    std::copy(&values[k * numComponents], &values[k * numComponents] + 3, &colors[k * 3]);
+                }
+                hasColors = true;
+            }
+
+            texCoords.assign(numVertices * 2, 0.0f);
+            if (const JsonValue* accessor = attributes.Find("TEXCOORD_0")) {
+                std::vector<float> values = document.ReadAccessor(static_cast<size_t>(accessor->GetNumber()), &numComponents);
+                for (size_t k = 0; k < numVertices && numComponents == 2 && k * 2 + 1 < values.size(); ++k) {
+                    texCoords[k * 2 + 0] = values[k * 2 + 0];
+                    texCoords[k * 2 + 1] = values[k * 2 + 1];
+                }
+                hasTexCoords = true;
+            }
+
+            mesh.normals.insert(mesh.normals.end(), normals.begin(), normals.end());
+            mesh.colors.insert(mesh.colors.end(), colors.begin(), colors.end());
+            mesh.texCoords.insert(mesh.texCoords.end(), texCoords.begin(), texCoords.end());
+
+            std::vector<uint32_t> indices;
+            if (const JsonValue* accessor = primitive.Find("indices")) {
+                indices = document.ReadIndices(static_cast<size_t>(accessor->GetNumber()));
+            } else {
+                indices.resize(numVertices);
+                for (size_t k = 0; k < numVertices; ++k) {
+                    indices[k] = static_cast<uint32_t>(k);
+                }
+            }
+
+            // Reverse the winding for the clockwise front faces of the renderer.
+            const uint32_t firstIndex = static_cast<uint32_t>(mesh.indices.size());
+            for (size_t k = 0; k + 2 < indices.size(); k += 3) {
+                if (indices[k] >= numVertices || indices[k + 1] >= numVertices || indices[k + 2] >= numVertices) {
+                    throw std::runtime_error("Index out of the vertices of the primitive.");
+                }
+                mesh.indices.insert(mesh.indices.end(), { firstVertex + indices[k], firstVertex + indices[k + 2], firstVertex + indices[k + 1] });
+            }
+            mesh.submeshes.push_back(ImportedMesh::Submesh{ firstIndex, static_cast<uint32_t>(mesh.indices.size()) - firstIndex });
+        }
+    }
+
+    if (!hasNormals) {
+        mesh.normals.clear();
+    }
+    if (!hasColors) {
+        mesh.colors.clear();
+    }
+    if (!hasTexCoords) {
+        mesh.texCoords.clear();
+    }
+
+    return mesh;
+}
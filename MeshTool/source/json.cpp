@@ -0,0 +1,288 @@
+#include "json.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+class JsonValue::Parser {
+public:
+    Parser(const char* begin, const char* end)
+        : m_Begin(begin)
+        , m_Current(begin)
+        , m_End(end) {
+    }
+
+    JsonValue ParseDocument() {
+        JsonValue value = ParseValue(0);
+        SkipWhitespace();
+        if (m_Current != m_End) {
+            Fail("Unexpected data after the document");
+        }
+        return value;
+    }
+
+private:
+    // Deeper documents are rejected instead of overflowing the stack.
+    static const int MaxDepth = 256;
+
+    void Fail(const char* message) const {
+        throw std::runtime_error(std::string(message) + " at offset " + std::to_string(m_Current - m_Begin) + ".");
+    }
+
+    void SkipWhitespace() {
+        while (m_Current != m_End && (*m_Current == ' ' || *m_Current == '\t' || *m_Current == '\n' || *m_Current == '\r')) {
+            ++m_Current;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipWhitespace();
+        if (m_Current != m_End && *m_Current == c) {
+            ++m_Current;
+            return true;
+        }
+        return false;
+    }
+
+    void Expect(char c) {
+        if (!Consume(c)) {
+            Fail((std::string("Expected '") + c + "'").c_str());
+        }
+    }
+
+    bool ConsumeLiteral(const char* literal) {
+        const char* current = m_Current;
+        for (; *literal; ++literal, ++current) {
+            if (current == m_End || *current != *literal) {
+                return false;
+            }
+        }
+        m_Current = current;
+        return true;
+    }
+
+    JsonValue ParseValue(int depth) {
+        if (depth > MaxDepth) {
+            Fail("The document is nested too deeply");
+        }
+
+        SkipWhitespace();
+        if (m_Current == m_End) {
+            Fail("Unexpected end of the document");
+        }
+
+        JsonValue value;
+        switch (*m_Current) {
+            case '{':
+                ++m_Current;
+                value.m_Type = Type::Object;
+                if (!Consume('}')) {
+                    do {
+                        SkipWhitespace();
+                        std::string key = ParseString();
+                        Expect(':');
+                        value.m_Object.emplace_back(std::move(key), ParseValue(depth + 1));
+                    } while (Consume(','));
+                    Expect('}');
+                }
+                break;
+            case '[':
+                ++m_Current;
+                value.m_Type = Type::Array;
+                if (!Consume(']')) {
+                    do {
+                        value.m_Array.push_back(ParseValue(depth + 1));
+                    } while (Consume(','));
+                    Expect(']');
+                }
+                break;
+            case '"':
+                value.m_Type = Type::String;
+                value.m_String = ParseString();
+                break;
+            default:
+                if (ConsumeLiteral("true")) {
+                    value.m_Type = Type::Bool;
+                    value.m_Bool = true;
+                } else if (ConsumeLiteral("false")) {
+                    value.m_Type = Type::Bool;
+                } else if (ConsumeLiteral("null")) {
+                    value.m_Type = Type::Null;
+                } else {
+                    value.m_Type = Type::Number;
+                    value.m_Number = ParseNumber();
+                }
+                break;
+        }
+        return value;
+    }
+
+    double ParseNumber() {
+        // strtod needs a terminated string, numbers are short.
+        std::string number;
+        while (m_Current != m_End && (std::isdigit(static_cast<unsigned char>(*m_Current)) || *m_Current == '-' ||
+            *m_Current == '+' || *m_Current == '.' || *m_Current == 'e' || *m_Current == 'E')) {
+            number += *m_Current++;
+        }
+
+        char* numberEnd = nullptr;
+        double value = std::strtod(number.c_str(), &numberEnd);
+        if (number.empty() || numberEnd != number.c_str() + number.size()) {
+            Fail("Invalid value");
+        }
+        return value;
+    }
+
+    static void AppendUtf8(std::string& string, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            string += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            string += static_cast<char>(0xC0 | (codePoint >> 6));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            string += static_cast<char>(0xE0 | (codePoint >> 12));
+            string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            string += static_cast<char>(0xF0 | (codePoint >> 18));
+            string += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    uint32_t ParseHex4() {
+        if (m_End - m_Current < 4) {
+            Fail("Invalid escape sequence");
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *m_Current++;
+            value <<= 4;
+            if (c >= '0' && c <= '9') {
+                value |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                value |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                value |= c - 'A' + 10;
+            } else {
+                Fail("Invalid escape sequence");
+            }
+        }
+        return value;
+    }
+
+    std::string ParseString() {
+        if (m_Current == m_End || *m_Current != '"') {
+            Fail("Expected a string");
+        }
+        ++m_Current;
+
+        std::string string;
+        for (;;) {
+            if (m_Current == m_End) {
+                Fail("Unterminated string");
+            }
+
+            char c = *m_Current++;
+            if (c == '"') {
+                return string;
+            }
+            if (c != '\\') {
+                string += c;
+                continue;
+            }
+
+            if (m_Current == m_End) {
+                Fail("Unterminated string");
+            }
+            switch (*m_Current++) {
+                case '"': string += '"'; break;
+                case '\\': string += '\\'; break;
+                case '/': string += '/'; break;
+                case 'b': string += '\b'; break;
+                case 'f': string += '\f'; break;
+                case 'n': string += '\n'; break;
+                case 'r': string += '\r'; break;
+                case 't': string += '\t'; break;
+                case 'u': {
+                    uint32_t codePoint = ParseHex4();
+                    // Characters outside of the basic plane are encoded as surrogate pairs.
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && m_End - m_Current >= 2 && m_Current[0] == '\\' && m_Current[1] == 'u') {
+                        m_Current += 2;
+                        uint32_t low = ParseHex4();
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(string, codePoint);
+                    break;
+                }
+                default:
+                    Fail("Invalid escape sequence");
+            }
+        }
+    }
+
+    const char* m_Begin;
+    const char* m_Current;
+    const char* m_End;
+};
+
+JsonValue::JsonValue()
+    : m_Type(Type::Null)
+    , m_Bool(false)
+    , m_Number(0.0) {
+}
+
+JsonValue JsonValue::Parse(const char* begin, const char* end) {
+    return Parser(begin, end).ParseDocument();
+}
+
+JsonValue::Type JsonValue::GetType() const {
+    return m_Type;
+}
+
+bool JsonValue::IsNull() const {
+    return m_Type == Type::Null;
+}
+
+bool JsonValue::GetBool() const {
+    if (m_Type != Type::Bool) {
+        throw std::runtime_error("Expected a boolean.");
+    }
+    return m_Bool;
+}
+
+double JsonValue::GetNumber() const {
+    if (m_Type != Type::Number) {
+        throw std::runtime_error("Expected a number.");
+    }
+    return m_Number;
+}
+
+const std::string& JsonValue::GetString() const {
+    if (m_Type != Type::String) {
+        throw std::runtime_error("Expected a string.");
+    }
+    return m_String;
+}
+
+size_t JsonValue::GetSize() const {
+    return m_Type == Type::Array ? m_Array.size() : 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    if (index >= GetSize()) {
+        throw std::runtime_error("Array index " + std::to_string(index) + " is out of range.");
+    }
+    return m_Array[index];
+}
+
+const JsonValue* JsonValue::Find(const std::string& key) const {
+    for (const auto& member : m_Object) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,463 @@
+/**
+ * Offline mesh tool.
+ *
+ * Imports an OBJ or glTF file, optimizes it for the vertex cache, overdraw
+ * and vertex fetch, and writes it in the runtime mesh format. Reports the
+ * vertex cache and fetch efficiency before and after.
+ *
+ * The first stream holds position and color, which is what the renderer
+ * draws with. Normals and texture coordinates, if any, go to a second stream.
+ * Attributes are stored as floats unless packed formats are chosen, see
+ * vertexquantization.h. Meshlets for the mesh shader path are optional.
+ * So are coarser levels of detail, simplified from the optimized triangles
+ * and stored as extra index ranges of the submeshes.
+ */
+#include "importer.h"
+#include "meshfile.h"
+#include "meshlet.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "vertexquantization.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string inputPath;
+    std::string outputPath;
+    uint32_t cacheSize;
+    float overdrawThreshold;
+    bool optimizeVertexCache;
+    bool optimizeOverdraw;
+    bool optimizeVertexFetch;
+    MeshAttributeFormat positionFormat;
+    MeshAttributeFormat normalFormat;
+    MeshAttributeFormat colorFormat;
+    MeshAttributeFormat texCoordFormat;
+    bool buildMeshlets;
+    uint32_t numLods;
+    float lodRatio;
+};
+
+// A level stops the chain if it keeps more than this share of the triangles of the previous one.
+const float MinLodReduction = 0.9f;
+
+// Names of the formats on the command line, the first of each semantic is the default.
+struct FormatName {
+    MeshSemantic semantic;
+    const char* name;
+    MeshAttributeFormat format;
+};
+
+const FormatName FormatNames[] = {
+    { MeshSemantic::Position, "float", MeshAttributeFormat::R32G32B32_Float },
+    { MeshSemantic::Position, "unorm16", MeshAttributeFormat::R16G16B16A16_UNorm },
+    { MeshSemantic::Normal, "float", MeshAttributeFormat::R32G32B32_Float },
+    { MeshSemantic::Normal, "oct16", MeshAttributeFormat::R16G16_SNorm },
+    { MeshSemantic::Color, "float", MeshAttributeFormat::R32G32B32_Float },
+    { MeshSemantic::Color, "unorm8", MeshAttributeFormat::R8G8B8A8_UNorm },
+    { MeshSemantic::TexCoord, "float", MeshAttributeFormat::R32G32_Float },
+    { MeshSemantic::TexCoord, "half", MeshAttributeFormat::R16G16_Float },
+};
+
+void PrintUsage() {
+    std::printf(
+        "Usage: MeshTool <input.obj|input.gltf|input.glb> <output.mesh> [options]\n"
+        "\n"
+        "Options:\n"
+        "  --cache-size <n>              Vertex cache size of the report, default %u.\n"
+        "  --overdraw-threshold <ratio>  ACMR increase allowed for overdraw reordering, default %.2f.\n"
+        "  --no-vertex-cache             Keep the triangle order.\n"
+        "  --no-overdraw                 Skip overdraw reordering.\n"
+        "  --no-vertex-fetch             Keep the vertex order.\n"
+        "  --positions <float|unorm16>   Format of positions, unorm16 is relative to the bounds.\n"
+        "  --normals <float|oct16>       Format of normals, oct16 is octahedral.\n"
+        "  --colors <float|unorm8>       Format of colors.\n"
+        "  --texcoords <float|half>      Format of texture coordinates.\n"
+        "  --quantize                    Pack all attributes: unorm16, oct16, unorm8 and half.\n"
+        "  --meshlets                    Build meshlets of up to %u vertices and %u triangles.\n"
+        "  --lods <n>                    Build up to n coarser levels of detail, default 0.\n"
+        "  --lod-ratio <ratio>           Triangles of a level relative to the previous one, default 0.5.\n",
+        DefaultVertexCacheSize, DefaultOverdrawThreshold, MaxMeshletVertices, MaxMeshletTriangles);
+}
+
+MeshAttributeFormat ParseFormat(MeshSemantic semantic, const std::string& name) {
+    for (const FormatName& formatName : FormatNames) {
+        if (formatName.semantic == semantic && name == formatName.name) {
+            return formatName.format;
+        }
+    }
+    throw std::runtime_error("Unknown attribute format " + name + ".");
+}
+
+bool EndsWith(const std::string& string, const char* suffix) {
+    const size_t length = std::strlen(suffix);
+    if (string.size() < length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if (std::tolower(static_cast<unsigned char>(string[string.size() - length + i])) != suffix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    options.cacheSize = DefaultVertexCacheSize;
+    options.overdrawThreshold = DefaultOverdrawThreshold;
+    options.optimizeVertexCache = true;
+    options.optimizeOverdraw = true;
+    options.optimizeVertexFetch = true;
+    options.positionFormat = MeshAttributeFormat::R32G32B32_Float;
+    options.normalFormat = MeshAttributeFormat::R32G32B32_Float;
+    options.colorFormat = MeshAttributeFormat::R32G32B32_Float;
+    options.texCoordFormat = MeshAttributeFormat::R32G32_Float;
+    options.buildMeshlets = false;
+    options.numLods = 0;
+    options.lodRatio = 0.5f;
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--cache-size" && i + 1 < argc) {
+            options.cacheSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--overdraw-threshold" && i + 1 < argc) {
+            options.overdrawThreshold = std::strtof(argv[++i], nullptr);
+        } else if (argument == "--no-vertex-cache") {
+            options.optimizeVertexCache = false;
+        } else if (argument == "--no-overdraw") {
+            options.optimizeOverdraw = false;
+        } else if (argument == "--no-vertex-fetch") {
+            options.optimizeVertexFetch = false;
+        } else if (argument == "--positions" && i + 1 < argc) {
+            options.positionFormat = ParseFormat(MeshSemantic::Position, argv[++i]);
+        } else if (argument == "--normals" && i + 1 < argc) {
+            options.normalFormat = ParseFormat(MeshSemantic::Normal, argv[++i]);
+        } else if (argument == "--colors" && i + 1 < argc) {
+            options.colorFormat = ParseFormat(MeshSemantic::Color, argv[++i]);
+        } else if (argument == "--texcoords" && i + 1 < argc) {
+            options.texCoordFormat = ParseFormat(MeshSemantic::TexCoord, argv[++i]);
+        } else if (argument == "--quantize") {
+            options.positionFormat = MeshAttributeFormat::R16G16B16A16_UNorm;
+            options.normalFormat = MeshAttributeFormat::R16G16_SNorm;
+            options.colorFormat = MeshAttributeFormat::R8G8B8A8_UNorm;
+            options.texCoordFormat = MeshAttributeFormat::R16G16_Float;
+        } else if (argument == "--meshlets") {
+            options.buildMeshlets = true;
+        } else if (argument == "--lods" && i + 1 < argc) {
+            options.numLods = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--lod-ratio" && i + 1 < argc) {
+            options.lodRatio = std::strtof(argv[++i], nullptr);
+        } else if (argument.compare(0, 2, "--") == 0) {
+            throw std::runtime_error("Unknown option " + argument + ".");
+        } else {
+            paths.push_back(argument);
+        }
+    }
+
+    if (paths.size() != 2 || options.cacheSize == 0 || !(options.lodRatio > 0.0f && options.lodRatio < 1.0f)) {
+        throw std::invalid_argument("Invalid arguments.");
+    }
+    options.inputPath = paths[0];
+    options.outputPath = paths[1];
+    return options;
+}
+
+void PrintStatistics(const char* label, const ImportedMesh& mesh, const Options& options) {
+    // The first stream is what the vertex shader fetches.
+    const size_t vertexSize = GetMeshAttributeFormatSize(options.positionFormat) + GetMeshAttributeFormatSize(options.colorFormat);
+    VertexCacheStatistics cache = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.GetNumVertices(), options.cacheSize);
+    VertexFetchStatistics fetch = AnalyzeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.GetNumVertices(), vertexSize);
+    std::printf("  %-8s %8.3f %8.3f %10.3f\n", label, cache.acmr, cache.atvr, fetch.overfetch);
+}
+
+template<typename T>
+void RemapAttribute(std::vector<T>& attribute, size_t numComponents, const std::vector<uint32_t>& remap, size_t numRemappedVertices) {
+    if (attribute.empty()) {
+        return;
+    }
+    std::vector<T> remapped(numRemappedVertices * numComponents);
+    RemapVertexBuffer(remapped.data(), attribute.data(), remap.size(), numComponents * sizeof(T), remap.data());
+    attribute.swap(remapped);
+}
+
+void Optimize(ImportedMesh& mesh, const Options& options) {
+    std::vector<uint32_t> reordered;
+    for (const ImportedMesh::Submesh& submesh : mesh.submeshes) {
+        uint32_t* indices = &mesh.indices[submesh.firstIndex];
+
+        if (options.optimizeVertexCache) {
+            OptimizeVertexCache(indices, indices, submesh.numIndices, mesh.GetNumVertices());
+        }
+
+        if (options.optimizeOverdraw) {
+            reordered.resize(submesh.numIndices);
+            OptimizeOverdraw(reordered.data(), indices, submesh.numIndices, mesh.positions.data(), 3 * sizeof(float),
+                mesh.GetNumVertices(), options.overdrawThreshold);
+            std::copy(reordered.begin(), reordered.end(), indices);
+        }
+    }
+
+    if (options.optimizeVertexFetch) {
+        // Submeshes share the vertices, they are ordered by their first use over all submeshes.
+        std::vector<uint32_t> remap(mesh.GetNumVertices());
+        size_t numVertices = GenerateVertexFetchRemap(remap.data(), mesh.indices.data(), mesh.indices.size(), remap.size());
+        RemapIndexBuffer(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), remap.data());
+        RemapAttribute(mesh.positions, 3, remap, numVertices);
+        RemapAttribute(mesh.normals, 3, remap, numVertices);
+        RemapAttribute(mesh.colors, 3, remap, numVertices);
+        RemapAttribute(mesh.texCoords, 2, remap, numVertices);
+    }
+}
+
+// The source attribute of a semantic, null if the mesh has none.
+const float* GetAttribute(const ImportedMesh& mesh, MeshSemantic semantic) {
+    const std::vector<float>* attribute = nullptr;
+    switch (semantic) {
+        case MeshSemantic::Position:
+            attribute = &mesh.positions;
+            break;
+        case MeshSemantic::Normal:
+            attribute = &mesh.normals;
+            break;
+        case MeshSemantic::Color:
+            attribute = &mesh.colors;
+            break;
+        case MeshSemantic::TexCoord:
+            attribute = &mesh.texCoords;
+            break;
+    }
+    return attribute->empty() ? nullptr : attribute->data();
+}
+
+// Add a stream of the attributes, tightly packed in the given order. Missing colors are white.
+// Returns the stride.
+uint32_t AddStream(MeshFileBuilder& builder, const ImportedMesh& mesh, const MeshSemantic* semantics,
+    const MeshAttributeFormat* formats, uint32_t numAttributes, const MeshFileBounds& bounds) {
+    const uint32_t numVertices = static_cast<uint32_t>(mesh.GetNumVertices());
+
+    MeshFileAttribute attributes[MeshFileMaxAttributes];
+    uint32_t stride = 0;
+    for (uint32_t i = 0; i < numAttributes; ++i) {
+        attributes[i] = { semantics[i], 0, formats[i], stride };
+        stride += GetMeshAttributeFormatSize(formats[i]);
+    }
+
+    const float white[] = { 1.0f, 1.0f, 1.0f };
+    std::vector<uint8_t> vertices(static_cast<size_t>(numVertices) * stride);
+    for (uint32_t i = 0; i < numAttributes; ++i) {
+        const float* source = GetAttribute(mesh, semantics[i]);
+        const uint32_t numComponents = GetMeshSemanticNumComponents(semantics[i]);
+        for (uint32_t j = 0; j < numVertices; ++j) {
+            const float* value = source ? &source[j * numComponents] : white;
+            EncodeAttribute(semantics[i], formats[i], value, bounds, &vertices[static_cast<size_t>(j) * stride + attributes[i].Offset]);
+        }
+    }
+    builder.AddStream(attributes, numAttributes, stride, vertices.data(), numVertices);
+    return stride;
+}
+
+// Build the meshlets of the submesh from its optimized triangle order.
+void AddMeshlets(MeshFileBuilder& builder, const ImportedMesh& mesh, const ImportedMesh::Submesh& submesh) {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    BuildMeshlets(meshlets, meshletVertices, meshletTriangles, &mesh.indices[submesh.firstIndex], submesh.numIndices,
+        mesh.GetNumVertices());
+
+    std::vector<MeshFileMeshlet> fileMeshlets;
+    uint32_t numCullable = 0;
+    for (const Meshlet& meshlet : meshlets) {
+        const MeshletBounds bounds = ComputeMeshletBounds(meshlet, meshletVertices.data(), meshletTriangles.data(),
+            mesh.positions.data(), 3 * sizeof(float));
+
+        MeshFileMeshlet fileMeshlet;
+        fileMeshlet.VertexOffset = meshlet.vertexOffset;
+        fileMeshlet.TriangleOffset = meshlet.triangleOffset;
+        fileMeshlet.NumVertices = meshlet.numVertices;
+        fileMeshlet.NumTriangles = meshlet.numTriangles;
+        std::copy(bounds.center, bounds.center + 3, fileMeshlet.Center);
+        fileMeshlet.Radius = bounds.radius;
+        std::copy(bounds.coneAxis, bounds.coneAxis + 3, fileMeshlet.ConeAxis);
+        fileMeshlet.ConeCutoff = bounds.coneCutoff;
+        fileMeshlets.push_back(fileMeshlet);
+
+        if (bounds.coneCutoff < 1.0f) {
+            ++numCullable;
+        }
+    }
+
+    builder.AddMeshlets(fileMeshlets.data(), static_cast<uint32_t>(fileMeshlets.size()),
+        meshletVertices.data(), static_cast<uint32_t>(meshletVertices.size()),
+        meshletTriangles.data(), static_cast<uint32_t>(meshletTriangles.size()));
+
+    if (!meshlets.empty()) {
+        std::printf("Meshlets: %zu, %.1f vertices and %.1f triangles on average, %u with a cullable normal cone\n",
+            meshlets.size(), static_cast<double>(meshletVertices.size()) / meshlets.size(),
+            static_cast<double>(meshletTriangles.size()) / meshlets.size(), numCullable);
+    }
+}
+
+// Simplify the submesh into a chain of coarser levels and append their indices. Each level is simplified from
+// the full detail so its error is measured against it.
+std::vector<MeshFileLod> BuildLods(std::vector<uint32_t>& indices, const ImportedMesh& mesh, const ImportedMesh::Submesh& submesh,
+    const Options& options) {
+    std::vector<MeshFileLod> lods;
+    std::vector<uint32_t> lodIndices(submesh.numIndices);
+    size_t numPreviousIndices = submesh.numIndices;
+    float targetRatio = 1.0f;
+
+    for (uint32_t i = 0; i < options.numLods; ++i) {
+        targetRatio *= options.lodRatio;
+        const size_t targetNumIndices = static_cast<size_t>(submesh.numIndices * targetRatio) / 3 * 3;
+
+        float error = 0.0f;
+        const size_t numIndices = SimplifyMesh(lodIndices.data(), &mesh.indices[submesh.firstIndex], submesh.numIndices,
+            mesh.positions.data(), 3 * sizeof(float), mesh.GetNumVertices(), targetNumIndices, FLT_MAX, &error);
+        if (numIndices == 0 || numIndices > numPreviousIndices * MinLodReduction) {
+            break;
+        }
+        numPreviousIndices = numIndices;
+
+        if (options.optimizeVertexCache) {
+            OptimizeVertexCache(lodIndices.data(), lodIndices.data(), numIndices, mesh.GetNumVertices());
+        }
+
+        MeshFileLod lod = {};
+        lod.FirstIndex = static_cast<uint32_t>(indices.size());
+        lod.NumIndices = static_cast<uint32_t>(numIndices);
+        lod.Error = error;
+        lods.push_back(lod);
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.begin() + numIndices);
+    }
+
+    if (!lods.empty()) {
+        std::printf("Levels of detail:");
+        for (const MeshFileLod& lod : lods) {
+            std::printf(" %u triangles (error %g)", lod.NumIndices / 3, lod.Error);
+        }
+        std::printf("\n");
+    }
+    return lods;
+}
+
+MeshFileBuilder BuildMeshFile(const ImportedMesh& mesh, const Options& options) {
+    const uint32_t numVertices = static_cast<uint32_t>(mesh.GetNumVertices());
+    MeshFileBuilder builder;
+
+    // Packed positions are relative to the bounds of the mesh, which the builder makes the union of the submeshes.
+    std::vector<MeshFileBounds> submeshBounds;
+    MeshFileBounds bounds = {};
+    for (const ImportedMesh::Submesh& submesh : mesh.submeshes) {
+        submeshBounds.push_back(MeshFileBuilder::ComputeBounds(mesh.positions.data(), 3 * sizeof(float),
+            &mesh.indices[submesh.firstIndex], submesh.numIndices));
+        for (int i = 0; i < 3; ++i) {
+            bounds.Min[i] = submeshBounds.size() == 1 ? submeshBounds.back().Min[i] : std::min(bounds.Min[i], submeshBounds.back().Min[i]);
+            bounds.Max[i] = submeshBounds.size() == 1 ? submeshBounds.back().Max[i] : std::max(bounds.Max[i], submeshBounds.back().Max[i]);
+        }
+    }
+
+    uint32_t vertexSize = 0;
+    uint32_t floatVertexSize = 0;
+
+    // Position and color, white if the source has no colors.
+    {
+        const MeshSemantic semantics[] = { MeshSemantic::Position, MeshSemantic::Color };
+        const MeshAttributeFormat formats[] = { options.positionFormat, options.colorFormat };
+        vertexSize += AddStream(builder, mesh, semantics, formats, 2, bounds);
+        floatVertexSize += 6 * sizeof(float);
+    }
+
+    // Normal and texture coordinates.
+    if (!mesh.normals.empty() || !mesh.texCoords.empty()) {
+        MeshSemantic semantics[2];
+        MeshAttributeFormat formats[2];
+        uint32_t numAttributes = 0;
+        if (!mesh.normals.empty()) {
+            semantics[numAttributes] = MeshSemantic::Normal;
+            formats[numAttributes++] = options.normalFormat;
+            floatVertexSize += 3 * sizeof(float);
+        }
+        if (!mesh.texCoords.empty()) {
+            semantics[numAttributes] = MeshSemantic::TexCoord;
+            formats[numAttributes++] = options.texCoordFormat;
+            floatVertexSize += 2 * sizeof(float);
+        }
+        vertexSize += AddStream(builder, mesh, semantics, formats, numAttributes, bounds);
+    }
+
+    std::printf("Vertices: %u bytes, %u as floats, %.1f KB\n", vertexSize, floatVertexSize,
+        static_cast<double>(vertexSize) * numVertices / 1024.0);
+
+    // The levels of detail of all submeshes follow the full detail indices.
+    std::vector<uint32_t> indices(mesh.indices);
+    std::vector< std::vector<MeshFileLod> > submeshLods;
+    for (const ImportedMesh::Submesh& submesh : mesh.submeshes) {
+        submeshLods.push_back(BuildLods(indices, mesh, submesh, options));
+    }
+
+    builder.SetIndices(indices.data(), static_cast<uint32_t>(indices.size()));
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        builder.AddSubmesh(mesh.submeshes[i].firstIndex, mesh.submeshes[i].numIndices, submeshBounds[i]);
+        if (options.buildMeshlets) {
+            AddMeshlets(builder, mesh, mesh.submeshes[i]);
+        }
+        for (const MeshFileLod& lod : submeshLods[i]) {
+            builder.AddLod(lod.FirstIndex, lod.NumIndices, lod.Error);
+        }
+    }
+    return builder;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::invalid_argument&) {
+        PrintUsage();
+        return 1;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        PrintUsage();
+        return 1;
+    }
+
+    try {
+        ImportedMesh mesh = EndsWith(options.inputPath, ".obj") ? ImportObj(options.inputPath) : ImportGltf(options.inputPath);
+        if (mesh.indices.empty()) {
+            throw std::runtime_error("No triangles in " + options.inputPath + ".");
+        }
+
+        std::printf("%s: %zu vertices, %zu triangles, %zu submeshes\n", options.inputPath.c_str(),
+            mesh.GetNumVertices(), mesh.indices.size() / 3, mesh.submeshes.size());
+        std::printf("  %-8s %8s %8s %10s\n", "", "ACMR", "ATVR", "Overfetch");
+        PrintStatistics("before", mesh, options);
+
+        Optimize(mesh, options);
+        PrintStatistics("after", mesh, options);
+
+        if (!BuildMeshFile(mesh, options).Write(options.outputPath)) {
+            throw std::runtime_error("Cannot write " + options.outputPath + ".");
+        }
+        std::printf("Wrote %s\n", options.outputPath.c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "importer.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// The position, texture coordinate and normal indices of a face corner, 0 if missing.
+struct ObjCorner {
+    int position;
+    int texCoord;
+    int normal;
+
+    bool operator==(const ObjCorner& other) const {
+        return position == other.position && texCoord == other.texCoord && normal == other.normal;
+    }
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner& corner) const {
+        return std::hash<int>()(corner.position) ^ (std::hash<int>()(corner.texCoord) * 31) ^ (std::hash<int>()(corner.normal) * 131);
+    }
+};
+
+const char* SkipSpaces(const char* current, const char* end) {
+    while (current != end && (*current == ' ' || *current == '\t')) {
+        ++current;
+    }
+    return current;
+}
+
+// Parse up to count floats, returns how many were read.
+int ParseFloats(const char* current, const char* end, float* values, int count) {
+    int numValues = 0;
+    while (numValues < count) {
+        current = SkipSpaces(current, end);
+        if (current == end) {
+            break;
+        }
+        char* valueEnd = nullptr;
+        float value = std::strtof(current, &valueEnd);
+        if (valueEnd == current || valueEnd > end) {
+            break;
+        }
+        values[numValues++] = value;
+        current = valueEnd;
+    }
+    return numValues;
+}
+
+// OBJ indices are one based, negative indices count back from the last element.
+int ResolveIndex(long index, size_t numElements, int lineNumber) {
+    long resolved = index < 0 ? static_cast<long>(numElements) + index + 1 : index;
+    if (resolved < 1 || resolved > static_cast<long>(numElements)) {
+        throw std::runtime_error("Index out of range on line " + std::to_string(lineNumber) + ".");
+    }
+    return static_cast<int>(resolved);
+}
+
+}
+
+ImportedMesh ImportObj(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path + ".");
+    }
+    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<float> positions;
+    std::vector<float> colors;
+    std::vector<float> texCoords;
+    std::vector<float> normals;
+    bool hasColors = false;
+
+    ImportedMesh mesh;
+    std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertices;
+    std::vector<ObjCorner> corners;
+    std::vector<ObjCorner> vertexCorners;
+    uint32_t submeshStart = 0;
+
+    int lineNumber = 0;
+    const char* current = contents.data();
+    const char* const end = contents.data() + contents.size();
+    while (current != end) {
+        const char* lineEnd = current;
+        while (lineEnd != end && *lineEnd != '\n' && *lineEnd != '\r') {
+            ++lineEnd;
+        }
+        ++lineNumber;
+
+        const char* line = SkipSpaces(current, lineEnd);
+        current = lineEnd;
+        if (current != end && *current == '\r') {
+            ++current;
+        }
+        if (current != end && *current == '\n') {
+            ++current;
+        }
+
+        if (lineEnd - line >= 2 && line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+            float values[6];
+            int numValues = ParseFloats(line + 2, lineEnd, values, 6);
+            if (numValues < 3) {
+                throw std::runtime_error("Invalid position on line " + std::to_string(lineNumber) + ".");
+            }
+            positions.insert(positions.end(), values, values + 3);
+            if (numValues == 6) {
+                colors.insert(colors.end(), values + 3, values + 6);
+                hasColors = true;
+            } else {
+                colors.insert(colors.end(), { 1.0f, 1.0f, 1.0f });
+            }
+        } else if (lineEnd - line >= 3 && line[0] == 'v' && line[1] == 't' && (line[2] == ' ' || line[2] == '\t')) {
+            float values[2] = {};
+            ParseFloats(line + 3, lineEnd, values, 2);
+            texCoords.insert(texCoords.end(), values, values + 2);
+        } else if (lineEnd - line >= 3 && line[0] == 'v' && line[1] == 'n' && (line[2] == ' ' || line[2] == '\t')) {
+            float values[3] = {};
+            if (ParseFloats(line + 3, lineEnd, values, 3) < 3) {
+                throw std::runtime_error("Invalid normal on line " + std::to_string(lineNumber) + ".");
+            }
+            normals.insert(normals.end(), values, values + 3);
+        } else if (lineEnd - line >= 2 && line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+            corners.clear();
+            const char* token = SkipSpaces(line + 2, lineEnd);
+            while (token != lineEnd) {
+                ObjCorner corner = {};
+                char* tokenEnd = nullptr;
+                corner.position = ResolveIndex(std::strtol(token, &tokenEnd, 10), positions.size() / 3, lineNumber);
+                token = tokenEnd;
+                if (token != lineEnd && *token == '/') {
+                    ++token;
+                    if (token != lineEnd && *token != '/') {
+                        corner.texCoord = ResolveIndex(std::strtol(token, &tokenEnd, 10), texCoords.size() / 2, lineNumber);
+                        token = tokenEnd;
+                    }
+                    if (token != lineEnd && *token == '/') {
+                        ++token;
+                        corner.normal = ResolveIndex(std::strtol(token, &tokenEnd, 10), normals.size() / 3, lineNumber);
+                        token = tokenEnd;
+                    }
+                }
+                corners.push_back(corner);
+                token = SkipSpaces(token, lineEnd);
+            }
+            if (corners.size() < 3) {
+                throw std::runtime_error("Face with less than three vertices on line " + std::to_string(lineNumber) + ".");
+            }
+
+            uint32_t faceVertices[3];
+            for (size_t i = 0; i < corners.size(); ++i) {
+                auto inserted = vertices.emplace(corners[i], static_cast<uint32_t>(vertexCorners.size()));
+                if (inserted.second) {
+                    vertexCorners.push_back(corners[i]);
+                }
+
+                // Fan triangulation with the winding reversed for the clockwise front faces of the renderer.
+                if (i == 0) {
+                    faceVertices[0] = inserted.first->second;
+                } else if (i == 1) {
+                    faceVertices[2] = inserted.first->second;
+                } else {
+                    faceVertices[1] = inserted.first->second;
+                    mesh.indices.insert(mesh.indices.end(), faceVertices, faceVertices + 3);
+                    faceVertices[2] = faceVertices[1];
+                }
+            }
+        } else if (lineEnd - line >= 6 && std::string(line, 6) == "usemtl") {
+            if (mesh.indices.size() > submeshStart) {
+                mesh.submeshes.push_back(ImportedMesh::Submesh{ submeshStart, static_cast<uint32_t>(mesh.indices.size()) - submeshStart });
+                submeshStart = static_cast<uint32_t>(mesh.indices.size());
+            }
+        }
+    }
+
+    if (mesh.indices.size() > submeshStart) {
+        mesh.submeshes.push_back(ImportedMesh::Submesh{ submeshStart, static_cast<uint32_t>(mesh.indices.size()) - submeshStart });
+    }
+
+    bool hasTexCoords = false;
+    bool hasNormals = false;
+    for (const ObjCorner& corner : vertexCorners) {
+        hasTexCoords = hasTexCoords || corner.texCoord != 0;
+        hasNormals = hasNormals || corner.normal != 0;
+    }
+
+    for (const ObjCorner& corner : vertexCorners) {
+        const float* position = &positions[(corner.position - 1) * 3];
+        mesh.positions.insert(mesh.positions.end(), { position[0], position[1], -position[2] });
+        if (hasColors) {
+            const float* color = &colors[(corner.position - 1) * 3];
+            mesh.colors.insert(mesh.colors.end(), color, color + 3);
+        }
+        if (hasTexCoords) {
+            const float* texCoord = corner.texCoord != 0 ? &texCoords[(corner.texCoord - 1) * 2] : nullptr;
+            mesh.texCoords.insert(mesh.texCoords.end(), { texCoord ? texCoord[0] : 0.0f, texCoord ? 1.0f - texCoord[1] : 0.0f });
+        }
+        if (hasNormals) {
+            const float* normal = corner.normal != 0 ? &normals[(corner.normal - 1) * 3] : nullptr;
+            mesh.normals.insert(mesh.normals.end(), { normal ? normal[0] : 0.0f, normal ? normal[1] : 0.0f, normal ? -normal[2] : 0.0f });
+        }
+    }
+
+    return mesh;
+}